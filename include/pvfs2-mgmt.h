@@ -89,6 +89,10 @@ enum PINT_server_perf_keys
     PINT_PERF_IO = 20,                  /* io requests called */
     PINT_PERF_SMALL_IO = 21,            /* small_io requests called */
     PINT_PERF_READDIR = 22,             /* readdir requests called */
+    PINT_PERF_SLAB_BYTES = 23,          /* bytes held by slab caches */
+    PINT_PERF_SLAB_OBJECTS = 24,        /* slab cache objects in use */
+    PINT_PERF_READAHEAD_HIT = 25,       /* bytes read that readahead asked for */
+    PINT_PERF_READAHEAD_WASTE = 26,     /* readahead bytes never read */
 };
 
 /*
@@ -192,6 +196,22 @@ PVFS_error PVFS_mgmt_noop(
     PVFS_BMI_addr_t addr,
     PVFS_hint hints);
 
+PVFS_error PVFS_imgmt_noop_phase(
+    PVFS_fs_id fs_id,
+    const PVFS_credential *credential,
+    PVFS_BMI_addr_t addr,
+    int32_t *startup_phase,
+    PVFS_mgmt_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_mgmt_noop_phase(
+    PVFS_fs_id fs_id,
+    const PVFS_credential *credential,
+    PVFS_BMI_addr_t addr,
+    int32_t *startup_phase,
+    PVFS_hint hints);
+
 const char *PVFS_mgmt_map_addr(
     PVFS_fs_id fs_id,
     PVFS_BMI_addr_t addr,
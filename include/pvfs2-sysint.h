@@ -120,6 +120,15 @@ struct PVFS_sysresp_getattr_s
 };
 typedef struct PVFS_sysresp_getattr_s PVFS_sysresp_getattr;
 
+/** Holds results of a getattr_list operation; the caller provides both
+ *  arrays, with one entry for each handle. */
+struct PVFS_sysresp_getattr_list_s
+{
+    PVFS_sys_attr *attr_array;  /* release each with PVFS_util_release_sys_attr */
+    PVFS_error *err_array;      /* per object status */
+};
+typedef struct PVFS_sysresp_getattr_list_s PVFS_sysresp_getattr_list;
+
 /* setattr */
 /* no data returned in setattr response */
 
@@ -202,6 +211,20 @@ struct PVFS_sysresp_statfs_s
 };
 typedef struct PVFS_sysresp_statfs_s PVFS_sysresp_statfs;
 
+/* copy */
+struct PVFS_sysresp_copy_s
+{
+    PVFS_size total_copied;  /* bytes moved between datafiles */
+};
+typedef struct PVFS_sysresp_copy_s PVFS_sysresp_copy;
+
+/* seek */
+struct PVFS_sysresp_seek_s
+{
+    PVFS_offset offset;  /* start of the data or hole that was found */
+};
+typedef struct PVFS_sysresp_seek_s PVFS_sysresp_seek;
+
 struct PVFS_sysresp_getparent_s
 {
     PVFS_object_ref parent_ref;
@@ -314,6 +337,29 @@ PVFS_error PVFS_sys_getattr(
     PVFS_sysresp_getattr *resp,
     PVFS_hint hints);
 
+/* gets the attributes of many objects with one request for each server
+ * holding some of them
+ */
+PVFS_error PVFS_isys_getattr_list(
+    PVFS_fs_id fs_id,
+    int nhandles,
+    PVFS_handle *handles,
+    uint32_t attrmask,
+    const PVFS_credential *credential,
+    PVFS_sysresp_getattr_list *resp,
+    PVFS_sys_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_sys_getattr_list(
+    PVFS_fs_id fs_id,
+    int nhandles,
+    PVFS_handle *handles,
+    uint32_t attrmask,
+    const PVFS_credential *credential,
+    PVFS_sysresp_getattr_list *resp,
+    PVFS_hint hints);
+
 PVFS_error PVFS_isys_setattr(
     PVFS_object_ref ref,
     PVFS_sys_attr attr,
@@ -420,6 +466,24 @@ PVFS_error PVFS_sys_remove(
     const PVFS_credential *credential,
     PVFS_hint hints);
 
+PVFS_error PVFS_isys_remove_list(
+    PVFS_object_ref parent_ref,
+    int32_t count,
+    char **object_names,
+    const PVFS_credential *credential,
+    PVFS_error *error_array,
+    PVFS_sys_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_sys_remove_list(
+    PVFS_object_ref parent_ref,
+    int32_t count,
+    char **object_names,
+    const PVFS_credential *credential,
+    PVFS_error *error_array,
+    PVFS_hint hints);
+
 PVFS_error PVFS_isys_rename(
     char *old_entry,
     PVFS_object_ref old_parent_ref,
@@ -531,6 +595,40 @@ PVFS_error PVFS_sys_flush(
     const PVFS_credential *credential,
     PVFS_hint hints);
 
+PVFS_error PVFS_isys_copy(
+    PVFS_object_ref src_ref,
+    PVFS_object_ref dst_ref,
+    const PVFS_credential *credential,
+    PVFS_sysresp_copy *resp,
+    PVFS_sys_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_sys_copy(
+    PVFS_object_ref src_ref,
+    PVFS_object_ref dst_ref,
+    const PVFS_credential *credential,
+    PVFS_sysresp_copy *resp,
+    PVFS_hint hints);
+
+PVFS_error PVFS_isys_seek(
+    PVFS_object_ref ref,
+    PVFS_offset offset,
+    enum PVFS_seek_type whence,
+    const PVFS_credential *credential,
+    PVFS_sysresp_seek *resp,
+    PVFS_sys_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_sys_seek(
+    PVFS_object_ref ref,
+    PVFS_offset offset,
+    enum PVFS_seek_type whence,
+    const PVFS_credential *credential,
+    PVFS_sysresp_seek *resp,
+    PVFS_hint hints);
+
 PVFS_error PVFS_isys_statfs(
     PVFS_fs_id fs_id,
     const PVFS_credential *credential,
@@ -556,6 +654,31 @@ PVFS_error PVFS_sys_dist_setparam(
     const char* param,
     void* value);
 
+/** write-behind buffer for one file, see PVFS_sys_wbuf_open() */
+typedef struct PVFS_sys_wbuf_s *PVFS_sys_wbuf;
+
+PVFS_error PVFS_sys_wbuf_open(
+    PVFS_object_ref ref,
+    PVFS_size size,
+    int flush_msecs,
+    const PVFS_credential *credential,
+    PVFS_sys_wbuf *wbuf);
+
+PVFS_error PVFS_sys_wbuf_write(
+    PVFS_sys_wbuf wbuf,
+    PVFS_offset offset,
+    const void *buffer,
+    PVFS_size size,
+    const PVFS_credential *credential);
+
+PVFS_error PVFS_sys_wbuf_flush(
+    PVFS_sys_wbuf wbuf,
+    const PVFS_credential *credential);
+
+PVFS_error PVFS_sys_wbuf_close(
+    PVFS_sys_wbuf wbuf,
+    const PVFS_credential *credential);
+
 PVFS_error PVFS_dist_pv_pairs_extract_and_add(
     const char * pv_pairs,
     void * dist);
@@ -598,6 +721,32 @@ PVFS_error PVFS_sys_geteattr_list(
     PVFS_sysresp_geteattr *resp,
     PVFS_hint hints);
 
+/* reads the same keys from many entries of the directory parent_ref;
+ * resp holds nhandles * nkey values and errors, ordered by handle and
+ * then by key
+ */
+PVFS_error PVFS_isys_geteattr_bulk(
+    PVFS_object_ref parent_ref,
+    int nhandles,
+    PVFS_handle *handles,
+    const PVFS_credential *credential,
+    int32_t nkey,
+    PVFS_ds_keyval *key_p,
+    PVFS_sysresp_geteattr *resp,
+    PVFS_sys_op_id *op_id,
+    PVFS_hint hints,
+    void *user_ptr);
+
+PVFS_error PVFS_sys_geteattr_bulk(
+    PVFS_object_ref parent_ref,
+    int nhandles,
+    PVFS_handle *handles,
+    const PVFS_credential *credential,
+    int32_t nkey,
+    PVFS_ds_keyval *key_p,
+    PVFS_sysresp_geteattr *resp,
+    PVFS_hint hints);
+
 PVFS_error PVFS_isys_seteattr(
     PVFS_object_ref ref,
     const PVFS_credential *credential,
@@ -730,6 +879,8 @@ int PVFS_sys_wait(
     const char *in_op_str,
     int *out_error);
 
+void PVFS_sys_release(PVFS_sys_op_id op_id);
+
 int PVFS_sys_cancel(PVFS_sys_op_id op_id);
 
 #endif
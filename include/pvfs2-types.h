@@ -666,6 +666,17 @@ enum PVFS_server_mode
     PVFS_SERVER_ADMIN_MODE = 2        /* administrative mode */
 };
 
+/* how far a server has got opening its storage after a restart; the
+ * server answers reads in every phase but refuses changes with
+ * -PVFS_EAGAIN until its handle ledgers are rebuilt
+ */
+enum PVFS_server_startup_phase
+{
+    PVFS_SERVER_STARTUP_LEDGER = 1,   /* rebuilding handle ledgers */
+    PVFS_SERVER_STARTUP_CLEANUP = 2,  /* removing stranded bstreams */
+    PVFS_SERVER_STARTUP_READY = 3     /* fully started */
+};
+
 /* PVFS2 ACL structures - Matches Linux ACL EA structures */
 /* matches POSIX ACL-XATTR format */
 typedef struct
@@ -1034,6 +1045,14 @@ enum PVFS_io_type
     PVFS_IO_WRITE = 2
 };
 
+/** PVFS seek types, used in both system and server interfaces.
+ */
+enum PVFS_seek_type
+{
+    PVFS_SEEK_DATA = 1,
+    PVFS_SEEK_HOLE = 2
+};
+
 /*
  * Filesystem "magic" number unique to PVFS2 kernel interface.  Used by
  * ROMIO to auto-detect access method given a mounted path.
@@ -36,6 +36,7 @@ struct options
     char* srcfile;
     char* destfile;
     int show_timings;
+    int client_copy;
 };
 
 enum object_type {
@@ -181,6 +182,38 @@ int main (int argc, char ** argv)
     }
 
     time1 = Wtime();
+
+    /* when both ends are in the same PVFS2 file system, let the servers
+     * move the data.  The copy needs matching layouts; if they differ
+     * (or the copy fails for any other reason) fall back to moving the
+     * data through this client, which rewrites everything from the start.
+     */
+    if (!user_opts->client_copy &&
+        src.fs_type == PVFS2_FILE && dest.fs_type == PVFS2_FILE &&
+        src.u.pvfs2.ref.fs_id == dest.u.pvfs2.ref.fs_id)
+    {
+        PVFS_sysresp_copy resp_copy;
+
+        memset(&resp_copy, 0, sizeof(resp_copy));
+        ret = PVFS_sys_copy(src.u.pvfs2.ref, dest.u.pvfs2.ref,
+                            &credentials, &resp_copy, hints);
+        if (ret == 0)
+        {
+            time2 = Wtime();
+            if (user_opts->show_timings)
+            {
+                print_timings(time2-time1, resp_copy.total_copied);
+            }
+            goto main_out;
+        }
+        if (ret != -PVFS_EINVAL)
+        {
+            PVFS_perror("PVFS_sys_copy", ret);
+            fprintf(stderr, "Falling back to copying through the client\n");
+        }
+        ret = 0;
+    }
+
     while((current_size = generic_read(&src, buffer,
                     total_written, user_opts->buf_size, &credentials)) > 0)
     {
@@ -229,7 +262,7 @@ main_out:
  */
 static struct options* parse_args(int argc, char* argv[])
 {
-    char flags[] = "tvs:n:b:";
+    char flags[] = "tvcs:n:b:";
     int one_opt = 0;
 
     struct options* tmp_opts = NULL;
@@ -257,6 +290,9 @@ static struct options* parse_args(int argc, char* argv[])
             case('t'):
                 tmp_opts->show_timings = 1;
                 break;
+            case('c'):
+                tmp_opts->client_copy = 1;
+                break;
             case('s'):
                 ret = sscanf(optarg, SCANF_lld, (SCANF_lld_type *)&tmp_opts->strip_size);
                 if(ret < 1){
@@ -305,6 +341,8 @@ static void usage(int argc, char** argv)
         "\n-s <strip_size>\t\t\tsize of access to PVFS2 volume"
         "\n-n <num_datafiles>\t\tnumber of PVFS2 datafiles to use"
         "\n-b <buffer_size in bytes>\thow much data to read/write at once"
+        "\n-c\t\t\t\tcopy through the client even when both files"
+        "\n\t\t\t\tare in PVFS2 (no server side copy)"
         "\n-t\t\t\t\tprint some timing information"
         "\n-v\t\t\t\tprint version number and exit\n");
     return;
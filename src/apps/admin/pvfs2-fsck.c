@@ -37,6 +37,8 @@ struct options
     int destructive;
     int safety_check;
     unsigned int safety_count;
+    int parallel;
+    char *checkpoint;
 };
 struct options *fsck_opts = NULL;
 
@@ -156,6 +158,13 @@ int main(int argc, char **argv)
     
     in_admin_mode = 1;
 
+    if (fsck_opts->parallel)
+    {
+        ret = parallel_check(cur_fs, addr_array, server_count, &creds,
+                             &in_admin_mode);
+        goto exit_now;
+    }
+
     hl_all = build_handlelist(cur_fs, addr_array, server_count, &creds);
     if (hl_all == NULL) {
 	ret = -1;
@@ -1181,6 +1190,1204 @@ void cull_leftovers(PVFS_fs_id cur_fs,
 
 /********************************************/
 
+/* parallel check
+ *
+ * The passes above walk the tree from the root one request at a time
+ * and keep every handle in a linearly searched list.  The parallel check
+ * instead scans each server's handle space with
+ * PVFS_mgmt_iterate_handles_list, keeping up to -P requests in flight to
+ * learn each object's type and the handles it refers to (directory
+ * entries, datafiles and dirdata).  Objects and references are appended
+ * to bucket files partitioned by a hash of the handle, and each bucket
+ * is then joined on its own, so memory use is bounded by the largest
+ * bucket rather than by the size of the file system.  Scan progress is
+ * saved in a checkpoint file so that an interrupted check can resume.
+ */
+
+/* handle space partitions; there are two files per bucket */
+#define PFSCK_BUCKET_BITS 8
+#define PFSCK_BUCKETS (1 << PFSCK_BUCKET_BITS)
+
+/* the client completion list holds at most 256 finished operations */
+#define PFSCK_MAX_OPS 256
+#define PFSCK_READDIR_COUNT 512
+#define PFSCK_CHECKPOINT_SECS 60
+
+#define PFSCK_ATTR_MASK \
+    (PVFS_ATTR_SYS_TYPE | PVFS_ATTR_SYS_DFILE_COUNT | PVFS_ATTR_SYS_DISTDIR_ATTR)
+
+#define PFSCK_MAGIC 0x7066736b /* "pfsk" */
+#define PFSCK_VERSION 1
+
+enum pfsck_phase
+{
+    PFSCK_PHASE_SCAN = 1,
+    PFSCK_PHASE_JOIN = 2
+};
+
+enum pfsck_ref_kind
+{
+    PFSCK_REF_DIRENT = 1,
+    PFSCK_REF_DFILE = 2,
+    PFSCK_REF_DIRDATA = 3
+};
+
+/* object flags, only used in memory during the join */
+#define PFSCK_OBJ_REFERENCED 1
+#define PFSCK_OBJ_BROKEN 2
+
+struct pfsck_object
+{
+    PVFS_handle handle;
+    int32_t type;       /* PVFS_TYPE_NONE if the object could not be read */
+    int32_t flags;
+};
+
+/* followed by name_len bytes of entry name for PFSCK_REF_DIRENT */
+struct pfsck_ref
+{
+    PVFS_handle target;
+    PVFS_handle parent;
+    int32_t kind;
+    int32_t name_len;
+};
+
+/* checkpoint file layout:
+ *   struct pfsck_checkpoint
+ *   server_count x PVFS_ds_position (next iterate position per server)
+ *   PFSCK_BUCKETS x 2 x uint64_t (valid length of object, ref files)
+ */
+struct pfsck_checkpoint
+{
+    uint32_t magic;
+    uint32_t version;
+    PVFS_fs_id fs_id;
+    int32_t server_count;
+    int32_t bucket_count;
+    int32_t phase;
+    int32_t next_bucket;
+    int32_t pad;
+    uint64_t handles;
+    uint64_t objects;
+    uint64_t refs;
+};
+
+enum pfsck_op_state
+{
+    PFSCK_OP_FREE = 0,
+    PFSCK_OP_GETATTR,
+    PFSCK_OP_DFILES,
+    PFSCK_OP_DIRDATA,
+    PFSCK_OP_READDIR
+};
+
+struct pfsck_op
+{
+    enum pfsck_op_state state;
+    PVFS_object_ref ref;
+    PVFS_sys_op_id op_id;
+    PVFS_sysresp_getattr getattr_resp;
+    PVFS_sysresp_readdir readdir_resp;
+    PVFS_ds_position token;
+    PVFS_handle *handles;
+    int handle_count;
+};
+
+struct pfsck_state
+{
+    PVFS_fs_id fs_id;
+    PVFS_credential *creds;
+    int server_count;
+    char *prefix;              /* checkpoint path, work files prefix */
+    int temporary;             /* remove work files and prefix dir */
+    struct pfsck_checkpoint ckpt;
+    PVFS_ds_position *positions;
+    uint64_t lengths[PFSCK_BUCKETS][2];
+    FILE *files[PFSCK_BUCKETS][2];
+    struct pfsck_op *ops;
+    int op_max;
+    int op_count;
+    int fatal;                 /* error that makes the scan unusable */
+    time_t last_checkpoint;
+    PVFS_handle *reserved;
+    unsigned long reserved_count;
+    PVFS_handle *broken;
+    unsigned long broken_count;
+    PVFS_handle root_handle;
+};
+
+static int pfsck_bucket(PVFS_handle handle)
+{
+    return (int)((handle * 11400714819323198485ULL) >>
+                 (64 - PFSCK_BUCKET_BITS));
+}
+
+static int pfsck_handle_cmp(const void *a, const void *b)
+{
+    PVFS_handle x = *(const PVFS_handle *)a;
+    PVFS_handle y = *(const PVFS_handle *)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+static int pfsck_handle_find(PVFS_handle *array, unsigned long count,
+                             PVFS_handle handle)
+{
+    return (count && bsearch(&handle, array, count, sizeof(PVFS_handle),
+                             pfsck_handle_cmp) != NULL);
+}
+
+static void pfsck_file_name(struct pfsck_state *st, int bucket, int which,
+                            char *buf, int len)
+{
+    snprintf(buf, len, "%s.%s.%03d", st->prefix,
+             (which ? "ref" : "obj"), bucket);
+}
+
+/* pfsck_open_files()
+ *
+ * opens the bucket files for appending, first cutting them back to the
+ * lengths recorded in the checkpoint so that records written after the
+ * last checkpoint are not duplicated when the scan resumes.
+ */
+static int pfsck_open_files(struct pfsck_state *st)
+{
+    char name[PATH_MAX];
+    int b, w;
+
+    for (b = 0; b < PFSCK_BUCKETS; b++)
+    {
+        for (w = 0; w < 2; w++)
+        {
+            pfsck_file_name(st, b, w, name, sizeof(name));
+            if (st->lengths[b][w] == 0)
+            {
+                st->files[b][w] = fopen(name, "w");
+            }
+            else
+            {
+                if (truncate(name, (off_t)st->lengths[b][w]) != 0)
+                {
+                    perror(name);
+                    return -1;
+                }
+                st->files[b][w] = fopen(name, "a");
+            }
+            if (!st->files[b][w])
+            {
+                perror(name);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void pfsck_close_files(struct pfsck_state *st)
+{
+    int b, w;
+
+    for (b = 0; b < PFSCK_BUCKETS; b++)
+    {
+        for (w = 0; w < 2; w++)
+        {
+            if (st->files[b][w])
+            {
+                fclose(st->files[b][w]);
+                st->files[b][w] = NULL;
+            }
+        }
+    }
+}
+
+static void pfsck_remove_files(struct pfsck_state *st)
+{
+    char name[PATH_MAX];
+    int b, w;
+
+    for (b = 0; b < PFSCK_BUCKETS; b++)
+    {
+        for (w = 0; w < 2; w++)
+        {
+            pfsck_file_name(st, b, w, name, sizeof(name));
+            unlink(name);
+        }
+    }
+    unlink(st->prefix);
+}
+
+/* pfsck_write_checkpoint()
+ *
+ * syncs the bucket files and atomically replaces the checkpoint file
+ */
+static int pfsck_write_checkpoint(struct pfsck_state *st)
+{
+    char tmp[PATH_MAX];
+    FILE *fp;
+    int b, w, ok = 1;
+
+    for (b = 0; b < PFSCK_BUCKETS; b++)
+    {
+        for (w = 0; w < 2 && st->files[b][w]; w++)
+        {
+            if (fflush(st->files[b][w]) != 0 ||
+                fsync(fileno(st->files[b][w])) != 0)
+            {
+                perror("pfsck_write_checkpoint");
+                return -1;
+            }
+            st->lengths[b][w] = (uint64_t)ftello(st->files[b][w]);
+        }
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", st->prefix);
+    fp = fopen(tmp, "w");
+    if (!fp)
+    {
+        perror(tmp);
+        return -1;
+    }
+    ok &= (fwrite(&st->ckpt, sizeof(st->ckpt), 1, fp) == 1);
+    ok &= (fwrite(st->positions, sizeof(PVFS_ds_position),
+                  st->server_count, fp) == st->server_count);
+    ok &= (fwrite(st->lengths, sizeof(st->lengths), 1, fp) == 1);
+    ok &= (fflush(fp) == 0 && fsync(fileno(fp)) == 0);
+    fclose(fp);
+    if (!ok || rename(tmp, st->prefix) != 0)
+    {
+        perror(st->prefix);
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* pfsck_read_checkpoint()
+ *
+ * returns 1 if a checkpoint was loaded, 0 if there is none, -1 on error
+ */
+static int pfsck_read_checkpoint(struct pfsck_state *st)
+{
+    FILE *fp;
+    int ok = 1;
+
+    fp = fopen(st->prefix, "r");
+    if (!fp)
+    {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    ok &= (fread(&st->ckpt, sizeof(st->ckpt), 1, fp) == 1);
+    if (ok && (st->ckpt.magic != PFSCK_MAGIC ||
+               st->ckpt.version != PFSCK_VERSION ||
+               st->ckpt.fs_id != st->fs_id ||
+               st->ckpt.server_count != st->server_count ||
+               st->ckpt.bucket_count != PFSCK_BUCKETS))
+    {
+        fprintf(stderr, "Error: checkpoint %s does not match this file "
+                "system.\n", st->prefix);
+        fclose(fp);
+        return -1;
+    }
+    ok &= (fread(st->positions, sizeof(PVFS_ds_position),
+                 st->server_count, fp) == st->server_count);
+    ok &= (fread(st->lengths, sizeof(st->lengths), 1, fp) == 1);
+    fclose(fp);
+    if (!ok)
+    {
+        fprintf(stderr, "Error: checkpoint %s is truncated.\n", st->prefix);
+        return -1;
+    }
+    return 1;
+}
+
+static int pfsck_add_object(struct pfsck_state *st, PVFS_handle handle,
+                            int32_t type)
+{
+    struct pfsck_object obj;
+
+    obj.handle = handle;
+    obj.type = type;
+    obj.flags = 0;
+    if (fwrite(&obj, sizeof(obj), 1,
+               st->files[pfsck_bucket(handle)][0]) != 1)
+    {
+        st->fatal = -PVFS_EIO;
+        return -1;
+    }
+    st->ckpt.objects++;
+    return 0;
+}
+
+static int pfsck_add_ref(struct pfsck_state *st, PVFS_handle target,
+                         PVFS_handle parent, int32_t kind, const char *name)
+{
+    struct pfsck_ref ref;
+    FILE *fp = st->files[pfsck_bucket(target)][1];
+
+    ref.target = target;
+    ref.parent = parent;
+    ref.kind = kind;
+    ref.name_len = (name ? strlen(name) : 0);
+    if (fwrite(&ref, sizeof(ref), 1, fp) != 1 ||
+        (ref.name_len && fwrite(name, ref.name_len, 1, fp) != 1))
+    {
+        st->fatal = -PVFS_EIO;
+        return -1;
+    }
+    st->ckpt.refs++;
+    return 0;
+}
+
+/* pfsck_op_done()
+ *
+ * processes the result of one step of an object's scan and sets up the
+ * next step, if any.
+ *
+ * returns 1 if op has another step to post, 0 if op is finished
+ */
+static int pfsck_op_done(struct pfsck_state *st, struct pfsck_op *op,
+                         int error)
+{
+    PVFS_sys_attr *attr = &op->getattr_resp.attr;
+    uint32_t i;
+
+    if (error && !(op->state == PFSCK_OP_GETATTR && error == -PVFS_ENOENT))
+    {
+        PVFS_perror("pfsck_op_done", error);
+        fprintf(stderr, "Error: failed to scan handle %llu.\n",
+                llu(op->ref.handle));
+        st->fatal = error;
+        goto finished;
+    }
+
+    switch (op->state)
+    {
+        case PFSCK_OP_GETATTR:
+            if (error)
+            {
+                pfsck_add_object(st, op->ref.handle, PVFS_TYPE_NONE);
+                goto finished;
+            }
+            pfsck_add_object(st, op->ref.handle, attr->objtype);
+            if (attr->objtype == PVFS_TYPE_METAFILE && attr->dfile_count > 0)
+            {
+                op->handle_count = attr->dfile_count;
+                op->state = PFSCK_OP_DFILES;
+            }
+            else if (attr->objtype == PVFS_TYPE_DIRECTORY)
+            {
+                if (attr->distr_dir_servers_max <= 0)
+                {
+                    op->token = PVFS_READDIR_START;
+                    op->state = PFSCK_OP_READDIR;
+                    return 1;
+                }
+                op->handle_count = attr->distr_dir_servers_max;
+                op->state = PFSCK_OP_DIRDATA;
+            }
+            else
+            {
+                goto finished;
+            }
+            op->handles = malloc(op->handle_count * sizeof(PVFS_handle));
+            if (!op->handles)
+            {
+                st->fatal = -PVFS_ENOMEM;
+                goto finished;
+            }
+            return 1;
+        case PFSCK_OP_DFILES:
+        case PFSCK_OP_DIRDATA:
+            for (i = 0; i < op->handle_count; i++)
+            {
+                pfsck_add_ref(st, op->handles[i], op->ref.handle,
+                              (op->state == PFSCK_OP_DFILES ?
+                               PFSCK_REF_DFILE : PFSCK_REF_DIRDATA), NULL);
+            }
+            free(op->handles);
+            op->handles = NULL;
+            if (op->state == PFSCK_OP_DFILES)
+            {
+                goto finished;
+            }
+            op->token = PVFS_READDIR_START;
+            op->state = PFSCK_OP_READDIR;
+            return 1;
+        case PFSCK_OP_READDIR:
+            for (i = 0; i < op->readdir_resp.pvfs_dirent_outcount; i++)
+            {
+                pfsck_add_ref(st, op->readdir_resp.dirent_array[i].handle,
+                              op->ref.handle, PFSCK_REF_DIRENT,
+                              op->readdir_resp.dirent_array[i].d_name);
+            }
+            if (op->readdir_resp.pvfs_dirent_outcount)
+            {
+                free(op->readdir_resp.dirent_array);
+                op->readdir_resp.dirent_array = NULL;
+            }
+            if (op->readdir_resp.pvfs_dirent_outcount == PFSCK_READDIR_COUNT)
+            {
+                op->token = op->readdir_resp.token;
+                return 1;
+            }
+            goto finished;
+        default:
+            assert(0);
+    }
+
+finished:
+    PVFS_util_release_sys_attr(attr);
+    free(op->handles);
+    op->handles = NULL;
+    op->state = PFSCK_OP_FREE;
+    st->op_count--;
+    return 0;
+}
+
+/* pfsck_op_post()
+ *
+ * posts the current step of op, and keeps going for steps that
+ * complete immediately.
+ */
+static void pfsck_op_post(struct pfsck_state *st, struct pfsck_op *op)
+{
+    int ret = 0;
+
+    do
+    {
+        op->op_id = -1;
+        switch (op->state)
+        {
+            case PFSCK_OP_GETATTR:
+                memset(&op->getattr_resp, 0, sizeof(op->getattr_resp));
+                ret = PVFS_isys_getattr(op->ref, PFSCK_ATTR_MASK, st->creds,
+                                        &op->getattr_resp, &op->op_id,
+                                        NULL, op);
+                break;
+            case PFSCK_OP_DFILES:
+                ret = PVFS_imgmt_get_dfile_array(op->ref, st->creds,
+                                                 op->handles,
+                                                 op->handle_count,
+                                                 &op->op_id, NULL, op);
+                break;
+            case PFSCK_OP_DIRDATA:
+                ret = PVFS_imgmt_get_dirdata_array(op->ref, st->creds,
+                                                   op->handles,
+                                                   op->handle_count,
+                                                   &op->op_id, NULL, op);
+                break;
+            case PFSCK_OP_READDIR:
+                memset(&op->readdir_resp, 0, sizeof(op->readdir_resp));
+                ret = PVFS_isys_readdir(op->ref, op->token,
+                                        PFSCK_READDIR_COUNT, st->creds,
+                                        &op->readdir_resp, &op->op_id,
+                                        NULL, op);
+                break;
+            default:
+                assert(0);
+        }
+        if (op->op_id != -1)
+        {
+            /* in flight; finished by pfsck_wait() */
+            return;
+        }
+    } while (pfsck_op_done(st, op, ret));
+}
+
+/* pfsck_wait()
+ *
+ * makes progress on the operations in flight, until a slot is free or,
+ * if all is set, until none are left.
+ */
+static void pfsck_wait(struct pfsck_state *st, int all)
+{
+    PVFS_sys_op_id ids[PFSCK_MAX_OPS];
+    void *user_ptrs[PFSCK_MAX_OPS];
+    int errors[PFSCK_MAX_OPS];
+    int i, count, ret;
+    struct pfsck_op *op;
+
+    while (st->op_count && (all || st->op_count == st->op_max))
+    {
+        count = 0;
+        for (i = 0; i < st->op_max; i++)
+        {
+            if (st->ops[i].state != PFSCK_OP_FREE && st->ops[i].op_id != -1)
+            {
+                ids[count++] = st->ops[i].op_id;
+            }
+        }
+
+        ret = PVFS_sys_testsome(ids, &count, user_ptrs, errors, 100);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_testsome", ret);
+            st->fatal = ret;
+            return;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            op = user_ptrs[i];
+            op->op_id = -1;
+            if (pfsck_op_done(st, op, errors[i]))
+            {
+                pfsck_op_post(st, op);
+            }
+        }
+    }
+}
+
+static void pfsck_scan_handle(struct pfsck_state *st, PVFS_handle handle)
+{
+    struct pfsck_op *op = NULL;
+    int i;
+
+    pfsck_wait(st, 0);
+    for (i = 0; i < st->op_max; i++)
+    {
+        if (st->ops[i].state == PFSCK_OP_FREE)
+        {
+            op = &st->ops[i];
+            break;
+        }
+    }
+    assert(op);
+
+    st->op_count++;
+    op->ref.handle = handle;
+    op->ref.fs_id = st->fs_id;
+    op->state = PFSCK_OP_GETATTR;
+    pfsck_op_post(st, op);
+}
+
+/* pfsck_iterate()
+ *
+ * runs PVFS_mgmt_iterate_handles_list on all servers, starting at
+ * positions, calling fn for each batch.  Each server is its own
+ * partition of the handle space; batches from all servers are fetched
+ * together.  round_fn, if given, is called once the batches of every
+ * server have been handled, the only time positions describe what has
+ * been done.
+ */
+static int pfsck_iterate(struct pfsck_state *st,
+                         PVFS_BMI_addr_t *addr_array,
+                         PVFS_ds_position *positions,
+                         int flags,
+                         int (*fn)(struct pfsck_state *, PVFS_handle *, int),
+                         int (*round_fn)(struct pfsck_state *))
+{
+    PVFS_handle **handle_matrix;
+    int *hcount_array;
+    int i, ret = 0, more = 1;
+
+    handle_matrix = calloc(st->server_count, sizeof(PVFS_handle *));
+    hcount_array = calloc(st->server_count, sizeof(int));
+    if (!handle_matrix || !hcount_array)
+    {
+        free(handle_matrix);
+        free(hcount_array);
+        return -PVFS_ENOMEM;
+    }
+    for (i = 0; i < st->server_count; i++)
+    {
+        handle_matrix[i] = calloc(HANDLE_BATCH, sizeof(PVFS_handle));
+        if (!handle_matrix[i])
+        {
+            ret = -PVFS_ENOMEM;
+            goto out;
+        }
+    }
+
+    while (more)
+    {
+        more = 0;
+        for (i = 0; i < st->server_count; i++)
+        {
+            hcount_array[i] =
+                (positions[i] == PVFS_ITERATE_END) ? 0 : HANDLE_BATCH;
+            more |= hcount_array[i];
+        }
+        if (!more)
+        {
+            break;
+        }
+
+        PVFS_util_refresh_credential(st->creds);
+        ret = PVFS_mgmt_iterate_handles_list(st->fs_id, st->creds,
+                                             handle_matrix, hcount_array,
+                                             positions, addr_array,
+                                             st->server_count, flags,
+                                             NULL, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_mgmt_iterate_handles_list", ret);
+            goto out;
+        }
+
+        for (i = 0; i < st->server_count; i++)
+        {
+            ret = fn(st, handle_matrix[i], hcount_array[i]);
+            if (ret < 0)
+            {
+                goto out;
+            }
+        }
+        if (round_fn)
+        {
+            ret = round_fn(st);
+            if (ret < 0)
+            {
+                goto out;
+            }
+        }
+    }
+    ret = 0;
+
+out:
+    for (i = 0; i < st->server_count; i++)
+    {
+        free(handle_matrix[i]);
+    }
+    free(handle_matrix);
+    free(hcount_array);
+    return ret;
+}
+
+static int pfsck_add_reserved(struct pfsck_state *st,
+                              PVFS_handle *handles, int count)
+{
+    PVFS_handle *tmp;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    tmp = realloc(st->reserved,
+                  (st->reserved_count + count) * sizeof(PVFS_handle));
+    if (!tmp)
+    {
+        return -PVFS_ENOMEM;
+    }
+    st->reserved = tmp;
+    memcpy(st->reserved + st->reserved_count, handles,
+           count * sizeof(PVFS_handle));
+    st->reserved_count += count;
+    return 0;
+}
+
+/* pfsck_scan_batch()
+ *
+ * scans one batch of handles returned by a server
+ */
+static int pfsck_scan_batch(struct pfsck_state *st,
+                            PVFS_handle *handles, int count)
+{
+    int i;
+
+    for (i = 0; i < count && !st->fatal; i++)
+    {
+        st->ckpt.handles++;
+        if (!pfsck_handle_find(st->reserved, st->reserved_count, handles[i]))
+        {
+            pfsck_scan_handle(st, handles[i]);
+        }
+    }
+    if (st->fatal)
+    {
+        pfsck_wait(st, 1);
+        return st->fatal;
+    }
+    return 0;
+}
+
+/* pfsck_scan_round()
+ *
+ * checkpoints, if enough time has passed, once the batches of every
+ * server in a round have been scanned.  The iterate positions have then
+ * moved past exactly the handles scanned, and waiting for every request
+ * to finish keeps them from running ahead of the records in the bucket
+ * files.
+ */
+static int pfsck_scan_round(struct pfsck_state *st)
+{
+    if (time(NULL) - st->last_checkpoint >= PFSCK_CHECKPOINT_SECS)
+    {
+        pfsck_wait(st, 1);
+        if (st->fatal || pfsck_write_checkpoint(st) != 0)
+        {
+            return st->fatal ? st->fatal : -PVFS_EIO;
+        }
+        st->last_checkpoint = time(NULL);
+        if (fsck_opts->verbose)
+        {
+            printf("# scanned %llu handles: %llu objects, %llu references.\n",
+                   llu(st->ckpt.handles), llu(st->ckpt.objects),
+                   llu(st->ckpt.refs));
+        }
+    }
+    return 0;
+}
+
+/* pfsck_load_objects()
+ *
+ * reads a bucket's object records into a sorted array
+ */
+static struct pfsck_object *pfsck_load_objects(struct pfsck_state *st,
+                                               int bucket,
+                                               unsigned long *count)
+{
+    char name[PATH_MAX];
+    struct pfsck_object *objs = NULL;
+    struct stat sbuf;
+    FILE *fp;
+
+    *count = 0;
+    pfsck_file_name(st, bucket, 0, name, sizeof(name));
+    fp = fopen(name, "r");
+    if (!fp || fstat(fileno(fp), &sbuf) != 0)
+    {
+        perror(name);
+        if (fp)
+        {
+            fclose(fp);
+        }
+        return NULL;
+    }
+
+    *count = sbuf.st_size / sizeof(struct pfsck_object);
+    objs = malloc((*count + 1) * sizeof(struct pfsck_object));
+    if (!objs || fread(objs, sizeof(struct pfsck_object), *count, fp) != *count)
+    {
+        perror(name);
+        free(objs);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    /* the handle is the first member, so handles compare objects too */
+    qsort(objs, *count, sizeof(struct pfsck_object), pfsck_handle_cmp);
+    return objs;
+}
+
+static struct pfsck_object *pfsck_find_object(struct pfsck_object *objs,
+                                              unsigned long count,
+                                              PVFS_handle handle)
+{
+    return bsearch(&handle, objs, count, sizeof(struct pfsck_object),
+                   pfsck_handle_cmp);
+}
+
+/* pfsck_next_ref()
+ *
+ * reads the next reference record, and its name into name
+ *
+ * returns 1 on success, 0 at end of file, -1 on error
+ */
+static int pfsck_next_ref(FILE *fp, struct pfsck_ref *ref, char *name)
+{
+    if (fread(ref, sizeof(*ref), 1, fp) != 1)
+    {
+        return feof(fp) ? 0 : -1;
+    }
+    if (ref->name_len < 0 || ref->name_len > PVFS_NAME_MAX ||
+        (ref->name_len && fread(name, ref->name_len, 1, fp) != 1))
+    {
+        return -1;
+    }
+    name[ref->name_len] = '\0';
+    return 1;
+}
+
+/* pfsck_find_broken()
+ *
+ * first join: finds metafiles and directories that refer to datafiles
+ * or dirdata that do not exist.  These are expected to be rare, so they
+ * are kept in memory for the second join.
+ */
+static int pfsck_find_broken(struct pfsck_state *st)
+{
+    char name[PATH_MAX];
+    char entry[PVFS_NAME_MAX + 1];
+    struct pfsck_object *objs, *obj;
+    struct pfsck_ref ref;
+    unsigned long count, alloc = 0;
+    PVFS_handle *tmp;
+    FILE *fp;
+    int b, ret;
+
+    for (b = 0; b < PFSCK_BUCKETS; b++)
+    {
+        objs = pfsck_load_objects(st, b, &count);
+        pfsck_file_name(st, b, 1, name, sizeof(name));
+        fp = fopen(name, "r");
+        if (!objs || !fp)
+        {
+            free(objs);
+            if (fp)
+            {
+                fclose(fp);
+            }
+            return -1;
+        }
+
+        while ((ret = pfsck_next_ref(fp, &ref, entry)) == 1)
+        {
+            if (ref.kind == PFSCK_REF_DIRENT)
+            {
+                continue;
+            }
+            obj = pfsck_find_object(objs, count, ref.target);
+            if (obj && obj->type != PVFS_TYPE_NONE)
+            {
+                continue;
+            }
+
+            printf("# %s handle %llu of %llu missing from list\n",
+                   (ref.kind == PFSCK_REF_DFILE ? "datafile" : "dirdata"),
+                   llu(ref.target), llu(ref.parent));
+            if (st->broken_count == alloc)
+            {
+                alloc = alloc ? 2 * alloc : 64;
+                tmp = realloc(st->broken, alloc * sizeof(PVFS_handle));
+                if (!tmp)
+                {
+                    ret = -1;
+                    break;
+                }
+                st->broken = tmp;
+            }
+            st->broken[st->broken_count++] = ref.parent;
+        }
+        fclose(fp);
+        free(objs);
+        if (ret < 0)
+        {
+            fprintf(stderr, "Error: failed to read %s.\n", name);
+            return -1;
+        }
+    }
+
+    qsort(st->broken, st->broken_count, sizeof(PVFS_handle),
+          pfsck_handle_cmp);
+    return 0;
+}
+
+/* pfsck_join_bucket()
+ *
+ * second join, for one bucket: checks every reference to an object in
+ * the bucket, then repairs the objects nothing valid refers to.
+ */
+static int pfsck_join_bucket(struct pfsck_state *st, int b)
+{
+    char name[PATH_MAX];
+    char entry[PVFS_NAME_MAX + 1];
+    static char lostname[64];
+    struct pfsck_object *objs, *obj;
+    struct pfsck_ref ref;
+    PVFS_object_ref dir_ref, obj_ref;
+    unsigned long count, i;
+    FILE *fp;
+    int ret;
+
+    objs = pfsck_load_objects(st, b, &count);
+    pfsck_file_name(st, b, 1, name, sizeof(name));
+    fp = fopen(name, "r");
+    if (!objs || !fp)
+    {
+        free(objs);
+        if (fp)
+        {
+            fclose(fp);
+        }
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (pfsck_handle_find(st->broken, st->broken_count, objs[i].handle))
+        {
+            objs[i].flags |= PFSCK_OBJ_BROKEN;
+        }
+    }
+
+    dir_ref.fs_id = obj_ref.fs_id = st->fs_id;
+    while ((ret = pfsck_next_ref(fp, &ref, entry)) == 1)
+    {
+        /* a broken object is removed, so what it refers to is not
+         * referenced any more
+         */
+        if (pfsck_handle_find(st->broken, st->broken_count, ref.parent))
+        {
+            continue;
+        }
+
+        obj = pfsck_find_object(objs, count, ref.target);
+        if (ref.kind == PFSCK_REF_DIRENT &&
+            (!obj || obj->type == PVFS_TYPE_NONE ||
+             (obj->flags & PFSCK_OBJ_BROKEN)))
+        {
+            PVFS_util_refresh_credential(st->creds);
+            dir_ref.handle = ref.parent;
+            obj_ref.handle = ref.target;
+            remove_directory_entry(dir_ref, obj_ref, entry, st->creds);
+            continue;
+        }
+        if (obj)
+        {
+            obj->flags |= PFSCK_OBJ_REFERENCED;
+        }
+    }
+    fclose(fp);
+    if (ret < 0)
+    {
+        fprintf(stderr, "Error: failed to read %s.\n", name);
+        free(objs);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        obj = &objs[i];
+        obj_ref.handle = obj->handle;
+        PVFS_util_refresh_credential(st->creds);
+
+        if (obj->flags & PFSCK_OBJ_BROKEN)
+        {
+            printf("* %s %llu is not recoverable.\n",
+                   (obj->type == PVFS_TYPE_DIRECTORY ? "Directory" : "File"),
+                   llu(obj->handle));
+            remove_object(obj_ref, obj->type, st->creds);
+            continue;
+        }
+        if (obj->type == PVFS_TYPE_NONE)
+        {
+            /* remove anything we can't get attributes on */
+            remove_object(obj_ref, obj->type, st->creds);
+            continue;
+        }
+        if ((obj->flags & PFSCK_OBJ_REFERENCED) ||
+            obj->handle == st->root_handle)
+        {
+            continue;
+        }
+
+        switch (obj->type)
+        {
+            case PVFS_TYPE_METAFILE:
+            case PVFS_TYPE_SYMLINK:
+                snprintf(lostname, sizeof(lostname), "lostfile.%llu",
+                         llu(obj->handle));
+                create_dirent(laf_ref, lostname, obj->handle, st->creds);
+                break;
+            case PVFS_TYPE_DIRECTORY:
+                snprintf(lostname, sizeof(lostname), "lostdir.%llu",
+                         llu(obj->handle));
+                create_dirent(laf_ref, lostname, obj->handle, st->creds);
+                break;
+            default:
+                /* unreferenced datafile or dirdata */
+                remove_object(obj_ref, obj->type, st->creds);
+                break;
+        }
+    }
+
+    free(objs);
+    return 0;
+}
+
+int parallel_check(PVFS_fs_id cur_fs,
+                   PVFS_BMI_addr_t *addr_array,
+                   int server_count,
+                   PVFS_credential *creds,
+                   int *in_admin_mode)
+{
+    struct pfsck_state st;
+    struct PVFS_mgmt_setparam_value param_value;
+    PVFS_sysresp_lookup lookup_resp;
+    PVFS_ds_position *reserved_positions = NULL;
+    char tmpdir[] = "/tmp/pvfs2-fsck.XXXXXX";
+    char tmpname[PATH_MAX];
+    int ret = -1, i, b;
+
+    memset(&st, 0, sizeof(st));
+    st.fs_id = cur_fs;
+    st.creds = creds;
+    st.server_count = server_count;
+    st.op_max = fsck_opts->parallel;
+
+    if (fsck_opts->checkpoint)
+    {
+        st.prefix = fsck_opts->checkpoint;
+    }
+    else
+    {
+        if (!mkdtemp(tmpdir))
+        {
+            perror("mkdtemp");
+            return -1;
+        }
+        snprintf(tmpname, sizeof(tmpname), "%s/checkpoint", tmpdir);
+        st.prefix = tmpname;
+        st.temporary = 1;
+    }
+
+    st.positions = calloc(server_count, sizeof(PVFS_ds_position));
+    reserved_positions = calloc(server_count, sizeof(PVFS_ds_position));
+    st.ops = calloc(st.op_max, sizeof(struct pfsck_op));
+    if (!st.positions || !reserved_positions || !st.ops)
+    {
+        perror("malloc");
+        goto out;
+    }
+
+    PVFS_util_refresh_credential(creds);
+    ret = PVFS_sys_lookup(cur_fs, "/", creds, &lookup_resp,
+                          PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+    if (ret != 0)
+    {
+        PVFS_perror("PVFS_sys_lookup", ret);
+        goto out;
+    }
+    st.root_handle = lookup_resp.ref.handle;
+
+    ret = pfsck_read_checkpoint(&st);
+    if (ret < 0)
+    {
+        goto out;
+    }
+    if (ret == 0)
+    {
+        st.ckpt.magic = PFSCK_MAGIC;
+        st.ckpt.version = PFSCK_VERSION;
+        st.ckpt.fs_id = cur_fs;
+        st.ckpt.server_count = server_count;
+        st.ckpt.bucket_count = PFSCK_BUCKETS;
+        st.ckpt.phase = PFSCK_PHASE_SCAN;
+        for (i = 0; i < server_count; i++)
+        {
+            st.positions[i] = PVFS_ITERATE_START;
+        }
+    }
+    else
+    {
+        printf("# resuming from checkpoint %s: %llu handles scanned.\n",
+               st.prefix, llu(st.ckpt.handles));
+    }
+
+    if (st.ckpt.phase == PFSCK_PHASE_SCAN)
+    {
+        /* reserved handles do not belong to any object yet */
+        for (i = 0; i < server_count; i++)
+        {
+            reserved_positions[i] = PVFS_ITERATE_START;
+        }
+        ret = pfsck_iterate(&st, addr_array, reserved_positions,
+                            PVFS_MGMT_RESERVED, pfsck_add_reserved, NULL);
+        if (ret < 0)
+        {
+            goto out;
+        }
+        qsort(st.reserved, st.reserved_count, sizeof(PVFS_handle),
+              pfsck_handle_cmp);
+
+        printf("# parallel check: scanning handles with %d concurrent "
+               "requests.\n", st.op_max);
+        if (pfsck_open_files(&st) != 0)
+        {
+            ret = -1;
+            goto out;
+        }
+        ret = pfsck_iterate(&st, addr_array, st.positions, 0,
+                            pfsck_scan_batch, pfsck_scan_round);
+        pfsck_wait(&st, 1);
+        if (ret < 0 || st.fatal)
+        {
+            /* the last checkpoint is still good */
+            fprintf(stderr, "Error: scan stopped; rerun with the same "
+                    "checkpoint to resume.\n");
+            ret = -1;
+            goto out;
+        }
+
+        st.ckpt.phase = PFSCK_PHASE_JOIN;
+        st.ckpt.next_bucket = 0;
+        if (pfsck_write_checkpoint(&st) != 0)
+        {
+            ret = -1;
+            goto out;
+        }
+        pfsck_close_files(&st);
+    }
+
+    printf("# parallel check: %llu handles scanned, %llu objects, "
+           "%llu references.\n", llu(st.ckpt.handles),
+           llu(st.ckpt.objects), llu(st.ckpt.refs));
+
+    /* drop out of admin mode now that the scan is complete; as in the
+     * serial check, repairs are made with the servers in normal mode
+     */
+    PVFS_util_refresh_credential(creds);
+    param_value.type = PVFS_MGMT_PARAM_TYPE_UINT64;
+    param_value.u.value = PVFS_SERVER_NORMAL_MODE;
+    PVFS_mgmt_setparam_list(cur_fs,
+                            creds,
+                            PVFS_SERV_PARAM_MODE,
+                            &param_value,
+                            addr_array,
+                            server_count,
+                            NULL, NULL);
+    *in_admin_mode = 0;
+
+    printf("# parallel check: finding files with missing datafiles or "
+           "dirdata.\n");
+    ret = pfsck_find_broken(&st);
+    if (ret != 0)
+    {
+        goto out;
+    }
+
+    printf("# parallel check: cross-checking references.\n");
+    for (b = st.ckpt.next_bucket; b < PFSCK_BUCKETS; b++)
+    {
+        ret = pfsck_join_bucket(&st, b);
+        if (ret != 0)
+        {
+            goto out;
+        }
+        st.ckpt.next_bucket = b + 1;
+        if (pfsck_write_checkpoint(&st) != 0)
+        {
+            ret = -1;
+            goto out;
+        }
+    }
+
+    /* all done; the work files are no longer needed */
+    pfsck_remove_files(&st);
+    ret = 0;
+
+out:
+    pfsck_close_files(&st);
+    if (st.temporary)
+    {
+        if (ret != 0)
+        {
+            pfsck_remove_files(&st);
+        }
+        rmdir(tmpdir);
+    }
+    free(st.positions);
+    free(reserved_positions);
+    free(st.ops);
+    free(st.reserved);
+    free(st.broken);
+    return ret;
+}
+
+/********************************************/
+
 int create_lost_and_found(PVFS_fs_id cur_fs,
 			  PVFS_credential *creds)
 {
@@ -1631,7 +2838,7 @@ static struct options *parse_args(int argc, char *argv[])
     memset(opts, 0, sizeof(struct options));
 
     /* look at command line arguments */
-    while((one_opt = getopt(argc, argv, "apyns:vVm:")) != EOF){
+    while((one_opt = getopt(argc, argv, "apyns:vVm:P:c:")) != EOF){
 	switch(one_opt)
         {
 	    case 'a':
@@ -1646,6 +2853,19 @@ static struct options *parse_args(int argc, char *argv[])
                 opts->safety_count = atoi(optarg);
                 opts->safety_check = 1;
                 break;
+            case 'P':
+                opts->parallel = atoi(optarg);
+                if (opts->parallel < 1 || opts->parallel > PFSCK_MAX_OPS)
+                {
+                    fprintf(stderr, "Error: -P must be between 1 and %d.\n",
+                            PFSCK_MAX_OPS);
+                    free(opts);
+                    return NULL;
+                }
+                break;
+            case 'c':
+                opts->checkpoint = optarg;
+                break;
             case 'V':
                 printf("%s\n", PVFS2_VERSION);
                 exit(0);
@@ -1686,6 +2906,13 @@ static struct options *parse_args(int argc, char *argv[])
 	return NULL;
     }
 
+    if (opts->checkpoint && !opts->parallel)
+    {
+        fprintf(stderr, "Error: -c requires -P.\n");
+        free(opts);
+        return NULL;
+    }
+
     return opts;
 }
 
@@ -1693,7 +2920,7 @@ static struct options *parse_args(int argc, char *argv[])
 static void usage(int argc, char** argv)
 {
     fprintf(stderr, "\n");
-    fprintf(stderr, "Usage  : %s [-vV] <-ayp -s N> [-m fs_mount_point]\n",
+    fprintf(stderr, "Usage  : %s [-vV] <-ayp -s N> [-P N [-c FILE]] [-m fs_mount_point]\n",
 	argv[0]);
     fprintf(stderr, "Display information about contents of file system.\n");
     fprintf(stderr, "  -V              print version and exit\n");
@@ -1704,6 +2931,10 @@ static void usage(int argc, char** argv)
     fprintf(stderr, "  -y              answer \"yes\" to all questions\n");
     fprintf(stderr, "  -p              automatically repair with no questions\n");
     fprintf(stderr, "  -a              equivalent to \"-p\"\n");
+    fprintf(stderr, "  -P N            parallel check of the whole handle "
+                                       "space, N requests in flight\n");
+    fprintf(stderr, "  -c FILE         checkpoint file for -P; resumes an "
+                                       "interrupted check\n");
 
     fprintf(stderr, "Example: %s -m /mnt/pvfs2\n",
 	argv[0]);
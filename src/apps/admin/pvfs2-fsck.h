@@ -58,6 +58,12 @@ void cull_leftovers(PVFS_fs_id cur_fs,
 		    PVFS_id_gen_t *addr_array,
 		    PVFS_credential *creds);
 
+int parallel_check(PVFS_fs_id cur_fs,
+                   PVFS_BMI_addr_t *addr_array,
+                   int server_count,
+                   PVFS_credential *creds,
+                   int *in_admin_mode);
+
 /* fs modification functions */
 int create_lost_and_found(PVFS_fs_id cur_fs,
 			  PVFS_credential *creds);
@@ -48,7 +48,7 @@
   arbitrarily restrict the number of paths
   that this ls version can take as arguments
 */
-#define MAX_NUM_PATHS       8
+#define MAX_NUM_PATHS       64
 
 /*
   Max length of the fully formatted date/time fields
@@ -117,6 +117,13 @@ static void print_entry_attr(
     struct options *opts,
     char *entry_buffer);
 
+static int list_files(
+    char pvfs_path[][PVFS_NAME_MAX],
+    PVFS_fs_id *fs_id_array,
+    struct options *opts,
+    int *listed,
+    char *entry_buffer);
+
 #define print_dot_and_dot_dot_info_if_required(refn)        \
 do {                                                        \
     if (opts->list_all && !opts->list_almost_all) {         \
@@ -751,6 +758,103 @@ int do_list(
     return 0;
 }
 
+/* list_files()
+ *
+ * lists the paths given on the command line that are not directories,
+ * before any directory is listed, as /bin/ls does.  the attributes of
+ * all of them are fetched together, with one request to each server of
+ * each file system.  listed[i] is set for each path listed here; the
+ * others (directories, and paths that could not be looked up or stat'ed)
+ * are left to do_list().
+ *
+ * returns the number of paths listed
+ */
+int list_files(
+    char pvfs_path[][PVFS_NAME_MAX],
+    PVFS_fs_id *fs_id_array,
+    struct options *opts,
+    int *listed,
+    char *entry_buffer)
+{
+    int i, j, ret, count, total = 0;
+    PVFS_credential credentials;
+    PVFS_sysresp_lookup lk_response;
+    PVFS_sysresp_getattr_list getattr_response;
+    PVFS_handle handles[MAX_NUM_PATHS];
+    PVFS_sys_attr attrs[MAX_NUM_PATHS];
+    PVFS_error errors[MAX_NUM_PATHS];
+    int index[MAX_NUM_PATHS], done[MAX_NUM_PATHS] = {0};
+    char segment[128];
+
+    ret = PVFS_util_gen_credential_defaults(&credentials);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_gen_credential_defaults", ret);
+        return 0;
+    }
+
+    getattr_response.attr_array = attrs;
+    getattr_response.err_array = errors;
+
+    /* one batch for each file system named */
+    for (i = 0; i < opts->num_starts; i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+
+        count = 0;
+        for (j = i; j < opts->num_starts; j++)
+        {
+            if (done[j] || fs_id_array[j] != fs_id_array[i])
+            {
+                continue;
+            }
+            done[j] = 1;
+            memset(&lk_response, 0, sizeof(PVFS_sysresp_lookup));
+            if (PVFS_sys_lookup(fs_id_array[j], pvfs_path[j], &credentials,
+                                &lk_response, PVFS2_LOOKUP_LINK_NO_FOLLOW,
+                                NULL) == 0)
+            {
+                handles[count] = lk_response.ref.handle;
+                /* in case the batch cannot even be started */
+                errors[count] = -PVFS_EIO;
+                index[count++] = j;
+            }
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+
+        /* a failed batch leaves each path to report its own error */
+        ret = PVFS_sys_getattr_list(fs_id_array[i], count, handles,
+                                    (opts->list_long) ?
+                                    PVFS_ATTR_SYS_ALL_NOHINT :
+                                    PVFS_ATTR_SYS_ALL_NOSIZE,
+                                    &credentials, &getattr_response, NULL);
+
+        for (j = 0; j < count; j++)
+        {
+            if (errors[j] != 0)
+            {
+                continue;
+            }
+            if (ret == 0 && attrs[j].objtype != PVFS_TYPE_DIRECTORY)
+            {
+                PINT_remove_base_dir(pvfs_path[index[j]], segment, 128);
+                print_entry(segment, handles[j], fs_id_array[i], &attrs[j],
+                            0, opts, entry_buffer);
+                listed[index[j]] = 1;
+                total++;
+            }
+            PVFS_util_release_sys_attr(&attrs[j]);
+        }
+    }
+    return total;
+}
+
 /* parse_args()
  *
  * parses command line arguments
@@ -1108,6 +1212,7 @@ int main(int argc, char **argv)
     int ret = -1, i = 0;
     char pvfs_path[MAX_NUM_PATHS][PVFS_NAME_MAX];
     PVFS_fs_id fs_id_array[MAX_NUM_PATHS] = {0};
+    int listed[MAX_NUM_PATHS] = {0};
     const PVFS_util_tab* tab;
     struct options* user_opts = NULL;
     char current_dir[PVFS_NAME_MAX] = {0};
@@ -1218,6 +1323,20 @@ int main(int argc, char **argv)
         user_opts->start[i][++j] = '\0';
 
         PINT_string_rm_extra_slashes_rts(user_opts->start[i], 1);
+    }
+
+    if (list_files(pvfs_path, fs_id_array, user_opts, listed,
+                   entry_buffer) > 0 && user_opts->num_starts > 1)
+    {
+        printf("\n");
+    }
+
+    for(i = 0; i < user_opts->num_starts; i++)
+    {
+        if (listed[i])
+        {
+            continue;
+        }
 
         do_list(user_opts->start[i], pvfs_path[i], fs_id_array[i], user_opts, entry_buffer);
 
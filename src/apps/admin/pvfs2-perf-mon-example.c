@@ -27,7 +27,7 @@
 #define PVFS2_VERSION "Unknown"
 #endif
 
-#define MAX_KEY_CNT 23
+#define MAX_KEY_CNT 27
 /* macros for accessing data returned from server */
 #define VALID_FLAG(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + key_cnt] != 0.0)
 #define ID(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + key_cnt])
@@ -56,6 +56,10 @@
 #define IO(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 20])
 #define SMALLIO(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 21])
 #define READDIR(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 22])
+#define SLAB_BYTES(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 23])
+#define SLAB_OBJECTS(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 24])
+#define RA_HIT(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 25])
+#define RA_WASTE(s,h) (perf_matrix[(s)][((h) * (key_cnt + 2)) + 26])
 
 int key_cnt; /* holds the Number of keys */
 
@@ -322,6 +326,10 @@ int main(int argc, char **argv)
             PRINT_COUNTER("\nrmdir:   ", RMDIRS(i, j));
             PRINT_COUNTER("\ngetattrs: ", GETATTRS(i, j));
             PRINT_COUNTER("\nsetattrs: ", SETATTRS(i, j));
+            PRINT_COUNTER("\nslab bytes: ", SLAB_BYTES(i, j));
+            PRINT_COUNTER("\nslab objects: ", SLAB_OBJECTS(i, j));
+            PRINT_COUNTER("\nreadahead hit: ", RA_HIT(i, j));
+            PRINT_COUNTER("\nreadahead waste: ", RA_WASTE(i, j));
 	    PRINT_COUNTER("\ntimestep: ", (unsigned)ID(i, j));
 	    printf("\n");
 	}
@@ -41,6 +41,7 @@ static int print_config(PVFS_fs_id fsid);
 static int noop_all_servers(PVFS_fs_id fsid);
 static void print_error_details(PVFS_error_details * error_details);
 static void print_root_check_error_details(PVFS_error_details * error_details);
+static const char *startup_phase_string(int32_t phase);
 
 int main(int argc, char **argv)
 {
@@ -281,6 +282,7 @@ static int noop_all_servers(PVFS_fs_id fsid)
     PVFS_BMI_addr_t* addr_array;
     int i;
     int tmp;
+    int32_t phase;
  
     ret = PVFS_util_gen_credential_defaults(&creds);
     if (ret < 0)
@@ -317,10 +319,10 @@ static int noop_all_servers(PVFS_fs_id fsid)
     {
 	printf("   %s ",
                PVFS_mgmt_map_addr(fsid, addr_array[i], &tmp));
-	ret = PVFS_mgmt_noop(fsid, &creds, addr_array[i], NULL);
+	ret = PVFS_mgmt_noop_phase(fsid, &creds, addr_array[i], &phase, NULL);
 	if (ret == 0)
 	{
-	    printf("Ok\n");
+	    printf("Ok%s\n", startup_phase_string(phase));
 	}
 	else
 	{
@@ -359,10 +361,10 @@ static int noop_all_servers(PVFS_fs_id fsid)
     {
 	printf("   %s ",
                PVFS_mgmt_map_addr(fsid, addr_array[i], &tmp));
-	ret = PVFS_mgmt_noop(fsid, &creds, addr_array[i], NULL);
+	ret = PVFS_mgmt_noop_phase(fsid, &creds, addr_array[i], &phase, NULL);
 	if (ret == 0)
 	{
-	    printf("Ok\n");
+	    printf("Ok%s\n", startup_phase_string(phase));
 	}
 	else
 	{
@@ -375,6 +377,25 @@ static int noop_all_servers(PVFS_fs_id fsid)
     return(0);
 }
 
+/* startup_phase_string()
+ *
+ * describes a server that has not finished starting up
+ *
+ * returns an empty string for a server that has
+ */
+static const char *startup_phase_string(int32_t phase)
+{
+    switch (phase)
+    {
+    case PVFS_SERVER_STARTUP_LEDGER:
+        return " (starting: rebuilding handle ledger, read-only)";
+    case PVFS_SERVER_STARTUP_CLEANUP:
+        return " (starting: clearing stranded bstreams)";
+    default:
+        return "";
+    }
+}
+
 /* print_config()
  *
  * prints out config file information
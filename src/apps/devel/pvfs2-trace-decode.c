@@ -0,0 +1,698 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/** \file
+ * Decodes a binary trace ring dump written by a server (see
+ * TraceRingEntries) into per-request latency breakdowns.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+
+#include "pvfs2-types.h"
+#include "pvfs2-internal.h"
+#include "pint-trace.h"
+
+/* number of states reported per request with -v */
+#define TOP_STATES 4
+
+struct trace_string
+{
+    uint64_t str;
+    char *name;
+};
+
+struct trace_event
+{
+    struct PINT_trace_record rec;
+    uint64_t thread_id;
+};
+
+/* time spent in one state of one request */
+struct state_time
+{
+    uint64_t str;
+    uint64_t ns;
+};
+
+/* one request: a top level state machine and the children it started */
+struct request
+{
+    uint64_t key;
+    int32_t op;
+    uint64_t handle;
+    uint64_t start;
+    uint64_t end;
+    int done;
+    uint64_t last_state;    /* state the top level machine ended in */
+    uint64_t sm_ns;
+    uint64_t job_ns[3];     /* bmi, trove, flow */
+    struct state_time *states;
+    int state_count;
+};
+
+/* state of a single smcb (top level or child) while scanning */
+struct smcb_slot
+{
+    uint64_t key;
+    struct request *req;
+    uint64_t enter_ts;
+    uint64_t enter_str;
+};
+
+/* outstanding job, matched from post to completion by job id */
+struct job_slot
+{
+    uint64_t job_id;
+    uint64_t post_ts;
+    int kind;
+};
+
+/* per op summary */
+struct op_summary
+{
+    int32_t op;
+    const char *name;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t sm_ns;
+    uint64_t job_ns[3];
+};
+
+typedef struct
+{
+    int verbose;
+    char *file;
+} options_t;
+
+static options_t opts;
+
+static struct trace_string *strings = NULL;
+static uint32_t string_count = 0;
+
+/* open addressed tables keyed by smcb address and job id */
+static struct smcb_slot *smcbs = NULL;
+static struct job_slot *jobs = NULL;
+static uint64_t table_size = 0;
+
+static struct request **requests = NULL;
+static uint64_t request_count = 0;
+static uint64_t request_alloc = 0;
+
+static const char *job_kind_name[3] = {"bmi", "trove", "flow"};
+
+static void usage(char *progname)
+{
+    fprintf(stderr, "Usage: %s [-v] <trace dump file>\n", progname);
+    fprintf(stderr, "  -v  print a line for every request with its "
+                    "slowest states\n");
+}
+
+static int process_args(int argc, char **argv)
+{
+    int c;
+
+    memset(&opts, 0, sizeof(opts));
+    while ((c = getopt(argc, argv, "vh")) != -1)
+    {
+        switch (c)
+        {
+            case 'v':
+                opts.verbose = 1;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    opts.file = argv[optind];
+    return 0;
+}
+
+static const char *string_lookup(uint64_t str)
+{
+    uint32_t i;
+
+    for (i = 0; i < string_count; i++)
+    {
+        if (strings[i].str == str)
+        {
+            return strings[i].name;
+        }
+    }
+    return "?";
+}
+
+static int event_compare(const void *a, const void *b)
+{
+    const struct trace_event *ea = a;
+    const struct trace_event *eb = b;
+
+    if (ea->rec.timestamp < eb->rec.timestamp)
+        return -1;
+    if (ea->rec.timestamp > eb->rec.timestamp)
+        return 1;
+    return 0;
+}
+
+static struct smcb_slot *smcb_find(uint64_t key, int create)
+{
+    uint64_t i, slot = (key >> 4) % table_size;
+
+    for (i = 0; i < table_size; i++)
+    {
+        if (smcbs[slot].key == key)
+        {
+            return &smcbs[slot];
+        }
+        if (smcbs[slot].key == 0)
+        {
+            if (!create)
+            {
+                return NULL;
+            }
+            smcbs[slot].key = key;
+            return &smcbs[slot];
+        }
+        slot = (slot + 1) % table_size;
+    }
+    return NULL;
+}
+
+static struct job_slot *job_find(uint64_t job_id, int create)
+{
+    uint64_t i, slot = job_id % table_size;
+
+    for (i = 0; i < table_size; i++)
+    {
+        if (jobs[slot].job_id == job_id)
+        {
+            return &jobs[slot];
+        }
+        if (jobs[slot].job_id == 0)
+        {
+            if (!create)
+            {
+                return NULL;
+            }
+            jobs[slot].job_id = job_id;
+            return &jobs[slot];
+        }
+        slot = (slot + 1) % table_size;
+    }
+    return NULL;
+}
+
+static struct request *request_new(uint64_t key, int32_t op, uint64_t ts)
+{
+    struct request *req;
+
+    if (request_count == request_alloc)
+    {
+        request_alloc = request_alloc ? request_alloc * 2 : 1024;
+        requests = realloc(requests, request_alloc * sizeof(*requests));
+        if (!requests)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    req = calloc(1, sizeof(*req));
+    if (!req)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    req->key = key;
+    req->op = op;
+    req->start = ts;
+    req->handle = PVFS_HANDLE_NULL;
+    requests[request_count++] = req;
+    return req;
+}
+
+static void request_reset(struct request *req, uint64_t ts)
+{
+    req->start = ts;
+    req->last_state = 0;
+    req->sm_ns = 0;
+    memset(req->job_ns, 0, sizeof(req->job_ns));
+    free(req->states);
+    req->states = NULL;
+    req->state_count = 0;
+}
+
+static void request_add_state(struct request *req, uint64_t str, uint64_t ns)
+{
+    int i;
+
+    for (i = 0; i < req->state_count; i++)
+    {
+        if (req->states[i].str == str)
+        {
+            req->states[i].ns += ns;
+            return;
+        }
+    }
+    req->states = realloc(req->states,
+                          (req->state_count + 1) * sizeof(*req->states));
+    if (!req->states)
+    {
+        perror("realloc");
+        exit(1);
+    }
+    req->states[req->state_count].str = str;
+    req->states[req->state_count].ns = ns;
+    req->state_count++;
+}
+
+static int state_compare(const void *a, const void *b)
+{
+    const struct state_time *sa = a;
+    const struct state_time *sb = b;
+
+    if (sa->ns > sb->ns)
+        return -1;
+    if (sa->ns < sb->ns)
+        return 1;
+    return 0;
+}
+
+/* job_kind()
+ *
+ * maps a job event type to an index in job_ns[]; sets *post if the event
+ * is a post rather than a completion
+ */
+static int job_kind(uint32_t type, int *post)
+{
+    *post = (type == PINT_TRACE_BMI_POST || type == PINT_TRACE_TROVE_POST ||
+             type == PINT_TRACE_FLOW_POST);
+    switch (type)
+    {
+        case PINT_TRACE_BMI_POST:
+        case PINT_TRACE_BMI_COMPLETE:
+            return 0;
+        case PINT_TRACE_TROVE_POST:
+        case PINT_TRACE_TROVE_COMPLETE:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+static void process_event(struct trace_event *ev)
+{
+    struct PINT_trace_record *rec = &ev->rec;
+    struct smcb_slot *sm, *parent;
+    struct job_slot *job;
+    int kind, post;
+
+    switch (rec->type)
+    {
+        case PINT_TRACE_SM_START:
+            sm = smcb_find(rec->key, 1);
+            if (!sm)
+            {
+                return;
+            }
+            parent = rec->aux ? smcb_find(rec->aux, 0) : NULL;
+            if (sm->req && sm->req->key == rec->key)
+            {
+                /* a server request restarts its unexpected receive
+                 * machine once the request is decoded; time spent
+                 * waiting for the message is not part of the request
+                 */
+                request_reset(sm->req, rec->timestamp);
+            }
+            else if (parent && parent->req)
+            {
+                /* child machine: charge its time to the parent request */
+                sm->req = parent->req;
+            }
+            else
+            {
+                sm->req = request_new(rec->key, rec->op, rec->timestamp);
+            }
+            sm->enter_ts = 0;
+            break;
+        case PINT_TRACE_SM_ENTER:
+            sm = smcb_find(rec->key, 0);
+            if (!sm || !sm->req)
+            {
+                /* started before the oldest record in the dump */
+                return;
+            }
+            sm->enter_ts = rec->timestamp;
+            sm->enter_str = rec->str;
+            if (rec->aux != PVFS_HANDLE_NULL && sm->req->key == rec->key)
+            {
+                sm->req->handle = rec->aux;
+            }
+            /* the op of a server request is only known once decoded */
+            if (sm->req->key == rec->key)
+            {
+                sm->req->op = rec->op;
+            }
+            break;
+        case PINT_TRACE_SM_EXIT:
+            sm = smcb_find(rec->key, 0);
+            if (!sm || !sm->req || !sm->enter_ts)
+            {
+                return;
+            }
+            sm->req->sm_ns += rec->timestamp - sm->enter_ts;
+            request_add_state(sm->req, sm->enter_str,
+                              rec->timestamp - sm->enter_ts);
+            sm->enter_ts = 0;
+            break;
+        case PINT_TRACE_SM_TERMINATE:
+            sm = smcb_find(rec->key, 0);
+            if (!sm || !sm->req)
+            {
+                return;
+            }
+            if (sm->req->key == rec->key)
+            {
+                sm->req->end = rec->timestamp;
+                sm->req->last_state = rec->str;
+                sm->req->done = 1;
+            }
+            /* the smcb address may be reused by a later request */
+            sm->req = NULL;
+            break;
+        default:
+            kind = job_kind(rec->type, &post);
+            if (post)
+            {
+                job = job_find(rec->aux, 1);
+                if (job)
+                {
+                    job->post_ts = rec->timestamp;
+                    job->kind = kind;
+                }
+                return;
+            }
+            job = job_find(rec->aux, 0);
+            if (!job || !job->post_ts)
+            {
+                return;
+            }
+            sm = smcb_find(rec->key, 0);
+            if (sm && sm->req)
+            {
+                sm->req->job_ns[kind] += rec->timestamp - job->post_ts;
+            }
+            job->post_ts = 0;
+            break;
+    }
+}
+
+static int read_dump(FILE *fp, struct trace_event **events_out,
+                     uint64_t *count_out)
+{
+    struct PINT_trace_file_header fh;
+    struct PINT_trace_ring_header rh;
+    struct PINT_trace_string_header sh;
+    struct trace_event *events = NULL;
+    uint64_t count = 0;
+    uint32_t r, i;
+
+    if (fread(&fh, sizeof(fh), 1, fp) != 1)
+    {
+        fprintf(stderr, "Error: short read on file header\n");
+        return -1;
+    }
+    if (fh.magic != PINT_TRACE_MAGIC || fh.version != PINT_TRACE_VERSION ||
+        fh.record_size != sizeof(struct PINT_trace_record))
+    {
+        fprintf(stderr, "Error: not a version %d trace dump\n",
+                PINT_TRACE_VERSION);
+        return -1;
+    }
+
+    for (r = 0; r < fh.ring_count; r++)
+    {
+        if (fread(&rh, sizeof(rh), 1, fp) != 1)
+        {
+            fprintf(stderr, "Error: short read on ring header %u\n", r);
+            return -1;
+        }
+        events = realloc(events, (count + rh.count) * sizeof(*events));
+        if (!events && rh.count)
+        {
+            perror("realloc");
+            return -1;
+        }
+        for (i = 0; i < rh.count; i++)
+        {
+            struct trace_event *ev = &events[count];
+
+            if (fread(&ev->rec, sizeof(ev->rec), 1, fp) != 1)
+            {
+                fprintf(stderr, "Error: short read on ring %u\n", r);
+                return -1;
+            }
+            /* skip records that were being overwritten during the dump */
+            if (ev->rec.seq != rh.dropped + i ||
+                ev->rec.type < PINT_TRACE_SM_START ||
+                ev->rec.type >= PINT_TRACE_TYPE_MAX)
+            {
+                continue;
+            }
+            ev->thread_id = rh.thread_id;
+            count++;
+        }
+    }
+
+    strings = calloc(fh.string_count + 1, sizeof(*strings));
+    if (!strings)
+    {
+        perror("calloc");
+        return -1;
+    }
+    for (i = 0; i < fh.string_count; i++)
+    {
+        if (fread(&sh, sizeof(sh), 1, fp) != 1)
+        {
+            fprintf(stderr, "Error: short read on string table\n");
+            return -1;
+        }
+        strings[i].str = sh.str;
+        strings[i].name = calloc(1, sh.len + 1);
+        if (!strings[i].name ||
+            (sh.len && fread(strings[i].name, sh.len, 1, fp) != 1))
+        {
+            fprintf(stderr, "Error: short read on string table\n");
+            return -1;
+        }
+        string_count++;
+    }
+
+    *events_out = events;
+    *count_out = count;
+    return 0;
+}
+
+/* machine_name()
+ *
+ * returns the state machine part of a "machine:state" string, in a
+ * static buffer
+ */
+static const char *machine_name(uint64_t str)
+{
+    static char buf[256];
+    const char *name = string_lookup(str);
+    char *colon;
+
+    strncpy(buf, name, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    colon = strchr(buf, ':');
+    if (colon)
+    {
+        *colon = '\0';
+    }
+    return buf;
+}
+
+static void print_request(struct request *req)
+{
+    int i;
+
+    printf("%-16llx %4d %-24s %20llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           llu(req->key), req->op, machine_name(req->last_state),
+           llu(req->handle),
+           (req->end - req->start) / 1000.0, req->sm_ns / 1000.0,
+           req->job_ns[0] / 1000.0, req->job_ns[1] / 1000.0,
+           req->job_ns[2] / 1000.0);
+
+    qsort(req->states, req->state_count, sizeof(*req->states),
+          state_compare);
+    for (i = 0; i < req->state_count && i < TOP_STATES; i++)
+    {
+        printf("    %10.1f  %s\n", req->states[i].ns / 1000.0,
+               string_lookup(req->states[i].str));
+    }
+}
+
+static void print_summary(void)
+{
+    struct op_summary *ops = NULL;
+    int op_count = 0;
+    uint64_t r;
+    int i, k;
+
+    for (r = 0; r < request_count; r++)
+    {
+        struct request *req = requests[r];
+        uint64_t total;
+
+        if (!req->done)
+        {
+            continue;
+        }
+        for (i = 0; i < op_count; i++)
+        {
+            if (ops[i].op == req->op)
+            {
+                break;
+            }
+        }
+        if (i == op_count)
+        {
+            ops = realloc(ops, (op_count + 1) * sizeof(*ops));
+            if (!ops)
+            {
+                perror("realloc");
+                exit(1);
+            }
+            memset(&ops[i], 0, sizeof(*ops));
+            ops[i].op = req->op;
+            ops[i].name = strdup(machine_name(req->last_state));
+            op_count++;
+        }
+        total = req->end - req->start;
+        ops[i].count++;
+        ops[i].total_ns += total;
+        if (total > ops[i].max_ns)
+        {
+            ops[i].max_ns = total;
+        }
+        ops[i].sm_ns += req->sm_ns;
+        for (k = 0; k < 3; k++)
+        {
+            ops[i].job_ns[k] += req->job_ns[k];
+        }
+    }
+
+    printf("%4s %-24s %8s %10s %10s %10s %10s %10s %10s\n",
+           "op", "machine", "count", "avg(us)", "max(us)", "sm(us)",
+           "bmi(us)", "trove(us)", "flow(us)");
+    for (i = 0; i < op_count; i++)
+    {
+        double n = (double)ops[i].count;
+
+        printf("%4d %-24s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               ops[i].op, ops[i].name, llu(ops[i].count),
+               ops[i].total_ns / n / 1000.0, ops[i].max_ns / 1000.0,
+               ops[i].sm_ns / n / 1000.0,
+               ops[i].job_ns[0] / n / 1000.0,
+               ops[i].job_ns[1] / n / 1000.0,
+               ops[i].job_ns[2] / n / 1000.0);
+        free((char *)ops[i].name);
+    }
+    free(ops);
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_event *events = NULL;
+    uint64_t count = 0, i, incomplete = 0;
+    FILE *fp;
+
+    if (process_args(argc, argv) != 0)
+    {
+        return 1;
+    }
+
+    fp = fopen(opts.file, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: unable to open %s: %s\n",
+                opts.file, strerror(errno));
+        return 1;
+    }
+    if (read_dump(fp, &events, &count) != 0)
+    {
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    /* events from all threads, in time order */
+    qsort(events, count, sizeof(*events), event_compare);
+
+    table_size = count * 2 + 1;
+    smcbs = calloc(table_size, sizeof(*smcbs));
+    jobs = calloc(table_size, sizeof(*jobs));
+    if (!smcbs || !jobs)
+    {
+        perror("calloc");
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        process_event(&events[i]);
+    }
+
+    if (opts.verbose)
+    {
+        printf("%-16s %4s %-24s %20s %10s %10s %10s %10s %10s\n",
+               "smcb", "op", "machine", "handle", "total(us)", "sm(us)",
+               job_kind_name[0], job_kind_name[1], job_kind_name[2]);
+    }
+    for (i = 0; i < request_count; i++)
+    {
+        if (!requests[i]->done)
+        {
+            incomplete++;
+            continue;
+        }
+        if (opts.verbose)
+        {
+            print_request(requests[i]);
+        }
+    }
+    if (opts.verbose)
+    {
+        printf("\n");
+    }
+
+    printf("%llu events, %llu requests (%llu incomplete or truncated)\n\n",
+           llu(count), llu(request_count), llu(incomplete));
+    print_summary();
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include "orange.h"
+#include "recursive-remove.h"
 
 /* optional parameters, filled in by parse_args() */
 struct rm_options
@@ -22,6 +23,7 @@ struct rm_options
     int recursive;
     int verbose;
     int debug;
+    int parallel;
     int num_files;
     char **filenames;
 };
@@ -35,7 +37,7 @@ int main(int argc, char **argv)
     FTS *fs;
     FTSENT *node;
     unsigned char error_seen = 0;
-    struct rm_options user_opts = {0, 0, 0, 0, 0, 0, NULL};
+    struct rm_options user_opts = {0, 0, 0, 0, 0, 0, 0, NULL};
     
     /* look at command line arguments */
     ret = parse_args(argc, argv, &user_opts);
@@ -49,7 +51,11 @@ int main(int argc, char **argv)
         return(-1);
     }
 
-    fs = fts_open(user_opts.filenames, FTS_COMFOLLOW | FTS_PHYSICAL , NULL);
+    /* nothing here needs the stat of a file, and the directory listings
+     * say which entries are directories
+     */
+    fs = fts_open(user_opts.filenames,
+                  FTS_COMFOLLOW | FTS_PHYSICAL | FTS_NOSTAT, NULL);
     if(fs == NULL)
     {
         perror("fts_open");
@@ -87,9 +93,29 @@ int main(int argc, char **argv)
                         "pvfs2-rm: cannot remove '%s': Is a directory\n",
                         node->fts_path);
             }
+            else if (user_opts.parallel > 1 && !user_opts.interactive &&
+                     !user_opts.verbose &&
+                     node->fts_level == FTS_ROOTLEVEL)
+            {
+                /* remove the whole tree with many requests in flight
+                 * rather than one entry at a time
+                 */
+                ret = recursive_delete_dir_parallel(node->fts_accpath,
+                                                    user_opts.parallel);
+                if (ret < 0 && !(errno == ENOENT && user_opts.force))
+                {
+                    error_seen = 1;
+                    fprintf(stderr,
+                            "recursive remove failed on path: %s\n",
+                            node->fts_accpath);
+                }
+                /* fts hands the node back once more as FTS_DP */
+                node->fts_number = 1;
+                fts_set(fs, node, FTS_SKIP);
+            }
             break;
         case FTS_DP : /* postorder dir */
-            if (user_opts.recursive)
+            if (user_opts.recursive && !node->fts_number)
             {
                 if (user_opts.interactive)
                 {
@@ -126,6 +152,7 @@ int main(int argc, char **argv)
         case FTS_F : /* reg file */
         case FTS_SL : /* sym link */
         case FTS_SLNONE : /* sym link - no target */
+        case FTS_NSOK : /* not a directory, not stat'ed */
             if (user_opts.interactive)
             {
                 char response = 0, c;
@@ -167,7 +194,6 @@ int main(int argc, char **argv)
         case FTS_DC :   /* cycle dir */
         case FTS_DOT :  /* dot dir */
         case FTS_NS :   /* no stat err */
-        case FTS_NSOK : /* no stat ok */
         case FTS_ERR :  /* error */
         default:
             fprintf(stderr, "%s: %s is not a removable file, directory, or symbolic link\n", argv[0], node->fts_path);
@@ -206,7 +232,7 @@ main_out:
 static int parse_args(int argc, char **argv, struct rm_options *user_opts_p)
 {
     int one_opt = 0;
-    char flags[] = "vVdirfh";
+    char flags[] = "vVdirfP:h";
     int index = 1; /* stand in for optind */
 
     static struct option lopt[] = {
@@ -217,6 +243,7 @@ static int parse_args(int argc, char **argv, struct rm_options *user_opts_p)
         {"Version", 0, NULL, 'V'},
         {"verbose", 0, NULL, 'v'},
         {"debug", 0, NULL, 'd'},
+        {"parallel", 1, NULL, 'P'},
         {NULL, 0, NULL, 0}
     };
 
@@ -249,6 +276,14 @@ static int parse_args(int argc, char **argv, struct rm_options *user_opts_p)
             case('r'):
                 user_opts_p->recursive = 1;
                 break;
+            case('P'):
+                user_opts_p->parallel = atoi(optarg);
+                if (optarg == argv[index])
+                {
+                    /* the value was an argument of its own */
+                    index++;
+                }
+                break;
             case('h'):
             default:
                 usage(argc, argv);
@@ -283,7 +318,8 @@ static int parse_args(int argc, char **argv, struct rm_options *user_opts_p)
 
 static void usage(int argc, char **argv)
 {
-    fprintf(stderr, "Usage: %s [-?vVidrf] pvfs2_filename[s]\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-?vVidrf] [-P N] pvfs2_filename[s]\n",
+            argv[0]);
     fprintf(stderr, "\t-h\thelp - print this message\n");
     fprintf(stderr, "\t-v\tverbose - print informative messages\n");
     fprintf(stderr, "\t-V\tVersion - print Version info\n");
@@ -291,6 +327,7 @@ static void usage(int argc, char **argv)
     fprintf(stderr, "\t-f\tforce - print nothing\n");
     fprintf(stderr, "\t-d\tdebug - print debugging info\n");
     fprintf(stderr, "\t-r\trecursive - remove directories and their contents\n");
+    fprintf(stderr, "\t-P N\tparallel - with -r, keep N operations in flight\n");
 }
 
 /*
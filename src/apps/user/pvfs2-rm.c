@@ -18,6 +18,7 @@ struct options
 {
     int force;
     int recursive;
+    int parallel;
     int num_files;
     char **filenames;
 };
@@ -30,7 +31,7 @@ int main(int argc, char **argv)
     int ret = EXIT_FAILURE;
     int i = 0;
     unsigned char error_seen = 0;
-    struct options user_opts = {0, 0, 0, 0};
+    struct options user_opts = {0, 0, RR_DEFAULT_PARALLELISM, 0, 0};
     
     /* look at command line arguments */
     ret = parse_args(argc, argv, &user_opts);
@@ -78,7 +79,8 @@ int main(int argc, char **argv)
              * since recursive wasn't specified). */
             if(user_opts.recursive)
             {
-                ret = recursive_delete_dir(working_path);
+                ret = recursive_delete_dir_parallel(working_path,
+                                                    user_opts.parallel);
                 if(ret < 0)
                 {
                     fprintf(stderr,
@@ -131,7 +133,7 @@ int main(int argc, char **argv)
 static int parse_args(int argc, char **argv, struct options *user_opts_p)
 {
     int one_opt = 0;
-    char flags[] = "rf?";
+    char flags[] = "rfP:?";
     opterr = 0;
 
     while((one_opt = getopt(argc, argv, flags)) != -1)
@@ -144,6 +146,9 @@ static int parse_args(int argc, char **argv, struct options *user_opts_p)
             case('r'):
                 user_opts_p->recursive = 1;
                 break;
+            case('P'):
+                user_opts_p->parallel = atoi(optarg);
+                break;
             case('?'):
                 usage(argc, argv);
                 exit(EXIT_FAILURE);
@@ -173,7 +178,9 @@ static int parse_args(int argc, char **argv, struct options *user_opts_p)
 
 static void usage(int argc, char **argv)
 {
-    fprintf(stderr, "Usage: %s [-rf] pvfs2_filename[s]\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-rf] [-P N] pvfs2_filename[s]\n", argv[0]);
+    fprintf(stderr, "\t-P N\twith -r, keep N operations in flight "
+            "(default %d, 1 for one at a time)\n", RR_DEFAULT_PARALLELISM);
 }
 
 /*
@@ -6,6 +6,7 @@
 package org.apache.hadoop.fs.ofs;
 
 import java.io.Closeable;
+import java.io.EOFException;
 import java.io.IOException;
 
 import org.apache.commons.logging.Log;
@@ -91,14 +92,18 @@ public class OrangeFileSystemFSInputStream extends OrangeFileSystemInputStream
         return ret;
     }
 
-    /* This method has an implementation in abstract class FSInputStream */
+    /*
+     * Positional reads go straight to pread, so they neither move the stream
+     * position nor wait for each other.
+     */
     @Override
     public int read(long position, byte[] buffer, int offset, int length)
             throws IOException {
-        long oldPos = getPos();
-        seek(position);
-        int ret = read(buffer, offset, length);
-        seek(oldPos);
+        statistics.incrementReadOps(1);
+        int ret = super.read(position, buffer, offset, length);
+        if (ret > 0) {
+            statistics.incrementBytesRead(ret);
+        }
         return ret;
     }
 
@@ -106,26 +111,22 @@ public class OrangeFileSystemFSInputStream extends OrangeFileSystemInputStream
     @Override
     public void readFully(long position, byte[] buffer)
             throws IOException {
-        long oldPos = getPos();
-        seek(position);
-        int ret = read(buffer);
-        if (ret < buffer.length) {
-            throw new IOException("readFully read < buffer.length bytes.");
-        }
-        seek(oldPos);
+        readFully(position, buffer, 0, buffer.length);
     }
 
     /* This method has an implementation in abstract class FSInputStream */
     @Override
     public void readFully(long position, byte[] buffer, int offset, int length)
             throws IOException {
-        long oldPos = getPos();
-        seek(position);
-        int ret = read(buffer, offset, length);
-        if (ret < length) {
-            throw new IOException("readFully read < buffer.length bytes.");
+        int done = 0;
+        while (done < length) {
+            int ret = read(position + done, buffer, offset + done,
+                    length - done);
+            if (ret < 0) {
+                throw new EOFException("readFully read < length bytes.");
+            }
+            done += ret;
         }
-        seek(oldPos);
     }
 
     /* *** This method declared abstract in FSInputStream *** */
@@ -30,6 +30,7 @@
 
 /* Forward Declarations */
 static int fill_stat(JNIEnv *env, struct stat *ptr, jobject *inst);
+static void *direct_buffer(JNIEnv *env, jobject buf, jlong count);
 //static int fill_statfs(JNIEnv *env, struct statfs *ptr, jobject *inst);
 
 /* Convert allocated struct to an instance of our Stat Class */
@@ -83,6 +84,27 @@ static int fill_stat(JNIEnv *env, struct stat *ptr, jobject *inst)
     return 0;
 }
 
+/*
+ * Returns the address of a direct ByteBuffer if it can hold count bytes, so
+ * that I/O goes straight to or from Java memory; NULL otherwise.
+ */
+static void *direct_buffer(JNIEnv *env, jobject buf, jlong count)
+{
+    void *buf_addr = (*env)->GetDirectBufferAddress(env, buf);
+    if (!buf_addr)
+    {
+        JNI_ERROR("buf_addr returned by GetDirectBufferAddress is NULL\n");
+        return NULL;
+    }
+    if (count < 0 || (*env)->GetDirectBufferCapacity(env, buf) < count)
+    {
+        JNI_ERROR("count = %lld doesn't fit in the buffer\n",
+                (long long) count);
+        return NULL;
+    }
+    return buf_addr;
+}
+
 /* Convert allocated structure to an instance of our Statfs Class */
 
 static int fill_statfs(JNIEnv *env, struct statfs *ptr, jobject *inst)
@@ -1232,22 +1254,123 @@ Java_org_orangefs_usrint_PVFS2POSIXJNI_openat(JNIEnv *env, jobject obj,
     return (jint) ret;
 }
 
-/* pread */
+/*
+ * pread into a direct ByteBuffer. The file position isn't used, so any
+ * number of threads may read one descriptor at once.
+ */
 JNIEXPORT jlong JNICALL
 Java_org_orangefs_usrint_PVFS2POSIXJNI_pread(JNIEnv *env, jobject obj, int fd,
-        jbyteArray buf, jlong count, jlong offset)
+        jobject buf, jlong count, jlong offset)
 {
-    /* TODO */
-    return -1;
+    JNI_PFI();
+    jlong ret = 0;
+    void * buf_addr = 0;
+    JNI_PRINT("\tfd = %d\n\tcount = %lu\n\toffset = %ld\n", fd,
+            (uint64_t) count, (long) offset);
+    buf_addr = direct_buffer(env, buf, count);
+    if (!buf_addr)
+    {
+        return -1;
+    }
+    ret = (jlong) pread(fd, buf_addr, (size_t) count, (off_t) offset);
+    if (ret < 0)
+    {
+        JNI_PERROR();
+        ret = -1;
+    }
+    return ret;
 }
 
-/* pwrite */
+/*
+ * preadv: reads each (offset, count) range into the direct ByteBuffer of
+ * the same index, with one call from Java for the whole list. On return
+ * counts holds the bytes read into each buffer; a range at or past EOF
+ * gets 0. Returns the total read, -1 on error.
+ */
+JNIEXPORT jlong JNICALL
+Java_org_orangefs_usrint_PVFS2POSIXJNI_preadv(JNIEnv *env, jobject obj, int fd,
+        jobjectArray bufs, jlongArray offsets, jlongArray counts)
+{
+    JNI_PFI();
+    jlong ret = 0;
+    jsize n = (*env)->GetArrayLength(env, bufs);
+    jsize i = 0;
+    jlong *coffsets = NULL;
+    jlong *ccounts = NULL;
+    ssize_t done = 0;
+    jobject buf = NULL;
+    void * buf_addr = 0;
+    if ((*env)->GetArrayLength(env, offsets) < n ||
+            (*env)->GetArrayLength(env, counts) < n)
+    {
+        JNI_ERROR("offsets and counts need an entry for each buffer\n");
+        return -1;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    coffsets = malloc(2 * n * sizeof(jlong));
+    if (!coffsets)
+    {
+        JNI_ERROR("malloc failed\n");
+        return -1;
+    }
+    ccounts = coffsets + n;
+    (*env)->GetLongArrayRegion(env, offsets, 0, n, coffsets);
+    (*env)->GetLongArrayRegion(env, counts, 0, n, ccounts);
+    for (i = 0; i < n; i++)
+    {
+        JNI_PRINT("\tfd = %d\n\tcount[%d] = %lu\n\toffset[%d] = %ld\n",
+                fd, i, (uint64_t) ccounts[i], i, (long) coffsets[i]);
+        buf = (*env)->GetObjectArrayElement(env, bufs, i);
+        buf_addr = buf ? direct_buffer(env, buf, ccounts[i]) : NULL;
+        if (!buf_addr)
+        {
+            ret = -1;
+            break;
+        }
+        done = pread(fd, buf_addr, (size_t) ccounts[i], (off_t) coffsets[i]);
+        (*env)->DeleteLocalRef(env, buf);
+        if (done < 0)
+        {
+            JNI_PERROR();
+            ret = -1;
+            break;
+        }
+        ccounts[i] = done;
+        ret += done;
+    }
+    if (ret >= 0)
+    {
+        (*env)->SetLongArrayRegion(env, counts, 0, n, ccounts);
+    }
+    free(coffsets);
+    return ret;
+}
+
+/* pwrite from a direct ByteBuffer */
 JNIEXPORT jlong JNICALL
 Java_org_orangefs_usrint_PVFS2POSIXJNI_pwrite(JNIEnv *env, jobject obj, int fd,
-        jbyteArray buf, jlong count, jlong offset)
+        jobject buf, jlong count, jlong offset)
 {
-    /* TODO */
-    return -1;
+    JNI_PFI();
+    jlong ret = 0;
+    void * buf_addr = 0;
+    JNI_PRINT("\tfd = %d\n\tcount = %lu\n\toffset = %ld\n", fd,
+            (uint64_t) count, (long) offset);
+    buf_addr = direct_buffer(env, buf, count);
+    if (!buf_addr)
+    {
+        return -1;
+    }
+    ret = (jlong) pwrite(fd, buf_addr, (size_t) count, (off_t) offset);
+    if (ret < 0)
+    {
+        JNI_PERROR();
+        ret = -1;
+    }
+    return ret;
 }
 
 /*
@@ -18,9 +18,17 @@ public class OrangeFileSystemInputChannel implements ReadableByteChannel {
     private Orange orange;
     private PVFS2POSIXJNIFlags pf;
     /* Channel Related Fields */
-    private int fd;
+    private volatile int fd;
     private int bufferSize;
     private ByteBuffer channelBuffer;
+    /* Direct buffer each thread stages positional reads into heap arrays */
+    private final ThreadLocal<ByteBuffer> stagingBuffer =
+            new ThreadLocal<ByteBuffer>() {
+                @Override
+                protected ByteBuffer initialValue() {
+                    return ByteBuffer.allocateDirect(bufferSize);
+                }
+            };
     /* OFSLOG for logging */
     public static final Log OFSLOG = LogFactory
             .getLog(OrangeFileSystemInputChannel.class);
@@ -173,6 +181,85 @@ public class OrangeFileSystemInputChannel implements ReadableByteChannel {
         }
     }
 
+    /*
+     * Positional read into dst from the given file position. The channel's
+     * file pointer and buffer are left alone, so this takes no lock and any
+     * number of threads may use it at once. A direct dst is filled in place;
+     * a heap dst goes through a per-thread direct buffer. Returns the number
+     * of bytes read, or -1 at EOF.
+     */
+    public int read(long position, ByteBuffer dst)
+            throws IOException {
+        int fd = this.fd;
+        if (fd < 0) {
+            throw new IOException("file descriptor isn't open.");
+        }
+        if (!dst.hasRemaining()) {
+            return 0;
+        }
+        long bytesRead = 0;
+        if (dst.isDirect()) {
+            bytesRead = orange.posix.pread(fd, dst.slice(), dst.remaining(),
+                    position);
+            if (bytesRead < 0) {
+                throw new IOException("orange.posix.pread failed.");
+            }
+            dst.position(dst.position() + (int) bytesRead);
+        } else {
+            ByteBuffer staging = stagingBuffer.get();
+            while (dst.hasRemaining()) {
+                int len = Math.min(dst.remaining(), staging.capacity());
+                staging.clear();
+                long ret = orange.posix.pread(fd, staging, len,
+                        position + bytesRead);
+                if (ret < 0) {
+                    throw new IOException("orange.posix.pread failed.");
+                }
+                staging.limit((int) ret);
+                dst.put(staging);
+                bytesRead += ret;
+                if (ret < len) {
+                    break;
+                }
+            }
+        }
+        return bytesRead > 0 ? (int) bytesRead : -1;
+    }
+
+    /*
+     * Vectored positional read: fills each dsts[i], which must be direct,
+     * from positions[i] with a single call into the native library, e.g. to
+     * prefetch the ranges of several splits. Each buffer's position advances
+     * by the bytes it got. Returns the total number of bytes read.
+     */
+    public long read(long[] positions, ByteBuffer[] dsts)
+            throws IOException {
+        int fd = this.fd;
+        if (fd < 0) {
+            throw new IOException("file descriptor isn't open.");
+        }
+        if (positions.length != dsts.length) {
+            throw new IOException("need one position per buffer.");
+        }
+        ByteBuffer[] slices = new ByteBuffer[dsts.length];
+        long[] counts = new long[dsts.length];
+        for (int i = 0; i < dsts.length; i++) {
+            if (!dsts[i].isDirect()) {
+                throw new IOException("vectored reads need direct buffers.");
+            }
+            slices[i] = dsts[i].slice();
+            counts[i] = dsts[i].remaining();
+        }
+        long ret = orange.posix.preadv(fd, slices, positions, counts);
+        if (ret < 0) {
+            throw new IOException("orange.posix.preadv failed.");
+        }
+        for (int i = 0; i < dsts.length; i++) {
+            dsts[i].position(dsts[i].position() + (int) counts[i]);
+        }
+        return ret;
+    }
+
     /*
      * When this method is called, the position should equal 0, and the limit
      * should equal the capacity, via clear().
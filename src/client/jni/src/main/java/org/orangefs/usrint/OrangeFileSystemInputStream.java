@@ -21,7 +21,7 @@ public class OrangeFileSystemInputStream extends InputStream implements
     private static final Log OFSLOG = LogFactory
             .getLog(OrangeFileSystemInputStream.class);
     /* File Related Fields */
-    private OrangeFileSystemInputChannel inChannel;
+    private volatile OrangeFileSystemInputChannel inChannel;
     private String path;
     private long fileSize;
 
@@ -114,6 +114,35 @@ public class OrangeFileSystemInputStream extends InputStream implements
         return ret;
     }
 
+    /*
+     * Positional reads; these leave the stream position alone and aren't
+     * synchronized, so concurrent readers of one stream don't serialize.
+     */
+    public int read(long position, byte[] b, int off, int len)
+            throws IOException {
+        return read(position, ByteBuffer.wrap(b, off, len));
+    }
+
+    /* Reads into a direct buffer without an intermediate copy */
+    public int read(long position, ByteBuffer buf)
+            throws IOException {
+        OrangeFileSystemInputChannel channel = inChannel;
+        if (channel == null) {
+            throw new IOException("InputChannel is null.");
+        }
+        return channel.read(position, buf);
+    }
+
+    /* Reads each of several ranges into its own direct buffer */
+    public long read(long[] positions, ByteBuffer[] bufs)
+            throws IOException {
+        OrangeFileSystemInputChannel channel = inChannel;
+        if (channel == null) {
+            throw new IOException("InputChannel is null.");
+        }
+        return channel.read(positions, bufs);
+    }
+
     @Override
     public void reset()
             throws IOException {
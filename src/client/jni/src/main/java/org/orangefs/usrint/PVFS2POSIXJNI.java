@@ -148,9 +148,18 @@ public class PVFS2POSIXJNI {
 
     public native int openat(int dirfd, String path, long flags, long mode);
 
-    public native long pread(int fd, byte[] buf, long count, long offset);
-
-    public native long pwrite(int fd, byte[] buf, long count, long offset);
+    /* buf must be a direct ByteBuffer; bytes go to its start */
+    public native long pread(int fd, ByteBuffer buf, long count, long offset);
+
+    /*
+     * Reads counts[i] bytes at offsets[i] into the direct ByteBuffer bufs[i]
+     * for each i, leaving the number actually read in counts[i].
+     */
+    public native long preadv(int fd, ByteBuffer[] bufs, long[] offsets,
+            long[] counts);
+
+    /* buf must be a direct ByteBuffer; bytes come from its start */
+    public native long pwrite(int fd, ByteBuffer buf, long count, long offset);
 
     public native long read(int fd, ByteBuffer buf, long count);
 
@@ -14,6 +14,8 @@
 #include "pvfs2-attr.h"
 #include "acache.h"
 #include "tcache.h"
+#include "pcache.h"
+#include "client-lease.h"
 #include "pint-util.h"
 #include "pvfs2-debug.h"
 #include "gossip.h"
@@ -254,6 +256,7 @@ int PINT_acache_get_cached_entry(
     struct PINT_tcache_entry* tmp_entry;
     struct acache_payload* tmp_payload;
     int ret = -1;
+    int miss = 0;
     struct timeval current_time = { 0, 0};
 
     if(!attr || !attr_status ||
@@ -276,6 +279,9 @@ int PINT_acache_get_cached_entry(
     *size_status = -PVFS_ETIME;
     attr->mask = 0;
 
+    /* drop anything a server has told us changed */
+    PINT_client_lease_poll();
+
     gen_mutex_lock(&acache_mutex);
 
     /* lookup */
@@ -293,6 +299,7 @@ int PINT_acache_get_cached_entry(
                      __func__,
                      llu(refn.handle));
         tmp_payload = NULL;
+        miss = 1;
         goto done;
     }
     else
@@ -385,6 +392,13 @@ int PINT_acache_get_cached_entry(
 
 done:
     gen_mutex_unlock(&acache_mutex);
+
+    /* another process on this node may have fetched them */
+    if(miss && PINT_pcache_get_attr(refn, attr, size, size_status) == 0)
+    {
+        *attr_status = 0;
+        ret = 0;
+    }
     return(ret);
 }
 
@@ -425,6 +439,8 @@ void PINT_acache_invalidate(
                     PINT_PERF_SET);
 
     gen_mutex_unlock(&acache_mutex);
+
+    PINT_pcache_invalidate_attr(refn);
     return;
 }
 
@@ -464,6 +480,8 @@ void PINT_acache_invalidate_size(
     }
 
     gen_mutex_unlock(&acache_mutex);
+
+    PINT_pcache_invalidate_size(refn);
     return;
 }
 
@@ -482,6 +500,7 @@ int PINT_acache_update(
 {
     struct acache_payload* tmp_payload = NULL;
     uint32_t save_mask;
+    unsigned int timeout_msecs;
     int ret = -1;
 
     gossip_debug(GOSSIP_ACACHE_DEBUG,
@@ -575,11 +594,59 @@ int PINT_acache_update(
     {
         load_payload(acache, refn, tmp_payload);
     }
+    PINT_tcache_get_info(acache, TCACHE_TIMEOUT_MSECS, &timeout_msecs);
 
     gen_mutex_unlock(&acache_mutex);
+
+    PINT_pcache_put_attr(refn, attr, size, timeout_msecs,
+                         ACACHE_DEFAULT_DYNAMIC_TIMEOUT_MSECS);
     return(0);
 }
 
+/**
+ * Keeps the cached attributes of an object for the length of a lease the
+ * server has granted on them, if that is longer than they would be kept
+ * anyway.  The size keeps its own timeout.  The lease is cut short by a
+ * tenth to allow for the time the reply took to arrive.
+ */
+void PINT_acache_set_lease(
+    PVFS_object_ref refn,   /**< object the lease is on */
+    uint32_t lease_msecs)   /**< length of the lease */
+{
+    struct PINT_tcache_entry* tmp_entry;
+    struct timeval expiration;
+    unsigned int enabled = 0;
+    int tmp_status;
+    int ret;
+
+    lease_msecs -= lease_msecs / 10;
+
+    gen_mutex_lock(&acache_mutex);
+
+    PINT_tcache_get_info(acache, TCACHE_ENABLE, &enabled);
+    ret = PINT_tcache_lookup(acache, &refn, &tmp_entry, &tmp_status);
+    if(enabled && ret == 0 && tmp_status == 0)
+    {
+        PINT_util_get_current_timeval(&expiration);
+        expiration.tv_sec += lease_msecs / 1000;
+        expiration.tv_usec += (lease_msecs % 1000) * 1000;
+        if(expiration.tv_usec >= 1000000)
+        {
+            expiration.tv_sec++;
+            expiration.tv_usec -= 1000000;
+        }
+        if(timercmp(&expiration, &tmp_entry->expiration_date, >))
+        {
+            gossip_debug(GOSSIP_ACACHE_DEBUG,
+                         "%s: H=%llu leased for %u msecs\n",
+                         __func__, llu(refn.handle), lease_msecs);
+            tmp_entry->expiration_date = expiration;
+        }
+    }
+
+    gen_mutex_unlock(&acache_mutex);
+}
+
 #if 0
 int PINT_acache_amend(
     PVFS_object_ref refn,   /**< object to update */
@@ -131,6 +131,10 @@ int PINT_acache_amend(
     PVFS_size* size);
 #endif
 
+void PINT_acache_set_lease(
+    PVFS_object_ref refn,
+    uint32_t lease_msecs);
+
 void PINT_acache_invalidate(
     PVFS_object_ref refn);
 
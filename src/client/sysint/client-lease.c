@@ -0,0 +1,269 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/** \file
+ *  \ingroup clientlease
+ * Implementation of the client side of attribute leases.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pvfs2-internal.h"
+#include "pvfs2-types.h"
+#include "gossip.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "quicklist.h"
+#include "bmi.h"
+#include "PINT-reqproto-encode.h"
+#include "pvfs2-req-proto.h"
+#include "acache.h"
+#include "client-lease.h"
+
+/* how many unexpected messages to take from BMI at once */
+#define LEASE_POLL_COUNT 16
+
+/* how many times PINT_client_lease_enable() looks for the answers still
+ * being sent before giving up on them */
+#define LEASE_ACK_DRAIN_TRIES 10
+
+/* an answer to a break that BMI has not finished sending */
+struct lease_ack
+{
+    struct qlist_head link;
+    bmi_op_id_t op_id;
+    struct PINT_encoded_msg encoded;
+};
+
+static int lease_enabled = 0;
+/* bumped for every break received */
+static unsigned int lease_generation = 0;
+static gen_mutex_t lease_mutex = GEN_MUTEX_INITIALIZER;
+/* answers are sent on a context of their own, reaped by the next poll */
+static bmi_context_id lease_context;
+static QLIST_HEAD(lease_ack_list);
+
+static void lease_ack_reap(int max_idle_time_ms);
+
+/**
+ * Turns asking for leases, and listening for their breaks, on or off.
+ */
+void PINT_client_lease_enable(int enable)
+{
+    struct lease_ack *ack;
+    int tries;
+
+    gen_mutex_lock(&lease_mutex);
+    if (enable && !lease_enabled)
+    {
+        if (BMI_open_context(&lease_context) < 0)
+        {
+            gossip_err("%s: cannot open a BMI context; no leases will be "
+                       "asked for\n", __func__);
+            gen_mutex_unlock(&lease_mutex);
+            return;
+        }
+    }
+    else if (!enable && lease_enabled)
+    {
+        qlist_for_each_entry(ack, &lease_ack_list, link)
+        {
+            BMI_cancel(ack->op_id, lease_context);
+        }
+        for (tries = 0; tries < LEASE_ACK_DRAIN_TRIES &&
+                 !qlist_empty(&lease_ack_list); tries++)
+        {
+            lease_ack_reap(10);
+        }
+        BMI_close_context(lease_context);
+    }
+    lease_enabled = enable;
+    gen_mutex_unlock(&lease_mutex);
+}
+
+/**
+ * \return nonzero if getattr requests should ask for a lease
+ */
+int PINT_client_lease_enabled(void)
+{
+    return lease_enabled;
+}
+
+/* lease_ack_reap()
+ *
+ * frees the answers BMI has finished sending; called with lease_mutex
+ * held
+ */
+static void lease_ack_reap(int max_idle_time_ms)
+{
+    bmi_op_id_t ids[LEASE_POLL_COUNT];
+    bmi_error_code_t errs[LEASE_POLL_COUNT];
+    bmi_size_t sizes[LEASE_POLL_COUNT];
+    void *user_ptrs[LEASE_POLL_COUNT];
+    struct lease_ack *ack;
+    int outcount = 0, i;
+
+    if (qlist_empty(&lease_ack_list) ||
+        BMI_testcontext(LEASE_POLL_COUNT, ids, &outcount, errs, sizes,
+                        user_ptrs, max_idle_time_ms, lease_context) < 0)
+    {
+        return;
+    }
+    for (i = 0; i < outcount; i++)
+    {
+        ack = user_ptrs[i];
+        qlist_del(&ack->link);
+        PINT_encode_release(&ack->encoded, PINT_ENCODE_RESP);
+        free(ack);
+    }
+}
+
+/* lease_ack_send()
+ *
+ * tells the server that sent a break that the attributes are gone from
+ * the acache; it holds the change back until then
+ */
+static void lease_ack_send(struct BMI_unexpected_info *info,
+                           enum PVFS_encoding_type enc_type)
+{
+    struct PVFS_server_resp resp;
+    struct lease_ack *ack;
+    int ret;
+
+    ack = malloc(sizeof(*ack));
+    if (!ack)
+    {
+        return;
+    }
+    memset(&resp, 0, sizeof(resp));
+    resp.op = PVFS_SERV_LEASE_BREAK;
+    resp.status = 0;
+    ret = PINT_encode(&resp, PINT_ENCODE_RESP, &ack->encoded, info->addr,
+                      enc_type);
+    if (ret < 0)
+    {
+        free(ack);
+        return;
+    }
+
+    gen_mutex_lock(&lease_mutex);
+    ret = lease_enabled ?
+        BMI_post_send_list(&ack->op_id, info->addr,
+                           (const void **)ack->encoded.buffer_list,
+                           ack->encoded.size_list, ack->encoded.list_count,
+                           ack->encoded.total_size,
+                           ack->encoded.buffer_type, info->tag, ack,
+                           lease_context, NULL) : -PVFS_EINVAL;
+    if (ret == 0)
+    {
+        qlist_add_tail(&ack->link, &lease_ack_list);
+        ack = NULL;
+    }
+    gen_mutex_unlock(&lease_mutex);
+
+    if (ack)
+    {
+        if (ret < 0)
+        {
+            gossip_debug(GOSSIP_CLIENT_DEBUG,
+                         "%s: cannot answer a lease break: %d\n",
+                         __func__, ret);
+        }
+        PINT_encode_release(&ack->encoded, PINT_ENCODE_RESP);
+        free(ack);
+    }
+}
+
+/**
+ * Takes any lease breaks BMI has received, drops the attributes they
+ * name from the acache, and answers them.
+ */
+void PINT_client_lease_poll(void)
+{
+    struct BMI_unexpected_info info[LEASE_POLL_COUNT];
+    struct PINT_decoded_msg decoded;
+    struct PVFS_server_req *req;
+    PVFS_object_ref ref;
+    int outcount, i, ret;
+
+    if (!lease_enabled)
+    {
+        return;
+    }
+
+    gen_mutex_lock(&lease_mutex);
+    if (lease_enabled)
+    {
+        lease_ack_reap(0);
+    }
+    gen_mutex_unlock(&lease_mutex);
+
+    do
+    {
+        outcount = 0;
+        ret = BMI_testunexpected(LEASE_POLL_COUNT, &outcount, info, 0);
+        if (ret < 0)
+        {
+            return;
+        }
+
+        for (i = 0; i < outcount; i++)
+        {
+            if (info[i].error_code == 0 &&
+                PINT_decode(info[i].buffer, PINT_DECODE_REQ, &decoded,
+                            info[i].addr, info[i].size) == 0)
+            {
+                req = decoded.buffer;
+                if (req->op == PVFS_SERV_LEASE_BREAK)
+                {
+                    ref.handle = req->u.lease_break.handle;
+                    ref.fs_id = req->u.lease_break.fs_id;
+                    gossip_debug(GOSSIP_ACACHE_DEBUG,
+                                 "%s: lease break: H=%llu\n",
+                                 __func__, llu(ref.handle));
+
+                    gen_mutex_lock(&lease_mutex);
+                    lease_generation++;
+                    gen_mutex_unlock(&lease_mutex);
+                    PINT_acache_invalidate(ref);
+                    lease_ack_send(&info[i], decoded.enc_type);
+                }
+                else
+                {
+                    gossip_debug(GOSSIP_CLIENT_DEBUG,
+                                 "%s: ignoring unexpected op %d\n",
+                                 __func__, req->op);
+                }
+                PINT_decode_release(&decoded, PINT_DECODE_REQ);
+            }
+            BMI_unexpected_free(info[i].addr, info[i].buffer);
+        }
+    } while (outcount == LEASE_POLL_COUNT);
+}
+
+/**
+ * \return a count that changes whenever a break is received, so that a
+ * lease granted while a break was on its way can be told apart
+ */
+unsigned int PINT_client_lease_generation(void)
+{
+    unsigned int gen;
+
+    gen_mutex_lock(&lease_mutex);
+    gen = lease_generation;
+    gen_mutex_unlock(&lease_mutex);
+    return gen;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
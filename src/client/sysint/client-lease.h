@@ -0,0 +1,50 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#ifndef __CLIENT_LEASE_H
+#define __CLIENT_LEASE_H
+
+/** \defgroup clientlease Client side of attribute leases
+ *
+ * A server may grant a getattr from a client a lease on the attributes of
+ * a file or symlink, in which case the client keeps them in the acache
+ * for the length of the lease instead of its own timeout.  When the
+ * object changes, the server sends an unexpected PVFS_SERV_LEASE_BREAK
+ * request to the holders of a lease, and holds the change back until
+ * each has answered or its lease has run out.  The client picks those up
+ * whenever it makes progress on its state machines or looks in the
+ * acache, drops the cached attributes, and answers.
+ *
+ * Leases are only asked for once PVFS_sys_initialize() has finished, so
+ * that nothing else is waiting for unexpected messages in the process.
+ *
+ * @{
+ */
+
+/** \file
+ * Declarations for the client lease component.
+ */
+
+void PINT_client_lease_enable(int enable);
+
+int PINT_client_lease_enabled(void);
+
+void PINT_client_lease_poll(void);
+
+unsigned int PINT_client_lease_generation(void);
+
+/* @} */
+
+#endif /* __CLIENT_LEASE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -25,6 +25,7 @@
 #include "id-generator.h"
 #include "ncache.h"
 #include "acache.h"
+#include "client-lease.h"
 #include "pint-event.h"
 #include "pint-hint.h"
 #include "security-util.h"
@@ -364,7 +365,12 @@ struct PINT_client_op_entry_s PINT_client_sm_sys_table[] =
     {&pvfs2_client_statfs_sm},
     {&pvfs2_fs_add_sm},
     {&pvfs2_client_readdirplus_sm},
-    {&pvfs2_client_atomic_eattr_sm}
+    {&pvfs2_client_atomic_eattr_sm},
+    {&pvfs2_client_copy_sm},
+    {&pvfs2_client_remove_list_sm},
+    {&pvfs2_client_seek_sm},
+    {&pvfs2_client_get_eattr_bulk_sm},
+    {&pvfs2_client_getattr_list_sm}
 };
 
 struct PINT_client_op_entry_s PINT_client_sm_mgmt_table[] =
@@ -840,6 +846,9 @@ PVFS_error PINT_client_state_machine_test(
 			  pint_client_sm_context);
     assert(ret > -1);
 
+    /* take any lease breaks that came in meanwhile */
+    PINT_client_lease_poll();
+
     /* do as much as we can on every job that has completed */
     for(i = 0; i < job_count; i++)
     {
@@ -942,6 +951,9 @@ PVFS_error PINT_client_state_machine_testany(
                        * should at least test for
                        * ETIMEDOUT
                        */
+
+   /* take any lease breaks that came in meanwhile */
+   PINT_client_lease_poll();
  
    /* do as much as we can on every job that has completed */
    for(i = 0; i < job_count; i++)
@@ -1044,6 +1056,9 @@ PVFS_error PINT_client_state_machine_testsome(
                        * ETIMEDOUT
                        */
 
+    /* take any lease breaks that came in meanwhile */
+    PINT_client_lease_poll();
+
     /* do as much as we can on every job that has completed */
     for(i = 0; i < job_count; i++)
     {
@@ -1213,6 +1228,11 @@ const char *PINT_client_get_name_str(int op_type)
         { PVFS_SYS_SETATTR, "PVFS_SYS_SETATTR" },
         { PVFS_SYS_IO, "PVFS_SYS_IO" },
         { PVFS_SYS_FLUSH, "PVFS_SYS_FLUSH" },
+        { PVFS_SYS_COPY, "PVFS_SYS_COPY" },
+        { PVFS_SYS_REMOVE_LIST, "PVFS_SYS_REMOVE_LIST" },
+        { PVFS_SYS_SEEK, "PVFS_SYS_SEEK" },
+        { PVFS_SYS_GETEATTR_BULK, "PVFS_SYS_GETEATTR_BULK" },
+        { PVFS_SYS_GETATTR_LIST, "PVFS_SYS_GETATTR_LIST" },
         { PVFS_SYS_READDIRPLUS, "PVFS_SYS_READDIR_PLUS" },
         { PVFS_MGMT_SETPARAM_LIST, "PVFS_MGMT_SETPARAM_LIST" },
         { PVFS_MGMT_NOOP, "PVFS_MGMT_NOOP" },
@@ -1291,6 +1311,12 @@ int PVFS_sys_wait(PVFS_sys_op_id op_id,
     return PINT_client_wait_internal(op_id, in_op_str, out_error, "sys");
 }
 
+/** Frees an operation once PVFS_sys_wait() has returned for it */
+void PVFS_sys_release(PVFS_sys_op_id op_id)
+{
+    PINT_sys_release(op_id);
+}
+
 int PVFS_mgmt_testsome(PVFS_mgmt_op_id *op_id_array, /* out */
                        int *op_count,                /* in/out */
                        void **user_ptr_array,        /* out if present */
@@ -124,6 +124,12 @@ typedef struct PINT_sm_getattr_state
     PVFS_size size;
 
     int flags;
+
+    /* lease granted on the attributes, and the lease break count when
+     * the getattr was sent
+     */
+    uint32_t lease_msecs;
+    unsigned int lease_generation;
     
 } PINT_sm_getattr_state;
 
@@ -183,6 +189,31 @@ struct PINT_client_remove_sm
     PVFS_capability parent_capability;
 };
 
+/* handles of one remove_list stage that go to the same server */
+struct PINT_client_remove_list_group
+{
+    PVFS_BMI_addr_t addr;
+    int count;
+    PVFS_handle *handles;
+    int *entries;        /* entry each handle belongs to */
+};
+
+struct PINT_client_remove_list_sm
+{
+    int count;                  /* input parameter */
+    char **object_names;        /* input parameter */
+    PVFS_error *error_array;    /* in/out parameter */
+    PVFS_capability parent_capability;
+    PVFS_handle *handles;       /* object each entry pointed to */
+    PVFS_object_attr *attrs;    /* attributes of each object */
+    int *finished;              /* entries that need no more work */
+    int *entry_map;             /* entry of each crdirent msgpair */
+    int stage;
+    int group_count;
+    int group_max;
+    struct PINT_client_remove_list_group *groups;
+};
+
 struct PINT_client_create_sm
 {
     char *object_name;                /* input parameter */
@@ -314,6 +345,17 @@ typedef struct PINT_client_io_ctx
     int flow_in_progress;
     int write_ack_in_progress;
 
+    /*
+      large requests are sent to each server a window at a time; these
+      track the window this context is on
+    */
+    PVFS_offset window_offset;  /* from the start of the request */
+    PVFS_size window_done;      /* bytes moved in earlier windows */
+    PVFS_time window_start;     /* ms, when the window's msgpair was posted */
+    int window_ready;           /* next window waiting to be posted */
+    int complete;               /* last window finished */
+    int straggler;              /* cut off to retry on a mirror */
+
 } PINT_client_io_ctx;
 
 struct PINT_client_io_sm
@@ -352,6 +394,12 @@ struct PINT_client_io_sm
 
     PVFS_size * dfile_size_array;
     int small_io;
+
+    /* bytes of the request per window, 0 to send it all at once */
+    PVFS_size window_size;
+    int window_posting;         /* some context has a window to post */
+    int windows_done;           /* for the average window time */
+    PVFS_time window_msecs;
 };
 
 struct PINT_client_flush_sm
@@ -361,6 +409,29 @@ struct PINT_client_flush_sm
 #endif
 };
 
+struct PINT_client_copy_sm
+{
+    PVFS_object_ref dst_ref;      /* input parameter */
+    PVFS_sysresp_copy *copy_resp; /* in/out parameter */
+    PVFS_object_attr src_attr;    /* source attributes, from getattr */
+    int unstuffed;                /* set once the destination was unstuffed */
+    PVFS_offset offset;           /* datafile offset of the current chunk */
+    int *active;                  /* datafiles with data left to copy */
+    int *msg_dfile;               /* datafile index of each msgpair */
+    PVFS_handle *dst_handles;     /* destination handle of each msgpair */
+    uint32_t *wc_index;
+    PINT_dist *dist;              /* basic distribution of the requests */
+    PVFS_size total_copied;
+};
+
+struct PINT_client_seek_sm
+{
+    PVFS_offset offset;           /* input parameter */
+    enum PVFS_seek_type whence;   /* input parameter */
+    PVFS_sysresp_seek *seek_resp; /* in/out parameter */
+    PVFS_offset *result_array;    /* datafile offset asked for, then found */
+};
+
 struct PINT_client_readdir_sm
 {
     PVFS_ds_position pos_token;         /* in/out parameter */
@@ -394,6 +465,23 @@ struct PINT_client_readdirplus_sm
     PVFS_handle     **handles;
 };
 
+struct PINT_client_getattr_list_sm
+{
+    int nhandles;                       /* input parameter */
+    PVFS_handle *handles;               /* input parameter */
+    uint32_t attrmask;                  /* input parameter */
+    PVFS_sysresp_getattr_list *resp_p;  /* in/out parameter */
+    /* scratch variables */
+    PVFS_object_attr *obj_attr_array;   /* attributes of each handle */
+    PVFS_size **size_array;     /* datafile sizes of each metafile */
+    int *size_left;             /* datafile sizes each is waiting for */
+    PVFS_handle *msg_handles;   /* handles grouped by server */
+    int *msg_index;         /* handles entry of each msg_handles */
+    int *msg_aux;           /* datafile number of each msg_handles */
+    int *msg_first;         /* first msg_handles entry of each message */
+    PVFS_BMI_addr_t *msg_addr;  /* server of each message */
+};
+
 /* 
  * A segment is part of a path - namely each part of the
  * path delimited by / characters.  As each segment is
@@ -540,6 +628,7 @@ struct PINT_server_get_config_sm
     uint32_t fs_config_buf_size;
     int persist_config_buffers;
     int free_config_flag;
+    int from_pcache;        /* configuration came from the pcache */
 };
 
 struct PINT_server_fetch_config_sm_state
@@ -560,6 +649,20 @@ struct PINT_client_geteattr_sm
     PVFS_sysresp_geteattr *resp_p;
 };
 
+struct PINT_client_geteattr_bulk_sm
+{
+    int nhandles;                   /* input parameter */
+    PVFS_handle *handles;           /* input parameter */
+    int32_t nkey;                   /* input parameter */
+    PVFS_ds_keyval *key_array;      /* input parameter */
+    PVFS_sysresp_geteattr *resp_p;  /* in/out parameter */
+    /* scratch variables */
+    int32_t valsz;          /* largest value buffer of resp_p */
+    PVFS_handle *msg_handles;   /* handles grouped by server */
+    int *msg_index;         /* position in handles of each msg_handles */
+    int *msg_first;         /* first msg_handles entry of each message */
+};
+
 struct PINT_client_seteattr_sm
 {
     int32_t nkey;
@@ -622,6 +725,11 @@ struct PINT_client_mgmt_get_uid_list_sm
     uint32_t *uid_count;               /* out */
 };
 
+struct PINT_client_mgmt_noop_sm
+{
+    int32_t *startup_phase;            /* out */
+};
+
 #ifdef ENABLE_SECURITY_CERT
 struct PINT_client_mgmt_get_user_cert_sm
 {
@@ -695,6 +803,7 @@ typedef struct PINT_client_sm
     union
     {
         struct PINT_client_remove_sm remove;
+        struct PINT_client_remove_list_sm remove_list;
         struct PINT_client_create_sm create;
         struct PINT_client_mkdir_sm mkdir;
         struct PINT_client_symlink_sm sym;
@@ -702,7 +811,10 @@ typedef struct PINT_client_sm
         struct PINT_client_setattr_sm setattr;
         struct PINT_client_io_sm io;
         struct PINT_client_flush_sm flush;
+        struct PINT_client_copy_sm copy;
+        struct PINT_client_seek_sm seek;
         struct PINT_client_readdirplus_sm readdirplus;
+        struct PINT_client_getattr_list_sm getattr_list;
         struct PINT_client_lookup_sm lookup;
         struct PINT_client_rename_sm rename;
         struct PINT_client_mgmt_setparam_list_sm setparam_list;
@@ -718,6 +830,7 @@ typedef struct PINT_client_sm
         struct PINT_client_mgmt_get_dirdata_handle_sm mgmt_get_dirdata_handle;
         struct PINT_server_get_config_sm get_config;
         struct PINT_client_geteattr_sm geteattr;
+        struct PINT_client_geteattr_bulk_sm geteattr_bulk;
         struct PINT_client_seteattr_sm seteattr;
         struct PINT_client_atomiceattr_sm atomiceattr;
         struct PINT_client_deleattr_sm deleattr;
@@ -726,6 +839,7 @@ typedef struct PINT_client_sm
         struct PINT_sysdev_unexp_sm sysdev_unexp;
         struct PINT_client_job_timer_sm job_timer;
         struct PINT_client_mgmt_get_uid_list_sm get_uid_list;
+        struct PINT_client_mgmt_noop_sm mgmt_noop;
 #ifdef ENABLE_SECURITY_CERT
         struct PINT_client_mgmt_get_user_cert_sm mgmt_get_user_cert;
 #endif
@@ -814,6 +928,11 @@ enum
     PVFS_SYS_FS_ADD                = 19,
     PVFS_SYS_READDIRPLUS           = 20,
     PVFS_SYS_ATOMICEATTR           = 21,
+    PVFS_SYS_COPY                  = 22,
+    PVFS_SYS_REMOVE_LIST           = 23,
+    PVFS_SYS_SEEK                  = 24,
+    PVFS_SYS_GETEATTR_BULK         = 25,
+    PVFS_SYS_GETATTR_LIST          = 26,
     PVFS_MGMT_SETPARAM_LIST        = 70,
     PVFS_MGMT_NOOP                 = 71,
     PVFS_MGMT_STATFS_LIST          = 72,
@@ -834,7 +953,7 @@ enum
     PVFS_DEV_UNEXPECTED            = 400
 };
 
-#define PVFS_OP_SYS_MAXVALID  22
+#define PVFS_OP_SYS_MAXVALID  27
 #define PVFS_OP_SYS_MAXVAL 69
 #define PVFS_OP_MGMT_MAXVALID 84
 #define PVFS_OP_MGMT_MAXVAL 199
@@ -911,9 +1030,13 @@ extern struct PINT_state_machine_s pvfs2_client_setattr_sm;
 extern struct PINT_state_machine_s pvfs2_client_io_sm;
 extern struct PINT_state_machine_s pvfs2_client_small_io_sm;
 extern struct PINT_state_machine_s pvfs2_client_flush_sm;
+extern struct PINT_state_machine_s pvfs2_client_copy_sm;
+extern struct PINT_state_machine_s pvfs2_client_seek_sm;
+extern struct PINT_state_machine_s pvfs2_client_remove_list_sm;
 extern struct PINT_state_machine_s pvfs2_client_sysint_readdir_sm;
 extern struct PINT_state_machine_s pvfs2_client_readdir_sm;
 extern struct PINT_state_machine_s pvfs2_client_readdirplus_sm;
+extern struct PINT_state_machine_s pvfs2_client_getattr_list_sm;
 extern struct PINT_state_machine_s pvfs2_client_lookup_sm;
 extern struct PINT_state_machine_s pvfs2_client_rename_sm;
 extern struct PINT_state_machine_s pvfs2_client_truncate_sm;
@@ -934,6 +1057,7 @@ extern struct PINT_state_machine_s pvfs2_client_mgmt_remove_dirent_sm;
 extern struct PINT_state_machine_s pvfs2_client_mgmt_create_dirent_sm;
 extern struct PINT_state_machine_s pvfs2_client_mgmt_get_dirdata_handle_sm;
 extern struct PINT_state_machine_s pvfs2_client_get_eattr_sm;
+extern struct PINT_state_machine_s pvfs2_client_get_eattr_bulk_sm;
 extern struct PINT_state_machine_s pvfs2_client_set_eattr_sm;
 extern struct PINT_state_machine_s pvfs2_client_atomic_eattr_sm;
 extern struct PINT_state_machine_s pvfs2_client_del_eattr_sm;
@@ -13,6 +13,8 @@
 #include "pint-sysint-utils.h"
 #include "acache.h"
 #include "ncache.h"
+#include "pcache.h"
+#include "client-lease.h"
 #include "client-capcache.h"
 #include "gen-locks.h"
 #include "pint-cached-config.h"
@@ -64,6 +66,7 @@ int PVFS_sys_finalize()
         return 0;
     }
 
+    PINT_client_lease_enable(0);
     id_gen_safe_finalize();
 
     /* If desired, display cache perf counters before they are finalized. */
@@ -97,6 +100,7 @@ int PVFS_sys_finalize()
     PINT_client_capcache_finalize();
     PINT_ncache_finalize();
     PINT_acache_finalize();
+    PINT_pcache_finalize();
     PINT_cached_config_finalize();
 
     /* flush all known server configurations */
@@ -18,6 +18,8 @@
 #include "pvfs2-internal.h"
 #include "acache.h"
 #include "ncache.h"
+#include "pcache.h"
+#include "client-lease.h"
 #include "client-capcache.h"
 #include "pint-cached-config.h"
 #include "pvfs2-sysint.h"
@@ -303,6 +305,11 @@ int PVFS_sys_initialize(uint64_t default_debug_mask)
     }        
     client_status_flag |= CLIENT_NCACHE_INIT;
 
+    /* attach to the node-local metadata cache, if one is configured;
+     * without it we just start with empty caches
+     */
+    PINT_pcache_initialize();
+
     /* initialize the server configuration manager */
     ret = PINT_server_config_mgr_initialize();
     if (ret < 0)
@@ -342,6 +349,11 @@ int PVFS_sys_initialize(uint64_t default_debug_mask)
     /* keep track of this pointer for freeing on finalize */
     g_smcb = smcb;
 
+    /* nothing else here waits for unexpected messages, so servers may
+     * now send us lease breaks
+     */
+    PINT_client_lease_enable(1);
+
     ret = 0;
     goto local_exit;
 
@@ -9,6 +9,7 @@
 #include "pvfs2-attr.h"
 #include "ncache.h"
 #include "tcache.h"
+#include "pcache.h"
 #include "pint-util.h"
 #include "pint-sysint-utils.h"
 #include "pvfs2-debug.h"
@@ -249,6 +250,11 @@ int PINT_ncache_get_cached_entry(
                         1,
                         PINT_PERF_ADD);
         gen_mutex_unlock(&ncache_mutex);
+        /* another process on this node may have looked it up */
+        if(PINT_pcache_get_name(entry, parent_ref, entry_ref) == 0)
+        {
+            return(0);
+        }
         /* Return -PVFS_ENOENT if the entry has expired */
         if(status != 0)
         {   
@@ -324,6 +330,8 @@ void PINT_ncache_invalidate(
                     PINT_PERF_SET);
 
     gen_mutex_unlock(&ncache_mutex);
+
+    PINT_pcache_invalidate_name(entry, parent_ref);
     return;
 }
   
@@ -348,6 +356,7 @@ int PINT_ncache_update(
     int status;
     int purged;
     unsigned int enabled;
+    unsigned int timeout_msecs;
 
     /* skip out immediately if the cache is disabled */
     PINT_tcache_get_info(ncache, TCACHE_ENABLE, &enabled);
@@ -444,6 +453,8 @@ int PINT_ncache_update(
                     ncache->num_entries,
                     PINT_PERF_SET);
 
+    PINT_tcache_get_info(ncache, TCACHE_TIMEOUT_MSECS, &timeout_msecs);
+
     gen_mutex_unlock(&ncache_mutex);
   
     /* cleanup if we did not succeed for some reason */
@@ -451,6 +462,10 @@ int PINT_ncache_update(
     {
         ncache_free_payload(tmp_payload);
     }
+    else
+    {
+        PINT_pcache_put_name(entry, parent_ref, entry_ref, timeout_msecs);
+    }
   
     gossip_debug(GOSSIP_NCACHE_DEBUG, "ncache: update(): return=%d\n", ret);
     return(ret);
@@ -0,0 +1,800 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include "pvfs2-internal.h"
+#define __PINT_REQPROTO_ENCODE_FUNCS_C
+#include "pvfs2-attr.h"
+#include "pvfs2-req-proto.h"
+#include "pint-util.h"
+#include "pint-distribution.h"
+#include "pvfs2-debug.h"
+#include "gossip.h"
+#include "pcache.h"
+
+/** \file
+ *  \ingroup pcache
+ * Implementation of the Persistent Metadata Cache (pcache) component.
+ */
+
+#define PCACHE_MAGIC 0x70636163
+#define PCACHE_VERSION 1
+
+#define PCACHE_CONFIG_SLOTS 4
+#define PCACHE_CONFIG_BYTES (64 * 1024)
+#define PCACHE_NAME_SLOTS 4096
+#define PCACHE_ATTR_SLOTS 4096
+#define PCACHE_ATTR_BYTES 768
+/* slots an entry may hash to */
+#define PCACHE_PROBES 8
+
+/* server configurations change rarely, but a stale one must not outlive
+ * a server restart for long
+ */
+#define PCACHE_CONFIG_TIMEOUT_MSECS (5 * 60 * 1000)
+
+/* how long an attaching process waits for the creator to set up */
+#define PCACHE_ATTACH_TRIES 100
+#define PCACHE_ATTACH_WAIT_USECS 10000
+
+struct pcache_config_slot
+{
+    uint64_t expires;
+    uint32_t size;
+    char server[PVFS_MAX_SERVER_ADDR_LEN];
+    char buf[PCACHE_CONFIG_BYTES];
+};
+
+struct pcache_name_slot
+{
+    uint64_t expires;
+    PVFS_fs_id fs_id;
+    PVFS_handle parent;
+    PVFS_handle handle;
+    char name[PVFS_NAME_MAX + 1];
+};
+
+struct pcache_attr_slot
+{
+    uint64_t expires;
+    uint64_t size_expires;
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+    PVFS_size size;
+    uint32_t len;             /* bytes of encoded attributes in buf */
+    char buf[PCACHE_ATTR_BYTES];
+};
+
+struct pcache_segment
+{
+    uint32_t magic;           /* set last, once the segment is usable */
+    uint32_t version;
+    uint64_t segment_size;
+#ifndef WIN32
+    pthread_mutex_t mutex;    /* process shared and robust */
+#endif
+    struct pcache_config_slot config[PCACHE_CONFIG_SLOTS];
+    struct pcache_name_slot names[PCACHE_NAME_SLOTS];
+    struct pcache_attr_slot attrs[PCACHE_ATTR_SLOTS];
+};
+
+static struct pcache_segment *pcache = NULL;
+
+#ifndef WIN32
+
+static int pcache_attach(const char *path);
+static int pcache_lock(void);
+static void pcache_unlock(void);
+static uint64_t pcache_now(void);
+static uint32_t pcache_hash(const void *buf, int len, uint32_t hash);
+static void pcache_free_decoded(PVFS_object_attr *attr);
+
+/**
+ * Attaches to the shared segment named by PVFS2_PCACHE_FILE, creating it
+ * if this is the first process to use it.  The pcache is simply left
+ * disabled if the variable is not set or the segment can't be used.
+ * \return 0 on success or if disabled, -PVFS_error on failure
+ */
+int PINT_pcache_initialize(void)
+{
+    char *path;
+    int ret;
+
+    path = getenv("PVFS2_PCACHE_FILE");
+    if (!path || !*path)
+    {
+        return 0;
+    }
+
+    ret = pcache_attach(path);
+    if (ret < 0)
+    {
+        gossip_debug(GOSSIP_CLIENT_DEBUG, "pcache: not using %s: %d\n",
+                     path, ret);
+        return ret;
+    }
+    gossip_debug(GOSSIP_CLIENT_DEBUG, "pcache: attached to %s\n", path);
+    return 0;
+}
+
+/** Detaches from the shared segment; its contents stay for other
+ * processes.
+ */
+void PINT_pcache_finalize(void)
+{
+    if (pcache)
+    {
+        munmap(pcache, sizeof(*pcache));
+        pcache = NULL;
+    }
+}
+
+/** \return nonzero if this process is attached to a pcache segment */
+int PINT_pcache_enabled(void)
+{
+    return (pcache != NULL);
+}
+
+/**
+ * Retrieves a copy of the configuration buffer of the given config
+ * server.  The caller frees *fs_config_buf.
+ * \return 0 on success, -PVFS_ENOENT if not cached
+ */
+int PINT_pcache_get_config(
+    const char *server,
+    char **fs_config_buf,
+    uint32_t *fs_config_buf_size)
+{
+    struct pcache_config_slot *slot;
+    uint64_t now = pcache_now();
+    int ret = -PVFS_ENOENT;
+    int i;
+
+    if (!pcache || pcache_lock() < 0)
+    {
+        return ret;
+    }
+    for (i = 0; i < PCACHE_CONFIG_SLOTS; i++)
+    {
+        slot = &pcache->config[i];
+        if (slot->expires > now && !strcmp(slot->server, server))
+        {
+            *fs_config_buf = malloc(slot->size);
+            if (!*fs_config_buf)
+            {
+                ret = -PVFS_ENOMEM;
+                break;
+            }
+            memcpy(*fs_config_buf, slot->buf, slot->size);
+            *fs_config_buf_size = slot->size;
+            ret = 0;
+            break;
+        }
+    }
+    pcache_unlock();
+    return ret;
+}
+
+/** Stores the configuration buffer received from a config server. */
+void PINT_pcache_put_config(
+    const char *server,
+    const char *fs_config_buf,
+    uint32_t fs_config_buf_size)
+{
+    struct pcache_config_slot *slot, *victim = NULL;
+    int i;
+
+    if (!pcache || fs_config_buf_size > PCACHE_CONFIG_BYTES ||
+        strlen(server) >= PVFS_MAX_SERVER_ADDR_LEN)
+    {
+        return;
+    }
+    if (pcache_lock() < 0)
+    {
+        return;
+    }
+    for (i = 0; i < PCACHE_CONFIG_SLOTS; i++)
+    {
+        slot = &pcache->config[i];
+        if (!strcmp(slot->server, server))
+        {
+            victim = slot;
+            break;
+        }
+        if (!victim || slot->expires < victim->expires)
+        {
+            victim = slot;
+        }
+    }
+    strcpy(victim->server, server);
+    memcpy(victim->buf, fs_config_buf, fs_config_buf_size);
+    victim->size = fs_config_buf_size;
+    victim->expires = pcache_now() + PCACHE_CONFIG_TIMEOUT_MSECS;
+    pcache_unlock();
+}
+
+static struct pcache_name_slot *find_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    struct pcache_name_slot **victim)
+{
+    struct pcache_name_slot *slot;
+    uint32_t hash;
+    int i;
+
+    hash = pcache_hash(&parent_ref->handle, sizeof(PVFS_handle), 0);
+    hash = pcache_hash(entry, strlen(entry), hash);
+    for (i = 0; i < PCACHE_PROBES; i++)
+    {
+        slot = &pcache->names[(hash + i) % PCACHE_NAME_SLOTS];
+        if (slot->parent == parent_ref->handle &&
+            slot->fs_id == parent_ref->fs_id &&
+            !strcmp(slot->name, entry))
+        {
+            return slot;
+        }
+        if (victim && (!*victim || slot->expires < (*victim)->expires))
+        {
+            *victim = slot;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Looks up a name that some process on this node resolved recently.
+ * \return 0 on success, -PVFS_ENOENT if not cached or expired
+ */
+int PINT_pcache_get_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    PVFS_object_ref *entry_ref)
+{
+    struct pcache_name_slot *slot;
+    int ret = -PVFS_ENOENT;
+
+    if (!pcache || strlen(entry) > PVFS_NAME_MAX || pcache_lock() < 0)
+    {
+        return ret;
+    }
+    slot = find_name(entry, parent_ref, NULL);
+    if (slot && slot->expires > pcache_now())
+    {
+        entry_ref->handle = slot->handle;
+        entry_ref->fs_id = slot->fs_id;
+        ret = 0;
+    }
+    pcache_unlock();
+
+    gossip_debug(GOSSIP_NCACHE_DEBUG, "pcache: name [%s] %s\n", entry,
+                 ret ? "miss" : "hit");
+    return ret;
+}
+
+/** Stores a name entry that expires after timeout_msecs. */
+void PINT_pcache_put_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    const PVFS_object_ref *entry_ref,
+    unsigned int timeout_msecs)
+{
+    struct pcache_name_slot *slot, *victim = NULL;
+
+    if (!pcache || strlen(entry) > PVFS_NAME_MAX || pcache_lock() < 0)
+    {
+        return;
+    }
+    slot = find_name(entry, parent_ref, &victim);
+    if (!slot)
+    {
+        slot = victim;
+        strcpy(slot->name, entry);
+        slot->parent = parent_ref->handle;
+        slot->fs_id = parent_ref->fs_id;
+    }
+    slot->handle = entry_ref->handle;
+    slot->expires = pcache_now() + timeout_msecs;
+    pcache_unlock();
+}
+
+/** Drops a name entry (if present). */
+void PINT_pcache_invalidate_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref)
+{
+    struct pcache_name_slot *slot;
+
+    if (!pcache || strlen(entry) > PVFS_NAME_MAX || pcache_lock() < 0)
+    {
+        return;
+    }
+    slot = find_name(entry, parent_ref, NULL);
+    if (slot)
+    {
+        slot->expires = 0;
+    }
+    pcache_unlock();
+}
+
+static struct pcache_attr_slot *find_attr(
+    PVFS_object_ref refn,
+    struct pcache_attr_slot **victim)
+{
+    struct pcache_attr_slot *slot;
+    uint32_t hash;
+    int i;
+
+    hash = pcache_hash(&refn.handle, sizeof(PVFS_handle), 0);
+    for (i = 0; i < PCACHE_PROBES; i++)
+    {
+        slot = &pcache->attrs[(hash + i) % PCACHE_ATTR_SLOTS];
+        if (slot->handle == refn.handle && slot->fs_id == refn.fs_id)
+        {
+            return slot;
+        }
+        if (victim && (!*victim || slot->expires < (*victim)->expires))
+        {
+            *victim = slot;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Retrieves a copy of attributes that some process on this node fetched
+ * recently, and the logical file size if that has not expired yet.
+ * \return 0 on success, -PVFS_ENOENT if not cached or expired
+ */
+int PINT_pcache_get_attr(
+    PVFS_object_ref refn,
+    PVFS_object_attr *attr,
+    PVFS_size *size,
+    int *size_status)
+{
+    struct pcache_attr_slot *slot;
+    char buf[PCACHE_ATTR_BYTES];
+    char *ptr = buf;
+    PVFS_object_attr tmp_attr;
+    PVFS_size tmp_size = 0;
+    int have_size = 0;
+    uint64_t now = pcache_now();
+    int ret;
+
+    if (!pcache || pcache_lock() < 0)
+    {
+        return -PVFS_ENOENT;
+    }
+    slot = find_attr(refn, NULL);
+    if (!slot || slot->expires <= now)
+    {
+        pcache_unlock();
+        gossip_debug(GOSSIP_ACACHE_DEBUG, "pcache: miss: H=%llu\n",
+                     llu(refn.handle));
+        return -PVFS_ENOENT;
+    }
+    memcpy(buf, slot->buf, slot->len);
+    if (slot->size_expires > now)
+    {
+        tmp_size = slot->size;
+        have_size = 1;
+    }
+    pcache_unlock();
+
+    memset(&tmp_attr, 0, sizeof(tmp_attr));
+    decode_PVFS_object_attr(&ptr, &tmp_attr);
+    ret = PINT_copy_object_attr(attr, &tmp_attr);
+    pcache_free_decoded(&tmp_attr);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (have_size)
+    {
+        attr->mask |= PVFS_ATTR_DATA_SIZE;
+        *size = tmp_size;
+        *size_status = 0;
+    }
+    gossip_debug(GOSSIP_ACACHE_DEBUG, "pcache: hit: H=%llu, size %s\n",
+                 llu(refn.handle), have_size ? "valid" : "expired");
+    return 0;
+}
+
+/**
+ * Stores attributes that expire after timeout_msecs, and the logical file
+ * size (if not NULL) that expires after size_timeout_msecs.
+ */
+void PINT_pcache_put_attr(
+    PVFS_object_ref refn,
+    const PVFS_object_attr *attr,
+    const PVFS_size *size,
+    unsigned int timeout_msecs,
+    unsigned int size_timeout_msecs)
+{
+    struct pcache_attr_slot *slot, *victim = NULL;
+    PVFS_object_attr tmp_attr;
+    char *buf, *ptr;
+    int len;
+    uint64_t now;
+
+    if (!pcache)
+    {
+        return;
+    }
+
+    /* a datafile's size lives in the attributes; only logical file
+     * sizes are kept on the side
+     */
+    if (attr->objtype == PVFS_TYPE_DATAFILE)
+    {
+        return;
+    }
+
+    /* capabilities belong to the process that got them */
+    tmp_attr = *attr;
+    tmp_attr.mask &= ~(PVFS_ATTR_CAPABILITY | PVFS_ATTR_DIR_DIRENT_COUNT |
+                       PVFS_ATTR_DATA_SIZE);
+
+    buf = malloc(roundup8(sizeof(PVFS_object_attr)) +
+                 extra_size_PVFS_object_attr);
+    if (!buf)
+    {
+        return;
+    }
+    ptr = buf;
+    encode_PVFS_object_attr(&ptr, &tmp_attr);
+    len = ptr - buf;
+    if (len > PCACHE_ATTR_BYTES)
+    {
+        /* too many datafiles to share */
+        free(buf);
+        PINT_pcache_invalidate_attr(refn);
+        return;
+    }
+
+    if (pcache_lock() < 0)
+    {
+        free(buf);
+        return;
+    }
+    now = pcache_now();
+    slot = find_attr(refn, &victim);
+    if (!slot)
+    {
+        slot = victim;
+        slot->handle = refn.handle;
+        slot->fs_id = refn.fs_id;
+        slot->size_expires = 0;
+    }
+    memcpy(slot->buf, buf, len);
+    slot->len = len;
+    slot->expires = now + timeout_msecs;
+    if (size)
+    {
+        slot->size = *size;
+        slot->size_expires = now + size_timeout_msecs;
+    }
+    else
+    {
+        slot->size_expires = 0;
+    }
+    pcache_unlock();
+    free(buf);
+}
+
+/** Drops the attributes of an object (if present). */
+void PINT_pcache_invalidate_attr(PVFS_object_ref refn)
+{
+    struct pcache_attr_slot *slot;
+
+    if (!pcache || pcache_lock() < 0)
+    {
+        return;
+    }
+    slot = find_attr(refn, NULL);
+    if (slot)
+    {
+        slot->expires = 0;
+        slot->size_expires = 0;
+    }
+    pcache_unlock();
+}
+
+/** Drops only the logical file size of an object (if present). */
+void PINT_pcache_invalidate_size(PVFS_object_ref refn)
+{
+    struct pcache_attr_slot *slot;
+
+    if (!pcache || pcache_lock() < 0)
+    {
+        return;
+    }
+    slot = find_attr(refn, NULL);
+    if (slot)
+    {
+        slot->size_expires = 0;
+    }
+    pcache_unlock();
+}
+
+static int pcache_attach(const char *path)
+{
+    struct pcache_segment *seg;
+    pthread_mutexattr_t mattr;
+    struct stat sbuf;
+    int fd, creator = 1;
+    int i;
+
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        creator = 0;
+        fd = open(path, O_RDWR);
+    }
+    if (fd < 0)
+    {
+        return -PVFS_errno_to_error(errno);
+    }
+
+    if (creator)
+    {
+        if (ftruncate(fd, sizeof(*seg)) < 0)
+        {
+            close(fd);
+            unlink(path);
+            return -PVFS_errno_to_error(errno);
+        }
+    }
+    else
+    {
+        /* everyone sharing the segment sees the same metadata, so it has
+         * to be our own; wait for a creator that is still sizing it
+         */
+        for (i = 0; i < PCACHE_ATTACH_TRIES; i++)
+        {
+            if (fstat(fd, &sbuf) < 0)
+            {
+                close(fd);
+                return -PVFS_errno_to_error(errno);
+            }
+            if (sbuf.st_uid != geteuid() || (sbuf.st_mode & 077))
+            {
+                close(fd);
+                return -PVFS_EACCES;
+            }
+            if (sbuf.st_size == sizeof(*seg))
+            {
+                break;
+            }
+            usleep(PCACHE_ATTACH_WAIT_USECS);
+        }
+        if (i == PCACHE_ATTACH_TRIES)
+        {
+            close(fd);
+            return -PVFS_EINVAL;
+        }
+    }
+
+    seg = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED)
+    {
+        return -PVFS_errno_to_error(errno);
+    }
+
+    if (creator)
+    {
+        pthread_mutexattr_init(&mattr);
+        pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&seg->mutex, &mattr);
+        pthread_mutexattr_destroy(&mattr);
+        seg->version = PCACHE_VERSION;
+        seg->segment_size = sizeof(*seg);
+        __sync_synchronize();
+        seg->magic = PCACHE_MAGIC;
+    }
+    else
+    {
+        for (i = 0; i < PCACHE_ATTACH_TRIES && seg->magic != PCACHE_MAGIC;
+             i++)
+        {
+            usleep(PCACHE_ATTACH_WAIT_USECS);
+        }
+        __sync_synchronize();
+        if (seg->magic != PCACHE_MAGIC ||
+            seg->version != PCACHE_VERSION ||
+            seg->segment_size != sizeof(*seg))
+        {
+            munmap(seg, sizeof(*seg));
+            return -PVFS_EINVAL;
+        }
+    }
+
+    pcache = seg;
+    return 0;
+}
+
+static int pcache_lock(void)
+{
+    int ret;
+
+    ret = pthread_mutex_lock(&pcache->mutex);
+    if (ret == EOWNERDEAD)
+    {
+        /* a process died while changing an entry; we don't know which
+         * one, so start over
+         */
+        gossip_debug(GOSSIP_CLIENT_DEBUG, "pcache: clearing after a "
+                     "process died holding the lock\n");
+        memset(pcache->config, 0, sizeof(pcache->config));
+        memset(pcache->names, 0, sizeof(pcache->names));
+        memset(pcache->attrs, 0, sizeof(pcache->attrs));
+        pthread_mutex_consistent(&pcache->mutex);
+        ret = 0;
+    }
+    return (ret == 0) ? 0 : -PVFS_EINVAL;
+}
+
+static void pcache_unlock(void)
+{
+    pthread_mutex_unlock(&pcache->mutex);
+}
+
+/* milliseconds on a clock all processes on the node share */
+static uint64_t pcache_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* FNV-1a, continued from hash */
+static uint32_t pcache_hash(const void *buf, int len, uint32_t hash)
+{
+    const unsigned char *p = buf;
+    int i;
+
+    if (hash == 0)
+    {
+        hash = 2166136261U;
+    }
+    for (i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/* frees what decode_PVFS_object_attr allocated; strings point into the
+ * encoded buffer
+ */
+static void pcache_free_decoded(PVFS_object_attr *attr)
+{
+    if (attr->mask & PVFS_ATTR_META_DFILES)
+    {
+        decode_free(attr->u.meta.dfile_array);
+    }
+    if (attr->mask & PVFS_ATTR_META_MIRROR_DFILES)
+    {
+        decode_free(attr->u.meta.mirror_dfile_array);
+    }
+    if (attr->mask & PVFS_ATTR_META_DIST)
+    {
+        decode_free(attr->u.meta.dist);
+    }
+    if (attr->mask & PVFS_ATTR_DISTDIR_ATTR)
+    {
+        decode_free(attr->dist_dir_bitmap);
+        decode_free(attr->dirdata_handles);
+    }
+}
+
+#else /* WIN32 */
+
+int PINT_pcache_initialize(void)
+{
+    return 0;
+}
+
+void PINT_pcache_finalize(void)
+{
+}
+
+int PINT_pcache_enabled(void)
+{
+    return 0;
+}
+
+int PINT_pcache_get_config(
+    const char *server,
+    char **fs_config_buf,
+    uint32_t *fs_config_buf_size)
+{
+    return -PVFS_ENOENT;
+}
+
+void PINT_pcache_put_config(
+    const char *server,
+    const char *fs_config_buf,
+    uint32_t fs_config_buf_size)
+{
+}
+
+int PINT_pcache_get_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    PVFS_object_ref *entry_ref)
+{
+    return -PVFS_ENOENT;
+}
+
+void PINT_pcache_put_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    const PVFS_object_ref *entry_ref,
+    unsigned int timeout_msecs)
+{
+}
+
+void PINT_pcache_invalidate_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref)
+{
+}
+
+int PINT_pcache_get_attr(
+    PVFS_object_ref refn,
+    PVFS_object_attr *attr,
+    PVFS_size *size,
+    int *size_status)
+{
+    return -PVFS_ENOENT;
+}
+
+void PINT_pcache_put_attr(
+    PVFS_object_ref refn,
+    const PVFS_object_attr *attr,
+    const PVFS_size *size,
+    unsigned int timeout_msecs,
+    unsigned int size_timeout_msecs)
+{
+}
+
+void PINT_pcache_invalidate_attr(PVFS_object_ref refn)
+{
+}
+
+void PINT_pcache_invalidate_size(PVFS_object_ref refn)
+{
+}
+
+#endif /* WIN32 */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,102 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#ifndef __PCACHE_H
+#define __PCACHE_H
+
+#include "pvfs2-types.h"
+#include "pvfs2-attr.h"
+
+/** \defgroup pcache Persistent Metadata Cache (pcache)
+ *
+ * The pcache is a node-local shared memory segment that keeps client
+ * metadata between processes, so a short-lived program does not start
+ * with empty caches.  It is optional: it is only used when the
+ * PVFS2_PCACHE_FILE environment variable names the segment, normally a
+ * file under /dev/shm.  The first process to use the name creates the
+ * segment and later ones attach to it.  The file is private to its owner,
+ * since every process sharing it sees the same names and attributes.
+ *
+ * The pcache holds:
+ * - server configuration buffers, by config server address, so fs_add can
+ *   skip the getconfig request (handle mappings are built from these)
+ * - name entries, written through from the ncache
+ * - attributes and file sizes, written through from the acache
+ * .
+ *
+ * Entries keep the expiration time the local cache gave them and are never
+ * used past it, so sharing them does not make them any more stale than
+ * they would be in one long-running process.  Capabilities are not
+ * shared.  The segment is fixed size; a new entry replaces the oldest one
+ * among the few slots it can hash to.
+ *
+ * @{
+ */
+
+/** \file
+ * Declarations for the pcache component.
+ */
+
+int PINT_pcache_initialize(void);
+
+void PINT_pcache_finalize(void);
+
+int PINT_pcache_enabled(void);
+
+int PINT_pcache_get_config(
+    const char *server,
+    char **fs_config_buf,
+    uint32_t *fs_config_buf_size);
+
+void PINT_pcache_put_config(
+    const char *server,
+    const char *fs_config_buf,
+    uint32_t fs_config_buf_size);
+
+int PINT_pcache_get_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    PVFS_object_ref *entry_ref);
+
+void PINT_pcache_put_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref,
+    const PVFS_object_ref *entry_ref,
+    unsigned int timeout_msecs);
+
+void PINT_pcache_invalidate_name(
+    const char *entry,
+    const PVFS_object_ref *parent_ref);
+
+int PINT_pcache_get_attr(
+    PVFS_object_ref refn,
+    PVFS_object_attr *attr,
+    PVFS_size *size,
+    int *size_status);
+
+void PINT_pcache_put_attr(
+    PVFS_object_ref refn,
+    const PVFS_object_attr *attr,
+    const PVFS_size *size,
+    unsigned int timeout_msecs,
+    unsigned int size_timeout_msecs);
+
+void PINT_pcache_invalidate_attr(PVFS_object_ref refn);
+
+void PINT_pcache_invalidate_size(PVFS_object_ref refn);
+
+/* @} */
+
+#endif /* __PCACHE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,448 @@
+/*
+ * (C) 2003 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/** \file
+ *  \ingroup sysint
+ *
+ *  Write-behind buffers: collect small writes to one file and send them
+ *  on in large pieces.
+ *
+ *  A buffer holds one contiguous extent of the file.  Writes that start
+ *  inside or right at the end of it are copied in; any other write sends
+ *  the extent first.  When a buffer fills up, the part of it that ends on
+ *  a stripe boundary is posted with PVFS_isys_io and the rest is moved to
+ *  the front of a second buffer, which takes the writes that follow while
+ *  the first is on its way.  Only one write is in flight at a time, so
+ *  they reach the servers in order.  An extent older than the age limit
+ *  is sent by the next write.
+ *
+ *  A write that fails after it was accepted is reported by the next call
+ *  on the buffer.  Nothing is read through the buffer; callers flush it
+ *  before they read the file or ask for its size.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pvfs2-internal.h"
+#include "pvfs2-sysint.h"
+#include "pvfs2-request.h"
+#include "pvfs2-util.h"
+#include "gossip.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "pint-util.h"
+#include "client-state-machine.h"
+
+struct wbuf_extent
+{
+    char *data;
+    PVFS_offset offset;          /* of data[0] in the file */
+    PVFS_size len;               /* bytes buffered */
+    PVFS_size posted;            /* bytes in flight, if any */
+    PVFS_time first_ms;          /* when the first byte was buffered */
+    PVFS_sys_op_id op_id;
+    PVFS_Request req;
+    PVFS_sysresp_io resp;
+};
+
+struct PVFS_sys_wbuf_s
+{
+    gen_mutex_t mutex;
+    PVFS_object_ref ref;
+    PVFS_size stripe;            /* posts end on a multiple of this */
+    PVFS_size size;              /* capacity of each extent */
+    int flush_msecs;             /* age at which an extent is sent */
+    int active;                  /* the extent taking writes */
+    struct wbuf_extent ext[2];
+    PVFS_error error;            /* to report on the next call */
+};
+
+static void wbuf_set_error(struct PVFS_sys_wbuf_s *wb, PVFS_error error)
+{
+    if (error && !wb->error)
+    {
+        wb->error = error;
+    }
+}
+
+/* clears up after the write of ext has completed */
+static void wbuf_complete(struct PVFS_sys_wbuf_s *wb,
+                          struct wbuf_extent *ext,
+                          PVFS_error error)
+{
+    if (!error && ext->resp.total_completed != ext->posted)
+    {
+        error = -PVFS_EIO;
+    }
+    if (error)
+    {
+        gossip_debug(GOSSIP_CLIENT_DEBUG,
+                     "%s: write of %lld bytes at %lld failed: %d\n",
+                     __func__, lld(ext->posted), lld(ext->offset), error);
+    }
+    wbuf_set_error(wb, error);
+    PVFS_Request_free(&ext->req);
+    ext->op_id = -1;
+    ext->posted = 0;
+    ext->len = 0;
+}
+
+/* checks, without blocking, whether the write in flight is done */
+static void wbuf_test(struct PVFS_sys_wbuf_s *wb)
+{
+    struct wbuf_extent *ext = &wb->ext[!wb->active];
+    PVFS_sys_op_id op_id;
+    int count = 1, error = 0, ret;
+
+    if (!ext->posted)
+    {
+        return;
+    }
+    op_id = ext->op_id;
+    ret = PVFS_sys_testsome(&op_id, &count, NULL, &error, 0);
+    if (ret < 0)
+    {
+        return;
+    }
+    if (count == 1)
+    {
+        /* testsome has released the operation */
+        wbuf_complete(wb, ext, error);
+    }
+}
+
+/* waits for the write in flight, if any, to finish */
+static void wbuf_wait(struct PVFS_sys_wbuf_s *wb)
+{
+    struct wbuf_extent *ext = &wb->ext[!wb->active];
+    int error = 0, ret;
+
+    if (!ext->posted)
+    {
+        return;
+    }
+    ret = PVFS_sys_wait(ext->op_id, "io", &error);
+    if (ret < 0)
+    {
+        error = ret;
+    }
+    PINT_sys_release(ext->op_id);
+    wbuf_complete(wb, ext, error);
+}
+
+/* sends the active extent on: up to its last stripe boundary if that
+ * leaves something to send and whole is not set, else all of it
+ */
+static void wbuf_post(struct PVFS_sys_wbuf_s *wb,
+                      const PVFS_credential *credential,
+                      int whole)
+{
+    struct wbuf_extent *ext = &wb->ext[wb->active];
+    struct wbuf_extent *next = &wb->ext[!wb->active];
+    PVFS_size len, end;
+    PVFS_error ret;
+
+    if (ext->len == 0)
+    {
+        return;
+    }
+
+    /* the other extent takes what is not sent, so it must be free */
+    wbuf_wait(wb);
+
+    len = ext->len;
+    if (!whole)
+    {
+        end = ext->offset + ext->len;
+        end -= end % wb->stripe;
+        if (end > ext->offset)
+        {
+            len = end - ext->offset;
+        }
+    }
+
+    next->offset = ext->offset + len;
+    next->len = ext->len - len;
+    next->first_ms = ext->first_ms;
+    if (next->len)
+    {
+        memcpy(next->data, ext->data + len, next->len);
+    }
+    wb->active = !wb->active;
+
+    memset(&ext->resp, 0, sizeof(ext->resp));
+    ret = PVFS_Request_contiguous(len, PVFS_BYTE, &ext->req);
+    if (ret < 0)
+    {
+        wbuf_set_error(wb, ret);
+        ext->len = 0;
+        return;
+    }
+    ext->posted = len;
+    ret = PVFS_isys_io(wb->ref, ext->req, ext->offset, ext->data, ext->req,
+                       credential, &ext->resp, PVFS_IO_WRITE, &ext->op_id,
+                       PVFS_HINT_NULL, NULL);
+    if (ret < 0)
+    {
+        wbuf_complete(wb, ext, ret);
+    }
+    else if (ret == 1 || ext->op_id == -1)
+    {
+        /* finished already */
+        wbuf_complete(wb, ext, 0);
+    }
+}
+
+/* returns the error a previous call left behind, and forgets it */
+static PVFS_error wbuf_take_error(struct PVFS_sys_wbuf_s *wb)
+{
+    PVFS_error error = wb->error;
+
+    wb->error = 0;
+    return error;
+}
+
+/** Sets up a write-behind buffer for a file.
+ *
+ *  \param size bytes each of its two extents may hold; rounded to a
+ *         multiple of the file's stripe
+ *  \param flush_msecs age after which buffered data is sent on by the
+ *         next write; 0 for no limit
+ */
+PVFS_error PVFS_sys_wbuf_open(PVFS_object_ref ref,
+                              PVFS_size size,
+                              int flush_msecs,
+                              const PVFS_credential *credential,
+                              PVFS_sys_wbuf *wbuf)
+{
+    struct PVFS_sys_wbuf_s *wb;
+    PVFS_sysresp_getattr resp;
+    PVFS_size stripe;
+    PVFS_error ret;
+    int i;
+
+    if (!wbuf || size <= 0 || flush_msecs < 0)
+    {
+        return -PVFS_EINVAL;
+    }
+    *wbuf = NULL;
+
+    memset(&resp, 0, sizeof(resp));
+    ret = PVFS_sys_getattr(ref, PVFS_ATTR_SYS_TYPE |
+                           PVFS_ATTR_SYS_DFILE_COUNT | PVFS_ATTR_SYS_BLKSIZE,
+                           credential, &resp, PVFS_HINT_NULL);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    if (resp.attr.objtype != PVFS_TYPE_METAFILE)
+    {
+        PVFS_util_release_sys_attr(&resp.attr);
+        return -PVFS_EINVAL;
+    }
+    stripe = resp.attr.blksize > 0 ? resp.attr.blksize : 1;
+    if (resp.attr.dfile_count > 0)
+    {
+        stripe *= resp.attr.dfile_count;
+    }
+    PVFS_util_release_sys_attr(&resp.attr);
+
+    wb = calloc(1, sizeof(*wb));
+    if (!wb)
+    {
+        return -PVFS_ENOMEM;
+    }
+    gen_mutex_init(&wb->mutex);
+    wb->ref = ref;
+    wb->stripe = stripe;
+    wb->size = ((size + stripe - 1) / stripe) * stripe;
+    wb->flush_msecs = flush_msecs;
+    for (i = 0; i < 2; i++)
+    {
+        wb->ext[i].op_id = -1;
+        wb->ext[i].data = malloc(wb->size);
+        if (!wb->ext[i].data)
+        {
+            free(wb->ext[0].data);
+            free(wb);
+            return -PVFS_ENOMEM;
+        }
+    }
+
+    gossip_debug(GOSSIP_CLIENT_DEBUG, "%s: %llu: %lld bytes, stripe %lld\n",
+                 __func__, llu(ref.handle), lld(wb->size), lld(stripe));
+    *wbuf = wb;
+    return 0;
+}
+
+/** Writes size bytes at offset through the buffer.
+ *
+ *  \return 0 when all of it was taken, or the error of an earlier write
+ *  through the buffer, in which case none of it was
+ */
+PVFS_error PVFS_sys_wbuf_write(PVFS_sys_wbuf wbuf,
+                               PVFS_offset offset,
+                               const void *buffer,
+                               PVFS_size size,
+                               const PVFS_credential *credential)
+{
+    struct PVFS_sys_wbuf_s *wb = wbuf;
+    struct wbuf_extent *ext;
+    const char *src = buffer;
+    PVFS_sysresp_io resp;
+    PVFS_Request req;
+    PVFS_size n;
+    PVFS_time now;
+    PVFS_error ret;
+
+    if (!wb || offset < 0 || size < 0 || (size && !buffer))
+    {
+        return -PVFS_EINVAL;
+    }
+
+    gen_mutex_lock(&wb->mutex);
+
+    wbuf_test(wb);
+    ret = wbuf_take_error(wb);
+    if (ret < 0)
+    {
+        gen_mutex_unlock(&wb->mutex);
+        return ret;
+    }
+
+    now = PINT_util_get_time_ms();
+    ext = &wb->ext[wb->active];
+    if (ext->len && wb->flush_msecs &&
+        now - ext->first_ms >= wb->flush_msecs)
+    {
+        wbuf_post(wb, credential, 1);
+    }
+
+    if (size > wb->size)
+    {
+        /* too big to gain anything: send it straight on, after what is
+         * buffered
+         */
+        wbuf_post(wb, credential, 1);
+        wbuf_wait(wb);
+        ret = PVFS_Request_contiguous(size, PVFS_BYTE, &req);
+        if (ret == 0)
+        {
+            memset(&resp, 0, sizeof(resp));
+            ret = PVFS_sys_write(wb->ref, req, offset, (void *)buffer, req,
+                                 credential, &resp, PVFS_HINT_NULL);
+            if (ret == 0 && resp.total_completed != size)
+            {
+                ret = -PVFS_EIO;
+            }
+            PVFS_Request_free(&req);
+        }
+        if (ret == 0)
+        {
+            ret = wbuf_take_error(wb);
+        }
+        gen_mutex_unlock(&wb->mutex);
+        return ret;
+    }
+
+    while (size > 0)
+    {
+        ext = &wb->ext[wb->active];
+        if (ext->len == 0)
+        {
+            ext->offset = offset;
+            ext->first_ms = now;
+        }
+        else if (offset < ext->offset || offset > ext->offset + ext->len)
+        {
+            /* not adjacent */
+            wbuf_post(wb, credential, 1);
+            continue;
+        }
+
+        n = ext->offset + wb->size - offset;
+        if (n == 0)
+        {
+            wbuf_post(wb, credential, 0);
+            continue;
+        }
+        if (n > size)
+        {
+            n = size;
+        }
+        memcpy(ext->data + (offset - ext->offset), src, n);
+        if (offset + n > ext->offset + ext->len)
+        {
+            ext->len = offset + n - ext->offset;
+        }
+        offset += n;
+        src += n;
+        size -= n;
+
+        if (ext->len == wb->size)
+        {
+            wbuf_post(wb, credential, 0);
+        }
+    }
+
+    gen_mutex_unlock(&wb->mutex);
+    return 0;
+}
+
+/** Sends everything buffered and waits for it to be written.
+ *
+ *  \return the first error of a write through the buffer since the last
+ *  call that returned one
+ */
+PVFS_error PVFS_sys_wbuf_flush(PVFS_sys_wbuf wbuf,
+                               const PVFS_credential *credential)
+{
+    struct PVFS_sys_wbuf_s *wb = wbuf;
+    PVFS_error ret;
+
+    if (!wb)
+    {
+        return -PVFS_EINVAL;
+    }
+
+    gen_mutex_lock(&wb->mutex);
+    wbuf_post(wb, credential, 1);
+    wbuf_wait(wb);
+    ret = wbuf_take_error(wb);
+    gen_mutex_unlock(&wb->mutex);
+    return ret;
+}
+
+/** Flushes the buffer and frees it.
+ */
+PVFS_error PVFS_sys_wbuf_close(PVFS_sys_wbuf wbuf,
+                               const PVFS_credential *credential)
+{
+    struct PVFS_sys_wbuf_s *wb = wbuf;
+    PVFS_error ret;
+
+    if (!wb)
+    {
+        return -PVFS_EINVAL;
+    }
+
+    ret = PVFS_sys_wbuf_flush(wb, credential);
+    gen_mutex_destroy(&wb->mutex);
+    free(wb->ext[0].data);
+    free(wb->ext[1].data);
+    free(wb);
+    return ret;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
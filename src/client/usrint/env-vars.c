@@ -15,7 +15,8 @@ const char * env_var_str_names[] = {
     "ORANGEFS_LAYOUT",
     "ORANGEFS_LAYOUT_SERVER_LIST",
     "ORANGEFS_CACHE_FILE",
-    "ORANGEFS_STRIP_SIZE_AS_BLKSIZE"
+    "ORANGEFS_STRIP_SIZE_AS_BLKSIZE",
+    "ORANGEFS_WRITE_BEHIND"
 };
 
 void env_vars_struct_initialize(struct orangefs_user_env_vars_s *env_vars_p)
@@ -5,7 +5,7 @@
 #ifndef PVFS_USER_ENV_VAR_H
 #define PVFS_USER_ENV_VAR_H
 
-#define ENV_VAR_ENUM_COUNT 7
+#define ENV_VAR_ENUM_COUNT 8
 enum orangefs_user_env_var {
     ORANGEFS_DIST_NAME,
     ORANGEFS_DIST_PARAMS,
@@ -13,7 +13,8 @@ enum orangefs_user_env_var {
     ORANGEFS_LAYOUT,
     ORANGEFS_LAYOUT_SERVER_LIST,
     ORANGEFS_CACHE_FILE,
-    ORANGEFS_STRIP_SIZE_AS_BLKSIZE
+    ORANGEFS_STRIP_SIZE_AS_BLKSIZE,
+    ORANGEFS_WRITE_BEHIND
 };
 
 struct orangefs_user_env_var_s
@@ -86,6 +86,11 @@ int iocommon_fsync(pvfs_descriptor *pd)
         }
     }
 #endif
+    rc = iocommon_wbuf_flush(pd);
+    if (rc != 0)
+    {
+        goto errorout;
+    }
     errno = 0;
     rc = PVFS_sys_flush(pd->s->pvfs_ref, credential, PVFS_HINT_NULL);
     IOCOMMON_CHECK_ERR(rc);
@@ -94,6 +99,206 @@ errorout:
     return rc;
 }
 
+/* Write-behind: with ORANGEFS_WRITE_BEHIND=<bytes>[:<msecs>] in the
+ * environment, small writes to a file opened for writing are gathered
+ * into a buffer of that size and sent in the background.  Data older
+ * than msecs is sent on the next write.  An error sending buffered
+ * data is returned by the next write, flush, fsync or close.
+ *
+ * A buffer lives in the process that opened the file; a forked child
+ * writes around the copy it inherited, which the parent flushes before
+ * the fork.  As with stdio, buffered data is lost across exec unless
+ * the file is fsynced or closed first.
+ */
+struct wbuf_entry
+{
+    struct qlist_head link;
+    pvfs_descriptor_status *s;
+};
+
+static QLIST_HEAD(wbuf_list);
+static gen_mutex_t wbuf_list_mutex = GEN_MUTEX_INITIALIZER;
+
+#if PVFS_USER_ENV_VARS_ENABLED
+static int wbuf_atexit = 0;
+
+static void iocommon_wbuf_exit(void)
+{
+    iocommon_wbuf_flush_all();
+}
+#endif
+
+/** Gives pd a write-behind buffer if it was asked for and suits the
+ *  way the file was opened.  Failing to get one is not an error.
+ */
+void iocommon_wbuf_open(pvfs_descriptor *pd)
+{
+#if PVFS_USER_ENV_VARS_ENABLED
+    const char *value = env_vars.env_var_array[ORANGEFS_WRITE_BEHIND].
+                        env_var_value;
+    PVFS_credential *credential;
+    struct wbuf_entry *we;
+    long long size;
+    int msecs = 0;
+    char *end;
+    int rc;
+
+    if (!value || !S_ISREG(pd->s->mode) ||
+        (pd->s->flags & O_ACCMODE) == O_RDONLY ||
+        (pd->s->flags & (O_APPEND | O_SYNC | O_DIRECT)))
+    {
+        return;
+    }
+#if PVFS_UCACHE_ENABLE
+    if (ucache_enabled && pd->s->fent)
+    {
+        /* the ucache already gathers this file's writes */
+        return;
+    }
+#endif
+    size = strtoll(value, &end, 0);
+    if (*end == ':')
+    {
+        msecs = strtol(end + 1, &end, 0);
+    }
+    if (size <= 0 || msecs < 0 || *end != '\0')
+    {
+        gossip_err("Ignoring bad ORANGEFS_WRITE_BEHIND value %s\n", value);
+        return;
+    }
+
+    we = malloc(sizeof(*we));
+    if (!we)
+    {
+        return;
+    }
+    if (iocommon_cred(&credential) != 0 ||
+        (rc = PVFS_sys_wbuf_open(pd->s->pvfs_ref, size, msecs,
+                                 credential, &pd->s->wbuf)) != 0)
+    {
+        gossip_debug(GOSSIP_USRINT_DEBUG,
+                     "iocommon_wbuf_open: no write-behind for %d\n", pd->fd);
+        pd->s->wbuf = NULL;
+        free(we);
+        return;
+    }
+    pd->s->wbuf_pid = getpid();
+
+    we->s = pd->s;
+    gen_mutex_lock(&wbuf_list_mutex);
+    qlist_add_tail(&we->link, &wbuf_list);
+    if (!wbuf_atexit)
+    {
+        atexit(iocommon_wbuf_exit);
+        wbuf_atexit = 1;
+    }
+    gen_mutex_unlock(&wbuf_list_mutex);
+#endif /* PVFS_USER_ENV_VARS_ENABLED */
+}
+
+/* returns pd's write-behind buffer if this process owns one */
+static PVFS_sys_wbuf iocommon_wbuf(pvfs_descriptor *pd)
+{
+    if (pd->s->wbuf && pd->s->wbuf_pid == getpid())
+    {
+        return pd->s->wbuf;
+    }
+    return NULL;
+}
+
+/** Sends whatever pd has buffered and waits for it.  Called before
+ *  anything that must see the data: reads, fsync, truncate, stat and
+ *  seeking from the end.
+ */
+int iocommon_wbuf_flush(pvfs_descriptor *pd)
+{
+    int rc = 0;
+    int orig_errno = errno;
+    PVFS_credential *credential;
+    PVFS_sys_wbuf wbuf = iocommon_wbuf(pd);
+
+    if (!wbuf)
+    {
+        return 0;
+    }
+    rc = iocommon_cred(&credential);
+    if (rc != 0)
+    {
+        goto errorout;
+    }
+    errno = 0;
+    rc = PVFS_sys_wbuf_flush(wbuf, credential);
+    IOCOMMON_CHECK_ERR(rc);
+
+errorout:
+    return rc;
+}
+
+/** Flushes and frees pd's write-behind buffer; called when the last
+ *  descriptor sharing its status closes.
+ */
+int iocommon_wbuf_close(pvfs_descriptor *pd)
+{
+    int rc = 0;
+    int orig_errno = errno;
+    PVFS_credential *credential;
+    PVFS_sys_wbuf wbuf = iocommon_wbuf(pd);
+    struct wbuf_entry *we, *tmp;
+
+    if (!wbuf)
+    {
+        /* a copy inherited over fork belongs to the parent */
+        pd->s->wbuf = NULL;
+        return 0;
+    }
+    rc = iocommon_cred(&credential);
+    if (rc != 0)
+    {
+        goto errorout;
+    }
+    pd->s->wbuf = NULL;
+
+    gen_mutex_lock(&wbuf_list_mutex);
+    qlist_for_each_entry_safe(we, tmp, &wbuf_list, link)
+    {
+        if (we->s == pd->s)
+        {
+            qlist_del(&we->link);
+            free(we);
+            break;
+        }
+    }
+    gen_mutex_unlock(&wbuf_list_mutex);
+
+    errno = 0;
+    rc = PVFS_sys_wbuf_close(wbuf, credential);
+    IOCOMMON_CHECK_ERR(rc);
+
+errorout:
+    return rc;
+}
+
+/** Flushes every write-behind buffer of this process, before a fork
+ *  and at exit.
+ */
+void iocommon_wbuf_flush_all(void)
+{
+    int orig_errno = errno;
+    PVFS_credential *credential;
+    struct wbuf_entry *we;
+
+    gen_mutex_lock(&wbuf_list_mutex);
+    if (!qlist_empty(&wbuf_list) && iocommon_cred(&credential) == 0)
+    {
+        qlist_for_each_entry(we, &wbuf_list, link)
+        {
+            PVFS_sys_wbuf_flush(we->s->wbuf, credential);
+        }
+    }
+    gen_mutex_unlock(&wbuf_list_mutex);
+    errno = orig_errno;
+}
+
 /**
  * Find the PVFS handle to an object (file, dir sym) 
  * assumes an absoluate path
@@ -1353,6 +1558,7 @@ finish:
     {
         pd->s->mode |= S_IFLNK;
     }
+    iocommon_wbuf_open(pd);
     /* ops below will lock if needed */
     gen_mutex_unlock(&pd->s->lock);
     gen_mutex_unlock(&pd->lock);
@@ -1462,6 +1668,11 @@ off64_t iocommon_lseek(pvfs_descriptor *pd, off64_t offset,
             PVFS_sysresp_getattr attributes_resp;
 
             memset(&attributes_resp, 0, sizeof(attributes_resp));
+            rc = iocommon_wbuf_flush(pd);
+            if (rc != 0)
+            {
+                goto errorout;
+            }
             rc = iocommon_cred(&credential);
             if (rc != 0)
             {
@@ -1480,6 +1691,43 @@ off64_t iocommon_lseek(pvfs_descriptor *pd, off64_t offset,
                                   (offset * unit_size);
             break;
         }
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+        case SEEK_DATA:
+        case SEEK_HOLE:
+        {
+            PVFS_credential *credential;
+            PVFS_sysresp_seek seek_resp;
+
+            if (S_ISDIR(pd->s->mode))
+            {
+                errno = EINVAL;
+                goto errorout;
+            }
+            rc = iocommon_wbuf_flush(pd);
+            if (rc != 0)
+            {
+                goto errorout;
+            }
+            rc = iocommon_cred(&credential);
+            if (rc != 0)
+            {
+                goto errorout;
+            }
+            /* The servers find the next data or hole in their datafiles */
+            errno = 0;
+            /* descriptor state mutex remains locked */
+            rc = PVFS_sys_seek(pd->s->pvfs_ref,
+                               offset * unit_size,
+                               (whence == SEEK_DATA) ?
+                                   PVFS_SEEK_DATA : PVFS_SEEK_HOLE,
+                               credential,
+                               &seek_resp,
+                               NULL);
+            IOCOMMON_CHECK_ERR(rc);
+            pd->s->file_pointer = seek_resp.offset;
+            break;
+        }
+#endif
         default:
         {
             errno = EINVAL;
@@ -2049,6 +2297,55 @@ unsigned char read_full_block_into_ucache(
 }
 #endif /* PVFS_UCACHE_ENABLE */
 
+/* reads or writes through pd's write-behind buffer */
+static int iocommon_wbuf_readorwrite(enum PVFS_io_type which,
+                                     pvfs_descriptor *pd,
+                                     PVFS_size offset,
+                                     size_t iovec_count,
+                                     const struct iovec *vector)
+{
+    int rc = 0;
+    int orig_errno = errno;
+    PVFS_credential *credential;
+    size_t i;
+
+    if (which == PVFS_IO_READ)
+    {
+        rc = iocommon_wbuf_flush(pd);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        errno = 0;
+        return iocommon_vreadorwrite(which,
+                                     &pd->s->pvfs_ref,
+                                     offset,
+                                     iovec_count,
+                                     vector);
+    }
+
+    rc = iocommon_cred(&credential);
+    if (rc != 0)
+    {
+        goto errorout;
+    }
+    errno = 0;
+    for (i = 0; i < iovec_count; i++)
+    {
+        rc = PVFS_sys_wbuf_write(pd->s->wbuf,
+                                 offset,
+                                 vector[i].iov_base,
+                                 vector[i].iov_len,
+                                 credential);
+        IOCOMMON_CHECK_ERR(rc);
+        offset += vector[i].iov_len;
+    }
+    return sum_iovec_lengths(iovec_count, vector);
+
+errorout:
+    return rc;
+}
+
 /** Do a blocking read or write, possibly utilizing the user cache.
  * Returns -1 on error, some positive value on success;
  */
@@ -2075,6 +2372,14 @@ int iocommon_readorwrite(enum PVFS_io_type which,
     {
 #endif /* PVFS_UCACHE_ENABLE */
         /* Bypass the ucache */
+        if (iocommon_wbuf(pd))
+        {
+            return iocommon_wbuf_readorwrite(which,
+                                             pd,
+                                             offset,
+                                             iovec_count,
+                                             vector);
+        }
         errno = 0;
         rc = iocommon_vreadorwrite(which,
                                    &pd->s->pvfs_ref,
@@ -2581,6 +2886,13 @@ int iocommon_ireadorwrite(enum PVFS_io_type which,
         return PVFS_FD_FAILURE;
     }
 
+    /* Buffered writes must reach the servers before this does */
+    rc = iocommon_wbuf_flush(pd);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
     /* Create the memory request of a contiguous region: 'mem_req' x count */
     rc = PVFS_Request_contiguous(count, etype_req, &contig_memory_req);
 
@@ -2711,6 +3023,8 @@ int iocommon_stat(pvfs_descriptor *pd, struct stat *buf, uint32_t mask)
     memset(&attr, 0, sizeof(attr));
     memset(buf, 0, sizeof(struct stat));
 
+    rc = iocommon_wbuf_flush(pd);
+    IOCOMMON_RETURN_ERR(rc);
     errno = 0;
     rc = iocommon_getattr(pd->s->pvfs_ref, &attr, mask);
     IOCOMMON_RETURN_ERR(rc);
@@ -2793,6 +3107,8 @@ int iocommon_stat64(pvfs_descriptor *pd, struct stat64 *buf, uint32_t mask)
     memset(&attr, 0, sizeof(attr));
     memset(buf, 0, sizeof(struct stat64));
 
+    rc = iocommon_wbuf_flush(pd);
+    IOCOMMON_RETURN_ERR(rc);
     errno = 0;
     rc = iocommon_getattr(pd->s->pvfs_ref, &attr, mask);
     IOCOMMON_RETURN_ERR(rc);
@@ -3084,6 +3400,50 @@ errorout:
     return(rc);
 }
 
+#ifdef _DIRENT_HAVE_D_TYPE
+#ifndef DT_UNKNOWN
+#define DT_UNKNOWN 0
+#endif
+/* the object type readdirplus returned for an entry, as a d_type */
+static unsigned char iocommon_dirent_type(PVFS_sysresp_readdirplus *resp,
+                                          int i)
+{
+    if (resp->stat_err_array[i] != 0 ||
+        !(resp->attr_array[i].mask & PVFS_ATTR_SYS_TYPE))
+    {
+        return DT_UNKNOWN;
+    }
+    switch (resp->attr_array[i].objtype)
+    {
+    case PVFS_TYPE_METAFILE:
+        return DT_REG;
+    case PVFS_TYPE_DIRECTORY:
+        return DT_DIR;
+    case PVFS_TYPE_SYMLINK:
+        return DT_LNK;
+    default:
+        return DT_UNKNOWN;
+    }
+}
+#endif
+
+/* release what readdirplus allocated in resp */
+static void iocommon_readdirplus_release(PVFS_sysresp_readdirplus *resp)
+{
+    int i;
+
+    if (resp->attr_array)
+    {
+        for (i = 0; i < resp->pvfs_dirent_outcount; i++)
+        {
+            PVFS_util_release_sys_attr(&resp->attr_array[i]);
+        }
+        free(resp->attr_array);
+    }
+    free(resp->stat_err_array);
+    free(resp->dirent_array);
+}
+
 int iocommon_getdents(pvfs_descriptor *pd, /**< pvfs fiel descriptor */
                       struct dirent *dirp, /**< pointer to buffer */
                       unsigned int size)   /**< number of bytes in buffer */
@@ -3093,7 +3453,7 @@ int iocommon_getdents(pvfs_descriptor *pd, /**< pvfs fiel descriptor */
     int name_max;
     int count;  /* number of records to read */
     PVFS_credential *credential;
-    PVFS_sysresp_readdir readdir_resp;
+    PVFS_sysresp_readdirplus readdir_resp;
     PVFS_ds_position token;
     int bytes = 0, i = 0;
 
@@ -3130,18 +3490,22 @@ int iocommon_getdents(pvfs_descriptor *pd, /**< pvfs fiel descriptor */
     /* posix deals in bytes in buffer and bytes read */
     /* PVFS deals in number of records to read or were read */
     count = size / sizeof(struct dirent);
-    if (count > PVFS_REQ_LIMIT_DIRENT_COUNT)
+    if (count > PVFS_REQ_LIMIT_DIRENT_COUNT_READDIRPLUS)
     {
-        count = PVFS_REQ_LIMIT_DIRENT_COUNT;
+        count = PVFS_REQ_LIMIT_DIRENT_COUNT_READDIRPLUS;
     }
     errno = 0;
     /* descrpitor state mutex remains locked */
-    rc = PVFS_sys_readdir(pd->s->pvfs_ref,
-                          token,
-                          count,
-                          credential,
-                          &readdir_resp,
-                          NULL);
+    /* readdirplus returns the entry types with the names, so callers
+     * such as fts and glob can skip a stat per entry
+     */
+    rc = PVFS_sys_readdirplus(pd->s->pvfs_ref,
+                              token,
+                              count,
+                              credential,
+                              PVFS_ATTR_SYS_TYPE,
+                              &readdir_resp,
+                              NULL);
     IOCOMMON_CHECK_ERR(rc);
 
     pd->s->token = readdir_resp.token;
@@ -3157,10 +3521,7 @@ int iocommon_getdents(pvfs_descriptor *pd, /**< pvfs fiel descriptor */
         dirp->d_reclen = sizeof(struct dirent);
 #endif
 #ifdef _DIRENT_HAVE_D_TYPE
-#ifndef DT_UNKNOWN
-#define DT_UNKNOWN 0
-#endif
-        dirp->d_type = DT_UNKNOWN;
+        dirp->d_type = iocommon_dirent_type(&readdir_resp, i);
 #endif
         strncpy(dirp->d_name, readdir_resp.dirent_array[i].d_name, name_max);
         dirp->d_name[name_max] = 0;
@@ -3169,7 +3530,7 @@ int iocommon_getdents(pvfs_descriptor *pd, /**< pvfs fiel descriptor */
         dirp++;
     }
     gen_mutex_unlock(&pd->s->lock);
-    free(readdir_resp.dirent_array);
+    iocommon_readdirplus_release(&readdir_resp);
     return bytes;
 
 errorout:
@@ -3186,7 +3547,7 @@ int iocommon_getdents64(pvfs_descriptor *pd,
     int name_max;
     int count;
     PVFS_credential *credential;
-    PVFS_sysresp_readdir readdir_resp;
+    PVFS_sysresp_readdirplus readdir_resp;
     PVFS_ds_position token;
     int bytes = 0, i = 0;
 
@@ -3221,18 +3582,22 @@ int iocommon_getdents64(pvfs_descriptor *pd,
     /* clear the output buffer */
     memset(dirp, 0, size);
     count = size / sizeof(struct dirent64);
-    if (count > PVFS_REQ_LIMIT_DIRENT_COUNT)
+    if (count > PVFS_REQ_LIMIT_DIRENT_COUNT_READDIRPLUS)
     {
-        count = PVFS_REQ_LIMIT_DIRENT_COUNT;
+        count = PVFS_REQ_LIMIT_DIRENT_COUNT_READDIRPLUS;
     }
     errno = 0;
     /* descrpitor state mutex remains locked */
-    rc = PVFS_sys_readdir(pd->s->pvfs_ref,
-                          token,
-                          count,
-                          credential,
-                          &readdir_resp,
-                          NULL);
+    /* readdirplus returns the entry types with the names, so callers
+     * such as fts and glob can skip a stat per entry
+     */
+    rc = PVFS_sys_readdirplus(pd->s->pvfs_ref,
+                              token,
+                              count,
+                              credential,
+                              PVFS_ATTR_SYS_TYPE,
+                              &readdir_resp,
+                              NULL);
     IOCOMMON_CHECK_ERR(rc);
 
     pd->s->token = readdir_resp.token;
@@ -3248,10 +3613,7 @@ int iocommon_getdents64(pvfs_descriptor *pd,
         dirp->d_reclen = sizeof(struct dirent64);
 #endif
 #ifdef _DIRENT_HAVE_D_TYPE
-#ifndef DT_UNKNOWN
-#define DT_UNKNOWN 0
-#endif
-        dirp->d_type = DT_UNKNOWN;
+        dirp->d_type = iocommon_dirent_type(&readdir_resp, i);
 #endif
         strncpy(dirp->d_name, readdir_resp.dirent_array[i].d_name, name_max);
         dirp->d_name[name_max] = 0;
@@ -3260,7 +3622,7 @@ int iocommon_getdents64(pvfs_descriptor *pd,
         dirp++;
     }
     gen_mutex_unlock(&pd->s->lock);
-    free(readdir_resp.dirent_array);
+    iocommon_readdirplus_release(&readdir_resp);
     return bytes;
 
 errorout:
@@ -3498,6 +3860,10 @@ int iocommon_sendfile(int sockfd, pvfs_descriptor *pd,
         errno = EBADF;
         return -1;
     }
+    if (iocommon_wbuf_flush(pd) != 0)
+    {
+        return -1;
+    }
     buffer = (char *)malloc(buffer_size);
 
     PVFS_Request_contiguous(buffer_size, PVFS_BYTE, &mem_req);
@@ -83,6 +83,14 @@ unsigned char read_full_block_into_ucache( pvfs_descriptor *pd,
 
 extern int iocommon_fsync(pvfs_descriptor *pvfs_info);
 
+extern void iocommon_wbuf_open(pvfs_descriptor *pd);
+
+extern int iocommon_wbuf_flush(pvfs_descriptor *pd);
+
+extern int iocommon_wbuf_close(pvfs_descriptor *pd);
+
+extern void iocommon_wbuf_flush_all(void);
+
 int iocommon_expand_path (PVFS_path_t *Ppath,
                           int follow_flag, 
                           int flags,
@@ -1196,6 +1196,8 @@ static int init_usrint_internal(void)
 static void parent_fork_begin(void)
 {
     init_debug("Parent preparing to fork\n");
+    /* the child must not see data still waiting in our buffers */
+    iocommon_wbuf_flush_all();
     gen_mutex_lock(&shmctrl->shmctrl_lock);
     shmctrl->shmctrl_copy = 1;
     gen_mutex_unlock(&shmctrl->shmctrl_lock);
@@ -1770,6 +1772,8 @@ static void rebuild_descriptor_table(pvfs_desc_list_t *shmpdl)
                 /* need to decide how to update this correctly */
                 scp->descriptor_table[d]->s->fent = NULL;
             }
+            /* write-behind buffers do not survive exec */
+            scp->descriptor_table[d]->s->wbuf = NULL;
         }
     }
 
@@ -2149,6 +2153,7 @@ static pvfs_descriptor *get_desc_table_entry(int newfd,
     /* these should be filled in by caller as needed */
     pd->s->dpath = NULL;
     pd->s->fent = NULL; /* not caching if left NULL */
+    pd->s->wbuf = NULL; /* set by iocommon_open if wanted */
     pd->s->flags = 0;
     pd->s->mode = 0;
     pd->s->mode_deferred = 0;
@@ -2379,6 +2384,7 @@ pvfs_descriptor *pvfs_find_descriptor(int fd)
 	    pd->s->file_pointer = 0;
 	    pd->s->token = 0;
         pd->s->fent = NULL; /* not caching if left NULL */
+        pd->s->wbuf = NULL;
         gen_mutex_unlock(&pd->s->lock);
     }
     else
@@ -2403,6 +2409,8 @@ pvfs_descriptor *pvfs_find_descriptor(int fd)
 int pvfs_free_descriptor(int fd)
 {
     int dup_cnt;
+    int ret;
+    int wbuf_errno = 0;
     pvfs_descriptor *pd = NULL;
     gossip_debug(GOSSIP_USRINT_DEBUG,
                  "pvfs_free_descriptor called with %d\n", fd);
@@ -2433,6 +2441,21 @@ int pvfs_free_descriptor(int fd)
     /* descrement dup count */
     dup_cnt = --(pd->s->dup_cnt);
 
+    /* send any buffered writes, like close does on NFS; a failure is
+     * reported by close once the descriptor is gone anyway */
+    if (dup_cnt <= 0)
+    {
+        ret = iocommon_wbuf_close(pd);
+    }
+    else
+    {
+        ret = iocommon_wbuf_flush(pd);
+    }
+    if (ret < 0)
+    {
+        wbuf_errno = errno ? errno : EIO;
+    }
+
     /* if not sharing, see if last dup */
     if (dup_cnt <= 0 && !pd->shared_status)
     {
@@ -2500,6 +2523,13 @@ int pvfs_free_descriptor(int fd)
     gen_mutex_unlock(&pd->lock);
     put_descriptor(pd);
 
+    if (wbuf_errno)
+    {
+        errno = wbuf_errno;
+        gossip_debug(GOSSIP_USRINT_DEBUG,
+                     "\tpvfs_free_descriptor returns %d\n", -1);
+        return -1;
+    }
     gossip_debug(GOSSIP_USRINT_DEBUG, "\tpvfs_free_descriptor returns %d\n", 0);
 	return 0;
 }
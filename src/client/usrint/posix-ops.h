@@ -216,6 +216,8 @@ typedef struct pvfs_descriptor_status_s
     char *dpath;              /**< path of an open directory for fchdir */
     struct file_ent_s *fent;  /**< reference to cached objects */            
                               /**< set to NULL if not caching this file */
+    PVFS_sys_wbuf wbuf;       /**< write-behind buffer, NULL if none */
+    pid_t wbuf_pid;           /**< process the write-behind buffer is in */
 } pvfs_descriptor_status;
 
 /* bit flags used only in pvfs_descriptor_status clrflags */
@@ -927,6 +927,10 @@ int pvfs_ftruncate64(int fd, off64_t length)
     {
         return -1;
     }
+    if (iocommon_wbuf_flush(pd) != 0)
+    {
+        return -1;
+    }
     return iocommon_truncate(pd->s->pvfs_ref, length);
 }
 
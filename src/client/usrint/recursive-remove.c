@@ -4,7 +4,9 @@
  * See COPYING in top-level directory.
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -12,13 +14,26 @@
 #include <usrint.h>
 #include <posix-pvfs.h>
 #include <gossip.h>
+#include <openfile-util.h>
+#include <iocommon.h>
+#include <pvfs-path.h>
 #include <recursive-remove.h>
 #include <str-utils.h>
 
+static int recursive_delete_dir_serial(char *dir);
+
 /* Recursively delete the absolute path "dir".
  * Returns 0 on success, -1 on failure.
  */
 int recursive_delete_dir(char *dir)
+{
+    return recursive_delete_dir_parallel(dir, RR_DEFAULT_PARALLELISM);
+}
+
+/* Recursively delete "dir" one POSIX call at a time.  Used for paths
+ * that are not in PVFS and when no parallelism is asked for.
+ */
+static int recursive_delete_dir_serial(char *dir)
 {
     int ret = -1;
     DIR * dirp = NULL;
@@ -84,7 +99,7 @@ int recursive_delete_dir(char *dir)
         }
         if(S_ISDIR(buf.st_mode))
         {
-            ret = recursive_delete_dir(abs_path);
+            ret = recursive_delete_dir_serial(abs_path);
             if(ret < 0)
             {
                 RR_ERROR("recursive_delete_dir failed on path:%s\n", abs_path);
@@ -178,3 +193,555 @@ int remove_files_in_dir(char *dir, DIR* dirp)
     }
     return 0;
 }
+
+/* Parallel removal
+ *
+ * recursive_delete_dir_parallel() walks the tree with the nonblocking
+ * system interface instead of the POSIX calls above.  Directories are
+ * listed with readdirplus, which returns the type of each entry, so no
+ * entry is stat'ed on its own.  The non-directories of each batch of
+ * entries are removed with one PVFS_isys_remove_list, which groups them
+ * into batch remove requests per server.  A directory is removed once it
+ * has been listed and everything under it is gone.  Up to "parallelism"
+ * operations are kept in flight at a time.
+ */
+
+/* no more than PVFS_sys_testsome returns at once */
+#define RR_MAX_PARALLELISM 256
+/* times a directory is listed again when its rmdir finds entries that
+ * were added (or listed past) while it was being emptied
+ */
+#define RR_MAX_RELIST 4
+
+struct rr_dir
+{
+    PVFS_object_ref ref;
+    PVFS_object_ref parent_ref;
+    char *name;                 /* entry name in the parent */
+    char *path;                 /* for messages */
+    struct rr_dir *parent;      /* NULL for the top directory */
+    PVFS_ds_position token;
+    int pending;                /* ops, listing and subdirectories left */
+    int relist;
+    int failed;                 /* something below could not be removed */
+};
+
+enum rr_op_type
+{
+    RR_OP_LIST,
+    RR_OP_REMOVE_LIST,
+    RR_OP_RMDIR
+};
+
+struct rr_op
+{
+    enum rr_op_type type;
+    struct rr_dir *dir;
+    PVFS_sys_op_id op_id;
+    PVFS_sysresp_readdirplus resp;  /* names of a remove list live here */
+    int count;
+    char **names;
+    PVFS_handle *handles;
+    PVFS_error *errors;
+    struct rr_op *next;
+};
+
+struct rr_state
+{
+    PVFS_credential *credential;
+    int parallelism;
+    int inflight;
+    struct rr_op *ops[RR_MAX_PARALLELISM];
+    struct rr_op *queue;        /* waiting for a slot, newest first */
+    PVFS_error error;           /* first error seen */
+    int done;
+};
+
+static void rr_dir_check(struct rr_state *st, struct rr_dir *dir);
+
+static void rr_error(struct rr_state *st, const char *path,
+                     const char *name, PVFS_error err)
+{
+    RR_ERROR("cannot remove '%s%s%s': %s\n", path, name ? "/" : "",
+             name ? name : "", strerror(PVFS_ERROR_TO_ERRNO(err)));
+    if (!st->error)
+    {
+        st->error = err;
+    }
+}
+
+static struct rr_op *rr_op_new(struct rr_state *st,
+                               enum rr_op_type type,
+                               struct rr_dir *dir)
+{
+    struct rr_op *op;
+
+    op = calloc(1, sizeof(*op));
+    if (!op)
+    {
+        return NULL;
+    }
+    op->type = type;
+    op->dir = dir;
+    op->op_id = -1;
+    dir->pending++;
+
+    /* newest first keeps the walk close to depth first, which bounds
+     * the number of directories waiting to be listed
+     */
+    op->next = st->queue;
+    st->queue = op;
+    return op;
+}
+
+static void rr_op_free(struct rr_op *op)
+{
+    int i;
+
+    if (op->resp.attr_array)
+    {
+        for (i = 0; i < op->resp.pvfs_dirent_outcount; i++)
+        {
+            PVFS_util_release_sys_attr(&op->resp.attr_array[i]);
+        }
+        free(op->resp.attr_array);
+    }
+    free(op->resp.stat_err_array);
+    free(op->resp.dirent_array);
+    free(op->names);
+    free(op->handles);
+    free(op->errors);
+    free(op);
+}
+
+static void rr_dir_free(struct rr_dir *dir)
+{
+    free(dir->name);
+    free(dir->path);
+    free(dir);
+}
+
+/* queue a listing of dir from its current token */
+static void rr_list(struct rr_state *st, struct rr_dir *dir)
+{
+    if (!rr_op_new(st, RR_OP_LIST, dir))
+    {
+        rr_error(st, dir->path, NULL, -PVFS_ENOMEM);
+        dir->failed = 1;
+    }
+}
+
+static struct rr_dir *rr_dir_new(struct rr_state *st,
+                                 struct rr_dir *parent,
+                                 const char *name,
+                                 PVFS_handle handle)
+{
+    struct rr_dir *dir;
+
+    dir = calloc(1, sizeof(*dir));
+    if (!dir)
+    {
+        return NULL;
+    }
+    dir->name = strdup(name);
+    dir->path = malloc(strlen(parent->path) + strlen(name) + 2);
+    if (!dir->name || !dir->path)
+    {
+        rr_dir_free(dir);
+        return NULL;
+    }
+    sprintf(dir->path, "%s/%s", parent->path, name);
+    dir->ref.handle = handle;
+    dir->ref.fs_id = parent->ref.fs_id;
+    dir->parent_ref = parent->ref;
+    dir->parent = parent;
+    dir->token = PVFS_READDIR_START;
+    parent->pending++;
+    rr_list(st, dir);
+    return dir;
+}
+
+/* a directory is done: let its parent know */
+static void rr_dir_finish(struct rr_state *st, struct rr_dir *dir)
+{
+    struct rr_dir *parent = dir->parent;
+
+    if (dir->failed && parent)
+    {
+        parent->failed = 1;
+    }
+    rr_dir_free(dir);
+    if (!parent)
+    {
+        st->done = 1;
+        return;
+    }
+    parent->pending--;
+    rr_dir_check(st, parent);
+}
+
+/* once a directory has nothing left in progress, remove it */
+static void rr_dir_check(struct rr_state *st, struct rr_dir *dir)
+{
+    if (dir->pending)
+    {
+        return;
+    }
+    if (dir->failed)
+    {
+        /* the entries left are reported already; keep the directory */
+        rr_dir_finish(st, dir);
+    }
+    else if (!rr_op_new(st, RR_OP_RMDIR, dir))
+    {
+        rr_error(st, dir->path, NULL, -PVFS_ENOMEM);
+        dir->failed = 1;
+        rr_dir_finish(st, dir);
+    }
+}
+
+static void rr_list_done(struct rr_state *st, struct rr_op *op,
+                         PVFS_error err)
+{
+    struct rr_dir *dir = op->dir;
+    PVFS_sysresp_readdirplus *resp = &op->resp;
+    struct rr_op *rm_op = NULL;
+    int i, ndirs = 0;
+    int outcount = resp->pvfs_dirent_outcount;
+
+    if (err)
+    {
+        rr_error(st, dir->path, NULL, err);
+        dir->failed = 1;
+        rr_op_free(op);
+        dir->pending--;
+        rr_dir_check(st, dir);
+        return;
+    }
+
+    dir->token = resp->token;
+    for (i = 0; i < resp->pvfs_dirent_outcount; i++)
+    {
+        if (resp->stat_err_array[i] == 0 &&
+            resp->attr_array[i].objtype == PVFS_TYPE_DIRECTORY)
+        {
+            if (!rr_dir_new(st, dir, resp->dirent_array[i].d_name,
+                            resp->dirent_array[i].handle))
+            {
+                rr_error(st, dir->path, resp->dirent_array[i].d_name,
+                         -PVFS_ENOMEM);
+                dir->failed = 1;
+            }
+            ndirs++;
+        }
+    }
+
+    /* everything else goes in one remove list, which takes over the
+     * response for its names
+     */
+    if (outcount > ndirs)
+    {
+        rm_op = rr_op_new(st, RR_OP_REMOVE_LIST, dir);
+        if (rm_op)
+        {
+            rm_op->resp = *resp;
+            memset(resp, 0, sizeof(*resp));
+            i = outcount - ndirs;
+            rm_op->names = malloc(i * sizeof(char *));
+            rm_op->handles = malloc(i * sizeof(PVFS_handle));
+            rm_op->errors = malloc(i * sizeof(PVFS_error));
+        }
+        if (!rm_op || !rm_op->names || !rm_op->handles || !rm_op->errors)
+        {
+            /* an allocated op is posted with no entries, a no-op */
+            rr_error(st, dir->path, NULL, -PVFS_ENOMEM);
+            dir->failed = 1;
+        }
+        else
+        {
+            for (i = 0; i < outcount; i++)
+            {
+                if (rm_op->resp.stat_err_array[i] == 0 &&
+                    rm_op->resp.attr_array[i].objtype ==
+                    PVFS_TYPE_DIRECTORY)
+                {
+                    continue;
+                }
+                rm_op->names[rm_op->count] =
+                    rm_op->resp.dirent_array[i].d_name;
+                rm_op->handles[rm_op->count] =
+                    rm_op->resp.dirent_array[i].handle;
+                rm_op->count++;
+            }
+        }
+    }
+
+    if (outcount == 0)
+    {
+        dir->token = PVFS_READDIR_END;
+    }
+    rr_op_free(op);
+
+    /* the next batch keeps the listing pending */
+    if (dir->token != PVFS_READDIR_END && !dir->failed)
+    {
+        rr_list(st, dir);
+    }
+    dir->pending--;
+    rr_dir_check(st, dir);
+}
+
+static void rr_remove_list_done(struct rr_state *st, struct rr_op *op,
+                                PVFS_error err)
+{
+    struct rr_dir *dir = op->dir;
+    int i, reported = 0;
+
+    for (i = 0; i < op->count; i++)
+    {
+        if (op->errors[i] == -PVFS_EISDIR)
+        {
+            /* its type was not known when it was listed */
+            if (!rr_dir_new(st, dir, op->names[i], op->handles[i]))
+            {
+                rr_error(st, dir->path, op->names[i], -PVFS_ENOMEM);
+                dir->failed = 1;
+            }
+        }
+        else if (op->errors[i] && op->errors[i] != -PVFS_ENOENT)
+        {
+            rr_error(st, dir->path, op->names[i], op->errors[i]);
+            dir->failed = 1;
+            reported = 1;
+        }
+    }
+    if (err && err != -PVFS_EISDIR && err != -PVFS_ENOENT && !reported)
+    {
+        rr_error(st, dir->path, NULL, err);
+        dir->failed = 1;
+    }
+    rr_op_free(op);
+    dir->pending--;
+    rr_dir_check(st, dir);
+}
+
+static void rr_rmdir_done(struct rr_state *st, struct rr_op *op,
+                          PVFS_error err)
+{
+    struct rr_dir *dir = op->dir;
+
+    rr_op_free(op);
+    dir->pending--;
+    if (err == -PVFS_ENOTEMPTY && dir->relist < RR_MAX_RELIST)
+    {
+        dir->relist++;
+        dir->token = PVFS_READDIR_START;
+        rr_list(st, dir);
+        rr_dir_check(st, dir);
+        return;
+    }
+    if (err && err != -PVFS_ENOENT)
+    {
+        rr_error(st, dir->path, NULL, err);
+        dir->failed = 1;
+    }
+    rr_dir_finish(st, dir);
+}
+
+static void rr_done(struct rr_state *st, struct rr_op *op, PVFS_error err)
+{
+    switch (op->type)
+    {
+    case RR_OP_LIST:
+        rr_list_done(st, op, err);
+        break;
+    case RR_OP_REMOVE_LIST:
+        rr_remove_list_done(st, op, err);
+        break;
+    case RR_OP_RMDIR:
+        rr_rmdir_done(st, op, err);
+        break;
+    }
+}
+
+/* post op, or finish it here if it completes at once */
+static void rr_post(struct rr_state *st, struct rr_op *op)
+{
+    PVFS_error ret = -PVFS_EINVAL;
+
+    op->op_id = -1;
+    switch (op->type)
+    {
+    case RR_OP_LIST:
+        ret = PVFS_isys_readdirplus(op->dir->ref, op->dir->token,
+                                    PVFS_REQ_LIMIT_DIRENT_COUNT_READDIRPLUS,
+                                    st->credential, PVFS_ATTR_SYS_TYPE,
+                                    &op->resp, &op->op_id, NULL, op);
+        break;
+    case RR_OP_REMOVE_LIST:
+        ret = 0;
+        if (op->count > 0)
+        {
+            ret = PVFS_isys_remove_list(op->dir->ref, op->count, op->names,
+                                        st->credential, op->errors,
+                                        &op->op_id, NULL, op);
+        }
+        break;
+    case RR_OP_RMDIR:
+        ret = PVFS_isys_remove(op->dir->name, op->dir->parent_ref,
+                               st->credential, &op->op_id, NULL, op);
+        break;
+    }
+    if (ret < 0 || op->op_id == -1)
+    {
+        rr_done(st, op, ret);
+        return;
+    }
+    st->ops[st->inflight++] = op;
+}
+
+/* Recursively delete "dir" with up to "parallelism" nonblocking
+ * operations in flight.  Returns 0 on success, -1 with errno set on
+ * failure, after removing everything else it could.
+ */
+int recursive_delete_dir_parallel(char *dir, int parallelism)
+{
+    int ret = -1;
+    int i, j, count;
+    char *path = NULL;
+    char *filename = NULL;
+    struct rr_state *st = NULL;
+    struct rr_dir *top = NULL;
+    PVFS_object_ref parent_ref;
+    PVFS_sys_attr attr;
+    PVFS_sys_op_id ids[RR_MAX_PARALLELISM];
+    void *user_ptrs[RR_MAX_PARALLELISM];
+    int errors[RR_MAX_PARALLELISM];
+
+    RR_PFI();
+    if (parallelism <= 1)
+    {
+        return recursive_delete_dir_serial(dir);
+    }
+    if (parallelism > RR_MAX_PARALLELISM)
+    {
+        parallelism = RR_MAX_PARALLELISM;
+    }
+
+    PVFS_INIT(pvfs_sys_init);
+    path = PVFS_qualify_path(dir);
+    if (!path)
+    {
+        return -1;
+    }
+    st = calloc(1, sizeof(*st));
+    top = calloc(1, sizeof(*top));
+    if (!st || !top)
+    {
+        errno = ENOMEM;
+        goto out;
+    }
+    st->parallelism = parallelism;
+    if (iocommon_cred(&st->credential) != 0)
+    {
+        goto out;
+    }
+    memset(&parent_ref, 0, sizeof(parent_ref));
+    if (iocommon_lookup(path, PVFS2_LOOKUP_LINK_NO_FOLLOW, &parent_ref,
+                        &top->ref, &filename, NULL) < 0)
+    {
+        /* not a PVFS path, or one the POSIX calls report better */
+        errno = 0;
+        ret = recursive_delete_dir_serial(dir);
+        goto out;
+    }
+    memset(&attr, 0, sizeof(attr));
+    if (iocommon_getattr(top->ref, &attr, PVFS_ATTR_SYS_TYPE) < 0)
+    {
+        goto out;
+    }
+    if (attr.objtype != PVFS_TYPE_DIRECTORY)
+    {
+        errno = ENOTDIR;
+        goto out;
+    }
+    top->parent_ref = parent_ref;
+    top->name = filename;
+    top->path = strdup(dir);
+    filename = NULL;
+    if (!top->path)
+    {
+        errno = ENOMEM;
+        goto out;
+    }
+    top->token = PVFS_READDIR_START;
+    rr_list(st, top);
+    rr_dir_check(st, top);
+    top = NULL;     /* freed by the walk */
+
+    while (!st->done)
+    {
+        while (st->queue && st->inflight < st->parallelism)
+        {
+            struct rr_op *op = st->queue;
+
+            st->queue = op->next;
+            rr_post(st, op);
+        }
+        if (st->done)
+        {
+            break;
+        }
+        /* every directory waits on an op, so this cannot be empty */
+        assert(st->inflight > 0);
+
+        for (i = 0; i < st->inflight; i++)
+        {
+            ids[i] = st->ops[i]->op_id;
+        }
+        count = st->inflight;
+        ret = PVFS_sys_testsome(ids, &count, user_ptrs, errors, 100);
+        if (ret < 0)
+        {
+            /* the ops left in flight cannot be finished */
+            rr_error(st, dir, NULL, ret);
+            break;
+        }
+        for (i = 0; i < count; i++)
+        {
+            /* skip anything else this process had going */
+            for (j = 0; j < st->inflight; j++)
+            {
+                if (st->ops[j] == user_ptrs[i])
+                {
+                    st->ops[j] = st->ops[--st->inflight];
+                    rr_done(st, user_ptrs[i], errors[i]);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (st->error)
+    {
+        errno = PVFS_ERROR_TO_ERRNO(st->error);
+        ret = -1;
+    }
+    else
+    {
+        ret = 0;
+    }
+
+out:
+    if (top)
+    {
+        rr_dir_free(top);
+    }
+    free(st);
+    free(filename);
+    if (path != dir)
+    {
+        PVFS_free_expanded(path);
+    }
+    return ret;
+}
@@ -64,7 +64,11 @@
  #define RR_PERROR(message) do {} while(0)
 #endif
 
+/* operations recursive_delete_dir() keeps in flight */
+#define RR_DEFAULT_PARALLELISM 32
+
 int recursive_delete_dir(char *dir);
+int recursive_delete_dir_parallel(char *dir, int parallelism);
 int remove_files_in_dir(char *dir, DIR* dirp);
 
 #endif
@@ -59,6 +59,10 @@ char pass[100];
  */
 #define READBUFSIZE 1048576
 #define KEYBUFSIZ 256
+/* WALKBATCH = how many directory entries dav_orangefs_walk reads (with
+               their attributes) and checks for locknull at a time...
+ */
+#define WALKBATCH 60
 /* these are reserved property names, code in dav_orangefs_propdb_store
    won't let you set them with PROPPATCH. */
 #define DAVLOCK_PROPERTY "orangefs_lock"
@@ -121,6 +125,7 @@ struct dav_resource_private {
   int removeWalk;
   int copyWalk;
   int locknull;
+  int sizeKnown;
   char *mountPoint;
   char *Uri;
   char *DirName;
@@ -176,6 +181,9 @@ int getLockHelper(dav_lock **, char *, const dav_resource *);
 void lockStringToParts(char *, int, char **, time_t *, int *, char **);
 static int are_they_the_same(const dav_resource *, const dav_resource *);
 void dirnameBasename(char *, char *, char *);
+void direntStatAttrs(dav_resource_private *, char *, PVFS_object_ref,
+                     PVFS_handle, PVFS_sys_attr *, int, apr_pool_t *);
+void freeReaddirplus(PVFS_sysresp_readdirplus *);
 int orangeRead(PVFS_object_ref *, PVFS_credential *, char *, 
                void *, int64_t, int64_t);
 int orangeWrite(const void *, apr_size_t, apr_pool_t *, 
@@ -1407,10 +1415,17 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
 {                              
   dav_walk_resource walkResource = { 0 };  
   dav_error *err = NULL;
-  PVFS_sysresp_readdir resp_readdir;
+  PVFS_sysresp_readdirplus resp_readdir;
+  PVFS_sysresp_geteattr resp_locknull;
+  PVFS_handle locknull_handles[WALKBATCH];
+  PVFS_ds_keyval locknull_key;
+  PVFS_ds_keyval locknull_val[WALKBATCH];
+  PVFS_error locknull_err[WALKBATCH];
+  char locknull_buf[WALKBATCH][KEYBUFSIZ];
+  char keyName[KEYBUFSIZ];
   PVFS_ds_position token;
   int pvfs_dirent_incount;
-  int max_dirents_returned=25;
+  int max_dirents_returned=WALKBATCH;
   int rc, i=0;
   char *newResource;
   dav_walk_params newParams = { 0 };
@@ -1511,26 +1526,40 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
      any directories...
 
      We decide (max_dirents_returned) how many objects (file/dir names)
-     PVFS_sys_readdir will return each time it is called, and PVFS_sys_readdir
-     communicates via resp_readdir.token which is both a cursor into
-     the enumeration of file/dir names and a flag that lets us know when
-     we're done.
+     PVFS_sys_readdirplus will return each time it is called, and 
+     PVFS_sys_readdirplus communicates via resp_readdir.token which is both 
+     a cursor into the enumeration of file/dir names and a flag that lets 
+     us know when we're done.
+
+     PVFS_sys_readdirplus hands back each object's attributes along with
+     its name, and one PVFS_sys_geteattr_bulk per batch tells us which
+     objects are locknull resources, so we don't have to visit the servers
+     with an orangeAttrs "stat" (a lookup, a couple of getattrs and a 
+     geteattr) for every object in the directory. Size is included, so
+     getcontentlength won't need its own "get size" stat either.
 
      walkResource's value changes with each file/directory that we encounter,
-     but the ref argument to PVFS_sys_readdir needs to remain constant
+     but the ref argument to PVFS_sys_readdirplus needs to remain constant
      while we enumerate a directory's contents...
   */
   pvfs_dirent_incount = max_dirents_returned;
   token=0;
   readDir_ref.handle = (PVFS_handle)walkResource.resource->info->ref->handle;
   readDir_ref.fs_id = (PVFS_fs_id)walkResource.resource->info->ref->fs_id;
+
+  memset(keyName,0,KEYBUFSIZ);
+  strcpy(keyName,"user.pvfs2.");
+  strcat(keyName,LOCKNULL_PROPERTY);
+  locknull_key.buffer = keyName;
+  locknull_key.buffer_sz = strlen(keyName)+1;
+
   do {
 
-    memset(&resp_readdir,0,sizeof(PVFS_sysresp_readdir));
+    memset(&resp_readdir,0,sizeof(PVFS_sysresp_readdirplus));
 
     if (debug_orangefs) {
      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
-       "dav_orangefs_walk: PVFS_sys_readdir: handle:%d: fs_id:%d: "
+       "dav_orangefs_walk: PVFS_sys_readdirplus: handle:%d: fs_id:%d: "
        "token:%d: pid:%d:",
        readDir_ref.handle,readDir_ref.fs_id,token,getpid());
     }
@@ -1556,20 +1585,42 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
        Anyhow, if we get a bad return code from the readdir, we'll
        log a message, but not return an error.
     */
-    if ((rc = PVFS_sys_readdir(
+    if ((rc = PVFS_sys_readdirplus(
                 readDir_ref,
                 (!token ? PVFS_READDIR_START : token),
                 pvfs_dirent_incount,
                 walkResource.resource->info->credential,
+                PVFS_ATTR_SYS_ALL_NOHINT,
                 &resp_readdir,
                 NULL)) < 0) {
       ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
-        "dav_orangefs_walk: PVFS_sys_readdir, rc:%d:\n",rc);
+        "dav_orangefs_walk: PVFS_sys_readdirplus, rc:%d:\n",rc);
 /*      Remember ifdefs for dav_new_error 2.2 support. */
 //      return dav_new_error(params->pool,HTTP_FORBIDDEN,0,NULL);
         return NULL;
     }
 
+    /* find out which of this batch's objects are locknull resources,
+       if that fails we'll just have to call them all not locknull...
+    */
+    for (i=0;i<resp_readdir.pvfs_dirent_outcount;i++) {
+      locknull_handles[i] = resp_readdir.dirent_array[i].handle;
+      locknull_val[i].buffer = locknull_buf[i];
+      locknull_val[i].buffer_sz = KEYBUFSIZ;
+      locknull_err[i] = -PVFS_ENOENT;
+    }
+    resp_locknull.val_array = locknull_val;
+    resp_locknull.err_array = locknull_err;
+    if ((rc = PVFS_sys_geteattr_bulk(readDir_ref,
+                                     resp_readdir.pvfs_dirent_outcount,
+                                     locknull_handles,
+                                     walkResource.resource->info->credential,
+                                     1,&locknull_key,&resp_locknull,
+                                     NULL)) < 0) {
+      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+        "dav_orangefs_walk: PVFS_sys_geteattr_bulk, rc:%d:\n",rc);
+    }
+
     /* any given directory might contain more objects than can be
        dealt with on a single pass, we only want to establish the
        current directory's name on the first pass...
@@ -1611,9 +1662,21 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
        */
       orangefsInfo->r = walkResource.resource->info->r; 
 
-      /* Obtain orangefs info for resource we just found with readdir... */
-      rc = orangeAttrs("stat",newResource,params->pool,orangefsInfo,
-                       NULL,NULL);
+      /* Obtain orangefs info for resource we just found with readdir,
+         readdirplus already fetched it unless the object is a symlink 
+         (which orangeAttrs follows) or its attributes couldn't be read...
+       */
+      if ((resp_readdir.stat_err_array[i] == 0) &&
+          (resp_readdir.attr_array[i].objtype != PVFS_TYPE_SYMLINK)) {
+        direntStatAttrs(orangefsInfo,newResource,readDir_ref,
+                        resp_readdir.dirent_array[i].handle,
+                        &resp_readdir.attr_array[i],
+                        (locknull_err[i] == 0),params->pool);
+        rc = 0;
+      } else {
+        rc = orangeAttrs("stat",newResource,params->pool,orangefsInfo,
+                         NULL,NULL);
+      }
 
       /* remember if this is a remove or copy walk... */
       orangefsInfo->removeWalk = isRemoveWalk;
@@ -1622,6 +1685,7 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
       if (rc) {
         ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
           "dav_orangefs_walk: can't stat orangeFs!");
+        freeReaddirplus(&resp_readdir);
 #if AP_SERVER_MAJORVERSION_NUMBER == 2 && AP_SERVER_MINORVERSION_NUMBER <= 2
         return dav_new_error(params->pool,HTTP_NOT_FOUND,0,NULL);
 #else
@@ -1698,6 +1762,7 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
         err = (*params->func)(&walkResource,APR_REG);
 
         if (err != NULL) {
+          freeReaddirplus(&resp_readdir);
           return err;
         }
         
@@ -1714,6 +1779,7 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
         if (isCopyWalk) {
           /* create the dir */
           if ((rc = orangeMkdir((dav_resource *)walkResource.walk_ctx))) {
+            freeReaddirplus(&resp_readdir);
 #if AP_SERVER_MAJORVERSION_NUMBER == 2 && AP_SERVER_MINORVERSION_NUMBER <= 2
             return dav_new_error(params->pool,HTTP_MULTI_STATUS,0,
                               apr_psprintf(params->pool,
@@ -1765,6 +1831,7 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
                            newDavResource->pool);
 
           if (err != NULL) {
+            freeReaddirplus(&resp_readdir);
             return err;
           }
           
@@ -1776,15 +1843,13 @@ static dav_error *dav_orangefs_walk(const dav_walk_params *params,
 
     token=resp_readdir.token;
 
+    /* free blobs of memory allocated by readdirplus... */
+    freeReaddirplus(&resp_readdir);
+
     if (resp_readdir.pvfs_dirent_outcount < pvfs_dirent_incount) {
       break;
     }
 
-    /* free blob of memory allocated by readdir... */
-    if (resp_readdir.pvfs_dirent_outcount) {
-      free(resp_readdir.dirent_array);
-    }
-
   } while (resp_readdir.pvfs_dirent_outcount != 0);
 
   if ((walkResource.response) && (newResponse)) {
@@ -2956,7 +3021,14 @@ static dav_prop_insert dav_orangefs_insert_prop(const dav_resource *resource,
        flag set, which will trigger orangeAttrs to set a special 
        attribute mask that causes file length to be returned. You can't 
        get here without someone explicitly asking for file length.
+
+       Resources found by dav_orangefs_walk already know their size, 
+       since readdirplus fetched it along with everything else.
     */ 
+    if (resource->info->sizeKnown) {
+      sprintf(value,"%"APR_OFF_T_FMT,resource->info->orangefs_finfo.size);
+      break;
+    }
     orangefsInfo = apr_pcalloc(resource->pool,sizeof(*orangefsInfo));
     orangefsInfo->mountPoint =
       apr_pstrdup(resource->pool,resource->info->mountPoint);
@@ -4590,6 +4662,81 @@ int getStatAttrs(PVFS_object_ref *ref,
   return rc;
 }
 
+/* Fill out a dav_resource_private for an object found by readdirplus 
+   the way orangeAttrs "stat" would, from the attributes readdirplus
+   already fetched, so that nothing more has to be fetched from orangefs...
+*/
+void direntStatAttrs(dav_resource_private *drp,
+                     char *resource,
+                     PVFS_object_ref parent_ref,
+                     PVFS_handle handle,
+                     PVFS_sys_attr *attr,
+                     int locknull,
+                     apr_pool_t *pool)
+{
+  if (debug_orangefs) {
+      DBG1("orangefs: direntStatAttrs %s",resource);
+  }
+
+  drp->Uri = apr_pstrdup(pool,resource);
+  drp->DirName = apr_pcalloc(pool,PVFS_NAME_MAX);
+  drp->BaseName = apr_pcalloc(pool,PVFS_NAME_MAX);
+  dirnameBasename(resource,drp->DirName,drp->BaseName);
+
+  drp->parent_ref = apr_pcalloc(pool,sizeof(*drp->parent_ref));
+  *drp->parent_ref = parent_ref;
+  drp->ref = apr_pcalloc(pool,sizeof(*drp->ref));
+  drp->ref->handle = handle;
+  drp->ref->fs_id = parent_ref.fs_id;
+
+  drp->locknull = locknull;
+
+  if (attr->mask & PVFS_ATTR_SYS_TYPE) {
+    if (attr->objtype & PVFS_TYPE_METAFILE) {
+      drp->orangefs_finfo.filetype=APR_REG; // regular file
+    } else if (attr->objtype & PVFS_TYPE_DIRECTORY) {
+      drp->orangefs_finfo.filetype=APR_DIR; // directory
+    }
+  }
+
+  drp->orangefs_finfo.size=0;
+  if (attr->mask & PVFS_ATTR_SYS_SIZE) {
+    drp->orangefs_finfo.size = attr->size;
+    drp->sizeKnown = 1;
+  }
+
+  drp->orangefs_finfo.mtime=0;
+  if (attr->mask & PVFS_ATTR_SYS_MTIME) {
+    drp->orangefs_finfo.mtime = attr->mtime;
+  }
+
+  drp->orangefs_finfo.ctime=0;
+  if (attr->mask & PVFS_ATTR_SYS_CTIME) {
+    drp->orangefs_finfo.ctime = attr->ctime;
+  }
+
+  /* remember these for permissions checking... */
+  drp->perms=attr->perms;
+  drp->uid=attr->owner;
+  drp->gid=attr->group;
+}
+
+/* free what PVFS_sys_readdirplus allocated for one batch... */
+void freeReaddirplus(PVFS_sysresp_readdirplus *resp) {
+  int i;
+
+  for (i=0;i<resp->pvfs_dirent_outcount;i++) {
+    if (resp->stat_err_array[i] == 0) {
+      PVFS_util_release_sys_attr(&resp->attr_array[i]);
+    }
+  }
+  if (resp->pvfs_dirent_outcount) {
+    free(resp->dirent_array);
+    free(resp->stat_err_array);
+    free(resp->attr_array);
+  }
+}
+
 /* Take the character string from a lock property and convert its parts into
    their proper types...
 */
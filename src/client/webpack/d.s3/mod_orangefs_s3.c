@@ -174,18 +174,6 @@ typedef struct {
     char *sn;
 } orangefs_s3_request;
 
-/*
-  struct orangefs_s3_resource
- 
-   Convenience structure to hold everything related to an individual 
-   PVFS2 resource.
- */
-typedef struct {
-    char *pvfs_path;
-    PVFS_dirent *entry;
-    PVFS_object_ref obj;
-} orangefs_s3_resource;
-
 /*
   struct orangefs_s3_s3_list
  
@@ -205,6 +193,34 @@ const char *EXT_ATTR_S3_OWNER_ID           = "user.s3.owner.id";
 const char *EXT_ATTR_S3_OWNER_DISPLAY_NAME = "user.s3.owner.display-name";
 const char *EXT_ATTR_S3_ENTITY_TAG         = "user.s3.entity-tag";
 const char *EXT_ATTR_S3_SIZE               = "user.s3.size";
+const char *EXT_ATTR_S3_UPLOAD_KEY         = "user.s3.upload.key";
+const char *EXT_ATTR_S3_UPLOAD_PART_SIZE   = "user.s3.upload.part-size";
+const char *EXT_ATTR_S3_UPLOAD_PART        = "user.s3.upload.part.";
+
+/* multipart uploads are written to this file, next to the object, and
+   renamed over it when they complete */
+#define S3_UPLOAD_PREFIX ".s3-upload-"
+
+/* bucket listings read this many directory entries at a time, and fetch
+   the S3 attributes of all of them with one request to each server */
+#define S3_LIST_BATCH 60
+#define S3_LIST_VALUE_SIZE 256
+
+/* objects are streamed through two buffers of this size, so that one
+   is filled from OrangeFS (or the client) while the other is drained */
+#define S3_IO_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* S3 limits on multipart uploads; only the last part may be smaller
+   than the minimum */
+#define S3_MAX_PARTS 10000
+#define S3_MIN_PART_SIZE (5LL * 1024 * 1024)
+#define S3_MAX_PART_SIZE (5LL * 1024 * 1024 * 1024)
+
+/* part 1 sets the size of every part but the last, and so where each
+   part goes in the object.  A part that arrives before part 1 is kept
+   past the end of any possible object, in a slot of its own, and moved
+   into place when the upload completes */
+#define S3_STAGE_OFFSET (S3_MAX_PARTS * S3_MAX_PART_SIZE)
 
 const int PERM_S3_FULL_CONTROL 	= 1;
 const int PERM_S3_WRITE		= 2;
@@ -345,80 +361,6 @@ static apr_hash_t *parse_form_from_string(request_rec *r, char *args)
   return form;
 }
 
-/*
-   The orangefs_s3_recurse routine is used by various functions inside 
-   this module whenever a task needs to recurse the file system and 
-   execute a visitor pattern.
-  
-     req       structure containing the original request
-     resource  structure describing the requested resource
-     userInfo  arbitrary parameter to be passed onto the visitor pattern
-     visitor   function to invoke when visiting a resource recursively
-  
- */
-static int orangefs_s3_recurse(orangefs_s3_request *req, 
-                               orangefs_s3_resource *resource, 
-                               void *userInfo,
-                               void(*visitor)(orangefs_s3_request *req, 
-                                              orangefs_s3_resource *resource, 
-                                              void *userInfo))
-{
-  PVFS_sysresp_getattr getattr_response;
-  PVFS_sysresp_readdir readdir_response;
-  PVFS_ds_position token = PVFS_READDIR_START;
-  int rc, i;
-
-  if (debug_orangefs_s3) {
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,"orangefs_s3_recurse:");
-  }
-
-  /* first call visitor for "this" node */
-  visitor(req, resource, userInfo);
-
-  memset(&getattr_response, 0, sizeof(PVFS_sysresp_getattr));
-  rc = PVFS_sys_getattr(resource->obj, PVFS_ATTR_SYS_ALL, 
-                        req->credentials, &getattr_response, NULL);
-  if (rc != 0) {
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
-                 "PVFS_sys_getattr returned %d.", rc);
-    return HTTP_INTERNAL_SERVER_ERROR;
-  }
-
-  if (getattr_response.attr.objtype == PVFS_TYPE_DIRECTORY) {
-    /* read the entire directory */
-    do {
-      memset(&readdir_response, 0, sizeof(PVFS_sysresp_readdir));
-      rc = PVFS_sys_readdir(resource->obj, token, 60, req->credentials, 
-                            &readdir_response, NULL);
-      if (rc < 0) {
-        ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
-                     "PVFS_sys_readdir returned %d.", rc);
-        return HTTP_INTERNAL_SERVER_ERROR;
-      }
-
-      for (i = 0; i < readdir_response.pvfs_dirent_outcount; i++) {
-        orangefs_s3_resource *child_resource = 
-          apr_pcalloc(req->pool, sizeof(orangefs_s3_resource));
-  
-        child_resource->entry = &readdir_response.dirent_array[i];
-        child_resource->obj.handle = readdir_response.dirent_array[i].handle;
-        child_resource->obj.fs_id = resource->obj.fs_id;
-        child_resource->pvfs_path = 
-          apr_pstrcat(req->pool, resource->pvfs_path, "/", 
-                      readdir_response.dirent_array[i].d_name, NULL);
-
-        rc = orangefs_s3_recurse(req, child_resource, userInfo, visitor);
-        if (rc != OK)
-          return rc;
-      }
-
-      token = readdir_response.token;
-    } while ((token != PVFS_READDIR_END) && !req->conf->quit);
-  }
-
-  return OK;
-}
-
 static char * orangefs_s3_bin_to_hex(apr_pool_t *pool, 
                                      unsigned char *bin, 
                                      int length)
@@ -441,12 +383,17 @@ static char * orangefs_s3_bin_to_hex(apr_pool_t *pool,
 }
 
 /*
-   This routine will write the contents of the POST data to a PVFS2 object and
-   return the contents MD5 sum.
+   This routine will write the contents of the POST data to a PVFS2 object,
+   starting at offset, and return its size and MD5 sum.  The data goes
+   through a write-behind buffer, so large pieces are being written to the
+   servers while the next ones are read from the client.
+
+   Returns 0 on success, -1 if the body could not be read, or the PVFS
+   error of a failed write.
  */
 static int orangefs_s3_write_post_data_ref(orangefs_s3_request *req, 
                                            PVFS_object_ref *ref, 
-                                           PVFS_hint hints, 
+                                           PVFS_offset offset,
                                            size_t *size, 
                                            unsigned char *md5)
 {
@@ -456,17 +403,24 @@ static int orangefs_s3_write_post_data_ref(orangefs_s3_request *req,
   const char *buf;
   apr_bucket *b;
   apr_bucket_brigade *bb;
-  PVFS_Request mem_req, file_req;
-  PVFS_sysresp_io resp_io;
-  size_t offset = 0;
+  PVFS_sys_wbuf wbuf;
+  size_t written = 0;
   apr_md5_ctx_t md5_ctx;
-  int rc;
+  int rc, close_rc;
 
   if (debug_orangefs_s3) {
     ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
                  "orangefs_s3_write_post_data_ref:");
   }
 
+  rc = PVFS_sys_wbuf_open(*ref, S3_IO_BUFFER_SIZE, 0, req->credentials, 
+                          &wbuf);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+                 "PVFS_sys_wbuf_open returned %d.", rc);
+    return rc;
+  }
+
   /* initialize the bucket brigade from the request */
   bb = apr_brigade_create(req->r->pool, req->r->connection->bucket_alloc);
 
@@ -475,7 +429,7 @@ static int orangefs_s3_write_post_data_ref(orangefs_s3_request *req,
   /* loop over each bucket until we get an EOS */
   do {
     status = ap_get_brigade(req->r->input_filters, bb, AP_MODE_READBYTES,
-                            APR_BLOCK_READ, 4096);
+                            APR_BLOCK_READ, S3_IO_BUFFER_SIZE);
     if (status == APR_SUCCESS) {
       for (b = APR_BRIGADE_FIRST(bb);
            b!= APR_BRIGADE_SENTINEL(bb);
@@ -492,35 +446,43 @@ static int orangefs_s3_write_post_data_ref(orangefs_s3_request *req,
 
         /* read into buf */
         status = apr_bucket_read(b, &buf, &bytes, APR_BLOCK_READ);
-        if (status == APR_SUCCESS) {
-          file_req = PVFS_BYTE;
-          rc = PVFS_Request_contiguous(bytes, PVFS_BYTE, &mem_req);
-          if (rc < 0) {
-            ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
-                         "PVFS_sys_resolve returned %d.", rc);
-            return -1;
-          }
-
-          rc = PVFS_sys_write(*ref, file_req, offset, (void *)buf, mem_req,
-                              req->credentials, &resp_io, hints);
-
-          offset += bytes;
-
-          PVFS_Request_free(&mem_req);
-
-          apr_md5_update(&md5_ctx, buf, bytes);
+        if (status != APR_SUCCESS) {
+          rc = -1;
+          break;
+        }
 
-        } else {
-          return -1;
+        rc = PVFS_sys_wbuf_write(wbuf, offset + written, buf, bytes,
+                                 req->credentials);
+        if (rc < 0) {
+          ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+                       "PVFS_sys_wbuf_write returned %d.", rc);
+          break;
         }
+
+        written += bytes;
+        apr_md5_update(&md5_ctx, buf, bytes);
       }
+    } else {
+      rc = -1;
     }
 
     apr_brigade_cleanup(bb);
-  } while (!end && (status == APR_SUCCESS));
+  } while (!end && rc == 0);
+
+  close_rc = PVFS_sys_wbuf_close(wbuf, req->credentials);
+  if (close_rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+                 "PVFS_sys_wbuf_close returned %d.", close_rc);
+    if (rc == 0) {
+      rc = close_rc;
+    }
+  }
+  if (rc != 0) {
+    return rc;
+  }
 
   apr_md5_final(md5, &md5_ctx);
-  *size = offset;
+  *size = written;
 
   return 0;
 }
@@ -725,8 +687,101 @@ static PVFS_object_ref * orangefs_s3_mkdir_p(orangefs_s3_request *req,
   return NULL;
 }
 
-static int orangefs_s3_put_object(orangefs_s3_request *req, 
-                                  char *bucket, 
+/*
+   Splits an object path within a bucket into the PVFS path of its
+   directory and the name of its entry.
+ */
+static void orangefs_s3_split_path(orangefs_s3_request *req,
+                                   char *bucket,
+                                   char *path,
+                                   char **parent_path,
+                                   char **entry_name)
+{
+  char *ptr;
+
+  *parent_path =
+    apr_pstrcat(req->pool, req->conf->pvfs_path, "/", bucket, NULL);
+
+  /* walk backwards from the end to find the last '/' */
+  for (ptr = path + strlen(path) - 1; (ptr > path) && (*ptr != '/'); ptr--);
+
+  if (ptr > path) {
+    *entry_name = apr_pstrdup(req->pool, ptr + 1);
+    *parent_path = apr_pstrcat(req->pool, *parent_path,
+                               apr_pstrndup(req->pool, path,
+                               (ptr - path)), NULL);
+  } else {
+    *entry_name = apr_pstrdup(req->pool, path + 1);
+  }
+}
+
+/*
+   Sets the S3 entity tag, size and owner attributes of an object that
+   has just been written, and returns the entity tag to the client.
+ */
+static void orangefs_s3_set_object_attrs(orangefs_s3_request *req,
+                                         PVFS_object_ref *ref,
+                                         char *etag,
+                                         PVFS_size size)
+{
+  PVFS_ds_keyval key, val;
+  char tmp[64];
+  int rc;
+
+  key.buffer = (void*)EXT_ATTR_S3_ENTITY_TAG;
+  key.buffer_sz = strlen(key.buffer) + 1;
+  val.buffer = etag;
+  val.buffer_sz = strlen(val.buffer) + 1;
+
+  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for entity tag returned rc %d.", rc);
+  }
+
+  /* write out etag response header */
+  apr_table_setn(req->r->headers_out, "ETag",
+                 apr_pstrcat(req->pool, "\"", etag, "\"", NULL));
+
+  key.buffer = (void*)EXT_ATTR_S3_SIZE;
+  key.buffer_sz = strlen(key.buffer) + 1;
+  sprintf(tmp, "%lld", (long long)(size));
+  val.buffer = tmp;
+  val.buffer_sz = strlen(val.buffer) + 1;
+
+  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for size returned rc %d.", rc);
+  }
+
+  key.buffer = (void*)EXT_ATTR_S3_OWNER_ID;
+  key.buffer_sz = strlen(key.buffer) + 1;
+  val.buffer = apr_pcalloc(req->pool, BUFSIZ);
+  sprintf(val.buffer, "%d", req->credentials->userid);
+  val.buffer_sz = strlen(val.buffer) + 1;
+
+  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for owner id returned rc %d.", rc);
+  }
+
+  key.buffer = (void*)EXT_ATTR_S3_OWNER_DISPLAY_NAME;
+  key.buffer_sz = strlen(key.buffer) + 1;
+  val.buffer = req->cn;
+  val.buffer_sz = strlen(val.buffer) + 1;
+
+  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for owner display name returned rc %d.",
+                 rc);
+  }
+}
+
+static int orangefs_s3_put_object(orangefs_s3_request *req,
+                                  char *bucket,
                                   char *path)
 {
   char *entry_name, *parent_path, *entry_path;
@@ -734,36 +789,33 @@ static int orangefs_s3_put_object(orangefs_s3_request *req,
   PVFS_sysresp_create resp_create;
   PVFS_object_ref *parent_ref;
   PVFS_object_ref *ref;
-  PVFS_ds_keyval key, val;
   PVFS_sys_dist *new_dist = NULL;
   PVFS_sys_attr attr;
   PVFS_hint hints = NULL;
   unsigned char md5[APR_MD5_DIGESTSIZE];
-  char tmp[1024];
   size_t size = 0;
-  char *ptr;
-  int rc, i;
+  int existed = 0;
+  int rc;
 
   if (debug_orangefs_s3) {
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
                  "orangefs_s3_put_object for bucket %s path %s.", bucket, path);
   }
 
   PVFS_hint_import_env(&hints);
 
-  entry_path = apr_pstrcat(req->pool, req->conf->pvfs_path, "/", 
+  entry_path = apr_pstrcat(req->pool, req->conf->pvfs_path, "/",
                            bucket, path, NULL);
 
   memset(&resp_lookup, 0, sizeof(PVFS_sysresp_lookup));
-  rc = PVFS_sys_lookup(req->conf->fsid, entry_path, req->credentials, 
+  rc = PVFS_sys_lookup(req->conf->fsid, entry_path, req->credentials,
                        &resp_lookup, PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
   if (rc == 0) {
     /* file already exists */
     ref = &resp_lookup.ref;
+    existed = 1;
   } else {
     /* does not exist, need to create it */
-    entry_name = apr_pstrdup(req->pool, path);
-    entry_name++;
 
     /* fill out our attr */
     attr.owner = req->credentials->userid;
@@ -772,33 +824,20 @@ static int orangefs_s3_put_object(orangefs_s3_request *req,
     attr.mask = (PVFS_ATTR_SYS_ALL_SETABLE);
     attr.dfile_count = 0;
 
-    parent_path = 
-      apr_pstrcat(req->pool, req->conf->pvfs_path, "/", bucket, NULL);
-
-    /* walk backwards from the end to find the last '/' */
-    for (ptr = path + strlen(path) -1; (ptr > path) && (*ptr != '/'); ptr--);
+    orangefs_s3_split_path(req, bucket, path, &parent_path, &entry_name);
 
-    if (ptr > path) {
-      entry_name = apr_pstrdup(req->pool, ptr + 1);
-      parent_path = apr_pstrcat(req->pool, parent_path, 
-                                apr_pstrndup(req->pool, path, 
-                                (ptr - path)), NULL);
-    } else {
-      entry_name = apr_pstrdup(req->pool, path + 1);
-    }
-    
     parent_ref = orangefs_s3_mkdir_p(req, req->conf->fsid, parent_path);
     if (parent_ref == NULL) {
-      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
                    "Unable to get or create parent directory %s", parent_path);
       return HTTP_INTERNAL_SERVER_ERROR;
     }
 
     /* need to create the entry */
-    rc = PVFS_sys_create(entry_name, *parent_ref, attr, req->credentials, 
+    rc = PVFS_sys_create(entry_name, *parent_ref, attr, req->credentials,
                          new_dist, &resp_create, NULL, hints);
     if (rc < 0) {
-      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
+      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
                    "PVFS_sys_create returned %d.", rc);
       return HTTP_INTERNAL_SERVER_ERROR;
     }
@@ -806,179 +845,1051 @@ static int orangefs_s3_put_object(orangefs_s3_request *req,
     ref = &resp_create.ref;
   }
 
-  /* now we need to write the PUT/POST data */
+  /* now we need to write the PUT/POST data */
+  memset(md5, 0, APR_MD5_DIGESTSIZE);
+  rc = orangefs_s3_write_post_data_ref(req, ref, 0, &size, md5);
+  if (rc != 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "Unable to write the data of %s: %d.", entry_path, rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+
+  /* a replaced object may have been longer than the new one */
+  if (existed) {
+    rc = PVFS_sys_truncate(*ref, size, req->credentials, hints);
+    if (rc < 0) {
+      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                   "PVFS_sys_truncate returned %d.", rc);
+      return HTTP_INTERNAL_SERVER_ERROR;
+    }
+  }
+
+  orangefs_s3_set_object_attrs(req, ref,
+    orangefs_s3_bin_to_hex(req->pool, md5, APR_MD5_DIGESTSIZE), size);
+
+  return OK;
+}
+
+/*
+   Parses the Range header of a GET against an object of size bytes.
+   Only a single range is handled; any other form is ignored, as HTTP
+   allows, and the whole object is sent.
+
+   Returns 1 and the range in *first and *length if one should be sent,
+   0 if the whole object should be sent, and -1 if the range does not
+   overlap the object.
+ */
+static int orangefs_s3_parse_range(const char *range,
+                                   PVFS_size size,
+                                   PVFS_offset *first,
+                                   PVFS_size *length)
+{
+  const char *ptr;
+  char *end;
+  apr_int64_t from, to;
+
+  if (range == NULL || strncasecmp(range, "bytes=", 6) != 0 ||
+      strchr(range, ',') != NULL) {
+    return 0;
+  }
+
+  for (ptr = range + 6; apr_isspace(*ptr); ptr++);
+
+  if (*ptr == '-') {
+    /* the last so many bytes */
+    to = apr_strtoi64(ptr + 1, &end, 10);
+    if (end == ptr + 1 || *end != '\0' || to < 0) {
+      return 0;
+    }
+    if (to == 0 || size == 0) {
+      return -1;
+    }
+    if (to > size) {
+      to = size;
+    }
+    *first = size - to;
+    *length = to;
+    return 1;
+  }
+
+  from = apr_strtoi64(ptr, &end, 10);
+  if (end == ptr || *end != '-' || from < 0) {
+    return 0;
+  }
+
+  ptr = end + 1;
+  if (*ptr == '\0') {
+    to = size - 1;
+  } else {
+    to = apr_strtoi64(ptr, &end, 10);
+    if (end == ptr || *end != '\0' || to < from) {
+      return 0;
+    }
+    if (to >= size) {
+      to = size - 1;
+    }
+  }
+
+  if (from >= size) {
+    return -1;
+  }
+
+  *first = from;
+  *length = to - from + 1;
+  return 1;
+}
+
+/*
+   Starts reading size bytes of an object at offset into buf.
+ */
+static int orangefs_s3_post_read(orangefs_s3_request *req,
+                                 PVFS_object_ref *ref,
+                                 PVFS_hint hints,
+                                 PVFS_offset offset,
+                                 PVFS_size size,
+                                 char *buf,
+                                 PVFS_Request *mem_req,
+                                 PVFS_sysresp_io *resp_io,
+                                 PVFS_sys_op_id *op_id)
+{
+  int rc;
+
+  rc = PVFS_Request_contiguous(size, PVFS_BYTE, mem_req);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_Request_contiguous returned rc %d.", rc);
+    return rc;
+  }
+
+  memset(resp_io, 0, sizeof(PVFS_sysresp_io));
+  *op_id = -1;
+  rc = PVFS_isys_read(*ref, PVFS_BYTE, offset, buf, *mem_req,
+                      req->credentials, resp_io, op_id, hints, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_isys_read returned rc %d.", rc);
+    PVFS_Request_free(mem_req);
+  }
+
+  return rc;
+}
+
+/*
+   Waits for a read started by orangefs_s3_post_read.  PVFS_sys_wait is
+   used, rather than PVFS_sys_testsome, because it only completes the one
+   operation and so is safe with many requests running at once.
+ */
+static int orangefs_s3_wait_read(PVFS_sys_op_id op_id, PVFS_Request *mem_req)
+{
+  int rc, error = 0;
+
+  if (op_id != -1) {
+    rc = PVFS_sys_wait(op_id, "io", &error);
+    if (rc < 0) {
+      error = rc;
+    }
+    PVFS_sys_release(op_id);
+  }
+  PVFS_Request_free(mem_req);
+
+  if (error < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_wait for read returned %d.", error);
+  }
+
+  return error;
+}
+
+/*
+   Sends length bytes of an object, starting at offset, to the client.
+   Two buffers are used so that the next piece is being read from the
+   servers while the last one is sent.
+ */
+static int orangefs_s3_send_range(orangefs_s3_request *req,
+                                  PVFS_object_ref *ref,
+                                  PVFS_hint hints,
+                                  PVFS_offset offset,
+                                  PVFS_size length)
+{
+  char *buf[2];
+  PVFS_Request mem_req[2];
+  PVFS_sysresp_io resp_io[2];
+  PVFS_sys_op_id op_id[2];
+  PVFS_size want[2];
+  PVFS_size posted = 0;
+  apr_bucket_brigade *bb;
+  apr_bucket *b;
+  int cur = 0, pending = -1;
+  int rc = 0;
+
+  if (debug_orangefs_s3) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_send_range: %lld bytes at %lld.",
+                 (long long)(length), (long long)(offset));
+  }
+
+  if (length <= 0) {
+    return OK;
+  }
+
+  buf[0] = apr_palloc(req->pool, S3_IO_BUFFER_SIZE);
+  buf[1] = apr_palloc(req->pool, S3_IO_BUFFER_SIZE);
+  bb = apr_brigade_create(req->pool, req->r->connection->bucket_alloc);
+
+  want[0] = PVFS_util_min(length, S3_IO_BUFFER_SIZE);
+  rc = orangefs_s3_post_read(req, ref, hints, offset, want[0], buf[0],
+                             &mem_req[0], &resp_io[0], &op_id[0]);
+  if (rc < 0) {
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+  posted = want[0];
+  pending = 0;
+
+  while (pending == cur) {
+    rc = orangefs_s3_wait_read(op_id[cur], &mem_req[cur]);
+    pending = -1;
+    if (rc < 0) {
+      break;
+    }
+
+    /* start on the next piece before sending this one; a short read
+       means the object was cut while it was being sent */
+    if (posted < length && resp_io[cur].total_completed == want[cur]) {
+      want[!cur] = PVFS_util_min(length - posted, S3_IO_BUFFER_SIZE);
+      rc = orangefs_s3_post_read(req, ref, hints, offset + posted,
+                                 want[!cur], buf[!cur], &mem_req[!cur],
+                                 &resp_io[!cur], &op_id[!cur]);
+      if (rc < 0) {
+        break;
+      }
+      posted += want[!cur];
+      pending = !cur;
+    }
+
+    if (resp_io[cur].total_completed > 0) {
+      b = apr_bucket_transient_create(buf[cur],
+                                      resp_io[cur].total_completed,
+                                      bb->bucket_alloc);
+      APR_BRIGADE_INSERT_TAIL(bb, b);
+      if (ap_pass_brigade(req->r->output_filters, bb) != APR_SUCCESS) {
+        /* the client went away */
+        apr_brigade_cleanup(bb);
+        break;
+      }
+      apr_brigade_cleanup(bb);
+    }
+
+    cur = !cur;
+  }
+
+  /* the servers must be done with a buffer before it goes back to
+     the pool */
+  if (pending != -1) {
+    orangefs_s3_wait_read(op_id[pending], &mem_req[pending]);
+  }
+
+  if (rc < 0) {
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+
+  return OK;
+}
+
+static int orangefs_s3_get_object(orangefs_s3_request *req,
+                                  char *bucket,
+                                  char *path)
+{
+  char *entry_path;
+  PVFS_sysresp_lookup resp_lookup;
+  PVFS_sysresp_getattr resp_getattr;
+  PVFS_object_ref *ref;
+  PVFS_hint hints = NULL;
+  PVFS_ds_keyval k, v;
+  PVFS_offset first = 0;
+  PVFS_size size, length;
+  char buffer[4096];
+  char buffer2[256];
+  int rc;
+
+  if (debug_orangefs_s3) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_get_object for bucket %s path %s.", bucket, path);
+  }
+
+  if (req->params) {
+    apr_array_header_t *arr;
+
+    arr = apr_hash_get(req->params, "acl", APR_HASH_KEY_STRING);
+    if (arr) {
+    }
+
+    arr = apr_hash_get(req->params, "torrent", APR_HASH_KEY_STRING);
+    if (arr) {
+    }
+  }
+
+  entry_path = apr_pstrcat(req->pool, req->conf->pvfs_path, "/",
+                           bucket, path, NULL);
+
+  memset(&resp_lookup, 0, sizeof(PVFS_sysresp_lookup));
+  rc = PVFS_sys_lookup(req->conf->fsid, entry_path, req->root,
+                       &resp_lookup, PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+
+  if (rc < 0) {
+    /* no such file */
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_lookup for %s returned %d.", entry_path, rc);
+    return HTTP_NOT_FOUND;
+  }
+
+  ref = &resp_lookup.ref;
+  PVFS_hint_import_env(&hints);
+
+  /* the size of the file, rather than the one recorded when the object
+     was put, is what can be read */
+  memset(&resp_getattr, 0, sizeof(PVFS_sysresp_getattr));
+  rc = PVFS_sys_getattr(*ref, PVFS_ATTR_SYS_SIZE, req->credentials,
+                        &resp_getattr, hints);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_getattr for %s returned %d.", entry_path, rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+  size = resp_getattr.attr.size;
+  length = size;
+
+  k.buffer = (void*)EXT_ATTR_S3_ENTITY_TAG;
+  k.buffer_sz = strlen(k.buffer) + 1;
+  v.buffer = buffer;
+  v.buffer_sz = 4096;
+
+  memset(buffer, 0, 4096);
+  rc = PVFS_sys_geteattr(resp_lookup.ref, req->credentials, &k, &v, NULL);
+  if (rc >= 0) {
+    memset(buffer2, 0, 256);
+    memcpy(buffer2, buffer, v.read_sz);
+    apr_table_setn(req->r->headers_out, "ETag",
+                   apr_pstrcat(req->pool, "\"", (char*)buffer2, "\"", NULL));
+  }
+
+  apr_table_setn(req->r->headers_out, "Accept-Ranges", "bytes");
+
+  rc = orangefs_s3_parse_range(apr_table_get(req->r->headers_in, "Range"),
+                               size, &first, &length);
+  if (rc < 0) {
+    apr_table_setn(req->r->headers_out, "Content-Range",
+                   apr_psprintf(req->pool, "bytes */%lld", (long long)(size)));
+    return HTTP_RANGE_NOT_SATISFIABLE;
+  } else if (rc > 0) {
+    req->r->status = HTTP_PARTIAL_CONTENT;
+    apr_table_setn(req->r->headers_out, "Content-Range",
+                   apr_psprintf(req->pool, "bytes %lld-%lld/%lld",
+                                (long long)(first), (long long)(first + length - 1),
+                                (long long)(size)));
+  }
+
+  ap_set_content_length(req->r, length);
+
+  /* if it's a HEAD request, return without content */
+  if (strcmp(req->r->method, "HEAD") == 0) {
+    return OK;
+  }
+
+  return orangefs_s3_send_range(req, ref, hints, first, length);
+}
+
+/*
+   Multipart uploads.  An upload is written to a hidden file in the
+   directory of its object, named after the upload id and carrying the
+   object key in an attribute.  Part 1 sets the part size, so every
+   other part except the last goes straight to its place in the file;
+   when the upload completes the file is cut to its length and renamed
+   over the object.  Each part is recorded in an attribute holding its
+   length, MD5 sum and whether it was staged.
+ */
+
+/* finds the upload file of uploadId, checking that it belongs to path */
+static int orangefs_s3_lookup_upload(orangefs_s3_request *req,
+                                     char *bucket,
+                                     char *path,
+                                     const char *upload_id,
+                                     PVFS_object_ref *parent_ref,
+                                     char **upload_name,
+                                     PVFS_object_ref *ref)
+{
+  PVFS_sysresp_lookup resp_lookup;
+  PVFS_ds_keyval k, v;
+  char *parent_path, *entry_name;
+  char key[PVFS_NAME_MAX + 1];
+  int rc;
+
+  /* an upload id is always 32 hex digits, so it cannot name another
+     file */
+  if (upload_id == NULL || strlen(upload_id) != APR_MD5_DIGESTSIZE * 2 ||
+      strspn(upload_id, "0123456789abcdef") != APR_MD5_DIGESTSIZE * 2) {
+    return -PVFS_ENOENT;
+  }
+
+  orangefs_s3_split_path(req, bucket, path, &parent_path, &entry_name);
+  *upload_name = apr_pstrcat(req->pool, S3_UPLOAD_PREFIX, upload_id, NULL);
+
+  memset(&resp_lookup, 0, sizeof(PVFS_sysresp_lookup));
+  rc = PVFS_sys_lookup(req->conf->fsid, parent_path, req->credentials,
+                       &resp_lookup, PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+  if (rc < 0) {
+    return rc;
+  }
+  *parent_ref = resp_lookup.ref;
+
+  memset(&resp_lookup, 0, sizeof(PVFS_sysresp_lookup));
+  rc = PVFS_sys_ref_lookup(req->conf->fsid, *upload_name, *parent_ref,
+                           req->credentials, &resp_lookup,
+                           PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+  if (rc < 0) {
+    return rc;
+  }
+  *ref = resp_lookup.ref;
+
+  k.buffer = (void*)EXT_ATTR_S3_UPLOAD_KEY;
+  k.buffer_sz = strlen(k.buffer) + 1;
+  memset(key, 0, sizeof(key));
+  v.buffer = key;
+  v.buffer_sz = PVFS_NAME_MAX;
+
+  rc = PVFS_sys_geteattr(*ref, req->credentials, &k, &v, NULL);
+  if (rc < 0) {
+    return rc;
+  }
+  if (strcmp(key, path) != 0) {
+    return -PVFS_ENOENT;
+  }
+
+  return 0;
+}
+
+static int orangefs_s3_no_such_upload(orangefs_s3_request *req,
+                                      const char *upload_id)
+{
+  ap_rprintf(req->r, "<Error>");
+  ap_rprintf(req->r, "  <Code>NoSuchUpload</Code>");
+  ap_rprintf(req->r, "  <Message>The specified upload does not exist.</Message>");
+  ap_rprintf(req->r, "  <UploadId>%s</UploadId>",
+             upload_id ? ap_escape_html(req->pool, upload_id) : "");
+  ap_rprintf(req->r, "</Error>");
+
+  return HTTP_NOT_FOUND;
+}
+
+static int orangefs_s3_invalid_part(orangefs_s3_request *req,
+                                    const char *code,
+                                    const char *message)
+{
+  ap_rprintf(req->r, "<Error>");
+  ap_rprintf(req->r, "  <Code>%s</Code>", code);
+  ap_rprintf(req->r, "  <Message>%s</Message>", message);
+  ap_rprintf(req->r, "</Error>");
+
+  return HTTP_BAD_REQUEST;
+}
+
+/* reads the part size of an upload; 0 if part 1 has not yet arrived */
+static int orangefs_s3_get_part_size(orangefs_s3_request *req,
+                                     PVFS_object_ref *ref,
+                                     PVFS_size *part_size)
+{
+  PVFS_ds_keyval k, v;
+  char tmp[64];
+  int rc;
+
+  k.buffer = (void*)EXT_ATTR_S3_UPLOAD_PART_SIZE;
+  k.buffer_sz = strlen(k.buffer) + 1;
+  memset(tmp, 0, sizeof(tmp));
+  v.buffer = tmp;
+  v.buffer_sz = sizeof(tmp) - 1;
+
+  *part_size = 0;
+  rc = PVFS_sys_geteattr(*ref, req->credentials, &k, &v, NULL);
+  if (rc == -PVFS_ENOENT || rc == -PVFS_ENODATA) {
+    return 0;
+  } else if (rc < 0) {
+    return rc;
+  }
+
+  *part_size = apr_atoi64(tmp);
+  return 0;
+}
+
+/* where part_number goes in the upload file while it is staged */
+static PVFS_offset orangefs_s3_stage_offset(int part_number)
+{
+  return S3_STAGE_OFFSET + (PVFS_offset)(part_number - 1) * S3_MAX_PART_SIZE;
+}
+
+/*
+   Starts a multipart upload and returns its id.
+ */
+static int orangefs_s3_initiate_upload(orangefs_s3_request *req,
+                                       char *bucket,
+                                       char *path)
+{
+  char *entry_name, *parent_path, *upload_id, *upload_name;
+  PVFS_sysresp_create resp_create;
+  PVFS_object_ref *parent_ref;
+  PVFS_ds_keyval key, val;
+  PVFS_sys_attr attr;
+  PVFS_hint hints = NULL;
+  unsigned char id[APR_MD5_DIGESTSIZE];
+  int rc;
+
+  if (debug_orangefs_s3) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_initiate_upload for bucket %s path %s.",
+                 bucket, path);
+  }
+
+  if (strlen(path) > PVFS_NAME_MAX) {
+    return HTTP_BAD_REQUEST;
+  }
+
+  if (apr_generate_random_bytes(id, sizeof(id)) != APR_SUCCESS) {
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+  upload_id = orangefs_s3_bin_to_hex(req->pool, id, sizeof(id));
+  upload_name = apr_pstrcat(req->pool, S3_UPLOAD_PREFIX, upload_id, NULL);
+
+  PVFS_hint_import_env(&hints);
+
+  orangefs_s3_split_path(req, bucket, path, &parent_path, &entry_name);
+
+  parent_ref = orangefs_s3_mkdir_p(req, req->conf->fsid, parent_path);
+  if (parent_ref == NULL) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "Unable to get or create parent directory %s", parent_path);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+
+  attr.owner = req->credentials->userid;
+  attr.group = req->credentials->group_array[0];
+  attr.perms = 256;
+  attr.mask = (PVFS_ATTR_SYS_ALL_SETABLE);
+  attr.dfile_count = 0;
+
+  rc = PVFS_sys_create(upload_name, *parent_ref, attr, req->credentials,
+                       NULL, &resp_create, NULL, hints);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_create returned %d.", rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+
+  key.buffer = (void*)EXT_ATTR_S3_UPLOAD_KEY;
+  key.buffer_sz = strlen(key.buffer) + 1;
+  val.buffer = path;
+  val.buffer_sz = strlen(val.buffer) + 1;
+
+  rc = PVFS_sys_seteattr(resp_create.ref, req->credentials, &key, &val,
+                         0, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for upload key returned rc %d.", rc);
+    PVFS_sys_remove(upload_name, *parent_ref, req->credentials, NULL);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+
+  ap_rprintf(req->r, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+  ap_rprintf(req->r, "<InitiateMultipartUploadResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">");
+  ap_rprintf(req->r,   "<Bucket>%s</Bucket>", bucket);
+  ap_rprintf(req->r,   "<Key>%s</Key>", ap_escape_html(req->pool, path + 1));
+  ap_rprintf(req->r,   "<UploadId>%s</UploadId>", upload_id);
+  ap_rprintf(req->r, "</InitiateMultipartUploadResult>");
+
+  return OK;
+}
+
+/*
+   Writes one part of a multipart upload.
+ */
+static int orangefs_s3_upload_part(orangefs_s3_request *req,
+                                   char *bucket,
+                                   char *path,
+                                   const char *upload_id,
+                                   const char *part)
+{
+  char *upload_name;
+  PVFS_object_ref parent_ref, ref;
+  PVFS_ds_keyval key, val;
+  PVFS_size part_size = 0;
+  PVFS_offset offset;
+  apr_int64_t length;
+  const char *clen;
+  unsigned char md5[APR_MD5_DIGESTSIZE];
+  char *etag;
+  size_t size = 0;
+  int part_number, staged = 0;
+  int rc;
+
+  if (debug_orangefs_s3) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_upload_part %s of upload %s.",
+                 part, upload_id);
+  }
+
+  /* the length decides where the part goes, so it has to be known
+     before the body is read */
+  clen = apr_table_get(req->r->headers_in, "Content-Length");
+  if (clen == NULL) {
+    return HTTP_LENGTH_REQUIRED;
+  }
+  length = apr_atoi64(clen);
+  if (length < 0 || length > S3_MAX_PART_SIZE) {
+    return orangefs_s3_invalid_part(req, "EntityTooLarge",
+             "Your proposed upload exceeds the maximum allowed size.");
+  }
+
+  part_number = atoi(part);
+  if (part_number < 1 || part_number > S3_MAX_PARTS) {
+    return orangefs_s3_invalid_part(req, "InvalidArgument",
+             "Part number must be an integer between 1 and 10000.");
+  }
+
+  rc = orangefs_s3_lookup_upload(req, bucket, path, upload_id,
+                                 &parent_ref, &upload_name, &ref);
+  if (rc < 0) {
+    return orangefs_s3_no_such_upload(req, upload_id);
+  }
+
+  if (part_number == 1) {
+    /* part 1 sets the size of every part but the last; a second upload
+       of it must agree with the first */
+    key.buffer = (void*)EXT_ATTR_S3_UPLOAD_PART_SIZE;
+    key.buffer_sz = strlen(key.buffer) + 1;
+    val.buffer = apr_psprintf(req->pool, "%lld", (long long)(length));
+    val.buffer_sz = strlen(val.buffer) + 1;
+
+    rc = PVFS_sys_seteattr(ref, req->credentials, &key, &val,
+                           PVFS_XATTR_CREATE, NULL);
+    if (rc < 0) {
+      rc = orangefs_s3_get_part_size(req, &ref, &part_size);
+      if (rc < 0 || part_size == 0) {
+        return HTTP_INTERNAL_SERVER_ERROR;
+      }
+      if (part_size != length) {
+        return orangefs_s3_invalid_part(req, "InvalidPart",
+                 "Part 1 was already uploaded with a different size.");
+      }
+    }
+    offset = 0;
+  } else {
+    rc = orangefs_s3_get_part_size(req, &ref, &part_size);
+    if (rc < 0) {
+      return HTTP_INTERNAL_SERVER_ERROR;
+    }
+    if (part_size == 0) {
+      staged = 1;
+      offset = orangefs_s3_stage_offset(part_number);
+    } else if (length > part_size) {
+      return orangefs_s3_invalid_part(req, "InvalidPart",
+               "Only the last part may differ from the size of part 1.");
+    } else {
+      offset = (PVFS_offset)(part_number - 1) * part_size;
+    }
+  }
+
   memset(md5, 0, APR_MD5_DIGESTSIZE);
-  rc = orangefs_s3_write_post_data_ref(req, ref, hints, &size, md5);
-
-  /* convert md5sum to hex string */
-  {
-    char hexval[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 
-                        'a', 'b', 'c', 'd', 'e', 'f' };
-  
-    memset(tmp, 0, APR_MD5_DIGESTSIZE*2+1); 
-    for (i = 0; i < APR_MD5_DIGESTSIZE; i++) {
-      tmp[i*2] = hexval[(md5[i] >> 4) & 0xf];
-      tmp[(i*2)+1] = hexval[md5[i] & 0x0f];
-    }
+  rc = orangefs_s3_write_post_data_ref(req, &ref, offset, &size, md5);
+  if (rc != 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "Unable to write part %d of %s: %d.",
+                 part_number, upload_name, rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
+  if (size != length) {
+    return HTTP_BAD_REQUEST;
   }
 
-  key.buffer = (void*)EXT_ATTR_S3_ENTITY_TAG;
+  etag = orangefs_s3_bin_to_hex(req->pool, md5, APR_MD5_DIGESTSIZE);
+
+  key.buffer = apr_psprintf(req->pool, "%s%d", EXT_ATTR_S3_UPLOAD_PART,
+                            part_number);
   key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = tmp;
+  val.buffer = apr_psprintf(req->pool, "%lld %s %d", (long long)(length), etag,
+                            staged);
   val.buffer_sz = strlen(val.buffer) + 1;
 
-  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  rc = PVFS_sys_seteattr(ref, req->credentials, &key, &val, 0, NULL);
   if (rc < 0) {
-
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_seteattr() for part %d returned rc %d.",
+                 part_number, rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
   }
- 
-  /* write out etag response header */
-  apr_table_setn(req->r->headers_out, "ETag", 
-                 apr_pstrcat(req->pool, "\"", tmp, "\"", NULL));
 
-  key.buffer = (void*)EXT_ATTR_S3_SIZE;
-  key.buffer_sz = strlen(key.buffer) + 1;
-  sprintf(tmp, "%lu", size);
-  val.buffer = tmp;
-  val.buffer_sz = strlen(val.buffer) + 1;
+  apr_table_setn(req->r->headers_out, "ETag",
+                 apr_pstrcat(req->pool, "\"", etag, "\"", NULL));
 
-  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
-  if (rc < 0) {
+  return OK;
+}
 
-  }
+/*
+   Copies length bytes of a file from one offset to another.
+ */
+static int orangefs_s3_copy_range(orangefs_s3_request *req,
+                                  PVFS_object_ref *ref,
+                                  PVFS_offset from,
+                                  PVFS_offset to,
+                                  PVFS_size length)
+{
+  PVFS_Request mem_req;
+  PVFS_sysresp_io resp_io;
+  PVFS_sys_wbuf wbuf;
+  PVFS_size done = 0, want;
+  char *buf;
+  int rc, close_rc;
 
-  key.buffer = (void*)EXT_ATTR_S3_OWNER_ID;
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = apr_pcalloc(req->pool, BUFSIZ);
-  sprintf(val.buffer, "%d", req->credentials->userid);
-  val.buffer_sz = strlen(val.buffer) + 1;
+  buf = apr_palloc(req->pool, S3_IO_BUFFER_SIZE);
 
-  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
+  rc = PVFS_sys_wbuf_open(*ref, S3_IO_BUFFER_SIZE, 0, req->credentials,
+                          &wbuf);
   if (rc < 0) {
+    return rc;
+  }
 
+  while (done < length) {
+    want = PVFS_util_min(length - done, S3_IO_BUFFER_SIZE);
+    rc = PVFS_Request_contiguous(want, PVFS_BYTE, &mem_req);
+    if (rc < 0) {
+      break;
+    }
+    rc = PVFS_sys_read(*ref, PVFS_BYTE, from + done, buf, mem_req,
+                       req->credentials, &resp_io, NULL);
+    PVFS_Request_free(&mem_req);
+    if (rc < 0) {
+      break;
+    }
+    if (resp_io.total_completed != want) {
+      rc = -PVFS_EIO;
+      break;
+    }
+    rc = PVFS_sys_wbuf_write(wbuf, to + done, buf, want, req->credentials);
+    if (rc < 0) {
+      break;
+    }
+    done += want;
   }
 
-  key.buffer = (void*)EXT_ATTR_S3_OWNER_DISPLAY_NAME;
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = req->cn;
-  val.buffer_sz = strlen(val.buffer) + 1;
+  close_rc = PVFS_sys_wbuf_close(wbuf, req->credentials);
+  if (rc == 0) {
+    rc = close_rc;
+  }
 
-  rc = PVFS_sys_seteattr(*ref, req->credentials, &key, &val, 0, NULL);
-  if (rc < 0) {
+  return rc;
+}
 
-  }
+/* drops the attributes an upload kept while it ran */
+static void orangefs_s3_clear_upload_attrs(orangefs_s3_request *req,
+                                           PVFS_object_ref *ref)
+{
+  PVFS_sysresp_listeattr resp_listeattr;
+  PVFS_ds_position token = PVFS_ITERATE_START;
+  PVFS_ds_keyval *keyp;
+  apr_array_header_t *names;
+  const char *prefix = "user.s3.upload.";
+  int nkey = 32;
+  int i, rc;
+
+  names = apr_array_make(req->pool, 16, sizeof(char*));
+  keyp = apr_pcalloc(req->pool, sizeof(*keyp) * nkey);
+  for (i = 0; i < nkey; i++) {
+    keyp[i].buffer_sz = PVFS_MAX_XATTR_NAMELEN;
+    keyp[i].buffer = apr_pcalloc(req->pool, PVFS_MAX_XATTR_NAMELEN);
+  }
+
+  /* collect the names first, so that the listing is not disturbed by
+     the removals */
+  do {
+    memset(&resp_listeattr, 0, sizeof(resp_listeattr));
+    resp_listeattr.key_array = keyp;
+    rc = PVFS_sys_listeattr(*ref, token, nkey, req->credentials,
+                            &resp_listeattr, NULL);
+    if (rc < 0) {
+      break;
+    }
+    for (i = 0; i < resp_listeattr.nkey; i++) {
+      if (strncmp(keyp[i].buffer, prefix, strlen(prefix)) == 0) {
+        *(char**)apr_array_push(names) =
+          apr_pstrndup(req->pool, keyp[i].buffer, keyp[i].read_sz);
+      }
+    }
+    token = resp_listeattr.token;
+  } while (resp_listeattr.nkey == nkey && token != PVFS_ITERATE_END);
 
-  return OK;
+  for (i = 0; i < names->nelts; i++) {
+    PVFS_ds_keyval key;
+
+    key.buffer = APR_ARRAY_IDX(names, i, char*);
+    key.buffer_sz = strlen(key.buffer) + 1;
+    PVFS_sys_deleattr(*ref, req->credentials, &key, NULL);
+  }
 }
 
-static int orangefs_s3_get_object(orangefs_s3_request *req, 
-                                  char *bucket, 
-                                  char *path)
+/*
+   Checks the part list of a complete request against the parts that
+   were uploaded, puts staged parts in place and renames the upload
+   over the object.
+ */
+static int orangefs_s3_complete_upload(orangefs_s3_request *req,
+                                       char *bucket,
+                                       char *path,
+                                       const char *upload_id)
 {
-  char *entry_path;
-  PVFS_sysresp_lookup resp_lookup;
-  PVFS_Request mem_req, file_req;
-  PVFS_sysresp_io resp_io;
-  PVFS_object_ref *ref;
-  PVFS_hint hints = NULL;
-  PVFS_ds_keyval k, v;
-  char buffer[4096];
-  char buffer2[256];
-  size_t offset = 0;
-  int rc;
+  char *upload_name, *parent_path, *entry_name;
+  char *data = NULL;
+  apr_size_t sz = 0;
+  xmlTextReaderPtr reader;
+  const xmlChar *name;
+  char *number = NULL, *etag = NULL;
+  PVFS_object_ref parent_ref, ref;
+  PVFS_ds_keyval key, val;
+  PVFS_size part_size, total = 0;
+  apr_md5_ctx_t md5_ctx;
+  unsigned char md5[APR_MD5_DIGESTSIZE];
+  char record[128];
+  long long part_length;
+  char part_md5[APR_MD5_DIGESTSIZE * 2 + 1];
+  int staged;
+  apr_array_header_t *parts;
+  int i, j, n, rc;
 
   if (debug_orangefs_s3) {
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
-                 "orangefs_s3_get_object for bucket %s path %s.", bucket, path);
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_complete_upload %s for bucket %s path %s.",
+                 upload_id, bucket, path);
   }
 
-  if (req->params) {
-    apr_array_header_t *arr;
+  rc = orangefs_s3_lookup_upload(req, bucket, path, upload_id,
+                                 &parent_ref, &upload_name, &ref);
+  if (rc < 0) {
+    return orangefs_s3_no_such_upload(req, upload_id);
+  }
 
-    arr = apr_hash_get(req->params, "acl", APR_HASH_KEY_STRING);
-    if (arr) {
-    }
+  if (!orangefs_s3_load_post_data(req->r, &data, &sz) || data == NULL) {
+    return HTTP_BAD_REQUEST;
+  }
 
-    arr = apr_hash_get(req->params, "torrent", APR_HASH_KEY_STRING);
-    if (arr) {
+  /* gather the (PartNumber, ETag) pairs of the part list */
+  parts = apr_array_make(req->pool, 16, sizeof(char*) * 2);
+  reader = xmlReaderForMemory(data, sz, NULL, NULL, 0);
+  if (reader == NULL) {
+    return HTTP_BAD_REQUEST;
+  }
+  while ((rc = xmlTextReaderRead(reader)) == 1) {
+    if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+      name = xmlTextReaderConstLocalName(reader);
+      if (xmlStrEqual(name, BAD_CAST "Part")) {
+        number = etag = NULL;
+      } else if (xmlStrEqual(name, BAD_CAST "PartNumber") ||
+                 xmlStrEqual(name, BAD_CAST "ETag")) {
+        xmlChar *text = xmlTextReaderReadString(reader);
+
+        if (text) {
+          if (name[0] == 'P') {
+            number = apr_pstrdup(req->pool, (char*)text);
+          } else {
+            etag = apr_pstrdup(req->pool, (char*)text);
+          }
+          xmlFree(text);
+        }
+      }
+    } else if (xmlTextReaderNodeType(reader) ==
+               XML_READER_TYPE_END_ELEMENT &&
+               xmlStrEqual(xmlTextReaderConstLocalName(reader),
+                           BAD_CAST "Part")) {
+      char **pair = apr_array_push(parts);
+
+      pair[0] = number;
+      pair[1] = etag;
     }
   }
+  xmlFreeTextReader(reader);
+  if (rc != 0 || parts->nelts == 0) {
+    return orangefs_s3_invalid_part(req, "MalformedXML",
+             "The XML you provided was not well-formed.");
+  }
 
-  entry_path = apr_pstrcat(req->pool, req->conf->pvfs_path, "/", 
-                           bucket, path, NULL);
+  rc = orangefs_s3_get_part_size(req, &ref, &part_size);
+  if (rc < 0) {
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
 
-  memset(&resp_lookup, 0, sizeof(PVFS_sysresp_lookup));
-  rc = PVFS_sys_lookup(req->conf->fsid, entry_path, req->root, 
-                       &resp_lookup, PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+  n = parts->nelts;
+  apr_md5_init(&md5_ctx);
+  for (i = 1; i <= n; i++) {
+    char **pair = &APR_ARRAY_IDX(parts, i - 1, char*);
+    char *tag = pair[1];
+
+    /* parts have to run 1, 2, 3... so that each is where the part
+       size puts it */
+    if (pair[0] == NULL || atoi(pair[0]) != i || tag == NULL ||
+        part_size == 0) {
+      return orangefs_s3_invalid_part(req, "InvalidPart",
+               "One or more of the specified parts could not be found.");
+    }
+    if (*tag == '"') {
+      tag++;
+    }
+    if (*tag && tag[strlen(tag) - 1] == '"') {
+      tag = apr_pstrndup(req->pool, tag, strlen(tag) - 1);
+    }
 
-  if (rc < 0) {
-    /* no such file */
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
-                 "PVFS_sys_lookup for %s returned %d.", entry_path, rc);
-    return HTTP_NOT_FOUND;
+    key.buffer = apr_psprintf(req->pool, "%s%d", EXT_ATTR_S3_UPLOAD_PART, i);
+    key.buffer_sz = strlen(key.buffer) + 1;
+    memset(record, 0, sizeof(record));
+    val.buffer = record;
+    val.buffer_sz = sizeof(record) - 1;
+
+    rc = PVFS_sys_geteattr(ref, req->credentials, &key, &val, NULL);
+    if (rc < 0 ||
+        sscanf(record, "%lld %32s %d", &part_length, part_md5, &staged) != 3 ||
+        strcmp(part_md5, tag) != 0 || part_length > part_size) {
+      return orangefs_s3_invalid_part(req, "InvalidPart",
+               "One or more of the specified parts could not be found.");
+    }
+
+    if (i < n && (part_length != part_size ||
+                  part_length < S3_MIN_PART_SIZE)) {
+      return orangefs_s3_invalid_part(req, "EntityTooSmall",
+               "Your proposed upload is smaller than the minimum allowed "
+               "object size.");
+    }
+
+    if (staged) {
+      rc = orangefs_s3_copy_range(req, &ref, orangefs_s3_stage_offset(i),
+                                  total, part_length);
+      if (rc < 0) {
+        ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                     "Unable to move part %d of %s into place: %d.",
+                     i, upload_name, rc);
+        return HTTP_INTERNAL_SERVER_ERROR;
+      }
+    }
+    total += part_length;
+
+    /* the entity tag of the object is the MD5 of its parts' MD5s */
+    for (j = 0; j < APR_MD5_DIGESTSIZE; j++) {
+      unsigned int byte;
+
+      sscanf(part_md5 + j * 2, "%2x", &byte);
+      md5[j] = (unsigned char)byte;
+    }
+    apr_md5_update(&md5_ctx, md5, APR_MD5_DIGESTSIZE);
   }
+  apr_md5_final(md5, &md5_ctx);
 
-  ref = &resp_lookup.ref;
-  PVFS_hint_import_env(&hints);
+  /* drops whatever is past the last part, staging included */
+  rc = PVFS_sys_truncate(ref, total, req->credentials, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_truncate returned %d.", rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
 
-  k.buffer = (void*)EXT_ATTR_S3_SIZE;
-  k.buffer_sz = strlen(k.buffer) + 1;
-  v.buffer = buffer;
-  v.buffer_sz = 4096;
+  orangefs_s3_clear_upload_attrs(req, &ref);
+  orangefs_s3_set_object_attrs(req, &ref,
+    apr_psprintf(req->pool, "%s-%d",
+                 orangefs_s3_bin_to_hex(req->pool, md5, APR_MD5_DIGESTSIZE),
+                 n),
+    total);
 
-  memset(buffer, 0, 4096);
-  rc = PVFS_sys_geteattr(resp_lookup.ref, req->credentials, &k, &v, NULL);
-  if (rc >= 0) {
-    memset(buffer2, 0, 256);
-    memcpy(buffer2, buffer, v.read_sz);
-    apr_table_setn(req->r->headers_out, "Content-Length", 
-                   apr_pstrdup(req->pool, (char*)buffer2));
+  orangefs_s3_split_path(req, bucket, path, &parent_path, &entry_name);
+  rc = PVFS_sys_rename(upload_name, parent_ref, entry_name, parent_ref,
+                       req->credentials, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_rename returned %d.", rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
   }
 
-  k.buffer = (void*)EXT_ATTR_S3_ENTITY_TAG;
-  k.buffer_sz = strlen(k.buffer) + 1;
-  v.buffer = buffer;
-  v.buffer_sz = 4096;
+  ap_rprintf(req->r, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+  ap_rprintf(req->r, "<CompleteMultipartUploadResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">");
+  ap_rprintf(req->r,   "<Location>http://%s%s</Location>",
+             req->r->hostname, ap_escape_html(req->pool, req->r->uri));
+  ap_rprintf(req->r,   "<Bucket>%s</Bucket>", bucket);
+  ap_rprintf(req->r,   "<Key>%s</Key>", ap_escape_html(req->pool, path + 1));
+  ap_rprintf(req->r,   "<ETag>&quot;%s-%d&quot;</ETag>",
+             orangefs_s3_bin_to_hex(req->pool, md5, APR_MD5_DIGESTSIZE), n);
+  ap_rprintf(req->r, "</CompleteMultipartUploadResult>");
 
-  memset(buffer, 0, 4096);
-  rc = PVFS_sys_geteattr(resp_lookup.ref, req->credentials, &k, &v, NULL);
-  if (rc >= 0) {
-    memset(buffer2, 0, 256);
-    memcpy(buffer2, buffer, v.read_sz);
-    apr_table_setn(req->r->headers_out, "ETag", 
-                   apr_pstrcat(req->pool, "\"", (char*)buffer2, "\"", NULL));
+  return OK;
+}
+
+/*
+   Abandons a multipart upload and frees the space of its parts.
+ */
+static int orangefs_s3_abort_upload(orangefs_s3_request *req,
+                                    char *bucket,
+                                    char *path,
+                                    const char *upload_id)
+{
+  char *upload_name;
+  PVFS_object_ref parent_ref, ref;
+  int rc;
+
+  if (debug_orangefs_s3) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_abort_upload %s for bucket %s path %s.",
+                 upload_id, bucket, path);
   }
 
-  /* if it's a HEAD request, return without content */
-  if (strcmp(req->r->method, "HEAD") == 0) {
-    return OK;
+  rc = orangefs_s3_lookup_upload(req, bucket, path, upload_id,
+                                 &parent_ref, &upload_name, &ref);
+  if (rc < 0) {
+    return orangefs_s3_no_such_upload(req, upload_id);
   }
 
-  do {
-    file_req = PVFS_BYTE;
-    rc = PVFS_Request_contiguous(4096, PVFS_BYTE, &mem_req);
-    if (rc < 0) {
-      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
-                   "PVFS_Request_contiguous returned rc %d.", rc);
-      return HTTP_INTERNAL_SERVER_ERROR;
-    }
+  rc = PVFS_sys_remove(upload_name, parent_ref, req->credentials, NULL);
+  if (rc < 0) {
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "PVFS_sys_remove returned %d.", rc);
+    return HTTP_INTERNAL_SERVER_ERROR;
+  }
 
-    rc = PVFS_sys_read(*ref, file_req, offset, buffer, mem_req, 
-                       req->credentials, &resp_io, hints);
-    if (rc < 0) {
-      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL, 
-                   "PVFS_sys_read returned rc %d.", rc);
-      return HTTP_INTERNAL_SERVER_ERROR;
-    }
+  return HTTP_NO_CONTENT;
+}
 
-    offset += resp_io.total_completed;
+/*
+   Handles the multipart upload operations on an object.  Returns
+   DECLINED if the request is not one of them.
+ */
+static int orangefs_s3_multipart(orangefs_s3_request *req,
+                                 char *bucket,
+                                 char *path)
+{
+  apr_array_header_t *uploads = NULL, *upload_id = NULL, *part = NULL;
 
-    ap_rwrite(buffer, resp_io.total_completed, req->r);
-  } while (resp_io.total_completed > 0);
+  if (req->params) {
+    uploads = apr_hash_get(req->params, "uploads", APR_HASH_KEY_STRING);
+    upload_id = apr_hash_get(req->params, "uploadId", APR_HASH_KEY_STRING);
+    part = apr_hash_get(req->params, "partNumber", APR_HASH_KEY_STRING);
+  }
 
-  PVFS_Request_free(&mem_req);
+  if (req->r->method_number == M_POST) {
+    if (uploads) {
+      return orangefs_s3_initiate_upload(req, bucket, path);
+    } else if (upload_id) {
+      return orangefs_s3_complete_upload(req, bucket, path,
+                                         APR_ARRAY_IDX(upload_id, 0, char*));
+    }
+    return HTTP_METHOD_NOT_ALLOWED;
+  } else if (req->r->method_number == M_PUT && upload_id && part) {
+    return orangefs_s3_upload_part(req, bucket, path,
+                                   APR_ARRAY_IDX(upload_id, 0, char*),
+                                   APR_ARRAY_IDX(part, 0, char*));
+  } else if (req->r->method_number == M_DELETE && upload_id) {
+    return orangefs_s3_abort_upload(req, bucket, path,
+                                    APR_ARRAY_IDX(upload_id, 0, char*));
+  }
 
-  return OK;
+  return DECLINED;
 }
 
 static int orangefs_s3_get_bucket_acl(orangefs_s3_request *req, char *bucket)
@@ -1136,110 +2047,183 @@ static int orangefs_s3_get_bucket_website(orangefs_s3_request *req,
 
 /*
   Each file and directory path is represented as a single object in an 
-  S3 bucket, without a hierarchy, so to speak. This routine is a callback 
-  routine to list the contents of an entire bucket, recursively treating 
-  each file as an object.
+  S3 bucket, without a hierarchy, so to speak.  This routine lists the 
+  objects under one directory of a bucket, recursing into its 
+  subdirectories.  Entries come S3_LIST_BATCH at a time from readdirplus, 
+  which also returns their attributes, and the S3 attributes of a whole 
+  batch come from one geteattr_bulk; each batch is sent to the client 
+  as soon as it is written.
 
   req is the original request
-  resource is the current resource being returned
-  userInfo is the optional parameter to be passed to each visitor callback
+  listInfo describes the bucket being listed
+  dir is the directory to list
+  key_prefix is the S3 key of dir within the bucket, with a trailing '/', 
+    or "" for the bucket itself
  */
-static void orangefs_s3_get_bucket_recurse(orangefs_s3_request *req, 
-                                           orangefs_s3_resource *resource, 
-                                           void *userInfo)
+static int orangefs_s3_list_objects(orangefs_s3_request *req, 
+                                    orangefs_s3_s3_list *listInfo,
+                                    PVFS_object_ref dir,
+                                    const char *key_prefix)
 {
-  orangefs_s3_s3_list *listInfo;
-  PVFS_ds_keyval key, val;
-  PVFS_sysresp_getattr resp_getattr;
-  char *s3_path = NULL;
+  enum { ETAG, SIZE, OWNER_ID, DISPLAY_NAME, NKEY };
+  const char *key_names[NKEY] = { EXT_ATTR_S3_ENTITY_TAG, EXT_ATTR_S3_SIZE,
+                                  EXT_ATTR_S3_OWNER_ID,
+                                  EXT_ATTR_S3_OWNER_DISPLAY_NAME };
+  PVFS_sysresp_readdirplus resp_readdirplus;
+  PVFS_sysresp_geteattr resp_geteattr;
+  PVFS_ds_keyval keys[NKEY];
+  PVFS_ds_keyval vals[S3_LIST_BATCH * NKEY];
+  PVFS_error errs[S3_LIST_BATCH * NKEY];
+  PVFS_handle handles[S3_LIST_BATCH];
+  int slot[S3_LIST_BATCH];
+  PVFS_ds_position token = PVFS_READDIR_START;
+  PVFS_object_ref child;
+  PVFS_sys_attr *attr;
+  char *buffers, *name, *v[NKEY];
   struct tm *time;
   char scratch_time[26];
-  int rc;
+  int nfiles, i, k, rc = OK;
 
   if (debug_orangefs_s3) {
-    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,"orangefs_s3_get_bucket_recurse:");
+    ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                 "orangefs_s3_list_objects: %s", key_prefix);
   }
 
-  if (resource->entry == NULL) {
-    return;
+  for (k = 0; k < NKEY; k++) {
+    keys[k].buffer = apr_pstrdup(req->pool, key_names[k]);
+    keys[k].buffer_sz = strlen(key_names[k]) + 1;
   }
-
-  memset(&resp_getattr, 0, sizeof(PVFS_sysresp_getattr));
-  if ((rc = PVFS_sys_getattr(resource->obj, PVFS_ATTR_SYS_ALL_NOHINT, 
-                             req->credentials, &resp_getattr, NULL)) != 0) {
-    return;
+  /* each level of the recursion needs its own values, but only while 
+     it runs, so they do not come from the request pool */
+  buffers = malloc(S3_LIST_BATCH * NKEY * S3_LIST_VALUE_SIZE);
+  if (buffers == NULL) {
+    return HTTP_INTERNAL_SERVER_ERROR;
   }
-
-  if (resp_getattr.attr.objtype == PVFS_TYPE_DIRECTORY) {
-    return;
+  for (i = 0; i < S3_LIST_BATCH * NKEY; i++) {
+    vals[i].buffer = buffers + i * S3_LIST_VALUE_SIZE;
   }
 
-  listInfo = (orangefs_s3_s3_list *)userInfo;
-
-  ap_rprintf(req->r,   "<Contents>");
-
-  /* the resource->pvfs_path includes the full bucket path as well, 
-     so we need to strip that off */
-  s3_path = strstr(resource->pvfs_path, listInfo->bucket) + 
-            strlen(listInfo->bucket) + 1;
+  do {
+    memset(&resp_readdirplus, 0, sizeof(PVFS_sysresp_readdirplus));
+    rc = PVFS_sys_readdirplus(dir, token, S3_LIST_BATCH, req->credentials,
+                              PVFS_ATTR_SYS_ALL_NOHINT, &resp_readdirplus,
+                              NULL);
+    if (rc < 0) {
+      ap_log_error(APLOG_MARK,APLOG_ERR,0,NULL,
+                   "PVFS_sys_readdirplus returned %d.", rc);
+      free(buffers);
+      return HTTP_INTERNAL_SERVER_ERROR;
+    }
+    rc = OK;
+
+    /* the files of this batch, which are the objects; multipart uploads 
+       in progress are not objects yet */
+    nfiles = 0;
+    for (i = 0; i < resp_readdirplus.pvfs_dirent_outcount; i++) {
+      slot[i] = -1;
+      if (resp_readdirplus.stat_err_array[i] != 0 ||
+          resp_readdirplus.attr_array[i].objtype == PVFS_TYPE_DIRECTORY ||
+          strncmp(resp_readdirplus.dirent_array[i].d_name, S3_UPLOAD_PREFIX,
+                  strlen(S3_UPLOAD_PREFIX)) == 0) {
+        continue;
+      }
+      slot[i] = nfiles;
+      handles[nfiles++] = resp_readdirplus.dirent_array[i].handle;
+    }
 
-  ap_rprintf(req->r,     "<Key>%s</Key>", s3_path);
+    for (i = 0; i < nfiles * NKEY; i++) {
+      vals[i].buffer_sz = S3_LIST_VALUE_SIZE;
+    }
+    resp_geteattr.val_array = vals;
+    resp_geteattr.err_array = errs;
+    if (nfiles > 0 &&
+        PVFS_sys_geteattr_bulk(dir, nfiles, handles, req->credentials,
+                               NKEY, keys, &resp_geteattr, NULL) < 0) {
+      /* list the objects without their S3 attributes */
+      for (i = 0; i < nfiles * NKEY; i++) {
+        errs[i] = -PVFS_EIO;
+      }
+    }
 
-  time = localtime((const time_t*)&resp_getattr.attr.ctime);
-  strftime(scratch_time, 26, "%FT%H:%M:%S.000Z", time);
-  ap_rprintf(req->r,   "<LastModified>%s</LastModified>", scratch_time);
+    for (i = 0; i < resp_readdirplus.pvfs_dirent_outcount && rc == OK; i++) {
+      name = resp_readdirplus.dirent_array[i].d_name;
+      attr = &resp_readdirplus.attr_array[i];
+
+      if (resp_readdirplus.stat_err_array[i] == 0 &&
+          attr->objtype == PVFS_TYPE_DIRECTORY) {
+        child.handle = resp_readdirplus.dirent_array[i].handle;
+        child.fs_id = dir.fs_id;
+        rc = orangefs_s3_list_objects(req, listInfo, child, 
+                 apr_pstrcat(req->pool, key_prefix, name, "/", NULL));
+        continue;
+      }
+      if (slot[i] < 0) {
+        continue;
+      }
 
-  key.buffer = apr_pstrdup(req->pool, EXT_ATTR_S3_ENTITY_TAG);
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = apr_pcalloc(req->pool, 4096);
-  val.buffer_sz = 4096;
+      /* values are strings, but make sure of the terminator */
+      for (k = 0; k < NKEY; k++) {
+        PVFS_ds_keyval *val = &vals[slot[i] * NKEY + k];
 
-  rc = PVFS_sys_geteattr(resource->obj, req->credentials, &key, &val, NULL);
-  if (rc >= 0) {
-    ap_rprintf(req->r, "<ETag>&quot;%s&quot;</ETag>", (char*)val.buffer);
-  } else {
-    ap_rprintf(req->r, 
-               "<ETag>&quot;00000000000000000000000000000000&quot;</ETag>");
-  }
+        v[k] = NULL;
+        if (errs[slot[i] * NKEY + k] == 0) {
+          v[k] = val->buffer;
+          v[k][val->read_sz < S3_LIST_VALUE_SIZE ?
+               val->read_sz : S3_LIST_VALUE_SIZE - 1] = 0;
+        }
+      }
 
-  key.buffer = apr_pstrdup(req->pool, EXT_ATTR_S3_SIZE);
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = apr_pcalloc(req->pool, 4096);
-  val.buffer_sz = 4096;
+      ap_rprintf(req->r,   "<Contents>");
+      ap_rprintf(req->r,     "<Key>%s%s</Key>", key_prefix, name);
 
-  rc = PVFS_sys_geteattr(resource->obj, req->credentials, &key, &val, NULL);
-  if (rc >= 0) {
-    ap_rprintf(req->r,   "<Size>%s</Size>", (char*)val.buffer);
-  } else {
-    ap_rprintf(req->r,   "<Size>%lu</Size>", resp_getattr.attr.size);
-  }
+      time = localtime((const time_t*)&attr->ctime);
+      strftime(scratch_time, 26, "%FT%H:%M:%S.000Z", time);
+      ap_rprintf(req->r,   "<LastModified>%s</LastModified>", scratch_time);
 
-  ap_rprintf(req->r,     "<StorageClass>STANDARD</StorageClass>");
+      if (v[ETAG] != NULL) {
+        ap_rprintf(req->r, "<ETag>&quot;%s&quot;</ETag>", v[ETAG]);
+      } else {
+        ap_rprintf(req->r, 
+                   "<ETag>&quot;00000000000000000000000000000000&quot;</ETag>");
+      }
 
-  ap_rprintf(req->r,     "<Owner>");
+      if (v[SIZE] != NULL) {
+        ap_rprintf(req->r,   "<Size>%s</Size>", v[SIZE]);
+      } else {
+        ap_rprintf(req->r,   "<Size>%lld</Size>", (long long)attr->size);
+      }
 
-  key.buffer = apr_pstrdup(req->pool, EXT_ATTR_S3_OWNER_ID);
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = apr_pcalloc(req->pool, 4096);
-  val.buffer_sz = 4096;
+      ap_rprintf(req->r,     "<StorageClass>STANDARD</StorageClass>");
 
-  rc = PVFS_sys_geteattr(resource->obj, req->credentials, &key, &val, NULL);
-  if (rc >= 0)
-    ap_rprintf(req->r,     "<ID>%s</ID>", (char*)val.buffer);
+      ap_rprintf(req->r,     "<Owner>");
+      if (v[OWNER_ID] != NULL) {
+        ap_rprintf(req->r,     "<ID>%s</ID>", v[OWNER_ID]);
+      }
+      if (v[DISPLAY_NAME] != NULL) {
+        ap_rprintf(req->r,     "<DisplayName>%s</DisplayName>", v[DISPLAY_NAME]);
+      }
+      ap_rprintf(req->r,     "</Owner>");
 
-  key.buffer = apr_pstrdup(req->pool, EXT_ATTR_S3_OWNER_DISPLAY_NAME);
-  key.buffer_sz = strlen(key.buffer) + 1;
-  val.buffer = apr_pcalloc(req->pool, 4096);
-  val.buffer_sz = 4096;
+      ap_rprintf(req->r,   "</Contents>");
+    }
 
-  rc = PVFS_sys_geteattr(resource->obj, req->credentials, &key, &val, NULL);
-  if (rc >= 0) {
-    ap_rprintf(req->r,     "<DisplayName>%s</DisplayName>", (char*)val.buffer);
-  }
+    /* let the client have this batch while the next one is read */
+    ap_rflush(req->r);
 
-  ap_rprintf(req->r,     "</Owner>");
+    token = resp_readdirplus.token;
+    for (i = 0; i < resp_readdirplus.pvfs_dirent_outcount; i++) {
+      if (resp_readdirplus.stat_err_array[i] == 0) {
+        PVFS_util_release_sys_attr(&resp_readdirplus.attr_array[i]);
+      }
+    }
+    free(resp_readdirplus.dirent_array);
+    free(resp_readdirplus.stat_err_array);
+    free(resp_readdirplus.attr_array);
+  } while (rc == OK && resp_readdirplus.pvfs_dirent_outcount > 0 &&
+           token != PVFS_READDIR_END && !req->conf->quit);
 
-  ap_rprintf(req->r,   "</Contents>");
+  free(buffers);
+  return rc;
 }
 
 static int orangefs_s3_delete_bucket(orangefs_s3_request *req, char *bucket)
@@ -1398,7 +2382,6 @@ static int orangefs_s3_get_bucket(orangefs_s3_request *req, char *bucket)
   char *prefix = NULL;
   PVFS_sysresp_lookup resp_lookup;
   char pvfs_path[PVFS_NAME_MAX];
-  orangefs_s3_resource resource;
   orangefs_s3_s3_list listInfo;
   int rc;
 
@@ -1518,12 +2501,7 @@ static int orangefs_s3_get_bucket(orangefs_s3_request *req, char *bucket)
   listInfo.marker = marker;
   listInfo.delimiter = delimiter;
 
-  resource.pvfs_path = pvfs_path;
-  resource.entry = NULL;
-  memcpy(&resource.obj, &resp_lookup.ref, sizeof(resp_lookup.ref));
-
-  rc = orangefs_s3_recurse(req, &resource, &listInfo, 
-                           orangefs_s3_get_bucket_recurse);
+  rc = orangefs_s3_list_objects(req, &listInfo, resp_lookup.ref, "");
 
   ap_rprintf(req->r, "</ListBucketResult>");
 
@@ -1699,7 +2677,10 @@ static int orangefs_s3(orangefs_s3_request *req)
                      "Processing s3 object request for bucket %s, object %s.", 
                      bucket, path);
 
-        if (req->r->method_number == M_GET) {
+        rc = orangefs_s3_multipart(req, bucket, path);
+        if (rc != DECLINED) {
+          /* multipart upload operation */
+        } else if (req->r->method_number == M_GET) {
           rc = orangefs_s3_get_object(req, bucket, path);
         } else if (req->r->method_number == M_PUT) {
           rc = orangefs_s3_put_object(req, bucket, path);
@@ -1739,7 +2720,10 @@ static int orangefs_s3(orangefs_s3_request *req)
                    "Processing s3 object request for bucket %s, object %s.", 
                    bucket, req->r->uri);
 
-      if (req->r->method_number == M_GET) {
+      rc = orangefs_s3_multipart(req, bucket, req->r->uri);
+      if (rc != DECLINED) {
+        /* multipart upload operation */
+      } else if (req->r->method_number == M_GET) {
         rc = orangefs_s3_get_object(req, bucket, req->r->uri);
       } else if (req->r->method_number == M_PUT) {
         /* check if this a PUT/copy or just a PUT by checking the 
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #ifdef WIN32
@@ -23,6 +24,9 @@
 #else
 #include <syslog.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include "pvfs2-internal.h"
@@ -43,7 +47,8 @@ enum
 {
     GOSSIP_STDERR = 1,
     GOSSIP_FILE = 2,
-    GOSSIP_SYSLOG = 4
+    GOSSIP_SYSLOG = 4,
+    GOSSIP_ASYNC = 8
 };
 
 /** determines which logging facility to use.  Default to stderr to begin
@@ -62,14 +67,88 @@ static int internal_syslog_priority = LOG_INFO;
 /* what type of timestamp to put on logs */
 static enum gossip_logstamp internal_logstamp = GOSSIP_LOGSTAMP_DEFAULT;
 
+#if !defined(WIN32) && defined(__GEN_POSIX_LOCKING__)
+#define GOSSIP_HAVE_ASYNC
+
+/* default size of each thread's staging buffer for async logging */
+#define GOSSIP_ASYNC_BUFFER_DEFAULT (256 * 1024)
+
+/* how often (in msecs) the writer drains the staging buffers when no
+ * thread has woken it up
+ */
+#define GOSSIP_ASYNC_INTERVAL_MS 100
+
+/* most iovecs handed to a single writev() */
+#define GOSSIP_ASYNC_IOV 64
+
+/* number of message sites tracked for rate limiting (power of two) */
+#define GOSSIP_ASYNC_SITES 1024
+
+/* Staging buffer owned by one logging thread.  Only the owning thread
+ * moves head and only the writer thread moves tail, so messages are
+ * staged without taking a lock.  Both are free running byte counts that
+ * are taken modulo size (a power of two) to index data.
+ */
+struct gossip_async_buf
+{
+    struct gossip_async_buf *next;
+    char *data;
+    uint32_t size;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint64_t dropped;  /* messages lost because data was full */
+    int orphaned;               /* owning thread has exited */
+};
+
+/* rate limiting state for one message site, identified by the address
+ * of its format string
+ */
+struct gossip_async_site
+{
+    const char *format;
+    volatile time_t window;     /* second the count applies to */
+    volatile uint32_t count;
+    volatile uint32_t suppressed;
+};
+
+/* protects the buffer list, the log file and the writer state */
+static gen_mutex_t async_mutex = GEN_MUTEX_INITIALIZER;
+static pthread_cond_t async_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t async_thread;
+static pthread_key_t async_key;
+static pthread_once_t async_key_once = PTHREAD_ONCE_INIT;
+static struct gossip_async_buf *async_bufs = NULL;
+static int async_fd = -1;
+static int async_running = 0;
+static volatile int async_wakeup = 0;
+static uint32_t async_buffer_size = GOSSIP_ASYNC_BUFFER_DEFAULT;
+static int async_rate_limit = 0;
+static struct gossip_async_site async_sites[GOSSIP_ASYNC_SITES];
+static volatile uint64_t async_suppressed = 0;
+static uint64_t async_dropped_retired = 0;
+static uint64_t async_dropped_reported = 0;
+
+static int gossip_reopen_async(const char *filename, const char *mode);
+static void gossip_async_drain(void);
+static int gossip_async_write_now(const char *msg, int len);
+#endif
+
 /*****************************************************************
  * prototypes
  */
 static int gossip_disable_stderr(void);
 static int gossip_disable_file(void);
 
+static int gossip_format_va(char *buffer, int size, char prefix,
+    const char *format, va_list ap, enum gossip_logstamp ts);
 static int gossip_debug_fp_va(FILE *fp, char prefix, const char *format, va_list ap, enum
 gossip_logstamp ts);
+static int gossip_async_va(char prefix, const char *format, va_list ap);
+static int gossip_disable_async(void);
+#ifdef GOSSIP_HAVE_ASYNC
+static void gossip_async_key_create(void);
+static void *gossip_async_writer(void *arg);
+#endif
 static int gossip_debug_syslog(
     char prefix,
     const char *format,
@@ -182,10 +261,155 @@ int gossip_enable_file(
     return 0;
 }
 
+/** Turns on asynchronous logging to a file.  Messages are formatted by
+ *  the calling thread into a per-thread staging buffer of buffer_size
+ *  bytes (0 selects a default) and written to the file in batches by a
+ *  background thread, so logging does not block on disk I/O.  Messages
+ *  that arrive while a staging buffer is full are dropped and counted.
+ *  If rate_limit is greater than zero, at most that many messages per
+ *  second are accepted from each message site.  Error messages are never
+ *  rate limited, and are written out before gossip_err() returns.
+ *
+ *  \return 0 on success, -errno on failure.
+ */
+#ifdef GOSSIP_HAVE_ASYNC
+int gossip_enable_async(
+    const char *filename,
+    const char *mode,
+    int buffer_size,
+    int rate_limit)
+{
+    /* keep up with the existing logging settings */
+    int tmp_debug_on = gossip_debug_on;
+    uint64_t tmp_debug_mask = gossip_debug_mask;
+    int flags = O_WRONLY | O_CREAT;
+    uint32_t size = 1;
+    int ret;
+
+    /* turn off any running facility */
+    gossip_disable();
+
+    pthread_once(&async_key_once, gossip_async_key_create);
+
+    flags |= ((mode && mode[0] == 'w') ? O_TRUNC : O_APPEND);
+    async_fd = open(filename, flags, 0666);
+    if (async_fd < 0)
+    {
+        return -errno;
+    }
+
+    if (buffer_size <= 0)
+    {
+        buffer_size = GOSSIP_ASYNC_BUFFER_DEFAULT;
+    }
+    if (buffer_size < 2 * GOSSIP_BUF_SIZE)
+    {
+        buffer_size = 2 * GOSSIP_BUF_SIZE;
+    }
+    while (size < (uint32_t)buffer_size)
+    {
+        size <<= 1;
+    }
+    async_buffer_size = size;
+    async_rate_limit = rate_limit;
+    memset(async_sites, 0, sizeof(async_sites));
+
+    async_running = 1;
+    ret = pthread_create(&async_thread, NULL, gossip_async_writer, NULL);
+    if (ret != 0)
+    {
+        async_running = 0;
+        close(async_fd);
+        async_fd = -1;
+        return -ret;
+    }
+
+    gossip_facility = GOSSIP_ASYNC;
+
+    /* restore the logging settings */
+    gossip_debug_on = tmp_debug_on;
+    gossip_debug_mask = tmp_debug_mask;
+
+    return 0;
+}
+#else
+int gossip_enable_async(
+    const char *filename,
+    const char *mode,
+    int buffer_size,
+    int rate_limit)
+{
+    return -ENOSYS;
+}
+#endif
+
+/** Writes out any messages that have been logged but not yet written.
+ *
+ *  \return 0 on success, -errno on failure.
+ */
+int gossip_flush(
+    void)
+{
+    switch (gossip_facility)
+    {
+    case GOSSIP_STDERR:
+        fflush(stderr);
+        break;
+    case GOSSIP_FILE:
+        fflush(internal_log_file);
+        break;
+#ifdef GOSSIP_HAVE_ASYNC
+    case GOSSIP_ASYNC:
+        gen_mutex_lock(&async_mutex);
+        gossip_async_drain();
+        gen_mutex_unlock(&async_mutex);
+        break;
+#endif
+    default:
+        break;
+    }
+    return 0;
+}
+
+/** Fills in the number of messages dropped because a staging buffer was
+ *  full, and the number suppressed by rate limiting, since the program
+ *  started.  Both are zero unless asynchronous logging has been used.
+ */
+void gossip_get_async_stats(
+    uint64_t *dropped,
+    uint64_t *suppressed)
+{
+#ifdef GOSSIP_HAVE_ASYNC
+    struct gossip_async_buf *buf;
+    uint64_t total;
+
+    gen_mutex_lock(&async_mutex);
+    total = async_dropped_retired;
+    for (buf = async_bufs; buf; buf = buf->next)
+    {
+        total += buf->dropped;
+    }
+    gen_mutex_unlock(&async_mutex);
+
+    *dropped = total;
+    *suppressed = async_suppressed;
+#else
+    *dropped = 0;
+    *suppressed = 0;
+#endif
+}
+
 int gossip_reopen_file(
     const char *filename,
     const char *mode)
 {
+#ifdef GOSSIP_HAVE_ASYNC
+    if( gossip_facility == GOSSIP_ASYNC )
+    {
+        return gossip_reopen_async(filename, mode);
+    }
+#endif
+
     if( gossip_facility != GOSSIP_FILE )
     {
         return -EINVAL;
@@ -219,6 +443,9 @@ int gossip_disable(
     case GOSSIP_SYSLOG:
         ret = gossip_disable_syslog();
         break;
+    case GOSSIP_ASYNC:
+        ret = gossip_disable_async();
+        break;
     default:
         break;
     }
@@ -358,6 +585,9 @@ int __gossip_debug_va(
     case GOSSIP_SYSLOG:
         ret = gossip_debug_syslog(prefix, format, ap);
         break;
+    case GOSSIP_ASYNC:
+        ret = gossip_async_va(prefix, format, ap);
+        break;
     default:
         break;
     }
@@ -397,6 +627,9 @@ int gossip_err(
     case GOSSIP_SYSLOG:
         ret = gossip_err_syslog(format, ap);
         break;
+    case GOSSIP_ASYNC:
+        ret = gossip_async_va('E', format, ap);
+        break;
     default:
         break;
     }
@@ -507,18 +740,18 @@ int gossip_debug_fp(FILE *fp, char prefix,
     return ret;
 }
 
-/* gossip_debug_fp_va()
- * 
- * This is the standard debugging message function for the file logging
- * facility or to stderr.
+/* gossip_format_va()
  *
- * returns 0 on success, -errno on failure
+ * Formats a message with its prefix and timestamp into buffer.  Messages
+ * that do not fit are truncated.
+ *
+ * returns length of the formatted message on success, -errno on failure
  */
-static int gossip_debug_fp_va(FILE *fp, char prefix,
+static int gossip_format_va(char *buffer, int size, char prefix,
     const char *format, va_list ap, enum gossip_logstamp ts)
 {
-    char buffer[GOSSIP_BUF_SIZE], *bptr = buffer;
-    int bsize = sizeof(buffer), temp_size;
+    char *bptr = buffer;
+    int bsize = size, temp_size;
     int ret = -EINVAL;
     struct timeval tv;
     time_t tp;
@@ -583,8 +816,38 @@ static int gossip_debug_fp_va(FILE *fp, char prefix,
     {
         return -errno;
     }
+    if (ret == -1)
+    {
+        ret = bsize - 1;
+    }
 #endif
 
+    if (ret >= bsize)
+    {
+        ret = bsize - 1;
+    }
+    return (int)(bptr - buffer) + ret;
+}
+
+/* gossip_debug_fp_va()
+ * 
+ * This is the standard debugging message function for the file logging
+ * facility or to stderr.
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_debug_fp_va(FILE *fp, char prefix,
+    const char *format, va_list ap, enum gossip_logstamp ts)
+{
+    char buffer[GOSSIP_BUF_SIZE];
+    int ret = -EINVAL;
+
+    ret = gossip_format_va(buffer, sizeof(buffer), prefix, format, ap, ts);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
     ret = fprintf(fp, "%s", buffer);
     if (ret < 0)
     {
@@ -684,6 +947,544 @@ static int gossip_disable_syslog(
 }
 #endif
 
+#ifdef GOSSIP_HAVE_ASYNC
+/* gossip_async_key_release()
+ *
+ * thread exit hook for a staging buffer.  The writer frees the buffer
+ * once it has been drained; if no writer is running it is freed here.
+ *
+ * no return value
+ */
+static void gossip_async_key_release(void *arg)
+{
+    struct gossip_async_buf *buf = arg, **prev;
+
+    gen_mutex_lock(&async_mutex);
+    buf->orphaned = 1;
+    if (!async_running)
+    {
+        for (prev = &async_bufs; *prev; prev = &(*prev)->next)
+        {
+            if (*prev == buf)
+            {
+                *prev = buf->next;
+                break;
+            }
+        }
+        async_dropped_retired += buf->dropped;
+        free(buf->data);
+        free(buf);
+    }
+    gen_mutex_unlock(&async_mutex);
+}
+
+/* fork handlers: the writer thread does not survive fork(), so the
+ * child starts its own to keep a daemonized process logging
+ */
+static void gossip_async_prefork(void)
+{
+    gen_mutex_lock(&async_mutex);
+}
+
+static void gossip_async_postfork_parent(void)
+{
+    gen_mutex_unlock(&async_mutex);
+}
+
+static void gossip_async_postfork_child(void)
+{
+    gen_mutex_unlock(&async_mutex);
+    if (async_running &&
+        pthread_create(&async_thread, NULL, gossip_async_writer, NULL) != 0)
+    {
+        async_running = 0;
+    }
+}
+
+static void gossip_async_key_create(void)
+{
+    pthread_key_create(&async_key, gossip_async_key_release);
+    pthread_atfork(gossip_async_prefork, gossip_async_postfork_parent,
+                   gossip_async_postfork_child);
+}
+
+/* gossip_async_buf_get()
+ *
+ * finds (or creates) the staging buffer of the calling thread
+ *
+ * returns pointer to buffer on success, NULL on failure
+ */
+static struct gossip_async_buf *gossip_async_buf_get(void)
+{
+    struct gossip_async_buf *buf;
+
+    buf = pthread_getspecific(async_key);
+    if (buf)
+    {
+        return buf;
+    }
+
+    buf = calloc(1, sizeof(*buf));
+    if (!buf)
+    {
+        return NULL;
+    }
+    buf->size = async_buffer_size;
+    buf->data = malloc(buf->size);
+    if (!buf->data)
+    {
+        free(buf);
+        return NULL;
+    }
+    pthread_setspecific(async_key, buf);
+
+    gen_mutex_lock(&async_mutex);
+    buf->next = async_bufs;
+    async_bufs = buf;
+    gen_mutex_unlock(&async_mutex);
+
+    return buf;
+}
+
+/* gossip_async_buf_put()
+ *
+ * copies a formatted message into a staging buffer.  Called only by the
+ * thread that owns the buffer.  The writer is woken when the buffer
+ * passes half full.
+ *
+ * returns 0 on success, -EAGAIN if the message was dropped
+ */
+static int gossip_async_buf_put(struct gossip_async_buf *buf,
+    const char *msg, uint32_t len)
+{
+    uint32_t head = buf->head, tail, used, off, first;
+
+    tail = buf->tail;
+    /* do not reuse space until the writer is done reading it */
+    __sync_synchronize();
+
+    used = head - tail;
+    if (len > buf->size - used)
+    {
+        buf->dropped++;
+        return -EAGAIN;
+    }
+
+    off = head & (buf->size - 1);
+    first = buf->size - off;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(buf->data + off, msg, first);
+    memcpy(buf->data, msg + first, len - first);
+
+    /* make the message visible before publishing the new head */
+    __sync_synchronize();
+    buf->head = head + len;
+
+    if (used <= buf->size / 2 && used + len > buf->size / 2)
+    {
+        async_wakeup = 1;
+        pthread_cond_signal(&async_cond);
+    }
+    return 0;
+}
+
+/* gossip_async_rate_check()
+ *
+ * applies the per-site rate limit to a message.  Threads update the site
+ * table without locking, so the limit is approximate under contention.
+ * When a site's first message of a new second is accepted, *suppressed
+ * is set to the number of its messages rejected in the previous window.
+ *
+ * returns 1 if the message should be logged, 0 if not
+ */
+static int gossip_async_rate_check(const char *format, uint32_t *suppressed)
+{
+    uintptr_t key = (uintptr_t)format;
+    struct gossip_async_site *site;
+    time_t now = time(NULL);
+
+    *suppressed = 0;
+    key ^= key >> 12;
+    site = &async_sites[(key >> 3) & (GOSSIP_ASYNC_SITES - 1)];
+
+    if (site->format != format || site->window != now)
+    {
+        if (site->format == format)
+        {
+            *suppressed = site->suppressed;
+        }
+        site->format = format;
+        site->window = now;
+        site->count = 0;
+        site->suppressed = 0;
+    }
+
+    if (__sync_add_and_fetch(&site->count, 1) > (uint32_t)async_rate_limit)
+    {
+        __sync_fetch_and_add(&site->suppressed, 1);
+        __sync_fetch_and_add(&async_suppressed, 1);
+        return 0;
+    }
+    return 1;
+}
+
+/* gossip_format()
+ *
+ * variable argument version of gossip_format_va()
+ */
+static int gossip_format(char *buffer, int size, char prefix,
+    const char *format, ...)
+{
+    int ret;
+    va_list ap;
+
+    va_start(ap, format);
+    ret = gossip_format_va(buffer, size, prefix, format, ap,
+        internal_logstamp);
+    va_end(ap);
+    return ret;
+}
+
+/* gossip_async_va()
+ *
+ * message function for the asynchronous logging facility; formats the
+ * message into the calling thread's staging buffer
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_async_va(char prefix, const char *format, va_list ap)
+{
+    char buffer[GOSSIP_BUF_SIZE];
+    struct gossip_async_buf *buf;
+    uint32_t suppressed = 0;
+    int len;
+
+    if (prefix == 'E')
+    {
+        len = gossip_format_va(buffer, sizeof(buffer), prefix, format, ap,
+            internal_logstamp);
+        if (len < 0)
+        {
+            return len;
+        }
+        return gossip_async_write_now(buffer, len);
+    }
+
+    if (async_rate_limit > 0 && !gossip_async_rate_check(format, &suppressed))
+    {
+        return 0;
+    }
+
+    buf = gossip_async_buf_get();
+    if (!buf)
+    {
+        return -ENOMEM;
+    }
+
+    if (suppressed)
+    {
+        len = gossip_format(buffer, sizeof(buffer), 'W',
+            "gossip: suppressed %u messages like: %.60s%s", suppressed,
+            format, (strlen(format) > 60 ? "...\n" : ""));
+        if (len > 0)
+        {
+            gossip_async_buf_put(buf, buffer, len);
+        }
+    }
+
+    len = gossip_format_va(buffer, sizeof(buffer), prefix, format, ap,
+        internal_logstamp);
+    if (len < 0)
+    {
+        return len;
+    }
+    gossip_async_buf_put(buf, buffer, len);
+    return 0;
+}
+
+/* gossip_async_writev()
+ *
+ * writes an iovec array to the log file, retrying short writes
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_async_writev(struct iovec *iov, int count)
+{
+    ssize_t ret;
+
+    while (count > 0)
+    {
+        ret = writev(async_fd, iov, count);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -errno;
+        }
+        while (count > 0 && (size_t)ret >= iov->iov_len)
+        {
+            ret -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return 0;
+}
+
+/* gossip_async_drain()
+ *
+ * writes everything staged so far to the log file, reports new drops,
+ * and frees the drained buffers of exited threads.  Caller must hold
+ * async_mutex.
+ *
+ * no return value
+ */
+static void gossip_async_drain(void)
+{
+    struct iovec iov[GOSSIP_ASYNC_IOV];
+    struct gossip_async_buf *pending[GOSSIP_ASYNC_IOV];
+    uint32_t pending_head[GOSSIP_ASYNC_IOV];
+    struct gossip_async_buf *buf, **prev;
+    uint32_t head, tail, off, len, first;
+    uint64_t dropped = async_dropped_retired;
+    char msg[128];
+    int niov = 0, nbuf = 0, i, ret;
+
+    for (buf = async_bufs; buf; buf = buf->next)
+    {
+        head = buf->head;
+        /* read the message bytes only after seeing the head */
+        __sync_synchronize();
+        tail = buf->tail;
+        dropped += buf->dropped;
+        if (head == tail)
+        {
+            continue;
+        }
+
+        if (niov + 2 > GOSSIP_ASYNC_IOV)
+        {
+            gossip_async_writev(iov, niov);
+            __sync_synchronize();
+            for (i = 0; i < nbuf; i++)
+            {
+                pending[i]->tail = pending_head[i];
+            }
+            niov = nbuf = 0;
+        }
+
+        off = tail & (buf->size - 1);
+        len = head - tail;
+        first = buf->size - off;
+        if (first > len)
+        {
+            first = len;
+        }
+        iov[niov].iov_base = buf->data + off;
+        iov[niov++].iov_len = first;
+        if (len > first)
+        {
+            iov[niov].iov_base = buf->data;
+            iov[niov++].iov_len = len - first;
+        }
+        pending[nbuf] = buf;
+        pending_head[nbuf++] = head;
+    }
+
+    if (niov)
+    {
+        /* on a write error the messages are lost; there is nowhere
+         * better to report it than the log itself
+         */
+        gossip_async_writev(iov, niov);
+        __sync_synchronize();
+        for (i = 0; i < nbuf; i++)
+        {
+            pending[i]->tail = pending_head[i];
+        }
+    }
+
+    prev = &async_bufs;
+    while ((buf = *prev))
+    {
+        if (buf->orphaned && buf->head == buf->tail)
+        {
+            *prev = buf->next;
+            async_dropped_retired += buf->dropped;
+            free(buf->data);
+            free(buf);
+        }
+        else
+        {
+            prev = &buf->next;
+        }
+    }
+
+    if (dropped != async_dropped_reported)
+    {
+        ret = gossip_format(msg, sizeof(msg), 'W',
+            "gossip: dropped %llu messages, staging buffers full\n",
+            llu(dropped - async_dropped_reported));
+        if (ret > 0)
+        {
+            iov[0].iov_base = msg;
+            iov[0].iov_len = ret;
+            gossip_async_writev(iov, 1);
+        }
+        async_dropped_reported = dropped;
+    }
+}
+
+/* gossip_async_write_now()
+ *
+ * writes an error message to the log file before returning, since the
+ * process may not live long enough for the writer to get to it, and
+ * since a signal handler must not stage into the buffer of the thread
+ * it interrupted.  Whatever was staged before is written first, unless
+ * another thread holds async_mutex; waiting for it could deadlock a
+ * signal handler.
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_async_write_now(const char *msg, int len)
+{
+    struct iovec iov;
+    int locked, ret;
+
+    locked = (gen_mutex_trylock(&async_mutex) == 0);
+    if (locked)
+    {
+        gossip_async_drain();
+    }
+    iov.iov_base = (char *)msg;
+    iov.iov_len = len;
+    ret = gossip_async_writev(&iov, 1);
+    if (locked)
+    {
+        gen_mutex_unlock(&async_mutex);
+    }
+    return ret;
+}
+
+/* gossip_async_writer()
+ *
+ * background thread that drains the staging buffers until the async
+ * facility is disabled
+ */
+static void *gossip_async_writer(void *arg)
+{
+    struct timeval tv;
+    struct timespec ts;
+
+    gen_mutex_lock(&async_mutex);
+    while (async_running)
+    {
+        if (!async_wakeup)
+        {
+            gettimeofday(&tv, NULL);
+            tv.tv_usec += GOSSIP_ASYNC_INTERVAL_MS * 1000;
+            ts.tv_sec = tv.tv_sec + tv.tv_usec / 1000000;
+            ts.tv_nsec = (tv.tv_usec % 1000000) * 1000;
+            pthread_cond_timedwait(&async_cond, &async_mutex, &ts);
+        }
+        async_wakeup = 0;
+        gossip_async_drain();
+    }
+    gossip_async_drain();
+    gen_mutex_unlock(&async_mutex);
+
+    return NULL;
+}
+
+/* gossip_reopen_async()
+ *
+ * drains the staging buffers and switches the async facility to a new
+ * file, to allow log rotation
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_reopen_async(const char *filename, const char *mode)
+{
+    int flags = O_WRONLY | O_CREAT;
+    int fd, ret = 0;
+
+    flags |= ((mode && mode[0] == 'w') ? O_TRUNC : O_APPEND);
+
+    gen_mutex_lock(&async_mutex);
+    gossip_async_drain();
+    fd = open(filename, flags, 0666);
+    if (fd < 0)
+    {
+        /* keep logging to the old file */
+        ret = -errno;
+    }
+    else
+    {
+        close(async_fd);
+        async_fd = fd;
+    }
+    gen_mutex_unlock(&async_mutex);
+
+    return ret;
+}
+
+/* gossip_disable_async()
+ *
+ * The shutdown function for the asynchronous logging facility.  Stops
+ * the writer after it has written out all staged messages.
+ *
+ * returns 0 on success, -errno on failure
+ */
+static int gossip_disable_async(
+    void)
+{
+    int running;
+
+    gen_mutex_lock(&async_mutex);
+    running = async_running;
+    async_running = 0;
+    pthread_cond_signal(&async_cond);
+    if (!running)
+    {
+        /* the writer could not be restarted after a fork */
+        gossip_async_drain();
+    }
+    gen_mutex_unlock(&async_mutex);
+
+    if (running)
+    {
+        pthread_join(async_thread, NULL);
+    }
+
+    /* anything logged from here on has nowhere to go */
+    gossip_facility = 0;
+    close(async_fd);
+    async_fd = -1;
+    return 0;
+}
+#else
+static int gossip_async_va(char prefix, const char *format, va_list ap)
+{
+    return 0;
+}
+
+static int gossip_disable_async(
+    void)
+{
+    return 0;
+}
+#endif /* GOSSIP_HAVE_ASYNC */
+
 /*
  * Local variables:
  *  c-indent-level: 4
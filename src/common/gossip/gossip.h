@@ -91,6 +91,10 @@ int gossip_enable_syslog(int priority);
 int gossip_enable_stderr(void);
 int gossip_enable_file(const char *filename, const char *mode);
 int gossip_reopen_file(const char *filename, const char *mode);
+int gossip_enable_async(const char *filename, const char *mode,
+                        int buffer_size, int rate_limit);
+int gossip_flush(void);
+void gossip_get_async_stats(uint64_t *dropped, uint64_t *suppressed);
 int gossip_disable(void);
 int gossip_set_debug_mask(int debug_on, uint64_t mask);
 int gossip_get_debug_mask(int *debug_on, uint64_t *mask);
@@ -100,6 +100,10 @@ struct PINT_perf_key server_keys[] =
     {"io requests called", PINT_PERF_IO, PINT_PERF_PRESERVE},
     {"small_io requests called", PINT_PERF_SMALL_IO, PINT_PERF_PRESERVE},
     {"readdir requests called", PINT_PERF_READDIR, PINT_PERF_PRESERVE},
+    {"bytes held by slab caches", PINT_PERF_SLAB_BYTES, PINT_PERF_PRESERVE},
+    {"slab objects in use", PINT_PERF_SLAB_OBJECTS, PINT_PERF_PRESERVE},
+    {"bytes read from readahead", PINT_PERF_READAHEAD_HIT, PINT_PERF_PRESERVE},
+    {"readahead bytes not read", PINT_PERF_READAHEAD_WASTE, PINT_PERF_PRESERVE},
     {NULL, 0, 0},
 };
 
@@ -0,0 +1,486 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef __GEN_POSIX_LOCKING__
+#include <pthread.h>
+#endif
+
+#include "pvfs2-types.h"
+#include "pvfs2-debug.h"
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "gen-locks.h"
+#include "pint-slab.h"
+
+#define SLAB_MAGIC_FREE  0x5fee5fee
+#define SLAB_MAGIC_INUSE 0x1a11c0de
+#define SLAB_POISON_BYTE 0x6b
+
+/* header in front of every object */
+struct PINT_slab_obj
+{
+    struct PINT_slab_obj *next;   /* free list link */
+    PINT_slab *slab;
+    uint32_t magic;
+};
+
+/* keep objects aligned the way malloc would */
+#define SLAB_ALIGN(__x) (((__x) + 15) & ~((size_t)15))
+#define SLAB_HDR_SIZE SLAB_ALIGN(sizeof(struct PINT_slab_obj))
+#define SLAB_STRIDE(__slab) (SLAB_HDR_SIZE + SLAB_ALIGN((__slab)->size))
+#define SLAB_OBJ_DATA(__obj) ((void *)((char *)(__obj) + SLAB_HDR_SIZE))
+#define SLAB_DATA_OBJ(__data) \
+    ((struct PINT_slab_obj *)((char *)(__data) - SLAB_HDR_SIZE))
+
+struct PINT_slab_chunk
+{
+    struct PINT_slab_chunk *next;
+    size_t bytes;
+};
+
+#define SLAB_CHUNK_HDR_SIZE SLAB_ALIGN(sizeof(struct PINT_slab_chunk))
+
+/* free objects one thread holds for one cache */
+struct slab_thread_cache
+{
+    struct PINT_slab_obj *list;
+    int count;
+};
+
+/* all of a thread's caches; linked so that stats can see them */
+struct slab_thread
+{
+    struct slab_thread_cache cache[PINT_SLAB_MAX_CACHES];
+    struct slab_thread *next;
+    struct slab_thread *prev;
+};
+
+static gen_mutex_t slab_mutex = GEN_MUTEX_INITIALIZER;
+static PINT_slab *slabs[PINT_SLAB_MAX_CACHES];
+static int slab_count = 0;
+static struct slab_thread *threads = NULL;
+#ifdef __GEN_POSIX_LOCKING__
+static pthread_key_t thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+static void slab_thread_release(void *arg);
+
+static void slab_key_create(void)
+{
+    pthread_key_create(&thread_key, slab_thread_release);
+}
+#else
+/* without threads there is just the one set of caches */
+static struct slab_thread single_thread;
+#endif
+
+/* slab_register()
+ *
+ * gives a cache its index on first use
+ *
+ * returns 0 on success, -PVFS_ENOMEM if there are too many caches
+ */
+static int slab_register(PINT_slab *slab)
+{
+    int ret = 0;
+
+#ifdef __GEN_POSIX_LOCKING__
+    pthread_once(&thread_key_once, slab_key_create);
+#endif
+
+    gen_mutex_lock(&slab_mutex);
+    if (slab->id < 0)
+    {
+        if (slab_count == PINT_SLAB_MAX_CACHES)
+        {
+            gossip_err("Error: too many slab caches, not caching %s\n",
+                       slab->name);
+            ret = -PVFS_ENOMEM;
+        }
+        else
+        {
+            slabs[slab_count] = slab;
+            slab->id = slab_count++;
+        }
+    }
+    gen_mutex_unlock(&slab_mutex);
+    return ret;
+}
+
+/* slab_thread_get()
+ *
+ * returns the calling thread's caches, creating them on first use, or
+ * NULL if out of memory
+ */
+#ifndef __GEN_POSIX_LOCKING__
+static struct slab_thread *slab_thread_get(void)
+{
+    threads = &single_thread;
+    return threads;
+}
+#else
+static struct slab_thread *slab_thread_get(void)
+{
+    struct slab_thread *t;
+
+    t = (struct slab_thread *)pthread_getspecific(thread_key);
+    if (t)
+    {
+        return t;
+    }
+
+    t = (struct slab_thread *)calloc(1, sizeof(struct slab_thread));
+    if (!t)
+    {
+        return NULL;
+    }
+    gen_mutex_lock(&slab_mutex);
+    t->next = threads;
+    if (threads)
+    {
+        threads->prev = t;
+    }
+    threads = t;
+    gen_mutex_unlock(&slab_mutex);
+
+    pthread_setspecific(thread_key, t);
+    return t;
+}
+#endif
+
+/* slab_grow()
+ *
+ * carves a new chunk of objects onto the shared free list; called with
+ * slab_mutex held
+ *
+ * returns 0 on success, -PVFS_ENOMEM on failure
+ */
+static int slab_grow(PINT_slab *slab)
+{
+    struct PINT_slab_chunk *chunk;
+    struct PINT_slab_obj *obj;
+    size_t stride = SLAB_STRIDE(slab);
+    size_t bytes = SLAB_CHUNK_HDR_SIZE + stride * PINT_SLAB_CHUNK_OBJECTS;
+    char *p;
+    int i;
+
+    chunk = (struct PINT_slab_chunk *)malloc(bytes);
+    if (!chunk)
+    {
+        return -PVFS_ENOMEM;
+    }
+    chunk->bytes = bytes;
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+
+    p = (char *)chunk + SLAB_CHUNK_HDR_SIZE;
+    for (i = 0; i < PINT_SLAB_CHUNK_OBJECTS; i++, p += stride)
+    {
+        obj = (struct PINT_slab_obj *)p;
+        obj->slab = slab;
+        obj->magic = SLAB_MAGIC_FREE;
+#if PVFS_SLAB_POISON
+        memset(SLAB_OBJ_DATA(obj), SLAB_POISON_BYTE, slab->size);
+#endif
+        obj->next = slab->free_list;
+        slab->free_list = obj;
+    }
+    slab->free_count += PINT_SLAB_CHUNK_OBJECTS;
+    slab->total += PINT_SLAB_CHUNK_OBJECTS;
+    return 0;
+}
+
+/* slab_refill()
+ *
+ * moves up to half a thread cache worth of objects from the shared free
+ * list to the thread's cache
+ *
+ * returns 0 on success, -PVFS_ENOMEM on failure
+ */
+static int slab_refill(PINT_slab *slab, struct slab_thread_cache *tc)
+{
+    struct PINT_slab_obj *obj;
+    int n = PINT_SLAB_THREAD_OBJECTS / 2;
+
+    gen_mutex_lock(&slab_mutex);
+    if (!slab->free_list && slab_grow(slab) < 0)
+    {
+        gen_mutex_unlock(&slab_mutex);
+        return -PVFS_ENOMEM;
+    }
+    while (n-- > 0 && slab->free_list)
+    {
+        obj = slab->free_list;
+        slab->free_list = obj->next;
+        slab->free_count--;
+        slab->out++;
+        obj->next = tc->list;
+        tc->list = obj;
+        tc->count++;
+    }
+    gen_mutex_unlock(&slab_mutex);
+    return 0;
+}
+
+/* slab_drain()
+ *
+ * returns count objects from a thread cache to the shared free list
+ */
+static void slab_drain(PINT_slab *slab, struct slab_thread_cache *tc,
+                       int count)
+{
+    struct PINT_slab_obj *obj;
+
+    gen_mutex_lock(&slab_mutex);
+    while (count-- > 0 && tc->list)
+    {
+        obj = tc->list;
+        tc->list = obj->next;
+        tc->count--;
+        obj->next = slab->free_list;
+        slab->free_list = obj;
+        slab->free_count++;
+        slab->out--;
+    }
+    gen_mutex_unlock(&slab_mutex);
+}
+
+#ifdef __GEN_POSIX_LOCKING__
+/* slab_thread_release()
+ *
+ * hands an exiting thread's cached objects back to their caches
+ */
+static void slab_thread_release(void *arg)
+{
+    struct slab_thread *t = (struct slab_thread *)arg;
+    int i, count;
+
+    gen_mutex_lock(&slab_mutex);
+    count = slab_count;
+    if (t->prev)
+    {
+        t->prev->next = t->next;
+    }
+    else
+    {
+        threads = t->next;
+    }
+    if (t->next)
+    {
+        t->next->prev = t->prev;
+    }
+    gen_mutex_unlock(&slab_mutex);
+
+    for (i = 0; i < count; i++)
+    {
+        if (t->cache[i].count)
+        {
+            slab_drain(slabs[i], &t->cache[i], t->cache[i].count);
+        }
+    }
+    free(t);
+}
+#endif
+
+/* PINT_slab_alloc()
+ *
+ * returns a zeroed object from the cache, or NULL if out of memory
+ */
+void *PINT_slab_alloc(PINT_slab *slab)
+{
+    struct slab_thread *t;
+    struct slab_thread_cache *tc;
+    struct PINT_slab_obj *obj;
+    void *data;
+
+    if (slab->id < 0 && slab_register(slab) < 0)
+    {
+        return NULL;
+    }
+
+    t = slab_thread_get();
+    if (!t)
+    {
+        return NULL;
+    }
+    tc = &t->cache[slab->id];
+    if (!tc->list && slab_refill(slab, tc) < 0)
+    {
+        return NULL;
+    }
+
+    obj = tc->list;
+    tc->list = obj->next;
+    tc->count--;
+
+    if (obj->magic != SLAB_MAGIC_FREE)
+    {
+        gossip_lerr("Error: %s slab object %p handed out twice\n",
+                    slab->name, SLAB_OBJ_DATA(obj));
+    }
+    obj->magic = SLAB_MAGIC_INUSE;
+    obj->next = NULL;
+
+    data = SLAB_OBJ_DATA(obj);
+#if PVFS_SLAB_POISON
+    {
+        unsigned char *c = (unsigned char *)data;
+        size_t i;
+
+        for (i = 0; i < slab->size; i++)
+        {
+            if (c[i] != SLAB_POISON_BYTE)
+            {
+                gossip_lerr("Error: %s slab object %p written at offset "
+                            "%llu after it was freed\n", slab->name, data,
+                            llu(i));
+                break;
+            }
+        }
+    }
+#endif
+    memset(data, 0, slab->size);
+    return data;
+}
+
+/* PINT_slab_free()
+ *
+ * returns an object to the cache it came from
+ */
+void PINT_slab_free(PINT_slab *slab, void *data)
+{
+    struct slab_thread *t;
+    struct slab_thread_cache *tc;
+    struct PINT_slab_obj *obj;
+
+    if (!data)
+    {
+        return;
+    }
+
+    obj = SLAB_DATA_OBJ(data);
+    if (obj->slab != slab || obj->magic != SLAB_MAGIC_INUSE)
+    {
+        gossip_lerr("Error: %p freed to %s slab is not an object in use "
+                    "from it\n", data, slab->name);
+        return;
+    }
+    obj->magic = SLAB_MAGIC_FREE;
+#if PVFS_SLAB_POISON
+    memset(data, SLAB_POISON_BYTE, slab->size);
+#endif
+
+    t = slab_thread_get();
+    if (!t)
+    {
+        /* no thread cache; put it straight back on the shared list */
+        struct slab_thread_cache tmp = { obj, 1 };
+
+        obj->next = NULL;
+        slab_drain(slab, &tmp, 1);
+        return;
+    }
+    tc = &t->cache[slab->id];
+    obj->next = tc->list;
+    tc->list = obj;
+    tc->count++;
+    if (tc->count > PINT_SLAB_THREAD_OBJECTS)
+    {
+        slab_drain(slab, tc, PINT_SLAB_THREAD_OBJECTS / 2);
+    }
+}
+
+/* PINT_slab_get_stats()
+ *
+ * fills in stats for up to max caches.  Objects sitting in thread caches
+ * are counted as free; the numbers are a snapshot and may be slightly off
+ * while other threads allocate.
+ *
+ * returns the number of caches filled in
+ */
+int PINT_slab_get_stats(struct PINT_slab_stats *stats, int max)
+{
+    struct slab_thread *t;
+    int i, count;
+
+    gen_mutex_lock(&slab_mutex);
+    count = slab_count < max ? slab_count : max;
+    for (i = 0; i < count; i++)
+    {
+        PINT_slab *slab = slabs[i];
+        uint64_t cached = 0;
+        uint64_t chunks = 0;
+
+        for (t = threads; t; t = t->next)
+        {
+            cached += t->cache[i].count;
+        }
+        chunks = (slab->total + PINT_SLAB_CHUNK_OBJECTS - 1) /
+                 PINT_SLAB_CHUNK_OBJECTS;
+
+        stats[i].name = slab->name;
+        stats[i].size = slab->size;
+        stats[i].total = slab->total;
+        stats[i].in_use = slab->out > cached ? slab->out - cached : 0;
+        stats[i].bytes = chunks * (SLAB_CHUNK_HDR_SIZE +
+                                   SLAB_STRIDE(slab) *
+                                   PINT_SLAB_CHUNK_OBJECTS);
+    }
+    gen_mutex_unlock(&slab_mutex);
+    return count;
+}
+
+/* PINT_slab_totals()
+ *
+ * sums memory held and objects in use over all caches
+ */
+void PINT_slab_totals(uint64_t *bytes, uint64_t *in_use)
+{
+    struct PINT_slab_stats stats[PINT_SLAB_MAX_CACHES];
+    int i, count;
+
+    *bytes = 0;
+    *in_use = 0;
+    count = PINT_slab_get_stats(stats, PINT_SLAB_MAX_CACHES);
+    for (i = 0; i < count; i++)
+    {
+        *bytes += stats[i].bytes;
+        *in_use += stats[i].in_use;
+    }
+}
+
+/* PINT_slab_report_leaks()
+ *
+ * logs every cache that still has objects in use; meant for shutdown,
+ * after the users of the caches have been stopped
+ */
+void PINT_slab_report_leaks(void)
+{
+    struct PINT_slab_stats stats[PINT_SLAB_MAX_CACHES];
+    int i, count;
+
+    count = PINT_slab_get_stats(stats, PINT_SLAB_MAX_CACHES);
+    for (i = 0; i < count; i++)
+    {
+        if (stats[i].in_use)
+        {
+            gossip_debug(GOSSIP_SERVER_DEBUG, "slab %s: %llu of %llu "
+                         "objects still in use\n", stats[i].name,
+                         llu(stats[i].in_use), llu(stats[i].total));
+        }
+    }
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,87 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* PINT_slab: object caches for the small, fixed size structures that
+ * every request allocates and frees several times (state machine control
+ * blocks and frame entries, job descriptors, BMI method ops).
+ *
+ * Objects are carved out of chunks of PINT_SLAB_CHUNK_OBJECTS and are
+ * never handed back to malloc while the process runs.  Each thread keeps
+ * a short list of free objects per cache so that the common alloc/free
+ * pair takes no lock; only refilling or draining that list takes the
+ * (single, module wide) slab mutex.
+ *
+ * Caches are declared statically with PINT_SLAB_INITIALIZER and register
+ * themselves on first use, so no initialization call is needed and they
+ * work in the client library, the server and libbmi alike.
+ */
+
+#ifndef __PINT_SLAB_H
+#define __PINT_SLAB_H
+
+#include <stdint.h>
+
+/* objects allocated from malloc at a time when a cache runs dry */
+#define PINT_SLAB_CHUNK_OBJECTS 64
+
+/* free objects a thread keeps per cache before returning half of them */
+#define PINT_SLAB_THREAD_OBJECTS 128
+
+/* maximum number of caches in a process */
+#define PINT_SLAB_MAX_CACHES 32
+
+/* fill freed objects with a pattern and check it when they are handed
+ * out again, to catch writes after free
+ */
+#ifndef PVFS_SLAB_POISON
+#define PVFS_SLAB_POISON 0
+#endif
+
+struct PINT_slab_obj;
+struct PINT_slab_chunk;
+
+/* all fields but name and size are private to pint-slab.c */
+typedef struct PINT_slab
+{
+    const char *name;
+    size_t size;                  /* object size asked for */
+    int id;                       /* index into the per thread caches */
+    struct PINT_slab_obj *free_list;
+    int free_count;
+    struct PINT_slab_chunk *chunks;
+    uint64_t total;               /* objects carved out of chunks */
+    uint64_t out;                 /* objects outside the shared free list */
+} PINT_slab;
+
+#define PINT_SLAB_INITIALIZER(__name, __size) \
+    { __name, __size, -1, NULL, 0, NULL, 0, 0 }
+
+struct PINT_slab_stats
+{
+    const char *name;
+    size_t size;         /* object size */
+    uint64_t total;      /* objects owned by the cache */
+    uint64_t in_use;     /* objects handed out and not freed */
+    uint64_t bytes;      /* bytes of memory held, including overhead */
+};
+
+void *PINT_slab_alloc(PINT_slab *slab);
+void PINT_slab_free(PINT_slab *slab, void *obj);
+
+int PINT_slab_get_stats(struct PINT_slab_stats *stats, int max);
+void PINT_slab_totals(uint64_t *bytes, uint64_t *in_use);
+void PINT_slab_report_leaks(void);
+
+#endif /* __PINT_SLAB_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,509 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "state-machine.h"
+#include "pint-trace.h"
+
+#ifndef WIN32
+
+/* maximum number of threads that can own a ring; threads beyond this
+ * simply do not record events
+ */
+#define PINT_TRACE_MAX_RINGS 256
+
+/* size of the (static) table used to collect state names at dump time */
+#define PINT_TRACE_MAX_STRINGS 4096
+
+struct PINT_trace_ring
+{
+    uint64_t thread_id;
+    volatile uint32_t head;     /* sequence number of the next record */
+    struct PINT_trace_record *records;
+};
+
+int PINT_trace_enabled = 0;
+
+static uint32_t ring_entries = 0;
+static uint32_t ring_mask = 0;
+static struct PINT_trace_ring *rings[PINT_TRACE_MAX_RINGS];
+static volatile int ring_count = 0;
+static gen_mutex_t ring_mutex = GEN_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+static PVFS_handle (*handle_fn)(struct PINT_smcb *) = NULL;
+
+/* scratch table of distinct state pointers; static so that a dump from a
+ * signal handler does not need to allocate memory
+ */
+static uint64_t dump_strings[PINT_TRACE_MAX_STRINGS];
+
+/* PINT_trace_init()
+ *
+ * enables tracing with a ring of (at least) the given number of records
+ * per thread.  A value <= 0 selects PINT_TRACE_DEFAULT_ENTRIES.
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_trace_init(int entries)
+{
+    uint32_t n = 1;
+
+    if (entries <= 0)
+    {
+        entries = PINT_TRACE_DEFAULT_ENTRIES;
+    }
+    while (n < (uint32_t)entries)
+    {
+        n <<= 1;
+    }
+
+    if (pthread_key_create(&ring_key, NULL) != 0)
+    {
+        return -PVFS_ENOMEM;
+    }
+
+    ring_entries = n;
+    ring_mask = n - 1;
+    ring_count = 0;
+    PINT_trace_enabled = 1;
+
+    gossip_debug(GOSSIP_SERVER_DEBUG,
+                 "Trace rings enabled: %u records per thread\n", n);
+    return 0;
+}
+
+void PINT_trace_finalize(void)
+{
+    int i;
+
+    if (!ring_entries)
+    {
+        return;
+    }
+
+    PINT_trace_enabled = 0;
+
+    gen_mutex_lock(&ring_mutex);
+    for (i = 0; i < ring_count; i++)
+    {
+        free(rings[i]->records);
+        free(rings[i]);
+        rings[i] = NULL;
+    }
+    ring_count = 0;
+    gen_mutex_unlock(&ring_mutex);
+
+    pthread_key_delete(ring_key);
+    ring_entries = 0;
+    ring_mask = 0;
+}
+
+/* PINT_trace_set_handle_fn()
+ *
+ * registers a function used to find the target handle of a state machine.
+ * The state machine engine is shared by client and server and does not
+ * know about request structures, so the server provides this.
+ */
+void PINT_trace_set_handle_fn(PVFS_handle (*fn)(struct PINT_smcb *))
+{
+    handle_fn = fn;
+}
+
+/* trace_ring_get()
+ *
+ * returns the calling thread's ring, creating it on first use, or NULL if
+ * one could not be created.
+ */
+static struct PINT_trace_ring *trace_ring_get(void)
+{
+    struct PINT_trace_ring *ring;
+
+    ring = pthread_getspecific(ring_key);
+    if (ring)
+    {
+        return ring;
+    }
+
+    ring = malloc(sizeof(*ring));
+    if (!ring)
+    {
+        return NULL;
+    }
+    ring->records = calloc(ring_entries, sizeof(struct PINT_trace_record));
+    if (!ring->records)
+    {
+        free(ring);
+        return NULL;
+    }
+    ring->thread_id = (uint64_t)(uintptr_t)gen_thread_self();
+    ring->head = 0;
+
+    gen_mutex_lock(&ring_mutex);
+    if (ring_count >= PINT_TRACE_MAX_RINGS)
+    {
+        gen_mutex_unlock(&ring_mutex);
+        free(ring->records);
+        free(ring);
+        return NULL;
+    }
+    rings[ring_count] = ring;
+    ring_count++;
+    gen_mutex_unlock(&ring_mutex);
+
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+static inline void trace_record(enum PINT_trace_type type,
+                                uint64_t key,
+                                uint64_t aux,
+                                uint64_t str,
+                                int32_t op,
+                                int32_t value)
+{
+    struct PINT_trace_ring *ring;
+    struct PINT_trace_record *rec;
+    struct timespec ts;
+    uint32_t seq;
+
+    ring = trace_ring_get();
+    if (!ring)
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    seq = ring->head;
+    rec = &ring->records[seq & ring_mask];
+    rec->timestamp = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    rec->key = key;
+    rec->aux = aux;
+    rec->str = str;
+    rec->type = type;
+    rec->op = op;
+    rec->value = value;
+    rec->seq = seq;
+
+    /* make the record visible before publishing the new head to a
+     * concurrent dump
+     */
+    __asm__ __volatile__("" ::: "memory");
+    ring->head = seq + 1;
+}
+
+void PINT_trace_sm(enum PINT_trace_type type,
+                   struct PINT_smcb *smcb,
+                   int32_t value)
+{
+    uint64_t aux = PVFS_HANDLE_NULL;
+
+    if (type == PINT_TRACE_SM_START)
+    {
+        /* lets the decoder credit child machines to their parent */
+        aux = (uint64_t)(uintptr_t)smcb->parent_smcb;
+    }
+    else if (handle_fn)
+    {
+        aux = (uint64_t)handle_fn(smcb);
+    }
+    trace_record(type, (uint64_t)(uintptr_t)smcb, aux,
+                 (uint64_t)(uintptr_t)smcb->current_state,
+                 smcb->op, value);
+}
+
+void PINT_trace_job(enum PINT_trace_type type,
+                    void *key,
+                    uint64_t job_id,
+                    int32_t value)
+{
+    trace_record(type, (uint64_t)(uintptr_t)key, job_id, 0, 0, value);
+}
+
+/* trace_write()
+ *
+ * write() the whole buffer, retrying on short writes.  Only uses
+ * async-signal-safe calls.
+ */
+static int trace_write(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t ret;
+
+    while (len > 0)
+    {
+        ret = write(fd, p, len);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -PVFS_ERROR_CODE(errno);
+        }
+        p += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+/* trace_collect_string()
+ *
+ * adds a state pointer to the static string table if not already there.
+ */
+static void trace_collect_string(uint64_t str, uint32_t *count)
+{
+    uint32_t i;
+    uint32_t slot = (uint32_t)((str >> 3) % PINT_TRACE_MAX_STRINGS);
+
+    for (i = 0; i < PINT_TRACE_MAX_STRINGS; i++)
+    {
+        if (dump_strings[slot] == str)
+        {
+            return;
+        }
+        if (dump_strings[slot] == 0)
+        {
+            dump_strings[slot] = str;
+            (*count)++;
+            return;
+        }
+        slot = (slot + 1) % PINT_TRACE_MAX_STRINGS;
+    }
+}
+
+/* PINT_trace_dump_fd()
+ *
+ * writes the contents of all trace rings to an already open file
+ * descriptor.  This does not allocate memory or take locks, so it may be
+ * called from a fatal signal handler.  Records being written concurrently
+ * may be torn; the decoder discards them using the sequence numbers.
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_trace_dump_fd(int fd)
+{
+    struct PINT_trace_file_header fh;
+    struct PINT_trace_ring_header rh;
+    struct PINT_trace_string_header sh;
+    struct PINT_state_s *state;
+    const char *machine;
+    uint32_t head, first, count, start, i;
+    int nrings, r, ret;
+
+    if (!ring_entries)
+    {
+        return -PVFS_EINVAL;
+    }
+
+    nrings = ring_count;
+
+    memset(dump_strings, 0, sizeof(dump_strings));
+    memset(&fh, 0, sizeof(fh));
+    fh.magic = PINT_TRACE_MAGIC;
+    fh.version = PINT_TRACE_VERSION;
+    fh.record_size = sizeof(struct PINT_trace_record);
+    fh.ring_count = nrings;
+
+    /* gather the distinct states referenced so the header can carry the
+     * string count
+     */
+    for (r = 0; r < nrings; r++)
+    {
+        head = rings[r]->head;
+        count = head < ring_entries ? head : ring_entries;
+        for (i = 0; i < count; i++)
+        {
+            struct PINT_trace_record *rec =
+                &rings[r]->records[(head - count + i) & ring_mask];
+            if (rec->str && rec->type >= PINT_TRACE_SM_START &&
+                rec->type <= PINT_TRACE_SM_TERMINATE)
+            {
+                trace_collect_string(rec->str, &fh.string_count);
+            }
+        }
+    }
+
+    ret = trace_write(fd, &fh, sizeof(fh));
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    for (r = 0; r < nrings; r++)
+    {
+        head = rings[r]->head;
+        count = head < ring_entries ? head : ring_entries;
+        first = head - count;
+
+        memset(&rh, 0, sizeof(rh));
+        rh.thread_id = rings[r]->thread_id;
+        rh.count = count;
+        rh.dropped = first;
+        ret = trace_write(fd, &rh, sizeof(rh));
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        /* oldest records first; the ring may wrap once */
+        start = first & ring_mask;
+        if (start + count > ring_entries)
+        {
+            ret = trace_write(fd, &rings[r]->records[start],
+                (ring_entries - start) * sizeof(struct PINT_trace_record));
+            if (ret == 0)
+            {
+                ret = trace_write(fd, &rings[r]->records[0],
+                    (start + count - ring_entries) *
+                    sizeof(struct PINT_trace_record));
+            }
+        }
+        else
+        {
+            ret = trace_write(fd, &rings[r]->records[start],
+                count * sizeof(struct PINT_trace_record));
+        }
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    /* string table: "machine:state" for each state seen */
+    for (i = 0; i < PINT_TRACE_MAX_STRINGS; i++)
+    {
+        char name[256];
+        size_t mlen, slen;
+
+        if (!dump_strings[i])
+        {
+            continue;
+        }
+        state = (struct PINT_state_s *)(uintptr_t)dump_strings[i];
+        machine = (state->parent_machine && state->parent_machine->name) ?
+                  state->parent_machine->name : "UNKNOWN";
+        mlen = strlen(machine);
+        slen = state->state_name ? strlen(state->state_name) : 0;
+        if (slen > sizeof(name) / 2)
+        {
+            slen = sizeof(name) / 2;
+        }
+        if (mlen + slen + 1 > sizeof(name))
+        {
+            mlen = sizeof(name) - slen - 1;
+        }
+        memcpy(name, machine, mlen);
+        name[mlen] = ':';
+        memcpy(&name[mlen + 1], state->state_name, slen);
+
+        memset(&sh, 0, sizeof(sh));
+        sh.str = dump_strings[i];
+        sh.len = mlen + slen + 1;
+        ret = trace_write(fd, &sh, sizeof(sh));
+        if (ret == 0)
+        {
+            ret = trace_write(fd, name, sh.len);
+        }
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/* PINT_trace_dump()
+ *
+ * writes the contents of all trace rings to the named file, replacing it
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_trace_dump(const char *path)
+{
+    int fd, ret;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        ret = -PVFS_ERROR_CODE(errno);
+        gossip_err("Error: unable to open trace dump file %s\n", path);
+        return ret;
+    }
+
+    ret = PINT_trace_dump_fd(fd);
+    close(fd);
+    if (ret < 0)
+    {
+        gossip_err("Error: failed to write trace dump file %s\n", path);
+    }
+    return ret;
+}
+
+#else /* WIN32 */
+
+int PINT_trace_enabled = 0;
+
+int PINT_trace_init(int entries)
+{
+    return -PVFS_ENOSYS;
+}
+
+void PINT_trace_finalize(void)
+{
+}
+
+void PINT_trace_set_handle_fn(PVFS_handle (*fn)(struct PINT_smcb *))
+{
+}
+
+void PINT_trace_sm(enum PINT_trace_type type,
+                   struct PINT_smcb *smcb,
+                   int32_t value)
+{
+}
+
+void PINT_trace_job(enum PINT_trace_type type,
+                    void *key,
+                    uint64_t job_id,
+                    int32_t value)
+{
+}
+
+int PINT_trace_dump(const char *path)
+{
+    return -PVFS_ENOSYS;
+}
+
+int PINT_trace_dump_fd(int fd)
+{
+    return -PVFS_ENOSYS;
+}
+
+#endif /* WIN32 */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
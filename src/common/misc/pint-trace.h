@@ -0,0 +1,138 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* PINT_trace: low overhead binary tracing of state machine transitions
+ * and BMI/Trove/flow job post and completion events.
+ *
+ * Each thread that records an event gets its own fixed size ring of
+ * records, so the recording path takes no locks: it is a few stores and a
+ * clock read.  Rings only keep the most recent events; they are written
+ * to a file on demand (PINT_trace_dump) or from a crash handler
+ * (PINT_trace_dump_fd), and decoded offline by pvfs2-trace-decode.
+ */
+
+#ifndef __PINT_TRACE_H
+#define __PINT_TRACE_H
+
+#include "pvfs2-types.h"
+
+#define PINT_TRACE_MAGIC   0x4f465354 /* "OFST" */
+#define PINT_TRACE_VERSION 1
+
+/* default number of records kept per thread (must be a power of two) */
+#define PINT_TRACE_DEFAULT_ENTRIES 8192
+
+enum PINT_trace_type
+{
+    PINT_TRACE_SM_START = 1,    /* state machine started */
+    PINT_TRACE_SM_ENTER,        /* state action about to run */
+    PINT_TRACE_SM_EXIT,         /* state action returned */
+    PINT_TRACE_SM_TERMINATE,    /* state machine terminated */
+    PINT_TRACE_BMI_POST,
+    PINT_TRACE_BMI_COMPLETE,
+    PINT_TRACE_TROVE_POST,
+    PINT_TRACE_TROVE_COMPLETE,
+    PINT_TRACE_FLOW_POST,
+    PINT_TRACE_FLOW_COMPLETE,
+    PINT_TRACE_TYPE_MAX
+};
+
+/* one trace record, written in host byte order.  The layout is part of
+ * the dump file format; bump PINT_TRACE_VERSION if it changes.
+ */
+struct PINT_trace_record
+{
+    uint64_t timestamp;  /* nanoseconds, CLOCK_MONOTONIC */
+    uint64_t key;        /* smcb (or job user pointer) the event belongs to */
+    uint64_t aux;        /* SM_START: parent smcb; other SM events: target
+                          * handle; job events: job id */
+    uint64_t str;        /* SM events: address of the PINT_state_s */
+    uint32_t type;       /* enum PINT_trace_type */
+    int32_t  op;         /* state machine op type */
+    int32_t  value;      /* SM action, error code, or status tag */
+    uint32_t seq;        /* per-ring sequence number */
+};
+
+/* dump file layout:
+ *   struct PINT_trace_file_header
+ *   ring_count x { struct PINT_trace_ring_header, records[count] }
+ *   string_count x { struct PINT_trace_string_header, name[len] }
+ */
+struct PINT_trace_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t ring_count;
+    uint32_t string_count;
+    uint32_t pad;
+};
+
+struct PINT_trace_ring_header
+{
+    uint64_t thread_id;
+    uint32_t count;      /* records that follow, oldest first */
+    uint32_t dropped;    /* records overwritten before the dump */
+};
+
+struct PINT_trace_string_header
+{
+    uint64_t str;        /* address recorded in PINT_trace_record.str */
+    uint32_t len;        /* length of name that follows, no terminator */
+    uint32_t pad;
+};
+
+struct PINT_smcb;
+
+extern int PINT_trace_enabled;
+
+int PINT_trace_init(int entries);
+void PINT_trace_finalize(void);
+
+void PINT_trace_set_handle_fn(PVFS_handle (*fn)(struct PINT_smcb *));
+
+void PINT_trace_sm(enum PINT_trace_type type,
+                   struct PINT_smcb *smcb,
+                   int32_t value);
+void PINT_trace_job(enum PINT_trace_type type,
+                    void *key,
+                    uint64_t job_id,
+                    int32_t value);
+
+int PINT_trace_dump(const char *path);
+int PINT_trace_dump_fd(int fd);
+
+#ifndef WIN32
+
+#define PINT_TRACE_SM(type, smcb, value)                  \
+do {                                                      \
+    if (PINT_trace_enabled)                               \
+        PINT_trace_sm((type), (smcb), (value));           \
+} while (0)
+
+#define PINT_TRACE_JOB(type, key, job_id, value)          \
+do {                                                      \
+    if (PINT_trace_enabled)                               \
+        PINT_trace_job((type), (key), (job_id), (value)); \
+} while (0)
+
+#else
+
+#define PINT_TRACE_SM(type, smcb, value) do { } while (0)
+#define PINT_TRACE_JOB(type, key, job_id, value) do { } while (0)
+
+#endif /* WIN32 */
+
+#endif /* __PINT_TRACE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
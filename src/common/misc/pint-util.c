@@ -225,6 +225,12 @@ int PINT_copy_object_attr(PVFS_object_attr *dest, PVFS_object_attr *src)
                 src->u.meta.stuffed_size;
         }
 
+        if ((src->objtype == PVFS_TYPE_METAFILE) &&
+            (src->mask & PVFS_ATTR_META_SIZE))
+        {
+            dest->u.meta.size = src->u.meta.size;
+        }
+
         if (src->mask & PVFS_ATTR_DIR_HINT)
         {
             dest->u.dir.hint.dfile_count = 
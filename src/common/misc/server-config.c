@@ -68,6 +68,7 @@ static DOTCONF_CB(exit_dhranges_context);
 static DOTCONF_CB(enter_distribution_context);
 static DOTCONF_CB(exit_distribution_context);
 static DOTCONF_CB(get_unexp_req);
+static DOTCONF_CB(get_sm_worker_threads);
 static DOTCONF_CB(get_tcp_buffer_send);
 static DOTCONF_CB(get_tcp_buffer_receive);
 static DOTCONF_CB(get_tcp_bind_specific);
@@ -77,8 +78,12 @@ static DOTCONF_CB(get_root_handle);
 static DOTCONF_CB(get_name);
 static DOTCONF_CB(get_logfile);
 static DOTCONF_CB(get_logtype);
+static DOTCONF_CB(get_log_buffer_size);
+static DOTCONF_CB(get_log_rate_limit);
 static DOTCONF_CB(get_event_logging_list);
 static DOTCONF_CB(get_event_tracing);
+static DOTCONF_CB(get_trace_ring_entries);
+static DOTCONF_CB(get_trace_dump_file);
 static DOTCONF_CB(get_filesystem_collid);
 static DOTCONF_CB(get_alias_list);
 static DOTCONF_CB(check_this_server);
@@ -106,6 +111,10 @@ static DOTCONF_CB(get_attr_cache_size);
 static DOTCONF_CB(get_attr_cache_max_num_elems);
 static DOTCONF_CB(get_trove_sync_meta);
 static DOTCONF_CB(get_trove_sync_data);
+static DOTCONF_CB(get_write_agg_size);
+static DOTCONF_CB(get_readahead_size);
+static DOTCONF_CB(get_attr_lease_secs);
+static DOTCONF_CB(get_size_cache_secs);
 static DOTCONF_CB(get_file_stuffing);
 static DOTCONF_CB(get_trove_max_concurrent_io);
 /* Berkeley DB */
@@ -696,11 +705,29 @@ static const configoption_t options[] =
      * messages from OrangeFS server.  The default value is <c>file</c>, which causes
      * all log messages to be written to the file specified by the LogFile
      * parameter.  Another option is <c>syslog</c>, which causes all log messages
-     * to be written to syslog.
+     * to be written to syslog.  The <c>async</c> option also writes to
+     * LogFile, but server threads only copy each message into a staging
+     * buffer and a background thread writes them out in batches, so that
+     * verbose debug logging does not put disk I/O on the request path.
      */
     {"LogType",ARG_STR, get_logtype,NULL,
         CTX_DEFAULTS|CTX_SERVER_OPTIONS,"file"},
 
+    /* Size in bytes of each server thread's staging buffer when LogType is
+     * <c>async</c>.  Messages logged while a thread's buffer is full are
+     * dropped, and the number dropped is written to the log.
+     */
+    {"LogBufferSize",ARG_INT, get_log_buffer_size,NULL,
+        CTX_DEFAULTS|CTX_SERVER_OPTIONS,"262144"},
+
+    /* Maximum number of messages per second accepted from any one place
+     * in the code when LogType is <c>async</c>.  Excess messages are
+     * suppressed and counted.  Error messages are never suppressed.  A
+     * value of 0 disables rate limiting.
+     */
+    {"LogRateLimit",ARG_INT, get_log_rate_limit,NULL,
+        CTX_DEFAULTS|CTX_SERVER_OPTIONS,"0"},
+
     /* The gossip interface in OrangeFS allows users to specify different
      * levels of logging for the OrangeFS server.  This option sets that level for
      * either all servers (by being defined in the Defaults context) or for
@@ -726,6 +753,22 @@ static const configoption_t options[] =
     {"EnableTracing",ARG_STR, get_event_tracing,NULL,
         CTX_DEFAULTS|CTX_SERVER_OPTIONS,"no"},
 
+    /* Number of records kept in each server thread's binary trace ring.
+     * When non-zero, every state machine transition and every BMI, Trove
+     * and flow job post and completion is recorded in a per-thread ring
+     * buffer.  The rings are written to <c>TraceDumpFile</c> when the
+     * server receives SIGUSR2 or crashes, and can be decoded with
+     * pvfs2-trace-decode.  A value of 0 disables trace rings.
+     */
+    {"TraceRingEntries",ARG_INT, get_trace_ring_entries,NULL,
+        CTX_DEFAULTS|CTX_SERVER_OPTIONS,"0"},
+
+    /* The file that trace rings are written to.  See 
+     * <c>TraceRingEntries</c>.
+     */
+    {"TraceDumpFile",ARG_STR, get_trace_dump_file,NULL,
+        CTX_DEFAULTS|CTX_SERVER_OPTIONS,"/tmp/pvfs2-server.trace"},
+
     /* At startup each OrangeFS server allocates space for a set number
      * of incoming requests to prevent the allocation delay at the beginning
      * of each unexpected request.  This parameter specifies the number
@@ -739,6 +782,16 @@ static const configoption_t options[] =
      {"UnexpectedRequests",ARG_INT, get_unexp_req,NULL,
          CTX_DEFAULTS|CTX_SERVER_OPTIONS,"50"},
 
+    /* Number of worker threads that run the server's state machines.
+     * With the default of 0 the main loop runs every state action itself.
+     * Otherwise the main loop only waits for job completions and hands
+     * each one to a worker; all the state machines of one request run on
+     * the same worker, so state actions still never run concurrently
+     * for a request.
+     */
+    {"StateMachineWorkers",ARG_INT, get_sm_worker_threads,NULL,
+        CTX_DEFAULTS|CTX_SERVER_OPTIONS,"0"},
+
     /* DEPRECATED. Use <c>DataStorageSpace</c> and <c>MetadataStorageSpace</c> 
      *       instead.
      */
@@ -1106,6 +1159,46 @@ static const configoption_t options[] =
     {"TroveSyncData",ARG_STR, get_trove_sync_data, NULL, 
         CTX_STORAGEHINTS,"yes"},
 
+    /* Writes to a datafile whose contiguous pieces are at most this many
+     * bytes, and that arrive while another write to it is in progress,
+     * are gathered, merged by offset, and written together when that
+     * write completes.  This turns many small interleaved writes from
+     * different clients into a few large ones.  A write still completes
+     * only once its data is written.  0 turns aggregation off.
+     */
+    {"WriteAggregationSize",ARG_INT, get_write_agg_size, NULL,
+        CTX_STORAGEHINTS,"65536"},
+
+    /* When a datafile is being read sequentially, the server asks the
+     * kernel to read ahead of the client, starting at 128k and doubling
+     * up to this many bytes.  This only applies to the buffered Trove
+     * methods (alt-aio, dbpf); directio reads bypass the page cache.
+     * 0 turns server readahead off.
+     */
+    {"ReadaheadSize",ARG_INT, get_readahead_size, NULL,
+        CTX_STORAGEHINTS,"2097152"},
+
+    /* A client that asks for them is given a lease of this many seconds
+     * on the attributes of the files and symlinks it reads, and caches
+     * them that long instead of for its own short timeout.  The server
+     * remembers the holders of each lease and tells them to drop their
+     * copy when the object is changed or removed by another client.
+     * File sizes are not covered, since writes go to the datafiles on
+     * other servers.  0 turns leases off.
+     */
+    {"AttrLeaseTimeoutSecs",ARG_INT, get_attr_lease_secs, NULL,
+        CTX_STORAGEHINTS,"0"},
+
+    /* The server of a file keeps the file's size for up to this many
+     * seconds once a client has asked for it, so that stat need not ask
+     * every server holding a datafile.  Before a datafile of the file is
+     * next written or truncated, its server tells the metadata server to
+     * forget the size, so a cached size is never stale.  Set it the same
+     * on all servers.  0 turns the cache off.
+     */
+    {"SizeCacheTimeoutSecs",ARG_INT, get_size_cache_secs, NULL,
+        CTX_STORAGEHINTS,"0"},
+
     /* Berkeley DB: The DBCacheSizeBytes option allows users to set the size of
      * the shared memory buffer pool (i.e., cache) for Berkeley DB. The size is
      * specified in bytes.
@@ -1822,6 +1915,23 @@ DOTCONF_CB(get_unexp_req)
     return NULL;
 }
 
+DOTCONF_CB(get_sm_worker_threads)
+{
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+    if(config_s->configuration_context == CTX_SERVER_OPTIONS &&
+       config_s->my_server_options == 0)
+    {
+        return NULL;
+    }
+    if(cmd->data.value < 0)
+    {
+        return "StateMachineWorkers must not be negative.\n";
+    }
+    config_s->sm_worker_threads = cmd->data.value;
+    return NULL;
+}
+
 DOTCONF_CB(get_tcp_buffer_receive)
 {
     struct server_configuration_s *config_s =
@@ -2083,6 +2193,40 @@ DOTCONF_CB(get_logtype)
     return NULL;
 }
 
+DOTCONF_CB(get_log_buffer_size)
+{
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+    if(config_s->configuration_context == CTX_SERVER_OPTIONS &&
+       config_s->my_server_options == 0)
+    {
+        return NULL;
+    }
+    if(cmd->data.value < 0)
+    {
+        return "LogBufferSize must not be negative.\n";
+    }
+    config_s->log_buffer_size = cmd->data.value;
+    return NULL;
+}
+
+DOTCONF_CB(get_log_rate_limit)
+{
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+    if(config_s->configuration_context == CTX_SERVER_OPTIONS &&
+       config_s->my_server_options == 0)
+    {
+        return NULL;
+    }
+    if(cmd->data.value < 0)
+    {
+        return "LogRateLimit must not be negative.\n";
+    }
+    config_s->log_rate_limit = cmd->data.value;
+    return NULL;
+}
+
 
 DOTCONF_CB(get_event_logging_list)
 {
@@ -2131,6 +2275,40 @@ DOTCONF_CB(get_event_tracing)
     return NULL;
 }
 
+DOTCONF_CB(get_trace_ring_entries)
+{
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+    if(config_s->configuration_context == CTX_SERVER_OPTIONS &&
+       config_s->my_server_options == 0)
+    {
+        return NULL;
+    }
+    if(cmd->data.value < 0)
+    {
+        return "TraceRingEntries must not be negative.\n";
+    }
+    config_s->trace_ring_entries = cmd->data.value;
+    return NULL;
+}
+
+DOTCONF_CB(get_trace_dump_file)
+{
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+    if(config_s->configuration_context == CTX_SERVER_OPTIONS &&
+       config_s->my_server_options == 0)
+    {
+        return NULL;
+    }
+    if (config_s->trace_dump_file)
+    {
+        free(config_s->trace_dump_file);
+    }
+    config_s->trace_dump_file = (cmd->data.str ? strdup(cmd->data.str) : NULL);
+    return NULL;
+}
+
 DOTCONF_CB(get_flow_module_list)
 {
     int i = 0, len = 0;
@@ -2891,6 +3069,82 @@ DOTCONF_CB(get_trove_sync_data)
     return NULL;
 }
 
+DOTCONF_CB(get_write_agg_size)
+{
+    struct filesystem_configuration_s *fs_conf = NULL;
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+
+    fs_conf = (struct filesystem_configuration_s *)
+                    PINT_llist_head(config_s->file_systems);
+    assert(fs_conf);
+
+    if(cmd->data.value < 0)
+    {
+        return("WriteAggregationSize must not be negative.\n");
+    }
+    fs_conf->write_agg_size = cmd->data.value;
+
+    return NULL;
+}
+
+DOTCONF_CB(get_readahead_size)
+{
+    struct filesystem_configuration_s *fs_conf = NULL;
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+
+    fs_conf = (struct filesystem_configuration_s *)
+                    PINT_llist_head(config_s->file_systems);
+    assert(fs_conf);
+
+    if(cmd->data.value < 0)
+    {
+        return("ReadaheadSize must not be negative.\n");
+    }
+    fs_conf->readahead_size = cmd->data.value;
+
+    return NULL;
+}
+
+DOTCONF_CB(get_attr_lease_secs)
+{
+    struct filesystem_configuration_s *fs_conf = NULL;
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+
+    fs_conf = (struct filesystem_configuration_s *)
+                    PINT_llist_head(config_s->file_systems);
+    assert(fs_conf);
+
+    if(cmd->data.value < 0 || cmd->data.value > 3600)
+    {
+        return("AttrLeaseTimeoutSecs must be between 0 and 3600.\n");
+    }
+    fs_conf->attr_lease_secs = cmd->data.value;
+
+    return NULL;
+}
+
+DOTCONF_CB(get_size_cache_secs)
+{
+    struct filesystem_configuration_s *fs_conf = NULL;
+    struct server_configuration_s *config_s = 
+                    (struct server_configuration_s *)cmd->context;
+
+    fs_conf = (struct filesystem_configuration_s *)
+                    PINT_llist_head(config_s->file_systems);
+    assert(fs_conf);
+
+    if(cmd->data.value < 0 || cmd->data.value > 3600)
+    {
+        return("SizeCacheTimeoutSecs must be between 0 and 3600.\n");
+    }
+    fs_conf->size_cache_secs = cmd->data.value;
+
+    return NULL;
+}
+
 DOTCONF_CB(get_trove_max_concurrent_io)
 {
     struct server_configuration_s *config_s = 
@@ -4029,6 +4283,12 @@ void PINT_config_release(struct server_configuration_s *config_s)
             config_s->event_logging = NULL;
         }
 
+        if (config_s->trace_dump_file)
+        {
+            free(config_s->trace_dump_file);
+            config_s->trace_dump_file = NULL;
+        }
+
         if (config_s->bmi_modules)
         {
             free(config_s->bmi_modules);
@@ -4470,6 +4730,10 @@ static void copy_filesystem(struct filesystem_configuration_s *dest_fs,
             src_fs->attr_cache_max_num_elems;
         dest_fs->trove_sync_meta = src_fs->trove_sync_meta;
         dest_fs->trove_sync_data = src_fs->trove_sync_data;
+        dest_fs->write_agg_size = src_fs->write_agg_size;
+        dest_fs->readahead_size = src_fs->readahead_size;
+        dest_fs->attr_lease_secs = src_fs->attr_lease_secs;
+        dest_fs->size_cache_secs = src_fs->size_cache_secs;
  
         /* copy all relevant export options */
         dest_fs->exp_flags    = src_fs->exp_flags;
@@ -88,6 +88,10 @@ typedef struct filesystem_configuration_s
     int attr_cache_max_num_elems;
     int trove_sync_meta;
     int trove_sync_data;
+    int write_agg_size;
+    int readahead_size;
+    int attr_lease_secs;
+    int size_cache_secs;
     int immediate_completion;
     int coalescing_high_watermark;
     int coalescing_low_watermark;
@@ -162,6 +166,8 @@ typedef struct server_configuration_s
     size_t fs_config_buflen;        /* the fs.conf file length          */
     char *fs_config_buf;            /* the fs.conf file contents        */
     int  initial_unexpected_requests;
+    int  sm_worker_threads;         /* threads running state machines,
+                                       0=run them in the main loop      */
     int  server_job_bmi_timeout;    /* job timeout values in seconds    */
     int  server_job_flow_timeout;
     int  client_job_bmi_timeout; 
@@ -174,10 +180,14 @@ typedef struct server_configuration_s
     uint32_t  *precreate_batch_size;    /* batch size for each ds type */
     uint32_t  *precreate_low_threshold; /* threshold for each ds type */
     char *logfile;                  /* what log file to write to */
-    char *logtype;                  /* "file" or "syslog" destination */
+    char *logtype;                  /* "file", "syslog" or "async" */
+    int log_buffer_size;            /* per thread async log buffer */
+    int log_rate_limit;             /* async msgs/sec per site, 0=off */
     enum gossip_logstamp logstamp_type; /* how to timestamp logs */
     char *event_logging;
     int enable_events;
+    int trace_ring_entries;         /* records per thread trace ring, 0=off */
+    char *trace_dump_file;          /* where trace rings are dumped to */
     char *bmi_modules;              /* BMI modules                      */
     char *bmi_opts;                 /* BMI options                      */
     char *flow_modules;             /* Flow modules                     */
@@ -16,6 +16,8 @@
 #include "pvfs2-debug.h"
 #include "state-machine.h"
 #include "client-state-machine.h"
+#include "pint-trace.h"
+#include "pint-slab.h"
 
 struct PINT_frame_s
 {
@@ -25,6 +27,11 @@ struct PINT_frame_s
     struct qlist_head link;
 };
 
+static PINT_slab smcb_slab =
+    PINT_SLAB_INITIALIZER("smcb", sizeof(struct PINT_smcb));
+static PINT_slab frame_entry_slab =
+    PINT_SLAB_INITIALIZER("sm frame", sizeof(struct PINT_frame_s));
+
 static struct PINT_state_s *PINT_pop_state(struct PINT_smcb *);
 static void PINT_push_state(struct PINT_smcb *, struct PINT_state_s *);
 static struct PINT_state_s *PINT_sm_task_map(struct PINT_smcb *smcb, int task_id);
@@ -54,6 +61,8 @@ int PINT_state_machine_terminate(struct PINT_smcb *smcb, job_status_s *r)
     void *my_frame;
     job_id_t id;
 
+    PINT_TRACE_SM(PINT_TRACE_SM_TERMINATE, smcb, r->error_code);
+
     /* notify parent */
     if (smcb->parent_smcb)
     {
@@ -147,9 +156,14 @@ PINT_sm_action PINT_state_machine_invoke(struct PINT_smcb *smcb,
                  state_name,
                  (int32_t)r->status_user_tag);
 //}
+
+    PINT_TRACE_SM(PINT_TRACE_SM_ENTER, smcb, (int32_t)r->status_user_tag);
      
     /* call state action function */
     retval = (smcb->current_state->action.func)(smcb,r);
+
+    PINT_TRACE_SM(PINT_TRACE_SM_EXIT, smcb, retval);
+
     /* process return code */
     switch (retval)
     {
@@ -214,6 +228,8 @@ PINT_sm_action PINT_state_machine_start(struct PINT_smcb *smcb, job_status_s *r)
      */
     smcb->immediate = 1;
 
+    PINT_TRACE_SM(PINT_TRACE_SM_START, smcb, 0);
+
     /* set the base frame to be the current TOS, which should be 0 */
     smcb->base_frame = smcb->frame_count - 1;
 
@@ -522,13 +538,12 @@ int PINT_smcb_alloc(
         int (*term_fn)(struct PINT_smcb *, job_status_s *),
         job_context_id context_id)
 {
-    *smcb = (struct PINT_smcb *)malloc(sizeof(struct PINT_smcb));
+    /* comes back zeroed */
+    *smcb = (struct PINT_smcb *)PINT_slab_alloc(&smcb_slab);
     if (!(*smcb))
     {
         return -PVFS_ENOMEM;
     }
-    /* zero out all members */
-    memset(*smcb, 0, sizeof(struct PINT_smcb));
 
     INIT_QLIST_HEAD(&(*smcb)->frames);
     (*smcb)->base_frame = -1; /* no frames yet */
@@ -540,7 +555,7 @@ int PINT_smcb_alloc(
         void *new_frame = malloc(frame_size);
         if (!new_frame)
         {
-            free(*smcb);
+            PINT_slab_free(&smcb_slab, *smcb);
             *smcb = NULL;
             return -PVFS_ENOMEM;
         }
@@ -597,9 +612,9 @@ void PINT_smcb_free(struct PINT_smcb *smcb)
             free(frame_entry->frame);
         } 
         qlist_del(&frame_entry->link);
-        free(frame_entry);
+        PINT_slab_free(&frame_entry_slab, frame_entry);
     }
-    free(smcb);
+    PINT_slab_free(&smcb_slab, smcb);
 }
 
 /* Function: PINT_pop_state
@@ -708,7 +723,7 @@ int PINT_sm_push_frame(struct PINT_smcb *smcb, int task_id, void *frame_p)
     gossip_debug(GOSSIP_STATE_MACHINE_DEBUG,
                  "[SM Frame PUSH]: (%p) frame: %p\n",
                  smcb, frame_p);
-    newframe = malloc(sizeof(struct PINT_frame_s));
+    newframe = PINT_slab_alloc(&frame_entry_slab);
     if(!newframe)
     {
         return -PVFS_ENOMEM;
@@ -755,7 +770,7 @@ void *PINT_sm_pop_frame(struct PINT_smcb *smcb,
     *error_code = frame_entry->error;
     *task_id = frame_entry->task_id;
 
-    free(frame_entry);
+    PINT_slab_free(&frame_entry_slab, frame_entry);
 
     gossip_debug(GOSSIP_STATE_MACHINE_DEBUG,
             "[SM Frame POP]: (%p) frame: %p\n",
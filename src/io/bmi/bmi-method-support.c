@@ -73,6 +73,50 @@ void bmi_dealloc_method_op(method_op_p op_p)
     return;
 }
 
+/*
+ * bmi_slab_alloc_method_op()
+ *
+ * like bmi_alloc_method_op(), but takes the operation from a slab cache
+ * declared with PINT_BMI_OP_SLAB_INITIALIZER; for methods that allocate
+ * an operation per message
+ *
+ * returns a pointer to the new structure on success, NULL on failure.
+ */
+method_op_p bmi_slab_alloc_method_op(PINT_slab *slab)
+{
+    method_op_p my_method_op = NULL;
+    size_t ssize = sizeof(method_op_st);
+
+    /* comes back zeroed */
+    my_method_op = (method_op_p) PINT_slab_alloc(slab);
+    if (!my_method_op)
+    {
+	return (NULL);
+    }
+
+    id_gen_fast_register(&(my_method_op->op_id), my_method_op);
+
+    if (slab->size > ssize)
+    {
+	my_method_op->method_data = (char *) my_method_op + ssize;
+    }
+
+    return (my_method_op);
+}
+
+/*
+ * bmi_slab_dealloc_method_op()
+ *
+ * returns an operation from bmi_slab_alloc_method_op() to its cache
+ *
+ * no return value
+ */
+void bmi_slab_dealloc_method_op(PINT_slab *slab, method_op_p op_p)
+{
+    id_gen_fast_unregister(op_p->op_id);
+    PINT_slab_free(slab, op_p);
+}
+
 
 /*
  * alloc_method_addr()
@@ -15,6 +15,7 @@
 #include "quicklist.h"
 #include "bmi-types.h"
 #include "pint-event.h"
+#include "pint-slab.h"
 
 #define BMI_MAX_CONTEXTS 16
 
@@ -231,6 +232,13 @@ struct method_drop_addr_query
 method_op_p bmi_alloc_method_op(bmi_size_t payload_size);
 void bmi_dealloc_method_op(method_op_p op_p);
 
+/* operations with a payload of a fixed type, from a slab cache */
+#define PINT_BMI_OP_SLAB_INITIALIZER(__name, __payload_type) \
+    PINT_SLAB_INITIALIZER(__name, sizeof(method_op_st) + \
+                          sizeof(__payload_type))
+method_op_p bmi_slab_alloc_method_op(PINT_slab *slab);
+void bmi_slab_dealloc_method_op(PINT_slab *slab, method_op_p op_p);
+
 /* These functions can be used to manage generic address structures */
 bmi_method_addr_p bmi_alloc_method_addr(int method_type,
 				bmi_size_t payload_size);
@@ -94,6 +94,13 @@ enum
     BMI_OPTIMISTIC_BUFFER_REG = 14,
     BMI_TCP_CHECK_UNEXPECTED = 15,
     BMI_TRANSPORT_METHODS_STRING = 16,
+    BMI_WAKE_TESTCONTEXT = 17,  /**< make a blocked testcontext return */
+    BMI_CHECK_WAKEUP = 18,      /**< see if testcontext can be woken up, so
+                                  that callers may block in it for long */
+    BMI_GET_WAIT_FD = 19,       /**< get a descriptor that polls readable
+                                  when the method has work to do */
+    BMI_CHECK_UNEXP_READY = 20, /**< see if unexpected messages are waiting
+                                  for testunexpected */
 };
 
 enum BMI_io_type
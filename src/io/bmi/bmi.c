@@ -15,8 +15,10 @@
 #include <time.h>
 #ifndef WIN32
 #include <sys/time.h>
+#include <poll.h>
 #endif
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "bmi.h"
 #include "bmi-method-support.h"
@@ -77,6 +79,9 @@ struct drop_item
 #ifdef __STATIC_METHOD_BMI_TCP__
 extern struct bmi_method_ops bmi_tcp_ops;
 #endif
+#ifdef __STATIC_METHOD_BMI_SM__
+extern struct bmi_method_ops bmi_sm_ops;
+#endif
 #ifdef __STATIC_METHOD_BMI_GM__
 extern struct bmi_method_ops bmi_gm_ops;
 #endif
@@ -97,6 +102,9 @@ static struct bmi_method_ops *const static_methods[] = {
 #ifdef __STATIC_METHOD_BMI_TCP__
     &bmi_tcp_ops,
 #endif
+#ifdef __STATIC_METHOD_BMI_SM__
+    &bmi_sm_ops,
+#endif
 #ifdef __STATIC_METHOD_BMI_GM__
     &bmi_gm_ops,
 #endif
@@ -141,6 +149,7 @@ struct method_usage_t
     int iters_active;  /* how many iterations since this method had action */
     int plan;
     int flags;
+    int wait_fd;       /* polls readable when the method has work, or -1 */
 };
 
 static struct method_usage_t * expected_method_usage = NULL;
@@ -159,6 +168,18 @@ static void bmi_addr_force_drop(ref_st_p ref, ref_list_p ref_list);
 static void bmi_check_forget_list(void);
 static void bmi_check_addr_force_drop (void);
 
+#ifdef __STATIC_METHOD_BMI_SM__
+/* shared memory stands in for tcp between processes on the same host
+ * unless PVFS2_BMI_SM=0 is set in the environment
+ */
+static int bmi_sm_enabled(void)
+{
+    const char *env = getenv("PVFS2_BMI_SM");
+
+    return !(env && !strcmp(env, "0"));
+}
+#endif
+
 /** Initializes the BMI layer.  Must be called before any other BMI
  *  functions.
  *
@@ -329,6 +350,33 @@ int BMI_initialize(const char *method_list,
             free(requested_methods[i]);
         }
         free(requested_methods);
+
+#ifdef __STATIC_METHOD_BMI_SM__
+        /* a server listening on tcp also takes clients on its own host
+         * through shared memory, under the same port
+         */
+        if ((flags & BMI_INIT_SERVER) && bmi_sm_enabled() &&
+            !strstr(method_list, "bmi_sm"))
+        {
+            for (j = 0; j < addr_count; j++)
+            {
+                if (!strncmp(listen_addrs[j], "tcp://", 6))
+                {
+                    char sm_addr[BMI_MAX_ADDR_LEN];
+
+                    snprintf(sm_addr, sizeof(sm_addr), "sm://%s",
+                             listen_addrs[j] + 6);
+                    ret = activate_method("bmi_sm", sm_addr, flags, options);
+                    if (ret < 0)
+                    {
+                        gossip_err("Warning: local clients will use tcp; "
+                                   "bmi_sm failed to start: %d\n", ret);
+                    }
+                    break;
+                }
+            }
+        }
+#endif
         if (listen_addrs)
         {
             PINT_free_string_list(listen_addrs, addr_count);
@@ -1222,6 +1270,91 @@ int BMI_testunexpected(int incount,
 }
 
 
+/*
+ * Runs testcontext on the methods in the poll plan, or on all of them
+ * if all is set, until incount operations have completed.
+ */
+static int testcontext_methods(int nmeth,
+                               int all,
+                               int incount,
+                               bmi_op_id_t* out_id_array,
+                               int *outcount,
+                               bmi_error_code_t * error_code_array,
+                               bmi_size_t * actual_size_array,
+                               void **user_ptr_array,
+                               int max_idle_time_ms,
+                               bmi_context_id context_id)
+{
+    int i = 0;
+    int ret = 0;
+    int tmp_outcount = 0;
+
+    while (*outcount < incount && i < nmeth)
+    {
+        if (all || expected_method_usage[i].plan)
+        {
+            ret = active_method_table[i]->testcontext(
+                        incount - *outcount, 
+                        &out_id_array[*outcount],
+                        &tmp_outcount,
+                        &error_code_array[*outcount], 
+                        &actual_size_array[*outcount],
+                        user_ptr_array ?  &user_ptr_array[*outcount] : NULL,
+                        max_idle_time_ms,
+                        context_id);
+            if (ret < 0)
+            {
+                return (ret);
+            }
+            (*outcount) += tmp_outcount;
+            expected_method_usage[i].iters_polled = 0;
+            if (ret)
+            {
+                expected_method_usage[i].iters_active = 0;
+            }
+        }
+        i++;
+    }
+    return (ret);
+}
+
+#ifndef WIN32
+/*
+ * Waits up to max_idle_time_ms for any of the methods to have work,
+ * if all of them can say so through a descriptor.
+ *
+ * returns 1 if it waited or found work, 0 if a method has no descriptor
+ */
+static int wait_methods(int nmeth, int max_idle_time_ms)
+{
+    struct pollfd pfds[nmeth];
+    int i, ret, ready;
+
+    for (i = 0; i < nmeth; i++)
+    {
+        if (expected_method_usage[i].wait_fd < 0)
+        {
+            return 0;
+        }
+        /* a message read in while testing is already off its socket */
+        ready = 0;
+        if (active_method_table[i]->get_info(BMI_CHECK_UNEXP_READY,
+                                             &ready) == 0 && ready)
+        {
+            return 1;
+        }
+        pfds[i].fd = expected_method_usage[i].wait_fd;
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    do
+    {
+        ret = poll(pfds, nmeth, max_idle_time_ms);
+    } while (ret < 0 && errno == EINTR);
+    return 1;
+}
+#endif
+
 /** Checks to see if any messages from the specified context have
  *  completed.
  *
@@ -1238,9 +1371,8 @@ int BMI_testcontext(int incount,
 {
     int i = 0;
     int ret = -1;
-    int position = 0;
-    int tmp_outcount = 0;
     int tmp_active_method_count = 0;
+    int idle_time_ms = max_idle_time_ms;
 #ifndef WIN32
     struct timespec ts;
 #endif
@@ -1274,36 +1406,50 @@ int BMI_testcontext(int incount,
 
     construct_poll_plan(expected_method_usage,
                         tmp_active_method_count, 
-                        &max_idle_time_ms);
+                        &idle_time_ms);
 
-    while (position < incount && i < tmp_active_method_count)
+#ifndef WIN32
+    if (idle_time_ms > 0 && tmp_active_method_count > 1)
     {
-        if (expected_method_usage[i].plan)
+        /* rather than splitting the idle time so that each method
+         * sleeps in turn while the others go unattended, check them all
+         * and then sleep on all of them at once
+         */
+        ret = testcontext_methods(tmp_active_method_count, 1, incount,
+                                  out_id_array, outcount, error_code_array,
+                                  actual_size_array, user_ptr_array, 0,
+                                  context_id);
+        if (ret >= 0 && *outcount == 0 &&
+            wait_methods(tmp_active_method_count, max_idle_time_ms))
         {
-            ret = active_method_table[i]->testcontext(
-                        incount - position, 
-                        &out_id_array[position],
-                        &tmp_outcount,
-                        &error_code_array[position], 
-                        &actual_size_array[position],
-                        user_ptr_array ?  &user_ptr_array[position] : NULL,
-                        max_idle_time_ms,
-                        context_id);
-            if (ret < 0)
-            {
-                /* can't recover from this */
-                gossip_lerr("Error: critical BMI_testcontext failure.\n");
-                return (ret);
-            }
-            position += tmp_outcount;
-            (*outcount) += tmp_outcount;
-            expected_method_usage[i].iters_polled = 0;
-            if (ret)
-            {
-                expected_method_usage[i].iters_active = 0;
-            }
+            ret = testcontext_methods(tmp_active_method_count, 1, incount,
+                                      out_id_array, outcount,
+                                      error_code_array, actual_size_array,
+                                      user_ptr_array, 0, context_id);
         }
-        i++;
+        else if (ret >= 0 && *outcount == 0)
+        {
+            /* fall back to splitting the idle time */
+            ret = testcontext_methods(tmp_active_method_count, 0, incount,
+                                      out_id_array, outcount,
+                                      error_code_array, actual_size_array,
+                                      user_ptr_array, idle_time_ms,
+                                      context_id);
+        }
+    }
+    else
+#endif
+    {
+        ret = testcontext_methods(tmp_active_method_count, 0, incount,
+                                  out_id_array, outcount, error_code_array,
+                                  actual_size_array, user_ptr_array,
+                                  idle_time_ms, context_id);
+    }
+    if (ret < 0)
+    {
+        /* can't recover from this */
+        gossip_lerr("Error: critical BMI_testcontext failure.\n");
+        return (ret);
     }
 
     /* return 1 if anything completed */
@@ -1720,6 +1866,33 @@ int BMI_get_info(BMI_addr_t addr,
             }
             break;
 
+        case BMI_CHECK_WAKEUP:
+            /* testcontext splits its idle time between methods unless
+             * it can wait on all of them at once, so a long wait is
+             * only safe with a single method, or methods that all have
+             * wait descriptors, that can all be woken up
+             */
+            *((int *) inout_parameter) = 0;
+            gen_mutex_lock(&active_method_count_mutex);
+            for (i = 0; i < active_method_count; i++)
+            {
+                int wakeup = 0;
+
+                if ((active_method_count > 1 &&
+                     expected_method_usage[i].wait_fd < 0) ||
+                    active_method_table[i]->get_info(option, &wakeup) < 0 ||
+                    !wakeup)
+                {
+                    break;
+                }
+            }
+            if (active_method_count > 0 && i == active_method_count)
+            {
+                *((int *) inout_parameter) = 1;
+            }
+            gen_mutex_unlock(&active_method_count_mutex);
+            break;
+
         default:
             return (bmi_errno_to_pvfs(-ENOSYS));
     }
@@ -1771,6 +1944,18 @@ int BMI_query_addr_range (BMI_addr_t addr,
     }
     strncpy(provided_method_name, id_string, provided_method_length);
 
+#ifdef __STATIC_METHOD_BMI_SM__
+    /* bmi_sm addresses stand in for tcp clients on this host and are
+     * checked against tcp wildcards by bmi_sm itself
+     */
+    if (tmp_ref->interface == &bmi_sm_ops)
+    {
+        free(provided_method_name);
+        return bmi_sm_ops.query_addr_range(tmp_ref->method_addr, id_string,
+                                           netmask);
+    }
+#endif
+
     /* Now we will run through each method looking for one that
      * matches the specified wildcard address. 
      */
@@ -1814,6 +1999,47 @@ int BMI_query_addr_range (BMI_addr_t addr,
     return ret;
 }
 
+#ifdef __STATIC_METHOD_BMI_SM__
+/*
+ * A tcp server on this host is reached through shared memory if it
+ * takes connections that way.  bmi_sm only answers if it could connect,
+ * so anything else still goes to tcp.
+ * NOTE: assumes caller has protected active_method_count with a mutex lock
+ *
+ * returns the address and sets *index to the bmi_sm entry in the active
+ * table, or returns NULL
+ */
+static bmi_method_addr_p bmi_sm_lookup(const char *id_string,
+                                       char *bmi_opts,
+                                       int *index)
+{
+    bmi_method_addr_p meth_addr;
+    int i;
+
+    if (strncmp(id_string, "tcp://", 6) || !bmi_sm_enabled())
+    {
+        return NULL;
+    }
+    meth_addr = bmi_sm_ops.method_addr_lookup(id_string);
+    if (!meth_addr)
+    {
+        return NULL;
+    }
+    if (activate_method(bmi_sm_ops.method_name, 0, 0, bmi_opts) < 0)
+    {
+        bmi_sm_ops.set_info(BMI_DROP_ADDR, meth_addr);
+        return NULL;
+    }
+    for (i = 0; active_method_table[i] != &bmi_sm_ops; i++)
+    {
+        ;
+    }
+    meth_addr->method_type = i;
+    *index = i;
+    return meth_addr;
+}
+#endif
+
 /** Resolves the string representation of a host address into a BMI
  *  address handle.
  *
@@ -1859,7 +2085,10 @@ int BMI_addr_lookup(BMI_addr_t * new_addr,
      */
     i = 0;
     gen_mutex_lock(&active_method_count_mutex);
-    while ((i < active_method_count) &&
+#ifdef __STATIC_METHOD_BMI_SM__
+    meth_addr = bmi_sm_lookup(id_string, bmi_opts, &i);
+#endif
+    while (!meth_addr && (i < active_method_count) &&
            !(meth_addr = active_method_table[i]->method_addr_lookup(id_string)))
     {
         gossip_debug(GOSSIP_BMI_DEBUG_CONTROL, 
@@ -2352,6 +2581,7 @@ static int grow_method_usage (struct method_usage_t ** p,
     }
     memset(&((*p)[active_method_count]), 0, sizeof(**p));
     (*p)[active_method_count].flags = newflags;
+    (*p)[active_method_count].wait_fd = -1;
 
     return 1;
  }
@@ -2471,6 +2701,16 @@ activate_method(const char *name,
         return ret;
     }
 
+    /* a method that can tell when it has work lets testcontext wait on
+     * several methods at once
+     */
+    if (meth->get_info(BMI_GET_WAIT_FD,
+                       &expected_method_usage[active_method_count - 1].wait_fd)
+        < 0)
+    {
+        expected_method_usage[active_method_count - 1].wait_fd = -1;
+    }
+
     /* tell it about any open contexts */
     for (i = 0; i < BMI_MAX_CONTEXTS; i++)
     {
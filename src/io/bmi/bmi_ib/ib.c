@@ -93,7 +93,10 @@ static void encourage_recv_incoming(struct buf_head *bh,
                                     msg_type_t type,
                                     u_int32_t byte_len);
 static void encourage_rts_done_waiting_buffer(struct ib_work *sq);
+static void encourage_send_incoming_read_done(struct buf_head *bh);
+static void encourage_read_done_waiting_buffer(struct ib_work *rq);
 static int send_cts(struct ib_work *rq);
+static void post_rdma_read(struct ib_work *rq, struct buf_head *bh);
 static void ib_close_connection(ib_connection_t *c);
 static int ib_tcp_client_connect(ib_method_addr_t *ibmap,
                                  struct bmi_method_addr *remote_map);
@@ -129,6 +132,10 @@ static const char *wc_opcode_string(int opcode)
     {
         return "RDMA WRITE";
     }
+    else if (opcode == BMI_IB_OP_RDMA_READ)
+    {
+        return "RDMA READ";
+    }
     else
     {
         return "(UNKNOWN)";
@@ -141,6 +148,56 @@ static const char *wc_opcode_string(int opcode)
  * walk the incomingq looking for things to do to them.  Returns
  * number of new things that arrived.
  */
+/*
+ * An RDMA read of an rq, posted by post_rdma_read, completed.  Only the
+ * last read of the rq is signaled, but one that fails completes too, and
+ * then all those after it are flushed, the last among them.  So the rq,
+ * failed or not, is done when its last read is.  Returns 1 if so.
+ */
+static int rdma_read_completion(const struct bmi_ib_wc *wc)
+{
+    struct ib_work *rq = ptr_from_int64(wc->id & ~(u_int64_t) IB_WR_ID_FLAGS);
+
+    if (wc->status != 0)
+    {
+        warning("%s: rq %p RDMA read error %s from %s", __func__, rq,
+                wc_status_string(wc->status), rq->c->peername);
+        if (rq->mop && rq->mop->error_code == 0)
+        {
+            rq->mop->error_code = wc->status;
+        }
+    }
+    if (!(wc->id & IB_WR_ID_READ_LAST))
+    {
+        return 0;
+    }
+
+#if !MEMCACHE_BOUNCEBUF
+    memcache_deregister(ib_device->memcache, &rq->buflist);
+#endif
+    if (rq->state.recv & RQ_CANCELLED)
+    {
+        /* the cancel waited for the read to let go of the buffers */
+        rq->state.recv = RQ_CANCELLED;
+        debug(2, "%s: rq %p RDMA read over, cancelled", __func__, rq);
+        return 1;
+    }
+    if (rq->mop && rq->mop->error_code != 0)
+    {
+        rq->state.recv = RQ_ERROR;
+        return 1;
+    }
+
+    /* the data of an RTS_READ has all arrived, ack */
+    rq->state.recv &= ~RQ_READ_WAITING_DATA;
+    rq->state.recv |= RQ_READ_WAITING_DONE_BUFFER;
+    debug(2, "%s: rq %p RDMA read done, now %s", 
+          __func__, rq, rq_state_name(rq->state.recv));
+
+    encourage_read_done_waiting_buffer(rq);
+    return 1;
+}
+
 static int ib_check_cq(void)
 {
     int ret = 0;
@@ -163,6 +220,13 @@ static int ib_check_cq(void)
 
         debug(4, "%s: found something", __func__);
 
+        if (wc.id & IB_WR_ID_READ)
+        {
+            /* tagged, as opcode is not valid on errors */
+            ret += rdma_read_completion(&wc);
+            continue;
+        }
+
         if (wc.status != 0) 
         {
             bh = ptr_from_int64(wc.id);
@@ -208,7 +272,7 @@ static int ib_check_cq(void)
                         llu(wc.id), 
                         wc_opcode_string(wc.opcode),
                         wc_status_string(wc.status), 
-                        bh->c->peername);
+                        bh->c ? bh->c->peername : "(unknown)");
             }
             continue;
         }
@@ -245,6 +309,11 @@ static int ib_check_cq(void)
                 /* incoming CTS messages go to the send engine */
                 encourage_send_incoming_cts(bh, byte_len);
             } 
+            else if (mh_common.type == MSG_READ_DONE)
+            {
+                /* as do the acks of RDMA read transfers */
+                encourage_send_incoming_read_done(bh);
+            }
             else 
             {
                 /* something for the recv side, no known rq yet */
@@ -302,6 +371,14 @@ static int ib_check_cq(void)
                 {
                     sq->state.send = SQ_WAITING_USER_TEST;
                 }
+                else if (state == SQ_WAITING_RTS_READ_SEND_COMPLETION)
+                {
+                    sq->state.send = SQ_WAITING_READ_DONE;
+                }
+                else if (state == SQ_WAITING_RTS_READ_SEND_COMPLETION_GOT_DONE)
+                {
+                    sq->state.send = SQ_WAITING_USER_TEST;
+                }
                 else if (state == SQ_CANCELLED)
                 {
                     ;
@@ -331,6 +408,10 @@ static int ib_check_cq(void)
                 {
                     rq->state.recv &= ~RQ_RTS_WAITING_CTS_SEND_COMPLETION;
                 }
+                else if (state & RQ_READ_WAITING_DONE_SEND_COMPLETION)
+                {
+                    rq->state.recv &= ~RQ_READ_WAITING_DONE_SEND_COMPLETION;
+                }
                 else if (state == RQ_CANCELLED)
                 {
                     ;
@@ -394,12 +475,21 @@ static struct buf_head *get_eager_buf(ib_connection_t *c)
 }
 
 /*
- * Re-post a receive buffer, possibly returning credit to the peer.
+ * Re-post a receive buffer, possibly returning credit to the peer.  A held
+ * copy of a shared receive buffer is just freed; the shared buffer itself
+ * went back to the device when the copy was made.
  */
 static void post_rr(ib_connection_t *c, 
                     struct buf_head *bh)
 {
-    ib_device->func.post_rr(c, bh);
+    if (bh->num < 0)
+    {
+        free(bh);
+    }
+    else
+    {
+        ib_device->func.post_rr(c, bh);
+    }
     ++c->return_credit;
 
     /* if credits are building up, explicitly send them over */
@@ -427,6 +517,75 @@ static void post_rr(ib_connection_t *c,
     }
 }
 
+/*
+ * An incoming message has to wait in its buffer until the user posts or
+ * tests for it.  That is fine for per-connection buffers, but a shared
+ * receive buffer is copied out and reposted right away, so that messages
+ * waiting on one slow peer cannot use up the queue for everyone.  The
+ * credit is still returned only when the returned buffer head is handed
+ * to post_rr().
+ */
+static struct buf_head *hold_eager_buf(struct buf_head *bh, 
+                                       u_int32_t byte_len)
+{
+    struct buf_head *held;
+
+    if (!ib_device->srq)
+    {
+        return bh;
+    }
+
+    held = bmi_ib_malloc(sizeof(*held) + byte_len);
+    INIT_QLIST_HEAD(&held->list);
+    held->num = -1;
+    held->c = bh->c;
+    held->sq = NULL;
+    held->buf = held + 1;
+    memcpy(held->buf, bh->buf, byte_len);
+
+    ib_device->func.post_rr(bh->c, bh);
+    return held;
+}
+
+/*
+ * Append the address, length and remote key of each registered buffer in
+ * the list, as carried by CTS and RTS_READ messages.  Returns the end of
+ * the encoded list.
+ */
+static char *encode_buflist(char *ptr, 
+                            const ib_buflist_t *buflist)
+{
+    u_int64_t *bufp = (u_int64_t *) ptr;
+    u_int32_t *lenp = (u_int32_t *)(bufp + buflist->num);
+    u_int32_t *keyp = (u_int32_t *)(lenp + buflist->num);
+    int i;
+
+    for (i = 0; i < buflist->num; i++) 
+    {
+        bufp[i] = htobmi64(int64_from_ptr(buflist->buf.recv[i]));
+        lenp[i] = htobmi32(buflist->len[i]);
+        keyp[i] = htobmi32(buflist->memcache[i]->memkeys.rkey);
+    }
+    return (char *)(keyp + buflist->num);
+}
+
+/*
+ * Large messages are pulled by the receiver with RDMA read when the peer
+ * supports it and our buffer list fits in one eager message.  Otherwise
+ * the RTS/CTS exchange is used and we RDMA write the data.
+ */
+static int use_rdma_read(const struct ib_work *sq)
+{
+#if MEMCACHE_BOUNCEBUF
+    return 0;
+#else
+    return sq->c->rdma_read &&
+           sizeof(msg_header_rts_read_t) + 
+             sq->buflist.num * MSG_HEADER_CTS_BUFLIST_ENTRY_SIZE <= 
+             ib_device->eager_buf_size;
+#endif
+}
+
 /*
  * Push a send message along its next step.  Called internally only.
  */
@@ -487,6 +646,38 @@ static void encourage_send_waiting_buffer(struct ib_work *sq)
         debug(2, "%s: sq %p sent EAGER len %lld", 
               __func__, sq, lld(sq->buflist.tot_len));
     } 
+    else if (use_rdma_read(sq))
+    {
+        /*
+         * Request to send with our buffer list, for the receiver to read
+         * from directly.  The mop id comes back in the READ_DONE.
+         */
+        msg_header_rts_read_t mh_rts_read;
+        char *ptr = bh->buf;
+        char *end;
+
+        memcache_register(ib_device->memcache, &sq->buflist);
+
+        memset(&mh_rts_read, 0, sizeof(msg_header_rts_read_t));
+        msg_header_init(&mh_rts_read.c, c, MSG_RTS_READ);
+        mh_rts_read.bmi_tag = sq->bmi_tag;
+        mh_rts_read.buflist_num = sq->buflist.num;
+        mh_rts_read.mop_id = sq->mop->op_id;
+        mh_rts_read.tot_len = sq->buflist.tot_len;
+
+        encode_msg_header_rts_read_t(&ptr, &mh_rts_read);
+        end = encode_buflist((char *)((msg_header_rts_read_t *) bh->buf + 1),
+                             &sq->buflist);
+
+        post_sr(bh, end - (char *) bh->buf);
+
+        sq->state.send = SQ_WAITING_RTS_READ_SEND_COMPLETION;
+        debug(2, "%s: sq %p sent RTS_READ mopid %llx len %lld", 
+              __func__, 
+              sq, 
+              llu(sq->mop->op_id), 
+              lld(sq->buflist.tot_len));
+    }
     else 
     {
         /*
@@ -607,6 +798,62 @@ static void encourage_send_incoming_cts(struct buf_head *bh,
     debug(0, "%s: sq %p now %s", __func__, sq, sq_state_name(sq->state.send));
 }
 
+/*
+ * The receiver has read all the data named in our RTS_READ.  Unpin and
+ * let the user test for completion, or wait for our own RTS_READ send
+ * completion if that is still to come.
+ */
+static void encourage_send_incoming_read_done(struct buf_head *bh)
+{
+    msg_header_rts_done_t mh_read_done;
+    struct ib_work *sq, *sqt;
+    char *ptr = bh->buf;
+
+    decode_msg_header_rts_done_t(&ptr, &mh_read_done);
+
+    sq = NULL;
+    qlist_for_each_entry(sqt, &ib_device->sendq, list) 
+    {
+        if (sqt->c == bh->c && 
+            sqt->mop->op_id == (bmi_op_id_t) mh_read_done.mop_id) 
+        {
+            sq = sqt;
+            break;
+        }
+    }
+
+    /* nothing more to get out of the message */
+    post_rr(bh->c, bh);
+
+    if (!sq)
+    {
+        error("%s: mop_id %llx in READ_DONE message not found", 
+              __func__, llu(mh_read_done.mop_id));
+        return;
+    }
+
+    if (sq->state.send == SQ_WAITING_READ_DONE)
+    {
+        sq->state.send = SQ_WAITING_USER_TEST;
+    }
+    else if (sq->state.send == SQ_WAITING_RTS_READ_SEND_COMPLETION)
+    {
+        sq->state.send = SQ_WAITING_RTS_READ_SEND_COMPLETION_GOT_DONE;
+    }
+    else
+    {
+        error("%s: wrong send state %s", 
+              __func__, sq_state_name(sq->state.send));
+        return;
+    }
+
+#if !MEMCACHE_BOUNCEBUF
+    memcache_deregister(ib_device->memcache, &sq->buflist);
+#endif
+
+    debug(2, "%s: sq %p now %s", __func__, sq, sq_state_name(sq->state.send));
+}
+
 
 /*
  * See if anything was preposted that matches this.
@@ -711,7 +958,7 @@ static void encourage_recv_incoming(struct buf_head *bh,
         } 
         else 
         {
-            rq = alloc_new_recv(c, bh);
+            rq = alloc_new_recv(c, hold_eager_buf(bh, byte_len));
             /* return value for when user does post_recv for this one */
             rq->bmi_tag = mh_eager.bmi_tag;
             rq->state.recv = RQ_EAGER_WAITING_USER_POST;
@@ -732,7 +979,7 @@ static void encourage_recv_incoming(struct buf_head *bh,
 
         debug(2, "%s: recv eager unexpected len %u", __func__, byte_len);
 
-        rq = alloc_new_recv(c, bh);
+        rq = alloc_new_recv(c, hold_eager_buf(bh, byte_len));
         /* return values for when user does testunexpected for this one */
         rq->bmi_tag = mh_eager.bmi_tag;
         rq->state.recv = RQ_EAGER_WAITING_USER_TESTUNEXPECTED;
@@ -806,6 +1053,66 @@ static void encourage_recv_incoming(struct buf_head *bh,
             /* else keep waiting until we can send that cts */
         }
     } 
+    else if (type == MSG_RTS_READ) 
+    {
+        /*
+         * Sender wants to send a big message and told us where it is.
+         * Read it now if the user has posted a matching receive, else
+         * keep the buffer list until the user posts.
+         */
+        msg_header_rts_read_t mh_rts_read;
+        u_int32_t want;
+
+        ptr = bh->buf;
+        decode_msg_header_rts_read_t(&ptr, &mh_rts_read);
+
+        debug(2, "%s: recv RTS_READ len %lld mopid %llx", 
+              __func__,
+              lld(mh_rts_read.tot_len), 
+              llu(mh_rts_read.mop_id));
+
+        want = sizeof(mh_rts_read) + 
+               mh_rts_read.buflist_num * MSG_HEADER_CTS_BUFLIST_ENTRY_SIZE;
+        if (bmi_ib_unlikely(byte_len != want))
+        {
+            error("%s: wrong message size for RTS_READ, got %u, want %u", 
+                  __func__, byte_len, want);
+            post_rr(c, bh);
+            return;
+        }
+
+        rq = find_matching_recv(RQ_WAITING_INCOMING, c, mh_rts_read.bmi_tag);
+        if (rq) 
+        {
+            if ((bmi_size_t) mh_rts_read.tot_len > rq->buflist.tot_len) 
+            {
+                error("%s: RTS_READ received %llu too large for buffer %llu",
+                      __func__, 
+                      llu(mh_rts_read.tot_len), 
+                      llu(rq->buflist.tot_len));
+                post_rr(c, bh);
+                return;
+            }
+            rq->actual_len = mh_rts_read.tot_len;
+            rq->rts_mop_id = mh_rts_read.mop_id;
+            post_rdma_read(rq, bh);
+            post_rr(c, bh);
+        } 
+        else 
+        {
+            rq = alloc_new_recv(c, hold_eager_buf(bh, byte_len));
+            /* return value for when user does post_recv for this one */
+            rq->bmi_tag = mh_rts_read.bmi_tag;
+            rq->actual_len = mh_rts_read.tot_len;
+            rq->rts_mop_id = mh_rts_read.mop_id;
+            rq->state.recv = RQ_RTS_READ_WAITING_USER_POST;
+            /* do not repost, keeping the buffer list until user post */
+        }
+        debug(2, "%s: rq %p MSG_RTS_READ now %s", 
+              __func__, 
+              rq,
+              rq_state_name(rq->state.recv));
+    } 
     else if (type == MSG_RTS_DONE) 
     {
         msg_header_rts_done_t mh_rts_done;
@@ -940,12 +1247,8 @@ static int send_cts(struct ib_work *rq)
     ib_connection_t *c = rq->c;
     struct buf_head *bh;
     msg_header_cts_t mh_cts;
-    u_int64_t *bufp;
-    u_int32_t *lenp;
-    u_int32_t *keyp;
     u_int32_t post_len;
     char *ptr;
-    int i;
 
     debug(2, "%s: rq %p from %s mopid %llx len %lld", 
           __func__,
@@ -999,22 +1302,15 @@ static int send_cts(struct ib_work *rq)
     encode_msg_header_cts_t(&ptr, &mh_cts);
 
     /* encode all the buflist entries */
-    bufp = (u_int64_t *)((msg_header_cts_t *) bh->buf + 1);
-    lenp = (u_int32_t *)(bufp + rq->buflist.num);
-    keyp = (u_int32_t *)(lenp + rq->buflist.num);
-    post_len = (char *)(keyp + rq->buflist.num) - (char *)bh->buf;
+    post_len = sizeof(mh_cts) + 
+               rq->buflist.num * MSG_HEADER_CTS_BUFLIST_ENTRY_SIZE;
     if (post_len > ib_device->eager_buf_size)
     {
         error("%s: too many (%d) recv buflist entries for buf", 
               __func__, rq->buflist.num);
         return 1;
     }
-    for (i = 0; i < rq->buflist.num; i++) 
-    {
-        bufp[i] = htobmi64(int64_from_ptr(rq->buflist.buf.recv[i]));
-        lenp[i] = htobmi32(rq->buflist.len[i]);
-        keyp[i] = htobmi32(rq->buflist.memcache[i]->memkeys.rkey);
-    }
+    encode_buflist((char *)((msg_header_cts_t *) bh->buf + 1), &rq->buflist);
 
     /* send the cts */
     post_sr(bh, post_len);
@@ -1026,6 +1322,70 @@ static int send_cts(struct ib_work *rq)
     return 0;
 }
 
+/*
+ * Start pulling the data of an RTS_READ, whose buffer list is in bh, into
+ * the receive buffers.  Pins the receive buffers like send_cts; the RDMA
+ * read completion unpins them.
+ */
+static void post_rdma_read(struct ib_work *rq, 
+                           struct buf_head *bh)
+{
+    msg_header_rts_read_t mh_rts_read;
+    char *ptr = bh->buf;
+
+    decode_msg_header_rts_read_t(&ptr, &mh_rts_read);
+
+    debug(2, "%s: rq %p from %s mopid %llx len %lld", 
+          __func__,
+          rq, 
+          rq->c->peername, 
+          llu(rq->rts_mop_id),
+          lld(rq->actual_len));
+
+#if !MEMCACHE_EARLY_REG
+    memcache_register(ib_device->memcache, &rq->buflist);
+#endif
+    rq->mop->error_code = 0;  /* first failed read, if any */
+    ib_device->func.post_sr_rdmar(rq, 
+                                  mh_rts_read.buflist_num,
+                                  (msg_header_rts_read_t *) bh->buf + 1);
+    rq->state.recv = RQ_READ_WAITING_DATA | RQ_RTS_WAITING_USER_TEST;
+}
+
+/*
+ * We finished the RDMA read.  Send him a done message so he can unpin.
+ */
+static void encourage_read_done_waiting_buffer(struct ib_work *rq)
+{
+    ib_connection_t *c = rq->c;
+    struct buf_head *bh;
+    char *ptr;
+    msg_header_rts_done_t mh_read_done;
+
+    bh = get_eager_buf(c);
+    if (!bh) 
+    {
+        debug(2, "%s: rq %p no free send buffers to %s",
+              __func__, rq, c->peername);
+        return;
+    }
+    rq->bh = bh;
+    bh->sq = rq;  /* uplink for completion */
+    ptr = bh->buf;
+
+    msg_header_init(&mh_read_done.c, c, MSG_READ_DONE);
+    mh_read_done.mop_id = rq->rts_mop_id;
+
+    debug(2, "%s: rq %p sent READ_DONE mopid %llx", 
+          __func__, rq, llu(rq->rts_mop_id));
+
+    encode_msg_header_rts_done_t(&ptr, &mh_read_done);
+
+    post_sr(bh, sizeof(mh_read_done));
+    rq->state.recv &= ~RQ_READ_WAITING_DONE_BUFFER;
+    rq->state.recv |= RQ_READ_WAITING_DONE_SEND_COMPLETION;
+}
+
 /*
  * Bring up the connection before posting a send or receive on it.
  */
@@ -1291,7 +1651,8 @@ static int post_recv(bmi_op_id_t *id,
 
     /* check to see if matching recv is in the queue */
     rq = find_matching_recv(RQ_EAGER_WAITING_USER_POST | 
-                                RQ_RTS_WAITING_USER_POST, 
+                                RQ_RTS_WAITING_USER_POST |
+                                RQ_RTS_READ_WAITING_USER_POST, 
                             c, 
                             tag);
     if (rq) 
@@ -1412,6 +1773,33 @@ static int post_recv(bmi_op_id_t *id,
         }
         goto out;
     }
+    else if (rq->state.recv == RQ_RTS_READ_WAITING_USER_POST) 
+    {
+        debug(2, "%s: rq %p %s start read", 
+              __func__, 
+              rq,
+              rq_state_name(rq->state.recv));
+
+        if (rq->actual_len > tot_expected_len) 
+        {
+            error("%s: RTS_READ %lld matches too-small buffer %lld",
+                  __func__, 
+                  lld(rq->actual_len), 
+                  lld(rq->buflist.tot_len));
+            ret = -EINVAL;
+            goto out;
+        }
+
+#if MEMCACHE_EARLY_REG
+        memcache_register(ib_device->memcache, &rq->buflist);
+#endif
+        post_rdma_read(rq, rq->bh);
+
+        /* done with the sender's buffer list */
+        post_rr(rq->c, rq->bh);
+        rq->bh = NULL;
+        goto out;
+    }
 
 #if MEMCACHE_EARLY_REG
     /* but remember that this might not be used if the other side sends
@@ -1693,6 +2081,14 @@ static int test_rq(struct ib_work *rq,
               rq, 
               rq_state_name(rq->state.recv));
     } 
+    else if (rq->state.recv & RQ_READ_WAITING_DONE_BUFFER) 
+    {
+        debug(2, "%s: rq %p %s, encouraging", 
+              __func__, 
+              rq,
+              rq_state_name(rq->state.recv));
+        encourage_read_done_waiting_buffer(rq);
+    } 
     else if (rq->state.recv == RQ_CANCELLED && complete) 
     {
         debug(2, "%s: rq %p cancelled", __func__, rq);
@@ -2122,6 +2518,12 @@ static int BMI_ib_cancel(bmi_op_id_t id,
             {
                 memcache_deregister(ib_device->memcache, &sq->buflist);
             }
+            /* pin when sending rts_read, release when read done */
+            if (sq->state.send == SQ_WAITING_RTS_READ_SEND_COMPLETION ||
+                sq->state.send == SQ_WAITING_READ_DONE)
+            {
+                memcache_deregister(ib_device->memcache, &sq->buflist);
+            }
     #if MEMCACHE_EARLY_REG
             /* pin when sending rts, so also must dereg in this state */
             if (sq->state.send == SQ_WAITING_RTS_SEND_COMPLETION ||
@@ -2158,8 +2560,23 @@ static int BMI_ib_cancel(bmi_op_id_t id,
             }
     #endif
 #endif
-            if (!(rq->state.recv == RQ_EAGER_WAITING_USER_TEST 
-               || rq->state.recv == RQ_RTS_WAITING_USER_TEST))
+            /* copies of shared recv bufs waiting for the user */
+            if ((rq->state.recv & (RQ_EAGER_WAITING_USER_POST |
+                                   RQ_EAGER_WAITING_USER_TESTUNEXPECTED |
+                                   RQ_RTS_READ_WAITING_USER_POST))
+              && rq->bh->num < 0)
+            {
+                free(rq->bh);
+                rq->bh = NULL;
+            }
+            if (rq->state.recv & RQ_READ_WAITING_DATA)
+            {
+                /* the read still writes the buffers; its completion
+                 * unpins them and lets the rq go */
+                rq->state.recv = RQ_CANCELLED | RQ_READ_WAITING_DATA;
+            }
+            else if (!(rq->state.recv == RQ_EAGER_WAITING_USER_TEST 
+                    || rq->state.recv == RQ_RTS_WAITING_USER_TEST))
             {
                 rq->state.recv = RQ_CANCELLED;
             }
@@ -2318,31 +2735,42 @@ static ib_connection_t *ib_new_connection(int sock,
     /* fill send and recv free lists and buf heads */
     c->eager_send_buf_contig = bmi_ib_malloc(ib_device->eager_buf_num * 
                                ib_device->eager_buf_size);
-    c->eager_recv_buf_contig = bmi_ib_malloc(ib_device->eager_buf_num * 
-                               ib_device->eager_buf_size);
     INIT_QLIST_HEAD(&c->eager_send_buf_free);
     INIT_QLIST_HEAD(&c->eager_recv_buf_free);
     c->eager_send_buf_head_contig = bmi_ib_malloc(ib_device->eager_buf_num * 
                                     sizeof(*c->eager_send_buf_head_contig));
-    c->eager_recv_buf_head_contig = bmi_ib_malloc(ib_device->eager_buf_num * 
-                                    sizeof(*c->eager_recv_buf_head_contig));
+    c->eager_recv_buf_contig = NULL;
+    c->eager_recv_buf_head_contig = NULL;
 
     for (i = 0; i < ib_device->eager_buf_num; i++) 
     {
         struct buf_head *ebs = &c->eager_send_buf_head_contig[i];
-        struct buf_head *ebr = &c->eager_recv_buf_head_contig[i];
         INIT_QLIST_HEAD(&ebs->list);
-        INIT_QLIST_HEAD(&ebr->list);
         ebs->c = c;
-        ebr->c = c;
         ebs->num = i;
-        ebr->num = i;
         ebs->buf = (char *) c->eager_send_buf_contig + i * 
                    ib_device->eager_buf_size;
-	ebr->buf = (char *) c->eager_recv_buf_contig + i * 
-                   ib_device->eager_buf_size;
         qlist_add_tail(&ebs->list, &c->eager_send_buf_free);
-        qlist_add_tail(&ebr->list, &c->eager_recv_buf_free);
+    }
+
+    /* eager messages arrive in the shared receive queue, if there is one */
+    if (!ib_device->srq)
+    {
+        c->eager_recv_buf_contig = bmi_ib_malloc(ib_device->eager_buf_num * 
+                                   ib_device->eager_buf_size);
+        c->eager_recv_buf_head_contig = bmi_ib_malloc(
+                                    ib_device->eager_buf_num * 
+                                    sizeof(*c->eager_recv_buf_head_contig));
+        for (i = 0; i < ib_device->eager_buf_num; i++) 
+        {
+            struct buf_head *ebr = &c->eager_recv_buf_head_contig[i];
+            INIT_QLIST_HEAD(&ebr->list);
+            ebr->c = c;
+            ebr->num = i;
+            ebr->buf = (char *) c->eager_recv_buf_contig + i * 
+                       ib_device->eager_buf_size;
+            qlist_add_tail(&ebr->list, &c->eager_recv_buf_free);
+        }
     }
 
     /* put it on the list */
@@ -2358,6 +2786,9 @@ static ib_connection_t *ib_new_connection(int sock,
     c->send_credit = ib_device->eager_buf_num - 1;
     c->return_credit = 0;
 
+    /* set by new_connection if both sides can do it */
+    c->rdma_read = 0;
+
     if (is_server)
     {
         debug(4, "%s: [SERVER SIDE] calling new_connection, sock=%d",
@@ -2892,6 +3323,13 @@ static int BMI_ib_initialize(struct bmi_method_addr *listen_addr,
     bmi_ib_method_id = method_id;
 
     ib_device = bmi_ib_malloc(sizeof(*ib_device));
+    memset(ib_device, 0, sizeof(*ib_device));
+
+    /* the device sizes its shared receive queue buffers from these */
+    ib_device->eager_buf_num  = DEFAULT_EAGER_BUF_NUM;
+    ib_device->eager_buf_size = DEFAULT_EAGER_BUF_SIZE;
+    ib_device->eager_buf_payload = ib_device->eager_buf_size - 
+                                   sizeof(msg_header_eager_t);
 
     /* try, in order, OpenIB then VAPI; set up function pointers */
     ret = 1;
@@ -2945,11 +3383,6 @@ static int BMI_ib_initialize(struct bmi_method_addr *listen_addr,
     INIT_QLIST_HEAD(&ib_device->sendq);
     INIT_QLIST_HEAD(&ib_device->recvq);
 
-    ib_device->eager_buf_num  = DEFAULT_EAGER_BUF_NUM;
-    ib_device->eager_buf_size = DEFAULT_EAGER_BUF_SIZE;
-    ib_device->eager_buf_payload = ib_device->eager_buf_size - 
-                                   sizeof(msg_header_eager_t);
-
     gen_mutex_unlock(&interface_mutex);
 
     debug(0, "IB module successfully initialized");
@@ -32,6 +32,13 @@
  *       that prevented it from ever using small-io.
  */ 
 
+/* eager receive buffers posted to the shared receive queue, for all
+ * connections together; change with the srq_bufs=N option, 0 disables */
+#define DEFAULT_SRQ_BUF_NUM (512)
+
+/* optional protocol features, traded at connection setup */
+#define BMI_IB_FEATURE_RDMA_READ 0x1
+
 struct buf_head;
 
 /*
@@ -45,7 +52,7 @@ typedef struct {
     struct bmi_method_addr *remote_map;
     char *peername;  /* string representation of remote_map */
 
-    /* per-connection buffers */
+    /* per-connection buffers; no recv bufs when using a shared recv queue */
     void *eager_send_buf_contig;    /* bounce bufs, for short sends */
     void *eager_recv_buf_contig;    /* eager bufs, for short recvs */
 
@@ -62,6 +69,8 @@ typedef struct {
     int send_credit;    /* free slots on receiver */
     int return_credit;  /* receive buffers he filled but that we've emptied */
 
+    int rdma_read;  /* both sides move large messages with RDMA read */
+
     void *priv;
 
     BMI_addr_t bmi_addr;
@@ -73,8 +82,10 @@ typedef struct {
  */
 struct buf_head {
     struct qlist_head list;
-    int num;             /* ordinal index in the alloced buf heads */
-    ib_connection_t *c;  /* owning connection */
+    int num;             /* ordinal index in the alloced buf heads, or
+                            -1 for a held copy of a shared recv buf */
+    ib_connection_t *c;  /* owning connection, or sender of the message
+                            now in a shared recv buf */
     struct ib_work *sq;  /* owning sq (usually) or rq */
     void *buf;           /* actual memory */
 };
@@ -104,6 +115,9 @@ typedef enum {
     SQ_WAITING_USER_TEST,
     SQ_CANCELLED,
     SQ_ERROR,
+    SQ_WAITING_RTS_READ_SEND_COMPLETION,
+    SQ_WAITING_RTS_READ_SEND_COMPLETION_GOT_DONE,
+    SQ_WAITING_READ_DONE,
 } sq_state_t;
 typedef enum {  /* bits *_USER_POST will be ORed */
     RQ_EAGER_WAITING_USER_POST = 0x1,
@@ -117,6 +131,10 @@ typedef enum {  /* bits *_USER_POST will be ORed */
     RQ_WAITING_INCOMING = 0x100,
     RQ_CANCELLED = 0x200,
     RQ_ERROR = 0x400,
+    RQ_RTS_READ_WAITING_USER_POST = 0x800,
+    RQ_READ_WAITING_DATA = 0x1000,
+    RQ_READ_WAITING_DONE_BUFFER = 0x2000,
+    RQ_READ_WAITING_DONE_SEND_COMPLETION = 0x4000,
 } rq_state_t;
 typedef enum {
     MSG_EAGER_SEND = 1,
@@ -126,6 +144,8 @@ typedef enum {
     MSG_RTS_DONE,
     MSG_CREDIT,
     MSG_BYE,
+    MSG_RTS_READ,
+    MSG_READ_DONE,
 } msg_type_t;
 
 #ifdef __util_c
@@ -146,6 +166,9 @@ static name_t sq_state_names[] = {
     entry(SQ_WAITING_USER_TEST),
     entry(SQ_CANCELLED),
     entry(SQ_ERROR),
+    entry(SQ_WAITING_RTS_READ_SEND_COMPLETION),
+    entry(SQ_WAITING_RTS_READ_SEND_COMPLETION_GOT_DONE),
+    entry(SQ_WAITING_READ_DONE),
     { 0, 0 }
 };
 static name_t rq_state_names[] = {
@@ -160,6 +183,10 @@ static name_t rq_state_names[] = {
     entry(RQ_WAITING_INCOMING),
     entry(RQ_CANCELLED),
     entry(RQ_ERROR),
+    entry(RQ_RTS_READ_WAITING_USER_POST),
+    entry(RQ_READ_WAITING_DATA),
+    entry(RQ_READ_WAITING_DONE_BUFFER),
+    entry(RQ_READ_WAITING_DONE_SEND_COMPLETION),
     { 0, 0 }
 };
 static name_t msg_type_names[] = {
@@ -170,6 +197,8 @@ static name_t msg_type_names[] = {
     entry(MSG_RTS_DONE),
     entry(MSG_CREDIT),
     entry(MSG_BYE),
+    entry(MSG_RTS_READ),
+    entry(MSG_READ_DONE),
     { 0, 0 }
 };
 #undef entry
@@ -334,6 +363,28 @@ endecode_fields_3(msg_header_rts_done_t,
     uint32_t, c.credit,
     uint64_t, mop_id);
 
+/*
+ * MSG_RTS_READ instead of MSG_RTS when the peer supports RDMA read.  The
+ * sender's buffer list follows, in the same format as for the CTS, and the
+ * receiver pulls the data as soon as the matching receive is posted.  The
+ * receiver answers with a MSG_READ_DONE, using msg_header_rts_done_t, so
+ * that the sender can unpin and complete.
+ */
+typedef struct {
+    msg_header_common_t c;
+    bmi_msg_tag_t bmi_tag;
+    u_int32_t buflist_num;  /* number of buffers, then lengths to follow */
+    u_int64_t mop_id;  /* returned in the MSG_READ_DONE */
+    u_int64_t tot_len;
+} msg_header_rts_read_t;
+endecode_fields_6(msg_header_rts_read_t,
+    enum, c.type,
+    uint32_t, c.credit,
+    int32_t, bmi_tag,
+    uint32_t, buflist_num,
+    uint64_t, mop_id,
+    uint64_t, tot_len);
+
 
 /*
  * Generic work completion from poll_cq() for both vapi and openib.
@@ -342,7 +393,8 @@ struct bmi_ib_wc {
     uint64_t id;
     int status;  /* opaque, but zero means success */
     uint32_t byte_len;
-    enum { BMI_IB_OP_SEND, BMI_IB_OP_RECV, BMI_IB_OP_RDMA_WRITE } opcode;
+    enum { BMI_IB_OP_SEND, BMI_IB_OP_RECV, BMI_IB_OP_RDMA_WRITE,
+           BMI_IB_OP_RDMA_READ } opcode;
 };
 
 /*
@@ -358,6 +410,9 @@ struct ib_device_func {
     void (*post_rr)(const ib_connection_t *c, struct buf_head *bh);
     void (*post_sr_rdmaw)(struct ib_work *sq, msg_header_cts_t *mh_cts,
                           void *mh_cts_buf);
+    /* NULL if the device cannot do the RDMA read rendez-vous */
+    void (*post_sr_rdmar)(struct ib_work *rq, u_int32_t buflist_num,
+                          void *buflist_buf);
     void (*prepare_cq_block)(int *cq_fd, int *async_fd);
     void (*ack_cq_completion_event)(void);
     int (*check_cq)(struct bmi_ib_wc *wc);
@@ -392,6 +447,15 @@ typedef struct {
     unsigned long eager_buf_size;
     bmi_size_t eager_buf_payload;
 
+    /*
+     * Set by the device when eager messages from all connections arrive in
+     * one shared receive queue.  The connections then have no receive
+     * buffers of their own, and messages that have to wait for the user are
+     * copied out so that the shared buffer can be reposted at once.  Credits
+     * still limit each sender to eager_buf_num messages in flight.
+     */
+    int srq;
+
     void *priv;
     struct ib_device_func func;
 
@@ -442,6 +506,15 @@ void memcache_cache_flush(void *md);
 #define ptr_from_int64(p) (void *)(unsigned long)(p)
 #define int64_from_ptr(p) (u_int64_t)(unsigned long)(p)
 
+/*
+ * The RDMA reads of an rq carry the rq in their wr_id, with low bits, free
+ * in an aligned pointer, marking the entry as a read and the last read of
+ * the rq, the only one signaled.  Unsignaled reads complete only on error.
+ */
+#define IB_WR_ID_READ 0x2
+#define IB_WR_ID_READ_LAST 0x1
+#define IB_WR_ID_FLAGS 0x3
+
 /* make cast from list entry to actual item explicit */
 #define qlist_upcast(l) ((void *)(l))
 
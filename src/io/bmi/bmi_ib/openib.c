@@ -15,6 +15,7 @@
 #include <src/common/misc/pvfs2-internal.h>  /* llu */
 #include <infiniband/verbs.h>
 #include <ctype.h>
+#include <src/common/quickhash/quickhash.h>
 
 #ifdef HAVE_VALGRIND_H
 #include <memcheck.h>
@@ -73,6 +74,23 @@ struct openib_device_priv {
     unsigned int max_unsignaled_sends;
     
     enum transport_type transport_type;
+
+    /* RDMA reads in flight per QP, as initiator and as target */
+    int max_rd_atomic;
+    int max_dest_rd_atomic;
+    int max_sge_rd;  /* scatter entries allowed in one RDMA read */
+
+    /*
+     * Shared receive queue with its eager buffers, or NULL if the NIC does
+     * not have one or it was turned off.  A completion on it only names the
+     * QP, so connections are found by QP number in qp_table.
+     */
+    struct ibv_srq *srq;
+    struct ibv_mr *srq_mr;
+    int srq_buf_num;
+    void *srq_buf_contig;
+    struct buf_head *srq_buf_head_contig;
+    struct qhash_table *qp_table;
 };
 
 /*
@@ -89,6 +107,9 @@ struct openib_connection_priv {
     /* ib remote params */
     union nic_id remote_id;
     uint32_t remote_qp_num;
+    uint32_t max_inline_data;  /* sends up to this long go inline */
+    ib_connection_t *c;
+    struct qhash_head qp_link;  /* in qp_table, with a shared recv queue */
 };
 
 /* NOTE:  You have to be sure that ib_uverbs.ko is loaded, otherwise it
@@ -100,6 +121,10 @@ struct openib_connection_priv {
 static const int DEFAULT_IBV_PORT = 1;
 static const unsigned int IBV_NUM_CQ_ENTRIES = 1024;
 static const int IBV_MTU = IBV_MTU_1024;  /* dmtu, 1k good for mellanox */
+/* headers, credits and small eager messages go inline with the descriptor */
+static const uint32_t IBV_MAX_INLINE = 256;
+static const int IBV_MAX_RD_ATOMIC = 16;
+static const int QP_TABLE_SIZE = 1021;
 
 static int exchange_data(int sock, 
                          int is_server, 
@@ -112,8 +137,12 @@ static void init_connection_modify_qp(struct ibv_qp *qp,
 static void openib_post_rr(const ib_connection_t *c, 
                            struct buf_head *bh);
 int parse_bmi_opts_get_ib_port(char *options);
+static int parse_bmi_opts_get_int(char *options, 
+                                  const char *name, 
+                                  int def);
 int openib_ib_initialize(char *options);
 static void openib_ib_finalize(void);
+static const char *openib_wc_status_string(int status);
 
 
 /*
@@ -152,25 +181,32 @@ static int openib_new_connection(ib_connection_t *c,
         } id;
         uint32_t qp_num;
     } ch_in, ch_out;
+    uint32_t features_in, features_out;
 
     /* build new connection/context */
     oc = bmi_ib_malloc(sizeof(*oc));
+    memset(oc, 0, sizeof(*oc));
+    INIT_QHASH_HEAD(&oc->qp_link);
+    oc->c = c;
     c->priv = oc;
 
-    /* register memory region, Recv side */
+    /* register memory region, Recv side, unless using the shared queue */
     len = ib_device->eager_buf_num * ib_device->eager_buf_size;
 
-    debug(0, "%s: calling ibv_reg_mr recv side", __func__);
-    oc->eager_recv_mr = ibv_reg_mr(od->nic_pd, 
-                                   c->eager_recv_buf_contig, 
-                                   len,
-                                   IBV_ACCESS_LOCAL_WRITE | 
-                                     IBV_ACCESS_REMOTE_WRITE | 
-                                     IBV_ACCESS_REMOTE_READ);
-    if (!oc->eager_recv_mr)
+    if (!od->srq)
     {
-        error("%s: register_mr eager recv", __func__);
-        return -ENOMEM;
+        debug(0, "%s: calling ibv_reg_mr recv side", __func__);
+        oc->eager_recv_mr = ibv_reg_mr(od->nic_pd, 
+                                       c->eager_recv_buf_contig, 
+                                       len,
+                                       IBV_ACCESS_LOCAL_WRITE | 
+                                         IBV_ACCESS_REMOTE_WRITE | 
+                                         IBV_ACCESS_REMOTE_READ);
+        if (!oc->eager_recv_mr)
+        {
+            error("%s: register_mr eager recv", __func__);
+            return -ENOMEM;
+        }
     }
 
     /* register memory region, Send side */
@@ -192,37 +228,49 @@ static int openib_new_connection(ib_connection_t *c,
     memset(&att, 0, sizeof(att));
     att.send_cq = od->nic_cq;
     att.recv_cq = od->nic_cq;
+    att.srq = od->srq;
     num_wr = ib_device->eager_buf_num + 50;  /* plus some rdmaw */
     if (num_wr > od->nic_max_wr)
     {
         num_wr = od->nic_max_wr;
     }
-    att.cap.max_recv_wr = num_wr;
+    att.cap.max_recv_wr = od->srq ? 0 : num_wr;
     att.cap.max_send_wr = num_wr;
-    att.cap.max_recv_sge = 16;
+    att.cap.max_recv_sge = od->srq ? 0 : 16;
     att.cap.max_send_sge = 16;
-    if ((int) att.cap.max_recv_sge > od->nic_max_sge) 
+    if (16 > od->nic_max_sge) 
     {
-        att.cap.max_recv_sge = od->nic_max_sge;
+        if (!od->srq)
+        {
+            att.cap.max_recv_sge = od->nic_max_sge;
+        }
         /* -1 to work around mellanox issue */
         att.cap.max_send_sge = od->nic_max_sge - 1;
     }
+    att.cap.max_inline_data = IBV_MAX_INLINE;
     att.qp_type = IBV_QPT_RC;
     debug(0, "%s: calling ibv_create_qp", __func__);
     oc->qp = ibv_create_qp(od->nic_pd, &att);
     if (!oc->qp)
+    {
+        /* some NICs cannot send inline at all */
+        att.cap.max_inline_data = 0;
+        oc->qp = ibv_create_qp(od->nic_pd, &att);
+    }
+    if (!oc->qp)
     {
         error("%s: create QP", __func__);
         return -EINVAL;
     }
     VALGRIND_MAKE_MEM_DEFINED(&att, sizeof(att));
     VALGRIND_MAKE_MEM_DEFINED(&oc->qp->qp_num, sizeof(oc->qp->qp_num));
+    oc->max_inline_data = att.cap.max_inline_data;
 
     /* compare the caps that came back against what we already have */
     if (od->sg_max_len == 0) 
     {
         od->sg_max_len = att.cap.max_send_sge;
-        if (att.cap.max_recv_sge < od->sg_max_len)
+        if (!od->srq && att.cap.max_recv_sge < od->sg_max_len)
         {
             od->sg_max_len = att.cap.max_recv_sge;
         }
@@ -237,7 +285,7 @@ static int openib_new_connection(ib_connection_t *c,
                   __func__, att.cap.max_send_sge, od->sg_max_len);
             return -EINVAL;
         }
-        if (att.cap.max_recv_sge < od->sg_max_len)
+        if (!od->srq && att.cap.max_recv_sge < od->sg_max_len)
         {
             error("%s: new conn has smaller recv SG array size %d vs %d",
                   __func__, att.cap.max_recv_sge, od->sg_max_len);
@@ -260,7 +308,7 @@ static int openib_new_connection(ib_connection_t *c,
     }
 
     /* verify we got what we asked for */
-    if ((int) att.cap.max_recv_wr < num_wr)
+    if (!od->srq && (int) att.cap.max_recv_wr < num_wr)
     {
         error("%s: asked for %d recv WRs on QP, got %d", 
               __func__, num_wr, att.cap.max_recv_wr);
@@ -308,18 +356,40 @@ static int openib_new_connection(ib_connection_t *c,
     debug(0, "%s: calling init_connection_modify_qp", __func__);
     init_connection_modify_qp(oc->qp, oc->remote_qp_num, oc->remote_id);
 
-    /* post initial RRs and RRs for acks */
-    debug(0, "%s: entering for loop for openib_post_rr", __func__);
-    for (i = 0; i < ib_device->eager_buf_num; i++)
+    if (od->srq)
     {
-        openib_post_rr(c, &c->eager_recv_buf_head_contig[i]);
+        /* so that messages in the shared queue find their connection */
+        qhash_add(od->qp_table, &oc->qp->qp_num, &oc->qp_link);
+    }
+    else
+    {
+        /* post initial RRs and RRs for acks */
+        debug(0, "%s: entering for loop for openib_post_rr", __func__);
+        for (i = 0; i < ib_device->eager_buf_num; i++)
+        {
+            openib_post_rr(c, &c->eager_recv_buf_head_contig[i]);
+        }
     }
 
-    /* final sychronization to ensure both sides have posted RRs */
+    /* final sychronization to ensure both sides have posted RRs; this
+     * also trades optional protocol features, older peers send zero */
+    features_out = 0;
+    if (ib_device->func.post_sr_rdmar)
+    {
+        features_out |= BMI_IB_FEATURE_RDMA_READ;
+    }
+    features_out = htobmi32(features_out);
     debug(0, "%s: calling exchange data (final sync)", __func__);
-    ret = exchange_data(sock, is_server, &ret, &ret, sizeof(ret));
+    ret = exchange_data(sock, is_server, &features_in, &features_out,
+                        sizeof(features_in));
     debug(0, "%s: returning from exchange data (final sync), ret=%d", 
           __func__, ret);
+    if (ret == 0)
+    {
+        features_in = bmitoh32(features_in);
+        c->rdma_read = ib_device->func.post_sr_rdmar != NULL && 
+                       (features_in & BMI_IB_FEATURE_RDMA_READ);
+    }
 
   out:
     return ret;
@@ -438,7 +508,7 @@ static void init_connection_modify_qp(struct ibv_qp *qp,
            | IBV_QP_MIN_RNR_TIMER;
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_RTR;
-    attr.max_dest_rd_atomic = 1;
+    attr.max_dest_rd_atomic = od->max_dest_rd_atomic;
     attr.ah_attr.port_num = od->nic_port;
     if (od->active_mtu > IBV_MTU) 
     {
@@ -451,7 +521,9 @@ static void init_connection_modify_qp(struct ibv_qp *qp,
     debug(1, "%s: attr.path_mtu=%d", __func__, attr.path_mtu);
     attr.rq_psn = 0;
     attr.dest_qp_num = remote_qp_num;
-    attr.min_rnr_timer = 31;
+    /* the shared recv queue runs dry only for an instant under a burst
+     * from many senders, so have them retry soon (0.64 ms, not 491 ms) */
+    attr.min_rnr_timer = od->srq ? 12 : 31;
     
     if (od->transport_type == IB)
     {
@@ -482,7 +554,7 @@ static void init_connection_modify_qp(struct ibv_qp *qp,
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_RTS;
     attr.sq_psn = 0;
-    attr.max_rd_atomic = 1;
+    attr.max_rd_atomic = od->max_rd_atomic;
     attr.timeout = 14;      /* 4.096us * 2^14 = .0671 sec */
     attr.retry_cnt = 7;
     attr.rnr_retry = 7;
@@ -527,6 +599,9 @@ static void openib_close_connection(ib_connection_t *c)
     int ret;
     struct openib_connection_priv *oc = c->priv;
 
+    /* no longer a target for shared recv queue messages */
+    qhash_del(&oc->qp_link);
+
     /* destroy the queue pair */
     if (oc->qp) 
     {
@@ -588,6 +663,12 @@ static void openib_post_sr(const struct buf_head *bh,
     };
     struct ibv_send_wr *bad_wr;
 
+    /* the NIC copies small ones out of the descriptor, saving a DMA read */
+    if (len <= oc->max_inline_data)
+    {
+        sr.send_flags |= IBV_SEND_INLINE;
+    }
+
     debug(4, "%s: %s bh %d len %u wr %d/%d", 
           __func__, 
           c->peername, 
@@ -613,17 +694,17 @@ static void openib_post_sr(const struct buf_head *bh,
 }
 
 /*
- * Post one of the eager recv bufs for this connection.
+ * Post one of the eager recv bufs for this connection, or back to the
+ * shared recv queue if there is one.
  */
 static void openib_post_rr(const ib_connection_t *c, 
                            struct buf_head *bh)
 {
-    struct openib_connection_priv *oc = c->priv;
+    struct openib_device_priv *od = ib_device->priv;
     int ret;
     struct ibv_sge sg = {
         .addr = int64_from_ptr(bh->buf),
         .length = ib_device->eager_buf_size,
-        .lkey = oc->eager_recv_mr->lkey,
     };
     struct ibv_recv_wr rr = {
         .wr_id = int64_from_ptr(bh),
@@ -633,11 +714,27 @@ static void openib_post_rr(const ib_connection_t *c,
     };
     struct ibv_recv_wr *bad_wr;
 
-    debug(4, "%s: %s bh %d", __func__, c->peername, bh->num);
-    ret = ibv_post_recv(oc->qp, &rr, &bad_wr);
-    if (ret)
+    if (od->srq)
     {
-        error("%s: ibv_post_recv", __func__);
+        debug(4, "%s: srq bh %d", __func__, bh->num);
+        sg.lkey = od->srq_mr->lkey;
+        ret = ibv_post_srq_recv(od->srq, &rr, &bad_wr);
+        if (ret)
+        {
+            error("%s: ibv_post_srq_recv", __func__);
+        }
+    }
+    else
+    {
+        struct openib_connection_priv *oc = c->priv;
+
+        debug(4, "%s: %s bh %d", __func__, c->peername, bh->num);
+        sg.lkey = oc->eager_recv_mr->lkey;
+        ret = ibv_post_recv(oc->qp, &rr, &bad_wr);
+        if (ret)
+        {
+            error("%s: ibv_post_recv", __func__);
+        }
     }
 }
 
@@ -807,12 +904,165 @@ static void openib_post_sr_rdmaw(struct ib_work *sq,
 #endif
 }
 
+/*
+ * Called on the receiver of an RTS_READ once the matching receive is
+ * posted.  RDMA read the data straight out of the sender's buffers, whose
+ * addresses, lengths and keys follow the RTS_READ header.  This is the
+ * mirror of the rdmaw case: a read comes from one contiguous remote buffer
+ * but can scatter locally, so the reads are driven by the send elements,
+ * split when there are more local pieces than scatter entries.  Only the
+ * last read is signaled; its completion tells us all the data is here.
+ */
+static void openib_post_sr_rdmar(struct ib_work *rq, 
+                                 u_int32_t buflist_num,
+                                 void *buflist_buf)
+{
+    ib_connection_t *c = rq->c;
+    struct openib_connection_priv *oc = c->priv;
+    struct openib_device_priv *od = ib_device->priv;
+    struct ibv_send_wr sr;
+    int max_sge;
+    u_int32_t i;
+
+    u_int32_t send_index = 0;   /* working remote entry in buflist */
+    u_int32_t send_offset = 0;  /* byte offset in working remote entry */
+    int recv_index = 0;         /* working local entry */
+    u_int32_t recv_offset = 0;  /* byte offset in working local entry */
+    u_int64_t *send_bufp = (u_int64_t *) buflist_buf;
+    u_int32_t *send_lenp = (u_int32_t *) (send_bufp + buflist_num);
+    u_int32_t *send_rkey = (u_int32_t *) (send_lenp + buflist_num);
+    u_int64_t bytes_left = 0;
+
+    for (i = 0; i < buflist_num; i++)
+    {
+        bytes_left += bmitoh32(send_lenp[i]);
+    }
+    debug(2, "%s: rq %p totlen %llu", __func__, rq, llu(bytes_left));
+
+    max_sge = od->sg_max_len;
+    if (od->max_sge_rd < max_sge)
+    {
+        max_sge = od->max_sge_rd;
+    }
+
+    /* constant things for every read */
+    memset(&sr, 0, sizeof(sr));
+    sr.opcode = IBV_WR_RDMA_READ;
+    sr.sg_list = od->sg_tmp_array;
+    sr.next = NULL;
+
+    while (bytes_left > 0) 
+    {
+        int ret;
+        struct ibv_send_wr *bad_wr;
+        u_int32_t send_len = bmitoh32(send_lenp[send_index]);
+
+        if (send_offset == send_len)
+        {
+            /* finished this remote entry, or it was empty */
+            ++send_index;
+            send_offset = 0;
+            continue;
+        }
+
+        sr.wr.rdma.remote_addr = bmitoh64(send_bufp[send_index]) + 
+                                 send_offset;
+        sr.wr.rdma.rkey = bmitoh32(send_rkey[send_index]);
+        sr.num_sge = 0;
+
+        debug(0, "%s: chunk from %s remote addr %llx rkey %x",
+              __func__, 
+              c->peername, 
+              llu(sr.wr.rdma.remote_addr),
+              sr.wr.rdma.rkey);
+
+        /* scatter this remote entry over the local ones; sizes checked */
+        while (send_offset < send_len && sr.num_sge < max_sge) 
+        {
+            u_int32_t this_bytes = rq->buflist.len[recv_index] - recv_offset;
+
+            if (this_bytes == 0)
+            {
+                ++recv_index;
+                recv_offset = 0;
+                continue;
+            }
+            if (this_bytes > send_len - send_offset)
+            {
+                this_bytes = send_len - send_offset;
+            }
+
+            od->sg_tmp_array[sr.num_sge].addr = 
+                    int64_from_ptr(rq->buflist.buf.recv[recv_index]) + 
+                    recv_offset;
+            od->sg_tmp_array[sr.num_sge].length = this_bytes;
+            od->sg_tmp_array[sr.num_sge].lkey = 
+                    rq->buflist.memcache[recv_index]->memkeys.lkey;
+
+            debug(0, "%s: chunk %d local addr %llx len %d lkey %x",
+                  __func__, 
+                  sr.num_sge,
+                  (unsigned long long) od->sg_tmp_array[sr.num_sge].addr, 
+                  od->sg_tmp_array[sr.num_sge].length,
+                  od->sg_tmp_array[sr.num_sge].lkey);
+
+            ++sr.num_sge;
+            send_offset += this_bytes;
+            recv_offset += this_bytes;
+            bytes_left -= this_bytes;
+            if (recv_offset == rq->buflist.len[recv_index]) 
+            {
+                ++recv_index;
+                recv_offset = 0;
+            }
+        }
+
+        /* any read that fails completes, and must find its rq */
+        sr.wr_id = int64_from_ptr(rq) | IB_WR_ID_READ;
+        if (bytes_left == 0) 
+        {
+            sr.wr_id |= IB_WR_ID_READ_LAST;
+            sr.send_flags = IBV_SEND_SIGNALED; /* completion drives the unpin */
+        } 
+        else 
+        {
+            sr.send_flags = 0;
+        }
+
+        ret = ibv_post_send(oc->qp, &sr, &bad_wr);
+        if (ret)
+        {
+            error("%s: ibv_post_send (%d)", __func__, ret);
+            return;
+        }
+    }
+}
+
+/*
+ * Return the buf head if this id is one of the shared recv queue buffers.
+ */
+static struct buf_head *srq_buf_head(const struct openib_device_priv *od, 
+                                     uint64_t id)
+{
+    struct buf_head *bh = ptr_from_int64(id);
+
+    if (od->srq && 
+        bh >= od->srq_buf_head_contig && 
+        bh < od->srq_buf_head_contig + od->srq_buf_num)
+    {
+        return bh;
+    }
+    return NULL;
+}
+
 static int openib_check_cq(struct bmi_ib_wc *wc)
 {
     struct openib_device_priv *od = ib_device->priv;
     struct ibv_wc desc;
+    struct buf_head *bh;
     int ret;
 
+  again:
     memset(&desc, 0, sizeof(struct ibv_wc));
 
     ret = ibv_poll_cq(od->nic_cq, 1, &desc);
@@ -827,6 +1077,26 @@ static int openib_check_cq(struct bmi_ib_wc *wc)
         return 0;
     }
 
+    /* a message in the shared recv queue: say which connection sent it */
+    bh = srq_buf_head(od, desc.wr_id);
+    if (bh)
+    {
+        struct qhash_head *link;
+
+        link = qhash_search(od->qp_table, &desc.qp_num);
+        bh->c = link ? qhash_entry(link, struct openib_connection_priv,
+                                   qp_link)->c : NULL;
+        if (desc.status != IBV_WC_SUCCESS || !bh->c)
+        {
+            /* flushed by a QP in error, or its connection is gone */
+            debug(1, "%s: srq bh %d status %s qp_num %u dropped",
+                  __func__, bh->num, 
+                  openib_wc_status_string(desc.status), desc.qp_num);
+            openib_post_rr(NULL, bh);
+            goto again;
+        }
+    }
+
     /* convert to generic form */
     wc->id = desc.wr_id;
     wc->status = desc.status;
@@ -846,29 +1116,8 @@ static int openib_check_cq(struct bmi_ib_wc *wc)
             break;
 
         case IBV_WC_RDMA_READ:
-            warning("%s: unhandled IBV_WC_RDMA_READ opcode, id %llx status %d \
-                    opcode %d",
-                    __func__, 
-                    llu(desc.wr_id),
-                    desc.status,
-                    desc.opcode);
-            warning("%s: vender_err %d byte_len %d imm_data %d qp_num %d",
-                    __func__,
-                    desc.vendor_err,
-                    desc.byte_len,
-                    desc.imm_data,
-                    desc.qp_num);
-            warning("%s: src_qp %d wc_flags %d pkey_index %d slid %d",
-                    __func__, 
-                    desc.src_qp, 
-                    desc.wc_flags, 
-                    desc.pkey_index, 
-                    desc.slid);
-            warning("%s: sl %d dlid_path_bits %d",
-                    __func__, 
-                    desc.sl, 
-                    desc.dlid_path_bits);
-            return 0;
+            wc->opcode = BMI_IB_OP_RDMA_READ;
+            break;
 
         case IBV_WC_COMP_SWAP:
             warning("%s: unhandled IBV_WC_COMP_SWAP opcode, id %llx status %d \
@@ -1453,6 +1702,157 @@ int parse_bmi_opts_get_ib_port(char *options)
     }
 }
 
+/*
+ * Parses an optional "name=N" integer out of the BMI options string.
+ *
+ * Returns the value given, or def if absent or malformed.
+ */
+static int parse_bmi_opts_get_int(char *options, 
+                                  const char *name, 
+                                  int def)
+{
+    char *cp;
+    char *end_ptr;
+    long val;
+
+    if (!options)
+    {
+        return def;
+    }
+    cp = strstr(options, name);
+    if (!cp)
+    {
+        return def;
+    }
+
+    cp += strlen(name);
+    for (; isspace(*cp); cp++);     /* skip whitespace */
+    if (*cp == '=')
+    {
+        for (++cp; isspace(*cp); cp++); /* skip '=' and whitespace */
+        val = strtol(cp, &end_ptr, 10);
+        if (end_ptr != cp && (*end_ptr == '\0' || end_ptr[0] == ','))
+        {
+            return (int) val;
+        }
+    }
+    warning("%s: malformed %s option; using default: %d", 
+            __func__, name, def);
+    return def;
+}
+
+static int qp_table_compare(const void *key, 
+                            struct qhash_head *link)
+{
+    const struct openib_connection_priv *oc;
+
+    oc = qhash_entry(link, struct openib_connection_priv, qp_link);
+    return oc->qp->qp_num == *(const uint32_t *) key;
+}
+
+/*
+ * Release whatever part of the shared recv queue got built.  Connections
+ * go back to their own recv buffers.
+ */
+static void openib_destroy_srq(struct openib_device_priv *od)
+{
+    int ret;
+
+    if (od->srq)
+    {
+        ret = ibv_destroy_srq(od->srq);
+        if (ret)
+        {
+            error_xerrno(ret, "%s: ibv_destroy_srq", __func__);
+        }
+        od->srq = NULL;
+    }
+    if (od->srq_mr)
+    {
+        ret = ibv_dereg_mr(od->srq_mr);
+        if (ret)
+        {
+            error_xerrno(ret, "%s: ibv_dereg_mr srq", __func__);
+        }
+        od->srq_mr = NULL;
+    }
+    if (od->qp_table)
+    {
+        qhash_finalize(od->qp_table);
+        od->qp_table = NULL;
+    }
+    free(od->srq_buf_contig);
+    od->srq_buf_contig = NULL;
+    free(od->srq_buf_head_contig);
+    od->srq_buf_head_contig = NULL;
+    ib_device->srq = 0;
+}
+
+/*
+ * One recv queue, with srq_buf_num eager buffers, shared by the QPs of all
+ * connections, so that memory for receives does not grow with the number
+ * of peers.  Returns 0, or -errno if the NIC will not do it.
+ */
+static int openib_create_srq(struct openib_device_priv *od)
+{
+    struct ibv_srq_init_attr attr;
+    unsigned long len;
+    int i;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.attr.max_wr = od->srq_buf_num;
+    attr.attr.max_sge = 1;
+    od->srq = ibv_create_srq(od->nic_pd, &attr);
+    if (!od->srq)
+    {
+        warning_errno("%s: ibv_create_srq", __func__);
+        return -ENOSYS;
+    }
+
+    od->qp_table = qhash_init(qp_table_compare, quickhash_32bit_hash,
+                              QP_TABLE_SIZE);
+    if (!od->qp_table)
+    {
+        return -ENOMEM;
+    }
+
+    len = od->srq_buf_num * ib_device->eager_buf_size;
+    od->srq_buf_contig = bmi_ib_malloc(len);
+    od->srq_buf_head_contig = bmi_ib_malloc(od->srq_buf_num * 
+                                            sizeof(*od->srq_buf_head_contig));
+    if (!od->srq_buf_contig || !od->srq_buf_head_contig)
+    {
+        return -ENOMEM;
+    }
+    od->srq_mr = ibv_reg_mr(od->nic_pd, 
+                            od->srq_buf_contig, 
+                            len,
+                            IBV_ACCESS_LOCAL_WRITE);
+    if (!od->srq_mr)
+    {
+        warning("%s: register_mr srq", __func__);
+        return -ENOMEM;
+    }
+
+    /* mark it in use before posting, post_rr checks it */
+    ib_device->srq = 1;
+    for (i = 0; i < od->srq_buf_num; i++)
+    {
+        struct buf_head *bh = &od->srq_buf_head_contig[i];
+
+        INIT_QLIST_HEAD(&bh->list);
+        bh->num = i;
+        bh->c = NULL;
+        bh->sq = NULL;
+        bh->buf = (char *) od->srq_buf_contig + 
+                  i * ib_device->eager_buf_size;
+        openib_post_rr(NULL, bh);
+    }
+
+    debug(0, "%s: %d shared recv buffers", __func__, od->srq_buf_num);
+    return 0;
+}
+
 /*
  * Startup, once per application.
  */
@@ -1470,6 +1870,7 @@ int openib_ib_initialize(char *options)
     int ib_port;
 
     od = bmi_ib_malloc(sizeof(*od));
+    memset(od, 0, sizeof(*od));
     ib_device->priv = od;
 
 #ifdef HAVE_IBV_GET_DEVICES
@@ -1566,6 +1967,7 @@ int openib_ib_initialize(char *options)
     ib_device->func.post_sr = openib_post_sr;
     ib_device->func.post_rr = openib_post_rr;
     ib_device->func.post_sr_rdmaw = openib_post_sr_rdmaw;
+    ib_device->func.post_sr_rdmar = openib_post_sr_rdmar;
     ib_device->func.check_cq = openib_check_cq;
     ib_device->func.prepare_cq_block = openib_prepare_cq_block;
     ib_device->func.ack_cq_completion_event = openib_ack_cq_completion_event;
@@ -1581,6 +1983,31 @@ int openib_ib_initialize(char *options)
     od->nic_max_sge = hca_cap.max_sge;
     od->nic_max_wr = hca_cap.max_qp_wr;
 
+    /* several RDMA reads in flight per QP, both ways, if the NIC allows */
+    od->max_rd_atomic = hca_cap.max_qp_init_rd_atom;
+    if (od->max_rd_atomic > IBV_MAX_RD_ATOMIC)
+    {
+        od->max_rd_atomic = IBV_MAX_RD_ATOMIC;
+    }
+    od->max_dest_rd_atomic = hca_cap.max_qp_rd_atom;
+    if (od->max_dest_rd_atomic > IBV_MAX_RD_ATOMIC)
+    {
+        od->max_dest_rd_atomic = IBV_MAX_RD_ATOMIC;
+    }
+    if (od->max_dest_rd_atomic < 1)
+    {
+        od->max_dest_rd_atomic = 1;
+    }
+    od->max_sge_rd = hca_cap.max_sge_rd ? hca_cap.max_sge_rd : hca_cap.max_sge;
+
+    /* large messages are pulled by the receiver unless told otherwise */
+    if (od->max_rd_atomic < 1 || 
+        !parse_bmi_opts_get_int(options, "rdma_read", 1))
+    {
+        od->max_rd_atomic = 1;
+        ib_device->func.post_sr_rdmar = NULL;
+    }
+
     if (hca_cap.max_cq < cqe_num) 
     {
         cqe_num = hca_cap.max_cq;
@@ -1643,6 +2070,24 @@ int openib_ib_initialize(char *options)
     od->num_unsignaled_sends = 0;
     od->max_unsignaled_sends = 0;
 
+    /* shared recv queue for the eager messages of all connections */
+    od->srq_buf_num = parse_bmi_opts_get_int(options, "srq_bufs",
+                                             DEFAULT_SRQ_BUF_NUM);
+    if (od->srq_buf_num > hca_cap.max_srq_wr)
+    {
+        od->srq_buf_num = hca_cap.max_srq_wr;
+    }
+    if (hca_cap.max_srq > 0 && od->srq_buf_num > 0)
+    {
+        ret = openib_create_srq(od);
+        if (ret)
+        {
+            warning("%s: no shared recv queue, using per-connection buffers",
+                    __func__);
+            openib_destroy_srq(od);
+        }
+    }
+
     return 0;
 }
 
@@ -1658,6 +2103,7 @@ static void openib_ib_finalize(void)
     {
         free(od->sg_tmp_array);
     }
+    openib_destroy_srq(od);
     ret = ibv_destroy_cq(od->nic_cq);
     if (ret)
     {
@@ -938,6 +938,7 @@ int vapi_ib_initialize(char *options)
     ib_device->func.post_sr = vapi_post_sr;
     ib_device->func.post_rr = vapi_post_rr;
     ib_device->func.post_sr_rdmaw = vapi_post_sr_rdmaw;
+    ib_device->func.post_sr_rdmar = NULL;  /* RTS/CTS only */
     ib_device->func.check_cq = vapi_check_cq;
     ib_device->func.prepare_cq_block = vapi_prepare_cq_block;
     ib_device->func.ack_cq_completion_event = vapi_ack_cq_completion_event;
@@ -0,0 +1,3461 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Shared memory implementation of a BMI method, for clients and servers
+ * that run on the same host.  See the README in this directory for the
+ * protocol.
+ */
+
+#include "pvfs2-internal.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bmi-method-support.h"
+#include "bmi-method-callback.h"
+#include "op-list.h"
+#include "gossip.h"
+#include "id-generator.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "pint-slab.h"
+
+/* size of each of the two rings in a connection; a power of two */
+#define SM_RING_SIZE (256 * 1024)
+
+/* largest unexpected message, and largest expected message that is
+ * copied through the ring in one piece
+ */
+#define SM_EAGER_LIMIT 16384
+
+/* largest message overall, as for tcp */
+#define SM_MAX_SIZE 16777216
+
+/* larger messages that cannot use cross memory attach are streamed
+ * through the ring in pieces of this size; also bounds the buffer lists
+ * carried by RTS and CTS records
+ */
+#define SM_FRAG_SIZE (SM_RING_SIZE / 4)
+
+/* larger messages are moved with cross memory attach when possible;
+ * below this, copying through the ring is as fast
+ */
+#define SM_RNDV_LIMIT (128 * 1024)
+
+/* how long a client waits for a server to answer its hello */
+#define SM_CONNECT_TIMEOUT_MS 5000
+
+/* the shared segment starts with a page of control fields */
+#define SM_SHARED_HDR_SIZE 4096
+#define SM_CACHELINE 64
+
+#define SM_MAGIC 0x626d6973     /* "bmis" */
+#define SM_VERSION 1
+#define SM_PROBE_MAGIC 0x70726f6265626d69ULL
+
+#define SM_SOCKET_PREFIX "pvfs2-bmi-sm-"
+
+#define SM_WORK_METRIC 16
+
+#define sm_mb() __sync_synchronize()
+#define SM_ALIGN8(x) (((x) + 7) & ~((uint64_t)7))
+
+/* the two ends of a connection */
+enum
+{
+    SM_SIDE_CLIENT = 0,
+    SM_SIDE_SERVER = 1
+};
+
+/* control fields of one ring, written by the side named in the index
+ * of sm_shared.ring (producer) except for tail (consumer)
+ */
+struct sm_ring_ctl
+{
+    volatile uint64_t head;     /* bytes ever written */
+    char pad0[SM_CACHELINE - sizeof(uint64_t)];
+    volatile uint64_t tail;     /* bytes ever consumed */
+    /* the producer found the ring full and wants a wakeup */
+    volatile uint32_t producer_waiting;
+    char pad1[SM_CACHELINE - sizeof(uint64_t) - sizeof(uint32_t)];
+};
+
+/* start of the shared segment; the ring written by side i follows the
+ * header at SM_SHARED_HDR_SIZE + i * ring_size
+ */
+struct sm_shared
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_size;
+    uint32_t pad;
+    /* side i may use process_vm_readv/writev on the other side */
+    volatile uint32_t cma[2];
+    char pad1[SM_CACHELINE - 6 * sizeof(uint32_t)];
+    struct sm_ring_ctl ring[2];
+};
+
+/* record types in a ring */
+enum
+{
+    SM_MSG_WRAP = 1,    /* skip to the start of the ring */
+    SM_MSG_EAGER = 2,   /* a message, or the first piece of a streamed one */
+    SM_MSG_FRAG = 3,    /* next piece of a streamed message */
+    SM_MSG_RTS = 4,     /* sender's buffer list, to be read by the receiver */
+    SM_MSG_CTS = 5,     /* receiver's buffer list, to be written by sender */
+    SM_MSG_DONE = 6     /* cross memory transfer finished */
+};
+
+#define SM_FLAG_UNEXPECTED 1
+
+/* header of every record; the payload follows, padded to 8 bytes */
+struct sm_msg
+{
+    uint32_t type;
+    uint32_t len;       /* payload bytes */
+    int32_t tag;
+    int32_t status;     /* DONE: 0 or BMI error code */
+    uint32_t flags;
+    uint32_t pad;
+    uint64_t size;      /* total size of the message */
+    uint64_t id;        /* op id of the sender of the RTS */
+    uint64_t peer_id;   /* op id of its receiver (CTS, DONE after a CTS) */
+};
+
+/* buffer list entry in RTS and CTS records */
+struct sm_iov
+{
+    uint64_t base;
+    uint64_t len;
+};
+
+/* exchanged over the socket when connecting */
+struct sm_hello
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ip;        /* local IPv4 address the client looked up, or 0 */
+    uint32_t pad;
+    uint64_t probe;     /* address of sm_probe_word in the client */
+};
+
+struct sm_hello_reply
+{
+    uint32_t magic;
+    int32_t status;     /* 0 or BMI error code; segment fd attached if 0 */
+    uint32_t ring_size;
+    uint32_t pad;
+    uint64_t probe;     /* address of sm_probe_word in the server */
+};
+
+/* connection states */
+enum
+{
+    SM_CONN_DOWN = 0,   /* not connected; a client end may connect again */
+    SM_CONN_HELLO = 1,  /* accepted, waiting for the client's hello */
+    SM_CONN_UP = 2
+};
+
+/* method specific address data; one connection per address */
+struct sm_addr
+{
+    bmi_method_addr_p map;
+    BMI_addr_t bmi_addr;        /* server end, from the BMI layer */
+    int state;
+    int side;
+    int fd;                     /* socket for setup and wakeups */
+    int port;                   /* server port, client end only */
+    char *host;                 /* host named in the address, client end */
+    int alias;                  /* looked up as a tcp address */
+    uint32_t ip;                /* IPv4 address the client stands for */
+    pid_t peer_pid;
+    char peer_string[64];       /* for rev_lookup_unexpected */
+    int error;                  /* why the connection went down */
+    int dont_reconnect;         /* server end; the client has to come back */
+    int registered;             /* fd is in the epoll set */
+    struct qlist_head link;     /* in sm_conns while up */
+
+    struct sm_shared *shm;
+    size_t shm_size;
+    uint32_t ring_size;
+    char *tx_ring;
+    char *rx_ring;
+    struct sm_ring_ctl *tx;
+    struct sm_ring_ctl *rx;
+    uint64_t tx_head;           /* local copy, ahead of tx->head */
+    uint64_t tx_published;
+    uint64_t rx_tail;           /* local copy, ahead of rx->tail */
+    int cma;                    /* we may read/write the peer's memory */
+
+    struct qlist_head send_queue;   /* sends in order, waiting for ring space */
+    struct qlist_head ctl_queue;    /* CTS and DONE records waiting for space */
+    struct qlist_head rndv_ops;     /* sends and receives waiting on CTS/DONE */
+    method_op_p rx_cur;             /* receive taking a streamed message */
+    int rx_blocked;                 /* next message waits for a receive */
+};
+
+/* operation states */
+enum
+{
+    SM_OP_SEND_QUEUED = 1,
+    SM_OP_SEND_RNDV,
+    SM_OP_RECV_POSTED,
+    SM_OP_RECV_STREAM,
+    SM_OP_RECV_RNDV,
+    SM_OP_EARLY,            /* arrived before its receive was posted */
+    SM_OP_COMPLETE
+};
+
+/* method specific op data */
+struct sm_op
+{
+    int state;
+    int unexpected;
+    uint64_t peer_id;           /* early RTS: id of the sender's op */
+    struct sm_iov *iovs;        /* early RTS: the sender's buffer list */
+    int iov_count;
+};
+
+/* a CTS or DONE record waiting for ring space */
+struct sm_ctl
+{
+    struct qlist_head link;
+    struct sm_msg msg;
+    struct sm_iov *iovs;        /* CTS payload */
+};
+
+/* function prototypes */
+int BMI_sm_initialize(bmi_method_addr_p listen_addr,
+                      int method_id,
+                      int init_flags,
+                      char *options);
+int BMI_sm_finalize(void);
+int BMI_sm_set_info(int option,
+                    void *inout_parameter);
+int BMI_sm_get_info(int option,
+                    void *inout_parameter);
+void *BMI_sm_memalloc(bmi_size_t size,
+                      enum bmi_op_type send_recv);
+int BMI_sm_memfree(void *buffer,
+                   bmi_size_t size,
+                   enum bmi_op_type send_recv);
+int BMI_sm_unexpected_free(void *buffer);
+int BMI_sm_post_send(bmi_op_id_t *id,
+                     bmi_method_addr_p dest,
+                     const void *buffer,
+                     bmi_size_t size,
+                     enum bmi_buffer_type buffer_type,
+                     bmi_msg_tag_t tag,
+                     void *user_ptr,
+                     bmi_context_id context_id,
+                     PVFS_hint hints);
+int BMI_sm_post_sendunexpected(bmi_op_id_t *id,
+                               bmi_method_addr_p dest,
+                               const void *buffer,
+                               bmi_size_t size,
+                               enum bmi_buffer_type buffer_type,
+                               bmi_msg_tag_t tag,
+                               void *user_ptr,
+                               bmi_context_id context_id,
+                               PVFS_hint hints);
+int BMI_sm_post_recv(bmi_op_id_t *id,
+                     bmi_method_addr_p src,
+                     void *buffer,
+                     bmi_size_t expected_size,
+                     bmi_size_t *actual_size,
+                     enum bmi_buffer_type buffer_type,
+                     bmi_msg_tag_t tag,
+                     void *user_ptr,
+                     bmi_context_id context_id,
+                     PVFS_hint hints);
+int BMI_sm_test(bmi_op_id_t id,
+                int *outcount,
+                bmi_error_code_t *error_code,
+                bmi_size_t *actual_size,
+                void **user_ptr,
+                int max_idle_time_ms,
+                bmi_context_id context_id);
+int BMI_sm_testsome(int incount,
+                    bmi_op_id_t *id_array,
+                    int *outcount,
+                    int *index_array,
+                    bmi_error_code_t *error_code_array,
+                    bmi_size_t *actual_size_array,
+                    void **user_ptr_array,
+                    int max_idle_time_ms,
+                    bmi_context_id context_id);
+int BMI_sm_testunexpected(int incount,
+                          int *outcount,
+                          struct bmi_method_unexpected_info *info,
+                          int max_idle_time_ms);
+int BMI_sm_testcontext(int incount,
+                       bmi_op_id_t *out_id_array,
+                       int *outcount,
+                       bmi_error_code_t *error_code_array,
+                       bmi_size_t *actual_size_array,
+                       void **user_ptr_array,
+                       int max_idle_time_ms,
+                       bmi_context_id context_id);
+bmi_method_addr_p BMI_sm_method_addr_lookup(const char *id_string);
+const char *BMI_sm_addr_rev_lookup_unexpected(bmi_method_addr_p map);
+int BMI_sm_query_addr_range(bmi_method_addr_p map,
+                            const char *wildcard_string,
+                            int netmask);
+int BMI_sm_post_send_list(bmi_op_id_t *id,
+                          bmi_method_addr_p dest,
+                          const void *const *buffer_list,
+                          const bmi_size_t *size_list,
+                          int list_count,
+                          bmi_size_t total_size,
+                          enum bmi_buffer_type buffer_type,
+                          bmi_msg_tag_t tag,
+                          void *user_ptr,
+                          bmi_context_id context_id,
+                          PVFS_hint hints);
+int BMI_sm_post_recv_list(bmi_op_id_t *id,
+                          bmi_method_addr_p src,
+                          void *const *buffer_list,
+                          const bmi_size_t *size_list,
+                          int list_count,
+                          bmi_size_t total_expected_size,
+                          bmi_size_t *total_actual_size,
+                          enum bmi_buffer_type buffer_type,
+                          bmi_msg_tag_t tag,
+                          void *user_ptr,
+                          bmi_context_id context_id,
+                          PVFS_hint hints);
+int BMI_sm_post_sendunexpected_list(bmi_op_id_t *id,
+                                    bmi_method_addr_p dest,
+                                    const void *const *buffer_list,
+                                    const bmi_size_t *size_list,
+                                    int list_count,
+                                    bmi_size_t total_size,
+                                    enum bmi_buffer_type buffer_type,
+                                    bmi_msg_tag_t tag,
+                                    void *user_ptr,
+                                    bmi_context_id context_id,
+                                    PVFS_hint hints);
+int BMI_sm_open_context(bmi_context_id context_id);
+void BMI_sm_close_context(bmi_context_id context_id);
+int BMI_sm_cancel(bmi_op_id_t id,
+                  bmi_context_id context_id);
+
+char BMI_sm_method_name[] = "bmi_sm";
+
+const struct bmi_method_ops bmi_sm_ops = {
+    .method_name = BMI_sm_method_name,
+    .initialize = BMI_sm_initialize,
+    .finalize = BMI_sm_finalize,
+    .set_info = BMI_sm_set_info,
+    .get_info = BMI_sm_get_info,
+    .memalloc = BMI_sm_memalloc,
+    .memfree  = BMI_sm_memfree,
+    .unexpected_free = BMI_sm_unexpected_free,
+    .post_send = BMI_sm_post_send,
+    .post_sendunexpected = BMI_sm_post_sendunexpected,
+    .post_recv = BMI_sm_post_recv,
+    .test = BMI_sm_test,
+    .testsome = BMI_sm_testsome,
+    .testcontext = BMI_sm_testcontext,
+    .testunexpected = BMI_sm_testunexpected,
+    .method_addr_lookup = BMI_sm_method_addr_lookup,
+    .post_send_list = BMI_sm_post_send_list,
+    .post_recv_list = BMI_sm_post_recv_list,
+    .post_sendunexpected_list = BMI_sm_post_sendunexpected_list,
+    .open_context = BMI_sm_open_context,
+    .close_context = BMI_sm_close_context,
+    .cancel = BMI_sm_cancel,
+    .rev_lookup_unexpected = BMI_sm_addr_rev_lookup_unexpected,
+    .query_addr_range = BMI_sm_query_addr_range,
+};
+
+/* module parameters */
+static struct
+{
+    int method_flags;
+    int method_id;
+    int initialized;
+    bmi_method_addr_p listen_addr;
+    int listen_fd;
+    int listen_port;
+    int epfd;
+    int wake_fd;
+} sm_params = { 0, 0, 0, NULL, -1, 0, -1, -1 };
+
+static gen_mutex_t interface_mutex = GEN_MUTEX_INITIALIZER;
+static gen_cond_t interface_cond = GEN_COND_INITIALIZER;
+/* a thread is waiting in epoll_wait() */
+static int sm_test_busy = 0;
+/* completions were queued outside of a test call */
+static int sm_need_wake = 0;
+
+/* posted receives that have not matched a message yet */
+static QLIST_HEAD(sm_recv_posted);
+/* messages and RTS records that arrived before their receive */
+static QLIST_HEAD(sm_recv_early);
+/* unexpected messages waiting for testunexpected */
+static QLIST_HEAD(sm_unexp_done);
+/* connections that are up */
+static QLIST_HEAD(sm_conns);
+static op_list_p completion_array[BMI_MAX_CONTEXTS] = { NULL };
+
+/* read by the peer to find out whether it may use cross memory attach */
+static const volatile uint64_t sm_probe_word = SM_PROBE_MAGIC;
+
+static PINT_slab sm_op_slab =
+    PINT_BMI_OP_SLAB_INITIALIZER("bmi sm op", struct sm_op);
+
+static bmi_method_addr_p alloc_sm_method_addr(void);
+static void dealloc_sm_method_addr(bmi_method_addr_p map);
+static method_op_p alloc_sm_method_op(void);
+static void dealloc_sm_method_op(method_op_p op);
+static int sm_post_send_generic(bmi_op_id_t *id,
+                                bmi_method_addr_p dest,
+                                const void *const *buffer_list,
+                                const bmi_size_t *size_list,
+                                int list_count,
+                                bmi_size_t total_size,
+                                bmi_msg_tag_t tag,
+                                void *user_ptr,
+                                bmi_context_id context_id,
+                                int unexpected);
+static int sm_post_recv_generic(bmi_op_id_t *id,
+                                bmi_method_addr_p src,
+                                void *const *buffer_list,
+                                const bmi_size_t *size_list,
+                                int list_count,
+                                bmi_size_t expected_size,
+                                bmi_size_t *actual_size,
+                                bmi_msg_tag_t tag,
+                                void *user_ptr,
+                                bmi_context_id context_id);
+static int sm_connect(struct sm_addr *conn);
+static int sm_conn_ready(struct sm_addr *conn);
+static void sm_conn_fail(struct sm_addr *conn, int error_code);
+static int sm_conn_rx(struct sm_addr *conn);
+static int sm_conn_tx(struct sm_addr *conn);
+static void sm_ring_publish(struct sm_addr *conn);
+static void sm_ring_release(struct sm_addr *conn);
+static int sm_do_work(int max_idle_time);
+static void sm_accept(void);
+static void sm_hello(struct sm_addr *conn);
+static void sm_wake(void);
+static void sm_op_complete(method_op_p op, int error_code);
+static int sm_rndv_start(struct sm_addr *conn, method_op_p recv,
+                         uint64_t peer_id, bmi_size_t size,
+                         const struct sm_iov *iovs, int iov_count);
+static int sm_send_ctl(struct sm_addr *conn, const struct sm_msg *msg,
+                       const struct sm_iov *iovs);
+
+/* BMI_sm_initialize()
+ *
+ * Initializes the shared memory method; a server listens on a socket
+ * named after the port of its address.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_initialize(bmi_method_addr_p listen_addr,
+                      int method_id,
+                      int init_flags,
+                      char *options)
+{
+    struct epoll_event event;
+    struct sockaddr_un sun;
+    socklen_t len;
+    int ret = 0;
+
+    gossip_debug(GOSSIP_BMI_DEBUG_SM, "Initializing shared memory module.\n");
+
+    if ((init_flags & BMI_INIT_SERVER) && !listen_addr)
+    {
+        gossip_lerr("Error: bad parameters given to shared memory module.\n");
+        return bmi_errno_to_pvfs(-EINVAL);
+    }
+
+    gen_mutex_lock(&interface_mutex);
+
+    sm_params.method_id = method_id;
+    sm_params.method_flags = init_flags;
+    sm_params.listen_fd = -1;
+    sm_params.wake_fd = -1;
+
+    sm_params.epfd = epoll_create(16);
+    if (sm_params.epfd < 0)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto initialize_failure;
+    }
+    fcntl(sm_params.epfd, F_SETFD, FD_CLOEXEC);
+
+    /* registered with its own address as data so that it can be told
+     * apart from the connections
+     */
+    sm_params.wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (sm_params.wake_fd < 0)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto initialize_failure;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = &sm_params.wake_fd;
+    if (epoll_ctl(sm_params.epfd, EPOLL_CTL_ADD, sm_params.wake_fd,
+                  &event) < 0)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto initialize_failure;
+    }
+
+    if (init_flags & BMI_INIT_SERVER)
+    {
+        struct sm_addr *sm_addr_data = listen_addr->method_data;
+
+        sm_params.listen_addr = listen_addr;
+        sm_params.listen_port = sm_addr_data->port;
+
+        sm_params.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sm_params.listen_fd < 0)
+        {
+            ret = bmi_errno_to_pvfs(-errno);
+            goto initialize_failure;
+        }
+        fcntl(sm_params.listen_fd, F_SETFD, FD_CLOEXEC);
+        fcntl(sm_params.listen_fd, F_SETFL, O_NONBLOCK);
+
+        /* abstract socket names go away with the process */
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        len = offsetof(struct sockaddr_un, sun_path) + 1 +
+            snprintf(sun.sun_path + 1, sizeof(sun.sun_path) - 1,
+                     SM_SOCKET_PREFIX "%d", sm_params.listen_port);
+        if (bind(sm_params.listen_fd, (struct sockaddr *)&sun, len) < 0 ||
+            listen(sm_params.listen_fd, 128) < 0)
+        {
+            ret = bmi_errno_to_pvfs(-errno);
+            gossip_err("Error: bmi_sm could not listen for port %d: %s\n",
+                       sm_params.listen_port, strerror(errno));
+            goto initialize_failure;
+        }
+
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = &sm_params.listen_fd;
+        if (epoll_ctl(sm_params.epfd, EPOLL_CTL_ADD, sm_params.listen_fd,
+                      &event) < 0)
+        {
+            ret = bmi_errno_to_pvfs(-errno);
+            goto initialize_failure;
+        }
+    }
+
+    sm_params.initialized = 1;
+    gen_mutex_unlock(&interface_mutex);
+    gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                 "Shared memory module successfully initialized.\n");
+    return 0;
+
+  initialize_failure:
+    if (sm_params.listen_fd > -1)
+    {
+        close(sm_params.listen_fd);
+        sm_params.listen_fd = -1;
+    }
+    if (sm_params.wake_fd > -1)
+    {
+        close(sm_params.wake_fd);
+        sm_params.wake_fd = -1;
+    }
+    if (sm_params.epfd > -1)
+    {
+        close(sm_params.epfd);
+        sm_params.epfd = -1;
+    }
+    sm_params.listen_addr = NULL;
+    sm_params.listen_port = 0;
+    gen_mutex_unlock(&interface_mutex);
+    return ret;
+}
+
+/* BMI_sm_finalize()
+ *
+ * Shuts down the shared memory method.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_finalize(void)
+{
+    method_op_p op;
+    int i;
+
+    gen_mutex_lock(&interface_mutex);
+
+    if (sm_params.listen_addr)
+    {
+        dealloc_sm_method_addr(sm_params.listen_addr);
+        sm_params.listen_addr = NULL;
+    }
+    if (sm_params.listen_fd > -1)
+    {
+        close(sm_params.listen_fd);
+        sm_params.listen_fd = -1;
+    }
+    sm_params.listen_port = 0;
+
+    /* forcefully drop operations that are not tied to a connection;
+     * we are trusting the calling BMI layer to deallocate the
+     * addresses, which takes care of the rest
+     */
+    while ((op = op_list_shownext(&sm_unexp_done)))
+    {
+        op_list_remove(op);
+        free(op->buffer);
+        dealloc_sm_method_op(op);
+    }
+    for (i = 0; i < BMI_MAX_CONTEXTS; i++)
+    {
+        if (completion_array[i])
+        {
+            op_list_cleanup_fn(completion_array[i], dealloc_sm_method_op);
+            completion_array[i] = NULL;
+        }
+    }
+
+    if (sm_params.wake_fd > -1)
+    {
+        close(sm_params.wake_fd);
+        sm_params.wake_fd = -1;
+    }
+    if (sm_params.epfd > -1)
+    {
+        close(sm_params.epfd);
+        sm_params.epfd = -1;
+    }
+    sm_params.initialized = 0;
+
+    gossip_debug(GOSSIP_BMI_DEBUG_SM, "Shared memory module finalized.\n");
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* sm_parse_host_port()
+ *
+ * splits "host:port" or "port"; *host is set to a malloced string, or
+ * NULL if there was no host part
+ *
+ * returns 0 on success, -1 on malformed address
+ */
+static int sm_parse_host_port(const char *str, char **host, int *port)
+{
+    const char *delim = strrchr(str, ':');
+    const char *port_str = delim ? delim + 1 : str;
+    char *end;
+    long val;
+
+    val = strtol(port_str, &end, 10);
+    if (end == port_str || (*end && *end != '/') || val <= 0 || val > 65535)
+    {
+        return -1;
+    }
+    *port = (int)val;
+    *host = NULL;
+    if (delim && delim > str)
+    {
+        *host = strndup(str, delim - str);
+        if (!*host)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* sm_local_ip()
+ *
+ * finds out whether host names an address of this host; an IPv4 address
+ * is local if a socket can be bound to it
+ *
+ * returns 1 and sets *ip (network order) if so, 0 if not
+ */
+static int sm_local_ip(const char *host, uint32_t *ip)
+{
+    struct addrinfo hints, *res = NULL, *ai;
+    int found = 0;
+    int s;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0)
+    {
+        return 0;
+    }
+    for (ai = res; ai && !found; ai = ai->ai_next)
+    {
+        struct sockaddr_in sin;
+
+        memcpy(&sin, ai->ai_addr, sizeof(sin));
+        sin.sin_port = 0;
+        s = socket(AF_INET, SOCK_DGRAM, 0);
+        if (s < 0)
+        {
+            break;
+        }
+        if (bind(s, (struct sockaddr *)&sin, sizeof(sin)) == 0)
+        {
+            *ip = sin.sin_addr.s_addr;
+            found = 1;
+        }
+        close(s);
+    }
+    freeaddrinfo(res);
+    return found;
+}
+
+/*
+ * BMI_sm_method_addr_lookup()
+ *
+ * resolves the string representation of an address into a method
+ * address structure.  "sm://host:port" names the shared memory method of
+ * the server listening with that port and is connected on first use.
+ * "tcp://host:port" is taken only if host is this host and a server is
+ * listening for that port; the connection is made right away so that
+ * BMI can fall back to tcp if anything fails.
+ *
+ * returns a pointer to method_addr on success, NULL on failure
+ */
+bmi_method_addr_p BMI_sm_method_addr_lookup(const char *id_string)
+{
+    bmi_method_addr_p new_addr;
+    struct sm_addr *sm_addr_data;
+    char *str;
+    char *host = NULL;
+    int port, alias = 0;
+    uint32_t ip = 0;
+
+    str = string_key("sm", id_string);
+    if (!str)
+    {
+        str = string_key("tcp", id_string);
+        if (!str)
+        {
+            return NULL;
+        }
+        alias = 1;
+    }
+
+    if (sm_parse_host_port(str, &host, &port) < 0)
+    {
+        if (!alias)
+        {
+            gossip_err("Error: malformed sm address: %s\n", id_string);
+        }
+        free(str);
+        return NULL;
+    }
+    free(str);
+
+    if (alias)
+    {
+        /* a server does not talk to itself through shared memory, and
+         * only servers on this host are candidates
+         */
+        if (!host || port == sm_params.listen_port ||
+            !sm_local_ip(host, &ip))
+        {
+            free(host);
+            return NULL;
+        }
+    }
+
+    new_addr = alloc_sm_method_addr();
+    if (!new_addr)
+    {
+        free(host);
+        return NULL;
+    }
+    sm_addr_data = new_addr->method_data;
+    sm_addr_data->side = SM_SIDE_CLIENT;
+    sm_addr_data->port = port;
+    sm_addr_data->host = host;
+    sm_addr_data->alias = alias;
+    sm_addr_data->ip = ip;
+    snprintf(sm_addr_data->peer_string, sizeof(sm_addr_data->peer_string),
+             "sm://%s:%d", host ? host : "localhost", port);
+
+    if (alias)
+    {
+        int ret;
+
+        gen_mutex_lock(&interface_mutex);
+        ret = sm_connect(sm_addr_data);
+        gen_mutex_unlock(&interface_mutex);
+        if (ret < 0)
+        {
+            gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                         "bmi_sm: no shared memory path to %s\n",
+                         id_string);
+            dealloc_sm_method_addr(new_addr);
+            return NULL;
+        }
+        gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                     "bmi_sm: reaching %s through shared memory\n",
+                     id_string);
+    }
+
+    return new_addr;
+}
+
+/* BMI_sm_memalloc()
+ *
+ * no special memory is needed
+ */
+void *BMI_sm_memalloc(bmi_size_t size,
+                      enum bmi_op_type send_recv)
+{
+    return malloc(size);
+}
+
+int BMI_sm_memfree(void *buffer,
+                   bmi_size_t size,
+                   enum bmi_op_type send_recv)
+{
+    free(buffer);
+    return 0;
+}
+
+int BMI_sm_unexpected_free(void *buffer)
+{
+    free(buffer);
+    return 0;
+}
+
+/* BMI_sm_set_info()
+ *
+ * Pass in optional parameters.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_set_info(int option,
+                    void *inout_parameter)
+{
+    int ret = 0;
+
+    gen_mutex_lock(&interface_mutex);
+
+    switch (option)
+    {
+    case BMI_DROP_ADDR:
+        if (inout_parameter == NULL)
+        {
+            ret = bmi_errno_to_pvfs(-EINVAL);
+        }
+        else
+        {
+            bmi_method_addr_p map = (bmi_method_addr_p)inout_parameter;
+            struct sm_addr *sm_addr_data = map->method_data;
+
+            if (sm_addr_data->state != SM_CONN_DOWN)
+            {
+                sm_conn_fail(sm_addr_data, -BMI_ENETRESET);
+            }
+            dealloc_sm_method_addr(map);
+        }
+        break;
+
+    case BMI_WAKE_TESTCONTEXT:
+        sm_wake();
+        break;
+
+    default:
+        gossip_ldebug(GOSSIP_BMI_DEBUG_SM,
+                      "SM hint %d not implemented.\n", option);
+        break;
+    }
+
+    if (sm_need_wake)
+    {
+        sm_wake();
+    }
+    gen_mutex_unlock(&interface_mutex);
+    return ret;
+}
+
+/* BMI_sm_get_info()
+ *
+ * Query for optional parameters.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_get_info(int option,
+                    void *inout_parameter)
+{
+    struct method_drop_addr_query *query;
+    struct sm_addr *sm_addr_data;
+    int ret = 0;
+
+    gen_mutex_lock(&interface_mutex);
+
+    switch (option)
+    {
+    case BMI_CHECK_MAXSIZE:
+        *((int *)inout_parameter) = SM_MAX_SIZE;
+        break;
+
+    case BMI_GET_UNEXP_SIZE:
+        *((int *)inout_parameter) = SM_EAGER_LIMIT;
+        break;
+
+    case BMI_DROP_ADDR_QUERY:
+        query = (struct method_drop_addr_query *)inout_parameter;
+        sm_addr_data = query->addr->method_data;
+        /* a client end can connect again */
+        query->response = (sm_addr_data->state == SM_CONN_DOWN &&
+                           sm_addr_data->dont_reconnect);
+        break;
+
+    case BMI_CHECK_WAKEUP:
+        *((int *)inout_parameter) = 1;
+        break;
+
+    case BMI_GET_WAIT_FD:
+        *((int *)inout_parameter) = sm_params.epfd;
+        break;
+
+    case BMI_CHECK_UNEXP_READY:
+        *((int *)inout_parameter) = !qlist_empty(&sm_unexp_done);
+        break;
+
+    default:
+        gossip_ldebug(GOSSIP_BMI_DEBUG_SM,
+                      "SM hint %d not implemented.\n", option);
+        ret = bmi_errno_to_pvfs(-ENOSYS);
+        break;
+    }
+
+    gen_mutex_unlock(&interface_mutex);
+    return ret;
+}
+
+/* BMI_sm_post_send()
+ *
+ * Submits send operations.
+ *
+ * returns 0 on success that requires later poll, returns 1 on instant
+ * completion, -errno on failure
+ */
+int BMI_sm_post_send(bmi_op_id_t *id,
+                     bmi_method_addr_p dest,
+                     const void *buffer,
+                     bmi_size_t size,
+                     enum bmi_buffer_type buffer_type,
+                     bmi_msg_tag_t tag,
+                     void *user_ptr,
+                     bmi_context_id context_id,
+                     PVFS_hint hints)
+{
+    return sm_post_send_generic(id, dest, &buffer, &size, 1, size, tag,
+                                user_ptr, context_id, 0);
+}
+
+int BMI_sm_post_sendunexpected(bmi_op_id_t *id,
+                               bmi_method_addr_p dest,
+                               const void *buffer,
+                               bmi_size_t size,
+                               enum bmi_buffer_type buffer_type,
+                               bmi_msg_tag_t tag,
+                               void *user_ptr,
+                               bmi_context_id context_id,
+                               PVFS_hint hints)
+{
+    return sm_post_send_generic(id, dest, &buffer, &size, 1, size, tag,
+                                user_ptr, context_id, 1);
+}
+
+int BMI_sm_post_send_list(bmi_op_id_t *id,
+                          bmi_method_addr_p dest,
+                          const void *const *buffer_list,
+                          const bmi_size_t *size_list,
+                          int list_count,
+                          bmi_size_t total_size,
+                          enum bmi_buffer_type buffer_type,
+                          bmi_msg_tag_t tag,
+                          void *user_ptr,
+                          bmi_context_id context_id,
+                          PVFS_hint hints)
+{
+    return sm_post_send_generic(id, dest, buffer_list, size_list,
+                                list_count, total_size, tag, user_ptr,
+                                context_id, 0);
+}
+
+int BMI_sm_post_sendunexpected_list(bmi_op_id_t *id,
+                                    bmi_method_addr_p dest,
+                                    const void *const *buffer_list,
+                                    const bmi_size_t *size_list,
+                                    int list_count,
+                                    bmi_size_t total_size,
+                                    enum bmi_buffer_type buffer_type,
+                                    bmi_msg_tag_t tag,
+                                    void *user_ptr,
+                                    bmi_context_id context_id,
+                                    PVFS_hint hints)
+{
+    return sm_post_send_generic(id, dest, buffer_list, size_list,
+                                list_count, total_size, tag, user_ptr,
+                                context_id, 1);
+}
+
+/* BMI_sm_post_recv()
+ *
+ * Submits recv operations.
+ *
+ * returns 0 on success that requires later poll, returns 1 on instant
+ * completion, -errno on failure
+ */
+int BMI_sm_post_recv(bmi_op_id_t *id,
+                     bmi_method_addr_p src,
+                     void *buffer,
+                     bmi_size_t expected_size,
+                     bmi_size_t *actual_size,
+                     enum bmi_buffer_type buffer_type,
+                     bmi_msg_tag_t tag,
+                     void *user_ptr,
+                     bmi_context_id context_id,
+                     PVFS_hint hints)
+{
+    return sm_post_recv_generic(id, src, &buffer, &expected_size, 1,
+                                expected_size, actual_size, tag, user_ptr,
+                                context_id);
+}
+
+int BMI_sm_post_recv_list(bmi_op_id_t *id,
+                          bmi_method_addr_p src,
+                          void *const *buffer_list,
+                          const bmi_size_t *size_list,
+                          int list_count,
+                          bmi_size_t total_expected_size,
+                          bmi_size_t *total_actual_size,
+                          enum bmi_buffer_type buffer_type,
+                          bmi_msg_tag_t tag,
+                          void *user_ptr,
+                          bmi_context_id context_id,
+                          PVFS_hint hints)
+{
+    return sm_post_recv_generic(id, src, buffer_list, size_list, list_count,
+                                total_expected_size, total_actual_size, tag,
+                                user_ptr, context_id);
+}
+
+/* BMI_sm_test()
+ *
+ * Checks to see if a particular message has completed.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_test(bmi_op_id_t id,
+                int *outcount,
+                bmi_error_code_t *error_code,
+                bmi_size_t *actual_size,
+                void **user_ptr,
+                int max_idle_time,
+                bmi_context_id context_id)
+{
+    method_op_p query_op = (method_op_p)id_gen_fast_lookup(id);
+    struct sm_op *sm_op_data;
+    int ret;
+
+    assert(query_op != NULL);
+    sm_op_data = query_op->method_data;
+
+    gen_mutex_lock(&interface_mutex);
+
+    /* it may have completed while we worked on another operation */
+    ret = sm_do_work(sm_op_data->state == SM_OP_COMPLETE ? 0 : max_idle_time);
+    if (ret < 0)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return ret;
+    }
+
+    if (sm_op_data->state == SM_OP_COMPLETE)
+    {
+        assert(query_op->context_id == context_id);
+        op_list_remove(query_op);
+        if (user_ptr != NULL)
+        {
+            *user_ptr = query_op->user_ptr;
+        }
+        *error_code = query_op->error_code;
+        *actual_size = query_op->actual_size;
+        dealloc_sm_method_op(query_op);
+        (*outcount)++;
+    }
+
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_testsome()
+ *
+ * Checks to see if any messages from the specified list have completed.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_testsome(int incount,
+                    bmi_op_id_t *id_array,
+                    int *outcount,
+                    int *index_array,
+                    bmi_error_code_t *error_code_array,
+                    bmi_size_t *actual_size_array,
+                    void **user_ptr_array,
+                    int max_idle_time,
+                    bmi_context_id context_id)
+{
+    method_op_p query_op;
+    int i, ret;
+
+    gen_mutex_lock(&interface_mutex);
+
+    /* do not wait if one of them completed already */
+    for (i = 0; i < incount && max_idle_time > 0; i++)
+    {
+        if (id_array[i] &&
+            ((struct sm_op *)((method_op_p)id_gen_fast_lookup(
+                id_array[i]))->method_data)->state == SM_OP_COMPLETE)
+        {
+            max_idle_time = 0;
+        }
+    }
+
+    ret = sm_do_work(max_idle_time);
+    if (ret < 0)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return ret;
+    }
+
+    for (i = 0; i < incount; i++)
+    {
+        if (!id_array[i])
+        {
+            continue;
+        }
+        query_op = (method_op_p)id_gen_fast_lookup(id_array[i]);
+        if (((struct sm_op *)query_op->method_data)->state ==
+            SM_OP_COMPLETE)
+        {
+            assert(query_op->context_id == context_id);
+            op_list_remove(query_op);
+            error_code_array[*outcount] = query_op->error_code;
+            actual_size_array[*outcount] = query_op->actual_size;
+            index_array[*outcount] = i;
+            if (user_ptr_array != NULL)
+            {
+                user_ptr_array[*outcount] = query_op->user_ptr;
+            }
+            dealloc_sm_method_op(query_op);
+            (*outcount)++;
+        }
+    }
+
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_testunexpected()
+ *
+ * Checks to see if any unexpected messages have completed.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_testunexpected(int incount,
+                          int *outcount,
+                          struct bmi_method_unexpected_info *info,
+                          int max_idle_time)
+{
+    method_op_p query_op;
+    int ret;
+
+    gen_mutex_lock(&interface_mutex);
+
+    if (qlist_empty(&sm_unexp_done))
+    {
+        ret = sm_do_work(max_idle_time);
+        if (ret < 0)
+        {
+            gen_mutex_unlock(&interface_mutex);
+            return ret;
+        }
+    }
+
+    *outcount = 0;
+    while (*outcount < incount &&
+           (query_op = op_list_shownext(&sm_unexp_done)))
+    {
+        info[*outcount].error_code = query_op->error_code;
+        info[*outcount].addr = query_op->addr;
+        info[*outcount].buffer = query_op->buffer;
+        info[*outcount].size = query_op->actual_size;
+        info[*outcount].tag = query_op->msg_tag;
+        op_list_remove(query_op);
+        dealloc_sm_method_op(query_op);
+        (*outcount)++;
+    }
+
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_testcontext()
+ *
+ * Checks to see if any messages from the specified context have completed.
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_testcontext(int incount,
+                       bmi_op_id_t *out_id_array,
+                       int *outcount,
+                       bmi_error_code_t *error_code_array,
+                       bmi_size_t *actual_size_array,
+                       void **user_ptr_array,
+                       int max_idle_time,
+                       bmi_context_id context_id)
+{
+    method_op_p query_op;
+    int ret;
+
+    *outcount = 0;
+
+    gen_mutex_lock(&interface_mutex);
+
+    if (op_list_empty(completion_array[context_id]))
+    {
+        /* let the next testunexpected call pick those up right away */
+        if (!qlist_empty(&sm_unexp_done))
+        {
+            gen_mutex_unlock(&interface_mutex);
+            return 0;
+        }
+
+        ret = sm_do_work(max_idle_time);
+        if (ret < 0)
+        {
+            gen_mutex_unlock(&interface_mutex);
+            return ret;
+        }
+    }
+
+    while (*outcount < incount &&
+           (query_op = op_list_shownext(completion_array[context_id])))
+    {
+        assert(query_op->context_id == context_id);
+        op_list_remove(query_op);
+        error_code_array[*outcount] = query_op->error_code;
+        actual_size_array[*outcount] = query_op->actual_size;
+        out_id_array[*outcount] = query_op->op_id;
+        if (user_ptr_array != NULL)
+        {
+            user_ptr_array[*outcount] = query_op->user_ptr;
+        }
+        dealloc_sm_method_op(query_op);
+        (*outcount)++;
+    }
+
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_open_context()
+ *
+ * opens a new context with the specified context id
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_open_context(bmi_context_id context_id)
+{
+    gen_mutex_lock(&interface_mutex);
+    completion_array[context_id] = op_list_new();
+    if (!completion_array[context_id])
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return bmi_errno_to_pvfs(-ENOMEM);
+    }
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_close_context()
+ *
+ * shuts down a context, previously opened with BMI_sm_open_context()
+ *
+ * no return value
+ */
+void BMI_sm_close_context(bmi_context_id context_id)
+{
+    gen_mutex_lock(&interface_mutex);
+    op_list_cleanup_fn(completion_array[context_id], dealloc_sm_method_op);
+    completion_array[context_id] = NULL;
+    gen_mutex_unlock(&interface_mutex);
+}
+
+/* BMI_sm_cancel()
+ *
+ * attempt to cancel a pending bmi sm operation; one that has already
+ * started to move data takes its whole connection down
+ *
+ * returns 0 on success, -errno on failure
+ */
+int BMI_sm_cancel(bmi_op_id_t id,
+                  bmi_context_id context_id)
+{
+    method_op_p query_op;
+    struct sm_op *sm_op_data;
+
+    gen_mutex_lock(&interface_mutex);
+
+    query_op = (method_op_p)id_gen_fast_lookup(id);
+    if (!query_op)
+    {
+        /* assume that it has already completed naturally */
+        gen_mutex_unlock(&interface_mutex);
+        return 0;
+    }
+    sm_op_data = query_op->method_data;
+
+    switch (sm_op_data->state)
+    {
+    case SM_OP_COMPLETE:
+        break;
+
+    case SM_OP_RECV_POSTED:
+        op_list_remove(query_op);
+        sm_op_complete(query_op, -BMI_ECANCEL);
+        break;
+
+    case SM_OP_SEND_QUEUED:
+        if (!query_op->env_amt_complete)
+        {
+            op_list_remove(query_op);
+            sm_op_complete(query_op, -BMI_ECANCEL);
+            break;
+        }
+        /* fall through */
+    default:
+        /* the peer knows about this message already */
+        sm_conn_fail(query_op->addr->method_data, -BMI_ECANCEL);
+        break;
+    }
+
+    if (sm_need_wake)
+    {
+        sm_wake();
+    }
+    gen_mutex_unlock(&interface_mutex);
+    return 0;
+}
+
+/* BMI_sm_addr_rev_lookup_unexpected()
+ *
+ * returns a string describing the peer of an address
+ */
+const char *BMI_sm_addr_rev_lookup_unexpected(bmi_method_addr_p map)
+{
+    struct sm_addr *sm_addr_data = map->method_data;
+
+    return sm_addr_data->peer_string;
+}
+
+/* sm_match_octets()
+ *
+ * compares a dotted quad wildcard ("192.168.*") with an address in
+ * network order
+ *
+ * returns 1 on a match, 0 otherwise
+ */
+static int sm_match_octets(const char *wildcard, uint32_t ip)
+{
+    const unsigned char *octets = (const unsigned char *)&ip;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        char *end;
+        long val;
+
+        if (*wildcard == '*')
+        {
+            return 1;
+        }
+        val = strtol(wildcard, &end, 10);
+        if (end == wildcard || val != octets[i])
+        {
+            return 0;
+        }
+        if (i < 3)
+        {
+            if (*end != '.')
+            {
+                return 0;
+            }
+            wildcard = end + 1;
+        }
+    }
+    return 1;
+}
+
+/* BMI_sm_query_addr_range()
+ *
+ * Checks an address against a wildcard or network.  A peer here stands
+ * for a tcp client on this host, so tcp wildcards and networks are
+ * matched against the local IPv4 address the client looked the server
+ * up by (the address a tcp connection would have come from), or the
+ * loopback address.  sm wildcards match every peer.
+ *
+ * returns 1 on a match, 0 if no match, -errno on error
+ */
+int BMI_sm_query_addr_range(bmi_method_addr_p map,
+                            const char *wildcard_string,
+                            int netmask)
+{
+    struct sm_addr *sm_addr_data = map->method_data;
+    uint32_t ip = sm_addr_data->ip ? sm_addr_data->ip : htonl(INADDR_LOOPBACK);
+    const char *wildcard;
+
+    if (!strncmp(wildcard_string, "sm://", 5))
+    {
+        return 1;
+    }
+    if (strncmp(wildcard_string, "tcp://", 6))
+    {
+        return 0;
+    }
+    wildcard = wildcard_string + 6;
+
+    if (netmask == -1)
+    {
+        return sm_match_octets(wildcard, ip);
+    }
+    else
+    {
+        struct in_addr network;
+        uint32_t mask;
+
+        if (netmask < 0 || netmask > 32 || !inet_aton(wildcard, &network))
+        {
+            gossip_lerr("Invalid network specification: %s/%d\n",
+                        wildcard, netmask);
+            return bmi_errno_to_pvfs(-EINVAL);
+        }
+        mask = netmask ? htonl(~0U << (32 - netmask)) : 0;
+        return ((ip & mask) == (network.s_addr & mask));
+    }
+}
+
+/******************************************************************
+ * Internal support functions
+ */
+
+static bmi_method_addr_p alloc_sm_method_addr(void)
+{
+    bmi_method_addr_p map;
+    struct sm_addr *sm_addr_data;
+
+    map = bmi_alloc_method_addr(sm_params.method_id, sizeof(struct sm_addr));
+    if (!map)
+    {
+        return NULL;
+    }
+
+    /* zeroed by bmi_alloc_method_addr() */
+    sm_addr_data = map->method_data;
+    sm_addr_data->map = map;
+    sm_addr_data->fd = -1;
+    sm_addr_data->state = SM_CONN_DOWN;
+    INIT_QLIST_HEAD(&sm_addr_data->link);
+    INIT_QLIST_HEAD(&sm_addr_data->send_queue);
+    INIT_QLIST_HEAD(&sm_addr_data->ctl_queue);
+    INIT_QLIST_HEAD(&sm_addr_data->rndv_ops);
+    return map;
+}
+
+/* dealloc_sm_method_addr()
+ *
+ * frees an address; its connection must be down
+ */
+static void dealloc_sm_method_addr(bmi_method_addr_p map)
+{
+    struct sm_addr *sm_addr_data = map->method_data;
+
+    if (sm_addr_data->fd > -1)
+    {
+        close(sm_addr_data->fd);
+    }
+    if (sm_addr_data->shm)
+    {
+        munmap(sm_addr_data->shm, sm_addr_data->shm_size);
+    }
+    free(sm_addr_data->host);
+    bmi_dealloc_method_addr(map);
+}
+
+static method_op_p alloc_sm_method_op(void)
+{
+    return bmi_slab_alloc_method_op(&sm_op_slab);
+}
+
+static void dealloc_sm_method_op(method_op_p op)
+{
+    bmi_slab_dealloc_method_op(&sm_op_slab, op);
+}
+
+/* sm_wake()
+ *
+ * makes a thread blocked in sm_do_work() return
+ */
+static void sm_wake(void)
+{
+    uint64_t one = 1;
+
+    sm_need_wake = 0;
+    if (sm_params.wake_fd > -1 &&
+        write(sm_params.wake_fd, &one, sizeof(one)) < 0)
+    {
+        /* counter full of pending wakeups; just as good */
+    }
+}
+
+/* sm_op_complete()
+ *
+ * moves an operation, already off any list, to its completion queue
+ */
+static void sm_op_complete(method_op_p op, int error_code)
+{
+    struct sm_op *sm_op_data = op->method_data;
+
+    if (error_code)
+    {
+        op->error_code = error_code;
+    }
+    if (sm_op_data->iovs)
+    {
+        free(sm_op_data->iovs);
+        sm_op_data->iovs = NULL;
+    }
+    sm_op_data->state = SM_OP_COMPLETE;
+    op_list_add(completion_array[op->context_id], op);
+    sm_need_wake = 1;
+}
+
+/* sm_copy_list()
+ *
+ * copies between a contiguous buffer and the bytes of an operation's
+ * buffer list starting at offset
+ */
+static void sm_copy_list(method_op_p op, bmi_size_t offset, char *buf,
+                         bmi_size_t len, int to_list)
+{
+    int i;
+
+    for (i = 0; i < op->list_count && len > 0; i++)
+    {
+        bmi_size_t seg = op->size_list[i];
+        bmi_size_t n;
+
+        if (offset >= seg)
+        {
+            offset -= seg;
+            continue;
+        }
+        n = seg - offset;
+        if (n > len)
+        {
+            n = len;
+        }
+        if (to_list)
+        {
+            memcpy((char *)op->buffer_list[i] + offset, buf, n);
+        }
+        else
+        {
+            memcpy(buf, (const char *)op->buffer_list[i] + offset, n);
+        }
+        buf += n;
+        len -= n;
+        offset = 0;
+    }
+}
+
+/* sm_op_iovs()
+ *
+ * describes the first size bytes of an operation's buffer list
+ *
+ * returns the number of entries filled in, -1 if there are too many
+ */
+static int sm_op_iovs(method_op_p op, bmi_size_t size, struct sm_iov *iovs,
+                      int max)
+{
+    int i, count = 0;
+
+    for (i = 0; i < op->list_count && size > 0; i++)
+    {
+        bmi_size_t n = op->size_list[i] < size ? op->size_list[i] : size;
+
+        if (n == 0)
+        {
+            continue;
+        }
+        if (count == max)
+        {
+            return -1;
+        }
+        iovs[count].base = (uint64_t)(uintptr_t)op->buffer_list[i];
+        iovs[count].len = n;
+        count++;
+        size -= n;
+    }
+    return count;
+}
+
+#ifdef HAVE_PROCESS_VM_READV
+#define SM_CMA_IOV_MAX 64
+
+/* sm_cma_copy()
+ *
+ * moves size bytes between the buffer list of a local operation and
+ * the buffer list of the peer with process_vm_readv/writev
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_cma_copy(pid_t pid, method_op_p op, const struct sm_iov *iovs,
+                       int iov_count, bmi_size_t size, int write)
+{
+    struct iovec local[SM_CMA_IOV_MAX], remote[SM_CMA_IOV_MAX];
+    int li = 0, ri = 0;
+    bmi_size_t loff = 0, roff = 0;
+
+    while (size > 0)
+    {
+        int nl = 0, nr = 0, i;
+        bmi_size_t off;
+        ssize_t ret;
+
+        /* windows into both lists from where the last call stopped */
+        for (i = li, off = loff; i < op->list_count && nl < SM_CMA_IOV_MAX;
+             i++, off = 0)
+        {
+            if (op->size_list[i] > off)
+            {
+                local[nl].iov_base = (char *)op->buffer_list[i] + off;
+                local[nl].iov_len = op->size_list[i] - off;
+                nl++;
+            }
+        }
+        for (i = ri, off = roff; i < iov_count && nr < SM_CMA_IOV_MAX;
+             i++, off = 0)
+        {
+            if (iovs[i].len > off)
+            {
+                remote[nr].iov_base = (void *)(uintptr_t)(iovs[i].base + off);
+                remote[nr].iov_len = iovs[i].len - off;
+                nr++;
+            }
+        }
+        if (nl == 0 || nr == 0)
+        {
+            return -BMI_EMSGSIZE;
+        }
+
+        if (write)
+        {
+            ret = process_vm_writev(pid, local, nl, remote, nr, 0);
+        }
+        else
+        {
+            ret = process_vm_readv(pid, local, nl, remote, nr, 0);
+        }
+        if (ret <= 0)
+        {
+            return ret < 0 ? bmi_errno_to_pvfs(-errno) : -BMI_EFAULT;
+        }
+        if (ret > size)
+        {
+            ret = size;
+        }
+        size -= ret;
+
+        /* advance both lists past what was moved */
+        for (off = ret; off > 0 && li < op->list_count; )
+        {
+            bmi_size_t left = op->size_list[li] - loff;
+            if (off < left)
+            {
+                loff += off;
+                break;
+            }
+            off -= left;
+            li++;
+            loff = 0;
+        }
+        for (off = ret; off > 0 && ri < iov_count; )
+        {
+            bmi_size_t left = iovs[ri].len - roff;
+            if (off < left)
+            {
+                roff += off;
+                break;
+            }
+            off -= left;
+            ri++;
+            roff = 0;
+        }
+    }
+    return 0;
+}
+
+/* sm_cma_probe()
+ *
+ * checks whether we may use cross memory attach on a process by reading
+ * its probe word
+ */
+static int sm_cma_probe(pid_t pid, uint64_t addr)
+{
+    uint64_t val = 0;
+    struct iovec local, remote;
+
+    local.iov_base = &val;
+    local.iov_len = sizeof(val);
+    remote.iov_base = (void *)(uintptr_t)addr;
+    remote.iov_len = sizeof(val);
+    return (process_vm_readv(pid, &local, 1, &remote, 1, 0) ==
+            (ssize_t)sizeof(val) && val == SM_PROBE_MAGIC);
+}
+#else
+static int sm_cma_copy(pid_t pid, method_op_p op, const struct sm_iov *iovs,
+                       int iov_count, bmi_size_t size, int write)
+{
+    return -BMI_ENOSYS;
+}
+
+static int sm_cma_probe(pid_t pid, uint64_t addr)
+{
+    return 0;
+}
+#endif
+
+/* sm_create_segment()
+ *
+ * creates the shared segment for a connection, sealed against resizing
+ * where the kernel allows so that a client cannot make the server fault
+ * on it
+ *
+ * returns a file descriptor on success, -errno on failure
+ */
+static int sm_create_segment(size_t size)
+{
+    int fd = -1;
+
+#if defined(SYS_memfd_create) && defined(F_ADD_SEALS)
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+    fd = syscall(SYS_memfd_create, "pvfs2-bmi-sm",
+                 MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd > -1)
+    {
+        if (ftruncate(fd, size) < 0 ||
+            fcntl(fd, F_ADD_SEALS,
+                  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+        {
+            int err = errno;
+            close(fd);
+            return -err;
+        }
+        return fd;
+    }
+#endif
+
+    /* older kernels: an unlinked file in tmpfs */
+    {
+        char name[] = "/dev/shm/pvfs2-bmi-sm-XXXXXX";
+
+        fd = mkstemp(name);
+        if (fd < 0)
+        {
+            return -errno;
+        }
+        unlink(name);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if (ftruncate(fd, size) < 0)
+        {
+            int err = errno;
+            close(fd);
+            return -err;
+        }
+    }
+    return fd;
+}
+
+/* sm_conn_map()
+ *
+ * sets up the ring pointers of a connection over its mapped segment
+ */
+static void sm_conn_map(struct sm_addr *conn, struct sm_shared *shm,
+                        size_t size, uint32_t ring_size)
+{
+    int tx = conn->side;
+    int rx = 1 - conn->side;
+
+    conn->shm = shm;
+    conn->shm_size = size;
+    conn->ring_size = ring_size;
+    conn->tx = &shm->ring[tx];
+    conn->rx = &shm->ring[rx];
+    conn->tx_ring = (char *)shm + SM_SHARED_HDR_SIZE + tx * ring_size;
+    conn->rx_ring = (char *)shm + SM_SHARED_HDR_SIZE + rx * ring_size;
+    conn->tx_head = conn->tx_published = conn->tx->head;
+    conn->rx_tail = conn->rx->tail;
+}
+
+/* sm_wait_fd()
+ *
+ * waits for a socket to become readable, up to timeout ms
+ *
+ * returns 0 if readable, BMI error code otherwise
+ */
+static int sm_wait_fd(int fd, int timeout)
+{
+    struct pollfd pfd;
+    int ret;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    do
+    {
+        ret = poll(&pfd, 1, timeout);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+    {
+        return bmi_errno_to_pvfs(-errno);
+    }
+    if (ret == 0)
+    {
+        return -BMI_ETIMEDOUT;
+    }
+    return 0;
+}
+
+/* sm_connect()
+ *
+ * connects the client end of an address to its server: trades hellos
+ * over the server's socket and maps the shared segment the server
+ * sends back
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_connect(struct sm_addr *conn)
+{
+    struct sockaddr_un sun;
+    socklen_t len;
+    struct ucred cred;
+    struct sm_hello hello;
+    struct sm_hello_reply reply;
+    struct msghdr msg;
+    struct iovec iov;
+    union
+    {
+        struct cmsghdr cm;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr *cmsg;
+    int seg_fd = -1;
+    void *shm;
+    size_t size;
+    int ret;
+
+    conn->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conn->fd < 0)
+    {
+        return bmi_errno_to_pvfs(-errno);
+    }
+    fcntl(conn->fd, F_SETFD, FD_CLOEXEC);
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    len = offsetof(struct sockaddr_un, sun_path) + 1 +
+        snprintf(sun.sun_path + 1, sizeof(sun.sun_path) - 1,
+                 SM_SOCKET_PREFIX "%d", conn->port);
+    if (connect(conn->fd, (struct sockaddr *)&sun, len) < 0)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto connect_failure;
+    }
+
+    /* anybody may bind an abstract name; only trust a server run by
+     * root or by ourselves
+     */
+    len = sizeof(cred);
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto connect_failure;
+    }
+    if (cred.uid != 0 && cred.uid != getuid())
+    {
+        gossip_err("Warning: bmi_sm: ignoring server for port %d run by "
+                   "uid %d\n", conn->port, (int)cred.uid);
+        ret = -BMI_EACCES;
+        goto connect_failure;
+    }
+    conn->peer_pid = cred.pid;
+
+    memset(&hello, 0, sizeof(hello));
+    hello.magic = SM_MAGIC;
+    hello.version = SM_VERSION;
+    hello.ip = conn->ip;
+    hello.probe = (uint64_t)(uintptr_t)&sm_probe_word;
+    if (send(conn->fd, &hello, sizeof(hello), MSG_NOSIGNAL) !=
+        (ssize_t)sizeof(hello))
+    {
+        ret = -BMI_ECONNRESET;
+        goto connect_failure;
+    }
+
+    ret = sm_wait_fd(conn->fd, SM_CONNECT_TIMEOUT_MS);
+    if (ret < 0)
+    {
+        goto connect_failure;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &reply;
+    iov.iov_len = sizeof(reply);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    if (recvmsg(conn->fd, &msg, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(reply))
+    {
+        ret = -BMI_ECONNRESET;
+        goto connect_failure;
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        memcpy(&seg_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (reply.magic != SM_MAGIC || reply.status != 0 || seg_fd < 0 ||
+        reply.ring_size < 2 * SM_FRAG_SIZE ||
+        (reply.ring_size & (reply.ring_size - 1)))
+    {
+        ret = reply.status ? reply.status : -BMI_EPROTO;
+        goto connect_failure;
+    }
+
+    size = SM_SHARED_HDR_SIZE + 2 * (size_t)reply.ring_size;
+    shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg_fd, 0);
+    close(seg_fd);
+    seg_fd = -1;
+    if (shm == MAP_FAILED)
+    {
+        ret = bmi_errno_to_pvfs(-errno);
+        goto connect_failure;
+    }
+    conn->side = SM_SIDE_CLIENT;
+    sm_conn_map(conn, shm, size, reply.ring_size);
+
+    /* the server tested us before replying; tell it how we did */
+    conn->cma = sm_cma_probe(conn->peer_pid, reply.probe);
+    conn->shm->cma[SM_SIDE_CLIENT] = conn->cma;
+
+    fcntl(conn->fd, F_SETFL, O_NONBLOCK);
+    conn->state = SM_CONN_UP;
+    conn->error = 0;
+    snprintf(conn->peer_string, sizeof(conn->peer_string), "sm://%s:%d",
+             conn->host ? conn->host : "localhost", conn->port);
+
+    gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                 "bmi_sm: connected to server pid %d for port %d "
+                 "(cma %d/%d)\n", (int)conn->peer_pid, conn->port,
+                 conn->cma, conn->shm->cma[SM_SIDE_SERVER]);
+    return 0;
+
+  connect_failure:
+    if (seg_fd > -1)
+    {
+        close(seg_fd);
+    }
+    close(conn->fd);
+    conn->fd = -1;
+    return ret;
+}
+
+/* sm_conn_register()
+ *
+ * adds a connection to the epoll set
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_conn_register(struct sm_addr *conn)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = conn;
+    if (epoll_ctl(sm_params.epfd, EPOLL_CTL_ADD, conn->fd, &event) < 0)
+    {
+        return bmi_errno_to_pvfs(-errno);
+    }
+    conn->registered = 1;
+    return 0;
+}
+
+/* sm_conn_ready()
+ *
+ * makes sure a connection can carry messages: connects client ends
+ * that are down and puts connections made before the method was
+ * initialized into service
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_conn_ready(struct sm_addr *conn)
+{
+    int ret;
+
+    if (conn->state == SM_CONN_DOWN)
+    {
+        if (conn->side != SM_SIDE_CLIENT || conn->dont_reconnect)
+        {
+            return conn->error ? conn->error : -BMI_ENETRESET;
+        }
+        ret = sm_connect(conn);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    if (!conn->registered)
+    {
+        ret = sm_conn_register(conn);
+        if (ret < 0)
+        {
+            sm_conn_fail(conn, ret);
+            return ret;
+        }
+        qlist_add_tail(&conn->link, &sm_conns);
+    }
+    return 0;
+}
+
+/* sm_fail_list()
+ *
+ * completes all operations of a connection on a list with an error
+ */
+static void sm_fail_list(struct qlist_head *list, struct sm_addr *conn,
+                         int error_code)
+{
+    method_op_p op, tmp;
+
+    qlist_for_each_entry_safe(op, tmp, list, op_list_entry)
+    {
+        if (op->addr == conn->map)
+        {
+            op_list_remove(op);
+            sm_op_complete(op, error_code);
+        }
+    }
+}
+
+/* sm_conn_fail()
+ *
+ * takes a connection down and fails all of its operations; server ends
+ * are handed to BMI to be forgotten
+ */
+static void sm_conn_fail(struct sm_addr *conn, int error_code)
+{
+    struct sm_ctl *ctl, *tmp;
+    method_op_p op, tmp_op;
+    int was_up = (conn->state == SM_CONN_UP);
+
+    gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                 "bmi_sm: connection to %s down: %d\n",
+                 conn->peer_string, error_code);
+
+    if (conn->registered)
+    {
+        epoll_ctl(sm_params.epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        conn->registered = 0;
+        qlist_del_init(&conn->link);
+    }
+    if (conn->fd > -1)
+    {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    if (conn->shm)
+    {
+        munmap(conn->shm, conn->shm_size);
+        conn->shm = NULL;
+    }
+
+    sm_fail_list(&conn->send_queue, conn, error_code);
+    sm_fail_list(&conn->rndv_ops, conn, error_code);
+    sm_fail_list(&sm_recv_posted, conn, error_code);
+    if (conn->rx_cur)
+    {
+        sm_op_complete(conn->rx_cur, error_code);
+        conn->rx_cur = NULL;
+    }
+    conn->rx_blocked = 0;
+
+    qlist_for_each_entry_safe(op, tmp_op, &sm_recv_early, op_list_entry)
+    {
+        if (op->addr == conn->map)
+        {
+            op_list_remove(op);
+            free(op->buffer);
+            free(((struct sm_op *)op->method_data)->iovs);
+            dealloc_sm_method_op(op);
+        }
+    }
+    qlist_for_each_entry_safe(ctl, tmp, &conn->ctl_queue, link)
+    {
+        qlist_del(&ctl->link);
+        free(ctl->iovs);
+        free(ctl);
+    }
+
+    conn->state = SM_CONN_DOWN;
+    conn->error = error_code;
+
+    if (conn->side == SM_SIDE_SERVER)
+    {
+        conn->dont_reconnect = 1;
+        /* let BMI decide when to forget about the address */
+        if (was_up)
+        {
+            bmi_method_addr_forget_callback(conn->bmi_addr);
+        }
+    }
+}
+
+/* sm_ring_reserve()
+ *
+ * finds room for a record of rec_len bytes at the head of our ring,
+ * skipping to the start of the ring if it does not fit at the end
+ *
+ * returns a pointer to the room, NULL if the ring is too full
+ */
+static struct sm_msg *sm_ring_reserve(struct sm_addr *conn, uint32_t rec_len)
+{
+    uint64_t tail = conn->tx->tail;
+    uint32_t off = conn->tx_head & (conn->ring_size - 1);
+    uint32_t to_end = conn->ring_size - off;
+    uint32_t skip = (to_end < rec_len) ? to_end : 0;
+
+    if (conn->tx_head - tail + skip + rec_len > conn->ring_size)
+    {
+        return NULL;
+    }
+    if (skip)
+    {
+        /* a tail too short for a header is skipped implicitly */
+        if (skip >= sizeof(struct sm_msg))
+        {
+            struct sm_msg *wrap = (struct sm_msg *)(conn->tx_ring + off);
+            wrap->type = SM_MSG_WRAP;
+            wrap->len = skip - sizeof(struct sm_msg);
+        }
+        conn->tx_head += skip;
+        off = 0;
+    }
+    return (struct sm_msg *)(conn->tx_ring + off);
+}
+
+/* sm_ring_commit()
+ *
+ * accounts for a record written at the room from sm_ring_reserve()
+ */
+static void sm_ring_commit(struct sm_addr *conn, uint32_t rec_len)
+{
+    conn->tx_head += rec_len;
+}
+
+/* sm_ring_publish()
+ *
+ * makes the records written so far visible to the peer, and wakes it
+ * up if it had seen our ring empty and may be asleep
+ */
+static void sm_ring_publish(struct sm_addr *conn)
+{
+    uint64_t old = conn->tx_published;
+
+    if (conn->tx_head == old)
+    {
+        return;
+    }
+    sm_mb();
+    conn->tx->head = conn->tx_head;
+    conn->tx_published = conn->tx_head;
+    sm_mb();
+    if (conn->tx->tail == old &&
+        send(conn->fd, "", 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+    {
+        /* a full socket already holds plenty of wakeups */
+    }
+}
+
+/* sm_ring_release()
+ *
+ * hands the records consumed so far back to the peer, and wakes it up
+ * if it is waiting for room
+ */
+static void sm_ring_release(struct sm_addr *conn)
+{
+    if (conn->rx->tail == conn->rx_tail)
+    {
+        return;
+    }
+    sm_mb();
+    conn->rx->tail = conn->rx_tail;
+    sm_mb();
+    if (conn->rx->producer_waiting)
+    {
+        conn->rx->producer_waiting = 0;
+        if (send(conn->fd, "", 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+        {
+            /* see sm_ring_publish() */
+        }
+    }
+}
+
+/* sm_ring_full()
+ *
+ * asks the peer for a wakeup when it frees room, then checks again in
+ * case it did so in the meantime
+ *
+ * returns 1 if the ring is still too full for rec_len bytes, 0 if not
+ */
+static int sm_ring_full(struct sm_addr *conn, uint32_t rec_len)
+{
+    conn->tx->producer_waiting = 1;
+    sm_mb();
+    return (sm_ring_reserve(conn, rec_len) == NULL);
+}
+
+/* sm_send_record()
+ *
+ * writes one record with its payload gathered from an op's buffer list
+ * (at offset) or from a flat buffer
+ *
+ * returns 1 if written, 0 if the ring is full
+ */
+static int sm_send_record(struct sm_addr *conn, const struct sm_msg *hdr,
+                          method_op_p op, bmi_size_t offset,
+                          const void *payload)
+{
+    uint32_t rec_len = sizeof(struct sm_msg) + SM_ALIGN8(hdr->len);
+    struct sm_msg *m;
+
+    m = sm_ring_reserve(conn, rec_len);
+    if (!m)
+    {
+        return 0;
+    }
+    memcpy(m, hdr, sizeof(*m));
+    if (hdr->len)
+    {
+        if (op)
+        {
+            sm_copy_list(op, offset, (char *)(m + 1), hdr->len, 0);
+        }
+        else
+        {
+            memcpy(m + 1, payload, hdr->len);
+        }
+    }
+    sm_ring_commit(conn, rec_len);
+    return 1;
+}
+
+/* sm_send_ctl()
+ *
+ * sends a CTS or DONE record, or queues it until there is room
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_send_ctl(struct sm_addr *conn, const struct sm_msg *msg,
+                       const struct sm_iov *iovs)
+{
+    struct sm_ctl *ctl;
+
+    if (qlist_empty(&conn->ctl_queue) &&
+        sm_send_record(conn, msg, NULL, 0, iovs))
+    {
+        sm_ring_publish(conn);
+        return 0;
+    }
+
+    ctl = (struct sm_ctl *)malloc(sizeof(*ctl));
+    if (!ctl)
+    {
+        return -BMI_ENOMEM;
+    }
+    ctl->msg = *msg;
+    ctl->iovs = NULL;
+    if (msg->len)
+    {
+        ctl->iovs = (struct sm_iov *)malloc(msg->len);
+        if (!ctl->iovs)
+        {
+            free(ctl);
+            return -BMI_ENOMEM;
+        }
+        memcpy(ctl->iovs, iovs, msg->len);
+    }
+    qlist_add_tail(&ctl->link, &conn->ctl_queue);
+    return 0;
+}
+
+/* sm_send_done()
+ *
+ * reports the end of a cross memory transfer to the peer
+ */
+static void sm_send_done(struct sm_addr *conn, uint64_t id, bmi_size_t size,
+                         int status)
+{
+    struct sm_msg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SM_MSG_DONE;
+    msg.id = id;
+    msg.size = size;
+    msg.status = status;
+    if (sm_send_ctl(conn, &msg, NULL) < 0)
+    {
+        sm_conn_fail(conn, -BMI_ENOMEM);
+    }
+}
+
+/* sm_push_send()
+ *
+ * moves a queued send into the ring as far as room allows: an eager
+ * record, an RTS, or the next pieces of a streamed message
+ *
+ * returns 1 when the op has left the send queue, 0 if it has to wait
+ */
+static int sm_push_send(struct sm_addr *conn, method_op_p op)
+{
+    struct sm_op *sm_op_data = op->method_data;
+    struct sm_msg hdr;
+    int peer_cma = conn->shm->cma[1 - conn->side];
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.tag = op->msg_tag;
+    hdr.size = op->actual_size;
+    hdr.id = op->op_id;
+    if (sm_op_data->unexpected)
+    {
+        hdr.flags = SM_FLAG_UNEXPECTED;
+    }
+
+    if (op->actual_size > SM_RNDV_LIMIT && (conn->cma || peer_cma) &&
+        op->list_count * sizeof(struct sm_iov) <= SM_FRAG_SIZE)
+    {
+        /* rendezvous: the peer reads our buffers, or tells us where to
+         * write
+         */
+        struct sm_iov *iovs;
+        int count;
+
+        iovs = (struct sm_iov *)malloc(op->list_count * sizeof(*iovs));
+        if (!iovs)
+        {
+            return 0;
+        }
+        count = sm_op_iovs(op, op->actual_size, iovs, op->list_count);
+        hdr.type = SM_MSG_RTS;
+        hdr.len = count * sizeof(*iovs);
+        if (!sm_send_record(conn, &hdr, NULL, 0, iovs))
+        {
+            free(iovs);
+            return 0;
+        }
+        free(iovs);
+        op->env_amt_complete = 1;
+        op_list_remove(op);
+        sm_op_data->state = SM_OP_SEND_RNDV;
+        op_list_add(&conn->rndv_ops, op);
+        return 1;
+    }
+
+    /* eager, or streamed in pieces */
+    do
+    {
+        bmi_size_t left = op->actual_size - op->amt_complete;
+
+        hdr.type = op->env_amt_complete ? SM_MSG_FRAG : SM_MSG_EAGER;
+        hdr.len = left > SM_FRAG_SIZE ? SM_FRAG_SIZE : left;
+        if (!sm_send_record(conn, &hdr, op, op->amt_complete, NULL))
+        {
+            return 0;
+        }
+        op->env_amt_complete = 1;
+        op->amt_complete += hdr.len;
+    } while (op->amt_complete < op->actual_size);
+
+    op_list_remove(op);
+    sm_op_complete(op, 0);
+    return 1;
+}
+
+/* sm_conn_tx()
+ *
+ * pushes queued control records and sends into the ring
+ *
+ * returns 1 if anything was sent, 0 otherwise
+ */
+static int sm_conn_tx(struct sm_addr *conn)
+{
+    struct sm_ctl *ctl, *tmp;
+    method_op_p op;
+    int work = 0;
+
+    qlist_for_each_entry_safe(ctl, tmp, &conn->ctl_queue, link)
+    {
+        if (!sm_send_record(conn, &ctl->msg, NULL, 0, ctl->iovs))
+        {
+            sm_ring_full(conn, sizeof(struct sm_msg) +
+                         SM_ALIGN8(ctl->msg.len));
+            sm_ring_publish(conn);
+            return work;
+        }
+        qlist_del(&ctl->link);
+        free(ctl->iovs);
+        free(ctl);
+        work = 1;
+    }
+
+    while ((op = op_list_shownext(&conn->send_queue)))
+    {
+        bmi_size_t before = op->amt_complete;
+
+        if (!sm_push_send(conn, op))
+        {
+            if (op->amt_complete != before)
+            {
+                work = 1;
+            }
+            sm_ring_full(conn, sizeof(struct sm_msg) + SM_FRAG_SIZE);
+            break;
+        }
+        work = 1;
+    }
+    sm_ring_publish(conn);
+    return work;
+}
+
+/* sm_match_recv()
+ *
+ * finds the oldest posted receive for a message from conn with tag
+ */
+static method_op_p sm_match_recv(struct sm_addr *conn, bmi_msg_tag_t tag)
+{
+    struct op_list_search_key key;
+
+    memset(&key, 0, sizeof(key));
+    key.method_addr = conn->map;
+    key.method_addr_yes = 1;
+    key.msg_tag = tag;
+    key.msg_tag_yes = 1;
+    return op_list_search(&sm_recv_posted, &key);
+}
+
+/* sm_rndv_start()
+ *
+ * starts the transfer of a message announced by an RTS into a matched
+ * receive: reads it from the peer if we can, or sends a CTS for the
+ * peer to write it
+ *
+ * returns 1 if the receive completed, 0 if it waits for the peer
+ */
+static int sm_rndv_start(struct sm_addr *conn, method_op_p recv,
+                         uint64_t peer_id, bmi_size_t size,
+                         const struct sm_iov *iovs, int iov_count)
+{
+    struct sm_op *sm_op_data = recv->method_data;
+    struct sm_msg msg;
+    int ret;
+
+    recv->actual_size = size;
+
+    if (size > recv->expected_size)
+    {
+        sm_send_done(conn, peer_id, 0, -BMI_EMSGSIZE);
+        sm_op_complete(recv, -BMI_EMSGSIZE);
+        return 1;
+    }
+
+    if (conn->cma)
+    {
+        ret = sm_cma_copy(conn->peer_pid, recv, iovs, iov_count, size, 0);
+        sm_send_done(conn, peer_id, size, ret);
+        sm_op_complete(recv, ret);
+        return 1;
+    }
+
+    /* the peer writes to us */
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SM_MSG_CTS;
+    msg.id = peer_id;
+    msg.peer_id = recv->op_id;
+    msg.size = size;
+    sm_op_data->iovs = (struct sm_iov *)malloc(
+        recv->list_count * sizeof(struct sm_iov));
+    ret = sm_op_data->iovs ?
+        sm_op_iovs(recv, size, sm_op_data->iovs, recv->list_count) : -1;
+    if (ret < 0 || ret * sizeof(struct sm_iov) > SM_FRAG_SIZE)
+    {
+        sm_send_done(conn, peer_id, 0, -BMI_EMSGSIZE);
+        sm_op_complete(recv, -BMI_EMSGSIZE);
+        return 1;
+    }
+    msg.len = ret * sizeof(struct sm_iov);
+    ret = sm_send_ctl(conn, &msg, sm_op_data->iovs);
+    free(sm_op_data->iovs);
+    sm_op_data->iovs = NULL;
+    if (ret < 0)
+    {
+        sm_op_complete(recv, ret);
+        return 1;
+    }
+    sm_op_data->state = SM_OP_RECV_RNDV;
+    op_list_add(&conn->rndv_ops, recv);
+    return 0;
+}
+
+/* sm_find_rndv()
+ *
+ * finds an operation of a connection waiting on a CTS or DONE
+ */
+static method_op_p sm_find_rndv(struct sm_addr *conn, uint64_t id)
+{
+    method_op_p op;
+
+    qlist_for_each_entry(op, &conn->rndv_ops, op_list_entry)
+    {
+        if ((uint64_t)op->op_id == id)
+        {
+            return op;
+        }
+    }
+    return NULL;
+}
+
+/* sm_new_early()
+ *
+ * keeps a message (or an RTS) that arrived before its receive
+ *
+ * returns the new op, NULL when out of memory
+ */
+static method_op_p sm_new_early(struct sm_addr *conn,
+                                const struct sm_msg *hdr)
+{
+    method_op_p op = alloc_sm_method_op();
+
+    if (!op)
+    {
+        return NULL;
+    }
+    op->addr = conn->map;
+    op->msg_tag = hdr->tag;
+    op->actual_size = hdr->size;
+    op->send_recv = BMI_RECV;
+    ((struct sm_op *)op->method_data)->state = SM_OP_EARLY;
+    return op;
+}
+
+/* sm_stream_piece()
+ *
+ * copies a piece of a streamed message into the receive taking it
+ */
+static void sm_stream_piece(struct sm_addr *conn, method_op_p op,
+                            const struct sm_msg *hdr, char *payload)
+{
+    if (!op->error_code)
+    {
+        sm_copy_list(op, op->amt_complete, payload, hdr->len, 1);
+    }
+    op->amt_complete += hdr->len;
+    if (op->amt_complete >= op->actual_size)
+    {
+        conn->rx_cur = NULL;
+        sm_op_complete(op, 0);
+    }
+}
+
+/* sm_conn_rx()
+ *
+ * processes the records the peer has written to our receive ring
+ *
+ * returns 1 if anything was processed, 0 otherwise
+ */
+static int sm_conn_rx(struct sm_addr *conn)
+{
+    uint64_t head;
+    struct sm_msg hdr;
+    char *payload;
+    method_op_p op;
+    int work = 0;
+
+    head = conn->rx->head;
+    sm_mb();
+
+    while (conn->rx_tail != head && conn->state == SM_CONN_UP)
+    {
+        uint32_t off = conn->rx_tail & (conn->ring_size - 1);
+        uint32_t to_end = conn->ring_size - off;
+        uint32_t rec_len;
+
+        if (to_end < sizeof(struct sm_msg))
+        {
+            conn->rx_tail += to_end;
+            continue;
+        }
+        /* the peer could change the ring under us; use a copy */
+        memcpy(&hdr, conn->rx_ring + off, sizeof(hdr));
+        if (hdr.type == SM_MSG_WRAP)
+        {
+            conn->rx_tail += to_end;
+            continue;
+        }
+        rec_len = sizeof(struct sm_msg) + SM_ALIGN8((uint64_t)hdr.len);
+        if (hdr.len > SM_FRAG_SIZE || rec_len > to_end ||
+            conn->rx_tail + rec_len > head)
+        {
+            sm_conn_fail(conn, -BMI_EPROTO);
+            return 1;
+        }
+        payload = conn->rx_ring + off + sizeof(struct sm_msg);
+
+        switch (hdr.type)
+        {
+        case SM_MSG_EAGER:
+            if (conn->rx_cur || hdr.len > hdr.size ||
+                hdr.size > SM_MAX_SIZE)
+            {
+                sm_conn_fail(conn, -BMI_EPROTO);
+                return 1;
+            }
+            if (hdr.flags & SM_FLAG_UNEXPECTED)
+            {
+                if (hdr.len != hdr.size || hdr.size > SM_EAGER_LIMIT)
+                {
+                    sm_conn_fail(conn, -BMI_EPROTO);
+                    return 1;
+                }
+                op = sm_new_early(conn, &hdr);
+                if (op)
+                {
+                    op->buffer = malloc(hdr.size ? hdr.size : 1);
+                }
+                if (!op || !op->buffer)
+                {
+                    /* leave it in the ring for another try */
+                    if (op)
+                    {
+                        dealloc_sm_method_op(op);
+                    }
+                    sm_ring_release(conn);
+                    return work;
+                }
+                memcpy(op->buffer, payload, hdr.size);
+                ((struct sm_op *)op->method_data)->state = SM_OP_COMPLETE;
+                op_list_add(&sm_unexp_done, op);
+                break;
+            }
+
+            op = sm_match_recv(conn, hdr.tag);
+            if (op)
+            {
+                op_list_remove(op);
+                op->actual_size = hdr.size;
+                if (hdr.size > op->expected_size)
+                {
+                    /* take the pieces in, but drop them */
+                    op->error_code = -BMI_EMSGSIZE;
+                }
+                ((struct sm_op *)op->method_data)->state =
+                    SM_OP_RECV_STREAM;
+                conn->rx_cur = op;
+                sm_stream_piece(conn, op, &hdr, payload);
+            }
+            else if (hdr.len == hdr.size)
+            {
+                op = sm_new_early(conn, &hdr);
+                if (op)
+                {
+                    op->buffer = malloc(hdr.size ? hdr.size : 1);
+                }
+                if (!op || !op->buffer)
+                {
+                    if (op)
+                    {
+                        dealloc_sm_method_op(op);
+                    }
+                    sm_ring_release(conn);
+                    return work;
+                }
+                memcpy(op->buffer, payload, hdr.size);
+                op_list_add(&sm_recv_early, op);
+            }
+            else
+            {
+                /* a streamed message stays in the ring until somebody
+                 * posts a receive for it, as it would in a socket
+                 */
+                conn->rx_blocked = 1;
+                sm_ring_release(conn);
+                return work;
+            }
+            break;
+
+        case SM_MSG_FRAG:
+            if (!conn->rx_cur ||
+                conn->rx_cur->amt_complete + hdr.len >
+                conn->rx_cur->actual_size)
+            {
+                sm_conn_fail(conn, -BMI_EPROTO);
+                return 1;
+            }
+            sm_stream_piece(conn, conn->rx_cur, &hdr, payload);
+            break;
+
+        case SM_MSG_RTS:
+        {
+            int iov_count = hdr.len / sizeof(struct sm_iov);
+
+            if (hdr.size > SM_MAX_SIZE || (hdr.flags & SM_FLAG_UNEXPECTED))
+            {
+                sm_conn_fail(conn, -BMI_EPROTO);
+                return 1;
+            }
+            op = sm_match_recv(conn, hdr.tag);
+            if (op)
+            {
+                op_list_remove(op);
+                sm_rndv_start(conn, op, hdr.id, hdr.size,
+                              (struct sm_iov *)payload, iov_count);
+                break;
+            }
+            op = sm_new_early(conn, &hdr);
+            if (op)
+            {
+                struct sm_op *sm_op_data = op->method_data;
+
+                sm_op_data->peer_id = hdr.id;
+                sm_op_data->iov_count = iov_count;
+                sm_op_data->iovs = (struct sm_iov *)malloc(
+                    hdr.len ? hdr.len : 1);
+                if (!sm_op_data->iovs)
+                {
+                    dealloc_sm_method_op(op);
+                    op = NULL;
+                }
+            }
+            if (!op)
+            {
+                sm_ring_release(conn);
+                return work;
+            }
+            memcpy(((struct sm_op *)op->method_data)->iovs, payload,
+                   hdr.len);
+            op_list_add(&sm_recv_early, op);
+            break;
+        }
+
+        case SM_MSG_CTS:
+        {
+            int ret;
+
+            op = sm_find_rndv(conn, hdr.id);
+            if (!op || op->send_recv != BMI_SEND)
+            {
+                sm_conn_fail(conn, -BMI_EPROTO);
+                return 1;
+            }
+            op_list_remove(op);
+            ret = sm_cma_copy(conn->peer_pid, op, (struct sm_iov *)payload,
+                              hdr.len / sizeof(struct sm_iov),
+                              op->actual_size, 1);
+            sm_send_done(conn, hdr.peer_id, op->actual_size, ret);
+            sm_op_complete(op, ret);
+            break;
+        }
+
+        case SM_MSG_DONE:
+            op = sm_find_rndv(conn, hdr.id);
+            if (!op)
+            {
+                sm_conn_fail(conn, -BMI_EPROTO);
+                return 1;
+            }
+            op_list_remove(op);
+            if (op->send_recv == BMI_RECV)
+            {
+                op->actual_size = hdr.size;
+            }
+            sm_op_complete(op, hdr.status);
+            break;
+
+        default:
+            sm_conn_fail(conn, -BMI_EPROTO);
+            return 1;
+        }
+
+        conn->rx_tail += rec_len;
+        work = 1;
+        if (conn->state != SM_CONN_UP)
+        {
+            return 1;
+        }
+    }
+
+    if (conn->state == SM_CONN_UP)
+    {
+        sm_ring_release(conn);
+    }
+    return work;
+}
+
+/* sm_progress()
+ *
+ * works on every connection that is up
+ *
+ * returns 1 if anything happened, 0 otherwise
+ */
+static int sm_progress(void)
+{
+    struct sm_addr *conn, *tmp;
+    int work = 0;
+
+    qlist_for_each_entry_safe(conn, tmp, &sm_conns, link)
+    {
+        if (!conn->rx_blocked)
+        {
+            work |= sm_conn_rx(conn);
+        }
+        if (conn->state == SM_CONN_UP &&
+            (!qlist_empty(&conn->send_queue) ||
+             !qlist_empty(&conn->ctl_queue)))
+        {
+            work |= sm_conn_tx(conn);
+        }
+    }
+    return work;
+}
+
+/* sm_drain()
+ *
+ * reads the wakeup bytes of a connection whose socket polled readable
+ */
+static void sm_drain(struct sm_addr *conn)
+{
+    char buf[64];
+    ssize_t ret;
+
+    do
+    {
+        ret = recv(conn->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    } while (ret == (ssize_t)sizeof(buf));
+
+    if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        /* the peer went away */
+        sm_conn_fail(conn, -BMI_ECONNRESET);
+    }
+}
+
+/* sm_do_work()
+ *
+ * moves messages on all connections, and if there was nothing to do
+ * checks for (or waits up to max_idle_time ms for) wakeups from the
+ * peers and new connections
+ *
+ * returns 0 on success, BMI error code on failure
+ */
+static int sm_do_work(int max_idle_time)
+{
+    struct epoll_event events[SM_WORK_METRIC];
+    struct timespec wait_time;
+    struct timeval start;
+    int i, count;
+
+    if (sm_progress())
+    {
+        sm_need_wake = 0;
+        return 0;
+    }
+
+    if (sm_test_busy)
+    {
+        if (max_idle_time == 0)
+        {
+            return 0;
+        }
+        /* another thread is already waiting; wait for it to finish */
+        gettimeofday(&start, NULL);
+        wait_time.tv_sec = start.tv_sec + max_idle_time / 1000;
+        wait_time.tv_nsec = (start.tv_usec +
+                             ((max_idle_time % 1000) * 1000)) * 1000;
+        if (wait_time.tv_nsec >= 1000000000)
+        {
+            wait_time.tv_nsec -= 1000000000;
+            wait_time.tv_sec++;
+        }
+        gen_cond_timedwait(&interface_cond, &interface_mutex, &wait_time);
+        return 0;
+    }
+
+    if (max_idle_time == 0)
+    {
+        /* also keeps stale wakeups from leaving the epoll descriptor
+         * readable for BMI to wait on
+         */
+        count = epoll_wait(sm_params.epfd, events, SM_WORK_METRIC, 0);
+    }
+    else
+    {
+        sm_test_busy = 1;
+        gen_mutex_unlock(&interface_mutex);
+
+        count = epoll_wait(sm_params.epfd, events, SM_WORK_METRIC,
+                           max_idle_time);
+
+        gen_mutex_lock(&interface_mutex);
+        sm_test_busy = 0;
+    }
+
+    if (count < 0)
+    {
+        gen_cond_broadcast(&interface_cond);
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        return bmi_errno_to_pvfs(-errno);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (events[i].data.ptr == &sm_params.wake_fd)
+        {
+            uint64_t val;
+            if (read(sm_params.wake_fd, &val, sizeof(val)) < 0)
+            {
+                /* already cleared by another pass */
+            }
+        }
+        else if (events[i].data.ptr == &sm_params.listen_fd)
+        {
+            sm_accept();
+        }
+        else
+        {
+            struct sm_addr *conn = events[i].data.ptr;
+
+            if (conn->state == SM_CONN_HELLO)
+            {
+                sm_hello(conn);
+            }
+            else if (conn->state == SM_CONN_UP)
+            {
+                sm_drain(conn);
+            }
+        }
+    }
+
+    sm_progress();
+    sm_need_wake = 0;
+    gen_cond_broadcast(&interface_cond);
+    return 0;
+}
+
+/* sm_accept()
+ *
+ * takes a new connection on the listening socket; it is put into
+ * service when its hello arrives
+ */
+static void sm_accept(void)
+{
+    bmi_method_addr_p map;
+    struct sm_addr *conn;
+    int fd;
+
+    fd = accept(sm_params.listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    map = alloc_sm_method_addr();
+    if (!map)
+    {
+        close(fd);
+        return;
+    }
+    conn = map->method_data;
+    conn->side = SM_SIDE_SERVER;
+    conn->dont_reconnect = 1;
+    conn->fd = fd;
+    conn->state = SM_CONN_HELLO;
+    if (sm_conn_register(conn) < 0)
+    {
+        dealloc_sm_method_addr(map);
+    }
+}
+
+/* sm_hello_fail()
+ *
+ * gives up on a connection that never got into service
+ */
+static void sm_hello_fail(struct sm_addr *conn, int status)
+{
+    struct sm_hello_reply reply;
+
+    if (status)
+    {
+        memset(&reply, 0, sizeof(reply));
+        reply.magic = SM_MAGIC;
+        reply.status = status;
+        if (send(conn->fd, &reply, sizeof(reply), MSG_NOSIGNAL) < 0)
+        {
+            /* the client finds out anyway */
+        }
+    }
+    epoll_ctl(sm_params.epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    conn->registered = 0;
+    dealloc_sm_method_addr(conn->map);
+}
+
+/* sm_hello()
+ *
+ * answers the hello of a new client with the shared segment for the
+ * connection, and tells BMI about the new address
+ */
+static void sm_hello(struct sm_addr *conn)
+{
+    struct sm_hello hello;
+    struct sm_hello_reply reply;
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    struct msghdr msg;
+    struct iovec iov;
+    union
+    {
+        struct cmsghdr cm;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr *cmsg;
+    struct sm_shared *shm;
+    size_t size;
+    ssize_t ret;
+    int seg_fd;
+
+    ret = recv(conn->fd, &hello, sizeof(hello), MSG_DONTWAIT);
+    if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return;
+    }
+    if (ret != (ssize_t)sizeof(hello) || hello.magic != SM_MAGIC)
+    {
+        sm_hello_fail(conn, 0);
+        return;
+    }
+    if (hello.version != SM_VERSION)
+    {
+        sm_hello_fail(conn, -BMI_EPROTONOSUPPORT);
+        return;
+    }
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    {
+        sm_hello_fail(conn, -BMI_EACCES);
+        return;
+    }
+    conn->peer_pid = cred.pid;
+
+    /* the client may only stand for an address of this host */
+    if (hello.ip)
+    {
+        struct in_addr in;
+        uint32_t ip;
+
+        in.s_addr = hello.ip;
+        if (sm_local_ip(inet_ntoa(in), &ip))
+        {
+            conn->ip = hello.ip;
+        }
+    }
+
+    size = SM_SHARED_HDR_SIZE + 2 * (size_t)SM_RING_SIZE;
+    seg_fd = sm_create_segment(size);
+    if (seg_fd < 0)
+    {
+        gossip_err("Error: bmi_sm: could not create shared segment: %s\n",
+                   strerror(-seg_fd));
+        sm_hello_fail(conn, -BMI_ENOMEM);
+        return;
+    }
+    shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg_fd, 0);
+    if (shm == MAP_FAILED)
+    {
+        close(seg_fd);
+        sm_hello_fail(conn, -BMI_ENOMEM);
+        return;
+    }
+    memset(shm, 0, SM_SHARED_HDR_SIZE);
+    shm->magic = SM_MAGIC;
+    shm->version = SM_VERSION;
+    shm->ring_size = SM_RING_SIZE;
+    sm_conn_map(conn, shm, size, SM_RING_SIZE);
+    conn->cma = sm_cma_probe(conn->peer_pid, hello.probe);
+    shm->cma[SM_SIDE_SERVER] = conn->cma;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = SM_MAGIC;
+    reply.ring_size = SM_RING_SIZE;
+    reply.probe = (uint64_t)(uintptr_t)&sm_probe_word;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    iov.iov_base = &reply;
+    iov.iov_len = sizeof(reply);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &seg_fd, sizeof(int));
+    ret = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+    close(seg_fd);
+    if (ret != (ssize_t)sizeof(reply))
+    {
+        sm_hello_fail(conn, 0);
+        return;
+    }
+
+    snprintf(conn->peer_string, sizeof(conn->peer_string), "sm://pid-%d",
+             (int)conn->peer_pid);
+    conn->state = SM_CONN_UP;
+    qlist_add_tail(&conn->link, &sm_conns);
+    conn->bmi_addr = bmi_method_addr_reg_callback(conn->map);
+
+    gossip_debug(GOSSIP_BMI_DEBUG_SM,
+                 "bmi_sm: new connection from pid %d (cma %d)\n",
+                 (int)conn->peer_pid, conn->cma);
+}
+
+/* sm_post_send_generic()
+ *
+ * does the work common to all sends: copies the message into the ring
+ * right away if it fits and nothing is queued ahead of it, and queues
+ * it otherwise
+ *
+ * returns 0 on success that requires later poll, returns 1 on instant
+ * completion, -errno on failure
+ */
+static int sm_post_send_generic(bmi_op_id_t *id,
+                                bmi_method_addr_p dest,
+                                const void *const *buffer_list,
+                                const bmi_size_t *size_list,
+                                int list_count,
+                                bmi_size_t total_size,
+                                bmi_msg_tag_t tag,
+                                void *user_ptr,
+                                bmi_context_id context_id,
+                                int unexpected)
+{
+    struct sm_addr *conn = dest->method_data;
+    method_op_p op;
+    struct sm_op *sm_op_data;
+    int ret;
+
+    *id = 0;
+    if (total_size > (unexpected ? SM_EAGER_LIMIT : SM_MAX_SIZE))
+    {
+        return -BMI_EMSGSIZE;
+    }
+
+    gen_mutex_lock(&interface_mutex);
+
+    ret = sm_conn_ready(conn);
+    if (ret < 0)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return ret;
+    }
+
+    /* the common case: a small message with nothing ahead of it */
+    if (total_size <= SM_EAGER_LIMIT && qlist_empty(&conn->send_queue))
+    {
+        struct sm_msg hdr;
+        method_op_st tmp_op;
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.type = SM_MSG_EAGER;
+        hdr.len = total_size;
+        hdr.tag = tag;
+        hdr.size = total_size;
+        if (unexpected)
+        {
+            hdr.flags = SM_FLAG_UNEXPECTED;
+        }
+        tmp_op.buffer_list = (void *const *)buffer_list;
+        tmp_op.size_list = size_list;
+        tmp_op.list_count = list_count;
+        if (sm_send_record(conn, &hdr, &tmp_op, 0, NULL))
+        {
+            sm_ring_publish(conn);
+            if (sm_need_wake)
+            {
+                sm_wake();
+            }
+            gen_mutex_unlock(&interface_mutex);
+            return 1;
+        }
+    }
+
+    op = alloc_sm_method_op();
+    if (!op)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return -BMI_ENOMEM;
+    }
+    *id = op->op_id;
+    op->addr = dest;
+    op->send_recv = BMI_SEND;
+    op->user_ptr = user_ptr;
+    op->msg_tag = tag;
+    op->context_id = context_id;
+    op->actual_size = total_size;
+    op->expected_size = total_size;
+    if (list_count == 1)
+    {
+        /* the caller's arrays may be temporary for a single buffer */
+        op->buffer = (void *)buffer_list[0];
+        op->buffer_list = &op->buffer;
+        op->size_list = &op->actual_size;
+    }
+    else
+    {
+        op->buffer_list = (void *const *)buffer_list;
+        op->size_list = size_list;
+    }
+    op->list_count = list_count;
+    sm_op_data = op->method_data;
+    sm_op_data->state = SM_OP_SEND_QUEUED;
+    sm_op_data->unexpected = unexpected;
+    op_list_add(&conn->send_queue, op);
+
+    sm_conn_tx(conn);
+
+    if (sm_op_data->state == SM_OP_COMPLETE && !op->error_code)
+    {
+        /* went out completely; nobody needs to test for it */
+        op_list_remove(op);
+        dealloc_sm_method_op(op);
+        *id = 0;
+        ret = 1;
+    }
+    else
+    {
+        ret = 0;
+    }
+
+    if (sm_need_wake)
+    {
+        sm_wake();
+    }
+    gen_mutex_unlock(&interface_mutex);
+    return ret;
+}
+
+/* sm_post_recv_generic()
+ *
+ * does the work common to all receives: takes a message that already
+ * arrived, or posts the receive for one to come
+ *
+ * returns 0 on success that requires later poll, returns 1 on instant
+ * completion, -errno on failure
+ */
+static int sm_post_recv_generic(bmi_op_id_t *id,
+                                bmi_method_addr_p src,
+                                void *const *buffer_list,
+                                const bmi_size_t *size_list,
+                                int list_count,
+                                bmi_size_t expected_size,
+                                bmi_size_t *actual_size,
+                                bmi_msg_tag_t tag,
+                                void *user_ptr,
+                                bmi_context_id context_id)
+{
+    struct sm_addr *conn = src->method_data;
+    struct op_list_search_key key;
+    method_op_p op, early;
+    struct sm_op *sm_op_data;
+    int ret;
+
+    *id = 0;
+
+    gen_mutex_lock(&interface_mutex);
+
+    ret = sm_conn_ready(conn);
+    if (ret < 0)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return ret;
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.method_addr = src;
+    key.method_addr_yes = 1;
+    key.msg_tag = tag;
+    key.msg_tag_yes = 1;
+    early = op_list_search(&sm_recv_early, &key);
+
+    if (early && early->buffer)
+    {
+        /* a whole small message is waiting */
+        op_list_remove(early);
+        if (early->actual_size > expected_size)
+        {
+            ret = -BMI_EMSGSIZE;
+        }
+        else
+        {
+            method_op_st tmp_op;
+
+            tmp_op.buffer_list = buffer_list;
+            tmp_op.size_list = size_list;
+            tmp_op.list_count = list_count;
+            sm_copy_list(&tmp_op, 0, early->buffer, early->actual_size, 1);
+            *actual_size = early->actual_size;
+            ret = 1;
+        }
+        free(early->buffer);
+        dealloc_sm_method_op(early);
+        gen_mutex_unlock(&interface_mutex);
+        return ret;
+    }
+
+    op = alloc_sm_method_op();
+    if (!op)
+    {
+        gen_mutex_unlock(&interface_mutex);
+        return -BMI_ENOMEM;
+    }
+    *id = op->op_id;
+    op->addr = src;
+    op->send_recv = BMI_RECV;
+    op->user_ptr = user_ptr;
+    op->msg_tag = tag;
+    op->context_id = context_id;
+    op->expected_size = expected_size;
+    if (list_count == 1)
+    {
+        op->buffer = buffer_list[0];
+        op->buffer_list = &op->buffer;
+        op->size_list = &op->expected_size;
+    }
+    else
+    {
+        op->buffer_list = buffer_list;
+        op->size_list = size_list;
+    }
+    op->list_count = list_count;
+    sm_op_data = op->method_data;
+
+    if (early)
+    {
+        /* the sender is waiting with an RTS */
+        struct sm_op *early_data = early->method_data;
+
+        op_list_remove(early);
+        ret = sm_rndv_start(conn, op, early_data->peer_id,
+                            early->actual_size, early_data->iovs,
+                            early_data->iov_count);
+        free(early_data->iovs);
+        dealloc_sm_method_op(early);
+        if (ret == 1 && !op->error_code)
+        {
+            op_list_remove(op);
+            *actual_size = op->actual_size;
+            dealloc_sm_method_op(op);
+            *id = 0;
+        }
+        else
+        {
+            ret = 0;
+        }
+    }
+    else
+    {
+        sm_op_data->state = SM_OP_RECV_POSTED;
+        op_list_add(&sm_recv_posted, op);
+        ret = 0;
+        if (conn->rx_blocked)
+        {
+            /* this may be the receive a streamed message waits for */
+            conn->rx_blocked = 0;
+            sm_conn_rx(conn);
+        }
+    }
+
+    if (sm_need_wake)
+    {
+        sm_wake();
+    }
+    gen_mutex_unlock(&interface_mutex);
+    return ret;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
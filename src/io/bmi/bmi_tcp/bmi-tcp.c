@@ -260,6 +260,10 @@ struct tcp_op
     bmi_size_t size_list_stub;
 };
 
+/* every message posted or received takes one of these */
+static PINT_slab tcp_op_slab =
+    PINT_BMI_OP_SLAB_INITIALIZER("bmi tcp op", struct tcp_op);
+
 /* static io vector for use with readv and writev; we can only use
  * this because BMI serializes module calls
  */
@@ -606,7 +610,7 @@ int BMI_tcp_initialize(bmi_method_addr_p listen_addr,
     {
         if (op_list_array[i])
         {
-            op_list_cleanup(op_list_array[i]);
+            op_list_cleanup_fn(op_list_array[i], dealloc_tcp_method_op);
         }
     }
     if (tcp_socket_collection_p)
@@ -642,7 +646,7 @@ int BMI_tcp_finalize(void)
     {
         if (op_list_array[i])
         {
-            op_list_cleanup(op_list_array[i]);
+            op_list_cleanup_fn(op_list_array[i], dealloc_tcp_method_op);
             op_list_array[i] = NULL;
         }
     }
@@ -1154,6 +1158,11 @@ int BMI_tcp_set_info(int option,
         break;
     }
 
+    case BMI_WAKE_TESTCONTEXT:
+        BMI_socket_collection_wake(tcp_socket_collection_p);
+        ret = 0;
+        break;
+
     default:
 	gossip_ldebug(GOSSIP_BMI_DEBUG_TCP,
                       "TCP hint %d not implemented.\n", option);
@@ -1210,6 +1219,25 @@ int BMI_tcp_get_info(int option,
         ret = 0;
         break;
 
+    case BMI_CHECK_WAKEUP:
+        *((int *) inout_parameter) = 1;
+        ret = 0;
+        break;
+
+#ifdef __PVFS2_USE_EPOLL__
+    case BMI_GET_WAIT_FD:
+        /* the epoll set polls readable when any socket in it is ready */
+        *((int *) inout_parameter) = tcp_socket_collection_p->epfd;
+        ret = 0;
+        break;
+#endif
+
+    case BMI_CHECK_UNEXP_READY:
+        *((int *) inout_parameter) =
+            !op_list_empty(op_list_array[IND_COMPLETE_RECV_UNEXP]);
+        ret = 0;
+        break;
+
     default:
 	gossip_ldebug(GOSSIP_BMI_DEBUG_TCP,
                       "TCP hint %d not implemented.\n", option);
@@ -1849,7 +1877,8 @@ void BMI_tcp_close_context(bmi_context_id context_id)
     gen_mutex_lock(&interface_mutex);
 
     /* tear down completion queue for this context */
-    op_list_cleanup(completion_array[context_id]);
+    op_list_cleanup_fn(completion_array[context_id],
+                       dealloc_tcp_method_op);
 
     gen_mutex_unlock(&interface_mutex);
     return;
@@ -1929,6 +1958,8 @@ int BMI_tcp_cancel(bmi_op_id_t id,
     }
 
     op_list_add(completion_array[query_op->context_id], query_op);
+    /* the testing thread may be blocked on the sockets */
+    BMI_socket_collection_wake(tcp_socket_collection_p);
 
     gen_mutex_unlock(&interface_mutex);
     return (0);
@@ -3078,6 +3109,7 @@ static int tcp_cleanse_addr(bmi_method_addr_p map,
                             int error_code)
 {
     int i = 0;
+    int queued = 0;
     struct op_list_search_key key;
     method_op_p query_op = NULL;
 
@@ -3108,10 +3140,19 @@ static int tcp_cleanse_addr(bmi_method_addr_p map,
 		    op_list_add(completion_array[query_op->context_id], 
                                 query_op);
 		}
+		queued = 1;
 	    }
 	}
     }
 
+    /* this may run outside of tcp_do_work() (e.g. when a post fails),
+     * so make sure a thread blocked on the sockets sees the errors
+     */
+    if (queued)
+    {
+        BMI_socket_collection_wake(tcp_socket_collection_p);
+    }
+
     return (0);
 }
 
@@ -4196,7 +4237,7 @@ static method_op_p alloc_tcp_method_op(void)
 {
     method_op_p my_method_op = NULL;
 
-    my_method_op = bmi_alloc_method_op(sizeof(struct tcp_op));
+    my_method_op = bmi_slab_alloc_method_op(&tcp_op_slab);
 
     /* we trust alloc_method_op to zero it out */
 
@@ -4213,7 +4254,7 @@ static method_op_p alloc_tcp_method_op(void)
  */
 static void dealloc_tcp_method_op(method_op_p old_op)
 {
-    bmi_dealloc_method_op(old_op);
+    bmi_slab_dealloc_method_op(&tcp_op_slab, old_op);
     return;
 }
 
@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "pvfs2-internal.h"
 #include "gossip.h"
@@ -68,6 +69,30 @@ socket_collection_p BMI_socket_collection_init(int new_server_socket)
 
     tmp_scp->server_socket = new_server_socket;
 
+    /* the wake fd is registered with the collection itself as its data
+     * pointer so that testglobal can tell it apart from the sockets
+     */
+    tmp_scp->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if(tmp_scp->wake_fd < 0)
+    {
+        gossip_err("Error: eventfd() failure: %s.\n", strerror(errno));
+        close(tmp_scp->epfd);
+        free(tmp_scp);
+        return(NULL);
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = tmp_scp;
+    ret = epoll_ctl(tmp_scp->epfd, EPOLL_CTL_ADD, tmp_scp->wake_fd, &event);
+    if(ret < 0)
+    {
+        gossip_err("Error: epoll_ctl() failure: %s.\n", strerror(errno));
+        close(tmp_scp->wake_fd);
+        close(tmp_scp->epfd);
+        free(tmp_scp);
+        return(NULL);
+    }
+
     if(new_server_socket > -1)
     {
         memset(&event, 0, sizeof(event));
@@ -78,6 +103,8 @@ socket_collection_p BMI_socket_collection_init(int new_server_socket)
         if(ret < 0 && errno != EEXIST)
         {
             gossip_err("Error: epoll_ctl() failure: %s.\n", strerror(errno));
+            close(tmp_scp->wake_fd);
+            close(tmp_scp->epfd);
             free(tmp_scp);
             return(NULL);
         }
@@ -96,10 +123,32 @@ socket_collection_p BMI_socket_collection_init(int new_server_socket)
  */
 void BMI_socket_collection_finalize(socket_collection_p scp)
 {
+    close(scp->wake_fd);
+    close(scp->epfd);
     free(scp);
     return;
 }
 
+/* socket_collection_wake()
+ *
+ * makes a testglobal call that is blocked in epoll_wait(), or the next
+ * one to start, return right away
+ *
+ * no return values.
+ */
+void BMI_socket_collection_wake(socket_collection_p scp)
+{
+    uint64_t one = 1;
+
+    /* the only possible failure is a counter already full of pending
+     * wakeups, which is as good as success
+     */
+    if(write(scp->wake_fd, &one, sizeof(one)) < 0)
+    {
+        return;
+    }
+}
+
 
 /* socket_collection_testglobal()
  *
@@ -165,6 +214,17 @@ int BMI_socket_collection_testglobal(socket_collection_p scp,
     {
         assert(scp->event_array[i].events);
 
+        if(scp->event_array[i].data.ptr == scp)
+        {
+            /* someone just wanted us to return; clear the counter */
+            uint64_t count;
+            if(read(scp->wake_fd, &count, sizeof(count)) < 0)
+            {
+                /* already cleared by another pass */
+            }
+            continue;
+        }
+
         if(scp->event_array[i].events & ERRMASK)
             status[*outcount] |= SC_ERROR_BIT;
         if(scp->event_array[i].events & POLLIN)
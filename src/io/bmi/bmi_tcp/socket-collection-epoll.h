@@ -31,7 +31,8 @@
 struct socket_collection
 {
     int epfd;
-    
+    int wake_fd;    /* eventfd used to interrupt epoll_wait() */
+
     struct epoll_event event_array[BMI_EPOLL_MAX_PER_CYCLE];
 
     int server_socket;
@@ -135,6 +136,7 @@ do { \
 } while(0)
 
 void BMI_socket_collection_finalize(socket_collection_p scp);
+void BMI_socket_collection_wake(socket_collection_p scp);
 int BMI_socket_collection_testglobal(socket_collection_p scp,
 				 int incount,
 				 int *outcount,
@@ -101,6 +101,13 @@ do { \
     write(s->pipe_fd[1], &c, 1);\
 } while(0)
 
+/* make a poll that is idling (or the next one) return right away */
+#define BMI_socket_collection_wake(s) \
+do { \
+    char c = 0;\
+    write((s)->pipe_fd[1], &c, 1);\
+} while(0)
+
 void BMI_socket_collection_finalize(socket_collection_p scp);
 int BMI_socket_collection_testglobal(socket_collection_p scp,
 				 int incount,
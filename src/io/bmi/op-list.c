@@ -122,6 +122,20 @@ void op_list_add(op_list_p olp,
  * no return values
  */
 void op_list_cleanup(op_list_p olp)
+{
+    op_list_cleanup_fn(olp, bmi_dealloc_method_op);
+}
+
+/*
+ * op_list_cleanup_fn()
+ *
+ * like op_list_cleanup(), but hands each operation to dealloc_fn; for
+ * methods that do not allocate their operations with
+ * bmi_alloc_method_op()
+ *
+ * no return values
+ */
+void op_list_cleanup_fn(op_list_p olp, void (*dealloc_fn)(method_op_p))
 {
     op_list_p iterator = NULL;
     op_list_p scratch = NULL;
@@ -131,7 +145,7 @@ void op_list_cleanup(op_list_p olp)
     {
 	tmp_method_op = qlist_entry(iterator, struct method_op,
 				    op_list_entry);
-	bmi_dealloc_method_op(tmp_method_op);
+	dealloc_fn(tmp_method_op);
     }
     free(olp);
     olp = NULL;
@@ -40,6 +40,7 @@ op_list_p op_list_new(void);
 void op_list_add(op_list_p olp,
 		 method_op_p oip);
 void op_list_cleanup(op_list_p olp);
+void op_list_cleanup_fn(op_list_p olp, void (*dealloc_fn)(method_op_p));
 void op_list_remove(method_op_p oip);
 void op_list_dump(op_list_p olp);
 int op_list_empty(op_list_p olp);
@@ -213,6 +213,131 @@ int PINT_dist_strips_parse(
     }
 }
 
+/*
+ * parse hint into a table for the offset mapping functions
+ */
+int PINT_dist_strips_table_parse(
+    const char *input, PINT_dist_strips_table **table)
+{
+    PINT_dist_strips *strips;
+    PINT_dist_strips_table *t;
+    unsigned int count, server_ct = 0, i, s;
+    size_t len;
+    char *p;
+
+    *table = NULL;
+
+    if (PINT_dist_strips_parse(input, &strips, &count) == -1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (strips[i].server_nr >= server_ct)
+        {
+            server_ct = strips[i].server_nr + 1;
+        }
+    }
+    if (server_ct > count)
+    {
+        /* some server number below the highest one has no strip */
+        gossip_err("ERROR in varstrip distribution: The strip "
+                   "partitioning string must contain all data "
+                   "file numbers from 0 to the highest one specified!\n");
+        PINT_dist_strips_free_mem(&strips);
+        return -1;
+    }
+
+    /* one block for the table and all its arrays */
+    len = sizeof(*t) + count * sizeof(PINT_dist_strips) +
+        count * sizeof(PVFS_offset) + server_ct * sizeof(PVFS_size) +
+        (server_ct + 1) * sizeof(unsigned int) + count * sizeof(unsigned int);
+    t = malloc(len);
+    if (!t)
+    {
+        PINT_dist_strips_free_mem(&strips);
+        return -1;
+    }
+    p = (char *)t + sizeof(*t);
+    t->strips = (PINT_dist_strips *)p;
+    p += count * sizeof(PINT_dist_strips);
+    t->physical = (PVFS_offset *)p;
+    p += count * sizeof(PVFS_offset);
+    t->server_size = (PVFS_size *)p;
+    p += server_ct * sizeof(PVFS_size);
+    t->server_first = (unsigned int *)p;
+    p += (server_ct + 1) * sizeof(unsigned int);
+    t->by_server = (unsigned int *)p;
+
+    strcpy(t->input, input);
+    t->count = count;
+    t->server_ct = server_ct;
+    memcpy(t->strips, strips, count * sizeof(PINT_dist_strips));
+    PINT_dist_strips_free_mem(&strips);
+
+    t->stripe_size = t->strips[count - 1].offset + t->strips[count - 1].size;
+
+    /* count strips per server, and where each one starts in a stripe */
+    memset(t->server_size, 0, server_ct * sizeof(PVFS_size));
+    memset(t->server_first, 0, (server_ct + 1) * sizeof(unsigned int));
+    for (i = 0; i < count; i++)
+    {
+        s = t->strips[i].server_nr;
+        t->physical[i] = t->server_size[s];
+        t->server_size[s] += t->strips[i].size;
+        t->server_first[s + 1]++;
+    }
+    for (s = 0; s < server_ct; s++)
+    {
+        t->server_first[s + 1] += t->server_first[s];
+    }
+
+    /* group the strips by server, keeping them in offset order */
+    for (i = 0; i < count; i++)
+    {
+        s = t->strips[i].server_nr;
+        t->by_server[t->server_first[s]++] = i;
+    }
+    for (s = server_ct; s > 0; s--)
+    {
+        t->server_first[s] = t->server_first[s - 1];
+    }
+    t->server_first[0] = 0;
+
+    *table = t;
+    return 0;
+}
+
+void PINT_dist_strips_table_free(PINT_dist_strips_table *table)
+{
+    free(table);
+}
+
+/*
+ * returns the index of the strip that holds offset_in_stripe, which must
+ * be less than the stripe size
+ */
+unsigned int PINT_dist_strips_table_find(
+    const PINT_dist_strips_table *table, PVFS_offset offset_in_stripe)
+{
+    unsigned int lo = 0, hi = table->count - 1, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (table->strips[mid].offset <= offset_in_stripe)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
 /*
  * Local variables:
  *  mode: c
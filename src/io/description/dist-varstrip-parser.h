@@ -9,6 +9,7 @@
 
 #include "pvfs2-internal.h"
 #include "pvfs2-types.h"
+#include "pvfs2-dist-varstrip.h"
 
 struct PINT_dist_strips_s
 {
@@ -19,10 +20,37 @@ struct PINT_dist_strips_s
 
 typedef struct PINT_dist_strips_s PINT_dist_strips;
 
+/*
+ * strips parameter in the form the offset mapping works on: the strips in
+ * stripe order, each with the number of bytes its server holds in front of
+ * it in a stripe, plus for every server the indexes of its strips.  Both
+ * orders are sorted, so lookups are binary searches.
+ */
+struct PINT_dist_strips_table_s
+{
+    char input[PVFS_DIST_VARSTRIP_MAX_STRIPS_STRING_LENGTH];
+    unsigned int count;          /* number of strips */
+    unsigned int server_ct;      /* highest server number + 1 */
+    PVFS_size stripe_size;       /* size of all strips */
+    PINT_dist_strips *strips;    /* count strips, by offset */
+    PVFS_offset *physical;       /* per strip: its server's bytes before it */
+    PVFS_size *server_size;      /* per server: its bytes in a stripe */
+    unsigned int *server_first;  /* per server + 1: index into by_server */
+    unsigned int *by_server;     /* strip indexes grouped by server */
+};
+
+typedef struct PINT_dist_strips_table_s PINT_dist_strips_table;
+
 void PINT_dist_strips_free_mem(PINT_dist_strips **strip);
 int PINT_dist_strips_parse(
     const char *input, PINT_dist_strips **strip, unsigned *count);
 
+int PINT_dist_strips_table_parse(
+    const char *input, PINT_dist_strips_table **table);
+void PINT_dist_strips_table_free(PINT_dist_strips_table *table);
+unsigned int PINT_dist_strips_table_find(
+    const PINT_dist_strips_table *table, PVFS_offset offset_in_stripe);
+
 #endif
 
 /*
@@ -16,274 +16,296 @@
 #include "pvfs2-internal.h"
 #include "pvfs2-debug.h"
 #include "gossip.h"
+#include "gen-locks.h"
+
+/*
+ * The distribution keeps the strips string it is given together with the
+ * table parsed from it, so that the mapping functions, which run for every
+ * piece of every request, do not parse the string again.  Tables are
+ * shared by all the parameters with the same string and stay until the
+ * distribution is unregistered; only the string is encoded.
+ */
+struct varstrip_params
+{
+    PVFS_varstrip_params p;
+    const PINT_dist_strips_table *table;
+};
+
+/* distinct strips strings kept parsed; beyond that they are parsed on use */
+#define VARSTRIP_MAX_TABLES 256
+
+static PINT_dist_strips_table *varstrip_tables[VARSTRIP_MAX_TABLES];
+static int varstrip_table_count = 0;
+static gen_mutex_t varstrip_table_mutex = GEN_MUTEX_INITIALIZER;
+
+/* returns the shared table for strips, or NULL if there is none */
+static const PINT_dist_strips_table *varstrip_table_lookup(const char *strips)
+{
+    PINT_dist_strips_table *table = NULL;
+    int i;
+
+    if (strips[0] == '\0')
+    {
+        return NULL;
+    }
+
+    gen_mutex_lock(&varstrip_table_mutex);
+    for (i = 0; i < varstrip_table_count; i++)
+    {
+        if (strcmp(varstrip_tables[i]->input, strips) == 0)
+        {
+            table = varstrip_tables[i];
+            break;
+        }
+    }
+    if (!table && varstrip_table_count < VARSTRIP_MAX_TABLES &&
+        PINT_dist_strips_table_parse(strips, &table) == 0)
+    {
+        varstrip_tables[varstrip_table_count++] = table;
+    }
+    gen_mutex_unlock(&varstrip_table_mutex);
+    return table;
+}
+
+/* returns the table for params; one that had to be parsed for this call
+ * only is also returned in *tmp, to be freed by the caller
+ */
+static const PINT_dist_strips_table *varstrip_get_table(
+    void *params, PINT_dist_strips_table **tmp)
+{
+    struct varstrip_params *vp = (struct varstrip_params *)params;
+
+    *tmp = NULL;
+    if (vp->table)
+    {
+        return vp->table;
+    }
+    if (PINT_dist_strips_table_parse(vp->p.strips, tmp) == -1)
+    {
+        return NULL;
+    }
+    return *tmp;
+}
+
+/* returns the position in by_server of the first strip of server_nr that
+ * comes after strip ii, or server_first[server_nr + 1] if there is none
+ */
+static unsigned int varstrip_next_own(const PINT_dist_strips_table *t,
+                                      uint32_t server_nr,
+                                      unsigned int ii)
+{
+    unsigned int lo = t->server_first[server_nr];
+    unsigned int hi = t->server_first[server_nr + 1];
+    unsigned int mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (t->by_server[mid] <= ii)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* returns the strip of server_nr holding offset_in_stripe of the bytes it
+ * keeps for one stripe
+ */
+static unsigned int varstrip_find_own(const PINT_dist_strips_table *t,
+                                      uint32_t server_nr,
+                                      PVFS_offset offset_in_stripe)
+{
+    unsigned int lo = t->server_first[server_nr];
+    unsigned int hi = t->server_first[server_nr + 1] - 1;
+    unsigned int mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (t->physical[t->by_server[mid]] <= offset_in_stripe)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return t->by_server[lo];
+}
 
 static PVFS_offset logical_to_physical_offset(void* params,
                                               PINT_request_file_data* fd,
                                               PVFS_offset logical_offset)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
-    /* parse parameter */
-    PINT_dist_strips *strips;
-    uint32_t ui_count, ii, ui_stripe_nr;
-    PVFS_size ui_stripe_size;
-    int32_t server_nr = fd->server_nr;
-    
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
+    uint32_t server_nr = fd->server_nr;
+    PVFS_offset stripe_nr, offset_in_stripe, physical_offset;
+    unsigned int ii, kk;
+
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         return -1;
     }
-    
-    /* stripe size */
-    ui_stripe_size = strips[ui_count - 1].offset + 
-        strips[ui_count - 1].size;
-    ui_stripe_nr = logical_offset / ui_stripe_size;
-    /* search my strips */
-    for(ii = 0; ii < ui_count; ii++)
+    if (server_nr >= t->server_ct)
+    {
+        /* nothing of the file is on this server */
+        PINT_dist_strips_table_free(tmp);
+        return 0;
+    }
+
+    stripe_nr = logical_offset / t->stripe_size;
+    offset_in_stripe = logical_offset - stripe_nr * t->stripe_size;
+    ii = PINT_dist_strips_table_find(t, offset_in_stripe);
+
+    physical_offset = stripe_nr * t->server_size[server_nr];
+    if (t->strips[ii].server_nr == server_nr)
+    {
+        physical_offset += t->physical[ii] +
+            offset_in_stripe - t->strips[ii].offset;
+    }
+    else
     {
-        if (strips[ii].server_nr == server_nr)
+        /* not ours: the offset maps to the end of what we hold before it */
+        kk = varstrip_next_own(t, server_nr, ii);
+        if (kk < t->server_first[server_nr + 1])
         {
-            if ((logical_offset >= (ui_stripe_nr * ui_stripe_size) + 
-                                   strips[ii].offset) &&
-                (logical_offset <= (ui_stripe_nr * ui_stripe_size) + 
-                                   strips[ii].offset + strips[ii].size - 1))
-            {
-                unsigned int jj;
-                PVFS_offset ui_offset_in_strips;
-                
-                /* get size of all strips in the stripe of this server */
-                /* and get the size of all strips of this server that are */
-                /* before the current Strips */
-                PVFS_size ui_size_of_all_my_strips_in_stripe = 0;
-                PVFS_size ui_size_of_my_strips_before_current = 0;
-                for (jj = 0; jj < ui_count; jj++)
-                {
-                    if (strips[jj].server_nr == server_nr)
-                    {
-                        ui_size_of_all_my_strips_in_stripe += strips[jj].size;
-                        if (jj < ii)
-                        {
-                            ui_size_of_my_strips_before_current += 
-                                strips[jj].size;
-                        }
-                    }
-                }
-                
-                ui_offset_in_strips = logical_offset - 
-                    (ui_stripe_nr * ui_stripe_size) - strips[ii].offset;
-                
-                PINT_dist_strips_free_mem(&strips);
-                return ui_stripe_nr * ui_size_of_all_my_strips_in_stripe + 
-                       ui_size_of_my_strips_before_current + 
-                       ui_offset_in_strips;
-            }
+            physical_offset += t->physical[t->by_server[kk]];
+        }
+        else
+        {
+            physical_offset += t->server_size[server_nr];
         }
-        /* try next */
     }
-    gossip_err("logical_to_physical: todo\n");
-    /*
-     * todo: logical offsets that do not belong to the current server
-     *       I dont know if it is really neccessary to implement this.
-     *       In practice I have never seen this error string.
-     */
-    PINT_dist_strips_free_mem(&strips);
-    return 0;
+
+    PINT_dist_strips_table_free(tmp);
+    return physical_offset;
 }
 
 static PVFS_offset physical_to_logical_offset(void* params,
                                               PINT_request_file_data* fd,
                                               PVFS_offset physical_offset)
 {
-    /* parse parameter */
-    PINT_dist_strips *strips;
-    unsigned int ui_count, jj, ui_stripe_nr, ii;
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
     uint32_t server_nr = fd->server_nr;
-    PVFS_size ui_size_of_strips_in_stripe = 0;
-    PVFS_offset ui_physical_offset_in_stripe;
-    PVFS_offset ui_offset_in_stripe = 0;
-
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
+    PVFS_offset stripe_nr, offset_in_stripe, logical_offset;
+    unsigned int ii;
 
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         return -1;
     }
-
-    /* to what stripe belongs that physical offset? */
-    /* must get size of strips of this server in one stripe first */
-    for (jj = 0; jj < ui_count; jj++)
+    if (server_nr >= t->server_ct || t->server_size[server_nr] == 0)
     {
-        if (strips[jj].server_nr == server_nr)
-        {
-            ui_size_of_strips_in_stripe += strips[jj].size;
-        }
+        gossip_err("ERROR in varstrip distribution in "
+                   "function physical_to_logical: no fitting strip found!\n");
+        PINT_dist_strips_table_free(tmp);
+        return -1;
     }
-    ui_stripe_nr = physical_offset / ui_size_of_strips_in_stripe;
 
-    /* now get the Strips number in the 
-     * stripe the physical offset belongs to */
-    ui_physical_offset_in_stripe = 
-        physical_offset - ui_stripe_nr * ui_size_of_strips_in_stripe;
-    for(ii = 0; ii < ui_count; ii++)
-    {
-        if (strips[ii].server_nr == server_nr)
-        {
-            if (ui_physical_offset_in_stripe < 
-                ui_offset_in_stripe + strips[ii].size)
-            {
-                /* found! */
-                PVFS_offset logical_offset = ui_stripe_nr * 
-                    (strips[ui_count - 1].offset + strips[ui_count - 1].size) + 
-                    strips[ii].offset + 
-                    (ui_physical_offset_in_stripe - ui_offset_in_stripe);
-                PINT_dist_strips_free_mem(&strips);
-                return logical_offset;
-            }
-            else
-            {
-                ui_offset_in_stripe += strips[ii].size;
-            }
-        }
-        /* try next */
-    }
-    /* error! */
-    gossip_err("ERROR in varstrip distribution in "
-               "function physical_to_logical: no fitting strip found!\n");
-    PINT_dist_strips_free_mem(&strips);
-    return -1;
+    stripe_nr = physical_offset / t->server_size[server_nr];
+    offset_in_stripe = physical_offset -
+        stripe_nr * t->server_size[server_nr];
+    ii = varstrip_find_own(t, server_nr, offset_in_stripe);
+
+    logical_offset = stripe_nr * t->stripe_size + t->strips[ii].offset +
+        offset_in_stripe - t->physical[ii];
+
+    PINT_dist_strips_table_free(tmp);
+    return logical_offset;
 }
 
 static PVFS_offset next_mapped_offset(void* params,
                                       PINT_request_file_data* fd,
                                       PVFS_offset logical_offset)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
-    /* parse parameter */
-    PINT_dist_strips *strips;
-    unsigned int ui_count, ii, ui_stripe_nr;
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
     uint32_t server_nr = fd->server_nr;
-    PVFS_size ui_stripe_size;
-    PVFS_offset ui_offset_in_stripe;
+    PVFS_offset stripe_nr, offset_in_stripe, next_offset;
+    unsigned int ii, kk;
 
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         return -1;
     }
-
-    /* get number of stripes */
-    ui_stripe_size = 
-        strips[ui_count - 1].offset +
-        strips[ui_count - 1].size;
-    ui_stripe_nr = logical_offset / ui_stripe_size;
-
-    /* get offset in stripe */
-    ui_offset_in_stripe = 
-        logical_offset - (ui_stripe_nr * ui_stripe_size);
-
-    /* get Strips number */
-    ii = 0;
-    for(ii = 0; ii < ui_count; ii++)
+    if (server_nr >= t->server_ct || t->server_size[server_nr] == 0)
     {
-        if ((ui_offset_in_stripe >= strips[ii].offset) &&
-            (ui_offset_in_stripe <= strips[ii].offset + strips[ii].size - 1))
-        {
-            /* found! */
-            break;
-        }
+        PINT_dist_strips_table_free(tmp);
+        gossip_err("ERROR in varstrip distribution in "
+                   "next_mapped_offset: Did not find my next offset\n");
+        return -1;
     }
-    if (strips[ii].server_nr == server_nr)
+
+    stripe_nr = logical_offset / t->stripe_size;
+    offset_in_stripe = logical_offset - stripe_nr * t->stripe_size;
+    ii = PINT_dist_strips_table_find(t, offset_in_stripe);
+
+    if (t->strips[ii].server_nr == server_nr)
     {
-        /* logical offset is part of my Strips */
-        PINT_dist_strips_free_mem(&strips);
-        return logical_offset;
+        /* logical offset is part of my strips */
+        next_offset = logical_offset;
     }
     else
     {
-        /* search my next Strips */
-        unsigned int jj;
-        for (jj = ii + 1; jj < ui_count; jj++)
+        /* my next strip in this stripe, or my first one in the next */
+        kk = varstrip_next_own(t, server_nr, ii);
+        if (kk == t->server_first[server_nr + 1])
         {
-            if (strips[jj].server_nr == server_nr)
-            {
-                /* found! */
-                PVFS_offset ui_next_mapped_offset = 
-                    ui_stripe_nr * ui_stripe_size + strips[jj].offset;
-                PINT_dist_strips_free_mem(&strips);
-                return ui_next_mapped_offset;
-            }
-        }
-        /* not found! */
-        /* -> next stripe */
-        ui_stripe_nr++;
-        for (jj = 0; jj < ui_count; jj++)
-        {
-            if (strips[jj].server_nr == server_nr)
-            {
-                PVFS_offset ui_next_mapped_offset = 
-                    ui_stripe_nr * ui_stripe_size + strips[jj].offset;
-                PINT_dist_strips_free_mem(&strips);
-                return ui_next_mapped_offset;
-            }
+            kk = t->server_first[server_nr];
+            stripe_nr++;
         }
+        next_offset = stripe_nr * t->stripe_size +
+            t->strips[t->by_server[kk]].offset;
     }
-    /* huh? this is an error */
-    PINT_dist_strips_free_mem(&strips);
-    gossip_err("ERROR in varstrip distribution in "
-               "next_mapped_offset: Did not find my next offset\n");
-    return -1;
+
+    PINT_dist_strips_table_free(tmp);
+    return next_offset;
 }
 
 static PVFS_size contiguous_length(void* params,
                                    PINT_request_file_data* fd,
                                    PVFS_offset physical_offset)
 {
-    PVFS_varstrip_params* varstrip_params;
-    /* convert to a logical offset */
-     
-    /* parse parameter */
-    PINT_dist_strips *strips;
-    PVFS_offset ui_offset_in_stripe, logical_offset;
-    unsigned int ui_count, ii, ui_stripe_nr;
-    PVFS_size ui_stripe_size;
-
-    logical_offset = physical_to_logical_offset(
-        params, fd, physical_offset);
-    
-    varstrip_params = (PVFS_varstrip_params*)params;
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
+    uint32_t server_nr = fd->server_nr;
+    PVFS_offset stripe_nr, offset_in_stripe;
+    PVFS_size length;
+    unsigned int ii;
 
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         return -1;
     }
-
-    /* get number of stripes */
-    ui_stripe_size = strips[ui_count - 1].offset +
-        strips[ui_count - 1].size;
-    ui_stripe_nr = logical_offset / ui_stripe_size;
-    /* get offset in stripe */
-    ui_offset_in_stripe = logical_offset - (ui_stripe_nr * ui_stripe_size);
-    /* get Strips */
-    for(ii = 0; ii < ui_count; ii++)
+    if (server_nr >= t->server_ct || t->server_size[server_nr] == 0)
     {
-        if ((ui_offset_in_stripe >= strips[ii].offset) &&
-            (ui_offset_in_stripe <= strips[ii].offset + strips[ii].size - 1))
-        {
-            /* found! */
-            PVFS_size ui_contiguous_length = strips[ii].offset + 
-                strips[ii].size - ui_offset_in_stripe;
-            PINT_dist_strips_free_mem(&strips);
-            
-            return ui_contiguous_length;
-        }
+        gossip_err("ERROR in varstrip distribution in "
+                   "function contiguous_length: no fitting strip found\n");
+        PINT_dist_strips_table_free(tmp);
+        return 0;
     }
-    /* error! */
-    gossip_err("ERROR in varstrip distribution in "
-               "function contiguous_length: no fitting strip found\n");
-    PINT_dist_strips_free_mem(&strips);
-    return 0;
+
+    /* the rest of the strip the physical offset is in */
+    stripe_nr = physical_offset / t->server_size[server_nr];
+    offset_in_stripe = physical_offset -
+        stripe_nr * t->server_size[server_nr];
+    ii = varstrip_find_own(t, server_nr, offset_in_stripe);
+    length = t->strips[ii].size - (offset_in_stripe - t->physical[ii]);
+
+    PINT_dist_strips_table_free(tmp);
+    return length;
 }
 
 static PVFS_size logical_file_size(void* params,
@@ -306,57 +328,38 @@ static int get_num_dfiles(void* params,
                           uint32_t num_servers_requested,
                           uint32_t num_dfiles_requested)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
-    /* parse parameter */
-    PINT_dist_strips *strips;
-    unsigned int i_highest_data_file_number = 0;
-    unsigned int ii, ui_count;
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
+    unsigned int ii, server_ct;
 
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         /* error */
         return -1;
     }
-    /* get highest requested data file number */
-    for (ii = 0; ii < ui_count; ii++)
-    {
-        if (strips[ii].server_nr > i_highest_data_file_number)
-        {
-            i_highest_data_file_number = strips[ii].server_nr;
-        }
-    }
+    server_ct = t->server_ct;
     /* are all data file numbers available in string? */
-    for (ii = 0; ii < i_highest_data_file_number; ii++)
+    for (ii = 0; ii < server_ct; ii++)
     {
-        int b_found = 0;
-        unsigned int jj;
-        for (jj = 0; jj < ui_count; jj++)
-        {
-            if (strips[jj].server_nr == ii)
-            {
-                b_found = 1;
-                break;
-            }
-        }
-        if (!b_found)
+        if (t->server_size[ii] == 0)
         {
             gossip_err("ERROR in varstrip distribution: The strip "
                        "partitioning string must contain all data "
                        "file numbers from 0 to the highest one specified!\n");
+            PINT_dist_strips_table_free(tmp);
             return -1;
         }
     }
-    PINT_dist_strips_free_mem(&strips);
-    i_highest_data_file_number++;
-    if (i_highest_data_file_number > num_servers_requested)
+    PINT_dist_strips_table_free(tmp);
+    if (server_ct > num_servers_requested)
     {
         gossip_err("ERROR in varstrip distribution: There are more "
                    "data files specified in strip partitioning string "
                    "than servers available!\n");
         return -1;
     }
-    return i_highest_data_file_number;
+    return server_ct;
 }
 
 /* its like the default one but assures that last character is \0
@@ -365,7 +368,8 @@ static int get_num_dfiles(void* params,
 static int set_param(const char* dist_name, void* params,
                     const char* param_name, void* value)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
+    struct varstrip_params* vp = (struct varstrip_params*)params;
+    PVFS_varstrip_params* varstrip_params = &vp->p;
     if (strcmp(param_name, "strips") == 0)
     {
         if (strlen((char *)value) == 0)
@@ -382,6 +386,7 @@ static int set_param(const char* dist_name, void* params,
             else
             {
                 strcpy(varstrip_params->strips, (char *)value);
+                vp->table = varstrip_table_lookup(varstrip_params->strips);
             }
         }
     }
@@ -397,8 +402,9 @@ static void encode_params(char **pptr, void* params)
 
 static void decode_params(char **pptr, void* params)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
-    decode_here_string(pptr, varstrip_params->strips);
+    struct varstrip_params* vp = (struct varstrip_params*)params;
+    decode_here_string(pptr, vp->p.strips);
+    vp->table = varstrip_table_lookup(vp->p.strips);
 }
 
 static void registration_init(void* params)
@@ -409,7 +415,18 @@ static void registration_init(void* params)
 
 static void unregister(void)
 {
+    int i;
+
     PINT_dist_unregister_param(PVFS_DIST_VARSTRIP_NAME, "strips");
+
+    gen_mutex_lock(&varstrip_table_mutex);
+    for (i = 0; i < varstrip_table_count; i++)
+    {
+        PINT_dist_strips_table_free(varstrip_tables[i]);
+        varstrip_tables[i] = NULL;
+    }
+    varstrip_table_count = 0;
+    gen_mutex_unlock(&varstrip_table_mutex);
 }
 
 static char *params_string(void *params)
@@ -421,26 +438,25 @@ static char *params_string(void *params)
 
 static PVFS_size get_blksize(void* params, int dfile_count)
 {
-    PVFS_varstrip_params* varstrip_params = (PVFS_varstrip_params*)params;
-    PINT_dist_strips *strips;
-    uint32_t ui_count;
+    PINT_dist_strips_table *tmp;
+    const PINT_dist_strips_table *t;
     PVFS_size blksize;
 
-    if (PINT_dist_strips_parse(
-            varstrip_params->strips, &strips, &ui_count) == -1)
+    t = varstrip_get_table(params, &tmp);
+    if (!t)
     {
         return -1;
     }
  
     /* report the first strip size in the set as the block size */
-    blksize = strips[0].size;
+    blksize = t->strips[0].size;
 
-    PINT_dist_strips_free_mem(&strips);
+    PINT_dist_strips_table_free(tmp);
 
     return(blksize);
 }
 
-static PVFS_varstrip_params varstrip_params = { "\0" };
+static struct varstrip_params varstrip_params = { { "\0" }, NULL };
 
 static PINT_dist_methods varstrip_methods = {
     logical_to_physical_offset,
@@ -462,7 +478,7 @@ static PINT_dist_methods varstrip_methods = {
 PINT_dist varstrip_dist = {
     PVFS_DIST_VARSTRIP_NAME,
     roundup8(PVFS_DIST_VARSTRIP_NAME_SIZE), /* name size */
-    roundup8(sizeof(PVFS_varstrip_params)), /* param size */
+    roundup8(sizeof(struct varstrip_params)), /* param size */
     &varstrip_params,
     &varstrip_methods
 };
@@ -470,7 +486,7 @@ PINT_dist varstrip_dist = {
 PINT_dist varstrip_dist = {
     .dist_name = PVFS_DIST_VARSTRIP_NAME,
     .name_size = roundup8(PVFS_DIST_VARSTRIP_NAME_SIZE), /* name size */
-    .param_size = roundup8(sizeof(PVFS_varstrip_params)), /* param size */
+    .param_size = roundup8(sizeof(struct varstrip_params)), /* param size */
     .params = &varstrip_params,
     .methods = &varstrip_methods
 };
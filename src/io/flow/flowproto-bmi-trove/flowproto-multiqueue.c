@@ -23,6 +23,9 @@
 #include "thread-mgr.h"
 #include "pint-perf-counter.h"
 #include "pvfs2-internal.h"
+#ifdef __PVFS2_TROVE_SUPPORT__
+#include "src/io/flow/flowproto-bmi-trove/write-agg.h"
+#endif
 
 /* the following buffer settings are used by default if none are specified in
  * the flow descriptor
@@ -49,6 +52,7 @@ do {                                                                  \
 struct result_chain_entry
 {
     PVFS_id_gen_t posted_id;
+    int aggregated;    /* write held by write aggregation, no posted_id */
     char *buffer_offset;
     PINT_Request_result result;
     PVFS_size size_list[MAX_REGIONS];
@@ -326,6 +330,14 @@ int fp_multiqueue_initialize(int flowproto_id)
         return(ret);
     }
     PINT_thread_mgr_trove_getcontext(&global_trove_context);
+
+    ret = PINT_write_agg_initialize(global_trove_context);
+    if(ret < 0)
+    {
+        PINT_thread_mgr_trove_stop();
+        PINT_thread_mgr_bmi_stop();
+        return(ret);
+    }
 #endif
 
     return(0);
@@ -346,6 +358,7 @@ int fp_multiqueue_finalize(void)
         struct qlist_head *tmp_link = NULL, *scratch_link = NULL;
 
         PINT_thread_mgr_trove_stop();
+        PINT_write_agg_finalize();
 
         gen_mutex_lock(&id_sync_mode_mutex);
         qlist_for_each_safe(tmp_link, scratch_link, &s_id_sync_mode_list)
@@ -446,6 +459,26 @@ int fp_multiqueue_setinfo(flow_descriptor *flow_d,
             }
         }
         break;
+
+        case FLOWPROTO_WRITE_AGG_SIZE:
+        {
+            TROVE_coll_id coll_id = 0;
+            long long size = 0;
+
+            assert(parameter && strlen(parameter));
+            sscanf((const char *)parameter, "%d,%lld", &coll_id, &size);
+            ret = PINT_write_agg_set_size(coll_id, size);
+        }
+        break;
+
+        case FLOWPROTO_WRITE_AGG_FLUSH:
+        {
+            PVFS_object_ref *ref = parameter;
+
+            PINT_write_agg_flush(ref->fs_id, ref->handle);
+            ret = 0;
+        }
+        break;
 #endif
         default:
             break;
@@ -762,7 +795,7 @@ static void bmi_recv_callback_fn(void *user_ptr,
                 q_item->parent->dest.u.trove.coll_id);
         }
 
-        ret = trove_bstream_write_list(
+        ret = PINT_write_agg_post(
             q_item->parent->dest.u.trove.coll_id,
             q_item->parent->dest.u.trove.handle,
             (char**)&result_tmp->buffer_offset,
@@ -773,11 +806,10 @@ static void bmi_recv_callback_fn(void *user_ptr,
             result_tmp->result.segs,
             &q_item->out_size,
             sync_mode,
-            NULL,
             &result_tmp->trove_callback,
-            global_trove_context,
             &result_tmp->posted_id,
             q_item->parent->hints);
+        result_tmp->aggregated = (ret == 0 && !result_tmp->posted_id);
 
         result_tmp = result_tmp->next;
 
@@ -1364,6 +1396,7 @@ static void trove_write_callback_fn(void *user_ptr, PVFS_error error_code)
         error_code, flow_data->parent);
 
     result_tmp->posted_id = 0;
+    result_tmp->aggregated = 0;
 
     if(error_code != 0 || flow_data->parent->error_code != 0)
     {
@@ -2219,6 +2252,11 @@ static int cancel_pending_trove(struct qlist_head *list, TROVE_coll_id coll_id)
                                "failed, proceeding anyway.\n");
                 }
             }
+            else if(old_result_tmp->aggregated)
+            {
+                /* can't be canceled, but its callback will come */
+                count++;
+            }
         }while(result_tmp);
     }
     return (count);
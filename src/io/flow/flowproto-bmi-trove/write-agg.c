@@ -0,0 +1,889 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Write aggregation for the bmi-trove flow protocol.
+ *
+ * Many clients writing small interleaved pieces of one file turn into a
+ * stream of small writes to each datafile.  A write of small pieces to a
+ * datafile that no other write is in progress on goes to Trove right
+ * away, without a copy.  Those that arrive while one is in progress are
+ * copied aside and merged with each other by offset; adjacent and overlapping
+ * pieces become one contiguous run, later data over earlier.  When the
+ * write in progress completes, everything gathered meanwhile goes to Trove
+ * as one list write of those runs.  The time a write spends in Trove is
+ * thus the window in which the next ones are gathered, and it grows with
+ * the load.
+ *
+ * Each write still completes only after its own data has been written,
+ * with the status of the Trove write that carried it.
+ */
+
+#include <errno.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gossip.h"
+#include "quicklist.h"
+#include "quickhash.h"
+#include "gen-locks.h"
+#include "pvfs2-internal.h"
+#include "src/io/flow/flowproto-bmi-trove/write-agg.h"
+
+/* most data gathered for one datafile while a write to it is in progress;
+ * more writes go to Trove on their own
+ */
+#define AGG_MAX_PENDING (4*1024*1024)
+
+#define AGG_TABLE_SIZE 128
+
+/* a flow write waiting for the batch that carries it */
+struct agg_write
+{
+    struct PINT_thread_mgr_trove_callback *callback;
+    TROVE_size *out_size_p;
+    TROVE_size size;
+    PVFS_error error_code;
+    struct qlist_head link;
+};
+
+/* a contiguous range of gathered data */
+struct agg_run
+{
+    TROVE_offset offset;
+    TROVE_size size;
+    TROVE_size alloc;
+    char *buffer;
+    struct qlist_head link;
+};
+
+/* a piece of a write being added to a batch */
+struct agg_piece
+{
+    TROVE_offset offset;
+    TROVE_size size;
+    const char *data;
+    int span;
+};
+
+/* a range of the batch once a write is added: its pieces and the runs
+ * they overlap or touch, which all become one run
+ */
+struct agg_span
+{
+    TROVE_offset offset;
+    TROVE_size size;
+    struct agg_run *first;      /* first run in the span, which is kept */
+    struct agg_run *next;       /* first run after the span */
+    struct agg_run *run;        /* the run of the span, new if no first */
+    char *buffer;               /* new buffer, NULL to keep first's */
+    TROVE_size alloc;
+};
+
+/* one Trove write and the flow writes it completes */
+struct agg_batch
+{
+    struct agg_file *file;
+    struct qlist_head writes;
+    struct qlist_head runs;        /* sorted by offset, never touching */
+    int run_count;
+    TROVE_size bytes;              /* sum of the sizes of the writes */
+    TROVE_ds_flags flags;
+    PVFS_hint hints;
+
+    /* the lists given to Trove: those of a single write, or built from
+     * the runs
+     */
+    char **mem_array;
+    TROVE_size *mem_size_array;
+    int mem_count;
+    TROVE_offset *stream_offset_array;
+    TROVE_size *stream_size_array;
+    int stream_count;
+    int own_arrays;
+
+    TROVE_size out_size;
+    TROVE_op_id op_id;
+    struct PINT_thread_mgr_trove_callback trove_callback;
+};
+
+struct agg_key
+{
+    TROVE_handle handle;
+    TROVE_coll_id coll_id;
+};
+
+/* a datafile with a write in progress */
+struct agg_file
+{
+    struct agg_key key;
+    int in_flight;
+    struct agg_batch *pending;
+    struct qhash_head hash_link;
+};
+
+/* largest piece of a write that is aggregated, per file system */
+struct agg_size
+{
+    TROVE_coll_id coll_id;
+    TROVE_size size;
+    struct qlist_head link;
+};
+
+static struct qhash_table *agg_table = NULL;
+static QLIST_HEAD(agg_size_list);
+static gen_mutex_t agg_mutex = GEN_MUTEX_INITIALIZER;
+static TROVE_context_id agg_context = -1;
+
+static void agg_batch_callback(void *data, PVFS_error error_code);
+
+static int agg_compare(const void *key, struct qhash_head *link)
+{
+    const struct agg_key *agg_key = key;
+    struct agg_file *file = qhash_entry(link, struct agg_file, hash_link);
+
+    return (file->key.handle == agg_key->handle &&
+            file->key.coll_id == agg_key->coll_id);
+}
+
+static int agg_hash(const void *key, int table_size)
+{
+    return quickhash_64bit_hash(&((const struct agg_key *)key)->handle,
+                                table_size);
+}
+
+/* PINT_write_agg_initialize()
+ *
+ * sets up write aggregation; writes go to the given Trove context
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_write_agg_initialize(TROVE_context_id context_id)
+{
+    agg_table = qhash_init(agg_compare, agg_hash, AGG_TABLE_SIZE);
+    if (!agg_table)
+    {
+        return -PVFS_ENOMEM;
+    }
+    agg_context = context_id;
+    return 0;
+}
+
+/* PINT_write_agg_finalize()
+ *
+ * releases write aggregation resources; there must be no writes left
+ */
+void PINT_write_agg_finalize(void)
+{
+    struct agg_size *agg_size, *tmp;
+    int i;
+
+    gen_mutex_lock(&agg_mutex);
+    if (agg_table)
+    {
+        for (i = 0; i < AGG_TABLE_SIZE; i++)
+        {
+            assert(qlist_empty(&agg_table->array[i]));
+        }
+        qhash_finalize(agg_table);
+        agg_table = NULL;
+    }
+    qlist_for_each_entry_safe(agg_size, tmp, &agg_size_list, link)
+    {
+        qlist_del(&agg_size->link);
+        free(agg_size);
+    }
+    gen_mutex_unlock(&agg_mutex);
+}
+
+/* PINT_write_agg_set_size()
+ *
+ * sets the largest contiguous piece a write to a file system may have to
+ * be aggregated; 0 turns aggregation off
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_write_agg_set_size(TROVE_coll_id coll_id, TROVE_size size)
+{
+    struct agg_size *agg_size;
+
+    gen_mutex_lock(&agg_mutex);
+    qlist_for_each_entry(agg_size, &agg_size_list, link)
+    {
+        if (agg_size->coll_id == coll_id)
+        {
+            agg_size->size = size;
+            gen_mutex_unlock(&agg_mutex);
+            return 0;
+        }
+    }
+    agg_size = malloc(sizeof(*agg_size));
+    if (!agg_size)
+    {
+        gen_mutex_unlock(&agg_mutex);
+        return -PVFS_ENOMEM;
+    }
+    agg_size->coll_id = coll_id;
+    agg_size->size = size;
+    qlist_add_tail(&agg_size->link, &agg_size_list);
+    gen_mutex_unlock(&agg_mutex);
+
+    gossip_debug(GOSSIP_FLOW_PROTO_DEBUG, "write aggregation on coll_id %d "
+                 "for writes up to %lld bytes\n", coll_id, lld(size));
+    return 0;
+}
+
+/* NOTE: assumes caller holds agg_mutex */
+static TROVE_size agg_get_size(TROVE_coll_id coll_id)
+{
+    struct agg_size *agg_size;
+
+    qlist_for_each_entry(agg_size, &agg_size_list, link)
+    {
+        if (agg_size->coll_id == coll_id)
+        {
+            return agg_size->size;
+        }
+    }
+    return 0;
+}
+
+static struct agg_batch *agg_batch_new(struct agg_file *file)
+{
+    struct agg_batch *batch;
+
+    batch = calloc(1, sizeof(*batch));
+    if (!batch)
+    {
+        return NULL;
+    }
+    batch->file = file;
+    INIT_QLIST_HEAD(&batch->writes);
+    INIT_QLIST_HEAD(&batch->runs);
+    batch->trove_callback.fn = agg_batch_callback;
+    batch->trove_callback.data = batch;
+    return batch;
+}
+
+static void agg_batch_free(struct agg_batch *batch)
+{
+    struct agg_run *run, *tmp;
+
+    assert(qlist_empty(&batch->writes));
+    qlist_for_each_entry_safe(run, tmp, &batch->runs, link)
+    {
+        free(run->buffer);
+        free(run);
+    }
+    if (batch->own_arrays)
+    {
+        free(batch->mem_array);
+        free(batch->mem_size_array);
+        free(batch->stream_offset_array);
+        free(batch->stream_size_array);
+    }
+    free(batch);
+}
+
+static struct agg_write *agg_write_new(
+    struct PINT_thread_mgr_trove_callback *callback,
+    TROVE_size *out_size_p,
+    TROVE_size size)
+{
+    struct agg_write *write;
+
+    write = malloc(sizeof(*write));
+    if (!write)
+    {
+        return NULL;
+    }
+    write->callback = callback;
+    write->out_size_p = out_size_p;
+    write->size = size;
+    write->error_code = 0;
+    return write;
+}
+
+static void agg_add_write(struct agg_batch *batch, struct agg_write *write)
+{
+    qlist_add_tail(&write->link, &batch->writes);
+    batch->bytes += write->size;
+}
+
+static int agg_piece_compare(const void *a, const void *b)
+{
+    const struct agg_piece *pa = *(const struct agg_piece * const *)a;
+    const struct agg_piece *pb = *(const struct agg_piece * const *)b;
+
+    if (pa->offset != pb->offset)
+    {
+        return (pa->offset < pb->offset) ? -1 : 1;
+    }
+    return (pa < pb) ? -1 : (pa > pb);
+}
+
+static struct agg_run *agg_run_next(struct agg_batch *batch,
+                                    struct agg_run *run)
+{
+    return (run->link.next == &batch->runs) ? NULL :
+        qlist_entry(run->link.next, struct agg_run, link);
+}
+
+/* agg_add_extents()
+ *
+ * copies the count pieces of a write, size_array[i] bytes for
+ * offset_array[i], taken one after the other from data, into the batch.
+ * They are merged with the runs they overlap or touch, newer data over
+ * older.  All memory is allocated before the batch is changed, so on
+ * failure the batch is as it was.
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+static int agg_add_extents(struct agg_batch *batch,
+                           int count,
+                           const TROVE_offset *offset_array,
+                           const TROVE_size *size_array,
+                           const char *data)
+{
+    struct agg_piece *pieces, **sorted;
+    struct agg_span *spans, *span = NULL;
+    struct agg_run *run, *other;
+    TROVE_offset end;
+    int piece_count = 0, span_count = 0, i, ret = -PVFS_ENOMEM;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    pieces = malloc(count * sizeof(*pieces));
+    sorted = malloc(count * sizeof(*sorted));
+    spans = malloc(count * sizeof(*spans));
+    if (!pieces || !sorted || !spans)
+    {
+        goto out;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (size_array[i] > 0)
+        {
+            pieces[piece_count].offset = offset_array[i];
+            pieces[piece_count].size = size_array[i];
+            pieces[piece_count].data = data;
+            sorted[piece_count] = &pieces[piece_count];
+            piece_count++;
+        }
+        data += size_array[i];
+    }
+    qsort(sorted, piece_count, sizeof(*sorted), agg_piece_compare);
+
+    /* find the spans, taking the runs in order along with the pieces */
+    run = qlist_empty(&batch->runs) ? NULL :
+        qlist_entry(batch->runs.next, struct agg_run, link);
+    for (i = 0; i < piece_count; i++)
+    {
+        if (!span || sorted[i]->offset > span->offset + span->size)
+        {
+            if (span)
+            {
+                span->next = run;
+            }
+            span = &spans[span_count++];
+            memset(span, 0, sizeof(*span));
+            span->offset = sorted[i]->offset;
+        }
+        end = sorted[i]->offset + sorted[i]->size;
+        if (end > span->offset + span->size)
+        {
+            span->size = end - span->offset;
+        }
+        sorted[i]->span = span_count - 1;
+
+        for (; run && run->offset <= span->offset + span->size;
+             run = agg_run_next(batch, run))
+        {
+            if (run->offset + run->size < span->offset)
+            {
+                /* before the span, not touching it */
+                continue;
+            }
+            end = span->offset + span->size;
+            if (!span->first)
+            {
+                span->first = run;
+                if (run->offset < span->offset)
+                {
+                    span->offset = run->offset;
+                }
+            }
+            if (run->offset + run->size > end)
+            {
+                end = run->offset + run->size;
+            }
+            span->size = end - span->offset;
+        }
+    }
+    if (span)
+    {
+        span->next = run;
+    }
+
+    for (i = 0; i < span_count; i++)
+    {
+        span = &spans[i];
+        if (!span->first)
+        {
+            span->run = malloc(sizeof(*span->run));
+            if (!span->run)
+            {
+                goto out;
+            }
+            span->alloc = span->size;
+        }
+        else if (span->first->offset == span->offset &&
+                 span->size <= span->first->alloc)
+        {
+            /* grows in place */
+            continue;
+        }
+        else
+        {
+            /* grow geometrically, since pieces are often appended in
+             * order
+             */
+            span->alloc = span->size;
+            if (span->first->offset == span->offset &&
+                span->alloc < 2 * span->first->alloc)
+            {
+                span->alloc = 2 * span->first->alloc;
+            }
+        }
+        span->buffer = malloc(span->alloc);
+        if (!span->buffer)
+        {
+            goto out;
+        }
+    }
+
+    /* nothing can fail from here on */
+    for (i = 0; i < span_count; i++)
+    {
+        span = &spans[i];
+        if (!span->first)
+        {
+            run = span->run;
+            run->buffer = span->buffer;
+            run->alloc = span->alloc;
+            qlist_add_tail(&run->link,
+                           span->next ? &span->next->link : &batch->runs);
+            batch->run_count++;
+        }
+        else
+        {
+            run = span->first;
+            span->run = run;
+            if (span->buffer)
+            {
+                memcpy(span->buffer + (run->offset - span->offset),
+                       run->buffer, run->size);
+                free(run->buffer);
+                run->buffer = span->buffer;
+                run->alloc = span->alloc;
+            }
+            while ((other = agg_run_next(batch, run)) &&
+                   other != span->next)
+            {
+                memcpy(run->buffer + (other->offset - span->offset),
+                       other->buffer, other->size);
+                qlist_del(&other->link);
+                free(other->buffer);
+                free(other);
+                batch->run_count--;
+            }
+        }
+        run->offset = span->offset;
+        run->size = span->size;
+    }
+
+    /* in the order given, should pieces of one write overlap */
+    for (i = 0; i < piece_count; i++)
+    {
+        run = spans[pieces[i].span].run;
+        memcpy(run->buffer + (pieces[i].offset - run->offset),
+               pieces[i].data, pieces[i].size);
+    }
+    span_count = 0;
+    ret = 0;
+
+  out:
+    for (i = 0; i < span_count; i++)
+    {
+        free(spans[i].run);
+        free(spans[i].buffer);
+    }
+    free(pieces);
+    free(sorted);
+    free(spans);
+    return ret;
+}
+
+/* agg_batch_post()
+ *
+ * hands a batch to Trove
+ *
+ * returns 0 if posted, 1 on immediate completion, -PVFS_error on failure
+ */
+static int agg_batch_post(struct agg_batch *batch)
+{
+    struct agg_run *run;
+    int i = 0;
+
+    if (batch->run_count)
+    {
+        batch->mem_array = malloc(batch->run_count * sizeof(char *));
+        batch->mem_size_array = malloc(batch->run_count * sizeof(TROVE_size));
+        batch->stream_offset_array =
+            malloc(batch->run_count * sizeof(TROVE_offset));
+        batch->stream_size_array =
+            malloc(batch->run_count * sizeof(TROVE_size));
+        batch->own_arrays = 1;
+        if (!batch->mem_array || !batch->mem_size_array ||
+            !batch->stream_offset_array || !batch->stream_size_array)
+        {
+            return -PVFS_ENOMEM;
+        }
+        qlist_for_each_entry(run, &batch->runs, link)
+        {
+            batch->mem_array[i] = run->buffer;
+            batch->mem_size_array[i] = run->size;
+            batch->stream_offset_array[i] = run->offset;
+            batch->stream_size_array[i] = run->size;
+            i++;
+        }
+        batch->mem_count = batch->run_count;
+        batch->stream_count = batch->run_count;
+
+        gossip_debug(GOSSIP_FLOW_PROTO_DEBUG, "write aggregation: %lld "
+                     "bytes in %d runs to %llu\n", lld(batch->bytes),
+                     batch->run_count, llu(batch->file->key.handle));
+    }
+
+    return trove_bstream_write_list(batch->file->key.coll_id,
+                                    batch->file->key.handle,
+                                    batch->mem_array,
+                                    batch->mem_size_array,
+                                    batch->mem_count,
+                                    batch->stream_offset_array,
+                                    batch->stream_size_array,
+                                    batch->stream_count,
+                                    &batch->out_size,
+                                    batch->flags,
+                                    NULL,
+                                    &batch->trove_callback,
+                                    agg_context,
+                                    &batch->op_id,
+                                    batch->hints);
+}
+
+/* moves the writes of a finished batch to done and frees the batch */
+static void agg_batch_done(struct agg_batch *batch,
+                           PVFS_error error_code,
+                           struct qlist_head *done)
+{
+    struct agg_write *write, *tmp;
+
+    qlist_for_each_entry_safe(write, tmp, &batch->writes, link)
+    {
+        write->error_code = error_code;
+        qlist_del(&write->link);
+        qlist_add_tail(&write->link, done);
+    }
+    agg_batch_free(batch);
+}
+
+/* agg_issue()
+ *
+ * posts the data gathered for a file once nothing is in progress on it,
+ * or right away if forced
+ *
+ * NOTE: assumes caller holds agg_mutex
+ */
+static void agg_issue(struct agg_file *file,
+                      int force,
+                      struct qlist_head *done)
+{
+    struct agg_batch *batch;
+    int ret;
+
+    while (file->pending && (force || !file->in_flight))
+    {
+        batch = file->pending;
+        file->pending = NULL;
+        file->in_flight++;
+        ret = agg_batch_post(batch);
+        if (ret != 0)
+        {
+            file->in_flight--;
+            agg_batch_done(batch, (ret < 0) ? ret : 0, done);
+        }
+    }
+}
+
+/* NOTE: assumes caller holds agg_mutex */
+static void agg_file_put(struct agg_file *file)
+{
+    if (!file->in_flight && !file->pending)
+    {
+        qhash_del(&file->hash_link);
+        free(file);
+    }
+}
+
+/* completes flow writes; must be called without agg_mutex held */
+static void agg_complete(struct qlist_head *done)
+{
+    struct agg_write *write, *tmp;
+    struct PINT_thread_mgr_trove_callback *callback;
+    PVFS_error error_code;
+
+    qlist_for_each_entry_safe(write, tmp, done, link)
+    {
+        qlist_del(&write->link);
+        callback = write->callback;
+        error_code = write->error_code;
+        if (!error_code)
+        {
+            *write->out_size_p = write->size;
+        }
+        free(write);
+        callback->fn(callback->data, error_code);
+    }
+}
+
+static void agg_batch_callback(void *data, PVFS_error error_code)
+{
+    struct agg_batch *batch = data;
+    struct agg_file *file = batch->file;
+    QLIST_HEAD(done);
+
+    gen_mutex_lock(&agg_mutex);
+    file->in_flight--;
+    agg_batch_done(batch, error_code, &done);
+    agg_issue(file, 0, &done);
+    agg_file_put(file);
+    gen_mutex_unlock(&agg_mutex);
+
+    agg_complete(&done);
+}
+
+/* PINT_write_agg_post()
+ *
+ * posts a write to a datafile, with the same arguments as
+ * trove_bstream_write_list() but for the callback.  Writes made of
+ * small pieces are aggregated; others, and all writes if aggregation is
+ * off for the file system, go to Trove directly.  The data and the lists
+ * must stay in place until the write completes.
+ *
+ * sets *out_op_id_p to the Trove operation, or to 0 for an aggregated
+ * write, which cannot be cancelled but always completes through the
+ * callback.
+ *
+ * returns 0 on success, 1 on immediate completion, -PVFS_error on failure
+ */
+int PINT_write_agg_post(TROVE_coll_id coll_id,
+                        TROVE_handle handle,
+                        char **mem_offset_array,
+                        TROVE_size *mem_size_array,
+                        int mem_count,
+                        TROVE_offset *stream_offset_array,
+                        TROVE_size *stream_size_array,
+                        int stream_count,
+                        TROVE_size *out_size_p,
+                        TROVE_ds_flags flags,
+                        struct PINT_thread_mgr_trove_callback *callback,
+                        TROVE_op_id *out_op_id_p,
+                        PVFS_hint hints)
+{
+    struct agg_key key;
+    struct agg_file *file = NULL;
+    struct agg_batch *batch;
+    struct agg_write *write;
+    struct qhash_head *link;
+    TROVE_size size = 0, piece = 0;
+    int i, ret;
+
+    for (i = 0; i < stream_count; i++)
+    {
+        size += stream_size_array[i];
+        if (stream_size_array[i] > piece)
+        {
+            piece = stream_size_array[i];
+        }
+    }
+
+    gen_mutex_lock(&agg_mutex);
+
+    /* the flow protocol always hands over one buffer */
+    if (!agg_table || mem_count != 1 || piece > agg_get_size(coll_id))
+    {
+        goto direct;
+    }
+
+    key.handle = handle;
+    key.coll_id = coll_id;
+    link = qhash_search(agg_table, &key);
+    if (link)
+    {
+        file = qhash_entry(link, struct agg_file, hash_link);
+    }
+
+    if (!file || !file->in_flight)
+    {
+        /* nothing in progress: post it as it is */
+        if (!file)
+        {
+            file = malloc(sizeof(*file));
+            if (!file)
+            {
+                goto direct;
+            }
+            file->key = key;
+            file->in_flight = 0;
+            file->pending = NULL;
+            qhash_add(agg_table, &key, &file->hash_link);
+        }
+        batch = agg_batch_new(file);
+        write = agg_write_new(callback, out_size_p, size);
+        if (!batch || !write)
+        {
+            free(batch);
+            free(write);
+            agg_file_put(file);
+            goto direct;
+        }
+        agg_add_write(batch, write);
+        batch->mem_array = mem_offset_array;
+        batch->mem_size_array = mem_size_array;
+        batch->mem_count = mem_count;
+        batch->stream_offset_array = stream_offset_array;
+        batch->stream_size_array = stream_size_array;
+        batch->stream_count = stream_count;
+        batch->flags = flags;
+        batch->hints = hints;
+
+        file->in_flight++;
+        ret = agg_batch_post(batch);
+        if (ret != 0)
+        {
+            /* the caller completes it, so take the write back */
+            QLIST_HEAD(done);
+
+            file->in_flight--;
+            agg_batch_done(batch, 0, &done);
+            free(qlist_entry(done.next, struct agg_write, link));
+            agg_file_put(file);
+            gen_mutex_unlock(&agg_mutex);
+            if (ret == 1)
+            {
+                *out_size_p = size;
+            }
+            return ret;
+        }
+        gen_mutex_unlock(&agg_mutex);
+        *out_op_id_p = 0;
+        return 0;
+    }
+
+    /* a write is in progress: gather this one, all of it or, should
+     * memory run short, none of it
+     */
+    batch = file->pending;
+    if (batch && batch->bytes + size > AGG_MAX_PENDING)
+    {
+        goto direct;
+    }
+    write = agg_write_new(callback, out_size_p, size);
+    if (!write)
+    {
+        goto direct;
+    }
+    if (!batch)
+    {
+        batch = agg_batch_new(file);
+        if (!batch)
+        {
+            free(write);
+            goto direct;
+        }
+    }
+    if (agg_add_extents(batch, stream_count, stream_offset_array,
+                        stream_size_array, mem_offset_array[0]) < 0)
+    {
+        free(write);
+        if (batch != file->pending)
+        {
+            agg_batch_free(batch);
+        }
+        goto direct;
+    }
+    agg_add_write(batch, write);
+    batch->flags |= flags;
+    file->pending = batch;
+    gen_mutex_unlock(&agg_mutex);
+
+    *out_op_id_p = 0;
+    return 0;
+
+  direct:
+    gen_mutex_unlock(&agg_mutex);
+    return trove_bstream_write_list(coll_id,
+                                    handle,
+                                    mem_offset_array,
+                                    mem_size_array,
+                                    mem_count,
+                                    stream_offset_array,
+                                    stream_size_array,
+                                    stream_count,
+                                    out_size_p,
+                                    flags,
+                                    NULL,
+                                    callback,
+                                    agg_context,
+                                    out_op_id_p,
+                                    hints);
+}
+
+/* PINT_write_agg_flush()
+ *
+ * posts whatever has been gathered for a datafile without waiting for
+ * the write in progress
+ */
+void PINT_write_agg_flush(TROVE_coll_id coll_id, TROVE_handle handle)
+{
+    struct agg_key key;
+    struct qhash_head *link;
+    QLIST_HEAD(done);
+
+    key.handle = handle;
+    key.coll_id = coll_id;
+
+    gen_mutex_lock(&agg_mutex);
+    if (agg_table && (link = qhash_search(agg_table, &key)))
+    {
+        agg_issue(qhash_entry(link, struct agg_file, hash_link), 1, &done);
+    }
+    gen_mutex_unlock(&agg_mutex);
+
+    agg_complete(&done);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,44 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#ifndef __WRITE_AGG_H
+#define __WRITE_AGG_H
+
+#include "trove.h"
+#include "thread-mgr.h"
+
+int PINT_write_agg_initialize(TROVE_context_id context_id);
+
+void PINT_write_agg_finalize(void);
+
+int PINT_write_agg_set_size(TROVE_coll_id coll_id, TROVE_size size);
+
+int PINT_write_agg_post(TROVE_coll_id coll_id,
+                        TROVE_handle handle,
+                        char **mem_offset_array,
+                        TROVE_size *mem_size_array,
+                        int mem_count,
+                        TROVE_offset *stream_offset_array,
+                        TROVE_size *stream_size_array,
+                        int stream_count,
+                        TROVE_size *out_size_p,
+                        TROVE_ds_flags flags,
+                        struct PINT_thread_mgr_trove_callback *callback,
+                        TROVE_op_id *out_op_id_p,
+                        PVFS_hint hints);
+
+void PINT_write_agg_flush(TROVE_coll_id coll_id, TROVE_handle handle);
+
+#endif /* __WRITE_AGG_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -18,11 +18,15 @@
 #include "id-generator.h"
 #include "pint-util.h"
 #include "pvfs2-internal.h"
+#include "pint-slab.h"
 
 #ifdef WIN32
 typedef enum job_type job_type_t;
 #endif
 
+static PINT_slab job_desc_slab =
+    PINT_SLAB_INITIALIZER("job desc", sizeof(struct job_desc));
+
 /***************************************************************
  * Visible functions
  */
@@ -37,12 +41,12 @@ struct job_desc *alloc_job_desc(int type)
 {
     struct job_desc *jd = NULL;
 
-    jd = (struct job_desc *) malloc(sizeof(struct job_desc));
+    /* comes back zeroed */
+    jd = (struct job_desc *) PINT_slab_alloc(&job_desc_slab);
     if (!jd)
     {
 	return (NULL);
     }
-    memset(jd, 0, sizeof(struct job_desc));
 
     id_gen_safe_register(&(jd->job_id), jd);
 
@@ -64,7 +68,7 @@ struct job_desc *alloc_job_desc(int type)
 void dealloc_job_desc(struct job_desc *jd)
 {
     id_gen_safe_unregister(jd->job_id);
-    free(jd);
+    PINT_slab_free(&job_desc_slab, jd);
 }
 
 /* job_desc_q_new()
@@ -106,7 +110,7 @@ void job_desc_q_cleanup(job_desc_q_p jdqp)
                         job_desc_q_link);
                 /* qlist_for_each_safe lets us iterate and remove nodes.  no
                  * need to adjust pointers as we are freeing everything */
-                free(tmp_job_desc);
+                PINT_slab_free(&job_desc_slab, tmp_job_desc);
             }
 
             free(jdqp);
@@ -27,6 +27,7 @@
 #include "id-generator.h"
 #include "job-time-mgr.h"
 #include "pvfs2-internal.h"
+#include "pint-trace.h"
 
 /* contexts for use within the job interface */
 static bmi_context_id global_bmi_context = -1;
@@ -50,6 +51,10 @@ static int dev_unexp_pending_count = 0;
 static gen_mutex_t bmi_unexp_mutex = GEN_MUTEX_INITIALIZER;
 static gen_mutex_t dev_unexp_mutex = GEN_MUTEX_INITIALIZER;
 static gen_mutex_t completion_mutex = GEN_MUTEX_INITIALIZER;
+/* the request scheduler has no locking of its own; with server state
+ * machine workers it is entered from several threads at once
+ */
+static gen_mutex_t req_sched_mutex = GEN_MUTEX_INITIALIZER;
 
 static int initialized = 0;
 static gen_mutex_t initialized_mutex = GEN_MUTEX_INITIALIZER;
@@ -453,6 +458,7 @@ int job_bmi_send(PVFS_BMI_addr_t addr,
      */
     *id = jd->job_id;
     bmi_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_BMI_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return(job_time_mgr_add(jd, timeout_sec));
 }
@@ -552,6 +558,7 @@ int job_bmi_send_list(PVFS_BMI_addr_t addr,
      */
     *id = jd->job_id;
     bmi_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_BMI_POST, jd->job_user_ptr, jd->job_id, 0);
     return(job_time_mgr_add(jd, timeout_sec));
 }
 
@@ -632,6 +639,7 @@ int job_bmi_recv(PVFS_BMI_addr_t addr,
      */
     *id = jd->job_id;
     bmi_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_BMI_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return(job_time_mgr_add(jd, timeout_sec));
 }
@@ -717,6 +725,7 @@ int job_bmi_recv_list(PVFS_BMI_addr_t addr,
      */
     *id = jd->job_id;
     bmi_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_BMI_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return(job_time_mgr_add(jd, timeout_sec));
 }
@@ -828,7 +837,7 @@ int job_bmi_unexp_cancel(job_id_t id)
 
 #ifdef __PVFS2_JOB_THREADED__
     /* wake up anyone waiting for completion */
-    pthread_cond_signal(&completion_cond);
+    pthread_cond_broadcast(&completion_cond);
 #endif
     gen_mutex_unlock(&completion_mutex);
 
@@ -1081,8 +1090,10 @@ int job_req_sched_post(enum PVFS_server_op op,
     jd->context_id = context_id;
     jd->status_user_tag = status_user_tag;
 
+    gen_mutex_lock(&req_sched_mutex);
     ret = PINT_req_sched_post(
         op, fs_id, handle, access_type, sched_policy, jd, &(jd->u.req_sched.id));
+    gen_mutex_unlock(&req_sched_mutex);
 
     if (ret < 0)
     {
@@ -1133,7 +1144,9 @@ int job_req_sched_change_mode(enum PVFS_server_mode mode,
     jd->context_id = context_id;
     jd->status_user_tag = status_user_tag;
 
+    gen_mutex_lock(&req_sched_mutex);
     ret = PINT_req_sched_change_mode(mode, jd, &(jd->u.req_sched.id));
+    gen_mutex_unlock(&req_sched_mutex);
     if (ret < 0)
     {
         /* error posting */
@@ -1191,7 +1204,9 @@ int job_req_sched_post_timer(int msecs,
     jd->context_id = context_id;
     jd->status_user_tag = status_user_tag;
 
+    gen_mutex_lock(&req_sched_mutex);
     ret = PINT_req_sched_post_timer(msecs, jd, &(jd->u.req_sched.id));
+    gen_mutex_unlock(&req_sched_mutex);
 
     if (ret < 0)
     {
@@ -1267,8 +1282,16 @@ int job_req_sched_release(job_id_t in_completed_id,
         return 1;
     }
 
+    gen_mutex_lock(&req_sched_mutex);
     ret = PINT_req_sched_release(match_jd->u.req_sched.id, jd,
                                  &(jd->u.req_sched.id));
+    gen_mutex_unlock(&req_sched_mutex);
+
+    /* the release may have let queued requests through; hand them to the
+     * completion queue now, since job_testcontext() may be waiting in
+     * another thread rather than about to test the scheduler itself
+     */
+    do_one_test_cycle_req_sched();
 
     /* delete the old req sched job desc; it is no longer needed */
     dealloc_job_desc(match_jd);
@@ -1363,6 +1386,7 @@ int job_flow(flow_descriptor * flow_d,
     /* queue up the job desc. for later completion */
     *id = jd->job_id;
     flow_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_FLOW_POST, jd->job_user_ptr, jd->job_id, 0);
     gossip_debug(GOSSIP_FLOW_DEBUG, "Job flows in progress (post time): %d\n",
             flow_pending_count);
 
@@ -1494,6 +1518,7 @@ int job_trove_bstream_write_list(TROVE_coll_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 } 
@@ -1585,6 +1610,7 @@ int job_trove_bstream_read_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -1658,6 +1684,7 @@ int job_trove_bstream_flush(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -1743,6 +1770,7 @@ int job_trove_keyval_read(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -1831,6 +1859,7 @@ int job_trove_keyval_read_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -1917,6 +1946,7 @@ int job_trove_keyval_write(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2012,6 +2042,7 @@ int job_trove_keyval_write_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2091,6 +2122,7 @@ int job_trove_keyval_remove_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2166,6 +2198,7 @@ int job_trove_keyval_flush(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2248,6 +2281,7 @@ int job_trove_keyval_get_handle_info(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2333,6 +2367,7 @@ int job_trove_dspace_getattr(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2423,6 +2458,7 @@ int job_trove_dspace_getattr_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2506,6 +2542,7 @@ int job_trove_dspace_setattr(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2590,6 +2627,82 @@ int job_trove_bstream_resize(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
+
+    return (0);
+}
+
+/* job_trove_bstream_seek()
+ *
+ * finds the next data or hole at or after *inout_offset_p in a storage
+ * byte stream.  The result is stored in *inout_offset_p, which must stay
+ * valid until the job completes; it is -1 for TROVE_SEEK_DATA when there is
+ * no data at or after the offset
+ *
+ * returns 0 on success, 1 on immediate completion, and -errno on
+ * failure
+ */
+int job_trove_bstream_seek(PVFS_fs_id coll_id,
+                           PVFS_handle handle,
+                           PVFS_offset *inout_offset_p,
+                           int whence,
+                           PVFS_ds_flags flags,
+                           void *user_ptr,
+                           job_aint status_user_tag,
+                           job_status_s * out_status_p,
+                           job_id_t * id,
+                           job_context_id context_id,
+                           PVFS_hint hints)
+{
+    int ret = -1;
+    struct job_desc *jd = NULL;
+    void* user_ptr_internal GCC_UNUSED;
+
+    jd = alloc_job_desc(JOB_TROVE);
+    if (!jd)
+    {
+        out_status_p->error_code = -PVFS_ENOMEM;
+        return 1;
+    }
+    jd->job_user_ptr = user_ptr;
+    jd->context_id = context_id;
+    jd->status_user_tag = status_user_tag;
+    jd->trove_callback.fn = trove_thread_mgr_callback;
+    jd->trove_callback.data = (void*)jd;
+    user_ptr_internal = &jd->trove_callback;
+
+#ifdef __PVFS2_TROVE_SUPPORT__
+    ret = trove_bstream_seek(coll_id, handle, inout_offset_p, whence,
+                             flags, user_ptr_internal, global_trove_context,
+                             &(jd->u.trove.id), hints);
+#else
+    gossip_err("Error: Trove support not enabled.\n");
+    ret = -ENOSYS;
+#endif
+
+    if (ret < 0)
+    {
+        /* error posting trove operation */
+        dealloc_job_desc(jd);
+        jd = NULL;
+        out_status_p->error_code = ret;
+        out_status_p->status_user_tag = status_user_tag;
+        return (1);
+    }
+
+    if (ret == 1)
+    {
+        /* immediate completion */
+        out_status_p->error_code = 0;
+        out_status_p->status_user_tag = status_user_tag;
+        dealloc_job_desc(jd);
+        jd = NULL;
+        return (ret);
+    }
+
+    *id = jd->job_id;
+    trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2697,6 +2810,7 @@ int job_trove_keyval_remove(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2812,6 +2926,7 @@ int job_trove_keyval_iterate(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2904,6 +3019,7 @@ int job_trove_keyval_iterate_keys(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -2992,6 +3108,7 @@ int job_trove_dspace_iterate_handles(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3083,6 +3200,7 @@ int job_trove_dspace_create(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3173,6 +3291,7 @@ int job_trove_dspace_create_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3259,6 +3378,7 @@ int job_trove_dspace_remove_list(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3343,6 +3463,7 @@ int job_trove_dspace_remove(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3427,6 +3548,7 @@ int job_trove_dspace_verify(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3538,6 +3660,7 @@ int job_trove_fs_create(char *collname,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3714,6 +3837,7 @@ int job_trove_fs_seteattr(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3794,6 +3918,7 @@ int job_trove_fs_geteattr(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3875,6 +4000,7 @@ int job_trove_fs_deleattr(PVFS_fs_id coll_id,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
 
     return (0);
 }
@@ -3915,7 +4041,7 @@ int job_null(
     jd->completed_flag = 1;
 #ifdef __PVFS2_JOB_THREADED__
     /* wake up anyone waiting for completion */
-    pthread_cond_signal(&completion_cond);
+    pthread_cond_broadcast(&completion_cond);
 #endif
     gen_mutex_unlock(&completion_mutex);
 
@@ -4540,7 +4666,7 @@ static void precreate_pool_get_thread_mgr_callback_unlocked(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         free(tmp_trove->jd->u.precreate_pool.data);
         gen_mutex_unlock(&completion_mutex);
@@ -4588,7 +4714,7 @@ static void precreate_pool_iterate_callback(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
     }
     gen_mutex_unlock(&completion_mutex);
@@ -4662,7 +4788,7 @@ static void precreate_pool_fill_thread_mgr_callback(
         jd->completed_flag = 1;
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
         return;
@@ -4754,7 +4880,7 @@ static void precreate_pool_fill_thread_mgr_callback(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
         return;
@@ -4814,7 +4940,7 @@ static void precreate_pool_fill_thread_mgr_callback(
         jd->completed_flag = 1;
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
         return;
@@ -4862,6 +4988,8 @@ static void trove_thread_mgr_callback(
     {
         /* set job descriptor fields and put into completion queue */
         tmp_desc->u.trove.state = error_code;
+        PINT_TRACE_JOB(PINT_TRACE_TROVE_COMPLETE, tmp_desc->job_user_ptr,
+                       tmp_desc->job_id, error_code);
         job_desc_q_add(completion_queue_array[tmp_desc->context_id],
                        tmp_desc);
         /* set completed flag while holding queue lock */
@@ -4877,7 +5005,7 @@ static void trove_thread_mgr_callback(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
     }
     gen_mutex_unlock(&completion_mutex);
@@ -4913,6 +5041,8 @@ static void bmi_thread_mgr_callback(
         /* set job descriptor fields and put into completion queue */
         tmp_desc->u.bmi.error_code = error_code;
         tmp_desc->u.bmi.actual_size = actual_size;
+        PINT_TRACE_JOB(PINT_TRACE_BMI_COMPLETE, tmp_desc->job_user_ptr,
+                       tmp_desc->job_id, error_code);
         job_desc_q_add(completion_queue_array[tmp_desc->context_id],
                        tmp_desc);
         /* set completed flag while holding queue lock */
@@ -4922,7 +5052,7 @@ static void bmi_thread_mgr_callback(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
     }
     gen_mutex_unlock(&completion_mutex);
@@ -4972,7 +5102,7 @@ static void bmi_thread_mgr_unexp_handler(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
     }
@@ -5019,7 +5149,7 @@ static void dev_thread_mgr_unexp_handler(struct PINT_dev_unexp_info* unexp)
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
     }
@@ -5124,8 +5254,10 @@ static int do_one_test_cycle_req_sched(void)
     struct job_desc *tmp_desc = NULL;
 
 
+    gen_mutex_lock(&req_sched_mutex);
     ret = PINT_req_sched_testworld(&count, id_array,
                                    user_ptr_array, error_code_array);
+    gen_mutex_unlock(&req_sched_mutex);
 
     if (ret < 0)
     {
@@ -5146,6 +5278,9 @@ static int do_one_test_cycle_req_sched(void)
         tmp_desc->completed_flag = 1;
         job_desc_q_add(completion_queue_array[tmp_desc->context_id],
             tmp_desc);
+#ifdef __PVFS2_JOB_THREADED__
+        pthread_cond_broadcast(&completion_cond);
+#endif
         gen_mutex_unlock(&completion_mutex);
     }
 
@@ -5388,6 +5523,9 @@ static void flow_callback(flow_descriptor* flow_d, int cancel_path)
     /* if this is being triggered directly from PINT_flow_cancel(), then the
      * completion mutex is already held by the caller; skip the mutex.
      */
+    PINT_TRACE_JOB(PINT_TRACE_FLOW_COMPLETE, tmp_desc->job_user_ptr,
+                   tmp_desc->job_id, flow_d->error_code);
+
     if(!cancel_path)
         gen_mutex_lock(&completion_mutex);
     job_desc_q_add(completion_queue_array[tmp_desc->context_id],
@@ -5401,7 +5539,7 @@ static void flow_callback(flow_descriptor* flow_d, int cancel_path)
 
 #ifdef __PVFS2_JOB_THREADED__
     /* wake up anyone waiting for completion */
-    pthread_cond_signal(&completion_cond);
+    pthread_cond_broadcast(&completion_cond);
 #endif
     if(!cancel_path)
         gen_mutex_unlock(&completion_mutex);
@@ -5459,7 +5597,7 @@ int job_precreate_pool_fill_signal_error(
 
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);
     }
@@ -5923,7 +6061,7 @@ static void precreate_pool_get_handles_try_post(struct job_desc* jd)
         jd->completed_flag = 1;
 #ifdef __PVFS2_JOB_THREADED__
         /* wake up anyone waiting for completion */
-        pthread_cond_signal(&completion_cond);
+        pthread_cond_broadcast(&completion_cond);
 #endif
         gen_mutex_unlock(&completion_mutex);        
         return;
@@ -5970,7 +6108,7 @@ static void precreate_pool_get_handles_try_post(struct job_desc* jd)
                 jd->completed_flag = 1;
         #ifdef __PVFS2_JOB_THREADED__
                 /* wake up anyone waiting for completion */
-                pthread_cond_signal(&completion_cond);
+                pthread_cond_broadcast(&completion_cond);
         #endif
                 gen_mutex_unlock(&completion_mutex);        
                 return;
@@ -6039,7 +6177,7 @@ static void precreate_pool_get_handles_try_post(struct job_desc* jd)
                 jd->completed_flag = 1;
         #ifdef __PVFS2_JOB_THREADED__
                 /* wake up anyone waiting for completion */
-                pthread_cond_signal(&completion_cond);
+                pthread_cond_broadcast(&completion_cond);
         #endif
                 gen_mutex_unlock(&completion_mutex);        
                 return;
@@ -6099,7 +6237,7 @@ static void precreate_pool_get_handles_try_post(struct job_desc* jd)
                     jd->completed_flag = 1;
 #ifdef __PVFS2_JOB_THREADED__
                     /* wake up anyone waiting for completion */
-                    pthread_cond_signal(&completion_cond);
+                    pthread_cond_broadcast(&completion_cond);
 #endif
                     gen_mutex_unlock(&completion_mutex);        
                 }
@@ -6334,6 +6472,7 @@ int job_precreate_pool_iterate_handles(PVFS_fs_id fsid,
      */
     *id = jd->job_id;
     trove_pending_count++;
+    PINT_TRACE_JOB(PINT_TRACE_TROVE_POST, jd->job_user_ptr, jd->job_id, 0);
     gen_mutex_unlock(&precreate_pool_mutex);
 
     return (0);
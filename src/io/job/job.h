@@ -413,6 +413,19 @@ int job_trove_bstream_resize(PVFS_fs_id coll_id,
                              job_context_id context_id,
                              PVFS_hint hints);
 
+/* find the next data or hole in a bytestream */
+int job_trove_bstream_seek(PVFS_fs_id coll_id,
+                           PVFS_handle handle,
+                           PVFS_offset *inout_offset_p,
+                           int whence,
+                           PVFS_ds_flags flags,
+                           void *user_ptr,
+                           job_aint status_user_tag,
+                           job_status_s * out_status_p,
+                           job_id_t * id,
+                           job_context_id context_id,
+                           PVFS_hint hints);
+
 /* check consistency of a bytestream for a given vtag */
 int job_trove_bstream_validate(PVFS_fs_id coll_id,
                                PVFS_handle handle,
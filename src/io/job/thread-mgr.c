@@ -23,6 +23,11 @@
 #define THREAD_MGR_TEST_TIMEOUT 10
 static int thread_mgr_test_timeout = THREAD_MGR_TEST_TIMEOUT;
 
+/* how long the threads block when BMI or Trove can wake them up on
+ * demand; this only bounds the cost of a wakeup that got lost
+ */
+#define THREAD_MGR_WAKEUP_TIMEOUT 1000
+
 /* TODO: organize this stuff better */
 static void *bmi_thread_function(void *ptr);
 static void *trove_thread_function(void *ptr);
@@ -71,14 +76,48 @@ static int bmi_test_cancel_waiter = 0;
 static int bmi_test_count = 0;
 static gen_mutex_t trove_test_mutex = GEN_MUTEX_INITIALIZER;
 static int trove_test_flag = 0;
+static int trove_test_cancel_waiter = 0;
 static int trove_test_count = 0;
 
+#ifdef __PVFS2_JOB_THREADED__
+/* timeouts used by the threads; raised to THREAD_MGR_WAKEUP_TIMEOUT
+ * when the other threads can interrupt a test in progress
+ */
+static int bmi_idle_timeout = THREAD_MGR_TEST_TIMEOUT;
+static int trove_idle_timeout = THREAD_MGR_TEST_TIMEOUT;
+#endif
+
 static int bmi_thread_running = 0;
 static int trove_thread_running = 0;
 static int dev_thread_running = 0;
 
 static gen_mutex_t bmi_thread_running_mutex = GEN_MUTEX_INITIALIZER;
 
+#ifdef __PVFS2_JOB_THREADED__
+/* bmi_thread_wake(), trove_thread_wake()
+ *
+ * make the thread return from a test call that may be blocked for up
+ * to its idle timeout
+ */
+static void bmi_thread_wake(void)
+{
+    if(bmi_idle_timeout == THREAD_MGR_WAKEUP_TIMEOUT)
+    {
+        BMI_set_info(0, BMI_WAKE_TESTCONTEXT, NULL);
+    }
+}
+
+static void trove_thread_wake(void)
+{
+#ifdef __PVFS2_TROVE_SUPPORT__
+    if(trove_idle_timeout == THREAD_MGR_WAKEUP_TIMEOUT)
+    {
+        trove_wake_context(HACK_fs_id, global_trove_context);
+    }
+#endif
+}
+#endif /* __PVFS2_JOB_THREADED__ */
+
 /* trove_thread_function()
  *
  * function executed by the thread in charge of trove
@@ -91,12 +130,19 @@ static void *trove_thread_function(void *ptr)
     int timeout GCC_UNUSED = thread_mgr_test_timeout;
 
 #ifdef __PVFS2_JOB_THREADED__
+    timeout = trove_idle_timeout;
     PINT_event_thread_start("TROVE");
     while (trove_thread_running)
 #endif
     {
 	/* indicate that a test is in progress */
 	gen_mutex_lock(&trove_test_mutex);
+#ifdef __PVFS2_JOB_THREADED__
+        /* let waiting cancel operations run first */
+        while (trove_test_cancel_waiter) {
+            pthread_cond_wait(&trove_test_cond, &trove_test_mutex);
+        }
+#endif
 	trove_test_flag = 1;
 	gen_mutex_unlock(&trove_test_mutex);
 	
@@ -118,7 +164,7 @@ static void *trove_thread_function(void *ptr)
 	gen_mutex_lock(&trove_test_mutex);
 	trove_test_flag = 0;
 #ifdef __PVFS2_JOB_THREADED__
-	pthread_cond_signal(&trove_test_cond);
+	pthread_cond_broadcast(&trove_test_cond);
 #endif
 	gen_mutex_unlock(&trove_test_mutex);
 
@@ -233,7 +279,11 @@ static void *bmi_thread_function(void *ptr)
 	}
 	else
 	{
+#ifdef __PVFS2_JOB_THREADED__
+	    test_timeout = bmi_idle_timeout;
+#else
 	    test_timeout = thread_mgr_test_timeout;
+#endif
 	}
 
 	/* indicate that a test is in progress */
@@ -262,7 +312,7 @@ static void *bmi_thread_function(void *ptr)
 	gen_mutex_lock(&bmi_test_mutex);
 	bmi_test_flag = 0;
 #ifdef __PVFS2_JOB_THREADED__
-	pthread_cond_signal(&bmi_test_cond);
+	pthread_cond_broadcast(&bmi_test_cond);
 #endif
 	gen_mutex_unlock(&bmi_test_mutex);
 
@@ -443,6 +493,17 @@ int PINT_thread_mgr_trove_start(void)
     }
     trove_thread_ref_count++;
 #ifdef __PVFS2_JOB_THREADED__
+    /* trove can wake us up for cancel and stop, so there is no need to
+     * come back and check every few milliseconds
+     */
+    if(trove_wake_context(HACK_fs_id, global_trove_context) == 0)
+    {
+        trove_idle_timeout = THREAD_MGR_WAKEUP_TIMEOUT;
+    }
+    else
+    {
+        trove_idle_timeout = thread_mgr_test_timeout;
+    }
     trove_thread_running = 1;
     ret = pthread_create(&trove_thread_id, NULL, trove_thread_function, NULL);
     if(ret != 0)
@@ -473,6 +534,7 @@ int PINT_thread_mgr_trove_start(void)
 int PINT_thread_mgr_bmi_start(void)
 {
     int ret = -1;
+    int wakeup GCC_UNUSED = 0;
 
     gen_mutex_lock(&bmi_mutex);
     if(bmi_thread_ref_count > 0)
@@ -497,6 +559,11 @@ int PINT_thread_mgr_bmi_start(void)
     bmi_thread_running = 1;
     gen_mutex_unlock(&bmi_thread_running_mutex);
 #ifdef __PVFS2_JOB_THREADED__
+    bmi_idle_timeout = thread_mgr_test_timeout;
+    if(BMI_get_info(0, BMI_CHECK_WAKEUP, &wakeup) == 0 && wakeup)
+    {
+        bmi_idle_timeout = THREAD_MGR_WAKEUP_TIMEOUT;
+    }
     ret = pthread_create(&bmi_thread_id, NULL, bmi_thread_function, NULL);
     if(ret != 0)
     {
@@ -561,6 +628,7 @@ int PINT_thread_mgr_bmi_cancel(PVFS_id_gen_t id, void* user_ptr)
     while(bmi_test_flag == 1)
     {
 #ifdef __PVFS2_JOB_THREADED__
+        bmi_thread_wake();
 	pthread_cond_wait(&bmi_test_cond, &bmi_test_mutex);
 #else
 	/* this condition shouldn't be possible without threads */
@@ -589,6 +657,9 @@ int PINT_thread_mgr_bmi_cancel(PVFS_id_gen_t id, void* user_ptr)
 		llu(stat_bmi_id_array[i]));
 #endif
 	    /* match; no steps needed to cancel, the op is already done */
+#ifdef __PVFS2_JOB_THREADED__
+	    pthread_cond_broadcast(&bmi_test_cond);
+#endif
 	    gen_mutex_unlock(&bmi_test_mutex);
 	    return(0);
 	}
@@ -600,7 +671,7 @@ int PINT_thread_mgr_bmi_cancel(PVFS_id_gen_t id, void* user_ptr)
 	gossip_err("WARNING: BMI cancel failed, proceeding anyway.\n");
 #ifdef __PVFS2_JOB_THREADED__
     /* release waiting testcontext thread */
-    pthread_cond_signal(&bmi_test_cond);
+    pthread_cond_broadcast(&bmi_test_cond);
 #endif
     gen_mutex_unlock(&bmi_test_mutex);
     return(ret);
@@ -622,6 +693,7 @@ int PINT_thread_mgr_trove_stop(void)
 	trove_thread_running = 0;
         gen_mutex_unlock(&trove_mutex);
 #ifdef __PVFS2_JOB_THREADED__
+        trove_thread_wake();
 	pthread_join(trove_thread_id, NULL);
 #endif
 #ifdef __PVFS2_TROVE_SUPPORT__
@@ -656,6 +728,7 @@ int PINT_thread_mgr_bmi_stop(void)
         gen_mutex_unlock(&bmi_thread_running_mutex);
         gen_mutex_unlock(&bmi_mutex);
 #ifdef __PVFS2_JOB_THREADED__
+        bmi_thread_wake();
 	pthread_join(bmi_thread_id, NULL);
 #endif
 	BMI_close_context(global_bmi_context);
@@ -705,15 +778,18 @@ int PINT_thread_mgr_trove_cancel(PVFS_id_gen_t id,
      * progress
      */
     gen_mutex_lock(&trove_test_mutex);
+    ++trove_test_cancel_waiter;
     while(trove_test_flag == 1)
     {
 #ifdef __PVFS2_JOB_THREADED__
+        trove_thread_wake();
 	pthread_cond_wait(&trove_test_cond, &trove_test_mutex);
 #else
 	/* this condition shouldn't be possible without threads */
 	assert(0);
 #endif
     }
+    --trove_test_cancel_waiter;
 
     /* iterate down list of pending completions, to see if the caller is
      * trying to cancel one of them
@@ -732,6 +808,9 @@ int PINT_thread_mgr_trove_cancel(PVFS_id_gen_t id,
 		llu(stat_trove_id_array[i]));
 #endif
 	    /* match; no steps needed to cancel, the op is already done */
+#ifdef __PVFS2_JOB_THREADED__
+	    pthread_cond_broadcast(&trove_test_cond);
+#endif
 	    gen_mutex_unlock(&trove_test_mutex);
 	    return(0);
 	}
@@ -743,6 +822,10 @@ int PINT_thread_mgr_trove_cancel(PVFS_id_gen_t id,
 #else
     ret = 0;
     assert(0);
+#endif
+#ifdef __PVFS2_JOB_THREADED__
+    /* release waiting testcontext thread */
+    pthread_cond_broadcast(&trove_test_cond);
 #endif
     gen_mutex_unlock(&trove_test_mutex);
     return(ret);
@@ -810,6 +893,8 @@ int PINT_thread_mgr_dev_unexp_handler(
 int PINT_thread_mgr_bmi_unexp_handler(
     void (*fn)(struct BMI_unexpected_info* unexp))
 {
+    int wake GCC_UNUSED;
+
     /* sanity check */
     assert(fn != 0);
 
@@ -822,7 +907,19 @@ int PINT_thread_mgr_bmi_unexp_handler(
     }
     bmi_unexp_fn = fn;
     bmi_unexp_count++;
+    wake = (bmi_unexp_count == 1);
     gen_mutex_unlock(&bmi_mutex);
+
+#ifdef __PVFS2_JOB_THREADED__
+    /* unexpected messages that arrived while nobody was waiting for them
+     * are queued in BMI; the thread must not sleep on the sockets before
+     * picking them up
+     */
+    if(wake)
+    {
+        bmi_thread_wake();
+    }
+#endif
     return(0);
 }
 
@@ -17,7 +17,8 @@
 
 enum PVFS_coll_getinfo_options_e
 {
-    PVFS_COLLECTION_STATFS = 1
+    PVFS_COLLECTION_STATFS = 1,
+    PVFS_COLLECTION_STARTUP_PHASE = 2  /* int, a PVFS_server_startup_phase */
 };
 typedef enum PVFS_coll_getinfo_options_e PVFS_coll_getinfo_options;
 
@@ -377,7 +377,8 @@ struct TROVE_bstream_ops alt_aio_bstream_ops =
     alt_aio_bstream_read_list,
     alt_aio_bstream_write_list,
     dbpf_bstream_flush,
-    NULL
+    NULL,
+    dbpf_bstream_seek
 };
 
 /*
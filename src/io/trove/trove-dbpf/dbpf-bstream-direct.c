@@ -1387,7 +1387,8 @@ struct TROVE_bstream_ops dbpf_bstream_direct_ops =
     dbpf_bstream_direct_read_list,
     dbpf_bstream_direct_write_list,
     dbpf_bstream_direct_flush,
-    dbpf_bstream_direct_cancel
+    dbpf_bstream_direct_cancel,
+    dbpf_bstream_seek
 };
 
 static int dbpf_bstream_get_extents(
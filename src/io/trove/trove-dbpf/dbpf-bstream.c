@@ -26,6 +26,7 @@
 #include "dbpf-attr-cache.h"
 #include "pint-event.h"
 #include "dbpf-open-cache.h"
+#include "dbpf-readahead.h"
 #include "dbpf-sync.h"
 
 #include "dbpf-alt-aio.h"
@@ -874,6 +875,13 @@ inline int dbpf_bstream_rw_list(TROVE_coll_id coll_id,
     }
     q_op_p->op.u.b_rw_list.fd = q_op_p->op.u.b_rw_list.open_ref.fd;
 
+    if (opcode == LIO_READ)
+    {
+        dbpf_readahead_note_read(coll_p, handle, q_op_p->op.u.b_rw_list.fd,
+                                 stream_offset_array, stream_size_array,
+                                 stream_count);
+    }
+
     /*
       if we're doing an i/o write, remove the cached attribute for
       this handle if it's present
@@ -1455,6 +1463,124 @@ int dbpf_bstream_resize(TROVE_coll_id coll_id,
     return 0;
 }
 
+static int dbpf_bstream_seek_op_svc(struct dbpf_op *op_p)
+{
+    int ret;
+    struct open_cache_ref open_ref;
+    struct stat statbuf;
+    TROVE_offset offset = *op_p->u.b_seek.offset_p;
+    int seek_data = (op_p->u.b_seek.whence == TROVE_SEEK_DATA);
+    off_t found = -1;
+    int have_answer = 0;
+
+    ret = dbpf_open_cache_get(
+        op_p->coll_p->coll_id, op_p->handle,
+        DBPF_FD_BUFFERED_READ, &open_ref);
+    if (ret == -TROVE_ENOENT)
+    {
+        /* the bstream has never been written; it is all hole */
+        *op_p->u.b_seek.offset_p = seek_data ? -1 : offset;
+        return DBPF_OP_COMPLETE;
+    }
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    found = lseek(open_ref.fd, offset, seek_data ? SEEK_DATA : SEEK_HOLE);
+    if (found >= 0)
+    {
+        have_answer = 1;
+    }
+    else if (errno == ENXIO)
+    {
+        /* at or past the end of the bstream */
+        found = seek_data ? -1 : offset;
+        have_answer = 1;
+    }
+    else if (errno != EINVAL)
+    {
+        ret = -trove_errno_to_trove_error(errno);
+        dbpf_open_cache_put(&open_ref);
+        return ret;
+    }
+#endif
+
+    if (!have_answer)
+    {
+        /* the underlying file system can't tell; treat everything up to
+         * the end of the bstream as data
+         */
+        if (fstat(open_ref.fd, &statbuf) < 0)
+        {
+            ret = -trove_errno_to_trove_error(errno);
+            dbpf_open_cache_put(&open_ref);
+            return ret;
+        }
+        if (offset >= statbuf.st_size)
+        {
+            found = seek_data ? -1 : offset;
+        }
+        else
+        {
+            found = seek_data ? offset : statbuf.st_size;
+        }
+    }
+
+    dbpf_open_cache_put(&open_ref);
+
+    *op_p->u.b_seek.offset_p = found;
+    return DBPF_OP_COMPLETE;
+}
+
+int dbpf_bstream_seek(TROVE_coll_id coll_id,
+                      TROVE_handle handle,
+                      TROVE_offset *inout_offset_p,
+                      int whence,
+                      TROVE_ds_flags flags,
+                      void *user_ptr,
+                      TROVE_context_id context_id,
+                      TROVE_op_id *out_op_id_p,
+                      PVFS_hint hints)
+{
+    dbpf_queued_op_t *q_op_p = NULL;
+    struct dbpf_collection *coll_p = NULL;
+
+    if (*inout_offset_p < 0 ||
+        (whence != TROVE_SEEK_DATA && whence != TROVE_SEEK_HOLE))
+    {
+        return -TROVE_EINVAL;
+    }
+
+    coll_p = dbpf_collection_find_registered(coll_id);
+    if (coll_p == NULL)
+    {
+        return -TROVE_EINVAL;
+    }
+
+    q_op_p = dbpf_queued_op_alloc();
+    if (q_op_p == NULL)
+    {
+        return -TROVE_ENOMEM;
+    }
+
+    dbpf_queued_op_init(q_op_p,
+                        BSTREAM_SEEK,
+                        handle,
+                        coll_p,
+                        dbpf_bstream_seek_op_svc,
+                        user_ptr,
+                        flags,
+                        context_id);
+
+    q_op_p->op.u.b_seek.offset_p = inout_offset_p;
+    q_op_p->op.u.b_seek.whence = whence;
+    *out_op_id_p = dbpf_queued_op_queue(q_op_p);
+
+    return 0;
+}
+
 struct TROVE_bstream_ops dbpf_bstream_ops =
 {
     dbpf_bstream_read_at,
@@ -1464,7 +1590,8 @@ struct TROVE_bstream_ops dbpf_bstream_ops =
     dbpf_bstream_read_list,
     dbpf_bstream_write_list,
     dbpf_bstream_flush,
-    dbpf_bstream_cancel
+    dbpf_bstream_cancel,
+    dbpf_bstream_seek
 };
 
 /*
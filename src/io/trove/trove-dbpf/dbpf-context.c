@@ -15,6 +15,12 @@
 static gen_mutex_t dbpf_context_mutex = GEN_MUTEX_INITIALIZER;
 dbpf_op_queue_p dbpf_completion_queue_array[TROVE_MAX_CONTEXTS] = {NULL};
 gen_mutex_t dbpf_completion_queue_array_mutex[TROVE_MAX_CONTEXTS];
+/* set by dbpf_wake_context(), consumed by the next testcontext */
+int dbpf_completion_wake_array[TROVE_MAX_CONTEXTS] = {0};
+
+#ifdef __PVFS2_TROVE_THREADED__
+extern pthread_cond_t dbpf_op_completed_cond;
+#endif
 
 int dbpf_open_context(
     TROVE_coll_id coll_id,
@@ -53,6 +59,7 @@ int dbpf_open_context(
 	return -ENOMEM;
     }
     gen_mutex_init(&dbpf_completion_queue_array_mutex[context_index]);
+    dbpf_completion_wake_array[context_index] = 0;
 
     *context_id = context_index;
     gen_mutex_unlock(&dbpf_context_mutex);
@@ -90,6 +97,34 @@ int dbpf_close_context(
     return 0;
 }
 
+/* dbpf_wake_context()
+ *
+ * the testcontext functions wait on the completion condition until an
+ * operation completes; this lets another thread make them return early,
+ * e.g. to cancel an operation or to stop the thread calling them
+ */
+int dbpf_wake_context(
+    TROVE_coll_id coll_id,
+    TROVE_context_id context_id)
+{
+#ifdef __PVFS2_TROVE_THREADED__
+    gen_mutex_lock(&dbpf_context_mutex);
+    if (!dbpf_completion_queue_array[context_id])
+    {
+        gen_mutex_unlock(&dbpf_context_mutex);
+        return -TROVE_EINVAL;
+    }
+    gen_mutex_lock(&dbpf_completion_queue_array_mutex[context_id]);
+    dbpf_completion_wake_array[context_id] = 1;
+    pthread_cond_broadcast(&dbpf_op_completed_cond);
+    gen_mutex_unlock(&dbpf_completion_queue_array_mutex[context_id]);
+    gen_mutex_unlock(&dbpf_context_mutex);
+    return 0;
+#else
+    return -TROVE_ENOSYS;
+#endif
+}
+
 /* dbpf_context_ops
  *
  * Structure holding pointers to all the context operations functions
@@ -98,5 +133,6 @@ int dbpf_close_context(
 struct TROVE_context_ops dbpf_context_ops =
 {
     dbpf_open_context,
-    dbpf_close_context
+    dbpf_close_context,
+    dbpf_wake_context
 };
@@ -23,6 +23,10 @@ int dbpf_close_context(
     TROVE_coll_id coll_id,
     TROVE_context_id context_id);
 
+int dbpf_wake_context(
+    TROVE_coll_id coll_id,
+    TROVE_context_id context_id);
+
 #if defined(__cplusplus)
 }
 #endif
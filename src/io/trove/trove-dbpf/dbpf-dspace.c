@@ -31,6 +31,7 @@
 #include "dbpf-op-queue.h"
 #include "dbpf-attr-cache.h"
 #include "dbpf-open-cache.h"
+#include "dbpf-readahead.h"
 
 #define TROVE_DEFAULT_DB_PAGESIZE 512
 
@@ -45,6 +46,7 @@
 extern pthread_cond_t dbpf_op_completed_cond;
 extern dbpf_op_queue_p dbpf_completion_queue_array[TROVE_MAX_CONTEXTS];
 extern gen_mutex_t dbpf_completion_queue_array_mutex[TROVE_MAX_CONTEXTS];
+extern int dbpf_completion_wake_array[TROVE_MAX_CONTEXTS];
 #else
 extern struct qlist_head dbpf_op_queue;
 extern gen_mutex_t dbpf_op_queue_mutex;
@@ -538,6 +540,7 @@ static int remove_one_handle(TROVE_object_ref ref,
      * error if this fails (may not have ever been created)
      */
     ret = dbpf_open_cache_remove(coll_p->coll_id, ref.handle);
+    dbpf_readahead_forget(coll_p->coll_id, ref.handle);
 
     /* remove the keyval entries for this handle if any exist.
      * this way seems a bit messy to me, i.e. we're operating
@@ -1646,13 +1649,15 @@ static int dbpf_dspace_testcontext(
     /*
       check completion queue for any completed ops and return
       them in the provided ds_id_array (up to inout_count_p).
-      otherwise, cond_timedwait for max_idle_time_ms.
+      otherwise, cond_timedwait for max_idle_time_ms, or until
+      dbpf_wake_context() is called on this context.
 
       we will only sleep if there is nothing to do; otherwise 
       we return whatever we find ASAP
     */
     gen_mutex_lock(context_mutex);
-    if (dbpf_op_queue_empty(dbpf_completion_queue_array[context_id]))
+    if (dbpf_op_queue_empty(dbpf_completion_queue_array[context_id]) &&
+        !dbpf_completion_wake_array[context_id] && max_idle_time_ms > 0)
     {
         struct timeval base;
         struct timespec wait_time;
@@ -1663,14 +1668,22 @@ static int dbpf_dspace_testcontext(
             (max_idle_time_ms / 1000);
         wait_time.tv_nsec = base.tv_usec * 1000 + 
             ((max_idle_time_ms % 1000) * 1000000);
-        if (wait_time.tv_nsec > 1000000000)
+        if (wait_time.tv_nsec >= 1000000000)
         {
             wait_time.tv_nsec = wait_time.tv_nsec - 1000000000;
             wait_time.tv_sec++;
         }
 
-        ret = pthread_cond_timedwait(&dbpf_op_completed_cond,
-                                     context_mutex, &wait_time);
+        /* the condition is shared by all contexts, so keep waiting
+         * through wakeups meant for somebody else
+         */
+        do
+        {
+            ret = pthread_cond_timedwait(&dbpf_op_completed_cond,
+                                         context_mutex, &wait_time);
+        } while (ret == 0 &&
+                 dbpf_op_queue_empty(dbpf_completion_queue_array[context_id])
+                 && !dbpf_completion_wake_array[context_id]);
 
         if (ret == ETIMEDOUT)
         {
@@ -1678,11 +1691,13 @@ static int dbpf_dspace_testcontext(
              * no point in checking the completion queue, we should just
              * return
              */
+            dbpf_completion_wake_array[context_id] = 0;
             gen_mutex_unlock(context_mutex);
             *inout_count_p = 0;
             return(0);
         }
     }
+    dbpf_completion_wake_array[context_id] = 0;
 
     while(!dbpf_op_queue_empty(dbpf_completion_queue_array[context_id]) &&
           (out_count < limit))
@@ -39,6 +39,7 @@
 #include "trove-handle-mgmt.h"
 #include "gossip.h"
 #include "dbpf-open-cache.h"
+#include "dbpf-readahead.h"
 #include "pint-util.h"
 #include "dbpf-sync.h"
 
@@ -67,6 +68,7 @@ extern gen_mutex_t dbpf_attr_cache_mutex;
 
 extern int TROVE_db_cache_size_bytes;
 extern int TROVE_shm_key_hint;
+extern int TROVE_staged_startup;
 
 struct dbpf_storage *my_storage_p = NULL;
 static int start_directio_threads(void);
@@ -84,6 +86,12 @@ static int PINT_dbpf_io_completion_callback(PINT_context_id ctx_id,
 
 static int dbpf_db_create(char *dbname);
 static int dbpf_mkpath(char *pathname, mode_t mode);
+static void dbpf_collection_take_handle_snapshot(
+    struct dbpf_collection *coll_p);
+static void dbpf_collection_put_handle_snapshot(
+    struct dbpf_collection *coll_p);
+static int dbpf_collection_start_staged(
+    struct dbpf_collection *coll_p, char *handle_range_str);
 
 struct server_configuration_s *server_cfg=NULL;
 filesystem_configuration_s *cfg_fs=NULL;
@@ -110,6 +118,10 @@ int dbpf_collection_getinfo(TROVE_coll_id coll_id,
 
     switch(opt)
     {
+        case PVFS_COLLECTION_STARTUP_PHASE:
+            /* a failed ledger rebuild is reported, and stays in its phase */
+            *(int *)parameter = coll_p->startup_phase;
+            return (coll_p->startup_error ? coll_p->startup_error : 1);
         case PVFS_COLLECTION_STATFS:
             {
                 char path_name[PATH_MAX] = {0};
@@ -166,8 +178,32 @@ int dbpf_collection_setinfo(TROVE_method_id method_id,
                          "dbpf collection %d - Setting collection handle "
                          "ranges to %s\n", 
                          (int) coll_id, (char *)parameter);
-            ret = trove_set_handle_ranges(
-                coll_id, context_id, (char *)parameter);
+            ret = -TROVE_EINVAL;
+            if (coll && coll->handle_snapshot)
+            {
+                /* the snapshot saves iterating over every dataspace */
+                ret = trove_set_handle_ranges_from_snapshot(
+                    coll_id, (char *)parameter, coll->handle_snapshot,
+                    coll->handle_snapshot_len);
+                gossip_debug(GOSSIP_TROVE_DEBUG,
+                             "dbpf collection %d - handle ledger snapshot "
+                             "of %llu bytes %s\n", (int) coll_id,
+                             llu(coll->handle_snapshot_len),
+                             (ret == 0 ? "loaded" : "unusable, scanning"));
+                free(coll->handle_snapshot);
+                coll->handle_snapshot = NULL;
+            }
+            if (coll && TROVE_staged_startup)
+            {
+                /* scan in the background if the snapshot did not do */
+                ret = dbpf_collection_start_staged(
+                    coll, (ret == 0 ? NULL : (char *)parameter));
+            }
+            else if (ret != 0)
+            {
+                ret = trove_set_handle_ranges(
+                    coll_id, context_id, (char *)parameter);
+            }
             break;
         case TROVE_COLLECTION_HANDLE_TIMEOUT:
             gossip_debug(GOSSIP_TROVE_DEBUG, 
@@ -248,6 +284,14 @@ int dbpf_collection_setinfo(TROVE_method_id method_id,
             coll->immediate_completion = *(int *)parameter;
             ret = 0;
             break;
+        case TROVE_COLLECTION_READAHEAD_SIZE:
+            gossip_debug(GOSSIP_TROVE_DEBUG, 
+                         "dbpf collection %d - Setting readahead size "
+                         "to %d\n", (int) coll_id, *(int *)parameter);
+            assert(coll);
+            coll->readahead_size = *(int *)parameter;
+            ret = 0;
+            break;
         case TROVE_DIRECTIO_THREADS_NUM:
             trove_directio_threads_num = *(int *)parameter;
             ret = 0;
@@ -542,6 +586,7 @@ static int dbpf_initialize(char *data_path,
     my_storage_p = sto_p;
 
     dbpf_open_cache_initialize();
+    dbpf_readahead_initialize();
 
     return dbpf_thread_initialize();
 }
@@ -660,6 +705,7 @@ int dbpf_finalize(void)
 
     dbpf_thread_finalize();
     dbpf_open_cache_finalize();
+    dbpf_readahead_finalize();
     gen_mutex_lock(&dbpf_attr_cache_mutex);
     dbpf_attr_cache_finalize();
     gen_mutex_unlock(&dbpf_attr_cache_mutex);
@@ -1368,6 +1414,22 @@ int dbpf_collection_clear(TROVE_coll_id coll_id)
        return 0;
     }
 
+    if (coll_p->startup_thread_running)
+    {
+        /* an unfinished scan leaves the ranges unset: no snapshot */
+        coll_p->startup_cancel = 1;
+        trove_cancel_handle_ranges(coll_id);
+        pthread_join(coll_p->startup_thread, NULL);
+        coll_p->startup_thread_running = 0;
+    }
+    free(coll_p->startup_ranges);
+
+    if (coll_p->coll_attr_db != NULL)
+    {
+        dbpf_collection_put_handle_snapshot(coll_p);
+    }
+    free(coll_p->handle_snapshot);
+
     if ( (coll_p->coll_attr_db != NULL ) &&
          (ret = dbpf_db_sync(coll_p->coll_attr_db))
         != 0)
@@ -1664,10 +1726,20 @@ int dbpf_collection_lookup(char *collname,
     coll_p->c_low_watermark = 1;
     coll_p->meta_sync_enabled = 1; /* MUST be 1 !*/
 
+    dbpf_collection_take_handle_snapshot(coll_p);
+
     dbpf_collection_register(coll_p);
     *out_coll_id_p = coll_p->coll_id;
 
+    if (TROVE_staged_startup)
+    {
+        /* the rest happens once the handle ranges are set */
+        coll_p->startup_phase = PVFS_SERVER_STARTUP_LEDGER;
+        return 1;
+    }
+
     clear_stranded_bstreams(coll_p->coll_id);
+    coll_p->startup_phase = PVFS_SERVER_STARTUP_READY;
 
     return 1;
 }
@@ -1796,6 +1868,204 @@ struct dbpf_storage *dbpf_storage_lookup(
     return sto_p;
 }
 
+/* dbpf_collection_staged_startup()
+ *
+ * Internal function.
+ *
+ * Runs in its own thread once the handle ranges of a collection opened
+ * with TROVE_STAGED_STARTUP are set.  Rebuilds the handle ledger by
+ * scanning the dataspaces if there was no usable snapshot, then clears
+ * out stranded bstreams, moving startup_phase along as it goes.
+ */
+static void *dbpf_collection_staged_startup(void *arg)
+{
+    struct dbpf_collection *coll_p = arg;
+    TROVE_context_id context_id;
+    int ret;
+
+    if (coll_p->startup_ranges && !coll_p->startup_cancel)
+    {
+        ret = trove_open_context(coll_p->coll_id, &context_id);
+        if (ret == 0)
+        {
+            ret = trove_set_handle_ranges(coll_p->coll_id, context_id,
+                                          coll_p->startup_ranges);
+            trove_close_context(coll_p->coll_id, context_id);
+        }
+        if (ret == -TROVE_ECANCEL || coll_p->startup_cancel)
+        {
+            return NULL;
+        }
+        if (ret != 0)
+        {
+            gossip_err("Error: could not rebuild the handle ledger of "
+                       "collection %d; it will not accept changes.\n",
+                       (int) coll_p->coll_id);
+            coll_p->startup_error = (ret < 0 ? ret : -TROVE_EINVAL);
+            return NULL;
+        }
+        gossip_debug(GOSSIP_TROVE_DEBUG, "dbpf collection %d - handle "
+                     "ledger rebuilt\n", (int) coll_p->coll_id);
+    }
+
+    coll_p->startup_phase = PVFS_SERVER_STARTUP_CLEANUP;
+    if (coll_p->startup_cancel)
+    {
+        return NULL;
+    }
+    clear_stranded_bstreams(coll_p->coll_id);
+    coll_p->startup_phase = PVFS_SERVER_STARTUP_READY;
+
+    gossip_debug(GOSSIP_TROVE_DEBUG, "dbpf collection %d - startup "
+                 "complete\n", (int) coll_p->coll_id);
+    return NULL;
+}
+
+/* dbpf_collection_start_staged()
+ *
+ * Internal function.
+ *
+ * Starts the thread that finishes opening a collection.
+ * handle_range_str is the handle ranges to scan for, or NULL if the
+ * ledger was already loaded from a snapshot.
+ *
+ * returns 0 on success, -TROVE_errno on failure
+ */
+static int dbpf_collection_start_staged(
+    struct dbpf_collection *coll_p, char *handle_range_str)
+{
+    int ret;
+
+    if (coll_p->startup_thread_running)
+    {
+        return -TROVE_EBUSY;
+    }
+
+    coll_p->startup_phase = (handle_range_str ? PVFS_SERVER_STARTUP_LEDGER :
+                             PVFS_SERVER_STARTUP_CLEANUP);
+    if (handle_range_str)
+    {
+        coll_p->startup_ranges = strdup(handle_range_str);
+        if (!coll_p->startup_ranges)
+        {
+            return -TROVE_ENOMEM;
+        }
+    }
+
+    ret = pthread_create(&coll_p->startup_thread, NULL,
+                         dbpf_collection_staged_startup, coll_p);
+    if (ret != 0)
+    {
+        free(coll_p->startup_ranges);
+        coll_p->startup_ranges = NULL;
+        return -trove_errno_to_trove_error(ret);
+    }
+    coll_p->startup_thread_running = 1;
+    return 0;
+}
+
+/* dbpf_collection_take_handle_snapshot()
+ *
+ * Internal function.
+ *
+ * Reads the handle ledger snapshot left by the last clean close of the
+ * collection and removes it from disk, so that if the collection is not
+ * closed cleanly this time the next open scans the dataspaces instead
+ * of trusting a stale snapshot.
+ */
+static void dbpf_collection_take_handle_snapshot(
+    struct dbpf_collection *coll_p)
+{
+    struct dbpf_data key, data;
+    uint64_t header[2];
+    size_t len;
+    int ret;
+
+    key.data = TROVE_DBPF_HANDLE_LEDGER_KEY;
+    key.len = strlen(TROVE_DBPF_HANDLE_LEDGER_KEY);
+
+    /* every snapshot starts with a 16 byte header; read that much to
+     * learn the full length */
+    data.data = header;
+    data.len = sizeof(header);
+    ret = dbpf_db_get(coll_p->coll_attr_db, &key, &data);
+    if (ret != 0 || data.len < sizeof(header))
+    {
+        return;
+    }
+
+    len = data.len;
+    coll_p->handle_snapshot = malloc(len);
+    if (coll_p->handle_snapshot)
+    {
+        data.data = coll_p->handle_snapshot;
+        data.len = len;
+        ret = dbpf_db_get(coll_p->coll_attr_db, &key, &data);
+        if (ret == 0 && data.len == len)
+        {
+            coll_p->handle_snapshot_len = len;
+        }
+        else
+        {
+            free(coll_p->handle_snapshot);
+            coll_p->handle_snapshot = NULL;
+        }
+    }
+
+    ret = dbpf_db_del(coll_p->coll_attr_db, &key);
+    if (ret == 0)
+    {
+        ret = dbpf_db_sync(coll_p->coll_attr_db);
+    }
+    if (ret != 0)
+    {
+        gossip_err("Failed to remove handle ledger snapshot: %s\n",
+                   strerror(ret));
+        free(coll_p->handle_snapshot);
+        coll_p->handle_snapshot = NULL;
+    }
+}
+
+/* dbpf_collection_put_handle_snapshot()
+ *
+ * Internal function.
+ *
+ * Stores a snapshot of the handles in use when the collection is
+ * closed, if its handle ranges were set, for the next open to load.
+ */
+static void dbpf_collection_put_handle_snapshot(
+    struct dbpf_collection *coll_p)
+{
+    struct dbpf_data key, data;
+    void *snapshot = NULL;
+    size_t snapshot_len = 0;
+    int ret;
+
+    if (trove_handle_get_snapshot(coll_p->coll_id,
+                                  &snapshot, &snapshot_len) != 0)
+    {
+        return;
+    }
+
+    key.data = TROVE_DBPF_HANDLE_LEDGER_KEY;
+    key.len = strlen(TROVE_DBPF_HANDLE_LEDGER_KEY);
+    data.data = snapshot;
+    data.len = snapshot_len;
+
+    ret = dbpf_db_put(coll_p->coll_attr_db, &key, &data);
+    if (ret != 0)
+    {
+        gossip_err("Failed to store handle ledger snapshot: %s\n",
+                   strerror(ret));
+    }
+    else
+    {
+        gossip_debug(GOSSIP_TROVE_DEBUG, "stored handle ledger snapshot "
+                     "of %llu bytes\n", llu(snapshot_len));
+    }
+    free(snapshot);
+}
+
 static int dbpf_mkpath(char *pathname, mode_t mode)
 {
     int ret = -TROVE_EINVAL;
@@ -1946,6 +2216,7 @@ static __dbpf_op_type_str_map_t s_dbpf_op_type_str_map[] =
     { BSTREAM_WRITE_LIST, "BSTREAM_WRITE_LIST" },
     { BSTREAM_VALIDATE, "BSTREAM_VALIDATE" },
     { BSTREAM_FLUSH, "BSTREAM_FLUSH" },
+    { BSTREAM_SEEK, "BSTREAM_SEEK" },
     { KEYVAL_READ, "KEYVAL_READ" },
     { KEYVAL_WRITE, "KEYVAL_WRITE" },
     { KEYVAL_REMOVE_KEY, "KEYVAL_REMOVE_KEY" },
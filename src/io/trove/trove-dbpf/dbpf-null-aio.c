@@ -395,7 +395,8 @@ struct TROVE_bstream_ops null_aio_bstream_ops =
     null_aio_bstream_read_list,
     null_aio_bstream_write_list,
     dbpf_bstream_flush,
-    NULL
+    NULL,
+    dbpf_bstream_seek
 };
 
 /*
@@ -0,0 +1,302 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Sequential stream detection and readahead for buffered bstream reads.
+ *
+ * Each datafile being read gets a stream entry that remembers where its
+ * last read started and ended.  A read that starts inside or right at the
+ * end of the previous one continues the stream; anything else resets it.
+ * Once a stream has continued twice in a row, the bytes past the current
+ * read are hinted to the kernel with posix_fadvise(WILLNEED), so the page
+ * cache fills while the client is still busy with the data it has.  The
+ * next hint is issued when reads get within half a window of the end of
+ * what was hinted, and each hint doubles the window up to the collection's
+ * readahead size.  This keeps the disk one window ahead of a sequential
+ * reader without the read waiting for the hint.
+ *
+ * The table is fixed size and LRU, like the open cache: a datafile that has
+ * not been read for a while loses its stream to a newer one.  Bytes served
+ * from a hinted range are counted as readahead hits, and hinted bytes that
+ * were never read before the stream reset or was dropped as waste.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "quicklist.h"
+#include "gen-locks.h"
+#include "pint-perf-counter.h"
+#include "dbpf-readahead.h"
+
+#define READAHEAD_STREAMS 64
+/* first window of a new stream, same as the usual kernel default */
+#define READAHEAD_MIN_WINDOW (128*1024)
+/* reads in a row that continue a stream before anything is hinted */
+#define READAHEAD_TRIGGER 2
+
+#define RA_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define RA_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+struct readahead_stream
+{
+    TROVE_coll_id coll_id;
+    TROVE_handle handle;
+
+    TROVE_offset last_start; /* start of the previous read */
+    TROVE_offset next;       /* end of the furthest read so far */
+    int seq_count;           /* reads in a row that continued the stream */
+    TROVE_size window;       /* size of the next hint */
+
+    TROVE_offset ra_start;   /* range hinted and not yet passed */
+    TROVE_offset ra_end;
+    TROVE_offset ra_used;    /* how far reads have come into that range */
+
+    struct qlist_head link;
+};
+
+/* "stream_list" is in LRU order, most recently read first */
+static QLIST_HEAD(stream_list);
+static QLIST_HEAD(free_list);
+static gen_mutex_t readahead_mutex = GEN_MUTEX_INITIALIZER;
+static struct readahead_stream prealloc[READAHEAD_STREAMS];
+
+static void stream_reset(struct readahead_stream *s, TROVE_size min_window);
+static TROVE_size stream_waste(struct readahead_stream *s);
+
+void dbpf_readahead_initialize(void)
+{
+    int i;
+
+    gen_mutex_lock(&readahead_mutex);
+    INIT_QLIST_HEAD(&stream_list);
+    INIT_QLIST_HEAD(&free_list);
+    memset(prealloc, 0, sizeof(prealloc));
+    for (i = 0; i < READAHEAD_STREAMS; i++)
+    {
+        qlist_add_tail(&prealloc[i].link, &free_list);
+    }
+    gen_mutex_unlock(&readahead_mutex);
+}
+
+void dbpf_readahead_finalize(void)
+{
+    gen_mutex_lock(&readahead_mutex);
+    INIT_QLIST_HEAD(&stream_list);
+    INIT_QLIST_HEAD(&free_list);
+    gen_mutex_unlock(&readahead_mutex);
+}
+
+/* dbpf_readahead_note_read()
+ *
+ * Called as a buffered list read on the given datafile is posted.  Updates
+ * the datafile's stream and, if it is sequential and reads are catching up
+ * with what was hinted, hints the next window on fd.
+ */
+void dbpf_readahead_note_read(
+    struct dbpf_collection *coll_p,
+    TROVE_handle handle,
+    int fd,
+    TROVE_offset *stream_offset_array,
+    TROVE_size *stream_size_array,
+    int stream_count)
+{
+    struct qlist_head *iterator;
+    struct readahead_stream *s = NULL, *tmp;
+    TROVE_offset start, end, from = 0;
+    TROVE_size max_window, min_window, len = 0;
+    TROVE_size hit = 0, waste = 0;
+    struct stat statbuf;
+    int i;
+
+    max_window = coll_p->readahead_size;
+    if (max_window <= 0 || stream_count < 1 || fd < 0)
+    {
+        return;
+    }
+    min_window = RA_MIN(max_window, READAHEAD_MIN_WINDOW);
+
+    start = stream_offset_array[0];
+    end = start;
+    for (i = 0; i < stream_count; i++)
+    {
+        start = RA_MIN(start, stream_offset_array[i]);
+        end = RA_MAX(end, stream_offset_array[i] + stream_size_array[i]);
+    }
+
+    gen_mutex_lock(&readahead_mutex);
+
+    qlist_for_each(iterator, &stream_list)
+    {
+        tmp = qlist_entry(iterator, struct readahead_stream, link);
+        if (tmp->handle == handle && tmp->coll_id == coll_p->coll_id)
+        {
+            s = tmp;
+            break;
+        }
+    }
+
+    if (s)
+    {
+        qlist_del(&s->link);
+    }
+    else
+    {
+        if (!qlist_empty(&free_list))
+        {
+            s = qlist_entry(free_list.next, struct readahead_stream, link);
+        }
+        else
+        {
+            /* take over the least recently read stream */
+            s = qlist_entry(stream_list.prev, struct readahead_stream, link);
+            waste += stream_waste(s);
+        }
+        qlist_del(&s->link);
+        s->coll_id = coll_p->coll_id;
+        s->handle = handle;
+        stream_reset(s, min_window);
+        s->last_start = -1;
+        s->next = -1;
+    }
+    qlist_add(&s->link, &stream_list);
+
+    /* bytes of this read that an earlier hint already asked for */
+    if (end > s->ra_start && start < s->ra_end)
+    {
+        TROVE_offset from_used = RA_MAX(start, s->ra_used);
+        TROVE_offset to_used = RA_MIN(end, s->ra_end);
+
+        from_used = RA_MAX(from_used, s->ra_start);
+        if (to_used > from_used)
+        {
+            hit = to_used - from_used;
+        }
+        s->ra_used = RA_MAX(s->ra_used, to_used);
+    }
+
+    if (s->next >= 0 && start >= s->last_start && start <= s->next)
+    {
+        s->seq_count++;
+    }
+    else
+    {
+        waste += stream_waste(s);
+        stream_reset(s, min_window);
+        s->next = end;
+    }
+    s->last_start = start;
+    s->next = RA_MAX(s->next, end);
+
+    if (s->seq_count >= READAHEAD_TRIGGER &&
+        s->ra_end - s->next < s->window / 2)
+    {
+        from = RA_MAX(s->ra_end, s->next);
+        len = s->window;
+        if (fstat(fd, &statbuf) == 0)
+        {
+            len = (from < statbuf.st_size) ?
+                RA_MIN(len, statbuf.st_size - from) : 0;
+        }
+        if (len > 0)
+        {
+            if (from > s->ra_end)
+            {
+                /* reads passed everything hinted before */
+                s->ra_start = from;
+                s->ra_used = from;
+            }
+            s->ra_end = from + len;
+            s->window = RA_MIN(s->window * 2, max_window);
+        }
+    }
+
+    gen_mutex_unlock(&readahead_mutex);
+
+    if (len > 0)
+    {
+        gossip_debug(GOSSIP_TROVE_DEBUG,
+                     "readahead: handle %llu, %lld bytes at %lld\n",
+                     llu(handle), lld(len), lld(from));
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(fd, from, len, POSIX_FADV_WILLNEED);
+#endif
+    }
+
+    if (hit)
+    {
+        PINT_perf_count(PINT_server_pc, PINT_PERF_READAHEAD_HIT,
+                        hit, PINT_PERF_ADD);
+    }
+    if (waste)
+    {
+        PINT_perf_count(PINT_server_pc, PINT_PERF_READAHEAD_WASTE,
+                        waste, PINT_PERF_ADD);
+    }
+}
+
+/* dbpf_readahead_forget()
+ *
+ * Drops the stream of a datafile that is being removed.
+ */
+void dbpf_readahead_forget(
+    TROVE_coll_id coll_id,
+    TROVE_handle handle)
+{
+    struct qlist_head *iterator, *scratch;
+    struct readahead_stream *s;
+    TROVE_size waste = 0;
+
+    gen_mutex_lock(&readahead_mutex);
+    qlist_for_each_safe(iterator, scratch, &stream_list)
+    {
+        s = qlist_entry(iterator, struct readahead_stream, link);
+        if (s->handle == handle && s->coll_id == coll_id)
+        {
+            waste = stream_waste(s);
+            qlist_del(&s->link);
+            qlist_add(&s->link, &free_list);
+            break;
+        }
+    }
+    gen_mutex_unlock(&readahead_mutex);
+
+    if (waste)
+    {
+        PINT_perf_count(PINT_server_pc, PINT_PERF_READAHEAD_WASTE,
+                        waste, PINT_PERF_ADD);
+    }
+}
+
+static void stream_reset(struct readahead_stream *s, TROVE_size min_window)
+{
+    s->seq_count = 0;
+    s->window = min_window;
+    s->ra_start = 0;
+    s->ra_end = 0;
+    s->ra_used = 0;
+}
+
+/* hinted bytes the stream has not read yet */
+static TROVE_size stream_waste(struct readahead_stream *s)
+{
+    TROVE_offset used = RA_MAX(s->ra_used, s->ra_start);
+
+    return (s->ra_end > used) ? s->ra_end - used : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,38 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#ifndef __DBPF_READAHEAD_H__
+#define __DBPF_READAHEAD_H__
+
+#include "trove.h"
+#include "dbpf.h"
+
+void dbpf_readahead_initialize(void);
+
+void dbpf_readahead_finalize(void);
+
+void dbpf_readahead_note_read(
+    struct dbpf_collection *coll_p,
+    TROVE_handle handle,
+    int fd,
+    TROVE_offset *stream_offset_array,
+    TROVE_size *stream_size_array,
+    int stream_count);
+
+void dbpf_readahead_forget(
+    TROVE_coll_id coll_id,
+    TROVE_handle handle);
+
+#endif /* __DBPF_READAHEAD_H__ */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -67,7 +67,10 @@ int dbpf_thread_finalize(void)
 {
     int ret = 0;
 #ifdef __PVFS2_TROVE_THREADED__
+    gen_mutex_lock(&dbpf_op_queue_mutex);
     dbpf_thread_running = 0;
+    pthread_cond_signal(&dbpf_op_incoming_cond);
+    gen_mutex_unlock(&dbpf_op_queue_mutex);
     ret = pthread_join(dbpf_thread, NULL);
 
     pthread_cond_destroy(&dbpf_op_completed_cond);
@@ -83,8 +86,9 @@ void *dbpf_thread_function(void *ptr)
 {
 #ifdef __PVFS2_TROVE_THREADED__
     int out_count = 0, op_queued_empty = 0, ret = 0;
-    struct timeval base;
+#ifndef __PVFS2_TROVE_AIO_THREADED__
     struct timespec wait_time;
+#endif
 
     gossip_debug(GOSSIP_TROVE_DEBUG, "dbpf_thread_function started\n");
 
@@ -123,26 +127,19 @@ void *dbpf_thread_function(void *ptr)
         }
         else
         {
-            /* compute how long to wait */
-            gettimeofday(&base, NULL);
-            wait_time.tv_sec = base.tv_sec +
-                (TROVE_DEFAULT_TEST_TIMEOUT / 1000);
-            wait_time.tv_nsec = base.tv_usec * 1000 + 
-                ((TROVE_DEFAULT_TEST_TIMEOUT % 1000) * 1000000);
-            if (wait_time.tv_nsec > 1000000000)
-            {
-                wait_time.tv_nsec = wait_time.tv_nsec - 1000000000;
-                wait_time.tv_sec++;
-            }
-
-            ret = pthread_cond_timedwait(&dbpf_op_incoming_cond,
-                                         &dbpf_op_queue_mutex,
-                                         &wait_time);
-            if( ret == EINVAL || ret == EPERM )
+            /* sleep until an op is queued or we are asked to stop;
+             * both signal the incoming condition
+             */
+            while (qlist_empty(&dbpf_op_queue) && dbpf_thread_running)
             {
-                /* an error other than timeout occured */
-                gossip_debug(GOSSIP_TROVE_DEBUG, "%s: pthread_cond_timedwait "
-                             "returned an error\n", __func__);
+                ret = pthread_cond_wait(&dbpf_op_incoming_cond,
+                                        &dbpf_op_queue_mutex);
+                if (ret != 0)
+                {
+                    gossip_debug(GOSSIP_TROVE_DEBUG, "%s: pthread_cond_wait "
+                                 "returned an error\n", __func__);
+                    break;
+                }
             }
             gen_mutex_unlock(&dbpf_op_queue_mutex);
         }
@@ -46,9 +46,12 @@ do {                                                                    \
 } while(0)
 
 #ifdef __PVFS2_TROVE_THREADED__
+/* every context waits on the same condition; wake them all so the one
+ * owning the completion is sure to see it
+ */
 #define DBPF_COMPLETION_SIGNAL()                                   \
 do {                                                               \
-    pthread_cond_signal(&dbpf_op_completed_cond);                  \
+    pthread_cond_broadcast(&dbpf_op_completed_cond);               \
 } while(0)
 #else
 #define DBPF_COMPLETION_SIGNAL()  do { } while (0)
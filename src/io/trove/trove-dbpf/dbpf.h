@@ -37,6 +37,11 @@ extern "C" {
 
 #define LAST_HANDLE_STRING                                  "last_handle"
 
+/* collection attribute holding a snapshot of the handles in use, written
+ * when the collection is closed cleanly and removed again when it is
+ * opened; see trove_handle_get_snapshot */
+#define TROVE_DBPF_HANDLE_LEDGER_KEY                "trove-dbpf-handle-ledger"
+
 #define TROVE_DB_MODE                                                 0600
 #define TROVE_FD_MODE 0600
 
@@ -278,6 +283,19 @@ struct dbpf_collection
     TROVE_handle root_dir_handle;
     struct dbpf_storage *storage;
     struct handle_ledger *free_handles;
+    /* handle ledger snapshot read when the collection was opened, until
+     * the handle ranges are set */
+    void *handle_snapshot;
+    size_t handle_snapshot_len;
+    /* with TROVE_STAGED_STARTUP, the thread that rebuilds the handle
+     * ledger and clears stranded bstreams after the collection is
+     * opened; startup_phase is a PVFS_server_startup_phase */
+    pthread_t startup_thread;
+    int startup_thread_running;
+    int startup_phase;
+    int startup_error;
+    int startup_cancel;
+    char *startup_ranges;
     PINT_dbpf_keyval_pcache * pcache; /* the position cache for iterators */
 
     /* used by dbpf_collection.c calls to maintain list of collections */
@@ -290,6 +308,8 @@ struct dbpf_collection
      * If this option is on we don't queue ops or use threads.
      */
     int immediate_completion;
+    /* largest readahead window for sequential bstream reads, 0 for none */
+    int readahead_size;
 };
 
 /* Structure stored as data in collections database with collection
@@ -437,6 +457,12 @@ struct dbpf_bstream_resize_op
     void *queued_op_ptr;
 };
 
+struct dbpf_bstream_seek_op
+{
+    TROVE_offset *offset_p;
+    int whence;
+};
+
 /* Used to maintain state of partial processing of a listio operation
  */
 struct bstream_listio_state
@@ -537,6 +563,7 @@ enum dbpf_op_type
     BSTREAM_WRITE_LIST,
     BSTREAM_VALIDATE,
     BSTREAM_FLUSH,
+    BSTREAM_SEEK,
     KEYVAL_READ = KEYVAL_OP_TYPE,
     KEYVAL_WRITE,
     KEYVAL_REMOVE_KEY,
@@ -617,6 +644,7 @@ struct dbpf_op
         struct dbpf_dspace_setattr_op d_setattr;
         struct dbpf_bstream_rw_list_op b_rw_list;
         struct dbpf_bstream_resize_op b_resize;
+        struct dbpf_bstream_seek_op b_seek;
         struct dbpf_keyval_read_op k_read;
         struct dbpf_keyval_write_op k_write;
         struct dbpf_keyval_remove_op k_remove;
@@ -849,6 +877,16 @@ int dbpf_bstream_resize(TROVE_coll_id coll_id,
                         TROVE_op_id *out_op_id_p,
                         PVFS_hint  hints);
 
+int dbpf_bstream_seek(TROVE_coll_id coll_id,
+                      TROVE_handle handle,
+                      TROVE_offset *inout_offset_p,
+                      int whence,
+                      TROVE_ds_flags flags,
+                      void *user_ptr,
+                      TROVE_context_id context_id,
+                      TROVE_op_id *out_op_id_p,
+                      PVFS_hint  hints);
+
 int dbpf_bstream_validate(TROVE_coll_id coll_id,
                           TROVE_handle handle,
                           TROVE_ds_flags flags,
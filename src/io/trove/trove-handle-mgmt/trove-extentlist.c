@@ -549,24 +549,46 @@ int extentlist_set_purgatory(struct timeval * timeout)
  */
 int extentlist_handle_remove(struct TROVE_handle_extentlist *elist,
                              TROVE_handle handle)
+{
+    return extentlist_range_remove(elist, handle, handle);
+}
+
+/* extentlist_range_remove()
+ *
+ * removes the run of handles first..last from the free list.  the run
+ * must lie entirely within one extent of the list, which is trimmed or
+ * split into two as necessary.
+ *
+ * returns 0 on success, -1 on failure (not all present in one extent).
+ */
+int extentlist_range_remove(struct TROVE_handle_extentlist *elist,
+                            TROVE_handle first,
+                            TROVE_handle last)
 {
     int ret = -1;
     TROVE_handle key_handle, last_handle;
     struct TROVE_handle_extent *old_e, *new_e;
 
+    if (first > last)
+    {
+        return -1;
+    }
+
     ret = avltree_extent_search(
-        elist->index, handle, &key_handle, &last_handle);
-    if (ret == -1)
+        elist->index, first, &key_handle, &last_handle);
+    if ((ret == -1) || (last_handle < last))
     {
-        return ret;
+        return -1;
     }
 
     ret = avlremove(&(elist->index), key_handle);
     assert(ret != 0);
+    elist->num_handles -= (last - first + 1);
 
-    if (key_handle == last_handle)
+    if ((key_handle == first) && (last_handle == last))
     {
-        return 0; /* done, length 1 extent now gone */
+        elist->num_extents--;
+        return 0; /* done, the whole extent is now gone */
     }
 
     if ((old_e = (struct TROVE_handle_extent *)malloc(
@@ -575,16 +597,16 @@ int extentlist_handle_remove(struct TROVE_handle_extentlist *elist,
         assert(0);
     }
 
-    if (key_handle == handle)
+    if (key_handle == first)
     {
-        old_e->first = key_handle + 1;
+        old_e->first = last + 1;
         old_e->last  = last_handle;
         avlinsert(&(elist->index), old_e);
     }
-    else if (last_handle == handle)
+    else if (last_handle == last)
     {
         old_e->first = key_handle;
-        old_e->last  = last_handle - 1;
+        old_e->last  = first - 1;
         avlinsert(&(elist->index), old_e);
     }
     else
@@ -596,12 +618,60 @@ int extentlist_handle_remove(struct TROVE_handle_extentlist *elist,
             assert(0);
         }
         old_e->first = key_handle;
-        old_e->last  = handle - 1;
-        new_e->first = handle + 1;
+        old_e->last  = first - 1;
+        new_e->first = last + 1;
         new_e->last  = last_handle;
         avlinsert(&(elist->index), old_e);
         avlinsert(&(elist->index), new_e);
+        elist->num_extents++;
+    }
+    return 0;
+}
+
+/* extentlist_get_extents()
+ *
+ * returns a newly allocated array of every extent in the list, in
+ * ascending order, and the number of extents in it
+ *
+ * returns 0 on success, -1 if out of memory
+ */
+static TROVE_extent *g_extent_out = NULL;
+
+static void extent_tally(struct avlnode *n, int param, int depth)
+{
+    g_counter++;
+}
+
+static void extent_collect(struct avlnode *n, int param, int depth)
+{
+    struct TROVE_handle_extent *e = (struct TROVE_handle_extent *)(n->d);
+    g_extent_out[g_counter].first = e->first;
+    g_extent_out[g_counter].last = e->last;
+    g_counter++;
+}
+
+int extentlist_get_extents(
+    struct TROVE_handle_extentlist *elist,
+    TROVE_extent **out,
+    uint64_t *count)
+{
+    /* NOTE: like extentlist_count, this is not thread safe; we count
+     * on the trove-handle-mgmt layer to serialize calls.
+     */
+    g_counter = 0;
+    avldepthfirst(elist->index, extent_tally, 0, 0);
+
+    *count = g_counter;
+    *out = malloc((g_counter ? g_counter : 1) * sizeof(TROVE_extent));
+    if (*out == NULL)
+    {
+        return -1;
     }
+
+    g_extent_out = *out;
+    g_counter = 0;
+    avldepthfirst(elist->index, extent_collect, 0, 0);
+    g_extent_out = NULL;
     return 0;
 }
 
@@ -81,6 +81,14 @@ int extentlist_peek_handles_from_extent(
 int extentlist_handle_remove(
     struct TROVE_handle_extentlist *elist,
     TROVE_handle handle);
+int extentlist_range_remove(
+    struct TROVE_handle_extentlist *elist,
+    TROVE_handle first,
+    TROVE_handle last);
+int extentlist_get_extents(
+    struct TROVE_handle_extentlist *elist,
+    TROVE_extent **out,
+    uint64_t *count);
 void extentlist_show(
     struct TROVE_handle_extentlist *elist);
 void extentlist_count(
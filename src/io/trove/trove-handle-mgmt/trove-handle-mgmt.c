@@ -30,6 +30,11 @@ typedef struct
     TROVE_coll_id coll_id;
     int have_valid_ranges;
 
+    /* set while trove_set_handle_ranges scans the collection, which it
+     * does without holding trove_handle_mutex; cancel asks it to stop */
+    int loading;
+    int cancel;
+
     struct handle_ledger *ledger;
 } handle_ledger_t;
 
@@ -41,23 +46,56 @@ static int hash_fsid_compare(const void *key, struct qlist_head *link);
 
 static gen_mutex_t trove_handle_mutex = GEN_MUTEX_INITIALIZER;
 
+/* remove_handle_run:
+ *  internal function to take a run of consecutive handles found on
+ *  disk out of the ledger, one handle at a time if they can't all
+ *  come out together
+ */
+static void remove_handle_run(struct handle_ledger *ledger,
+                              TROVE_handle first,
+                              TROVE_handle last)
+{
+    TROVE_handle handle;
+
+    if (trove_handle_remove_range(ledger, first, last) == 0)
+    {
+        return;
+    }
+
+    for(handle = first; handle <= last; handle++)
+    {
+        if (trove_handle_remove(ledger, handle) != 0)
+        {
+            gossip_err(
+                "WARNING: could not remove "
+                "handle %llu from ledger; continuing.\n", llu(handle));
+        }
+    }
+}
+
 /* trove_check_handle_ranges:
  *  internal function to verify that handles
  *  on disk match our assigned handles.
- *  this function is *very* expensive.
+ *  this function is *very* expensive; runs of consecutive handles
+ *  are taken out of the ledger together to keep it down.
+ *  it is called without trove_handle_mutex held and only takes it
+ *  while updating the ledger, so handles of other collections can be
+ *  allocated while this one waits on the database.
  *
  * coll_id: id of collection which we will verify
  * extent_list: llist of legal handle ranges/extents
- * ledger: a book-keeping ledger object
+ * hl: the ledger management struct of the collection
  *
- * returns 0 on success; -1 otherwise
+ * returns 0 on success; -1 or -TROVE_ECANCEL otherwise
  */
 static int trove_check_handle_ranges(TROVE_coll_id coll_id,
                                      TROVE_context_id context_id,
                                      PINT_llist *extent_list,
-                                     struct handle_ledger *ledger)
+                                     handle_ledger_t *hl)
 {
+    struct handle_ledger *ledger = (hl ? hl->ledger : NULL);
     int ret = -1, i = 0, count = 0, op_count = 0;
+    TROVE_handle run_first = TROVE_HANDLE_NULL, run_last = TROVE_HANDLE_NULL;
     TROVE_op_id op_id = 0;
     TROVE_ds_state state = 0;
     TROVE_ds_position pos = TROVE_ITERATE_START;
@@ -70,6 +108,13 @@ static int trove_check_handle_ranges(TROVE_coll_id coll_id,
 
         while(count > 0)
         {
+            if (hl->cancel)
+            {
+                gossip_debug(GOSSIP_TROVE_DEBUG,
+                             "handle range check cancelled\n");
+                return -TROVE_ECANCEL;
+            }
+
             ret = trove_dspace_iterate_handles(coll_id,&pos,handles,
                                                &count,0,NULL,NULL,
                                                context_id,&op_id);
@@ -110,30 +155,44 @@ static int trove_check_handle_ranges(TROVE_coll_id coll_id,
 
             if (count > 0)
             {
+                gen_mutex_lock(&trove_handle_mutex);
                 for(i = 0; i != count; i++)
                 {
                     /* check every item in our range list */
                     if (!PINT_handle_in_extent_list(extent_list,
                                                     handles[i]))
                     {
+                        gen_mutex_unlock(&trove_handle_mutex);
                         gossip_err(
                             "Error: handle %llu is invalid "
                             "(out of bounds)\n", llu(handles[i]));
                         return -1;
                     }
 
-		    /* remove handle from trove-handle-mgmt */
-		    ret = trove_handle_remove(ledger, handles[i]);
-		    if (ret != 0)
+                    /* extend the current run, or remove it from
+                     * trove-handle-mgmt and start another */
+                    if ((run_first != TROVE_HANDLE_NULL) &&
+                        (handles[i] == run_last + 1))
                     {
-			gossip_err(
-                            "WARNING: could not remove "
-                            "handle %llu from ledger; continuing.\n", llu(handles[i]));
-		    }
+                        run_last = handles[i];
+                        continue;
+                    }
+                    if (run_first != TROVE_HANDLE_NULL)
+                    {
+                        remove_handle_run(ledger, run_first, run_last);
+                    }
+                    run_first = run_last = handles[i];
                 }
+                gen_mutex_unlock(&trove_handle_mutex);
                 ret = ((i == count) ? 0 : -1);
             }
         }
+        if (run_first != TROVE_HANDLE_NULL)
+        {
+            gen_mutex_lock(&trove_handle_mutex);
+            remove_handle_run(ledger, run_first, run_last);
+            gen_mutex_unlock(&trove_handle_mutex);
+        }
     }
     return ret;
 }
@@ -194,6 +253,8 @@ static handle_ledger_t *get_or_add_handle_ledger(TROVE_coll_id coll_id)
         {
             ledger->coll_id = coll_id;
             ledger->have_valid_ranges = 0;
+            ledger->loading = 0;
+            ledger->cancel = 0;
             ledger->ledger = trove_handle_ledger_init(coll_id,NULL);
             if (ledger->ledger)
             {
@@ -291,6 +352,11 @@ int trove_set_handle_ranges(TROVE_coll_id coll_id,
               create otherwise
             */
             ledger = get_or_add_handle_ledger(coll_id);
+            if (ledger && ledger->loading)
+            {
+                ledger = NULL;
+                ret = -TROVE_EBUSY;
+            }
             if (ledger)
             {
                 /* assert the internal ledger struct is valid */
@@ -305,8 +371,16 @@ int trove_set_handle_ranges(TROVE_coll_id coll_id,
                     return ret;
                 }
 
+                /* allocations fail until the scan is done */
+                ledger->loading = 1;
+                ledger->cancel = 0;
+                gen_mutex_unlock(&trove_handle_mutex);
+
                 ret = trove_check_handle_ranges(
-                    coll_id,context_id,extent_list,ledger->ledger);
+                    coll_id,context_id,extent_list,ledger);
+
+                gen_mutex_lock(&trove_handle_mutex);
+                ledger->loading = 0;
 		if (ret != 0)
                 {
                     gen_mutex_unlock(&trove_handle_mutex);
@@ -324,6 +398,122 @@ int trove_set_handle_ranges(TROVE_coll_id coll_id,
     return ret;
 }
 
+/*
+ * trove_set_handle_ranges_from_snapshot: like trove_set_handle_ranges,
+ * but takes the handles in use from a snapshot made by
+ * trove_handle_get_snapshot instead of iterating over every dataspace.
+ * on failure the ledger is left empty, so the caller can fall back to
+ * trove_set_handle_ranges.
+ */
+int trove_set_handle_ranges_from_snapshot(TROVE_coll_id coll_id,
+                                          char *handle_range_str,
+                                          void *snapshot,
+                                          size_t snapshot_len)
+{
+    int ret = -TROVE_EINVAL;
+    PINT_llist *extent_list = NULL;
+    handle_ledger_t *ledger = NULL;
+
+    gen_mutex_lock(&trove_handle_mutex);
+    if (handle_range_str && snapshot)
+    {
+        extent_list = PINT_create_extent_list(handle_range_str);
+        if (extent_list)
+        {
+            ledger = get_or_add_handle_ledger(coll_id);
+            if (ledger && (ledger->have_valid_ranges == 0) &&
+                !ledger->loading)
+            {
+                assert(ledger->ledger);
+
+                ret = trove_map_handle_ranges(extent_list, ledger->ledger);
+                if (ret == 0)
+                {
+                    ret = trove_handle_ledger_load_snapshot(
+                        ledger->ledger, snapshot, snapshot_len);
+                }
+
+                if (ret == 0)
+                {
+                    ledger->have_valid_ranges = 1;
+                }
+                else
+                {
+                    /* start over with an empty ledger */
+                    trove_handle_ledger_free(ledger->ledger);
+                    ledger->ledger = trove_handle_ledger_init(coll_id, NULL);
+                    if (!ledger->ledger)
+                    {
+                        qhash_search_and_remove(s_fsid_to_ledger_table,
+                                                &(coll_id));
+                        free(ledger);
+                    }
+                    ret = -TROVE_EINVAL;
+                }
+            }
+            PINT_release_extent_list(extent_list);
+        }
+    }
+    gen_mutex_unlock(&trove_handle_mutex);
+    return ret;
+}
+
+/*
+ * trove_cancel_handle_ranges: asks a trove_set_handle_ranges call that
+ * is scanning the collection in another thread to give up; it returns
+ * -TROVE_ECANCEL once it next looks, and the ranges are left unset.
+ */
+void trove_cancel_handle_ranges(TROVE_coll_id coll_id)
+{
+    handle_ledger_t *ledger = NULL;
+    struct qlist_head *hash_link = NULL;
+
+    gen_mutex_lock(&trove_handle_mutex);
+    hash_link = qhash_search(s_fsid_to_ledger_table,&(coll_id));
+    if (hash_link)
+    {
+        ledger = qlist_entry(hash_link, handle_ledger_t, hash_link);
+        if (ledger && ledger->loading)
+        {
+            ledger->cancel = 1;
+        }
+    }
+    gen_mutex_unlock(&trove_handle_mutex);
+}
+
+/*
+ * trove_handle_get_snapshot: returns a newly allocated, compact
+ * snapshot of the handles in use in the collection, which
+ * trove_set_handle_ranges_from_snapshot can load instead of scanning
+ * the next time the collection is opened.
+ */
+int trove_handle_get_snapshot(TROVE_coll_id coll_id,
+                              void **snapshot,
+                              size_t *snapshot_len)
+{
+    int ret = -TROVE_EINVAL;
+    handle_ledger_t *ledger = NULL;
+    struct qlist_head *hash_link = NULL;
+
+    gen_mutex_lock(&trove_handle_mutex);
+    hash_link = qhash_search(s_fsid_to_ledger_table,&(coll_id));
+    if (hash_link)
+    {
+        ledger = qlist_entry(hash_link, handle_ledger_t, hash_link);
+        if (ledger && (ledger->have_valid_ranges == 1))
+        {
+            ret = trove_handle_ledger_snapshot(
+                ledger->ledger, snapshot, snapshot_len);
+            if (ret != 0)
+            {
+                ret = -TROVE_ENOMEM;
+            }
+        }
+    }
+    gen_mutex_unlock(&trove_handle_mutex);
+    return ret;
+}
+
 /*
  * trove_set_handle_timeout: controls how long a handle, once freed,
  * will sit on the sidelines before returning to the pool of
@@ -520,6 +710,15 @@ int trove_handle_free(TROVE_coll_id coll_id, TROVE_handle handle)
         ledger = qlist_entry(hash_link, handle_ledger_t, hash_link);
         if (ledger)
         {
+            /*
+              while the collection is being scanned, a handle removed
+              before the scan reached it is still on the free list;
+              take it off so it is not freed twice
+            */
+            if (ledger->loading)
+            {
+                trove_handle_remove(ledger->ledger, handle);
+            }
             ret = trove_ledger_handle_free(ledger->ledger, handle);
         }
     }
@@ -22,6 +22,34 @@ int trove_set_handle_ranges(
     TROVE_context_id context_id,
     char *handle_range_str);
 
+/*
+  makes a trove_set_handle_ranges call running in another thread stop
+  scanning the collection and fail with -TROVE_ECANCEL
+*/
+void trove_cancel_handle_ranges(TROVE_coll_id coll_id);
+
+/*
+  sets the handle ranges like trove_set_handle_ranges, but takes the
+  handles in use from a snapshot made by trove_handle_get_snapshot
+  rather than iterating over every dataspace.  returns 0 on success;
+  on failure nothing is set and trove_set_handle_ranges should be used
+*/
+int trove_set_handle_ranges_from_snapshot(
+    TROVE_coll_id coll_id,
+    char *handle_range_str,
+    void *snapshot,
+    size_t snapshot_len);
+
+/*
+  returns a newly allocated run-length snapshot of the handles in use,
+  to be stored by the caller and loaded next time with
+  trove_set_handle_ranges_from_snapshot.  return value is 0 on success
+*/
+int trove_handle_get_snapshot(
+    TROVE_coll_id coll_id,
+    void **snapshot,
+    size_t *snapshot_len);
+
 int trove_set_handle_timeout(
     TROVE_coll_id coll_id,
     TROVE_context_id context_id,
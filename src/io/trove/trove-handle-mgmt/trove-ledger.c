@@ -29,6 +29,22 @@ struct handle_ledger {
     TROVE_handle recently_freed_list_handle;
     TROVE_handle overflow_list_handle;
     uint64_t cutoff;	/* when to start trying to reuse handles */
+    TROVE_extent *legal_extents; /* every extent added with addextent */
+    int legal_count;
+};
+
+/* a snapshot of a handle ledger is a compact, run-length record of the
+ * handles in use: this header followed by run_count extents of handles
+ * in use, in ascending order.  handles waiting out their purgatory are
+ * recorded as free, just as a scan of the dataspaces would find them.
+ */
+#define HANDLE_SNAPSHOT_MAGIC   0x686c6467
+#define HANDLE_SNAPSHOT_VERSION 1
+
+struct handle_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t run_count;
 };
 
 /* Functions used only internally:
@@ -112,6 +128,7 @@ void trove_handle_ledger_free(struct handle_ledger *hl)
     extentlist_free(&(hl->free_list));
     extentlist_free(&(hl->recently_freed_list));
     extentlist_free((&hl->overflow_list));
+    free(hl->legal_extents);
     free(hl);
 }
 
@@ -461,7 +478,20 @@ static int handle_store_load(TROVE_coll_id coll_id,
 inline int trove_handle_ledger_addextent(struct handle_ledger *hl, 
 	TROVE_extent * extent)
 {
-   return extentlist_addextent(&(hl->free_list), 
+    TROVE_extent *legal;
+
+    /* remember the legal extents so a snapshot can tell which handles
+     * are in use rather than simply not free */
+    legal = realloc(hl->legal_extents,
+                    (hl->legal_count + 1) * sizeof(TROVE_extent));
+    if (legal == NULL)
+    {
+        return -1;
+    }
+    hl->legal_extents = legal;
+    hl->legal_extents[hl->legal_count++] = *extent;
+
+    return extentlist_addextent(&(hl->free_list), 
 	   extent->first, extent->last);
 }
 
@@ -478,6 +508,201 @@ inline int trove_handle_remove(struct handle_ledger *hl, TROVE_handle handle)
     return extentlist_handle_remove(&(hl->free_list), handle);
 }
 
+/* trove_handle_remove_range: 
+ *	take a run of handles out of the valid handle space at once
+ *
+ * returns
+ *  0 if ok
+ *  nonzero  on error (some handle in the run was not free)
+ */
+int trove_handle_remove_range(struct handle_ledger *hl,
+                              TROVE_handle first, TROVE_handle last)
+{
+    return extentlist_range_remove(&(hl->free_list), first, last);
+}
+
+static int extent_compare(const void *a, const void *b)
+{
+    const TROVE_extent *ea = a, *eb = b;
+
+    if (ea->first < eb->first)
+        return -1;
+    return (ea->first > eb->first);
+}
+
+/* trove_handle_ledger_snapshot()
+ *
+ * builds a snapshot of the handles in use, that is the legal extents
+ * minus every free extent, into a newly allocated buffer.
+ *
+ * returns 0 on success, -1 on error
+ */
+int trove_handle_ledger_snapshot(struct handle_ledger *hl,
+                                 void **snapshot, size_t *snapshot_len)
+{
+    struct TROVE_handle_extentlist *lists[3];
+    struct handle_snapshot_header *header;
+    TROVE_extent *free_ext = NULL, *list_ext = NULL, *legal = NULL, *runs;
+    TROVE_handle cur;
+    uint64_t nfree = 0, count = 0, nruns = 0, j = 0, k;
+    int i, nlegal, done;
+
+    lists[0] = &(hl->free_list);
+    lists[1] = &(hl->recently_freed_list);
+    lists[2] = &(hl->overflow_list);
+
+    /* gather the free extents of all three lists in order */
+    for (i = 0; i < 3; i++)
+    {
+        if (extentlist_get_extents(lists[i], &list_ext, &count) != 0)
+        {
+            free(free_ext);
+            return -1;
+        }
+        if (count)
+        {
+            runs = realloc(free_ext, (nfree + count) * sizeof(TROVE_extent));
+            if (runs == NULL)
+            {
+                free(list_ext);
+                free(free_ext);
+                return -1;
+            }
+            free_ext = runs;
+            memcpy(&free_ext[nfree], list_ext, count * sizeof(TROVE_extent));
+            nfree += count;
+        }
+        free(list_ext);
+    }
+    if (nfree)
+    {
+        qsort(free_ext, nfree, sizeof(TROVE_extent), extent_compare);
+    }
+
+    legal = malloc((hl->legal_count + 1) * sizeof(TROVE_extent));
+    *snapshot = malloc(sizeof(*header) +
+                       (nfree + hl->legal_count) * sizeof(TROVE_extent));
+    if (!legal || !*snapshot)
+    {
+        free(legal);
+        free(*snapshot);
+        free(free_ext);
+        return -1;
+    }
+    memcpy(legal, hl->legal_extents, hl->legal_count * sizeof(TROVE_extent));
+    qsort(legal, hl->legal_count, sizeof(TROVE_extent), extent_compare);
+
+    /* merge overlapping legal extents, so each free extent starts in
+     * at most one of them and there are at most nfree + nlegal runs */
+    nlegal = 0;
+    for (i = 0; i < hl->legal_count; i++)
+    {
+        if ((nlegal > 0) && (legal[i].first <= legal[nlegal - 1].last))
+        {
+            if (legal[i].last > legal[nlegal - 1].last)
+            {
+                legal[nlegal - 1].last = legal[i].last;
+            }
+            continue;
+        }
+        legal[nlegal++] = legal[i];
+    }
+
+    header = *snapshot;
+    runs = (TROVE_extent *)(header + 1);
+
+    /* the gaps between free extents within each legal extent are the
+     * runs of handles in use */
+    for (i = 0; i < nlegal; i++)
+    {
+        cur = legal[i].first;
+        done = 0;
+        while ((j < nfree) && (free_ext[j].last < legal[i].first))
+        {
+            j++;
+        }
+        for (k = j; (k < nfree) && (free_ext[k].first <= legal[i].last); k++)
+        {
+            if (free_ext[k].first > cur)
+            {
+                runs[nruns].first = cur;
+                runs[nruns].last = free_ext[k].first - 1;
+                nruns++;
+            }
+            if (free_ext[k].last >= legal[i].last)
+            {
+                done = 1;
+                break;
+            }
+            if (free_ext[k].last + 1 > cur)
+            {
+                cur = free_ext[k].last + 1;
+            }
+        }
+        if (!done && (cur <= legal[i].last))
+        {
+            runs[nruns].first = cur;
+            runs[nruns].last = legal[i].last;
+            nruns++;
+        }
+    }
+
+    header->magic = HANDLE_SNAPSHOT_MAGIC;
+    header->version = HANDLE_SNAPSHOT_VERSION;
+    header->run_count = nruns;
+    *snapshot_len = sizeof(*header) + nruns * sizeof(TROVE_extent);
+
+    free(legal);
+    free(free_ext);
+    return 0;
+}
+
+/* trove_handle_ledger_load_snapshot()
+ *
+ * takes the handles recorded in use by a snapshot out of the free
+ * list.  the legal extents must already have been added.
+ *
+ * returns 0 on success, -1 if the snapshot is malformed or does not
+ * fit the legal extents (the ledger should then be thrown away)
+ */
+int trove_handle_ledger_load_snapshot(struct handle_ledger *hl,
+                                      void *snapshot, size_t snapshot_len)
+{
+    struct handle_snapshot_header *header = snapshot;
+    TROVE_extent *runs;
+    uint64_t i;
+
+    if ((snapshot_len < sizeof(*header)) ||
+        (header->magic != HANDLE_SNAPSHOT_MAGIC) ||
+        (header->version != HANDLE_SNAPSHOT_VERSION) ||
+        (header->run_count > (snapshot_len / sizeof(TROVE_extent))) ||
+        (snapshot_len !=
+         sizeof(*header) + header->run_count * sizeof(TROVE_extent)))
+    {
+        gossip_debug(GOSSIP_TROVE_DEBUG, "handle ledger snapshot is "
+                     "malformed (%llu bytes)\n", llu(snapshot_len));
+        return -1;
+    }
+
+    runs = (TROVE_extent *)(header + 1);
+    for (i = 0; i < header->run_count; i++)
+    {
+        if ((i > 0) && (runs[i].first <= runs[i - 1].last))
+        {
+            return -1;
+        }
+        if (extentlist_range_remove(&(hl->free_list),
+                                    runs[i].first, runs[i].last) != 0)
+        {
+            gossip_debug(GOSSIP_TROVE_DEBUG, "handle ledger snapshot run "
+                         "%llu-%llu is not within the handle ranges\n",
+                         llu(runs[i].first), llu(runs[i].last));
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /* trove_handle_ledger_set_threshold()
  * hl:  handle ledger object we will modify
  * nhandles:  number of total handles in the system. we will make a cutoff
@@ -41,6 +41,24 @@ int trove_handle_ledger_addextent(
 int trove_handle_remove(
     struct handle_ledger *hl,
     TROVE_handle handle);
+int trove_handle_remove_range(
+    struct handle_ledger *hl,
+    TROVE_handle first,
+    TROVE_handle last);
+
+/*
+  handle_ledger_snapshot, load_snapshot - save the handles in use as a
+  compact run-length buffer, and restore them into a freshly set up
+  ledger without scanning every dataspace.
+*/
+int trove_handle_ledger_snapshot(
+    struct handle_ledger *hl,
+    void **snapshot,
+    size_t *snapshot_len);
+int trove_handle_ledger_load_snapshot(
+    struct handle_ledger *hl,
+    void *snapshot,
+    size_t snapshot_len);
 
 /*
   handle_get,put - obtain, return a handle from/to a particular handle
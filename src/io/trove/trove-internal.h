@@ -115,6 +115,17 @@ struct TROVE_bstream_ops
          TROVE_coll_id coll_id,
          TROVE_op_id cancel_id,
          TROVE_context_id context_id);
+
+     int (*bstream_seek)(
+         TROVE_coll_id coll_id,
+         TROVE_handle handle,
+         TROVE_offset *inout_offset_p,
+         int whence,
+         TROVE_ds_flags flags,
+         void *user_ptr,
+         TROVE_context_id context_id,
+         TROVE_op_id *out_op_id_p,
+         PVFS_hint hints);
 };
 
 struct TROVE_keyval_ops
@@ -492,6 +503,10 @@ struct TROVE_context_ops
     int (*close_context)(
                          TROVE_coll_id coll_id,
                          TROVE_context_id context_id);
+
+    int (*wake_context)(
+                        TROVE_coll_id coll_id,
+                        TROVE_context_id context_id);
 };
 
 /*
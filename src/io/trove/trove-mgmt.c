@@ -277,6 +277,26 @@ int trove_close_context(TROVE_coll_id coll_id, TROVE_context_id context_id)
     return ret;
 }
 
+/* trove_wake_context()
+ *
+ * makes a testcontext call on the context that is waiting for
+ * completions, or the next one to be made, return right away.  Returns
+ * -TROVE_ENOSYS if the method completes operations in the caller's
+ * thread and so never waits.
+ */
+int trove_wake_context(TROVE_coll_id coll_id, TROVE_context_id context_id)
+{
+    TROVE_method_id method_id;
+    int ret = -TROVE_EINVAL;
+    method_id = global_trove_method_callback(coll_id);
+    if (trove_init_status != 0)
+    {
+        ret = context_method_table[method_id]->wake_context(coll_id,
+                                                            context_id);
+    }
+    return ret;
+}
+
 int trove_collection_clear(TROVE_method_id method_id, TROVE_coll_id coll_id)
 {
     return mgmt_method_table[method_id]->collection_clear(coll_id);
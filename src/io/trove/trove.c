@@ -34,6 +34,8 @@ struct PINT_perf_counter* PINT_server_tpc = NULL;
 
 int TROVE_shm_key_hint = 0;
 int TROVE_max_concurrent_io = 16;
+/* finish opening collections in the background (TROVE_STAGED_STARTUP) */
+int TROVE_staged_startup = 0;
 
 extern TROVE_method_callback global_trove_method_callback;
 
@@ -130,6 +132,40 @@ int trove_bstream_resize(
            hints);
 }
 
+/** Find the next data (TROVE_SEEK_DATA) or hole (TROVE_SEEK_HOLE) at or
+ *  after *inout_offset_p in a bstream.  The end of the bstream counts as a
+ *  hole.  If there is no data at or after the offset, *inout_offset_p is
+ *  set to -1.
+ */
+int trove_bstream_seek(
+    TROVE_coll_id coll_id,
+    TROVE_handle handle,
+    TROVE_offset* inout_offset_p,
+    int whence,
+    TROVE_ds_flags flags,
+    void* user_ptr,
+    TROVE_context_id context_id,
+    TROVE_op_id* out_op_id_p,
+    PVFS_hint hints)
+{
+    TROVE_method_id method_id;
+    method_id = global_trove_method_callback(coll_id);
+    if (!bstream_method_table[method_id]->bstream_seek)
+    {
+        return -TROVE_ENOSYS;
+    }
+    return bstream_method_table[method_id]->bstream_seek(
+           coll_id,
+           handle,
+           inout_offset_p,
+           whence,
+           flags,
+           user_ptr,
+           context_id,
+           out_op_id_p,
+           hints);
+}
+
 int trove_bstream_validate(
     TROVE_coll_id coll_id,
     TROVE_handle handle,
@@ -1050,6 +1086,11 @@ int trove_collection_setinfo(
         TROVE_max_concurrent_io = *((int*)parameter);
         return(0);
     }
+    if(option == TROVE_STAGED_STARTUP)
+    {
+        TROVE_staged_startup = *((int*)parameter);
+        return(0);
+    }
     method_id = global_trove_method_callback(coll_id);
     return mgmt_method_table[method_id]->collection_setinfo(
            method_id,
@@ -88,7 +88,16 @@ enum
     TROVE_COLLECTION_IMMEDIATE_COMPLETION,
     TROVE_DIRECTIO_THREADS_NUM,
     TROVE_DIRECTIO_OPS_PER_QUEUE,
-    TROVE_DIRECTIO_TIMEOUT
+    TROVE_DIRECTIO_TIMEOUT,
+    TROVE_COLLECTION_READAHEAD_SIZE,
+    TROVE_STAGED_STARTUP
+};
+
+/* whence values for trove_bstream_seek() */
+enum
+{
+    TROVE_SEEK_DATA = 1,
+    TROVE_SEEK_HOLE = 2
 };
 
 /** Initializes the Trove layer.  Must be called before any other Trove
@@ -114,6 +123,10 @@ int trove_close_context(
     TROVE_coll_id coll_id,
     TROVE_context_id context_id);
 
+int trove_wake_context(
+    TROVE_coll_id coll_id,
+    TROVE_context_id context_id);
+
 int trove_collection_clear(
     TROVE_method_id method_id,
     TROVE_coll_id coll_id);
@@ -198,6 +211,17 @@ int trove_bstream_resize(
 			 TROVE_op_id *out_op_id_p,
              PVFS_hint hints);
 
+int trove_bstream_seek(
+                       TROVE_coll_id coll_id,
+                       TROVE_handle handle,
+                       TROVE_offset *inout_offset_p,
+                       int whence,
+                       TROVE_ds_flags flags,
+                       void *user_ptr,
+                       TROVE_context_id context_id,
+                       TROVE_op_id *out_op_id_p,
+                       PVFS_hint hints);
+
 int trove_bstream_validate(
                            TROVE_coll_id coll_id,
 			   TROVE_handle handle,
@@ -107,6 +107,7 @@ static void lebf_initialize(void)
             case PVFS_SERV_INVALID:
             case PVFS_SERV_PERF_UPDATE:
             case PVFS_SERV_PRECREATE_POOL_REFILLER:
+            case PVFS_SERV_SIZE_REFRESH:
             case PVFS_SERV_JOB_TIMER:
                 /* never used, skip initialization */
                 continue;
@@ -139,6 +140,7 @@ static void lebf_initialize(void)
             case PVFS_SERV_MIRROR:
                  req.u.mirror.dist = &tmp_dist;
                  req.u.mirror.dst_count = 0;
+                 zero_capability(&req.u.mirror.dst_capability);
                  reqsize = extra_size_PVFS_servreq_mirror;
                  respsize = extra_size_PVFS_servresp_mirror;
                  break;
@@ -212,6 +214,15 @@ static void lebf_initialize(void)
             case PVFS_SERV_TRUNCATE:
                 /* nothing special */
                 break;
+            case PVFS_SERV_SEEK:
+                /* nothing special */
+                break;
+            case PVFS_SERV_LEASE_BREAK:
+                /* nothing special */
+                break;
+            case PVFS_SERV_SIZE_NOTIFY:
+                /* nothing special */
+                break;
             case PVFS_SERV_MKDIR:
                 zero_credential(&req.u.mkdir.credential);
                 req.u.mkdir.handle_extent_array.extent_count = 0;
@@ -271,6 +282,13 @@ static void lebf_initialize(void)
                 reqsize = extra_size_PVFS_servreq_geteattr;
                 respsize = extra_size_PVFS_servresp_geteattr;
                 break;
+            case PVFS_SERV_GETEATTR_BULK:
+                req.u.geteattr_bulk.nhandles = 0;
+                req.u.geteattr_bulk.nkey = 0;
+                resp.u.geteattr_bulk.count = 0;
+                reqsize = extra_size_PVFS_servreq_geteattr_bulk;
+                respsize = extra_size_PVFS_servresp_geteattr_bulk;
+                break;
             case PVFS_SERV_SETEATTR:
                 req.u.seteattr.nkey = 0;
                 reqsize = extra_size_PVFS_servreq_seteattr;
@@ -520,6 +538,9 @@ static int lebf_encode_req(
         CASE(PVFS_SERV_RMDIRENT, rmdirent);
         CASE(PVFS_SERV_CHDIRENT, chdirent);
         CASE(PVFS_SERV_TRUNCATE, truncate);
+        CASE(PVFS_SERV_SEEK, seek);
+        CASE(PVFS_SERV_LEASE_BREAK, lease_break);
+        CASE(PVFS_SERV_SIZE_NOTIFY, size_notify);
         CASE(PVFS_SERV_MKDIR, mkdir);
         CASE(PVFS_SERV_READDIR, readdir);
         CASE(PVFS_SERV_FLUSH, flush);
@@ -530,6 +551,7 @@ static int lebf_encode_req(
         CASE(PVFS_SERV_MGMT_DSPACE_INFO_LIST, mgmt_dspace_info_list);
         CASE(PVFS_SERV_MGMT_EVENT_MON, mgmt_event_mon);
         CASE(PVFS_SERV_GETEATTR, geteattr);
+        CASE(PVFS_SERV_GETEATTR_BULK, geteattr_bulk);
         CASE(PVFS_SERV_SETEATTR, seteattr);
         CASE(PVFS_SERV_ATOMICEATTR, atomiceattr);
         CASE(PVFS_SERV_DELEATTR, deleattr);
@@ -552,6 +574,7 @@ static int lebf_encode_req(
         case PVFS_SERV_WRITE_COMPLETION:
         case PVFS_SERV_PERF_UPDATE:
         case PVFS_SERV_PRECREATE_POOL_REFILLER:
+        case PVFS_SERV_SIZE_REFRESH:
         case PVFS_SERV_JOB_TIMER:
         case PVFS_SERV_NUM_OPS:  /* sentinel */
             gossip_err("%s: invalid operation %d\n", __func__, req->op);
@@ -628,6 +651,8 @@ static int lebf_encode_resp(
         CASE(PVFS_SERV_MKDIR, mkdir);
         CASE(PVFS_SERV_READDIR, readdir);
         CASE(PVFS_SERV_STATFS, statfs);
+        CASE(PVFS_SERV_MGMT_NOOP, mgmt_noop);
+        CASE(PVFS_SERV_SEEK, seek);
         CASE(PVFS_SERV_MGMT_PERF_MON, mgmt_perf_mon);
         CASE(PVFS_SERV_MGMT_ITERATE_HANDLES, mgmt_iterate_handles);
         CASE(PVFS_SERV_MGMT_DSPACE_INFO_LIST, mgmt_dspace_info_list);
@@ -635,6 +660,7 @@ static int lebf_encode_resp(
         CASE(PVFS_SERV_WRITE_COMPLETION, write_completion);
         CASE(PVFS_SERV_MGMT_GET_DIRDATA_HANDLE, mgmt_get_dirdata_handle);
         CASE(PVFS_SERV_GETEATTR, geteattr);
+        CASE(PVFS_SERV_GETEATTR_BULK, geteattr_bulk);
         CASE(PVFS_SERV_ATOMICEATTR, atomiceattr);
         CASE(PVFS_SERV_LISTEATTR, listeattr);
         CASE(PVFS_SERV_LISTATTR, listattr);
@@ -655,19 +681,21 @@ static int lebf_encode_resp(
         case PVFS_SERV_CRDIRENT:
         case PVFS_SERV_TRUNCATE:
         case PVFS_SERV_FLUSH:
-        case PVFS_SERV_MGMT_NOOP:
         case PVFS_SERV_BATCH_REMOVE:
         case PVFS_SERV_PROTO_ERROR:
         case PVFS_SERV_IMM_COPIES:
         case PVFS_SERV_MGMT_SETPARAM:
         case PVFS_SERV_MGMT_CREATE_ROOT_DIR:
         case PVFS_SERV_MGMT_SPLIT_DIRENT:
+        case PVFS_SERV_LEASE_BREAK:
+        case PVFS_SERV_SIZE_NOTIFY:
             /* nothing else */
             break;
 
         case PVFS_SERV_INVALID:
         case PVFS_SERV_PERF_UPDATE:
         case PVFS_SERV_PRECREATE_POOL_REFILLER:
+        case PVFS_SERV_SIZE_REFRESH:
         case PVFS_SERV_JOB_TIMER:
         case PVFS_SERV_NUM_OPS:  /* sentinel */
             gossip_err("%s: invalid operation %d\n", __func__, resp->op);
@@ -748,6 +776,9 @@ static int lebf_decode_req(
         CASE(PVFS_SERV_RMDIRENT, rmdirent);
         CASE(PVFS_SERV_CHDIRENT, chdirent);
         CASE(PVFS_SERV_TRUNCATE, truncate);
+        CASE(PVFS_SERV_SEEK, seek);
+        CASE(PVFS_SERV_LEASE_BREAK, lease_break);
+        CASE(PVFS_SERV_SIZE_NOTIFY, size_notify);
         CASE(PVFS_SERV_MKDIR, mkdir);
         CASE(PVFS_SERV_READDIR, readdir);
         CASE(PVFS_SERV_FLUSH, flush);
@@ -758,6 +789,7 @@ static int lebf_decode_req(
         CASE(PVFS_SERV_MGMT_DSPACE_INFO_LIST, mgmt_dspace_info_list);
         CASE(PVFS_SERV_MGMT_EVENT_MON, mgmt_event_mon);
         CASE(PVFS_SERV_GETEATTR, geteattr);
+        CASE(PVFS_SERV_GETEATTR_BULK, geteattr_bulk);
         CASE(PVFS_SERV_SETEATTR, seteattr);
         CASE(PVFS_SERV_ATOMICEATTR, atomiceattr);
         CASE(PVFS_SERV_DELEATTR, deleattr);
@@ -779,6 +811,7 @@ static int lebf_decode_req(
         case PVFS_SERV_WRITE_COMPLETION:
         case PVFS_SERV_PERF_UPDATE:
         case PVFS_SERV_PRECREATE_POOL_REFILLER:
+        case PVFS_SERV_SIZE_REFRESH:
         case PVFS_SERV_JOB_TIMER:
         case PVFS_SERV_PROTO_ERROR:
         case PVFS_SERV_NUM_OPS:  /* sentinel */
@@ -846,6 +879,8 @@ static int lebf_decode_resp(
         CASE(PVFS_SERV_MKDIR, mkdir);
         CASE(PVFS_SERV_READDIR, readdir);
         CASE(PVFS_SERV_STATFS, statfs);
+        CASE(PVFS_SERV_MGMT_NOOP, mgmt_noop);
+        CASE(PVFS_SERV_SEEK, seek);
         CASE(PVFS_SERV_MGMT_PERF_MON, mgmt_perf_mon);
         CASE(PVFS_SERV_MGMT_ITERATE_HANDLES, mgmt_iterate_handles);
         CASE(PVFS_SERV_MGMT_DSPACE_INFO_LIST, mgmt_dspace_info_list);
@@ -853,6 +888,7 @@ static int lebf_decode_resp(
         CASE(PVFS_SERV_MGMT_GET_DIRDATA_HANDLE, mgmt_get_dirdata_handle);
         CASE(PVFS_SERV_WRITE_COMPLETION, write_completion);
         CASE(PVFS_SERV_GETEATTR, geteattr);
+        CASE(PVFS_SERV_GETEATTR_BULK, geteattr_bulk);
         CASE(PVFS_SERV_ATOMICEATTR, atomiceattr);
         CASE(PVFS_SERV_LISTEATTR, listeattr);
         CASE(PVFS_SERV_LISTATTR, listattr);
@@ -874,18 +910,20 @@ static int lebf_decode_resp(
         case PVFS_SERV_CRDIRENT:
         case PVFS_SERV_TRUNCATE:
         case PVFS_SERV_FLUSH:
-        case PVFS_SERV_MGMT_NOOP:
         case PVFS_SERV_PROTO_ERROR:
         case PVFS_SERV_IMM_COPIES:
         case PVFS_SERV_MGMT_SETPARAM:
         case PVFS_SERV_MGMT_CREATE_ROOT_DIR:
         case PVFS_SERV_MGMT_SPLIT_DIRENT:
+        case PVFS_SERV_LEASE_BREAK:
+        case PVFS_SERV_SIZE_NOTIFY:
             /* nothing else */
             break;
 
         case PVFS_SERV_INVALID:
         case PVFS_SERV_PERF_UPDATE:
         case PVFS_SERV_PRECREATE_POOL_REFILLER:
+        case PVFS_SERV_SIZE_REFRESH:
         case PVFS_SERV_JOB_TIMER:
         case PVFS_SERV_NUM_OPS:  /* sentinel */
             gossip_lerr("%s: invalid operation %d.\n", __func__, resp->op);
@@ -975,6 +1013,8 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
                 decode_free(req->u.mirror.dist);
                 decode_free(req->u.mirror.dst_handle);
                 decode_free(req->u.mirror.wcIndex);
+                decode_free(req->u.mirror.dst_capability.handle_array);
+                decode_free(req->u.mirror.dst_capability.signature);
                 break;
 
             case PVFS_SERV_MKDIR:
@@ -1085,6 +1125,11 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
                 decode_free(req->u.geteattr.key);
                 decode_free(req->u.geteattr.valsz);
                 break;
+
+            case PVFS_SERV_GETEATTR_BULK:
+                decode_free(req->u.geteattr_bulk.handles);
+                decode_free(req->u.geteattr_bulk.key);
+                break;
                 
             case PVFS_SERV_ATOMICEATTR:
                 decode_free(req->u.atomiceattr.key);
@@ -1137,6 +1182,9 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
             case PVFS_SERV_RMDIRENT:
             case PVFS_SERV_CHDIRENT:
             case PVFS_SERV_TRUNCATE:
+            case PVFS_SERV_SEEK:
+            case PVFS_SERV_LEASE_BREAK:
+            case PVFS_SERV_SIZE_NOTIFY:
             case PVFS_SERV_READDIR:
             case PVFS_SERV_FLUSH:
             case PVFS_SERV_MGMT_SETPARAM:
@@ -1160,6 +1208,7 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
             case PVFS_SERV_WRITE_COMPLETION:
             case PVFS_SERV_PERF_UPDATE:
             case PVFS_SERV_PRECREATE_POOL_REFILLER:
+            case PVFS_SERV_SIZE_REFRESH:
             case PVFS_SERV_JOB_TIMER:
             case PVFS_SERV_PROTO_ERROR:            
             case PVFS_SERV_NUM_OPS:  /* sentinel */
@@ -1267,6 +1316,12 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
                     if (resp->u.geteattr.val)
                         decode_free(resp->u.geteattr.val);
                     break;
+                case PVFS_SERV_GETEATTR_BULK:
+                    if (resp->u.geteattr_bulk.val)
+                        decode_free(resp->u.geteattr_bulk.val);
+                    if (resp->u.geteattr_bulk.err)
+                        decode_free(resp->u.geteattr_bulk.err);
+                    break;
                 case PVFS_SERV_ATOMICEATTR:
                     /* need a loop here? */
                     if (resp->u.geteattr.val)
@@ -1379,6 +1434,9 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
                 case PVFS_SERV_RMDIRENT:
                 case PVFS_SERV_CHDIRENT:
                 case PVFS_SERV_TRUNCATE:
+                case PVFS_SERV_SEEK:
+                case PVFS_SERV_LEASE_BREAK:
+                case PVFS_SERV_SIZE_NOTIFY:
                 case PVFS_SERV_MKDIR:
                 case PVFS_SERV_FLUSH:
                 case PVFS_SERV_MGMT_SETPARAM:
@@ -1396,6 +1454,7 @@ static void lebf_decode_rel(struct PINT_decoded_msg *msg,
                 case PVFS_SERV_INVALID:
                 case PVFS_SERV_PERF_UPDATE:
                 case PVFS_SERV_PRECREATE_POOL_REFILLER:
+                case PVFS_SERV_SIZE_REFRESH:
                 case PVFS_SERV_JOB_TIMER:
                 case PVFS_SERV_NUM_OPS:  /* sentinel */
                     gossip_lerr("%s: invalid response operation %d.\n",
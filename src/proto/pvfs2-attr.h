@@ -44,6 +44,8 @@
 (PVFS_ATTR_META_DIST | PVFS_ATTR_META_DFILES | PVFS_ATTR_META_MIRROR_DFILES)
 
 #define PVFS_ATTR_META_UNSTUFFED (1 << 12)
+/* logical size of an unstuffed file, from the metadata server's cache */
+#define PVFS_ATTR_META_SIZE      (1 << 14)
 
 
 /* internal attribute masks for datafile objects */
@@ -98,6 +100,9 @@ struct PVFS_metafile_attr_s
 
     int32_t stuffed_size;
 
+    /* logical file size, when PVFS_ATTR_META_SIZE is set */
+    PVFS_size size;
+
     PVFS_metafile_hint hint;
 };
 typedef struct PVFS_metafile_attr_s PVFS_metafile_attr;
@@ -307,6 +312,8 @@ typedef struct PVFS_object_attr PVFS_object_attr;
 	encode_PVFS_metafile_attr_dfiles(pptr, &(x)->u.meta); \
     if ((x)->mask & PVFS_ATTR_META_MIRROR_DFILES) \
         encode_PVFS_metafile_attr_mirror_dfiles(pptr, &(x)->u.meta); \
+    if ((x)->mask & PVFS_ATTR_META_SIZE) \
+        encode_PVFS_size(pptr, &(x)->u.meta.size); \
     if ((x)->mask & PVFS_ATTR_DATA_SIZE) \
 	encode_PVFS_datafile_attr(pptr, &(x)->u.data); \
     if ((x)->mask & PVFS_ATTR_SYMLNK_TARGET) \
@@ -349,6 +356,8 @@ typedef struct PVFS_object_attr PVFS_object_attr;
 	decode_PVFS_metafile_attr_dfiles(pptr, &(x)->u.meta); \
     if ((x)->mask & PVFS_ATTR_META_MIRROR_DFILES) \
         decode_PVFS_metafile_attr_mirror_dfiles(pptr, &(x)->u.meta); \
+    if ((x)->mask & PVFS_ATTR_META_SIZE) \
+        decode_PVFS_size(pptr, &(x)->u.meta.size); \
     if ((x)->mask & PVFS_ATTR_DATA_SIZE) \
 	decode_PVFS_datafile_attr(pptr, &(x)->u.data); \
     if ((x)->mask & PVFS_ATTR_SYMLNK_TARGET) \
@@ -384,9 +393,10 @@ typedef struct PVFS_object_attr PVFS_object_attr;
 /*TODO: PVFS_REQ_LIMIT_HANDLES_COUNT really needs to change to something
         indicating the max number of servers */
 
-/* room for distribution, stuffed_size, dfile array, and mirror_dfile_array */
+/* room for distribution, stuffed_size, dfile array, mirror_dfile_array,
+ * and size */
 #define extra_size_PVFS_object_attr_meta (PVFS_REQ_LIMIT_DIST_BYTES + \
-  sizeof(int32_t) +                                                   \
+  sizeof(int32_t) + sizeof(PVFS_size) +                               \
   (PVFS_REQ_LIMIT_DFILE_COUNT * sizeof(PVFS_handle)) +                \
   (PVFS_REQ_LIMIT_MIRROR_DFILE_COUNT * sizeof(PVFS_handle))) 
 
@@ -26,7 +26,7 @@
  * compatibility (such as changing the semantics or protocol fields for an
  * existing request type)
  */
-#define PVFS2_PROTO_MAJOR 7
+#define PVFS2_PROTO_MAJOR 11
 /* update PVFS2_PROTO_MINOR on wire protocol changes that preserve backwards
  * compatibility (such as adding a new request type)
  * NOTE: Incrementing this will make clients unable to talk to older servers.
@@ -98,6 +98,11 @@ enum PVFS_server_op
     PVFS_SERV_TREE_GETATTR = 49,
     PVFS_SERV_MGMT_GET_USER_CERT = 50,
     PVFS_SERV_MGMT_GET_USER_CERT_KEYREQ = 51,
+    PVFS_SERV_SEEK = 52,
+    PVFS_SERV_LEASE_BREAK = 53,
+    PVFS_SERV_GETEATTR_BULK = 54,
+    PVFS_SERV_SIZE_NOTIFY = 55,
+    PVFS_SERV_SIZE_REFRESH = 56,   /* not a real protocol request */
 
     /* leave this entry last */
     PVFS_SERV_NUM_OPS
@@ -189,6 +194,8 @@ enum PVFS_server_op
 #define PVFS_REQ_LIMIT_EATTR_VAL_LEN    PVFS_MAX_XATTR_VALUELEN
 /* max number of keys or key/value pairs to set or get in an operation */
 #define PVFS_REQ_LIMIT_EATTR_LIST       PVFS_MAX_XATTR_LISTLEN 
+/* max number of value bytes returned by one geteattr_bulk request */
+#define PVFS_REQ_LIMIT_GETEATTR_BULK_BYTES 65536
 /* max size of security signature (in bytes) */
 #define PVFS_REQ_LIMIT_SIGNATURE        PVFS_SYS_LIMIT_SIGNATURE
 /* max number of groups in credential array */
@@ -569,6 +576,9 @@ endecode_fields_2a_struct(
 
 struct PVFS_servreq_tree_get_file_size
 {
+    /* if not PVFS_HANDLE_NULL, the metafile whose server caches the size;
+     * the datafiles tell that server before they next change */
+    PVFS_handle meta_handle;
     PVFS_fs_id  fs_id;
     uint32_t caller_handle_index;
     uint32_t retry_msgpair_at_leaf;
@@ -576,8 +586,9 @@ struct PVFS_servreq_tree_get_file_size
     uint32_t num_data_files;
     PVFS_handle *handle_array;
 };
-endecode_fields_4a_struct(
+endecode_fields_5a_struct(
     PVFS_servreq_tree_get_file_size,
+    PVFS_handle, meta_handle,
     PVFS_fs_id, fs_id,
     uint32_t, caller_handle_index,
     uint32_t, retry_msgpair_at_leaf,
@@ -595,12 +606,14 @@ endecode_fields_4a_struct(
                                  __num_data_files,                \
                                  __handle_array,                  \
                                  __retry_msgpair_at_leaf,         \
+                                 __meta_handle,                   \
                                  __hints)                         \
 do {                                                              \
     memset(&(__req), 0, sizeof(__req));                           \
     (__req).op = PVFS_SERV_TREE_GET_FILE_SIZE;                    \
     (__req).hints = (__hints);                                    \
     PVFS_REQ_COPY_CAPABILITY((__cap), (__req));                   \
+    (__req).u.tree_get_file_size.meta_handle = (__meta_handle);   \
     (__req).u.tree_get_file_size.credential = (__cred);           \
     (__req).u.tree_get_file_size.fs_id = (__fsid);                \
     (__req).u.tree_get_file_size.caller_handle_index =            \
@@ -764,19 +777,25 @@ do {                                            \
 /* getattr ****************************************************/
 /* - retreives attributes based on mask of PVFS_ATTR_XXX values */
 
+/* getattr request flags */
+#define PVFS_GETATTR_LEASE 1 /* sender will honor lease breaks */
+
 struct PVFS_servreq_getattr
 {
     PVFS_handle handle;           /* handle of target object */
     PVFS_fs_id fs_id;             /* file system */
     uint32_t attrmask;            /* mask of desired attributes */
+    uint32_t flags;               /* PVFS_GETATTR_XXX flags */
     PVFS_credential credential;   /* user credential */
 };
 
-endecode_fields_4_struct(
+endecode_fields_6_struct(
     PVFS_servreq_getattr,
     PVFS_handle, handle,
     PVFS_fs_id, fs_id,
     uint32_t, attrmask,
+    uint32_t, flags,
+    skip4,,
     PVFS_credential, credential);
 
 #define PINT_SERVREQ_GETATTR_FILL(__req,        \
@@ -801,10 +820,12 @@ do {                                            \
 struct PVFS_servresp_getattr
 {
     PVFS_object_attr attr;
+    uint32_t lease_msecs; /* how long attr may be cached, 0 if no lease */
 };
-endecode_fields_1_struct(
+endecode_fields_2_struct(
     PVFS_servresp_getattr,
-    PVFS_object_attr, attr);
+    PVFS_object_attr, attr,
+    uint32_t, lease_msecs);
 #define extra_size_PVFS_servresp_getattr \
     extra_size_PVFS_object_attr
 
@@ -1284,13 +1305,23 @@ endecode_fields_3_struct(
 /*   handle on a remote server. There could be multiple desti- */
 /*   nation data handles. dst_count tells us how many there    */
 /*   are.                                                      */
+/* - offset and length select a byte range of the datahandle;  */
+/*   a length of zero copies everything from offset to the end */
+/*   of the bstream.  Clients use this to copy files without   */
+/*   moving the data through the client (PVFS_sys_copy); they  */
+/*   pass the capability of the destination metafile, which    */
+/*   the source server uses for its write requests.            */
 struct PVFS_servreq_mirror
 {
     PVFS_handle src_handle;
     PVFS_handle *dst_handle;
+    PVFS_handle dst_meta_handle;
+    PVFS_capability dst_capability;
     PVFS_fs_id  fs_id;
     PINT_dist   *dist;
-    uint32_t    bsize;
+    PVFS_size   bsize;
+    PVFS_offset offset;
+    PVFS_size   length;
     uint32_t    src_server_nr;
     uint32_t    *wcIndex;
     uint32_t     dst_count;
@@ -1299,48 +1330,57 @@ struct PVFS_servreq_mirror
 };
 
 #ifdef __PINT_REQPROTO_ENCODE_FUNCS_C
-#define encode_PVFS_servreq_mirror(pptr,x) do {      \
-   int i;                                            \
-   encode_PVFS_handle(pptr,&(x)->src_handle);        \
-   encode_PVFS_fs_id(pptr,&(x)->fs_id);              \
-   encode_PINT_dist(pptr,&(x)->dist);                \
-   encode_uint32_t(pptr,&(x)->bsize);                \
-   encode_uint32_t(pptr,&(x)->src_server_nr);        \
-   encode_uint32_t(pptr,&(x)->dst_count);            \
-   encode_enum(pptr,&(x)->flow_type);                \
-   encode_enum(pptr,&(x)->encoding);                 \
-   for (i=0; i<(x)->dst_count; i++)                  \
-   {                                                 \
-       encode_PVFS_handle(pptr,&(x)->dst_handle[i]); \
-       encode_uint32_t(pptr,&(x)->wcIndex[i]);       \
-   }                                                 \
+#define encode_PVFS_servreq_mirror(pptr,x) do {           \
+   int i;                                                 \
+   encode_PVFS_handle(pptr,&(x)->src_handle);             \
+   encode_PVFS_handle(pptr,&(x)->dst_meta_handle);        \
+   encode_PVFS_capability(pptr,&(x)->dst_capability);     \
+   encode_PVFS_fs_id(pptr,&(x)->fs_id);                   \
+   encode_PINT_dist(pptr,&(x)->dist);                     \
+   encode_PVFS_size(pptr,&(x)->bsize);                    \
+   encode_PVFS_offset(pptr,&(x)->offset);                 \
+   encode_PVFS_size(pptr,&(x)->length);                   \
+   encode_uint32_t(pptr,&(x)->src_server_nr);             \
+   encode_uint32_t(pptr,&(x)->dst_count);                 \
+   encode_enum(pptr,&(x)->flow_type);                     \
+   encode_enum(pptr,&(x)->encoding);                      \
+   for (i=0; i<(x)->dst_count; i++)                       \
+   {                                                      \
+       encode_PVFS_handle(pptr,&(x)->dst_handle[i]);      \
+       encode_uint32_t(pptr,&(x)->wcIndex[i]);            \
+   }                                                      \
 } while (0)
 
-#define decode_PVFS_servreq_mirror(pptr,x) do {          \
-   int i;                                                \
-   decode_PVFS_handle(pptr,&(x)->src_handle);            \
-   decode_PVFS_fs_id(pptr,&(x)->fs_id);                  \
-   decode_PINT_dist(pptr,&(x)->dist);                    \
-   decode_uint32_t(pptr,&(x)->bsize);                    \
-   decode_uint32_t(pptr,&(x)->src_server_nr);            \
-   decode_uint32_t(pptr,&(x)->dst_count);                \
-   decode_enum(pptr,&(x)->flow_type);                    \
-   decode_enum(pptr,&(x)->encoding);                     \
-   (x)->dst_handle = decode_malloc((x)->dst_count *      \
-                                   sizeof(PVFS_handle)); \
-   (x)->wcIndex = decode_malloc((x)->dst_count *         \
-                               sizeof(uint32_t));        \
-   for (i=0; i<(x)->dst_count; i++)                      \
-   {                                                     \
-       decode_PVFS_handle(pptr,&(x)->dst_handle[i]);     \
-       decode_uint32_t(pptr,&(x)->wcIndex[i]);           \
-   }                                                     \
+#define decode_PVFS_servreq_mirror(pptr,x) do {           \
+   int i;                                                 \
+   decode_PVFS_handle(pptr,&(x)->src_handle);             \
+   decode_PVFS_handle(pptr,&(x)->dst_meta_handle);        \
+   decode_PVFS_capability(pptr,&(x)->dst_capability);     \
+   decode_PVFS_fs_id(pptr,&(x)->fs_id);                   \
+   decode_PINT_dist(pptr,&(x)->dist);                     \
+   decode_PVFS_size(pptr,&(x)->bsize);                    \
+   decode_PVFS_offset(pptr,&(x)->offset);                 \
+   decode_PVFS_size(pptr,&(x)->length);                   \
+   decode_uint32_t(pptr,&(x)->src_server_nr);             \
+   decode_uint32_t(pptr,&(x)->dst_count);                 \
+   decode_enum(pptr,&(x)->flow_type);                     \
+   decode_enum(pptr,&(x)->encoding);                      \
+   (x)->dst_handle = decode_malloc((x)->dst_count *       \
+                                   sizeof(PVFS_handle));  \
+   (x)->wcIndex = decode_malloc((x)->dst_count *          \
+                               sizeof(uint32_t));         \
+   for (i=0; i<(x)->dst_count; i++)                       \
+   {                                                      \
+       decode_PVFS_handle(pptr,&(x)->dst_handle[i]);      \
+       decode_uint32_t(pptr,&(x)->wcIndex[i]);            \
+   }                                                      \
 } while (0)
 #endif
 
 #define extra_size_PVFS_servreq_mirror                      \
    ( (sizeof(PVFS_handle) * PVFS_REQ_LIMIT_HANDLES_COUNT) + \
-     (sizeof(uint32_t) * PVFS_REQ_LIMIT_HANDLES_COUNT) )
+     (sizeof(uint32_t) * PVFS_REQ_LIMIT_HANDLES_COUNT) +    \
+     extra_size_PVFS_capability )
 
 /*Response to mirror request.  Identifies the number of bytes written and the */
 /*status of that write for each source-destination handle pair. (Source is    */
@@ -1349,7 +1389,7 @@ struct PVFS_servresp_mirror
 {
     PVFS_handle src_handle;
     uint32_t src_server_nr;
-    uint32_t *bytes_written;
+    PVFS_size *bytes_written;
     uint32_t *write_status_code;
     uint32_t dst_count;
 };
@@ -1362,7 +1402,7 @@ struct PVFS_servresp_mirror
    encode_uint32_t(pptr,&(x)->dst_count);                \
    for (i=0; i<(x)->dst_count; i++)                      \
    {                                                     \
-       encode_uint32_t(pptr,&(x)->bytes_written[i]);     \
+       encode_PVFS_size(pptr,&(x)->bytes_written[i]);    \
        encode_uint32_t(pptr,&(x)->write_status_code[i]); \
    }                                                     \
 } while (0)
@@ -1373,19 +1413,19 @@ struct PVFS_servresp_mirror
   decode_uint32_t(pptr,&(x)->src_server_nr);                \
   decode_uint32_t(pptr,&(x)->dst_count);                    \
   (x)->bytes_written     = decode_malloc((x)->dst_count *   \
-                                         sizeof(uint32_t)); \
+                                         sizeof(PVFS_size));\
   (x)->write_status_code = decode_malloc((x)->dst_count *   \
                                          sizeof(uint32_t)); \
   for (i=0; i<(x)->dst_count; i++ )                         \
   {                                                         \
-      decode_uint32_t(pptr,&(x)->bytes_written[i]);         \
+      decode_PVFS_size(pptr,&(x)->bytes_written[i]);        \
       decode_uint32_t(pptr,&(x)->write_status_code[i]);     \
   }                                                         \
 } while (0)
 #endif
 
-#define extra_size_PVFS_servresp_mirror                 \
-  ( (sizeof(uint32_t) * PVFS_REQ_LIMIT_HANDLES_COUNT) + \
+#define extra_size_PVFS_servresp_mirror                  \
+  ( (sizeof(PVFS_size) * PVFS_REQ_LIMIT_HANDLES_COUNT) + \
     (sizeof(uint32_t) * PVFS_REQ_LIMIT_HANDLES_COUNT) )
 
 
@@ -1423,6 +1463,103 @@ do {                                            \
     (__req).u.truncate.handle = (__handle);     \
 } while (0)
 
+/* seek ********************************************************/
+/* - finds the next data or hole in a datafile */
+
+struct PVFS_servreq_seek
+{
+    PVFS_handle handle; /* handle of datafile */
+    PVFS_fs_id fs_id;   /* file system */
+    PVFS_offset offset; /* datafile offset to start from */
+    int32_t whence;     /* PVFS_SEEK_DATA or PVFS_SEEK_HOLE */
+};
+endecode_fields_5_struct(
+    PVFS_servreq_seek,
+    PVFS_handle, handle,
+    PVFS_fs_id, fs_id,
+    skip4,,
+    PVFS_offset, offset,
+    int32_t, whence);
+#define PINT_SERVREQ_SEEK_FILL(__req,           \
+                               __cap,           \
+                               __fsid,          \
+                               __handle,        \
+                               __offset,        \
+                               __whence,        \
+                               __hints)         \
+do {                                            \
+    memset(&(__req), 0, sizeof(__req));         \
+    (__req).op = PVFS_SERV_SEEK;                \
+    PVFS_REQ_COPY_CAPABILITY((__cap), (__req)); \
+    (__req).hints = (__hints);                  \
+    (__req).u.seek.fs_id = (__fsid);            \
+    (__req).u.seek.handle = (__handle);         \
+    (__req).u.seek.offset = (__offset);         \
+    (__req).u.seek.whence = (__whence);         \
+} while (0)
+
+struct PVFS_servresp_seek
+{
+    PVFS_offset offset; /* -1 if seeking data and there is none */
+};
+endecode_fields_1_struct(
+    PVFS_servresp_seek,
+    PVFS_offset, offset);
+
+/* lease_break *************************************************/
+/* - sent by a server, unexpected, to a client holding a lease on the
+ * attributes of an object that has just been modified or removed; the
+ * client answers with a bare response once it has dropped them
+ */
+
+struct PVFS_servreq_lease_break
+{
+    PVFS_handle handle; /* handle of leased object */
+    PVFS_fs_id fs_id;   /* file system */
+};
+endecode_fields_3_struct(
+    PVFS_servreq_lease_break,
+    PVFS_handle, handle,
+    PVFS_fs_id, fs_id,
+    skip4,);
+#define PINT_SERVREQ_LEASE_BREAK_FILL(__req,    \
+                                      __fsid,   \
+                                      __handle) \
+do {                                            \
+    memset(&(__req), 0, sizeof(__req));         \
+    (__req).op = PVFS_SERV_LEASE_BREAK;         \
+    (__req).u.lease_break.fs_id = (__fsid);     \
+    (__req).u.lease_break.handle = (__handle);  \
+} while (0)
+
+/* size_notify *************************************************/
+/* - sent by a server to the server of a metafile whose size it caches,
+ * before a datafile of that metafile is written or truncated; a null
+ * handle stands for every metafile, as after the sender restarted
+ */
+
+struct PVFS_servreq_size_notify
+{
+    PVFS_handle handle; /* handle of metafile */
+    PVFS_fs_id fs_id;   /* file system */
+};
+endecode_fields_3_struct(
+    PVFS_servreq_size_notify,
+    PVFS_handle, handle,
+    PVFS_fs_id, fs_id,
+    skip4,);
+#define PINT_SERVREQ_SIZE_NOTIFY_FILL(__req,    \
+                                      __cap,    \
+                                      __fsid,   \
+                                      __handle) \
+do {                                            \
+    memset(&(__req), 0, sizeof(__req));         \
+    (__req).op = PVFS_SERV_SIZE_NOTIFY;         \
+    PVFS_REQ_COPY_CAPABILITY((__cap), (__req)); \
+    (__req).u.size_notify.fs_id = (__fsid);     \
+    (__req).u.size_notify.handle = (__handle);  \
+} while (0)
+
 /* statfs ****************************************************/
 /* - retrieves statistics for a particular file system */
 
@@ -1810,7 +1947,7 @@ do {                                                                \
 
 /* mgmt_noop ********************************************************/
 /* - does nothing except contact a server to see if it is responding
- * to requests
+ * to requests, and report how far along its startup is
  */
 
 #define PINT_SERVREQ_MGMT_NOOP_FILL(__req, __cap, __hints) \
@@ -1821,6 +1958,14 @@ do {                                                       \
     (__req).hints = (__hints);                             \
 } while (0)
 
+struct PVFS_servresp_mgmt_noop
+{
+    int32_t startup_phase; /* enum PVFS_server_startup_phase */
+};
+endecode_fields_1_struct(
+    PVFS_servresp_mgmt_noop,
+    int32_t, startup_phase);
+
 
 /* mgmt_perf_mon ****************************************************/
 /* retrieves performance statistics from server */
@@ -2068,6 +2213,70 @@ endecode_fields_1aa_struct(
     ((PVFS_REQ_LIMIT_EATTR_VAL_LEN + sizeof(PVFS_error)) \
      * PVFS_REQ_LIMIT_EATTR_LIST)
 
+/* geteattr_bulk ***********************************************/
+/* - retrieves the same list of extended attributes from many objects */
+
+struct PVFS_servreq_geteattr_bulk
+{
+    PVFS_fs_id fs_id;     /* file system */
+    uint32_t nhandles;    /* number of target objects */
+    PVFS_handle *handles; /* array of target objects */
+    int32_t valsz;        /* value buffer size, the same for every key */
+    int32_t nkey;         /* number of keys to read from each object */
+    PVFS_ds_keyval *key;  /* array of keys to read */
+};
+endecode_fields_1a_1a_struct(
+    PVFS_servreq_geteattr_bulk,
+    PVFS_fs_id, fs_id,
+    uint32_t, nhandles,
+    PVFS_handle, handles,
+    int32_t, valsz,
+    int32_t, nkey,
+    PVFS_ds_keyval, key);
+#define extra_size_PVFS_servreq_geteattr_bulk             \
+    (PVFS_REQ_LIMIT_LISTATTR * sizeof(PVFS_handle) +      \
+     roundup8(4 + PVFS_REQ_LIMIT_EATTR_KEY_LEN) * PVFS_REQ_LIMIT_EATTR_LIST)
+
+#define PINT_SERVREQ_GETEATTR_BULK_FILL(__req,          \
+                                        __cap,          \
+                                        __fsid,         \
+                                        __nhandles,     \
+                                        __handle_array, \
+                                        __nkey,         \
+                                        __key_array,    \
+                                        __valsz,        \
+                                        __hints)        \
+do {                                                    \
+    memset(&(__req), 0, sizeof(__req));                 \
+    (__req).op = PVFS_SERV_GETEATTR_BULK;               \
+    PVFS_REQ_COPY_CAPABILITY((__cap), (__req));         \
+    (__req).hints = (__hints);                          \
+    (__req).u.geteattr_bulk.fs_id = (__fsid);           \
+    (__req).u.geteattr_bulk.nhandles = (__nhandles);    \
+    (__req).u.geteattr_bulk.handles = (__handle_array); \
+    (__req).u.geteattr_bulk.valsz = (__valsz);          \
+    (__req).u.geteattr_bulk.nkey = (__nkey);            \
+    (__req).u.geteattr_bulk.key = (__key_array);        \
+} while (0)
+
+/* values and errors are ordered by handle, then by key */
+struct PVFS_servresp_geteattr_bulk
+{
+    int32_t count;          /* nhandles * nkey */
+    PVFS_ds_keyval *val;    /* array of values returned */
+    PVFS_error *err;        /* array of error codes */
+};
+endecode_fields_1aa_struct(
+    PVFS_servresp_geteattr_bulk,
+    skip4,,
+    int32_t, count,
+    PVFS_ds_keyval, val,
+    PVFS_error, err);
+#define extra_size_PVFS_servresp_geteattr_bulk                 \
+    (PVFS_REQ_LIMIT_GETEATTR_BULK_BYTES +                      \
+     (8 + 4 + sizeof(PVFS_error)) * PVFS_REQ_LIMIT_LISTATTR *  \
+     PVFS_REQ_LIMIT_EATTR_LIST)
+
 /* seteattr ****************************************************/
 /* - sets list of extended attributes */
 
@@ -2587,6 +2796,7 @@ struct PVFS_server_req
         struct PVFS_servreq_mgmt_remove_dirent mgmt_remove_dirent;
         struct PVFS_servreq_mgmt_get_dirdata_handle mgmt_get_dirdata_handle;
         struct PVFS_servreq_geteattr geteattr;
+        struct PVFS_servreq_geteattr_bulk geteattr_bulk;
         struct PVFS_servreq_seteattr seteattr;
         struct PVFS_servreq_atomiceattr atomiceattr;
         struct PVFS_servreq_deleattr deleattr;
@@ -2603,6 +2813,9 @@ struct PVFS_server_req
         struct PVFS_servreq_mgmt_split_dirent mgmt_split_dirent;
         struct PVFS_servreq_mgmt_get_user_cert mgmt_get_user_cert;
         struct PVFS_servreq_mgmt_get_user_cert_keyreq mgmt_get_user_cert_keyreq;
+        struct PVFS_servreq_seek seek;
+        struct PVFS_servreq_lease_break lease_break;
+        struct PVFS_servreq_size_notify size_notify;
     } u;
 };
 #ifdef __PINT_REQPROTO_ENCODE_FUNCS_C
@@ -2649,12 +2862,14 @@ struct PVFS_server_resp
         struct PVFS_servresp_io io;
         struct PVFS_servresp_write_completion write_completion;
         struct PVFS_servresp_statfs statfs;
+        struct PVFS_servresp_mgmt_noop mgmt_noop;
         struct PVFS_servresp_mgmt_perf_mon mgmt_perf_mon;
         struct PVFS_servresp_mgmt_iterate_handles mgmt_iterate_handles;
         struct PVFS_servresp_mgmt_dspace_info_list mgmt_dspace_info_list;
         struct PVFS_servresp_mgmt_event_mon mgmt_event_mon;
         struct PVFS_servresp_mgmt_get_dirdata_handle mgmt_get_dirdata_handle;
         struct PVFS_servresp_geteattr geteattr;
+        struct PVFS_servresp_geteattr_bulk geteattr_bulk;
         struct PVFS_servresp_atomiceattr atomiceattr;
         struct PVFS_servresp_listeattr listeattr;
         struct PVFS_servresp_small_io small_io;
@@ -2667,6 +2882,7 @@ struct PVFS_server_resp
         struct PVFS_servresp_mgmt_get_dirent mgmt_get_dirent;
         struct PVFS_servresp_mgmt_get_user_cert mgmt_get_user_cert;
         struct PVFS_servresp_mgmt_get_user_cert_keyreq mgmt_get_user_cert_keyreq;
+        struct PVFS_servresp_seek seek;
     } u;
 };
 endecode_fields_2_struct(
@@ -208,9 +208,13 @@ int PINT_perm_check(struct PINT_server_op *s_op)
             /* remove ops use parent handle from hint */
             case PVFS_SERV_REMOVE:
             case PVFS_SERV_TREE_REMOVE:
+            case PVFS_SERV_BATCH_REMOVE:
+            /* geteattr_bulk uses the directory its handles came from */
+            case PVFS_SERV_GETEATTR_BULK:
             /* io ops use metafile handle from hint */            
             case PVFS_SERV_SMALL_IO:
             case PVFS_SERV_IO:
+            case PVFS_SERV_MIRROR:
                 handle = PINT_HINT_GET_HANDLE(s_op->req->hints);
                 if (handle == PVFS_HANDLE_NULL)
                 {
@@ -0,0 +1,341 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "quickhash.h"
+#include "quicklist.h"
+#include "pint-util.h"
+#include "lease.h"
+
+#define LEASE_TABLE_SIZE 1021
+/* how often the timer drops leases nobody recalled */
+#define LEASE_SWEEP_MSECS 10000
+
+struct lease_entry
+{
+    struct qhash_head hash_link;
+    struct qlist_head list_link;
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+    PVFS_time expires;           /* latest expiry among the holders */
+    int count;
+    int size;
+    struct PINT_lease_holder *holders;
+};
+
+struct lease_key
+{
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+};
+
+static struct qhash_table *lease_table = NULL;
+static QLIST_HEAD(lease_list);
+static int lease_entry_count = 0;
+static PVFS_time lease_last_sweep = 0;
+static gen_mutex_t lease_mutex = GEN_MUTEX_INITIALIZER;
+
+static int lease_compare(const void *key, struct qhash_head *link)
+{
+    const struct lease_key *k = key;
+    struct lease_entry *e = qhash_entry(link, struct lease_entry, hash_link);
+
+    return (e->handle == k->handle && e->fs_id == k->fs_id);
+}
+
+static int lease_hash(const void *key, int table_size)
+{
+    const struct lease_key *k = key;
+
+    return (int)((k->handle ^ ((uint64_t)k->fs_id << 32)) %
+                 (uint64_t)table_size);
+}
+
+static void lease_entry_free(struct lease_entry *e)
+{
+    qhash_del(&e->hash_link);
+    qlist_del(&e->list_link);
+    lease_entry_count--;
+    free(e->holders);
+    free(e);
+}
+
+/* drops the holders of e whose lease ran out; returns the number left */
+static int lease_entry_prune(struct lease_entry *e, PVFS_time now)
+{
+    int i, j;
+
+    e->expires = 0;
+    for (i = 0, j = 0; i < e->count; i++)
+    {
+        if (e->holders[i].expires > now)
+        {
+            e->holders[j++] = e->holders[i];
+            if (e->holders[i].expires > e->expires)
+            {
+                e->expires = e->holders[i].expires;
+            }
+        }
+    }
+    e->count = j;
+    return j;
+}
+
+/* PINT_lease_initialize()
+ *
+ * sets up the lease table
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_lease_initialize(void)
+{
+    lease_table = qhash_init(lease_compare, lease_hash, LEASE_TABLE_SIZE);
+    if (!lease_table)
+    {
+        return -PVFS_ENOMEM;
+    }
+    lease_entry_count = 0;
+    lease_last_sweep = PINT_util_get_time_ms();
+    return 0;
+}
+
+/* PINT_lease_finalize()
+ *
+ * forgets all leases
+ */
+void PINT_lease_finalize(void)
+{
+    struct lease_entry *e, *tmp;
+
+    gen_mutex_lock(&lease_mutex);
+    if (lease_table)
+    {
+        qlist_for_each_entry_safe(e, tmp, &lease_list, list_link)
+        {
+            lease_entry_free(e);
+        }
+        qhash_finalize(lease_table);
+        lease_table = NULL;
+    }
+    gen_mutex_unlock(&lease_mutex);
+}
+
+/* PINT_lease_grant()
+ *
+ * records holder as having the attributes of handle for lease_msecs;
+ * a holder that already has a lease on it gets a fresh one
+ *
+ * returns the lease granted in msecs, 0 if none could be
+ */
+uint32_t PINT_lease_grant(PVFS_fs_id fs_id,
+                          PVFS_handle handle,
+                          PVFS_BMI_addr_t holder,
+                          uint32_t lease_msecs)
+{
+    struct lease_key key;
+    struct qhash_head *link;
+    struct lease_entry *e;
+    struct PINT_lease_holder *tmp_holders;
+    PVFS_time now, expires;
+    int i;
+
+    if (lease_msecs == 0)
+    {
+        return 0;
+    }
+
+    key.fs_id = fs_id;
+    key.handle = handle;
+    now = PINT_util_get_time_ms();
+    expires = now + lease_msecs;
+
+    gen_mutex_lock(&lease_mutex);
+
+    if (!lease_table)
+    {
+        gen_mutex_unlock(&lease_mutex);
+        return 0;
+    }
+
+    link = qhash_search(lease_table, &key);
+    if (link)
+    {
+        e = qhash_entry(link, struct lease_entry, hash_link);
+    }
+    else
+    {
+        if (lease_entry_count >= PINT_LEASE_MAX_ENTRIES)
+        {
+            gen_mutex_unlock(&lease_mutex);
+            return 0;
+        }
+        e = calloc(1, sizeof(*e));
+        if (!e)
+        {
+            gen_mutex_unlock(&lease_mutex);
+            return 0;
+        }
+        e->fs_id = fs_id;
+        e->handle = handle;
+        qhash_add(lease_table, &key, &e->hash_link);
+        qlist_add_tail(&e->list_link, &lease_list);
+        lease_entry_count++;
+    }
+
+    for (i = 0; i < e->count; i++)
+    {
+        if (e->holders[i].addr == holder)
+        {
+            break;
+        }
+    }
+
+    if (i == e->count)
+    {
+        if (e->count == PINT_LEASE_MAX_HOLDERS &&
+            lease_entry_prune(e, now) == PINT_LEASE_MAX_HOLDERS)
+        {
+            gen_mutex_unlock(&lease_mutex);
+            return 0;
+        }
+        if (e->count == e->size)
+        {
+            int new_size = e->size ? e->size * 2 : 4;
+
+            tmp_holders = realloc(e->holders, new_size * sizeof(*tmp_holders));
+            if (!tmp_holders)
+            {
+                if (e->count == 0)
+                {
+                    lease_entry_free(e);
+                }
+                gen_mutex_unlock(&lease_mutex);
+                return 0;
+            }
+            e->holders = tmp_holders;
+            e->size = new_size;
+        }
+        i = e->count++;
+        e->holders[i].addr = holder;
+    }
+
+    e->holders[i].expires = expires;
+    if (expires > e->expires)
+    {
+        e->expires = expires;
+    }
+
+    gen_mutex_unlock(&lease_mutex);
+    return lease_msecs;
+}
+
+/* PINT_lease_recall()
+ *
+ * ends all leases on handle.  The holders other than modifier whose
+ * lease has not yet run out are returned, with the time each lease
+ * runs out, in a new array in *holders, which the caller frees.
+ *
+ * returns the number of holders, -PVFS_error on failure
+ */
+int PINT_lease_recall(PVFS_fs_id fs_id,
+                      PVFS_handle handle,
+                      PVFS_BMI_addr_t modifier,
+                      struct PINT_lease_holder **holders)
+{
+    struct lease_key key;
+    struct qhash_head *link;
+    struct lease_entry *e;
+    struct PINT_lease_holder *out;
+    PVFS_time now;
+    int i, count = 0;
+
+    *holders = NULL;
+    key.fs_id = fs_id;
+    key.handle = handle;
+
+    gen_mutex_lock(&lease_mutex);
+
+    if (!lease_table || !(link = qhash_search(lease_table, &key)))
+    {
+        gen_mutex_unlock(&lease_mutex);
+        return 0;
+    }
+    e = qhash_entry(link, struct lease_entry, hash_link);
+
+    now = PINT_util_get_time_ms();
+    lease_entry_prune(e, now);
+    if (e->count > 0)
+    {
+        out = malloc(e->count * sizeof(*out));
+        if (!out)
+        {
+            gen_mutex_unlock(&lease_mutex);
+            return -PVFS_ENOMEM;
+        }
+        for (i = 0; i < e->count; i++)
+        {
+            if (e->holders[i].addr != modifier)
+            {
+                out[count++] = e->holders[i];
+            }
+        }
+        if (count)
+        {
+            *holders = out;
+        }
+        else
+        {
+            free(out);
+        }
+    }
+    lease_entry_free(e);
+
+    gen_mutex_unlock(&lease_mutex);
+
+    gossip_debug(GOSSIP_SERVER_DEBUG, "%s: %llu,%d: %d holder(s)\n",
+                 __func__, llu(handle), fs_id, count);
+    return count;
+}
+
+/* PINT_lease_expire()
+ *
+ * drops objects whose leases have all run out; meant to be called
+ * regularly, it only walks the table every LEASE_SWEEP_MSECS
+ */
+void PINT_lease_expire(void)
+{
+    struct lease_entry *e, *tmp;
+    PVFS_time now = PINT_util_get_time_ms();
+
+    gen_mutex_lock(&lease_mutex);
+    if (lease_table && now - lease_last_sweep >= LEASE_SWEEP_MSECS)
+    {
+        lease_last_sweep = now;
+        qlist_for_each_entry_safe(e, tmp, &lease_list, list_link)
+        {
+            if (e->expires <= now)
+            {
+                lease_entry_free(e);
+            }
+        }
+    }
+    gen_mutex_unlock(&lease_mutex);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,55 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Attribute leases.  A getattr from a client that asked for one records
+ * the client as a holder of a lease on the object for a fixed time.
+ * Whoever then modifies or removes the object recalls the lease, which
+ * hands back the other holders, and when their leases run out, so they
+ * can be told to drop their copy.
+ * Holders that are never recalled age out of the table.
+ */
+
+#ifndef __LEASE_H
+#define __LEASE_H
+
+#include "pvfs2-types.h"
+
+/* most clients remembered per object; later ones get no lease */
+#define PINT_LEASE_MAX_HOLDERS 64
+/* most objects with leases outstanding */
+#define PINT_LEASE_MAX_ENTRIES 65536
+
+struct PINT_lease_holder
+{
+    PVFS_BMI_addr_t addr;
+    PVFS_time expires;           /* ms, from PINT_util_get_time_ms() */
+};
+
+int PINT_lease_initialize(void);
+void PINT_lease_finalize(void);
+
+uint32_t PINT_lease_grant(PVFS_fs_id fs_id,
+                          PVFS_handle handle,
+                          PVFS_BMI_addr_t holder,
+                          uint32_t lease_msecs);
+
+int PINT_lease_recall(PVFS_fs_id fs_id,
+                      PVFS_handle handle,
+                      PVFS_BMI_addr_t modifier,
+                      struct PINT_lease_holder **holders);
+
+void PINT_lease_expire(void);
+
+#endif /* __LEASE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -29,6 +29,11 @@ extern struct PINT_server_req_params pvfs2_rmdirent_params;
 extern struct PINT_server_req_params pvfs2_chdirent_params;
 extern struct PINT_server_req_params pvfs2_flush_params;
 extern struct PINT_server_req_params pvfs2_truncate_params;
+extern struct PINT_server_req_params pvfs2_seek_params;
+extern struct PINT_server_req_params pvfs2_lease_break_params;
+extern struct PINT_server_req_params pvfs2_size_notify_params;
+extern struct PINT_server_req_params pvfs2_size_refresh_params;
+extern struct PINT_server_req_params pvfs2_get_eattr_bulk_params;
 extern struct PINT_server_req_params pvfs2_setparam_params;
 extern struct PINT_server_req_params pvfs2_noop_params;
 extern struct PINT_server_req_params pvfs2_unexpected_params;
@@ -121,11 +126,16 @@ struct PINT_server_req_entry PINT_server_req_table[] =
     /* 49 */ {PVFS_SERV_TREE_GETATTR, &pvfs2_tree_getattr_params},
 #ifdef ENABLE_SECURITY_CERT    
     /* 50 */ {PVFS_SERV_MGMT_GET_USER_CERT, &pvfs2_get_user_cert_params},
-    /* 51 */ {PVFS_SERV_MGMT_GET_USER_CERT_KEYREQ, &pvfs2_get_user_cert_keyreq_params}
+    /* 51 */ {PVFS_SERV_MGMT_GET_USER_CERT_KEYREQ, &pvfs2_get_user_cert_keyreq_params},
 #else
     /* 50 */ {PVFS_SERV_MGMT_GET_USER_CERT, NULL},
     /* 51 */ {PVFS_SERV_MGMT_GET_USER_CERT_KEYREQ, NULL},
 #endif
+    /* 52 */ {PVFS_SERV_SEEK, &pvfs2_seek_params},
+    /* 53 */ {PVFS_SERV_LEASE_BREAK, &pvfs2_lease_break_params},
+    /* 54 */ {PVFS_SERV_GETEATTR_BULK, &pvfs2_get_eattr_bulk_params},
+    /* 55 */ {PVFS_SERV_SIZE_NOTIFY, &pvfs2_size_notify_params},
+    /* 56 */ {PVFS_SERV_SIZE_REFRESH, &pvfs2_size_refresh_params}
 };
 
 #define CHECK_OP(_op_) assert(_op_ == PINT_server_req_table[_op_].op_type)
@@ -46,6 +46,7 @@
 /* #include "pvfs2-internal.h" */
 #include "src/server/request-scheduler/request-scheduler.h"
 #include "pint-event.h"
+#include "pint-trace.h"
 #include "pint-util.h"
 #include "client-state-machine.h"
 /* #include "pint-malloc.h" */
@@ -62,6 +63,10 @@
 #include "certcache.h"
 #endif
 #include "server-config-mgr.h"
+#include "sm-workers.h"
+#include "lease.h"
+#include "size-cache.h"
+#include "pint-slab.h"
 
 #ifndef PVFS2_VERSION
 #define PVFS2_VERSION "Unknown"
@@ -97,6 +102,10 @@ static struct server_configuration_s server_config;
  * after all threads complete and are no longer blocking.
  */
 static int signal_recvd_flag = 0;
+/* set once the posted unexpected receives were cancelled for shutdown */
+static int unexpected_purged = 0;
+/* set by SIGUSR2 to request a dump of the trace rings */
+static int trace_dump_recvd_flag = 0;
 static pid_t server_controlling_pid = 0;
 
 static PINT_event_id PINT_sm_event_id;
@@ -107,9 +116,13 @@ QLIST_HEAD(posted_sop_list);
 QLIST_HEAD(inprogress_sop_list);
 /* A list of all serv_op's that are started automatically without requests */
 static QLIST_HEAD(noreq_sop_list);
+/* protects the three lists above once state machine workers are running */
+gen_mutex_t server_sop_list_mutex = GEN_MUTEX_INITIALIZER;
 
-/* this is used externally by some server state machines */
-job_context_id server_job_context = -1;
+/* context of the main loop; server_job_context gives state machines the
+ * context of the thread they run in
+ */
+static job_context_id server_main_job_context = -1;
 
 typedef struct
 {
@@ -174,14 +187,19 @@ static int server_initialize_subsystems(
     PINT_server_status_flag *server_status_flag);
 static int server_setup_signal_handlers(void);
 static int server_check_if_root_directory_created(void);
+static int server_send_size_restart_notices(void);
 static int server_purge_unexpected_recv_machines(void);
 static int server_setup_process_environment(int background);
 static int server_shutdown(
     PINT_server_status_flag status,
     int ret, int sig);
 static void reload_config(void);
+static int server_start_unexpected_sm(struct PINT_smcb *smcb);
+static int server_start_noreq_sm(struct PINT_smcb *smcb);
 static void server_sig_handler(int sig);
 static void hup_sighandler(int sig, siginfo_t *info, void *secret);
+static void trace_sighandler(int sig);
+static PVFS_handle server_trace_handle(struct PINT_smcb *smcb);
 static int server_parse_cmd_line_args(int argc, char **argv);
 #ifdef __PVFS2_SEGV_BACKTRACE__
 static void bt_sighandler(int sig, siginfo_t *info, void *secret);
@@ -193,6 +211,7 @@ static int generate_shm_key_hint(int* server_index);
 
 static void precreate_pool_finalize(void);
 static int precreate_pool_initialize(int server_index);
+static int server_wait_for_storage(PVFS_fs_id fs_id);
 
 static int precreate_pool_setup_server(const char* host, PVFS_ds_type type,
     PVFS_fs_id fsid, PVFS_handle* pool_handle);
@@ -389,6 +408,15 @@ int main(int argc, char **argv)
         goto server_shutdown;
     }
 
+    /* sizes cached elsewhere were protected by arms this process lost */
+    ret = server_send_size_restart_notices();
+    if (ret < 0)
+    {
+        PVFS_perror_gossip("Error: failed to start size cache restart "
+                           "notices.\n", ret);
+        goto server_shutdown;
+    }
+
     /* we have to take care of creating the distributed root
      * directory and making the lost+found directory if needed */
     ret = server_check_if_root_directory_created();
@@ -406,12 +434,23 @@ int main(int argc, char **argv)
     {
         int i, comp_ct = PVFS_SERVER_TEST_COUNT;
 
+        if (trace_dump_recvd_flag != 0)
+        {
+            trace_dump_recvd_flag = 0;
+            if (server_status_flag & SERVER_TRACE_INIT)
+            {
+                PINT_trace_dump(server_config.trace_dump_file);
+            }
+        }
+
         if (signal_recvd_flag != 0)
         {
             /* If the signal is a SIGHUP, catch and reload configuration */
             if (signal_recvd_flag == SIGHUP)
             {
+                server_sm_workers_pause();
                 reload_config();
+                server_sm_workers_resume();
 
                 /* re-open log file to allow normal rotation */
                 gossip_reopen_file(server_config.logfile, "a");
@@ -431,7 +470,26 @@ int main(int argc, char **argv)
                  * all s_ops (for expected messages) have either finished or
                  * timed out,
                  */
-                if (qlist_empty(&inprogress_sop_list))
+                int drained;
+
+                if (!unexpected_purged)
+                {
+                    /*
+                     * iterate through all the machines that we had posted
+                     * for unexpected BMI messages and deallocate them.
+                     * From now the server will only try and finish
+                     * operations that are already in progress, wait for
+                     * them to timeout or complete before initiating
+                     * shutdown
+                     */
+                    server_purge_unexpected_recv_machines();
+                    unexpected_purged = 1;
+                }
+
+                gen_mutex_lock(&server_sop_list_mutex);
+                drained = qlist_empty(&inprogress_sop_list);
+                gen_mutex_unlock(&server_sop_list_mutex);
+                if (drained)
                 {
                     ret = 0;
                     siglevel = signal_recvd_flag;
@@ -445,7 +503,7 @@ int main(int argc, char **argv)
                               server_completed_job_p_array,
                               server_job_status_array,
                               PVFS2_SERVER_DEFAULT_TIMEOUT_MS,
-                              server_job_context);
+                              server_main_job_context);
         if (ret < 0)
         {
             gossip_lerr("pvfs2-server panic; main loop aborting\n");
@@ -544,7 +602,8 @@ static int server_initialize(
     
     assert(server_config.logfile != NULL);
 
-    if(!strcmp(server_config.logtype, "file"))
+    if(!strcmp(server_config.logtype, "file") ||
+       !strcmp(server_config.logtype, "async"))
     {
         dummy = fopen(server_config.logfile, "a");
         if (dummy == NULL)
@@ -575,6 +634,12 @@ static int server_initialize(
         {
             ret = gossip_enable_file(server_config.logfile, "a");
         }
+        else if(!strcmp(server_config.logtype, "async"))
+        {
+            ret = gossip_enable_async(server_config.logfile, "a",
+                                      server_config.log_buffer_size,
+                                      server_config.log_rate_limit);
+        }
         else
         {
             ret = gossip_enable_stderr();
@@ -672,6 +737,16 @@ static int server_initialize(
 
     *server_status_flag |= SERVER_STATE_MACHINE_INIT;
 
+    /* with workers, every state machine from here on runs on one of them */
+    ret = server_sm_workers_initialize(server_config.sm_worker_threads);
+    if (ret < 0)
+    {
+        gossip_err("Error: Could not start state machine workers\n");
+        return ret;
+    }
+
+    *server_status_flag |= SERVER_SM_WORKERS_INIT;
+
     /* Post starting set of BMI unexpected msg buffers */
     for (i = 0; i < server_config.initial_unexpected_requests; i++)
     {
@@ -788,11 +863,12 @@ static int server_initialize_subsystems(
     PINT_llist *cur = NULL;
     struct filesystem_configuration_s *cur_fs;
     TROVE_context_id trove_context = -1;
-    char buf[16] = {0};
+    char buf[32] = {0};
     PVFS_fs_id orig_fsid=0;
     PVFS_ds_flags init_flags = 0;
     int bmi_flags = BMI_INIT_SERVER;
     int server_index;
+    int staged_startup = 1;
 
     if(server_config.enable_events)
     {
@@ -813,6 +889,19 @@ static int server_initialize_subsystems(
         *server_status_flag |= SERVER_EVENT_INIT;
     }
 
+    if(server_config.trace_ring_entries > 0)
+    {
+        ret = PINT_trace_init(server_config.trace_ring_entries);
+        if (ret < 0)
+        {
+            gossip_err("Error initializing trace rings.\n");
+            return (ret);
+        }
+        PINT_trace_set_handle_fn(server_trace_handle);
+
+        *server_status_flag |= SERVER_TRACE_INIT;
+    }
+
     /* Initialize distributions */
     ret = PINT_dist_initialize(0);
     if (ret < 0)
@@ -892,6 +981,14 @@ static int server_initialize_subsystems(
     /* this should never fail */
     assert(ret == 0);
 
+    /* rebuild handle ledgers and clear stranded bstreams in the
+     * background, so reads are answered as soon as the databases are
+     * open; see server_get_startup_phase()
+     */
+    ret = trove_collection_setinfo(0, 0, TROVE_STAGED_STARTUP,
+                                   &staged_startup);
+    assert(ret == 0);
+
     generate_shm_key_hint(&server_index);
 
 /********/
@@ -1171,6 +1268,17 @@ static int server_initialize_subsystems(
                 return ret;
             } 
 
+            ret = trove_collection_setinfo(
+                                  cur_fs->coll_id,
+                                  trove_context,
+                                  TROVE_COLLECTION_READAHEAD_SIZE,
+                                  (void *)&cur_fs->readahead_size);
+            if(ret < 0)
+            {
+                gossip_err("Error setting trove readahead size\n");
+                return ret;
+            } 
+
             gossip_debug(GOSSIP_SERVER_DEBUG, "File system %s using "
                          "handles:\n\t%s\n", cur_fs->file_system_name,
                          cur_merged_handle_range);
@@ -1199,8 +1307,10 @@ static int server_initialize_subsystems(
             /* format and pass sync mode to the flow implementation 
              * for each file system configured
              */
-            snprintf(buf, 16, "%d,%d", cur_fs->coll_id, cur_fs->trove_sync_data);
+            snprintf(buf, 32, "%d,%d", cur_fs->coll_id, cur_fs->trove_sync_data);
             PINT_flow_setinfo(NULL, FLOWPROTO_DATA_SYNC_MODE, buf);
+            snprintf(buf, 32, "%d,%d", cur_fs->coll_id, cur_fs->write_agg_size);
+            PINT_flow_setinfo(NULL, FLOWPROTO_WRITE_AGG_SIZE, buf);
 
             trove_close_context(cur_fs->coll_id, trove_context);
             free(cur_merged_handle_range);
@@ -1237,7 +1347,7 @@ static int server_initialize_subsystems(
 
     *server_status_flag |= SERVER_JOB_INIT;
     
-    ret = job_open_context(&server_job_context);
+    ret = job_open_context(&server_main_job_context);
     if (ret < 0)
     {
         gossip_err("Error opening job context.\n");
@@ -1348,6 +1458,24 @@ static int server_initialize_subsystems(
 
     *server_status_flag |= SERVER_PRECREATE_INIT;
 
+    ret = PINT_lease_initialize();
+    if (ret < 0)
+    {
+        gossip_err("Error initializing the lease table.\n");
+        return (ret);
+    }
+
+    *server_status_flag |= SERVER_LEASE_INIT;
+
+    ret = PINT_size_cache_initialize();
+    if (ret < 0)
+    {
+        gossip_err("Error initializing the size cache.\n");
+        return (ret);
+    }
+
+    *server_status_flag |= SERVER_SIZE_CACHE_INIT;
+
     return ret;
 }
 
@@ -1356,6 +1484,7 @@ static int server_setup_signal_handlers(void)
     struct sigaction new_action;
     struct sigaction ign_action;
     struct sigaction hup_action;
+    struct sigaction trace_action;
     hup_action.sa_sigaction = (void *)hup_sighandler;
     sigemptyset (&hup_action.sa_mask);
     hup_action.sa_flags = SA_RESTART | SA_SIGINFO;
@@ -1376,6 +1505,10 @@ static int server_setup_signal_handlers(void)
     sigemptyset (&ign_action.sa_mask);
     ign_action.sa_flags = 0;
 
+    trace_action.sa_handler = trace_sighandler;
+    sigemptyset (&trace_action.sa_mask);
+    trace_action.sa_flags = SA_RESTART;
+
     /* catch these */
     sigaction (SIGILL, &new_action, NULL);
     sigaction (SIGTERM, &new_action, NULL);
@@ -1393,7 +1526,7 @@ static int server_setup_signal_handlers(void)
     /* ignore these */
     sigaction (SIGPIPE, &ign_action, NULL);
     sigaction (SIGUSR1, &ign_action, NULL);
-    sigaction (SIGUSR2, &ign_action, NULL);
+    sigaction (SIGUSR2, &trace_action, NULL);
 
     return 0;
 }
@@ -1473,6 +1606,13 @@ static int server_check_if_root_directory_created( void )
 
             if(js.error_code != 0)
             {
+                /* creating the root directory needs the handle ledger */
+                ret = server_wait_for_storage(cur_fs->coll_id);
+                if (ret < 0)
+                {
+                    return ret;
+                }
+
                 /* launch root-dir-create noreq state machine */
                 ret = server_state_machine_alloc_noreq(
                                        PVFS_SERV_MGMT_CREATE_ROOT_DIR,
@@ -1516,6 +1656,36 @@ static int server_check_if_root_directory_created( void )
     return 0;
 }
 
+/* server_send_size_restart_notices()
+ *
+ * starts a size restart notice for each file system that caches sizes
+ */
+static int server_send_size_restart_notices(void)
+{
+    PINT_llist *cur = server_config.file_systems;
+    struct filesystem_configuration_s *cur_fs;
+    int ret;
+
+    while (cur)
+    {
+        cur_fs = PINT_llist_head(cur);
+        if (!cur_fs)
+        {
+            break;
+        }
+        if (cur_fs->size_cache_secs > 0)
+        {
+            ret = PINT_server_size_restart_notice(cur_fs->coll_id);
+            if (ret < 0)
+            {
+                return ret;
+            }
+        }
+        cur = PINT_llist_next(cur);
+    }
+    return 0;
+}
+
 #ifdef __PVFS2_SEGV_BACKTRACE__
 
 #if defined(REG_EIP)
@@ -1561,6 +1731,11 @@ static void bt_sighandler(int sig, siginfo_t *info, void *secret)
     for (i=1; i<trace_size; ++i)
         gossip_err("[bt] %s\n", messages[i]);
 
+    if (server_status_flag & SERVER_TRACE_INIT)
+    {
+        PINT_trace_dump(server_config.trace_dump_file);
+    }
+
     signal_recvd_flag = sig;
     return;
 }
@@ -1592,6 +1767,41 @@ static void hup_sighandler(int sig, siginfo_t *info, void *secret)
     signal_recvd_flag = sig;
 }
 
+/* trace_sighandler()
+ *
+ * requests a dump of the trace rings; the main loop writes the dump.
+ *
+ * no return value
+ */
+static void trace_sighandler(int sig)
+{
+    trace_dump_recvd_flag = sig;
+}
+
+/* server_trace_handle()
+ *
+ * finds the target handle of the request a state machine is working on.
+ * Child state machines are credited to the request of their top level
+ * parent, whose bottom frame is always a PINT_server_op.
+ *
+ * returns the target handle, or PVFS_HANDLE_NULL if it is not known
+ */
+static PVFS_handle server_trace_handle(struct PINT_smcb *smcb)
+{
+    PINT_server_op *s_op;
+
+    while (smcb->parent_smcb)
+    {
+        smcb = smcb->parent_smcb;
+    }
+    if (smcb->frame_count <= 0)
+    {
+        return PVFS_HANDLE_NULL;
+    }
+    s_op = PINT_sm_frame(smcb, -smcb->base_frame);
+    return s_op ? s_op->target_handle : PVFS_HANDLE_NULL;
+}
+
 static void reload_config(void)
 {
     struct server_configuration_s sighup_server_config;
@@ -1803,6 +2013,33 @@ static int server_shutdown(PINT_server_status_flag status,
 
     free(s_server_options.server_alias);
 
+    if (status & SERVER_SM_WORKERS_INIT)
+    {
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting state machine "
+                     "workers     [   ...   ]\n");
+        server_sm_workers_finalize();
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[-]         state machine "
+                     "workers     [ stopped ]\n");
+    }
+
+    if (status & SERVER_SIZE_CACHE_INIT)
+    {
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting size cache "
+                     "              [   ...   ]\n");
+        PINT_size_cache_finalize();
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[-]         size cache "
+                     "              [ stopped ]\n");
+    }
+
+    if (status & SERVER_LEASE_INIT)
+    {
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting lease table "
+                     "             [   ...   ]\n");
+        PINT_lease_finalize();
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[-]         lease table "
+                     "             [ stopped ]\n");
+    }
+
     if (status & SERVER_PRECREATE_INIT)
     {
         gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting precreate pool "
@@ -1839,6 +2076,15 @@ static int server_shutdown(PINT_server_status_flag status,
                      "profiling interface [ stopped ]\n");
     }
 
+    if (status & SERVER_TRACE_INIT)
+    {
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting trace "
+                     "rings                [   ...   ]\n");
+        PINT_trace_finalize();
+        gossip_debug(GOSSIP_SERVER_DEBUG, "[-]         trace "
+                     "rings                [ stopped ]\n");
+    }
+
     if (status & SERVER_REQ_SCHED_INIT)
     {
         gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting request "
@@ -1850,7 +2096,7 @@ static int server_shutdown(PINT_server_status_flag status,
         
     if (status & SERVER_JOB_CTX_INIT)
     {
-        job_close_context(server_job_context);
+        job_close_context(server_main_job_context);
     }
 
     if (status & SERVER_JOB_INIT)
@@ -1914,6 +2160,9 @@ static int server_shutdown(PINT_server_status_flag status,
                      "interface         [ stopped ]\n");
     }
 
+    /* everything allocating from the slab caches has stopped */
+    PINT_slab_report_leaks();
+
     if (status & SERVER_SECURITY_INIT)
     {
         gossip_debug(GOSSIP_SERVER_DEBUG, "[+] halting security "
@@ -2033,6 +2282,13 @@ static void server_sig_handler(int sig)
                        sig, (int)server_status_flag);
         }
 
+        /* keep the recent history of a crashed server */
+        if ((sig == SIGSEGV || sig == SIGABRT || sig == SIGILL) &&
+            (server_status_flag & SERVER_TRACE_INIT))
+        {
+            PINT_trace_dump(server_config.trace_dump_file);
+        }
+
         /* ignore further invocations of this signal */
         new_action.sa_handler = SIG_IGN;
         sigemptyset(&new_action.sa_mask);
@@ -2043,14 +2299,9 @@ static void server_sig_handler(int sig)
          * server to exit gracefully on the next work cycle
          */
         signal_recvd_flag = sig;
-        /*
-         * iterate through all the machines that we had posted for
-         * unexpected BMI messages and deallocate them.
-         * From now the server will only try and finish operations
-         * that are already in progress, wait for them to timeout
-         * or complete before initiating shutdown
+        /* the main loop purges the unexpected receives; that takes locks
+         * the interrupted thread may be holding
          */
-        server_purge_unexpected_recv_machines();
     }
 }
 
@@ -2265,23 +2516,6 @@ int server_post_unexpected_recv(void)
     struct PINT_smcb *smcb = NULL;
     struct PINT_server_op *s_op;
 
-    /* The job status structure js that is sent into PINT_state_machine_start() below is used until
-     * the job_bmi_unexp() function call is executed in pvfs2_unexpected_sm.unexpected_post.  Once
-     * job_bmi_unexp() puts the unexp job on the job queue, then a job_status_s structure will be
-     * assigned from the global structure, server_job_status_array, when the job system processes it.
-     * (The job system performs this task in a later call to job_testcontext()). It is THIS job_status_s
-     * structure that carries into the next state of pvfs2_unexpected_sm.  Thus, the original js
-     * structure is ONLY used by job_bmi_unexp() to return an error if something within job_bmi_unexp()
-     * fails, like a memory issue.  It is NOT forwarded through the job system. In the case of an error,
-     * ret (below) will be SM_ACTION_TERMINATE upon return from PINT_state_machine_start() and the error_code
-     * is then properly propagated.
-     *
-     * NOTE: If an error occurs when this function is called during server_initialize() time, then the 
-     * server will not start.  If an error occurs during the pvfs2_unexpected_sm.unexpected_map state, the
-     * error is noted but the system continues to run.
-     */
-    job_status_s js={0};
-
     gossip_debug(GOSSIP_SERVER_DEBUG,
             "server_post_unexpected_recv\n");
 
@@ -2303,7 +2537,44 @@ int server_post_unexpected_recv(void)
     s_op->target_fs_id = PVFS_FS_ID_NULL;
 
     /* Add an unexpected s_ops to the list */
+    gen_mutex_lock(&server_sop_list_mutex);
     qlist_add_tail(&s_op->next, &posted_sop_list);
+    gen_mutex_unlock(&server_sop_list_mutex);
+
+    if (server_sm_workers_running())
+    {
+        /* errors posting are reported by the worker */
+        return server_sm_workers_start(smcb, server_start_unexpected_sm);
+    }
+    return server_start_unexpected_sm(smcb);
+}
+
+/* server_start_unexpected_sm()
+ *
+ * runs the first states of an unexpected receive state machine set up by
+ * server_post_unexpected_recv()
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+static int server_start_unexpected_sm(struct PINT_smcb *smcb)
+{
+    int ret;
+    /* The job status structure js that is sent into PINT_state_machine_start() below is used until
+     * the job_bmi_unexp() function call is executed in pvfs2_unexpected_sm.unexpected_post.  Once
+     * job_bmi_unexp() puts the unexp job on the job queue, then a job_status_s structure will be
+     * assigned from the global structure, server_job_status_array, when the job system processes it.
+     * (The job system performs this task in a later call to job_testcontext()). It is THIS job_status_s
+     * structure that carries into the next state of pvfs2_unexpected_sm.  Thus, the original js
+     * structure is ONLY used by job_bmi_unexp() to return an error if something within job_bmi_unexp()
+     * fails, like a memory issue.  It is NOT forwarded through the job system. In the case of an error,
+     * ret (below) will be SM_ACTION_TERMINATE upon return from PINT_state_machine_start() and the error_code
+     * is then properly propagated.
+     *
+     * NOTE: If an error occurs when this function is called during server_initialize() time, then the 
+     * server will not start.  If an error occurs during the pvfs2_unexpected_sm.unexpected_map state, the
+     * error is noted but the system continues to run.
+     */
+    job_status_s js={0};
 
     ret = PINT_state_machine_start(smcb, &js);
     if(ret == SM_ACTION_TERMINATE)
@@ -2325,8 +2596,10 @@ static int server_purge_unexpected_recv_machines(void)
 {
     struct qlist_head *tmp = NULL, *tmp2 = NULL;
 
+    gen_mutex_lock(&server_sop_list_mutex);
     if (qlist_empty(&posted_sop_list))
     {
+        gen_mutex_unlock(&server_sop_list_mutex);
         gossip_err("WARNING: Found empty posted operation list!\n");
         return -PVFS_EINVAL;
     }
@@ -2346,6 +2619,7 @@ static int server_purge_unexpected_recv_machines(void)
         /* cancel the pending job_bmi_unexp operation */
         job_bmi_unexp_cancel(s_op->unexp_id);
     }
+    gen_mutex_unlock(&server_sop_list_mutex);
     return 0;
 }
 
@@ -2410,8 +2684,10 @@ int server_state_machine_start(
         return ret;
     }
     /* Remove s_op from posted_sop_list and move it to the inprogress_sop_list */
+    gen_mutex_lock(&server_sop_list_mutex);
     qlist_del(&s_op->next);
     qlist_add_tail(&s_op->next, &inprogress_sop_list);
+    gen_mutex_unlock(&server_sop_list_mutex);
 
     /* set timestamp on the beginning of this state machine */
     id_gen_fast_register(&tmp_id, s_op);
@@ -2456,6 +2732,9 @@ int server_state_machine_start(
         return -PVFS_ENOSYS;
     }
 
+    /* the request proper starts here, not when the receive was posted */
+    PINT_TRACE_SM(PINT_TRACE_SM_START, smcb, 0);
+
     return PINT_state_machine_invoke(smcb, js_p);
 }
 
@@ -2519,26 +2798,47 @@ int server_state_machine_start_noreq(struct PINT_smcb *smcb)
 {
     struct PINT_server_op *new_op = PINT_sm_frame(smcb, PINT_FRAME_CURRENT);
     int ret = -PVFS_EINVAL;
-    job_status_s tmp_status;
 
     gossip_debug(GOSSIP_SERVER_DEBUG,
             "server_state_machine_start_noreq %p\n",smcb);
 
-    tmp_status.error_code = 0;
-
     if (new_op)
     {
 
         /* add to list of state machines started without a request */
+        gen_mutex_lock(&server_sop_list_mutex);
         qlist_add_tail(&new_op->next, &noreq_sop_list);
+        gen_mutex_unlock(&server_sop_list_mutex);
 
-        /* execute first state */
-        ret = PINT_state_machine_start(smcb, &tmp_status);
-        if (ret < 0)
+        if (server_sm_workers_running())
         {
-            gossip_lerr("Error: failed to start state machine.\n");
-            return ret;
+            return server_sm_workers_start(smcb, server_start_noreq_sm);
         }
+        ret = server_start_noreq_sm(smcb);
+    }
+    return ret;
+}
+
+/* server_start_noreq_sm()
+ *
+ * executes the first state of a state machine handed to
+ * server_state_machine_start_noreq()
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+static int server_start_noreq_sm(struct PINT_smcb *smcb)
+{
+    int ret;
+    job_status_s tmp_status;
+
+    tmp_status.error_code = 0;
+
+    /* execute first state */
+    ret = PINT_state_machine_start(smcb, &tmp_status);
+    if (ret < 0)
+    {
+        gossip_lerr("Error: failed to start state machine.\n");
+        return ret;
     }
     return ret;
 }
@@ -2559,11 +2859,98 @@ int server_state_machine_complete_noreq(PINT_smcb *smcb)
     gossip_debug(GOSSIP_SERVER_DEBUG, "%s: %p\n", __func__, smcb);
     id_gen_fast_register(&tmp_id, s_op);
                 
+    gen_mutex_lock(&server_sop_list_mutex);
     qlist_del(&s_op->next);
+    gen_mutex_unlock(&server_sop_list_mutex);
                 
     return SM_ACTION_TERMINATE;
 }
 
+/* server_get_startup_phase()
+ *
+ * finds how far the storage of fs_id has got since the server started,
+ * or that of the least ready file system if fs_id is PVFS_FS_ID_NULL.
+ * requests that change a file system are refused until it is past
+ * PVFS_SERVER_STARTUP_LEDGER
+ *
+ * returns a PVFS_server_startup_phase
+ */
+int server_get_startup_phase(PVFS_fs_id fs_id)
+{
+    static int all_ready = 0;
+    PINT_llist *cur = server_config.file_systems;
+    struct filesystem_configuration_s *cur_fs;
+    int phase, fs_phase = PVFS_SERVER_STARTUP_READY;
+    int min_phase = PVFS_SERVER_STARTUP_READY;
+
+    /* nothing goes back once every file system has started */
+    if (all_ready)
+    {
+        return PVFS_SERVER_STARTUP_READY;
+    }
+
+    while (cur)
+    {
+        cur_fs = PINT_llist_head(cur);
+        if (!cur_fs)
+        {
+            break;
+        }
+
+        /* a failed ledger rebuild stays in its phase */
+        phase = PVFS_SERVER_STARTUP_LEDGER;
+        trove_collection_getinfo(cur_fs->coll_id, 0,
+                                 PVFS_COLLECTION_STARTUP_PHASE, &phase);
+        if (phase < min_phase)
+        {
+            min_phase = phase;
+        }
+        if (cur_fs->coll_id == fs_id)
+        {
+            fs_phase = phase;
+        }
+        cur = PINT_llist_next(cur);
+    }
+
+    if (min_phase == PVFS_SERVER_STARTUP_READY)
+    {
+        all_ready = 1;
+    }
+    return (fs_id == PVFS_FS_ID_NULL ? min_phase : fs_phase);
+}
+
+/* server_wait_for_storage()
+ *
+ * waits until the storage of fs_id takes changes, for the startup steps
+ * that create objects themselves
+ *
+ * returns 0 on success, -PVFS_error if the handle ledger could not be
+ * rebuilt
+ */
+static int server_wait_for_storage(PVFS_fs_id fs_id)
+{
+    int ret, phase = PVFS_SERVER_STARTUP_LEDGER;
+
+    for (;;)
+    {
+        ret = trove_collection_getinfo(fs_id, 0,
+                                       PVFS_COLLECTION_STARTUP_PHASE, &phase);
+        if (ret < 0)
+        {
+            gossip_err("Error: storage for fs_id %d did not start.\n",
+                       (int) fs_id);
+            return ret;
+        }
+        if (phase > PVFS_SERVER_STARTUP_LEDGER)
+        {
+            return 0;
+        }
+        gossip_debug(GOSSIP_SERVER_DEBUG, "waiting for the handle ledger "
+                     "of fs_id %d\n", (int) fs_id);
+        sleep(1);
+    }
+}
+
 /* server_state_machine_complete()
  *
  * function to be called at the completion of state machine execution;
@@ -2621,12 +3008,28 @@ int server_state_machine_complete(PINT_smcb *smcb)
     s_op->unexp_bmi_buff.buffer = NULL;
 
 
+    /* a write that got past its size notice is done with the datafile */
+    if (s_op->size_notify.started)
+    {
+        PINT_size_write_end(s_op->size_notify.fs_id,
+                            s_op->size_notify.handle);
+        s_op->size_notify.started = 0;
+    }
+    PINT_server_lease_break_free(s_op);
+
    /* Remove s_op from the inprogress_sop_list */
+    gen_mutex_lock(&server_sop_list_mutex);
     qlist_del(&s_op->next);
+    gen_mutex_unlock(&server_sop_list_mutex);
 
     return SM_ACTION_TERMINATE;
 }
 
+job_context_id server_current_job_context(void)
+{
+    return server_sm_workers_context(server_main_job_context);
+}
+
 int server_state_machine_terminate(
         struct PINT_smcb *smcb, job_status_s *js_p)
 {
@@ -3085,6 +3488,14 @@ static int precreate_pool_setup_server(const char* host, PVFS_ds_type type,
         gossip_debug(GOSSIP_SERVER_DEBUG, "precreate_pool didn't find handle "
                      "for %s, type %s; creating now.\n", host, type_string);
 
+        /* creating the pool object needs the handle ledger */
+        ret = server_wait_for_storage(fsid);
+        if(ret < 0)
+        {
+            free(key.buffer);
+            return(ret);
+        }
+
         /* find extent array for ourselves */
         ret = PINT_cached_config_get_server(
             fsid, server_config.host_id, PINT_SERVER_TYPE_META, &ext_array);
@@ -38,7 +38,11 @@
 #include "pint-perf-counter.h"
 #include "server-config-mgr.h"
 
-extern job_context_id server_job_context;
+/* job context that state machines running in the calling thread post
+ * their jobs to; each state machine worker has its own
+ */
+job_context_id server_current_job_context(void);
+#define server_job_context server_current_job_context()
 
 #define PVFS2_SERVER_DEFAULT_TIMEOUT_MS      1000
 #define BMI_UNEXPECTED_OP                    999
@@ -159,7 +163,11 @@ typedef enum
     SERVER_SECURITY_INIT       = (1 << 20),
     SERVER_CAPCACHE_INIT       = (1 << 21),
     SERVER_CREDCACHE_INIT      = (1 << 22),
-    SERVER_CERTCACHE_INIT      = (1 << 23)
+    SERVER_CERTCACHE_INIT      = (1 << 23),
+    SERVER_TRACE_INIT          = (1 << 24),
+    SERVER_SM_WORKERS_INIT     = (1 << 25),
+    SERVER_LEASE_INIT          = (1 << 26),
+    SERVER_SIZE_CACHE_INIT     = (1 << 27)
 } PINT_server_status_flag;
 
 typedef enum
@@ -217,6 +225,12 @@ struct PINT_server_mirror_op
 
    /*info about each job*/
    write_job_t *jobs;
+
+   /*number of bytes copied from the source, starting at the request offset*/
+   PVFS_size copy_size;
+
+   /*hints sent with the write requests*/
+   PVFS_hint hints;
 };
 typedef struct PINT_server_mirror_op PINT_server_mirror_op;
 
@@ -300,6 +314,10 @@ struct PINT_server_create_copies_op
     /*source metadata handle*/                     
     PVFS_handle metadata_handle; 
 
+    /*server-to-server capability on the metadata handle, for the writes */
+    /*to the destination datahandles                                      */
+    PVFS_capability dst_capability;
+
     /*source file system*/
     PVFS_fs_id fs_id; 
 
@@ -533,6 +551,47 @@ struct PINT_server_truncate_op
     PVFS_offset size;        /* new size of datafile */
 };
 
+struct PINT_server_seek_op
+{
+    PVFS_offset offset;      /* in: where to start, out: what was found */
+};
+
+/* state of the lease breaks sent before a change is reported */
+struct PINT_server_lease_break_op
+{
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+    struct PINT_lease_holder *holders;  /* clients to tell */
+    int count;
+    int *acked;                 /* set as each of them answers */
+    PVFS_time expires;          /* when the last lease to wait for ends */
+};
+
+/* state of the size notice sent before a datafile changes */
+struct PINT_server_size_notify_op
+{
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;         /* datafile being changed */
+    PVFS_handle meta;           /* metafile whose size must be forgotten */
+    int started;                /* PINT_size_write_end() still owed */
+    PVFS_BMI_addr_t *addrs;     /* metadata servers yet to forget sizes */
+    int *forgot;                /* set as each of them answers */
+    int addr_count;
+    PVFS_time deadline;         /* when sizes they cached have run out */
+};
+
+struct PINT_server_size_refresh_op
+{
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;         /* metafile whose size is fetched */
+    PINT_dist *dist;
+    uint32_t dfile_count;
+    PVFS_handle *dfile_array;
+    PVFS_size *size_array;
+    uint64_t ticket;            /* from PINT_size_cache_refresh_begin() */
+    PVFS_time expires;
+};
+
 struct PINT_server_mkdir_op
 {
     PVFS_fs_id fs_id;
@@ -585,6 +644,12 @@ struct PINT_server_eattr_op
     void *buffer;
 };
 
+struct PINT_server_geteattr_bulk_op
+{
+    char *buffer;   /* backs every value of the response */
+    int index;      /* handle being read */
+};
+
 struct PINT_server_unstuff_op
 {
     PVFS_handle* dfile_array;
@@ -698,6 +763,11 @@ typedef struct PINT_server_op
 
     int num_pjmp_frames;
 
+    /* kept outside the union: writes use it alongside their own state */
+    struct PINT_server_size_notify_op size_notify;
+    /* likewise for the requests that modify or remove an object */
+    struct PINT_server_lease_break_op lease_break;
+
     union
     {
         /* request-specific scratch spaces for use during processing */
@@ -705,6 +775,7 @@ typedef struct PINT_server_op
         struct PINT_server_eattr_op eattr;
         struct PINT_server_getattr_op getattr;
         struct PINT_server_listattr_op listattr;
+        struct PINT_server_geteattr_bulk_op geteattr_bulk;
         struct PINT_server_getconfig_op getconfig;
         struct PINT_server_lookup_op lookup;
         struct PINT_server_crdirent_op crdirent;
@@ -717,6 +788,8 @@ typedef struct PINT_server_op
         struct PINT_server_small_io_op small_io;
         struct PINT_server_flush_op flush;
         struct PINT_server_truncate_op truncate;
+        struct PINT_server_seek_op seek;
+        struct PINT_server_size_refresh_op size_refresh;
         struct PINT_server_mkdir_op mkdir;
         struct PINT_server_mgmt_remove_dirent_op mgmt_remove_dirent;
         struct PINT_server_mgmt_get_dirdata_op mgmt_get_dirdata_handle;
@@ -922,6 +995,8 @@ extern struct PINT_state_machine_s pvfs2_tree_get_file_size_work_sm;
 extern struct PINT_state_machine_s pvfs2_tree_getattr_work_sm;
 extern struct PINT_state_machine_s pvfs2_tree_setattr_work_sm;
 extern struct PINT_state_machine_s pvfs2_call_msgpairarray_sm;
+extern struct PINT_state_machine_s pvfs2_size_notify_work_sm;
+extern struct PINT_state_machine_s pvfs2_lease_break_work_sm;
 
 extern void tree_getattr_free(PINT_server_op *s_op);
 extern void tree_setattr_free(PINT_server_op *s_op);
@@ -933,6 +1008,19 @@ extern void getattr_free(struct PINT_server_op *s_op);
 int server_perf_start_rollover(struct PINT_perf_counter *pc,
                                struct PINT_perf_counter *tpc);
 
+/* lease prototypes */
+void PINT_server_recall_leases(struct PINT_server_op *s_op,
+                               PVFS_fs_id fs_id,
+                               PVFS_handle handle);
+void PINT_server_lease_break_free(struct PINT_server_op *s_op);
+
+/* size cache prototypes */
+int PINT_server_size_restart_notice(PVFS_fs_id fs_id);
+void PINT_server_refresh_size(PVFS_fs_id fs_id,
+                              PVFS_handle handle,
+                              PVFS_object_attr *attr,
+                              uint32_t cache_msecs);
+
 /* keyval management prototypes */
 void free_keyval_buffers(struct PINT_server_op *s_op);
 void keep_keyval_buffers(struct PINT_server_op *s_op, int buf);
@@ -947,9 +1035,10 @@ int server_state_machine_start( PINT_smcb *smcb, job_status_s *js_p);
 int server_state_machine_complete(PINT_smcb *smcb);
 int server_state_machine_terminate(PINT_smcb *smcb, job_status_s *js_p);
 
-/* lists of server ops */
+/* lists of server ops; hold server_sop_list_mutex while changing them */
 extern struct qlist_head posted_sop_list;
 extern struct qlist_head inprogress_sop_list;
+extern gen_mutex_t server_sop_list_mutex;
 
 /* starts state machines not associated with an incoming request */
 int server_state_machine_alloc_noreq(
@@ -958,6 +1047,10 @@ int server_state_machine_start_noreq(
     struct PINT_smcb *new_op);
 int server_state_machine_complete_noreq(PINT_smcb *smcb);
 
+/* startup phase of the storage for fs_id, or of the least ready file
+ * system when fs_id is PVFS_FS_ID_NULL */
+int server_get_startup_phase(PVFS_fs_id fs_id);
+
 /* INCLUDE STATE-MACHINE.H DOWN HERE */
 #if 0
 #define PINT_OP_STATE       PINT_server_op
@@ -159,8 +159,9 @@ int PINT_timer_queue_finalize(void)
    {
        element = qlist_entry(iterator,struct req_sched_element,list_link);
        qlist_del(&(element->list_link));
-       if (element && element->user_ptr)
-          free(element->user_ptr);
+       /* user_ptr is the job descriptor of the timer; it belongs to the
+        * job layer and does not come from malloc
+        */
        if (element)
           free(element);
        element=NULL;
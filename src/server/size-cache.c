@@ -0,0 +1,619 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "pvfs2-debug.h"
+#include "gen-locks.h"
+#include "quickhash.h"
+#include "quicklist.h"
+#include "pint-util.h"
+#include "size-cache.h"
+
+#define SIZE_TABLE_SIZE 1021
+/* how often the timer drops sizes and arms that ran out */
+#define SIZE_SWEEP_MSECS 10000
+/* a size that just changed is not fetched again for this long, so a file
+ * being written does not have its datafiles armed over and over */
+#define SIZE_REFRESH_BACKOFF_MSECS 1000
+
+struct size_key
+{
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+};
+
+/* the size of a metafile, on its server */
+struct size_entry
+{
+    struct qhash_head hash_link;
+    struct qlist_head list_link;
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+    PVFS_size size;
+    int valid;
+    int refreshing;
+    uint64_t changed;            /* size_clock when last forgotten */
+    PVFS_time changed_at;        /* ms, from PINT_util_get_time_ms() */
+    PVFS_time expires;
+};
+
+/* a datafile, on its server */
+struct size_arm
+{
+    struct qhash_head hash_link;
+    struct qlist_head list_link;
+    PVFS_fs_id fs_id;
+    PVFS_handle handle;
+    PVFS_handle meta;            /* metafile to tell */
+    PVFS_time expires;
+    int armed;
+    int inflight;                /* writes and truncates under way */
+    int notifying;               /* of which still telling meta */
+};
+
+static struct qhash_table *size_table = NULL;
+static struct qhash_table *arm_table = NULL;
+static QLIST_HEAD(size_list);
+static QLIST_HEAD(arm_list);
+static int size_entry_count = 0;
+static int arm_count = 0;
+static int refresh_count = 0;
+static int restart_notices = 0;
+/* ordered count of the times sizes were forgotten */
+static uint64_t size_clock = 0;
+static PVFS_time size_last_sweep = 0;
+static gen_mutex_t size_mutex = GEN_MUTEX_INITIALIZER;
+
+static int size_compare(const void *key, struct qhash_head *link)
+{
+    const struct size_key *k = key;
+    struct size_entry *e = qhash_entry(link, struct size_entry, hash_link);
+
+    return (e->handle == k->handle && e->fs_id == k->fs_id);
+}
+
+static int arm_compare(const void *key, struct qhash_head *link)
+{
+    const struct size_key *k = key;
+    struct size_arm *a = qhash_entry(link, struct size_arm, hash_link);
+
+    return (a->handle == k->handle && a->fs_id == k->fs_id);
+}
+
+static int size_hash(const void *key, int table_size)
+{
+    const struct size_key *k = key;
+
+    return (int)((k->handle ^ ((uint64_t)k->fs_id << 32)) %
+                 (uint64_t)table_size);
+}
+
+static struct size_entry *size_entry_find(PVFS_fs_id fs_id,
+                                          PVFS_handle handle)
+{
+    struct size_key key;
+    struct qhash_head *link;
+
+    key.fs_id = fs_id;
+    key.handle = handle;
+    link = qhash_search(size_table, &key);
+    return link ? qhash_entry(link, struct size_entry, hash_link) : NULL;
+}
+
+static struct size_arm *size_arm_find(PVFS_fs_id fs_id, PVFS_handle handle)
+{
+    struct size_key key;
+    struct qhash_head *link;
+
+    key.fs_id = fs_id;
+    key.handle = handle;
+    link = qhash_search(arm_table, &key);
+    return link ? qhash_entry(link, struct size_arm, hash_link) : NULL;
+}
+
+static void size_entry_free(struct size_entry *e)
+{
+    qhash_del(&e->hash_link);
+    qlist_del(&e->list_link);
+    size_entry_count--;
+    free(e);
+}
+
+/* frees a if nothing needs it any more */
+static void size_arm_put(struct size_arm *a)
+{
+    if (!a->armed && !a->inflight && !a->notifying)
+    {
+        qhash_del(&a->hash_link);
+        qlist_del(&a->list_link);
+        arm_count--;
+        free(a);
+    }
+}
+
+/* PINT_size_cache_initialize()
+ *
+ * sets up the size and arm tables
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int PINT_size_cache_initialize(void)
+{
+    size_table = qhash_init(size_compare, size_hash, SIZE_TABLE_SIZE);
+    arm_table = qhash_init(arm_compare, size_hash, SIZE_TABLE_SIZE);
+    if (!size_table || !arm_table)
+    {
+        if (size_table)
+        {
+            qhash_finalize(size_table);
+            size_table = NULL;
+        }
+        if (arm_table)
+        {
+            qhash_finalize(arm_table);
+            arm_table = NULL;
+        }
+        return -PVFS_ENOMEM;
+    }
+    size_entry_count = 0;
+    arm_count = 0;
+    refresh_count = 0;
+    size_last_sweep = PINT_util_get_time_ms();
+    return 0;
+}
+
+/* PINT_size_cache_finalize()
+ *
+ * forgets all sizes and arms
+ */
+void PINT_size_cache_finalize(void)
+{
+    struct size_entry *e, *etmp;
+    struct size_arm *a, *atmp;
+
+    gen_mutex_lock(&size_mutex);
+    if (size_table)
+    {
+        qlist_for_each_entry_safe(e, etmp, &size_list, list_link)
+        {
+            size_entry_free(e);
+        }
+        qhash_finalize(size_table);
+        size_table = NULL;
+    }
+    if (arm_table)
+    {
+        qlist_for_each_entry_safe(a, atmp, &arm_list, list_link)
+        {
+            a->armed = a->inflight = a->notifying = 0;
+            size_arm_put(a);
+        }
+        qhash_finalize(arm_table);
+        arm_table = NULL;
+    }
+    gen_mutex_unlock(&size_mutex);
+}
+
+/* PINT_size_cache_lookup()
+ *
+ * finds the cached size of a metafile
+ *
+ * returns 0 and the size if one is cached, -PVFS_ENOENT otherwise
+ */
+int PINT_size_cache_lookup(PVFS_fs_id fs_id,
+                           PVFS_handle handle,
+                           PVFS_size *size)
+{
+    struct size_entry *e;
+    int ret = -PVFS_ENOENT;
+
+    gen_mutex_lock(&size_mutex);
+    if (size_table && (e = size_entry_find(fs_id, handle)) &&
+        e->valid && e->expires > PINT_util_get_time_ms())
+    {
+        *size = e->size;
+        ret = 0;
+    }
+    gen_mutex_unlock(&size_mutex);
+    return ret;
+}
+
+/* PINT_size_cache_refresh_begin()
+ *
+ * claims the fetch of the size of a metafile.  The ticket is handed back
+ * to PINT_size_cache_refresh_end() to tell whether the size was
+ * forgotten while it was being fetched.
+ *
+ * returns 0 if the caller should fetch the size, -PVFS_error if not:
+ * -PVFS_EALREADY if another fetch is under way, -PVFS_EAGAIN if the size
+ * changed too recently or too many fetches are under way
+ */
+int PINT_size_cache_refresh_begin(PVFS_fs_id fs_id,
+                                  PVFS_handle handle,
+                                  uint64_t *ticket)
+{
+    struct size_key key;
+    struct size_entry *e;
+    PVFS_time now = PINT_util_get_time_ms();
+
+    gen_mutex_lock(&size_mutex);
+
+    if (!size_table)
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EINVAL;
+    }
+
+    e = size_entry_find(fs_id, handle);
+    if (e && (e->refreshing || (e->valid && e->expires > now)))
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EALREADY;
+    }
+    if ((e && now - e->changed_at < SIZE_REFRESH_BACKOFF_MSECS) ||
+        refresh_count >= PINT_SIZE_CACHE_MAX_REFRESHES)
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EAGAIN;
+    }
+
+    if (!e)
+    {
+        if (size_entry_count >= PINT_SIZE_CACHE_MAX_ENTRIES)
+        {
+            gen_mutex_unlock(&size_mutex);
+            return -PVFS_ENOSPC;
+        }
+        e = calloc(1, sizeof(*e));
+        if (!e)
+        {
+            gen_mutex_unlock(&size_mutex);
+            return -PVFS_ENOMEM;
+        }
+        e->fs_id = fs_id;
+        e->handle = handle;
+        key.fs_id = fs_id;
+        key.handle = handle;
+        qhash_add(size_table, &key, &e->hash_link);
+        qlist_add_tail(&e->list_link, &size_list);
+        size_entry_count++;
+    }
+
+    e->valid = 0;
+    e->refreshing = 1;
+    refresh_count++;
+    *ticket = size_clock;
+
+    gen_mutex_unlock(&size_mutex);
+    return 0;
+}
+
+/* PINT_size_cache_refresh_end()
+ *
+ * ends a fetch claimed by PINT_size_cache_refresh_begin().  The size is
+ * kept until expires unless the fetch failed or the size was forgotten
+ * after the fetch began.
+ */
+void PINT_size_cache_refresh_end(PVFS_fs_id fs_id,
+                                 PVFS_handle handle,
+                                 uint64_t ticket,
+                                 PVFS_error error,
+                                 PVFS_size size,
+                                 PVFS_time expires)
+{
+    struct size_entry *e;
+
+    gen_mutex_lock(&size_mutex);
+    if (size_table && (e = size_entry_find(fs_id, handle)) && e->refreshing)
+    {
+        e->refreshing = 0;
+        refresh_count--;
+        if (error == 0 && e->changed <= ticket)
+        {
+            e->size = size;
+            e->valid = 1;
+            e->expires = expires;
+        }
+        else
+        {
+            e->changed_at = PINT_util_get_time_ms();
+        }
+        gossip_debug(GOSSIP_SERVER_DEBUG, "%s: %llu,%d: %s size %lld\n",
+                     __func__, llu(handle), fs_id,
+                     e->valid ? "cached" : "dropped", lld(size));
+    }
+    gen_mutex_unlock(&size_mutex);
+}
+
+/* PINT_size_cache_invalidate()
+ *
+ * forgets the size of a metafile, or of every metafile of fs_id if
+ * handle is PVFS_HANDLE_NULL, including sizes still being fetched
+ */
+void PINT_size_cache_invalidate(PVFS_fs_id fs_id,
+                                PVFS_handle handle)
+{
+    struct size_entry *e;
+    PVFS_time now = PINT_util_get_time_ms();
+
+    gen_mutex_lock(&size_mutex);
+    if (size_table)
+    {
+        size_clock++;
+        if (handle == PVFS_HANDLE_NULL)
+        {
+            qlist_for_each_entry(e, &size_list, list_link)
+            {
+                if (e->fs_id == fs_id)
+                {
+                    e->valid = 0;
+                    e->changed = size_clock;
+                    e->changed_at = now;
+                }
+            }
+        }
+        else if ((e = size_entry_find(fs_id, handle)))
+        {
+            e->valid = 0;
+            e->changed = size_clock;
+            e->changed_at = now;
+        }
+    }
+    gen_mutex_unlock(&size_mutex);
+
+    gossip_debug(GOSSIP_SERVER_DEBUG, "%s: %llu,%d\n",
+                 __func__, llu(handle), fs_id);
+}
+
+/* PINT_size_arm()
+ *
+ * has the next write or truncate of dfile within arm_msecs tell the
+ * server of meta first
+ *
+ * returns 0 on success, -PVFS_EAGAIN if dfile is being written now,
+ * other -PVFS_error on failure
+ */
+int PINT_size_arm(PVFS_fs_id fs_id,
+                  PVFS_handle dfile,
+                  PVFS_handle meta,
+                  uint32_t arm_msecs)
+{
+    struct size_key key;
+    struct size_arm *a;
+
+    if (arm_msecs == 0)
+    {
+        return -PVFS_EOPNOTSUPP;
+    }
+
+    gen_mutex_lock(&size_mutex);
+
+    if (!arm_table)
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EINVAL;
+    }
+
+    a = size_arm_find(fs_id, dfile);
+    if (a && a->inflight)
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EAGAIN;
+    }
+    if (!a)
+    {
+        if (arm_count >= PINT_SIZE_CACHE_MAX_ENTRIES)
+        {
+            gen_mutex_unlock(&size_mutex);
+            return -PVFS_ENOSPC;
+        }
+        a = calloc(1, sizeof(*a));
+        if (!a)
+        {
+            gen_mutex_unlock(&size_mutex);
+            return -PVFS_ENOMEM;
+        }
+        a->fs_id = fs_id;
+        a->handle = dfile;
+        key.fs_id = fs_id;
+        key.handle = dfile;
+        qhash_add(arm_table, &key, &a->hash_link);
+        qlist_add_tail(&a->list_link, &arm_list);
+        arm_count++;
+    }
+
+    a->meta = meta;
+    a->armed = 1;
+    a->expires = PINT_util_get_time_ms() + arm_msecs;
+
+    gen_mutex_unlock(&size_mutex);
+    return 0;
+}
+
+/* PINT_size_write_begin()
+ *
+ * records that dfile is about to be written or truncated.  Each call
+ * is matched by PINT_size_write_end() once the change is made.
+ *
+ * returns 1 and the metafile in *meta if the caller must tell its server
+ * first and then call PINT_size_notify_end(), 0 if not, -PVFS_error on
+ * failure
+ */
+int PINT_size_write_begin(PVFS_fs_id fs_id,
+                          PVFS_handle dfile,
+                          PVFS_handle *meta)
+{
+    struct size_key key;
+    struct size_arm *a;
+    int ret = 0;
+
+    gen_mutex_lock(&size_mutex);
+
+    if (!arm_table)
+    {
+        gen_mutex_unlock(&size_mutex);
+        return -PVFS_EINVAL;
+    }
+
+    a = size_arm_find(fs_id, dfile);
+    if (!a)
+    {
+        a = calloc(1, sizeof(*a));
+        if (!a)
+        {
+            gen_mutex_unlock(&size_mutex);
+            return -PVFS_ENOMEM;
+        }
+        a->fs_id = fs_id;
+        a->handle = dfile;
+        key.fs_id = fs_id;
+        key.handle = dfile;
+        qhash_add(arm_table, &key, &a->hash_link);
+        qlist_add_tail(&a->list_link, &arm_list);
+        arm_count++;
+    }
+
+    a->inflight++;
+    if (a->armed && a->expires <= PINT_util_get_time_ms())
+    {
+        a->armed = 0;
+    }
+    /* a write that overtakes a notice still under way waits for one too */
+    if (a->armed || a->notifying)
+    {
+        a->armed = 0;
+        a->notifying++;
+        *meta = a->meta;
+        ret = 1;
+    }
+
+    gen_mutex_unlock(&size_mutex);
+    return ret;
+}
+
+/* PINT_size_notify_end()
+ *
+ * records that a notice asked for by PINT_size_write_begin() was
+ * answered; if it failed, dfile stays armed so the next write tries again
+ */
+void PINT_size_notify_end(PVFS_fs_id fs_id,
+                          PVFS_handle dfile,
+                          PVFS_error error)
+{
+    struct size_arm *a;
+
+    gen_mutex_lock(&size_mutex);
+    if (arm_table && (a = size_arm_find(fs_id, dfile)) && a->notifying)
+    {
+        a->notifying--;
+        if (error && a->expires > PINT_util_get_time_ms())
+        {
+            a->armed = 1;
+        }
+    }
+    gen_mutex_unlock(&size_mutex);
+}
+
+/* PINT_size_write_end()
+ *
+ * records that a write or truncate of dfile is over
+ */
+void PINT_size_write_end(PVFS_fs_id fs_id,
+                         PVFS_handle dfile)
+{
+    struct size_arm *a;
+
+    gen_mutex_lock(&size_mutex);
+    if (arm_table && (a = size_arm_find(fs_id, dfile)) && a->inflight)
+    {
+        a->inflight--;
+        size_arm_put(a);
+    }
+    gen_mutex_unlock(&size_mutex);
+}
+
+/* PINT_size_restart_notice_begin()
+ *
+ * holds back writes until the metadata servers have been told that the
+ * arms of this server were lost; matched by
+ * PINT_size_restart_notice_end()
+ */
+void PINT_size_restart_notice_begin(void)
+{
+    gen_mutex_lock(&size_mutex);
+    restart_notices++;
+    gen_mutex_unlock(&size_mutex);
+}
+
+void PINT_size_restart_notice_end(void)
+{
+    gen_mutex_lock(&size_mutex);
+    restart_notices--;
+    gen_mutex_unlock(&size_mutex);
+}
+
+/* PINT_size_restart_notice_pending()
+ *
+ * returns nonzero while writes must wait for a restart notice
+ */
+int PINT_size_restart_notice_pending(void)
+{
+    int ret;
+
+    gen_mutex_lock(&size_mutex);
+    ret = restart_notices;
+    gen_mutex_unlock(&size_mutex);
+    return ret;
+}
+
+/* PINT_size_cache_expire()
+ *
+ * drops sizes and arms that ran out; meant to be called regularly, it
+ * only walks the tables every SIZE_SWEEP_MSECS
+ */
+void PINT_size_cache_expire(void)
+{
+    struct size_entry *e, *etmp;
+    struct size_arm *a, *atmp;
+    PVFS_time now = PINT_util_get_time_ms();
+
+    gen_mutex_lock(&size_mutex);
+    if (size_table && arm_table && now - size_last_sweep >= SIZE_SWEEP_MSECS)
+    {
+        size_last_sweep = now;
+        qlist_for_each_entry_safe(e, etmp, &size_list, list_link)
+        {
+            if (!e->refreshing &&
+                (e->valid ? e->expires <= now :
+                 now - e->changed_at >= SIZE_REFRESH_BACKOFF_MSECS))
+            {
+                size_entry_free(e);
+            }
+        }
+        qlist_for_each_entry_safe(a, atmp, &arm_list, list_link)
+        {
+            if (a->armed && a->expires <= now)
+            {
+                a->armed = 0;
+                size_arm_put(a);
+            }
+        }
+    }
+    gen_mutex_unlock(&size_mutex);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
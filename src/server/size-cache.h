@@ -0,0 +1,82 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Cached file sizes.  The server of a metafile remembers the logical
+ * size of the file once it has asked the servers of its datafiles for
+ * it, and those servers remember that it did (the datafile is "armed").
+ * Before an armed datafile is next written or truncated, its server
+ * tells the metadata server to forget the size, and waits for the answer.
+ * A cached size can therefore be handed out until it times out without
+ * ever being older than the data.  Arms live a little longer than the
+ * sizes they protect, and a server that restarts, losing its arms, tells
+ * every metadata server to forget all sizes before it writes anything.
+ */
+
+#ifndef __SIZE_CACHE_H
+#define __SIZE_CACHE_H
+
+#include "pvfs2-types.h"
+
+/* most files whose size is cached, or datafiles armed */
+#define PINT_SIZE_CACHE_MAX_ENTRIES 65536
+/* most sizes being fetched at once */
+#define PINT_SIZE_CACHE_MAX_REFRESHES 64
+
+int PINT_size_cache_initialize(void);
+void PINT_size_cache_finalize(void);
+
+/* metadata server side */
+int PINT_size_cache_lookup(PVFS_fs_id fs_id,
+                           PVFS_handle handle,
+                           PVFS_size *size);
+
+int PINT_size_cache_refresh_begin(PVFS_fs_id fs_id,
+                                  PVFS_handle handle,
+                                  uint64_t *ticket);
+
+void PINT_size_cache_refresh_end(PVFS_fs_id fs_id,
+                                 PVFS_handle handle,
+                                 uint64_t ticket,
+                                 PVFS_error error,
+                                 PVFS_size size,
+                                 PVFS_time expires);
+
+void PINT_size_cache_invalidate(PVFS_fs_id fs_id,
+                                PVFS_handle handle);
+
+/* I/O server side */
+int PINT_size_arm(PVFS_fs_id fs_id,
+                  PVFS_handle dfile,
+                  PVFS_handle meta,
+                  uint32_t arm_msecs);
+
+int PINT_size_write_begin(PVFS_fs_id fs_id,
+                          PVFS_handle dfile,
+                          PVFS_handle *meta);
+
+void PINT_size_notify_end(PVFS_fs_id fs_id,
+                          PVFS_handle dfile,
+                          PVFS_error error);
+
+void PINT_size_write_end(PVFS_fs_id fs_id,
+                         PVFS_handle dfile);
+
+void PINT_size_restart_notice_begin(void);
+void PINT_size_restart_notice_end(void);
+int PINT_size_restart_notice_pending(void);
+
+void PINT_size_cache_expire(void);
+
+#endif /* __SIZE_CACHE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,430 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "pvfs2-internal.h"
+#include "gossip.h"
+#include "gen-locks.h"
+#include "pvfs2-server.h"
+#include "sm-workers.h"
+
+/* how many completions a worker takes from its context at once */
+#define SM_WORKER_TEST_COUNT 64
+#define SM_WORKER_QUEUE_INITIAL 16
+
+/* a state machine waiting for a worker to run its first states */
+struct sm_start_item
+{
+    struct PINT_smcb *smcb;
+    int (*start_fn)(struct PINT_smcb *);
+};
+
+struct sm_worker
+{
+    pthread_t thread;
+    job_context_id context;
+    gen_mutex_t mutex;
+    /* ring of state machines to start; grown when full */
+    struct sm_start_item *items;
+    int head;
+    int count;
+    int size;
+    /* a null job is already on its way to wake the worker up */
+    int wake_pending;
+    job_id_t job_id_array[SM_WORKER_TEST_COUNT];
+    void *user_ptr_array[SM_WORKER_TEST_COUNT];
+    job_status_s status_array[SM_WORKER_TEST_COUNT];
+};
+
+static struct sm_worker *workers = NULL;
+static int worker_count = 0;
+static int workers_stopping = 0;
+static pthread_key_t worker_key;
+
+static gen_mutex_t start_mutex = GEN_MUTEX_INITIALIZER;
+static int next_worker = 0;
+
+/* workers count themselves active while running state actions so that
+ * the main loop can wait for them to go idle (e.g. to reload the config)
+ */
+static gen_mutex_t pause_mutex = GEN_MUTEX_INITIALIZER;
+static gen_cond_t pause_cond = GEN_COND_INITIALIZER;
+static int workers_paused = 0;
+static int workers_active = 0;
+
+static void *sm_worker_fn(void *arg);
+static void sm_worker_wake(struct sm_worker *w);
+static void sm_worker_enter(void);
+static void sm_worker_leave(void);
+
+/* server_sm_workers_initialize()
+ *
+ * opens a job context for each of count workers and starts them; with a
+ * count of 0 nothing is started and state machines keep running in the
+ * main loop
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int server_sm_workers_initialize(int count)
+{
+    int i, ret;
+
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    workers = (struct sm_worker *)calloc(count, sizeof(struct sm_worker));
+    if (!workers)
+    {
+        return -PVFS_ENOMEM;
+    }
+    ret = pthread_key_create(&worker_key, NULL);
+    if (ret != 0)
+    {
+        free(workers);
+        workers = NULL;
+        return -PVFS_ENOMEM;
+    }
+
+    workers_stopping = 0;
+    for (i = 0; i < count; i++)
+    {
+        struct sm_worker *w = &workers[i];
+
+        gen_mutex_init(&w->mutex);
+        w->items = (struct sm_start_item *)malloc(
+            SM_WORKER_QUEUE_INITIAL * sizeof(struct sm_start_item));
+        if (!w->items)
+        {
+            gen_mutex_destroy(&w->mutex);
+            ret = -PVFS_ENOMEM;
+            break;
+        }
+        w->size = SM_WORKER_QUEUE_INITIAL;
+
+        ret = job_open_context(&w->context);
+        if (ret < 0)
+        {
+            gossip_err("Error: failed to open job context for state "
+                       "machine worker %d\n", i);
+            gen_mutex_destroy(&w->mutex);
+            free(w->items);
+            break;
+        }
+
+        ret = pthread_create(&w->thread, NULL, sm_worker_fn, w);
+        if (ret != 0)
+        {
+            gossip_err("Error: failed to start state machine worker %d\n",
+                       i);
+            job_close_context(w->context);
+            gen_mutex_destroy(&w->mutex);
+            free(w->items);
+            ret = -PVFS_ENOMEM;
+            break;
+        }
+        worker_count = i + 1;
+    }
+
+    if (ret < 0)
+    {
+        server_sm_workers_finalize();
+        return ret;
+    }
+
+    gossip_debug(GOSSIP_SERVER_DEBUG, "Started %d state machine workers\n",
+                 worker_count);
+    return 0;
+}
+
+/* server_sm_workers_finalize()
+ *
+ * stops the workers and closes their job contexts.  State machines that
+ * are still in progress are dropped, just like the ones in the main loop.
+ */
+void server_sm_workers_finalize(void)
+{
+    int i, count = worker_count;
+
+    if (!workers)
+    {
+        return;
+    }
+
+    gen_mutex_lock(&pause_mutex);
+    workers_stopping = 1;
+    workers_paused = 0;
+    gen_cond_broadcast(&pause_cond);
+    gen_mutex_unlock(&pause_mutex);
+
+    for (i = 0; i < count; i++)
+    {
+        sm_worker_wake(&workers[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    /* the main thread may ask for its job context from here on */
+    worker_count = 0;
+    for (i = 0; i < count; i++)
+    {
+        job_close_context(workers[i].context);
+        gen_mutex_destroy(&workers[i].mutex);
+        free(workers[i].items);
+    }
+    free(workers);
+    workers = NULL;
+    pthread_key_delete(worker_key);
+}
+
+/* server_sm_workers_running()
+ *
+ * returns the number of workers, 0 if state machines run in the main loop
+ */
+int server_sm_workers_running(void)
+{
+    return worker_count;
+}
+
+/* server_sm_workers_context()
+ *
+ * returns the job context state machines running in the calling thread
+ * must post their jobs to: the worker's own context, or main_context
+ * outside of the workers
+ */
+job_context_id server_sm_workers_context(job_context_id main_context)
+{
+    struct sm_worker *w;
+
+    if (!worker_count)
+    {
+        return main_context;
+    }
+    w = (struct sm_worker *)pthread_getspecific(worker_key);
+    return w ? w->context : main_context;
+}
+
+/* server_sm_workers_start()
+ *
+ * hands a new state machine to the next worker, which points the smcb at
+ * its job context and runs start_fn(smcb)
+ *
+ * returns 0 on success, -PVFS_error on failure
+ */
+int server_sm_workers_start(struct PINT_smcb *smcb,
+                            int (*start_fn)(struct PINT_smcb *))
+{
+    struct sm_worker *w;
+    struct sm_start_item *item;
+    int wake;
+
+    gen_mutex_lock(&start_mutex);
+    w = &workers[next_worker];
+    next_worker = (next_worker + 1) % worker_count;
+    gen_mutex_unlock(&start_mutex);
+
+    gen_mutex_lock(&w->mutex);
+    if (w->count == w->size)
+    {
+        struct sm_start_item *tmp;
+        int tail = w->size - w->head;
+
+        tmp = (struct sm_start_item *)malloc(
+            2 * w->size * sizeof(struct sm_start_item));
+        if (!tmp)
+        {
+            gen_mutex_unlock(&w->mutex);
+            return -PVFS_ENOMEM;
+        }
+        /* unwrap the ring into the new array */
+        memcpy(tmp, &w->items[w->head], tail * sizeof(struct sm_start_item));
+        memcpy(&tmp[tail], w->items, w->head * sizeof(struct sm_start_item));
+        free(w->items);
+        w->items = tmp;
+        w->head = 0;
+        w->size *= 2;
+    }
+    item = &w->items[(w->head + w->count) % w->size];
+    item->smcb = smcb;
+    item->start_fn = start_fn;
+    w->count++;
+    wake = !w->wake_pending;
+    w->wake_pending = 1;
+    gen_mutex_unlock(&w->mutex);
+
+    if (wake)
+    {
+        sm_worker_wake(w);
+    }
+    return 0;
+}
+
+/* server_sm_workers_pause()
+ *
+ * waits until no worker is inside a state action and keeps them out
+ * until server_sm_workers_resume() is called
+ */
+void server_sm_workers_pause(void)
+{
+    gen_mutex_lock(&pause_mutex);
+    workers_paused = 1;
+    while (workers_active > 0)
+    {
+        gen_cond_wait(&pause_cond, &pause_mutex);
+    }
+    gen_mutex_unlock(&pause_mutex);
+}
+
+void server_sm_workers_resume(void)
+{
+    gen_mutex_lock(&pause_mutex);
+    workers_paused = 0;
+    gen_cond_broadcast(&pause_cond);
+    gen_mutex_unlock(&pause_mutex);
+}
+
+/* sm_worker_wake()
+ *
+ * posts a null job with no user pointer to the worker's context so that
+ * it returns from job_testcontext() right away
+ */
+static void sm_worker_wake(struct sm_worker *w)
+{
+    job_status_s js;
+    job_id_t id;
+    int ret;
+
+    ret = job_null(0, NULL, 0, &js, &id, w->context);
+    if (ret != 0)
+    {
+        gossip_err("Error: failed to wake state machine worker\n");
+    }
+}
+
+static void sm_worker_enter(void)
+{
+    gen_mutex_lock(&pause_mutex);
+    while (workers_paused && !workers_stopping)
+    {
+        gen_cond_wait(&pause_cond, &pause_mutex);
+    }
+    workers_active++;
+    gen_mutex_unlock(&pause_mutex);
+}
+
+static void sm_worker_leave(void)
+{
+    gen_mutex_lock(&pause_mutex);
+    workers_active--;
+    if (workers_paused && workers_active == 0)
+    {
+        gen_cond_broadcast(&pause_cond);
+    }
+    gen_mutex_unlock(&pause_mutex);
+}
+
+static void *sm_worker_fn(void *arg)
+{
+    struct sm_worker *w = (struct sm_worker *)arg;
+    struct sm_start_item item;
+    int i, ret, comp_ct;
+    sigset_t sigs;
+
+    /* leave asynchronous signals to the main thread; its handlers walk
+     * the server op lists, which a worker may hold locked
+     */
+    sigfillset(&sigs);
+    sigdelset(&sigs, SIGSEGV);
+    sigdelset(&sigs, SIGBUS);
+    sigdelset(&sigs, SIGILL);
+    sigdelset(&sigs, SIGFPE);
+    sigdelset(&sigs, SIGABRT);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    pthread_setspecific(worker_key, w);
+
+    for (;;)
+    {
+        /* start whatever state machines were handed to us */
+        gen_mutex_lock(&w->mutex);
+        w->wake_pending = 0;
+        while (w->count > 0 && !workers_stopping)
+        {
+            item = w->items[w->head];
+            w->head = (w->head + 1) % w->size;
+            w->count--;
+            gen_mutex_unlock(&w->mutex);
+
+            sm_worker_enter();
+            item.smcb->context = w->context;
+            ret = item.start_fn(item.smcb);
+            if (ret < 0)
+            {
+                PVFS_perror_gossip("Error: state machine start failed", ret);
+            }
+            sm_worker_leave();
+
+            gen_mutex_lock(&w->mutex);
+        }
+        gen_mutex_unlock(&w->mutex);
+
+        if (workers_stopping)
+        {
+            break;
+        }
+
+        comp_ct = SM_WORKER_TEST_COUNT;
+        ret = job_testcontext(w->job_id_array,
+                              &comp_ct,
+                              w->user_ptr_array,
+                              w->status_array,
+                              PVFS2_SERVER_DEFAULT_TIMEOUT_MS,
+                              w->context);
+        if (ret < 0)
+        {
+            gossip_lerr("pvfs2-server panic; state machine worker "
+                        "aborting\n");
+            break;
+        }
+
+        sm_worker_enter();
+        for (i = 0; i < comp_ct; i++)
+        {
+            /* wake up calls carry no state machine */
+            if (!w->user_ptr_array[i])
+            {
+                continue;
+            }
+            ret = PINT_state_machine_continue(
+                (struct PINT_smcb *)w->user_ptr_array[i],
+                &w->status_array[i]);
+            if (SM_ACTION_ISERR(ret))
+            {
+                PVFS_perror_gossip("Error: state machine processing error",
+                                   ret);
+            }
+        }
+        sm_worker_leave();
+    }
+
+    return NULL;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
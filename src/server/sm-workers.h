@@ -0,0 +1,41 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Optional pool of threads that run the server's state machines.  Each
+ * worker has a job context of its own and runs the same test/continue
+ * loop as the main thread on it.  A state machine is started on one
+ * worker and every job it (or any child machine) posts completes back to
+ * that worker, so its state actions never run concurrently and a job
+ * descriptor is only ever reaped by the thread that posted it.
+ */
+
+#ifndef __SM_WORKERS_H
+#define __SM_WORKERS_H
+
+#include "state-machine.h"
+#include "job.h"
+
+int server_sm_workers_initialize(int count);
+void server_sm_workers_finalize(void);
+int server_sm_workers_running(void);
+
+job_context_id server_sm_workers_context(job_context_id main_context);
+int server_sm_workers_start(struct PINT_smcb *smcb,
+                            int (*start_fn)(struct PINT_smcb *));
+
+void server_sm_workers_pause(void);
+void server_sm_workers_resume(void);
+
+#endif /* __SM_WORKERS_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
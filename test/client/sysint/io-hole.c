@@ -27,6 +27,7 @@ int main(int argc, char **argv)
     PVFS_sysresp_lookup resp_lk;
     PVFS_sysresp_create resp_cr;
     PVFS_sysresp_io resp_io;
+    PVFS_sysresp_seek resp_seek;
     PVFS_credential credentials;
     PVFS_object_ref parent_refn;
     PVFS_sys_attr attr;
@@ -154,6 +155,40 @@ int main(int argc, char **argv)
     printf("IO-HOLE: read %lld bytes at offset 10\n",
            lld(resp_io.total_completed));
 
+    /* the hole may be rounded to the storage block size, or not seen at
+     * all if storage cannot report holes, but it has to be in between
+     */
+    ret = PVFS_sys_seek(pinode_refn, 0, PVFS_SEEK_HOLE, &credentials,
+                        &resp_seek, NULL);
+    if ((ret < 0) || (resp_seek.offset < MAX_BUF_LEN) ||
+        (resp_seek.offset > 100000 + MAX_BUF_LEN))
+    {
+        PVFS_perror("PVFS_sys_seek (hole) failure", ret);
+        return -1;
+    }
+    printf("IO-HOLE: hole at offset %lld\n", lld(resp_seek.offset));
+
+    if (resp_seek.offset < 100000)
+    {
+        ret = PVFS_sys_seek(pinode_refn, resp_seek.offset, PVFS_SEEK_DATA,
+                            &credentials, &resp_seek, NULL);
+        if ((ret < 0) || (resp_seek.offset > 100000))
+        {
+            PVFS_perror("PVFS_sys_seek (data) failure", ret);
+            return -1;
+        }
+        printf("IO-HOLE: data at offset %lld\n", lld(resp_seek.offset));
+    }
+
+    ret = PVFS_sys_seek(pinode_refn, 100000 + MAX_BUF_LEN, PVFS_SEEK_DATA,
+                        &credentials, &resp_seek, NULL);
+    if (ret != -PVFS_ENXIO)
+    {
+        fprintf(stderr, "Seeking data past the end did not fail with "
+                "ENXIO (%d)\n", ret);
+        return -1;
+    }
+
     ret = PVFS_sys_finalize();
     if (ret < 0)
     {
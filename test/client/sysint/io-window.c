@@ -0,0 +1,540 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Checks reads and writes big enough to be sent to each server in
+ * windows (IO_WINDOW_STRIPES in sys-io.sm).  Every request here covers
+ * more than twice that many stripes of a file with small strips.  Writes
+ * must report every byte.  Reads must stop at the end of the file, also
+ * when it falls in a later window or a window starts past it, and return
+ * zeroes for holes.
+ *
+ * Given the pid of a server that holds data but not the metadata of the
+ * files or the directory, the test also mirrors a file, stops that
+ * server and reads the file.  The read must move on to the other copy
+ * once the stopped server falls behind, long before a BMI timeout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "client.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+#include "pvfs2-mirror.h"
+
+/* as in sys-io.sm */
+#define IO_WINDOW_STRIPES 16
+
+#define STRIP_SIZE 4096
+/* a little over two and a half windows */
+#define REQ_STRIPES 40
+/* the mirrored read has to outlast the straggler limit by far */
+#define MIRROR_STRIPES 4096
+/* far less than the BMI timeout a stopped server would otherwise hit */
+#define MIRROR_READ_MSECS 20000
+
+static PVFS_credential creds;
+static PVFS_size stripe;
+static pid_t stopped_server;
+
+static long long now_msecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/* reads or writes size bytes at offset; returns the bytes moved */
+static PVFS_size io_at(enum PVFS_io_type type, PVFS_object_ref ref,
+                       PVFS_offset offset, char *buf, PVFS_size size)
+{
+    PVFS_sysresp_io resp;
+    PVFS_Request mem_req;
+    int ret;
+
+    ret = PVFS_Request_contiguous(size, PVFS_BYTE, &mem_req);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_Request_contiguous", ret);
+        return ret;
+    }
+    memset(&resp, 0, sizeof(resp));
+    ret = PVFS_sys_io(ref, PVFS_BYTE, offset, buf, mem_req, &creds, &resp,
+                      type, NULL);
+    PVFS_Request_free(&mem_req);
+    if (ret < 0)
+    {
+        PVFS_perror(type == PVFS_IO_READ ? "PVFS_sys_read" :
+                    "PVFS_sys_write", ret);
+        return ret;
+    }
+    return resp.total_completed;
+}
+
+static int check_count(const char *what, PVFS_size got, PVFS_size expected)
+{
+    if (got != expected)
+    {
+        fprintf(stderr, "Error: %s: %lld bytes, expected %lld\n", what,
+                lld(got), lld(expected));
+        return -1;
+    }
+    return 0;
+}
+
+static int create_file(const char *name, PVFS_object_ref parent,
+                       PVFS_object_ref *ref)
+{
+    PVFS_sysresp_create resp_cr;
+    PVFS_sysresp_getattr resp_ga;
+    PVFS_sys_attr attr;
+    PVFS_sys_dist *dist;
+    PVFS_size strip = STRIP_SIZE;
+    int ret;
+
+    dist = PVFS_sys_dist_lookup("simple_stripe");
+    if (!dist)
+    {
+        fprintf(stderr, "Error: no simple_stripe distribution\n");
+        return -1;
+    }
+    ret = PVFS_sys_dist_setparam(dist, "strip_size", &strip);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_dist_setparam", ret);
+        PVFS_sys_dist_free(dist);
+        return ret;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.owner = creds.userid;
+    attr.group = creds.group_array[0];
+    attr.perms = PVFS_U_WRITE | PVFS_U_READ;
+    attr.atime = attr.ctime = attr.mtime = time(NULL);
+    attr.mask = PVFS_ATTR_SYS_ALL_SETABLE;
+    ret = PVFS_sys_create((char *)name, parent, attr, &creds, dist,
+                          &resp_cr, NULL, NULL);
+    PVFS_sys_dist_free(dist);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_create", ret);
+        return ret;
+    }
+    *ref = resp_cr.ref;
+
+    /* a new file is stuffed into one datafile until written past its
+     * first strip; do that, so that it is striped over all of them */
+    ret = check_count("unstuff", io_at(PVFS_IO_WRITE, *ref, STRIP_SIZE,
+                                       (char *)&strip, 1), 1);
+    if (ret == 0)
+    {
+        ret = PVFS_sys_truncate(*ref, 0, &creds, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_truncate", ret);
+        }
+    }
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    memset(&resp_ga, 0, sizeof(resp_ga));
+    ret = PVFS_sys_getattr(*ref, PVFS_ATTR_SYS_TYPE |
+                           PVFS_ATTR_SYS_DFILE_COUNT, &creds, &resp_ga, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_getattr", ret);
+        return ret;
+    }
+    stripe = STRIP_SIZE * resp_ga.attr.dfile_count;
+    PVFS_util_release_sys_attr(&resp_ga.attr);
+    if (stripe <= 0)
+    {
+        fprintf(stderr, "Error: %s has no datafiles\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* compares buf with what the file should hold */
+static int check_data(const char *what, const char *buf,
+                      const char *expected, PVFS_size size)
+{
+    PVFS_size i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (buf[i] != expected[i])
+        {
+            fprintf(stderr, "Error: %s: byte %lld is %d, expected %d\n",
+                    what, lld(i), buf[i], expected[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void fill(char *buf, PVFS_offset offset, PVFS_size size)
+{
+    PVFS_size i;
+
+    for (i = 0; i < size; i++)
+    {
+        buf[i] = (char)((offset + i) * 7 + 1);
+    }
+}
+
+/* a file written in windows, from the start and from an odd offset */
+static int test_write(PVFS_object_ref parent, const char *name)
+{
+    PVFS_object_ref ref;
+    PVFS_size len, size;
+    PVFS_offset off;
+    char *buf, *file;
+    int ret;
+
+    ret = create_file(name, parent, &ref);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    len = REQ_STRIPES * stripe + 100;
+    off = 3 * stripe + 7;
+    size = off + len;
+    buf = malloc(size);
+    file = malloc(size);
+    if (!buf || !file)
+    {
+        free(buf);
+        free(file);
+        return -1;
+    }
+    fill(file, 0, size);
+
+    ret = check_count("write at 0", io_at(PVFS_IO_WRITE, ref, 0, file, len),
+                      len);
+    if (ret == 0)
+    {
+        ret = check_count("write at odd offset",
+                          io_at(PVFS_IO_WRITE, ref, off, file + off, len),
+                          len);
+    }
+    if (ret == 0)
+    {
+        memset(buf, 0, size);
+        ret = check_count("read back", io_at(PVFS_IO_READ, ref, 0, buf, size),
+                          size);
+    }
+    if (ret == 0)
+    {
+        ret = check_data("read back", buf, file, size);
+    }
+
+    free(buf);
+    free(file);
+    PVFS_sys_remove((char *)name, parent, &creds, NULL);
+    return ret;
+}
+
+/* reads that end at a hole, at the end of the file or past it */
+static int test_short_read(PVFS_object_ref parent, const char *name)
+{
+    PVFS_object_ref ref;
+    PVFS_size len, size;
+    PVFS_offset tail;
+    char *buf, *file;
+    int ret;
+
+    ret = create_file(name, parent, &ref);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    len = REQ_STRIPES * stripe + 100;
+    buf = malloc(len);
+    file = calloc(1, len);
+    if (!buf || !file)
+    {
+        free(buf);
+        free(file);
+        return -1;
+    }
+
+    /* data in the first window, a hole, and the end of the file in the
+     * second window, on whichever server holds that strip */
+    tail = 2 * IO_WINDOW_STRIPES * stripe - 3 * STRIP_SIZE + 5;
+    fill(file, 0, STRIP_SIZE);
+    fill(file + tail, tail, 100);
+    size = tail + 100;
+    ret = check_count("write head",
+                      io_at(PVFS_IO_WRITE, ref, 0, file, STRIP_SIZE),
+                      STRIP_SIZE);
+    if (ret == 0)
+    {
+        ret = check_count("write tail",
+                          io_at(PVFS_IO_WRITE, ref, tail, file + tail, 100),
+                          100);
+    }
+    if (ret == 0)
+    {
+        memset(buf, 'x', len);
+        ret = check_count("read over hole and end",
+                          io_at(PVFS_IO_READ, ref, 0, buf, len), size);
+    }
+    if (ret == 0)
+    {
+        ret = check_data("read over hole and end", buf, file, size);
+    }
+
+    /* the end in the first window; later windows start past it */
+    if (ret == 0)
+    {
+        size = 5 * stripe + 3;
+        ret = PVFS_sys_truncate(ref, size, &creds, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_truncate", ret);
+        }
+    }
+    if (ret == 0)
+    {
+        memset(buf, 'x', len);
+        ret = check_count("read over end in first window",
+                          io_at(PVFS_IO_READ, ref, 0, buf, len), size);
+    }
+    if (ret == 0)
+    {
+        ret = check_data("read over end in first window", buf, file, size);
+    }
+
+    /* nothing at all to read */
+    if (ret == 0)
+    {
+        ret = check_count("read past end",
+                          io_at(PVFS_IO_READ, ref, size + 2 * stripe, buf,
+                                len), 0);
+    }
+
+    free(buf);
+    free(file);
+    PVFS_sys_remove((char *)name, parent, &creds, NULL);
+    return ret;
+}
+
+static int set_eattr(PVFS_object_ref ref, const char *key, void *val,
+                     int val_sz)
+{
+    PVFS_ds_keyval k, v;
+    int ret;
+
+    k.buffer = (char *)key;
+    k.buffer_sz = strlen(key) + 1;
+    v.buffer = val;
+    v.buffer_sz = val_sz;
+    ret = PVFS_sys_seteattr(ref, &creds, &k, &v, 0, NULL);
+    if (ret < 0)
+    {
+        fprintf(stderr, "Error: setting %s\n", key);
+        PVFS_perror("PVFS_sys_seteattr", ret);
+    }
+    return ret;
+}
+
+/* lets a read that hangs on the stopped server finish, and fail on its
+ * time, rather than leaving the server stopped */
+static void resume_server(int sig)
+{
+    kill(stopped_server, SIGCONT);
+}
+
+/* a mirrored file read while a server holding some of it is stopped */
+static int test_straggler(PVFS_object_ref parent, const char *name,
+                          pid_t server)
+{
+    PVFS_object_ref ref;
+    PVFS_sysresp_getattr resp_ga;
+    PVFS_ds_keyval k, v;
+    PVFS_flags hint_flags = 0;
+    PVFS_size size;
+    MIRROR_MODE mode = MIRROR_ON_IMMUTABLE;
+    int copies = 1, ret;
+    long long start, msecs;
+    char *buf, *file;
+
+    ret = create_file(name, parent, &ref);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    size = MIRROR_STRIPES * stripe;
+    buf = malloc(size);
+    file = malloc(size);
+    if (!buf || !file)
+    {
+        free(buf);
+        free(file);
+        return -1;
+    }
+    fill(file, 0, size);
+    ret = check_count("write mirrored file",
+                      io_at(PVFS_IO_WRITE, ref, 0, file, size), size);
+
+    /* as pvfs2-xattr does; making it immutable creates the copy */
+    if (ret == 0)
+    {
+        ret = set_eattr(ref, "user.pvfs2.mirror.copies", &copies,
+                        sizeof(copies));
+    }
+    if (ret == 0)
+    {
+        ret = set_eattr(ref, "user.pvfs2.mirror.mode", &mode, sizeof(mode));
+    }
+    if (ret == 0)
+    {
+        k.buffer = "user.pvfs2.meta_hint";
+        k.buffer_sz = sizeof("user.pvfs2.meta_hint");
+        v.buffer = &hint_flags;
+        v.buffer_sz = sizeof(hint_flags);
+        PVFS_sys_geteattr(ref, &creds, &k, &v, NULL);
+        hint_flags |= PVFS_IMMUTABLE_FL;
+        ret = set_eattr(ref, "user.pvfs2.meta_hint", &hint_flags,
+                        sizeof(hint_flags));
+    }
+
+    /* the read needs nothing else from the stopped server */
+    if (ret == 0)
+    {
+        memset(&resp_ga, 0, sizeof(resp_ga));
+        ret = PVFS_sys_getattr(ref, PVFS_ATTR_SYS_ALL_NOHINT, &creds,
+                               &resp_ga, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_getattr", ret);
+        }
+        else
+        {
+            PVFS_util_release_sys_attr(&resp_ga.attr);
+        }
+    }
+
+    if (ret == 0)
+    {
+        memset(buf, 0, size);
+        stopped_server = server;
+        signal(SIGALRM, resume_server);
+        kill(server, SIGSTOP);
+        alarm(MIRROR_READ_MSECS / 1000);
+        start = now_msecs();
+        ret = check_count("read with a server stopped",
+                          io_at(PVFS_IO_READ, ref, 0, buf, size), size);
+        msecs = now_msecs() - start;
+        alarm(0);
+        kill(server, SIGCONT);
+        if (ret == 0)
+        {
+            ret = check_data("read with a server stopped", buf, file, size);
+        }
+        if (ret == 0 && msecs >= MIRROR_READ_MSECS)
+        {
+            fprintf(stderr, "Error: read with a server stopped took %lld "
+                    "ms\n", msecs);
+            ret = -1;
+        }
+        if (ret == 0)
+        {
+            printf("read of %lld bytes with a server stopped: %lld ms\n",
+                   lld(size), msecs);
+        }
+    }
+
+    free(buf);
+    free(file);
+    PVFS_sys_remove((char *)name, parent, &creds, NULL);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    PVFS_fs_id fs_id;
+    PVFS_sysresp_lookup resp_lk;
+    char path[PVFS_NAME_MAX], name[PVFS_NAME_MAX], *dir, *base;
+    pid_t server = 0;
+    int ret;
+
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <file> [<pid of a data server>]\n",
+                argv[0]);
+        return -1;
+    }
+    if (argc == 3 && (sscanf(argv[2], "%d", &server) != 1 || server < 1))
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s%s", argv[1][0] == '/' ? "" : "/",
+             argv[1]);
+    base = strrchr(path, '/');
+    *base++ = '\0';
+    dir = path[0] ? path : "/";
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return -1;
+    }
+    ret = PVFS_util_get_default_fsid(&fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return -1;
+    }
+    PVFS_util_gen_credential_defaults(&creds);
+    ret = PVFS_sys_lookup(fs_id, dir, &creds, &resp_lk,
+                          PVFS2_LOOKUP_LINK_FOLLOW, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_lookup", ret);
+        return -1;
+    }
+
+    snprintf(name, sizeof(name), "%s.write", base);
+    ret = test_write(resp_lk.ref, name);
+    if (ret == 0)
+    {
+        snprintf(name, sizeof(name), "%s.short", base);
+        ret = test_short_read(resp_lk.ref, name);
+    }
+    if (ret == 0 && server)
+    {
+        snprintf(name, sizeof(name), "%s.mirror", base);
+        ret = test_straggler(resp_lk.ref, name, server);
+    }
+
+    PVFS_sys_finalize();
+    if (ret == 0)
+    {
+        printf("windowed reads and writes right\n");
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,341 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Checks that changing or removing a file breaks the attribute leases of
+ * other clients (AttrLeaseTimeoutSecs).  A second process, a client of
+ * its own, creates three files, and this process caches their attributes
+ * under a lease.  The second process then changes the permissions of one
+ * with a setattr, removes one with a remove request and the last with a
+ * batch remove (remove_list).  The server must not report any of those
+ * done until this process has dropped its copy, so the first getattr
+ * after the change returns must see it.  This process keeps making
+ * progress meanwhile so that it can answer the break.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "client.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+
+/* how long a change may be held back by the break of a lease held by a
+ * client that answers; far less than the lease itself */
+#define LEASE_BREAK_WAIT_MSECS 5000
+/* how often this process makes progress while a change is under way */
+#define LEASE_BREAK_POLL_MSECS 10
+
+#define FILE_COUNT 3
+
+static PVFS_credential creds;
+
+static int init(PVFS_fs_id *fs_id, const char *dir, PVFS_object_ref *parent)
+{
+    PVFS_sysresp_lookup resp_lk;
+    int ret;
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return ret;
+    }
+    ret = PVFS_util_get_default_fsid(fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return ret;
+    }
+    PVFS_util_gen_credential_defaults(&creds);
+
+    /* without a break, attributes stay cached well past the wait */
+    PVFS_sys_set_info(PVFS_SYS_ACACHE_TIMEOUT_MSECS,
+                      LEASE_BREAK_WAIT_MSECS * 10);
+
+    ret = PVFS_sys_lookup(*fs_id, (char *)dir, &creds, &resp_lk,
+                          PVFS2_LOOKUP_LINK_FOLLOW, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_lookup", ret);
+        return ret;
+    }
+    *parent = resp_lk.ref;
+    return 0;
+}
+
+/* creates the files, so that the other process has not cached their
+ * attributes, then changes or removes the file named by each command
+ * read; writes back the result of each step */
+static void remover(const char *dir, char **names, int cmd_fd, int res_fd)
+{
+    PVFS_fs_id fs_id;
+    PVFS_object_ref parent;
+    PVFS_sysresp_create resp_cr;
+    PVFS_sysresp_lookup resp_lk;
+    PVFS_sys_attr attr;
+    PVFS_error error;
+    int i, ret;
+
+    ret = init(&fs_id, dir, &parent);
+
+    memset(&attr, 0, sizeof(attr));
+    attr.owner = creds.userid;
+    attr.group = creds.group_array[0];
+    attr.perms = PVFS_U_WRITE | PVFS_U_READ;
+    attr.atime = attr.ctime = attr.mtime = time(NULL);
+    attr.mask = PVFS_ATTR_SYS_ALL_SETABLE;
+    for (i = 0; ret == 0 && i < FILE_COUNT; i++)
+    {
+        ret = PVFS_sys_create(names[i], parent, attr, &creds, NULL,
+                              &resp_cr, NULL, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_create", ret);
+        }
+    }
+    if (write(res_fd, &ret, sizeof(ret)) != sizeof(ret))
+    {
+        ret = -1;
+    }
+
+    while (ret == 0 && read(cmd_fd, &i, sizeof(i)) == sizeof(i))
+    {
+        if (i == 0)
+        {
+            ret = PVFS_sys_ref_lookup(fs_id, names[i], parent, &creds,
+                                      &resp_lk, PVFS2_LOOKUP_LINK_NO_FOLLOW,
+                                      NULL);
+            if (ret == 0)
+            {
+                attr.perms = PVFS_U_READ;
+                attr.mask = PVFS_ATTR_SYS_PERM;
+                ret = PVFS_sys_setattr(resp_lk.ref, attr, &creds, NULL);
+            }
+        }
+        else if (i == 1)
+        {
+            ret = PVFS_sys_remove(names[i], parent, &creds, NULL);
+        }
+        else
+        {
+            error = 0;
+            ret = PVFS_sys_remove_list(parent, 1, &names[i], &creds,
+                                       &error, NULL);
+            if (ret == 0)
+            {
+                ret = error;
+            }
+        }
+        if (ret < 0)
+        {
+            PVFS_perror(i == 0 ? "setattr" : "remove", ret);
+        }
+        if (write(res_fd, &ret, sizeof(ret)) != sizeof(ret))
+        {
+            break;
+        }
+    }
+    PVFS_sys_finalize();
+    exit(ret < 0 ? 1 : 0);
+}
+
+static int getattr(PVFS_object_ref ref, PVFS_permissions *perms)
+{
+    PVFS_sysresp_getattr resp;
+    int ret;
+
+    /* not the size, whose fetch from the datafiles would notice the
+     * removal without any lease break */
+    memset(&resp, 0, sizeof(resp));
+    ret = PVFS_sys_getattr(ref, PVFS_ATTR_SYS_ALL_NOSIZE, &creds, &resp,
+                           NULL);
+    if (ret == 0)
+    {
+        *perms = resp.attr.perms;
+        PVFS_util_release_sys_attr(&resp.attr);
+    }
+    return ret;
+}
+
+/* waits for the other process to finish a step, making progress all the
+ * while; returns the result of the step, or -1 if the process is lost */
+static int wait_step(PVFS_object_ref ref, int res_fd, int *waited)
+{
+    struct pollfd pfd;
+    struct timespec start, end;
+    PVFS_permissions perms;
+    int result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pfd.fd = res_fd;
+    pfd.events = POLLIN;
+    do
+    {
+        /* answers any break on the way */
+        getattr(ref, &perms);
+    } while (poll(&pfd, 1, LEASE_BREAK_POLL_MSECS) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *waited = (end.tv_sec - start.tv_sec) * 1000 +
+        (end.tv_nsec - start.tv_nsec) / 1000000;
+
+    if (read(res_fd, &result, sizeof(result)) != sizeof(result))
+    {
+        fprintf(stderr, "Error: lost the remover process.\n");
+        return -1;
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    PVFS_fs_id fs_id;
+    PVFS_object_ref parent, refs[FILE_COUNT];
+    PVFS_sysresp_lookup resp_lk;
+    PVFS_permissions perms;
+    char path[PVFS_NAME_MAX], *dir, *name;
+    char name_buf[FILE_COUNT][PVFS_NAME_MAX], *names[FILE_COUNT];
+    const char *how[FILE_COUNT] = {"setattr", "remove", "remove_list"};
+    int cmd_pipe[2], res_pipe[2];
+    int i, waited, result, ret = 0;
+    pid_t child;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <file>\n", argv[0]);
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s%s", argv[1][0] == '/' ? "" : "/",
+             argv[1]);
+    name = strrchr(path, '/');
+    *name++ = '\0';
+    dir = path[0] ? path : "/";
+    for (i = 0; i < FILE_COUNT; i++)
+    {
+        snprintf(name_buf[i], sizeof(name_buf[i]), "%s.%d", name, i);
+        names[i] = name_buf[i];
+    }
+
+    /* before the client is set up, so that it has its own */
+    if (pipe(cmd_pipe) < 0 || pipe(res_pipe) < 0)
+    {
+        perror("pipe");
+        return -1;
+    }
+    child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (child == 0)
+    {
+        close(cmd_pipe[1]);
+        close(res_pipe[0]);
+        remover(dir, names, cmd_pipe[0], res_pipe[1]);
+    }
+    close(cmd_pipe[0]);
+    close(res_pipe[1]);
+
+    ret = init(&fs_id, dir, &parent);
+    if (ret == 0 &&
+        read(res_pipe[0], &result, sizeof(result)) != sizeof(result))
+    {
+        fprintf(stderr, "Error: lost the remover process.\n");
+        ret = -1;
+    }
+    else if (ret == 0)
+    {
+        ret = result;
+    }
+    for (i = 0; ret == 0 && i < FILE_COUNT; i++)
+    {
+        ret = PVFS_sys_ref_lookup(fs_id, names[i], parent, &creds, &resp_lk,
+                                  PVFS2_LOOKUP_LINK_NO_FOLLOW, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_ref_lookup", ret);
+            break;
+        }
+        refs[i] = resp_lk.ref;
+    }
+
+    for (i = 0; ret == 0 && i < FILE_COUNT; i++)
+    {
+        /* cache the attributes, under a lease */
+        ret = getattr(refs[i], &perms);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_getattr", ret);
+            break;
+        }
+
+        if (write(cmd_pipe[1], &i, sizeof(i)) != sizeof(i))
+        {
+            fprintf(stderr, "Error: lost the remover process.\n");
+            ret = -1;
+            break;
+        }
+        ret = wait_step(refs[i], res_pipe[0], &waited);
+        if (ret < 0)
+        {
+            break;
+        }
+        if (waited >= LEASE_BREAK_WAIT_MSECS)
+        {
+            fprintf(stderr, "Error: %s: held back for %d ms\n", how[i],
+                    waited);
+            ret = -1;
+            break;
+        }
+
+        /* no waiting: the change was only reported once our copy went */
+        ret = getattr(refs[i], &perms);
+        if (i == 0 && ret == 0 && perms == PVFS_U_READ)
+        {
+            printf("%s: new attributes seen after %d ms\n", how[i], waited);
+        }
+        else if (i > 0 && ret == -PVFS_ENOENT)
+        {
+            printf("%s: attributes dropped after %d ms\n", how[i], waited);
+            ret = 0;
+        }
+        else if (ret == 0)
+        {
+            fprintf(stderr, "Error: %s: old attributes still cached\n",
+                    how[i]);
+            ret = -1;
+        }
+        else
+        {
+            PVFS_perror("PVFS_sys_getattr", ret);
+        }
+    }
+
+    close(cmd_pipe[1]);
+    waitpid(child, NULL, 0);
+    for (i = 0; i < FILE_COUNT; i++)
+    {
+        /* whatever the remover left */
+        PVFS_sys_remove(names[i], parent, &creds, NULL);
+    }
+    PVFS_sys_finalize();
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
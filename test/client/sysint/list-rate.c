@@ -0,0 +1,363 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Measures how many directory entries per second can be listed along
+ * with their attributes and two extended attributes, the way the DAV and
+ * S3 gateways list a directory.  The files are listed once with readdir
+ * and a getattr and geteattr for each entry, and once with readdirplus
+ * and one geteattr_bulk for each batch of entries; both listings must
+ * return the same values.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "client.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+
+#define LIST_BATCH 60
+#define LIST_NKEY 2
+#define LIST_VALSZ 64
+
+static PVFS_object_ref parent;
+static PVFS_credential creds;
+static PVFS_ds_keyval keys[LIST_NKEY];
+static char *key_names[LIST_NKEY] = {"user.list-rate.tag",
+                                     "user.list-rate.size"};
+/* values read by the listing being timed, in directory order */
+static char (*values)[LIST_NKEY][LIST_VALSZ];
+static int file_count;
+
+static double Wtime(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return((double)t.tv_sec + (double)(t.tv_usec) / 1000000);
+}
+
+static void expected_value(int file, int k, char *buf)
+{
+    if (k == 0)
+    {
+        snprintf(buf, LIST_VALSZ, "tag-%08x", file * 2654435761u);
+    }
+    else
+    {
+        snprintf(buf, LIST_VALSZ, "%d", file * 1000);
+    }
+}
+
+static int create_files(void)
+{
+    PVFS_sysresp_create resp;
+    PVFS_sys_attr attr;
+    PVFS_ds_keyval val;
+    char name[64], buf[LIST_VALSZ];
+    int i, k, ret;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.owner = creds.userid;
+    attr.group = creds.group_array[0];
+    attr.perms = PVFS_U_WRITE | PVFS_U_READ;
+    attr.atime = attr.ctime = attr.mtime = time(NULL);
+    attr.mask = PVFS_ATTR_SYS_ALL_SETABLE;
+
+    for (i = 0; i < file_count; i++)
+    {
+        snprintf(name, sizeof(name), "list-rate-%d", i);
+        ret = PVFS_sys_create(name, parent, attr, &creds, NULL, &resp,
+                              NULL, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_create", ret);
+            return ret;
+        }
+        for (k = 0; k < LIST_NKEY; k++)
+        {
+            expected_value(i, k, buf);
+            val.buffer = buf;
+            val.buffer_sz = strlen(buf) + 1;
+            ret = PVFS_sys_seteattr(resp.ref, &creds, &keys[k], &val, 0,
+                                    NULL);
+            if (ret < 0)
+            {
+                PVFS_perror("PVFS_sys_seteattr", ret);
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
+
+static void remove_files(void)
+{
+    char name[64];
+    int i;
+
+    for (i = 0; i < file_count; i++)
+    {
+        snprintf(name, sizeof(name), "list-rate-%d", i);
+        PVFS_sys_remove(name, parent, &creds, NULL);
+    }
+}
+
+/* stores a value under the number in the name of its file */
+static int store(const char *name, int k, const PVFS_ds_keyval *val)
+{
+    int file;
+
+    if (sscanf(name, "list-rate-%d", &file) != 1 || file < 0 ||
+        file >= file_count)
+    {
+        return 0;
+    }
+    snprintf(values[file][k], LIST_VALSZ, "%.*s", (int) val->read_sz,
+             (char *) val->buffer);
+    return 1;
+}
+
+/* readdir, then a getattr and a geteattr for every entry */
+static int list_per_entry(void)
+{
+    PVFS_sysresp_readdir rd;
+    PVFS_sysresp_getattr ga;
+    PVFS_sysresp_geteattr ge;
+    PVFS_ds_keyval vals[LIST_NKEY];
+    PVFS_error errs[LIST_NKEY];
+    PVFS_object_ref ref;
+    char bufs[LIST_NKEY][LIST_VALSZ];
+    PVFS_ds_position token = PVFS_ITERATE_START;
+    int i, k, ret, listed = 0;
+
+    do
+    {
+        memset(&rd, 0, sizeof(rd));
+        ret = PVFS_sys_readdir(parent, token, LIST_BATCH, &creds, &rd, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_readdir", ret);
+            return ret;
+        }
+        for (i = 0; i < rd.pvfs_dirent_outcount; i++)
+        {
+            ref.handle = rd.dirent_array[i].handle;
+            ref.fs_id = parent.fs_id;
+            ret = PVFS_sys_getattr(ref, PVFS_ATTR_SYS_ALL_NOHINT, &creds,
+                                   &ga, NULL);
+            if (ret < 0)
+            {
+                PVFS_perror("PVFS_sys_getattr", ret);
+                return ret;
+            }
+            PVFS_util_release_sys_attr(&ga.attr);
+
+            for (k = 0; k < LIST_NKEY; k++)
+            {
+                vals[k].buffer = bufs[k];
+                vals[k].buffer_sz = LIST_VALSZ;
+            }
+            ge.val_array = vals;
+            ge.err_array = errs;
+            ret = PVFS_sys_geteattr_list(ref, &creds, LIST_NKEY, keys, &ge,
+                                         NULL);
+            for (k = 0; ret == 0 && k < LIST_NKEY; k++)
+            {
+                if (errs[k] == 0)
+                {
+                    listed += store(rd.dirent_array[i].d_name, k, &vals[k]);
+                }
+            }
+        }
+        token = rd.token;
+        free(rd.dirent_array);
+    } while (rd.pvfs_dirent_outcount && token != PVFS_ITERATE_END);
+
+    return listed;
+}
+
+/* readdirplus, then one geteattr_bulk for the entries of each batch */
+static int list_bulk(void)
+{
+    PVFS_sysresp_readdirplus rd;
+    PVFS_sysresp_geteattr ge;
+    PVFS_handle handles[LIST_BATCH];
+    PVFS_ds_keyval vals[LIST_BATCH * LIST_NKEY];
+    PVFS_error errs[LIST_BATCH * LIST_NKEY];
+    char bufs[LIST_BATCH * LIST_NKEY][LIST_VALSZ];
+    PVFS_ds_position token = PVFS_ITERATE_START;
+    int i, k, ret, listed = 0;
+
+    do
+    {
+        memset(&rd, 0, sizeof(rd));
+        ret = PVFS_sys_readdirplus(parent, token, LIST_BATCH, &creds,
+                                   PVFS_ATTR_SYS_ALL_NOHINT, &rd, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_readdirplus", ret);
+            return ret;
+        }
+        for (i = 0; i < rd.pvfs_dirent_outcount; i++)
+        {
+            handles[i] = rd.dirent_array[i].handle;
+            for (k = 0; k < LIST_NKEY; k++)
+            {
+                vals[i * LIST_NKEY + k].buffer = bufs[i * LIST_NKEY + k];
+                vals[i * LIST_NKEY + k].buffer_sz = LIST_VALSZ;
+            }
+        }
+        ge.val_array = vals;
+        ge.err_array = errs;
+        ret = PVFS_sys_geteattr_bulk(parent, rd.pvfs_dirent_outcount,
+                                     handles, &creds, LIST_NKEY, keys, &ge,
+                                     NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_geteattr_bulk", ret);
+            return ret;
+        }
+        for (i = 0; i < rd.pvfs_dirent_outcount; i++)
+        {
+            for (k = 0; k < LIST_NKEY; k++)
+            {
+                if (errs[i * LIST_NKEY + k] == 0)
+                {
+                    listed += store(rd.dirent_array[i].d_name, k,
+                                    &vals[i * LIST_NKEY + k]);
+                }
+            }
+            if (rd.stat_err_array[i] == 0)
+            {
+                PVFS_util_release_sys_attr(&rd.attr_array[i]);
+            }
+        }
+        token = rd.token;
+        free(rd.dirent_array);
+        free(rd.stat_err_array);
+        free(rd.attr_array);
+    } while (rd.pvfs_dirent_outcount && token != PVFS_ITERATE_END);
+
+    return listed;
+}
+
+/* times one listing and checks every value it found */
+static int run(const char *name, int (*list)(void))
+{
+    char buf[LIST_VALSZ];
+    int i, k, listed, errors = 0;
+    double t;
+
+    memset(values, 0, file_count * sizeof(*values));
+    t = Wtime();
+    listed = list();
+    t = Wtime() - t;
+    if (listed < 0)
+    {
+        return listed;
+    }
+
+    for (i = 0; i < file_count; i++)
+    {
+        for (k = 0; k < LIST_NKEY; k++)
+        {
+            expected_value(i, k, buf);
+            if (strcmp(values[i][k], buf) != 0)
+            {
+                errors++;
+            }
+        }
+    }
+    printf("%-12s %8d entries %10.1f entries/sec %s\n", name,
+           listed / LIST_NKEY, listed / LIST_NKEY / t,
+           errors ? "MISMATCH" : "ok");
+    return errors ? -PVFS_EINVAL : 0;
+}
+
+int main(int argc, char **argv)
+{
+    PVFS_fs_id fs_id;
+    PVFS_sysresp_lookup resp_lk;
+    char path[PVFS_NAME_MAX];
+    int k, ret;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <directory> <files>\n", argv[0]);
+        return -1;
+    }
+    if (sscanf(argv[2], "%d", &file_count) != 1 || file_count < 1)
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s%s", argv[1][0] == '/' ? "" : "/",
+             argv[1]);
+
+    values = calloc(file_count, sizeof(*values));
+    if (!values)
+    {
+        return -1;
+    }
+    for (k = 0; k < LIST_NKEY; k++)
+    {
+        keys[k].buffer = key_names[k];
+        keys[k].buffer_sz = strlen(key_names[k]) + 1;
+    }
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return -1;
+    }
+    ret = PVFS_util_get_default_fsid(&fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return -1;
+    }
+    PVFS_util_gen_credential_defaults(&creds);
+
+    ret = PVFS_sys_lookup(fs_id, path, &creds, &resp_lk,
+                          PVFS2_LOOKUP_LINK_FOLLOW, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_lookup", ret);
+        return -1;
+    }
+    parent = resp_lk.ref;
+
+    /* every listing should reach the servers */
+    PVFS_sys_set_info(PVFS_SYS_ACACHE_TIMEOUT_MSECS, 0);
+
+    ret = create_files();
+    if (ret == 0)
+    {
+        ret = run("per-entry", list_per_entry);
+    }
+    if (ret == 0)
+    {
+        ret = run("bulk", list_bulk);
+    }
+
+    remove_files();
+    PVFS_sys_finalize();
+    free(values);
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
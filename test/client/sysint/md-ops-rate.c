@@ -0,0 +1,290 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Measures how many metadata operations per second the servers complete
+ * with a fixed number of requests in flight.  Run it against servers
+ * started with different StateMachineWorkers settings to see how request
+ * processing scales with server threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "client.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+
+enum md_phase
+{
+    MD_CREATE,
+    MD_GETATTR,
+    MD_REMOVE
+};
+
+struct md_slot
+{
+    int file;
+    char name[64];
+    PVFS_sysresp_create create;
+    PVFS_sysresp_getattr getattr;
+    PVFS_sys_op_id op_id;
+};
+
+static PVFS_object_ref parent;
+static PVFS_credential creds;
+static PVFS_object_ref *files;
+static int file_count;
+
+static double Wtime(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return((double)t.tv_sec + (double)(t.tv_usec) / 1000000);
+}
+
+static int md_post(enum md_phase phase, struct md_slot *slot)
+{
+    PVFS_sys_attr attr;
+
+    slot->op_id = -1;
+    switch (phase)
+    {
+        case MD_CREATE:
+            memset(&attr, 0, sizeof(attr));
+            attr.owner = creds.userid;
+            attr.group = creds.group_array[0];
+            attr.perms = PVFS_U_WRITE | PVFS_U_READ;
+            attr.atime = attr.ctime = attr.mtime = time(NULL);
+            attr.mask = PVFS_ATTR_SYS_ALL_SETABLE;
+            snprintf(slot->name, sizeof(slot->name), "md-ops-%d",
+                     slot->file);
+            return PVFS_isys_create(slot->name, parent, attr, &creds,
+                                    NULL, NULL, &slot->create,
+                                    &slot->op_id, NULL, slot);
+        case MD_GETATTR:
+            return PVFS_isys_getattr(files[slot->file], PVFS_ATTR_SYS_ALL,
+                                     &creds, &slot->getattr, &slot->op_id,
+                                     NULL, slot);
+        case MD_REMOVE:
+            snprintf(slot->name, sizeof(slot->name), "md-ops-%d",
+                     slot->file);
+            return PVFS_isys_remove(slot->name, parent, &creds,
+                                    &slot->op_id, NULL, slot);
+    }
+    return -PVFS_EINVAL;
+}
+
+static int md_done(enum md_phase phase, struct md_slot *slot, int error)
+{
+    if (error)
+    {
+        PVFS_perror("md-ops-rate: operation failed", error);
+        return error;
+    }
+    if (phase == MD_CREATE)
+    {
+        files[slot->file] = slot->create.ref;
+    }
+    else if (phase == MD_GETATTR)
+    {
+        PVFS_util_release_sys_attr(&slot->getattr.attr);
+    }
+    return 0;
+}
+
+/* keeps window operations of one kind in flight; runs count operations,
+ * or for the given number of seconds if count is 0
+ */
+static int md_run(enum md_phase phase, int window, int count,
+                  double seconds, int *done)
+{
+    struct md_slot *slots;
+    struct md_slot **idle;
+    struct md_slot **busy;
+    PVFS_sys_op_id *ids;
+    void **user_ptrs;
+    int *errors;
+    int idle_count = window, busy_count = 0;
+    int posted = 0;
+    int i, j, n, ret = 0;
+    double end = Wtime() + seconds;
+
+    slots = calloc(window, sizeof(*slots));
+    idle = calloc(window, sizeof(*idle));
+    busy = calloc(window, sizeof(*busy));
+    ids = calloc(window, sizeof(*ids));
+    user_ptrs = calloc(window, sizeof(*user_ptrs));
+    errors = calloc(window, sizeof(*errors));
+    if (!slots || !idle || !busy || !ids || !user_ptrs || !errors)
+    {
+        fprintf(stderr, "md-ops-rate: out of memory\n");
+        return -PVFS_ENOMEM;
+    }
+    for (i = 0; i < window; i++)
+    {
+        idle[i] = &slots[i];
+    }
+
+    *done = 0;
+    while (ret == 0)
+    {
+        while (idle_count > 0 &&
+               (count ? posted < count : Wtime() < end))
+        {
+            struct md_slot *slot = idle[--idle_count];
+
+            slot->file = posted++ % file_count;
+            ret = md_post(phase, slot);
+            if (ret < 0 || slot->op_id == -1)
+            {
+                /* completed immediately */
+                idle[idle_count++] = slot;
+                ret = md_done(phase, slot, ret < 0 ? ret : 0);
+                if (ret < 0)
+                {
+                    break;
+                }
+                (*done)++;
+                continue;
+            }
+            busy[busy_count++] = slot;
+        }
+        if (ret < 0 || busy_count == 0)
+        {
+            break;
+        }
+
+        for (i = 0; i < busy_count; i++)
+        {
+            ids[i] = busy[i]->op_id;
+        }
+        n = busy_count;
+        ret = PVFS_sys_testsome(ids, &n, user_ptrs, errors, 100);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_testsome", ret);
+            break;
+        }
+        for (i = 0; i < n; i++)
+        {
+            for (j = 0; j < busy_count; j++)
+            {
+                if (busy[j] == user_ptrs[i])
+                {
+                    busy[j] = busy[--busy_count];
+                    break;
+                }
+            }
+            idle[idle_count++] = user_ptrs[i];
+            if (md_done(phase, user_ptrs[i], errors[i]) < 0)
+            {
+                ret = errors[i];
+            }
+            (*done)++;
+        }
+    }
+
+    free(slots);
+    free(idle);
+    free(busy);
+    free(ids);
+    free(user_ptrs);
+    free(errors);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    PVFS_fs_id fs_id;
+    PVFS_sysresp_lookup resp_lk;
+    char path[PVFS_NAME_MAX];
+    int window = 0, seconds = 0;
+    int done = 0;
+    int ret;
+    double t;
+
+    if (argc != 5)
+    {
+        fprintf(stderr, "Usage: %s <directory> <files> <ops in flight> "
+                "<getattr seconds>\n", argv[0]);
+        return -1;
+    }
+    if (sscanf(argv[2], "%d", &file_count) != 1 || file_count < 1 ||
+        sscanf(argv[3], "%d", &window) != 1 || window < 1 ||
+        sscanf(argv[4], "%d", &seconds) != 1 || seconds < 1)
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s%s", argv[1][0] == '/' ? "" : "/",
+             argv[1]);
+
+    files = calloc(file_count, sizeof(*files));
+    if (!files)
+    {
+        return -1;
+    }
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return -1;
+    }
+    ret = PVFS_util_get_default_fsid(&fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return -1;
+    }
+    PVFS_util_gen_credential_defaults(&creds);
+
+    ret = PVFS_sys_lookup(fs_id, path, &creds, &resp_lk,
+                          PVFS2_LOOKUP_LINK_FOLLOW, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_lookup", ret);
+        return -1;
+    }
+    parent = resp_lk.ref;
+
+    /* every getattr should reach a server */
+    PVFS_sys_set_info(PVFS_SYS_ACACHE_TIMEOUT_MSECS, 0);
+
+    t = Wtime();
+    ret = md_run(MD_CREATE, window, file_count, 0, &done);
+    t = Wtime() - t;
+    printf("create:  %8d ops %10.1f ops/sec\n", done, done / t);
+    if (ret == 0)
+    {
+        t = Wtime();
+        ret = md_run(MD_GETATTR, window, 0, seconds, &done);
+        t = Wtime() - t;
+        printf("getattr: %8d ops %10.1f ops/sec\n", done, done / t);
+    }
+
+    /* remove whatever was created even if something failed */
+    t = Wtime();
+    md_run(MD_REMOVE, window, file_count, 0, &done);
+    t = Wtime() - t;
+    printf("remove:  %8d ops %10.1f ops/sec\n", done, done / t);
+
+    PVFS_sys_finalize();
+    free(files);
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
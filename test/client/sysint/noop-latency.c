@@ -0,0 +1,155 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Ping-pong latency benchmark: sends one PVFS_SERV_MGMT_NOOP request at
+ * a time to a server and reports the round trip times.  A noop does no
+ * work on the server, so this measures the request path through the
+ * client and server job layers and the network alone.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "client.h"
+#include "pvfs2-mgmt.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+
+#define NOOP_WARMUP 100
+
+static double Wtime(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return((double)t.tv_sec + (double)(t.tv_usec) / 1000000);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    int ret, i, iterations, server = 0, count = 0;
+    PVFS_fs_id fs_id;
+    PVFS_credential creds;
+    PVFS_BMI_addr_t *addr_array;
+    double *times, start, total = 0;
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <iterations> [server index]\n", argv[0]);
+        return -1;
+    }
+    iterations = atoi(argv[1]);
+    if (argc == 3)
+    {
+        server = atoi(argv[2]);
+    }
+    if (iterations < 1 || server < 0)
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return -1;
+    }
+    ret = PVFS_util_get_default_fsid(&fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return -1;
+    }
+    ret = PVFS_util_gen_credential_defaults(&creds);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_gen_credential_defaults", ret);
+        return -1;
+    }
+
+    ret = PVFS_mgmt_count_servers(
+        fs_id, PVFS_MGMT_IO_SERVER | PVFS_MGMT_META_SERVER, &count);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_mgmt_count_servers", ret);
+        return -1;
+    }
+    if (server >= count)
+    {
+        fprintf(stderr, "Error: only %d servers.\n", count);
+        return -1;
+    }
+    addr_array = (PVFS_BMI_addr_t *)malloc(count * sizeof(PVFS_BMI_addr_t));
+    times = (double *)malloc(iterations * sizeof(double));
+    if (!addr_array || !times)
+    {
+        fprintf(stderr, "noop-latency: out of memory\n");
+        return -1;
+    }
+    ret = PVFS_mgmt_get_server_array(
+        fs_id, PVFS_MGMT_IO_SERVER | PVFS_MGMT_META_SERVER,
+        addr_array, &count);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_mgmt_get_server_array", ret);
+        return -1;
+    }
+
+    /* get the connection up and the caches warm */
+    for (i = 0; i < NOOP_WARMUP; i++)
+    {
+        ret = PVFS_mgmt_noop(fs_id, &creds, addr_array[server], NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_mgmt_noop", ret);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < iterations; i++)
+    {
+        start = Wtime();
+        ret = PVFS_mgmt_noop(fs_id, &creds, addr_array[server], NULL);
+        times[i] = Wtime() - start;
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_mgmt_noop", ret);
+            return -1;
+        }
+        total += times[i];
+    }
+
+    qsort(times, iterations, sizeof(double), cmp_double);
+    printf("%d noops to %s: avg %.1f usec, min %.1f, median %.1f, "
+           "99%% %.1f, max %.1f\n",
+           iterations, PVFS_mgmt_map_addr(fs_id, addr_array[server], NULL),
+           total * 1e6 / iterations, times[0] * 1e6,
+           times[iterations / 2] * 1e6,
+           times[(int)(iterations * 0.99)] * 1e6,
+           times[iterations - 1] * 1e6);
+
+    free(times);
+    free(addr_array);
+    PVFS_sys_finalize();
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,271 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Checks that the size of a file is right after every change, when the
+ * metadata server caches sizes (SizeCacheTimeoutSecs).  The file is
+ * grown by writes and shrunk and grown by truncates, and after each
+ * change its size is read twice, once usually starting a fetch of the
+ * size by the server and once usually hitting its cache.  A second
+ * process reads the size all the while, so that fetches race with the
+ * changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "client.h"
+#include "pvfs2-util.h"
+#include "pvfs2-internal.h"
+
+#define SIZE_CHECK_MAX (4 * 1024 * 1024)
+#define SIZE_CHECK_IO 4096
+
+static PVFS_credential creds;
+
+static int init(PVFS_fs_id *fs_id)
+{
+    int ret;
+
+    ret = PVFS_util_init_defaults();
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_init_defaults", ret);
+        return ret;
+    }
+    ret = PVFS_util_get_default_fsid(fs_id);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_util_get_default_fsid", ret);
+        return ret;
+    }
+    PVFS_util_gen_credential_defaults(&creds);
+
+    /* every size should come from the servers */
+    PVFS_sys_set_info(PVFS_SYS_ACACHE_TIMEOUT_MSECS, 0);
+    return 0;
+}
+
+static int get_size(PVFS_object_ref ref, PVFS_size *size)
+{
+    PVFS_sysresp_getattr resp;
+    int ret;
+
+    memset(&resp, 0, sizeof(resp));
+    ret = PVFS_sys_getattr(ref, PVFS_ATTR_SYS_SIZE, &creds, &resp, NULL);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_getattr", ret);
+        return ret;
+    }
+    *size = resp.attr.size;
+    PVFS_util_release_sys_attr(&resp.attr);
+    return 0;
+}
+
+static int write_at(PVFS_object_ref ref, PVFS_offset offset, char *buf)
+{
+    PVFS_sysresp_io resp;
+    PVFS_Request mem_req;
+    int ret;
+
+    ret = PVFS_Request_contiguous(SIZE_CHECK_IO, PVFS_BYTE, &mem_req);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_Request_contiguous", ret);
+        return ret;
+    }
+    ret = PVFS_sys_write(ref, PVFS_BYTE, offset, buf, mem_req, &creds,
+                         &resp, NULL);
+    PVFS_Request_free(&mem_req);
+    if (ret < 0)
+    {
+        PVFS_perror("PVFS_sys_write", ret);
+    }
+    return ret;
+}
+
+/* reads the size of the file, once it exists, until killed */
+static void reader(const char *name)
+{
+    PVFS_sysresp_lookup resp_lk;
+    PVFS_fs_id fs_id;
+    PVFS_size size;
+
+    if (init(&fs_id) < 0)
+    {
+        exit(1);
+    }
+    while (PVFS_sys_lookup(fs_id, (char *)name, &creds, &resp_lk,
+                           PVFS2_LOOKUP_LINK_FOLLOW, NULL) < 0)
+    {
+        usleep(10000);
+    }
+    while (get_size(resp_lk.ref, &size) == 0)
+    {
+    }
+    exit(1);
+}
+
+static int check(PVFS_object_ref ref, PVFS_size expected, int round,
+                 const char *what)
+{
+    PVFS_size size;
+    int i, ret;
+
+    for (i = 0; i < 2; i++)
+    {
+        ret = get_size(ref, &size);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        if (size != expected)
+        {
+            fprintf(stderr, "Error: round %d, after %s: size %lld, "
+                    "expected %lld\n", round, what, lld(size),
+                    lld(expected));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    PVFS_fs_id fs_id;
+    PVFS_sysresp_lookup resp_lk;
+    PVFS_sysresp_create resp_cr;
+    PVFS_sys_attr attr;
+    PVFS_object_ref ref;
+    PVFS_size expected = 0;
+    PVFS_offset offset;
+    char path[PVFS_NAME_MAX], *dir, *name;
+    char buf[SIZE_CHECK_IO];
+    int rounds, i, ret = 0;
+    pid_t child;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <file> <rounds>\n", argv[0]);
+        return -1;
+    }
+    if (sscanf(argv[2], "%d", &rounds) != 1 || rounds < 1)
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s%s", argv[1][0] == '/' ? "" : "/",
+             argv[1]);
+    name = strrchr(path, '/');
+    *name++ = '\0';
+    dir = path[0] ? path : "/";
+    srandom(time(NULL));
+
+    /* before the client is set up, so that it has its own */
+    child = fork();
+    if (child == 0)
+    {
+        snprintf(buf, sizeof(buf), "%s/%s", path, name);
+        reader(buf);
+    }
+    memset(buf, 'x', sizeof(buf));
+
+    ret = init(&fs_id);
+    if (ret == 0)
+    {
+        ret = PVFS_sys_lookup(fs_id, dir, &creds, &resp_lk,
+                              PVFS2_LOOKUP_LINK_FOLLOW, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_lookup", ret);
+        }
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.owner = creds.userid;
+    attr.group = creds.group_array[0];
+    attr.perms = PVFS_U_WRITE | PVFS_U_READ;
+    attr.atime = attr.ctime = attr.mtime = time(NULL);
+    attr.mask = PVFS_ATTR_SYS_ALL_SETABLE;
+    if (ret == 0)
+    {
+        ret = PVFS_sys_create(name, resp_lk.ref, attr, &creds, NULL,
+                              &resp_cr, NULL, NULL);
+        if (ret < 0)
+        {
+            PVFS_perror("PVFS_sys_create", ret);
+        }
+    }
+    if (ret < 0)
+    {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        return -1;
+    }
+    ref = resp_cr.ref;
+
+    /* past the first strip, so that the file is no longer stuffed */
+    ret = write_at(ref, SIZE_CHECK_MAX / 2, buf);
+    expected = SIZE_CHECK_MAX / 2 + SIZE_CHECK_IO;
+    if (ret == 0)
+    {
+        ret = check(ref, expected, 0, "write");
+    }
+
+    for (i = 1; ret == 0 && i <= rounds; i++)
+    {
+        offset = random() % SIZE_CHECK_MAX;
+        if (random() % 3)
+        {
+            ret = write_at(ref, offset, buf);
+            if (offset + SIZE_CHECK_IO > expected)
+            {
+                expected = offset + SIZE_CHECK_IO;
+            }
+            if (ret == 0)
+            {
+                ret = check(ref, expected, i, "write");
+            }
+        }
+        else
+        {
+            ret = PVFS_sys_truncate(ref, offset, &creds, NULL);
+            if (ret < 0)
+            {
+                PVFS_perror("PVFS_sys_truncate", ret);
+                break;
+            }
+            expected = offset;
+            ret = check(ref, expected, i, "truncate");
+        }
+    }
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    PVFS_sys_remove(name, resp_lk.ref, &creds, NULL);
+    PVFS_sys_finalize();
+
+    if (ret == 0)
+    {
+        printf("%d rounds, sizes right\n", rounds);
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <gossip.h>
+
+enum{
+	DEBUG_SOME_STUFF = 1,
+};
+
+#define NTHREADS 4
+
+double Wtime(void);
+
+static unsigned int iter = 100000;
+
+static void *log_thread(void *arg)
+{
+	unsigned int i;
+	long id = (long)arg;
+
+	for(i=0; i<iter; i++)
+	{
+		gossip_debug(DEBUG_SOME_STUFF, "thread %ld message %u\n", id, i);
+	}
+	return(NULL);
+}
+
+static double run_threads(void)
+{
+	pthread_t threads[NTHREADS];
+	double time1;
+	long i;
+
+	time1 = Wtime();
+	for(i=0; i<NTHREADS; i++)
+	{
+		pthread_create(&threads[i], NULL, log_thread, (void *)i);
+	}
+	for(i=0; i<NTHREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	return(Wtime() - time1);
+}
+
+int main(int argc, char **argv)	{
+	double t_file, t_async, t_limited;
+	uint64_t dropped = 0, suppressed = 0;
+
+	if(argc > 1)
+	{
+		iter = atoi(argv[1]);
+	}
+
+	/* synchronous file logging */
+	gossip_enable_file("time-gossip.log", "w");
+	gossip_set_debug_mask(1, DEBUG_SOME_STUFF);
+	t_file = run_threads();
+
+	/* buffered logging with a background writer */
+	gossip_enable_async("time-gossip-async.log", "w", 0, 0);
+	gossip_set_debug_mask(1, DEBUG_SOME_STUFF);
+	t_async = run_threads();
+	gossip_flush();
+	gossip_get_async_stats(&dropped, &suppressed);
+	printf("async: %llu dropped, %llu suppressed\n",
+		(unsigned long long)dropped, (unsigned long long)suppressed);
+
+	/* same again, with at most 1000 messages per second from the site */
+	gossip_enable_async("time-gossip-async.log", "a", 0, 1000);
+	gossip_set_debug_mask(1, DEBUG_SOME_STUFF);
+	t_limited = run_threads();
+	gossip_get_async_stats(&dropped, &suppressed);
+	printf("rate limited: %llu dropped, %llu suppressed\n",
+		(unsigned long long)dropped, (unsigned long long)suppressed);
+
+	gossip_disable();
+
+	printf("%d threads x %u messages:\n", NTHREADS, iter);
+	printf("  file:         %f seconds\n", t_file);
+	printf("  async:        %f seconds\n", t_async);
+	printf("  rate limited: %f seconds\n", t_limited);
+
+	return(0);
+}
+
+double Wtime(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return((double)t.tv_sec + (double)t.tv_usec / 1000000);
+}
@@ -88,7 +88,7 @@ static void print_usage(void)
 {
         fprintf(stderr, "usage: pingpong -h HOST_URI -s|-c [-u] [-r]\n");
         fprintf(stderr, "       where:\n");
-        fprintf(stderr, "       HOST_URI is tcp://host:port, mx://host:board:endpoint, etc\n");
+        fprintf(stderr, "       HOST_URI is tcp://host:port, sm://host:port, mx://host:board:endpoint, etc\n");
         fprintf(stderr, "       -s is server and -c is client\n");
         fprintf(stderr, "       -u will use unexpected messages (pass to client only)\n");
         fprintf(stderr, "       -r will calculate and verify checksums (adler32)\n");
@@ -718,6 +718,8 @@ static void get_method(struct options *opts)
                 opts->method = strdup("bmi_mx");
         } else if (id[0] == 'i' && id[1] == 'b' && check_uri(&id[2])) {
                 opts->method = strdup("bmi_ib");
+        } else if (id[0] == 's' && id[1] == 'm' && check_uri(&id[2])) {
+                opts->method = strdup("bmi_sm");
         }
         return;
 }
@@ -0,0 +1,288 @@
+/*
+ * (C) 2002 Clemson University.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Checks the varstrip distribution against simple_stripe on a layout both
+ * can express, and times PINT_process_request over each of them and over
+ * an uneven varstrip layout.
+ *
+ * usage: test-varstrip-speed [-n <MB per server>] [-s <segmax>]
+ *                            [-i <iterations>]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "pvfs2-types.h"
+#include "gossip.h"
+#include "pint-distribution.h"
+#include "pint-dist-utils.h"
+#include "pvfs2-request.h"
+#include "pint-request.h"
+#include "pvfs2-dist-simple-stripe.h"
+#include "pvfs2-dist-varstrip.h"
+#include "pvfs2-internal.h"
+
+#define SERVERS 4
+#define STRIP (64 * 1024)
+
+static PINT_dist *make_dist(const char *name, const char *param,
+                            void *value)
+{
+    PINT_dist *dist = PINT_dist_create(name);
+
+    if (!dist)
+    {
+        fprintf(stderr, "Error: no distribution %s.\n", name);
+        exit(1);
+    }
+    if (dist->methods->set_param(name, dist->params, param, value) != 0)
+    {
+        fprintf(stderr, "Error: cannot set %s of %s.\n", param, name);
+        exit(1);
+    }
+    return dist;
+}
+
+/* compares every mapping function of two distributions for one server */
+static int compare_dists(PINT_dist *a, PINT_dist *b, uint32_t server_nr)
+{
+    PINT_request_file_data fa, fb;
+    PVFS_offset off;
+    int errors = 0;
+
+    memset(&fa, 0, sizeof(fa));
+    fa.server_nr = server_nr;
+    fa.server_ct = SERVERS;
+    fa.dist = a;
+    fb = fa;
+    fb.dist = b;
+
+    for (off = 0; off < 3 * SERVERS * STRIP; off += 4093)
+    {
+        if (a->methods->logical_to_physical_offset(a->params, &fa, off) !=
+            b->methods->logical_to_physical_offset(b->params, &fb, off) ||
+            a->methods->next_mapped_offset(a->params, &fa, off) !=
+            b->methods->next_mapped_offset(b->params, &fb, off))
+        {
+            fprintf(stderr, "mismatch at logical %lld on server %u\n",
+                    lld(off), server_nr);
+            errors++;
+        }
+    }
+    for (off = 0; off < 3 * STRIP; off += 4093)
+    {
+        if (a->methods->physical_to_logical_offset(a->params, &fa, off) !=
+            b->methods->physical_to_logical_offset(b->params, &fb, off) ||
+            a->methods->contiguous_length(a->params, &fa, off) !=
+            b->methods->contiguous_length(b->params, &fb, off))
+        {
+            fprintf(stderr, "mismatch at physical %lld on server %u\n",
+                    lld(off), server_nr);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/* checks that the servers of a layout between them map every byte once */
+static int check_round_trip(PINT_dist *dist, uint32_t server_ct,
+                            PVFS_size span)
+{
+    PINT_request_file_data fd;
+    PVFS_offset off, phys;
+    uint32_t s, owners;
+    int errors = 0;
+
+    memset(&fd, 0, sizeof(fd));
+    fd.server_ct = server_ct;
+    fd.dist = dist;
+
+    for (off = 0; off < span; off += 1021)
+    {
+        owners = 0;
+        for (s = 0; s < server_ct; s++)
+        {
+            fd.server_nr = s;
+            if (dist->methods->next_mapped_offset(
+                    dist->params, &fd, off) != off)
+            {
+                continue;
+            }
+            owners++;
+            phys = dist->methods->logical_to_physical_offset(
+                dist->params, &fd, off);
+            if (dist->methods->physical_to_logical_offset(
+                    dist->params, &fd, phys) != off)
+            {
+                fprintf(stderr, "round trip of %lld on server %u failed\n",
+                        lld(off), s);
+                errors++;
+            }
+        }
+        if (owners != 1)
+        {
+            fprintf(stderr, "%lld has %u owners\n", lld(off), owners);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/* returns the seconds taken to process a contiguous request of size bytes
+ * for every server of the file, iterations times
+ */
+static double time_requests(PINT_dist *dist, uint32_t server_ct,
+                            PVFS_size size, int segmax, int iterations,
+                            long *segs)
+{
+    PINT_Request *req;
+    PINT_Request_state *rs;
+    PINT_request_file_data fd;
+    PINT_Request_result result;
+    struct timeval start, end;
+    int32_t blocklength = size;
+    PVFS_size displacement = 0;
+    uint32_t s;
+    int i, ret;
+
+    PVFS_Request_indexed(1, &blocklength, &displacement, PVFS_BYTE, &req);
+
+    result.offset_array = malloc(segmax * sizeof(PVFS_offset));
+    result.size_array = malloc(segmax * sizeof(PVFS_size));
+    result.segmax = segmax;
+    result.bytemax = size;
+
+    memset(&fd, 0, sizeof(fd));
+    fd.server_ct = server_ct;
+    fd.fsize = size;
+    fd.dist = dist;
+    fd.extend_flag = 0;
+
+    *segs = 0;
+    gettimeofday(&start, NULL);
+    for (i = 0; i < iterations * server_ct; i++)
+    {
+        s = i % server_ct;
+        fd.server_nr = s;
+        rs = PINT_new_request_state(req);
+        do
+        {
+            result.segs = 0;
+            result.bytes = 0;
+            ret = PINT_process_request(rs, NULL, &fd, &result, PINT_CLIENT);
+            *segs += result.segs;
+        } while (!PINT_REQUEST_DONE(rs) && ret >= 0);
+        PINT_free_request_state(rs);
+        if (ret < 0)
+        {
+            fprintf(stderr, "Error: PINT_process_request() failure.\n");
+            exit(1);
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    free(result.offset_array);
+    free(result.size_array);
+    PVFS_Request_free(&req);
+
+    return (end.tv_sec - start.tv_sec) +
+        (end.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+static void report(const char *name, double secs, long segs)
+{
+    printf("%-24s %8.3f s %10ld segments %8.1f ns/segment\n",
+           name, secs, segs, segs ? secs * 1e9 / segs : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    PINT_dist *simple, *varstrip, *uneven;
+    PVFS_size strip_size = STRIP;
+    PVFS_size size;
+    char even_strips[] = "0:64K;1:64K;2:64K;3:64K";
+    char uneven_strips[] = "0:64K;1:192K;2:64K;3:128K;0:32K;1:16K";
+    int mb = 64, segmax = 64, iterations = 100;
+    int errors = 0;
+    double secs;
+    long segs;
+    uint32_t s;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:s:i:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n':
+                mb = atoi(optarg);
+                break;
+            case 's':
+                segmax = atoi(optarg);
+                break;
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n <MB per server>] "
+                        "[-s <segmax>] [-i <iterations>]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (mb <= 0 || mb > 512 || segmax <= 0 || iterations <= 0)
+    {
+        fprintf(stderr, "Error: bad arguments.\n");
+        return 1;
+    }
+
+    PINT_dist_initialize(NULL);
+
+    simple = make_dist(PVFS_DIST_SIMPLE_STRIPE_NAME, "strip_size",
+                       &strip_size);
+    varstrip = make_dist(PVFS_DIST_VARSTRIP_NAME, "strips", even_strips);
+    uneven = make_dist(PVFS_DIST_VARSTRIP_NAME, "strips", uneven_strips);
+
+    for (s = 0; s < SERVERS; s++)
+    {
+        errors += compare_dists(simple, varstrip, s);
+    }
+    errors += check_round_trip(varstrip, SERVERS, 3 * SERVERS * STRIP);
+    errors += check_round_trip(uneven, SERVERS, 3 * 512 * 1024);
+    if (errors)
+    {
+        printf("TEST FAILED: %d mismatches\n", errors);
+        return 1;
+    }
+    printf("varstrip mappings match simple_stripe\n");
+
+    size = (PVFS_size)mb * 1024 * 1024 * SERVERS;
+    printf("%d MB per server, %d servers, segmax %d, %d iterations\n",
+           mb, SERVERS, segmax, iterations);
+
+    secs = time_requests(simple, SERVERS, size, segmax, iterations, &segs);
+    report("simple_stripe", secs, segs);
+    secs = time_requests(varstrip, SERVERS, size, segmax, iterations, &segs);
+    report("varstrip (even)", secs, segs);
+    secs = time_requests(uneven, SERVERS, size, segmax, iterations, &segs);
+    report("varstrip (uneven)", secs, segs);
+
+    PINT_dist_free(simple);
+    PINT_dist_free(varstrip);
+    PINT_dist_free(uneven);
+    PINT_dist_finalize();
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,394 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Checks how write aggregation merges the pieces of the writes it
+ * gathers into runs (agg_add_extents() in write-agg.c), against a plain
+ * byte map of the datafile.  The runs must stay sorted and apart, hold
+ * exactly the bytes written, and newer data must win.  Needs no server
+ * or storage space.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/io/flow/flowproto-bmi-trove/write-agg.c"
+
+#define FILE_SIZE 65536
+#define RANDOM_WRITES 2000
+
+static unsigned char model[FILE_SIZE];
+static char present[FILE_SIZE];
+static unsigned char next_byte;
+
+static struct agg_batch *new_batch(void)
+{
+    memset(model, 0, sizeof(model));
+    memset(present, 0, sizeof(present));
+    return agg_batch_new(NULL);
+}
+
+/* adds a write of count pieces to the batch and to the model */
+static int add(struct agg_batch *batch, int count,
+               const TROVE_offset *offsets, const TROVE_size *sizes)
+{
+    char *data, *p;
+    TROVE_size total = 0;
+    int i, ret;
+
+    for (i = 0; i < count; i++)
+    {
+        total += sizes[i];
+    }
+    data = malloc(total + 1);
+    if (!data)
+    {
+        return -1;
+    }
+    p = data;
+    for (i = 0; i < count; i++)
+    {
+        TROVE_size j;
+
+        for (j = 0; j < sizes[i]; j++)
+        {
+            /* never 0, so a missing byte shows */
+            if (++next_byte == 0)
+            {
+                next_byte = 1;
+            }
+            p[j] = next_byte;
+            model[offsets[i] + j] = next_byte;
+            present[offsets[i] + j] = 1;
+        }
+        p += sizes[i];
+    }
+
+    ret = agg_add_extents(batch, count, offsets, sizes, data);
+    free(data);
+    if (ret < 0)
+    {
+        fprintf(stderr, "Error: agg_add_extents failed: %d\n", ret);
+    }
+    return ret;
+}
+
+static int add_one(struct agg_batch *batch, TROVE_offset offset,
+                   TROVE_size size)
+{
+    return add(batch, 1, &offset, &size);
+}
+
+/* checks that the runs of the batch are what the model holds, and that
+ * there are as many as expected (any when run_count is -1)
+ */
+static int check(struct agg_batch *batch, const char *what, int run_count)
+{
+    struct agg_run *run;
+    TROVE_offset prev_end = -1;
+    TROVE_size bytes = 0, expected = 0;
+    int count = 0, i;
+
+    qlist_for_each_entry(run, &batch->runs, link)
+    {
+        if (run->offset <= prev_end || run->size <= 0 ||
+            run->size > run->alloc || run->offset + run->size > FILE_SIZE)
+        {
+            fprintf(stderr, "Error: %s: run %d at %lld, %lld bytes, out "
+                    "of place\n", what, count, lld(run->offset),
+                    lld(run->size));
+            return -1;
+        }
+        for (i = 0; i < run->size; i++)
+        {
+            if (!present[run->offset + i] ||
+                (unsigned char)run->buffer[i] != model[run->offset + i])
+            {
+                fprintf(stderr, "Error: %s: wrong byte at %lld\n", what,
+                        lld(run->offset + i));
+                return -1;
+            }
+        }
+        bytes += run->size;
+        prev_end = run->offset + run->size;
+        count++;
+    }
+    for (i = 0; i < FILE_SIZE; i++)
+    {
+        expected += present[i];
+    }
+
+    if (bytes != expected)
+    {
+        fprintf(stderr, "Error: %s: runs hold %lld bytes, not %lld\n",
+                what, lld(bytes), lld(expected));
+        return -1;
+    }
+    if (count != batch->run_count ||
+        (run_count >= 0 && count != run_count))
+    {
+        fprintf(stderr, "Error: %s: %d runs, counted %d, expected %d\n",
+                what, count, batch->run_count, run_count);
+        return -1;
+    }
+    return 0;
+}
+
+static struct agg_run *first_run(struct agg_batch *batch)
+{
+    return qlist_entry(batch->runs.next, struct agg_run, link);
+}
+
+static int test_insert_before(void)
+{
+    struct agg_batch *batch = new_batch();
+    int ret;
+
+    ret = add_one(batch, 100, 10);
+    if (ret == 0)
+    {
+        ret = add_one(batch, 50, 10);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "insert before", 2);
+    }
+    if (ret == 0 && first_run(batch)->offset != 50)
+    {
+        fprintf(stderr, "Error: insert before: first run at %lld\n",
+                lld(first_run(batch)->offset));
+        ret = -1;
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_touching(void)
+{
+    struct agg_batch *batch = new_batch();
+    int ret;
+
+    ret = add_one(batch, 100, 10);
+    if (ret == 0)
+    {
+        /* ends where the run starts */
+        ret = add_one(batch, 90, 10);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "touching before", 1);
+    }
+    if (ret == 0)
+    {
+        /* starts where the run ends */
+        ret = add_one(batch, 110, 10);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "touching after", 1);
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_overlapping(void)
+{
+    struct agg_batch *batch = new_batch();
+    int ret;
+
+    ret = add_one(batch, 100, 20);
+    if (ret == 0)
+    {
+        ret = add_one(batch, 110, 20);
+    }
+    if (ret == 0)
+    {
+        ret = add_one(batch, 90, 20);
+    }
+    if (ret == 0)
+    {
+        /* inside the run */
+        ret = add_one(batch, 95, 5);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "overlapping", 1);
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_swallowing(void)
+{
+    struct agg_batch *batch = new_batch();
+    int ret = 0, i;
+
+    for (i = 0; i < 5 && ret == 0; i++)
+    {
+        ret = add_one(batch, 10 + 20 * i, 10);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "apart", 5);
+    }
+    if (ret == 0)
+    {
+        /* from inside the first run to inside the third */
+        ret = add_one(batch, 15, 40);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "swallowing from inside", 3);
+    }
+    if (ret == 0)
+    {
+        /* over the rest, touching the last */
+        ret = add_one(batch, 5, 85);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "swallowing all", 1);
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_grow_in_place(void)
+{
+    struct agg_batch *batch = new_batch();
+    char *buffer = NULL;
+    int ret;
+
+    ret = add_one(batch, 0, 100);
+    if (ret == 0)
+    {
+        /* appending grows the run to twice its size */
+        ret = add_one(batch, 100, 10);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "grow", 1);
+    }
+    if (ret == 0 && first_run(batch)->alloc != 200)
+    {
+        fprintf(stderr, "Error: grow: run has room for %lld bytes\n",
+                lld(first_run(batch)->alloc));
+        ret = -1;
+    }
+    if (ret == 0)
+    {
+        buffer = first_run(batch)->buffer;
+        ret = add_one(batch, 110, 90);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "grow in place", 1);
+    }
+    if (ret == 0 && first_run(batch)->buffer != buffer)
+    {
+        fprintf(stderr, "Error: grow in place: run was moved\n");
+        ret = -1;
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_pieces(void)
+{
+    struct agg_batch *batch = new_batch();
+    /* out of order, one bridging the two runs with the run between */
+    TROVE_offset offsets[] = {60, 0, 30, 50};
+    TROVE_size sizes[] = {10, 10, 10, 0};
+    int ret;
+
+    ret = add_one(batch, 20, 10);
+    if (ret == 0)
+    {
+        ret = add_one(batch, 40, 10);
+    }
+    if (ret == 0)
+    {
+        ret = add(batch, 4, offsets, sizes);
+    }
+    if (ret == 0)
+    {
+        ret = check(batch, "one write of several pieces", 3);
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+static int test_random(void)
+{
+    struct agg_batch *batch = new_batch();
+    TROVE_offset offsets[4];
+    TROVE_size sizes[4];
+    int ret = 0, i, j, count;
+
+    srandom(1);
+    for (i = 0; i < RANDOM_WRITES && ret == 0; i++)
+    {
+        count = 1 + random() % 4;
+        for (j = 0; j < count; j++)
+        {
+            sizes[j] = 1 + random() % 300;
+            offsets[j] = random() % (FILE_SIZE - sizes[j]);
+        }
+        ret = add(batch, count, offsets, sizes);
+        if (ret == 0)
+        {
+            ret = check(batch, "random", -1);
+        }
+    }
+    agg_batch_free(batch);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    ret = test_insert_before();
+    if (ret == 0)
+    {
+        ret = test_touching();
+    }
+    if (ret == 0)
+    {
+        ret = test_overlapping();
+    }
+    if (ret == 0)
+    {
+        ret = test_swallowing();
+    }
+    if (ret == 0)
+    {
+        ret = test_grow_in_place();
+    }
+    if (ret == 0)
+    {
+        ret = test_pieces();
+    }
+    if (ret == 0)
+    {
+        ret = test_random();
+    }
+
+    if (ret == 0)
+    {
+        printf("write aggregation merges right\n");
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -0,0 +1,228 @@
+/*
+ * (C) 2001 Clemson University and The University of Chicago
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Measures the handle ledger: how fast handles are allocated and freed,
+ * and how long it takes to rebuild the ledger of a collection at startup
+ * by removing every handle in use one at a time (the old dataspace scan),
+ * by removing runs of consecutive handles (the scan now), and by loading
+ * the snapshot written at the last clean shutdown.  No storage space is
+ * needed; the ledger is exercised directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "trove.h"
+#include "trove-ledger.h"
+#include "pvfs2-internal.h"
+
+#define FIRST_HANDLE 4
+
+static int handle_count = 1000000;
+static int free_stride = 3;
+
+static double Wtime(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return((double)t.tv_sec + (double)(t.tv_usec) / 1000000);
+}
+
+static struct handle_ledger *new_ledger(void)
+{
+    struct handle_ledger *hl;
+    TROVE_extent range;
+
+    hl = trove_handle_ledger_init(0, NULL);
+    if (!hl)
+    {
+        return NULL;
+    }
+    range.first = FIRST_HANDLE;
+    range.last = FIRST_HANDLE + 2 * (TROVE_handle)handle_count - 1;
+    if (trove_handle_ledger_addextent(hl, &range) != 0)
+    {
+        trove_handle_ledger_free(hl);
+        return NULL;
+    }
+    trove_handle_ledger_set_threshold(hl, range.last - range.first + 1);
+    return hl;
+}
+
+static int compare_handles(const void *a, const void *b)
+{
+    const TROVE_handle *ha = a, *hb = b;
+    return (*ha < *hb) ? -1 : (*ha > *hb);
+}
+
+/* compares the snapshot of a rebuilt ledger with the original one */
+static const char *check(struct handle_ledger *hl, void *snap, size_t len)
+{
+    void *other;
+    size_t other_len;
+    const char *result;
+
+    if (trove_handle_ledger_snapshot(hl, &other, &other_len) != 0)
+    {
+        return "FAILED";
+    }
+    result = (other_len == len && !memcmp(other, snap, len)) ?
+        "ok" : "MISMATCH";
+    free(other);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    struct handle_ledger *hl;
+    TROVE_handle *handles, first, last;
+    void *snap;
+    size_t snap_len;
+    int i, opt, in_use = 0, errors = 0;
+    const char *result;
+    double t;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != EOF)
+    {
+        switch (opt)
+        {
+            case 'n':
+                handle_count = atoi(optarg);
+                break;
+            case 's':
+                free_stride = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n handles] [-s free every "
+                        "s'th handle]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (handle_count < 1 || free_stride < 1)
+    {
+        fprintf(stderr, "Error: could not parse args.\n");
+        return -1;
+    }
+
+    handles = malloc(handle_count * sizeof(TROVE_handle));
+    hl = new_ledger();
+    if (!handles || !hl)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        return -1;
+    }
+
+    t = Wtime();
+    for (i = 0; i < handle_count; i++)
+    {
+        handles[i] = trove_ledger_handle_alloc(hl);
+        if (handles[i] == TROVE_HANDLE_NULL)
+        {
+            fprintf(stderr, "Error: allocation %d failed.\n", i);
+            return -1;
+        }
+    }
+    t = Wtime() - t;
+    printf("%-22s %10d handles %12.0f handles/sec\n", "alloc",
+           handle_count, handle_count / t);
+
+    /* free every free_stride'th handle, leaving holes in the runs */
+    t = Wtime();
+    for (i = 0; i < handle_count; i += free_stride)
+    {
+        trove_ledger_handle_free(hl, handles[i]);
+        handles[i] = TROVE_HANDLE_NULL;
+    }
+    t = Wtime() - t;
+    printf("%-22s %10d handles %12.0f handles/sec\n", "free",
+           (handle_count + free_stride - 1) / free_stride,
+           ((handle_count + free_stride - 1) / free_stride) / t);
+
+    /* what is left in use, in the ascending order a scan finds it */
+    for (i = 0; i < handle_count; i++)
+    {
+        if (handles[i] != TROVE_HANDLE_NULL)
+        {
+            handles[in_use++] = handles[i];
+        }
+    }
+    qsort(handles, in_use, sizeof(TROVE_handle), compare_handles);
+
+    t = Wtime();
+    if (trove_handle_ledger_snapshot(hl, &snap, &snap_len) != 0)
+    {
+        fprintf(stderr, "Error: snapshot failed.\n");
+        return -1;
+    }
+    t = Wtime() - t;
+    printf("%-22s %10d in use   %10.3f sec %10llu bytes\n", "snapshot",
+           in_use, t, llu(snap_len));
+    trove_handle_ledger_free(hl);
+
+    /* rebuild one handle at a time */
+    hl = new_ledger();
+    t = Wtime();
+    for (i = 0; i < in_use; i++)
+    {
+        trove_handle_remove(hl, handles[i]);
+    }
+    t = Wtime() - t;
+    result = check(hl, snap, snap_len);
+    errors += strcmp(result, "ok") != 0;
+    printf("%-22s %10d in use   %10.3f sec %s\n", "rebuild per handle",
+           in_use, t, result);
+    trove_handle_ledger_free(hl);
+
+    /* rebuild a run of consecutive handles at a time */
+    hl = new_ledger();
+    t = Wtime();
+    for (i = 0; i < in_use; i++)
+    {
+        first = last = handles[i];
+        while (i + 1 < in_use && handles[i + 1] == last + 1)
+        {
+            last = handles[++i];
+        }
+        trove_handle_remove_range(hl, first, last);
+    }
+    t = Wtime() - t;
+    result = check(hl, snap, snap_len);
+    errors += strcmp(result, "ok") != 0;
+    printf("%-22s %10d in use   %10.3f sec %s\n", "rebuild per run",
+           in_use, t, result);
+    trove_handle_ledger_free(hl);
+
+    /* rebuild from the snapshot */
+    hl = new_ledger();
+    t = Wtime();
+    if (trove_handle_ledger_load_snapshot(hl, snap, snap_len) != 0)
+    {
+        fprintf(stderr, "Error: loading the snapshot failed.\n");
+        return -1;
+    }
+    t = Wtime() - t;
+    result = check(hl, snap, snap_len);
+    errors += strcmp(result, "ok") != 0;
+    printf("%-22s %10d in use   %10.3f sec %s\n", "rebuild from snapshot",
+           in_use, t, result);
+    trove_handle_ledger_free(hl);
+
+    free(snap);
+    free(handles);
+    return errors ? -1 : 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */